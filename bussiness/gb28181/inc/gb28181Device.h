@@ -11,9 +11,19 @@ struct eXosip_t;
 #include <stddef.h>
 #include <stdint.h>
 
+#include "gb28181PsMuxer.h"
+#include "mediaRtcp.h"
+#include "mediaRtpEgress.h"
+#include "mediaRtpFec.h"
+#include "mediaRtpHistory.h"
 #include "mppEncoder.h"
 #include "v4l2Capture.h"
 
+/* 单个通道同时承载的点播会话上限（实时预览、级联上级等各占一个）。 */
+#define GB28181_MAX_MEDIA_SESSIONS 4
+/* 一个 SIP 设备下挂的通道上限，mediaGateway 每个码流占一个通道。 */
+#define GB28181_MAX_CHANNELS 4
+
 /**
  * @brief GB28181 设备侧运行参数。
  *
@@ -41,19 +51,44 @@ typedef struct {
     const char *manufacturer;         /* 厂商字段。 */
     const char *model;                /* 型号字段。 */
     const char *firmware;             /* 固件版本字段。 */
-    const char *channel_id;           /* 目录里返回的通道 ID。 */
+    const char *channel_id;           /* 通道 0 的国标 ID，其余通道由 gb28181_device_add_channel 挂入。 */
+    const char *channel_name;         /* 通道 0 在 Catalog 中的名称，默认同 device_name。 */
     const char *user_agent;           /* SIP User-Agent。 */
-    int fps;                          /* 编码帧率（用于本地编码模式与时间戳节奏）。 */
-    int bitrate;                      /* 编码码率（用于本地编码模式）。 */
+    int fps;                          /* 通道 0 编码帧率（用于本地编码模式与发送平滑）。 */
+    int bitrate;                      /* 通道 0 编码码率（用于本地编码模式与发送平滑）。 */
     int gop;                          /* GOP 长度（用于本地编码模式）。 */
     int h264_profile;                 /* H264 Profile（用于本地编码模式）。 */
     int h264_level;                   /* H264 Level（用于本地编码模式）。 */
     int h264_cabac_en;                /* CABAC 开关（用于本地编码模式）。 */
     int external_media_input;         /* 1: 外部注入 H264，不初始化 V4L2/MPP。 */
+    int rtp_gso;                      /* 1: RTP 发送尝试 UDP GSO，内核不支持时退回 sendmmsg；0: 只用 sendmmsg。 */
+    int rtp_pacing;                   /* 1: RTP 发送按令牌桶平滑，避免 I 帧突发；0: 整帧立即发出。 */
+    int rtp_pacing_rate_percent;      /* 平滑基础速率占 bitrate 的百分比。 */
+    int rtp_pacing_burst_bytes;       /* 令牌桶容量（字节）。 */
+    int rtp_pacing_spread_percent;    /* 大帧最多摊到帧间隔的百分之多少。 */
+    int rtp_nack;                     /* 1: UDP 会话保留最近发送的 RTP 包，收到 RTCP NACK 时重传；0: 关闭。 */
+    int rtp_nack_history_kb;          /* 每通道重传负载缓冲大小（KB），决定可回溯的时长。 */
+    int rtp_fec;                      /* 1: UDP 会话附带 XOR FEC（RFC 5109），无回传通道时恢复零星丢包；0: 关闭。 */
+    int rtp_fec_payload_type;         /* FEC 包的 RTP 负载类型。 */
+    int rtp_fec_key_percent;          /* 关键帧 FEC 包数占媒体包数的百分比。 */
+    int rtp_fec_delta_percent;        /* 非关键帧 FEC 包数占媒体包数的百分比。 */
+    int rtp_rtcp;                     /* 1: UDP 会话按周期发 RTCP SR，并解析平台回的 RR 统计丢包/抖动/RTT；0: 关闭。 */
+    int rtp_rtcp_interval_ms;         /* SR 发送周期（毫秒），<=0 按 1000。 */
+    const char *log_level;            /* 运行期日志级别：debug/info/warn/error/off，NULL 按 info。 */
 } Gb28181DeviceConfig;
 
 /**
- * @brief 当前点播会话状态。
+ * @brief 挂到设备下的一个通道（对应 mediaGateway 的一个码流）。
+ */
+typedef struct {
+    const char *channel_id;           /* 通道国标 ID，Catalog 返回并用于 INVITE 路由。 */
+    const char *name;                 /* Catalog 中的通道名，为空时用设备名。 */
+    int fps;                          /* 通道码流帧率，用于发送平滑。 */
+    int bitrate;                      /* 通道码流码率（bps），用于发送平滑。 */
+} Gb28181ChannelConfig;
+
+/**
+ * @brief 单个点播会话状态。
  */
 typedef struct {
     int active;                       /* 是否存在有效会话。 */
@@ -65,37 +100,76 @@ typedef struct {
     int remote_port;                  /* 对端 SDP 中的视频接收端口。 */
     char remote_ssrc[32];             /* 对端 SDP 里声明的 SSRC（可选）。 */
     char local_ssrc[32];              /* 本端在 SDP 中声明的 SSRC。 */
-    char transport[32];               /* SDP 传输描述（例如 RTP/AVP）。 */
-    int rtp_socket_fd;                /* RTP UDP socket。 */
+    char transport[32];               /* SDP 传输描述（例如 RTP/AVP、TCP/RTP/AVP）。 */
+    int rtp_socket_fd;                /* RTP socket：UDP socket，或已建立/连接中的 TCP socket。 */
+    int rtp_tcp;                      /* 1: RTP over TCP（RFC 4571 分帧）；0: RTP over UDP。 */
+    int tcp_active;                   /* TCP 模式下本端是否主动连接（对端 a=setup:passive/actpass）。 */
+    int tcp_state;                    /* TCP 连接状态：0 未连接，1 连接中，2 已建立。 */
+    int rtp_listen_fd;                /* TCP 被动模式的监听 socket，接受连接后关闭。 */
+    int rtcp_socket_fd;               /* UDP 模式开启 NACK 时绑定在 local_media_port + 1 的 RTCP socket。 */
+    long long tcp_next_connect_ms;    /* TCP 主动模式下一次允许发起 connect 的时间。 */
+    int channel;                      /* 所属通道下标。 */
+    int slot;                         /* 通道会话表下标，同时决定本地媒体端口。 */
+    int local_media_port;             /* 本会话绑定并写入 SDP 的本地媒体端口。 */
+    int wait_keyframe;                /* 新建立或丢帧后置 1，收到关键帧前不给该会话发 P 帧。 */
     unsigned short rtp_sequence;      /* RTP sequence，逐包递增。 */
     unsigned int rtp_ssrc;            /* RTP SSRC 数值形式。 */
     unsigned int last_rtp_timestamp;  /* 最近一次发送使用的 RTP 时间戳。 */
 } Gb28181MediaSession;
 
+/**
+ * @brief 单个通道的运行状态：会话表、PS 封装与各会话发送器。
+ */
+typedef struct {
+    int in_use;                       /* 通道是否已挂入。 */
+    char channel_id[32];              /* 通道国标 ID。 */
+    char name[64];                    /* Catalog 中的通道名。 */
+    int fps;                          /* 码流帧率。 */
+    int bitrate;                      /* 码流码率（bps）。 */
+    int rate_changed;                 /* 上游调整码率/帧率后置 1，发流线程据此更新各会话的发送平滑速率。 */
+    int media_port;                   /* 本通道媒体端口起点，会话端口为 media_port + 2 * slot。 */
+    Gb28181MediaSession media_sessions[GB28181_MAX_MEDIA_SESSIONS]; /* 点播会话表，按 cid 区分。 */
+    int slot_sending[GB28181_MAX_MEDIA_SESSIONS]; /* 发流线程正不持锁使用该槽位 socket 的次数，关闭前要等它归零。 */
+    int slot_closing[GB28181_MAX_MEDIA_SESSIONS]; /* 槽位正在等发送结束后关闭，发流线程不再挑选它。 */
+    int pending_force_idr;            /* ACK 建立或丢帧后待执行的一次性 IDR 请求标记。 */
+    int external_idr_requested;       /* external 模式下该请求是否已转交上游编码器。 */
+    Gb28181PsMuxer ps_muxer;          /* 常驻 PS 封装状态，只由该通道的发流线程使用。 */
+    MediaRtpEgress rtp_egress[GB28181_MAX_MEDIA_SESSIONS]; /* 每个会话槽位一个 RTP 发送器，线程归属同 ps_muxer。 */
+    int egress_cid[GB28181_MAX_MEDIA_SESSIONS];            /* 发送器当前服务的会话 cid，变化时重置目标与统计。 */
+    int nack_enabled;                 /* 重传历史是否分配成功。 */
+    MediaRtpHistoryArena nack_arena;  /* 重传负载缓冲，每个 RTP 包只拷一次，各会话共用。 */
+    MediaRtpHistory nack_history[GB28181_MAX_MEDIA_SESSIONS]; /* 每个会话槽位的重传记录，随 egress 一起重置。 */
+    int fec_enabled;                  /* FEC 生成器是否分配成功。 */
+    MediaRtpFecEncoder fec;           /* 通道共用的 XOR 校验生成器，每帧只异或一次。 */
+    MediaRtpFecStream fec_streams[GB28181_MAX_MEDIA_SESSIONS]; /* 每个会话槽位的 FEC 输出流（独立 SSRC/序号）。 */
+    MediaRtcpPeer rtcp_peers[GB28181_MAX_MEDIA_SESSIONS]; /* 每个会话槽位的 SR 节奏与接收报告统计，随 egress 一起重置。 */
+} Gb28181Channel;
+
 /**
  * @brief GB28181 设备运行时上下文。
+ *
+ * 一个上下文对应一个 SIP UA（一次注册、一路 Keepalive），下挂多个通道。
  */
 typedef struct {
     struct eXosip_t *sip_context;     /* eXosip SIP 协议栈上下文。 */
     V4L2CaptureCtx *capture;          /* 本地采集上下文（外部输入模式下可为 NULL）。 */
     MppEncoderCtx *encoder;           /* 本地编码上下文（外部输入模式下可为 NULL）。 */
     Gb28181DeviceConfig config;       /* 归一化后的配置副本。 */
-    Gb28181MediaSession media_session;/* 当前媒体会话快照。 */
+    Gb28181Channel channels[GB28181_MAX_CHANNELS]; /* 通道表，通道 0 由 config.channel_id 初始化。 */
     int rid;                          /* 注册事务 ID。 */
     int running;                      /* 主循环运行标记。 */
     int registered_ok;                /* 最近一次注册是否成功。 */
     int capture_ready;                /* capture 是否已成功初始化。 */
     int encoder_ready;                /* encoder 是否已成功初始化。 */
-    int pending_force_idr;            /* ACK 建立后待执行的一次性 IDR 请求标记。 */
-    int external_idr_requested;       /* external 模式下该请求是否已转交上游编码器。 */
     int sync_ready;                   /* 互斥锁/条件变量是否可用。 */
     int media_thread_started;         /* 媒体线程是否已创建。 */
     unsigned int xml_sn;              /* XML 消息流水号。 */
     long long next_keepalive_ms;      /* 下一次 keepalive 的绝对时间（毫秒）。 */
     long long next_register_retry_ms; /* 下一次注册重试时间（毫秒）。 */
     pthread_t media_thread;           /* 本地采集编码发流线程。 */
-    pthread_mutex_t session_lock;     /* 保护 media_session 的互斥锁。 */
+    pthread_mutex_t session_lock;     /* 保护通道表与各通道会话表的互斥锁。 */
     pthread_cond_t session_cond;      /* SIP 与媒体线程之间的唤醒条件。 */
+    pthread_cond_t send_done_cond;    /* 发流线程放下槽位 socket 时广播，关闭会话的一方据此等待。 */
 } Gb28181DeviceCtx;
 
 /**
@@ -106,6 +180,24 @@ typedef struct {
  */
 int gb28181_device_init(Gb28181DeviceCtx *ctx, const Gb28181DeviceConfig *config);
 
+/**
+ * @brief 挂入一个通道，可在 SIP 线程运行期间调用。
+ *
+ * 通道媒体端口按下标自动分配：config.media_port + 通道下标 * 2 * GB28181_MAX_MEDIA_SESSIONS。
+ *
+ * @param ctx 设备上下文。
+ * @param channel 通道配置，channel_id 不能与已有通道重复。
+ * @return 通道下标，<0 失败（通道表满或 ID 重复）。
+ */
+int gb28181_device_add_channel(Gb28181DeviceCtx *ctx, const Gb28181ChannelConfig *channel);
+
+/**
+ * @brief 摘除通道并关闭其上的点播会话，调用方需保证该通道不再有发送线程。
+ * @param ctx 设备上下文。
+ * @param channel 通道下标。
+ */
+void gb28181_device_remove_channel(Gb28181DeviceCtx *ctx, int channel);
+
 /**
  * @brief 运行 SIP 事件循环（阻塞）。
  * @param ctx 设备上下文。
@@ -126,11 +218,22 @@ void gb28181_device_stop(Gb28181DeviceCtx *ctx);
 void gb28181_device_deinit(Gb28181DeviceCtx *ctx);
 
 /**
- * @brief 读取当前媒体会话快照。
+ * @brief 读取通道第一个活跃媒体会话的快照，没有会话时输出“无会话”状态。
  * @param ctx 设备上下文。
+ * @param channel 通道下标。
  * @param session 输出会话快照。
  */
-void gb28181_device_get_media_session(const Gb28181DeviceCtx *ctx, Gb28181MediaSession *session);
+void gb28181_device_get_media_session(const Gb28181DeviceCtx *ctx, int channel, Gb28181MediaSession *session);
+
+/**
+ * @brief 读取通道全部活跃媒体会话的快照。
+ * @param ctx 设备上下文。
+ * @param channel 通道下标。
+ * @param sessions 输出数组。
+ * @param max_sessions 输出数组容量。
+ * @return 实际写出的会话数。
+ */
+int gb28181_device_get_media_sessions(const Gb28181DeviceCtx *ctx, int channel, Gb28181MediaSession *sessions, int max_sessions);
 
 /**
  * @brief 外部输入 H264（Annex-B）帧并发送为 GB28181 PS/RTP。
@@ -138,9 +241,11 @@ void gb28181_device_get_media_session(const Gb28181DeviceCtx *ctx, Gb28181MediaS
  * 该接口用于复用外部编码链路（例如 mediaGateway 的共享编码输出）。
  * 函数内部会根据当前会话状态决定是否发送：
  * - 无有效会话时直接返回 0（不报错）；
- * - 有效会话时执行 PS 封装 + RTP 发送。
+ * - 有效会话时执行一次 PS 封装，再把 RTP 分片扇出到所有已建立的会话；
+ *   单个会话发送失败只关闭该会话，不影响其它会话。
  *
  * @param ctx 设备上下文。
+ * @param channel 通道下标，同一通道只能由一个线程调用。
  * @param h264_data Annex-B 格式 H264 数据。
  * @param h264_len 数据长度。
  * @param is_key_frame 是否关键帧（IDR）。
@@ -148,16 +253,35 @@ void gb28181_device_get_media_session(const Gb28181DeviceCtx *ctx, Gb28181MediaS
  * @return 0 成功或无需发送，<0 发送链路异常。
  */
 int gb28181_device_send_h264(Gb28181DeviceCtx *ctx,
+                             int channel,
                              const uint8_t *h264_data,
                              size_t h264_len,
                              int is_key_frame,
                              uint64_t pts_us);
 
 /*
- * external 模式下：查询并“消费”一次 ACK 触发的 IDR 请求。
+ * external 模式下：查询并“消费”通道上一次 ACK 触发的 IDR 请求。
  * 返回 1 表示上游应立即请求一次 IDR；返回 0 表示当前无需请求。
  */
-int gb28181_device_consume_external_idr_request(Gb28181DeviceCtx *ctx);
+int gb28181_device_consume_external_idr_request(Gb28181DeviceCtx *ctx, int channel);
+
+/*
+ * 查询通道当前是否有点播会话（INVITE 已应答即算，不必等 ACK），供上游按需编码判断。
+ * 返回 1 表示有会话；返回 0 表示没有。
+ */
+int gb28181_device_has_media_session(Gb28181DeviceCtx *ctx, int channel);
+
+/*
+ * 查询通道是否有正在收流的会话（已建立且已收到过关键帧）。
+ * 通道内所有会话共用一个发送队列，有这样的会话时不能往队列里回放旧关键帧缓存，否则它会重复收到旧帧。
+ */
+int gb28181_device_has_live_session(Gb28181DeviceCtx *ctx, int channel);
+
+/*
+ * external 模式下：上游编码器码率/帧率被重新配置（ABR 或手动调参）后通知通道，
+ * 发流线程在下一帧更新各会话的发送平滑速率。
+ */
+void gb28181_device_update_channel_rate(Gb28181DeviceCtx *ctx, int channel, int bitrate, int fps);
 
 #ifdef __cplusplus
 }
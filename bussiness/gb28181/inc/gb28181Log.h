@@ -0,0 +1,65 @@
+#ifndef __GB28181_LOG_H__
+#define __GB28181_LOG_H__
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 日志级别，数值越大越重要。 */
+#define GB28181_LOG_LEVEL_DEBUG 0
+#define GB28181_LOG_LEVEL_INFO 1
+#define GB28181_LOG_LEVEL_WARN 2
+#define GB28181_LOG_LEVEL_ERROR 3
+#define GB28181_LOG_LEVEL_OFF 4
+
+/*
+ * 编译期下限：低于该级别的日志语句条件恒为假，连同参数求值一起被编译器删掉。
+ * 例如 -DGB28181_LOG_COMPILE_LEVEL=2 只保留告警和错误。
+ */
+#ifndef GB28181_LOG_COMPILE_LEVEL
+#define GB28181_LOG_COMPILE_LEVEL GB28181_LOG_LEVEL_DEBUG
+#endif
+
+/* 运行期级别，默认 INFO；只在启动时由配置写入，热路径只读一次整型。 */
+extern int g_gb28181_log_level;
+
+/**
+ * @brief 该级别的日志当前是否会输出。需要先做额外计算（拼接 NALU 列表等）的日志用它包住整段代码。
+ */
+#define GB28181_LOG_ENABLED(level) ((level) >= GB28181_LOG_COMPILE_LEVEL && (level) >= g_gb28181_log_level)
+
+/**
+ * @brief 按级别输出一行日志，未启用时不求值任何参数；WARN 及以上写 stderr，其余写 stdout。
+ */
+#define GB28181_LOG(level, ...)                                                          \
+    do                                                                                   \
+    {                                                                                    \
+        if (GB28181_LOG_ENABLED(level))                                                  \
+            fprintf(((level) >= GB28181_LOG_LEVEL_WARN) ? stderr : stdout, __VA_ARGS__); \
+    } while (0)
+
+#define GB28181_LOGD(...) GB28181_LOG(GB28181_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define GB28181_LOGI(...) GB28181_LOG(GB28181_LOG_LEVEL_INFO, __VA_ARGS__)
+#define GB28181_LOGW(...) GB28181_LOG(GB28181_LOG_LEVEL_WARN, __VA_ARGS__)
+#define GB28181_LOGE(...) GB28181_LOG(GB28181_LOG_LEVEL_ERROR, __VA_ARGS__)
+
+/**
+ * @brief 设置运行期日志级别。
+ * @param level GB28181_LOG_LEVEL_*，越界时按 INFO 处理。
+ */
+void gb28181_log_set_level(int level);
+
+/**
+ * @brief 把配置里的级别名（debug/info/warn/error/off，不区分大小写）转成级别值。
+ * @param name 级别名，NULL 或无法识别时返回 INFO。
+ * @return GB28181_LOG_LEVEL_*。
+ */
+int gb28181_log_parse_level(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef __GB28181_PS_MUXER_H__
+#define __GB28181_PS_MUXER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+/* 单帧最多处理的 NALU 数，超出时整帧封装失败。 */
+#define GB28181_PS_MUXER_MAX_NALUS 64
+/* 单个 RTP 包最多引用的分段数，超过时提前结束该包。 */
+#define GB28181_PS_MUXER_MAX_PACKET_IOV 16
+/* 一帧内 pack/system/PSM/PES 头部的暂存区大小。 */
+#define GB28181_PS_MUXER_HEADER_SCRATCH 2048
+
+/**
+ * @brief NALU 描述：记录 Annex-B 一帧中每个 NALU 的偏移与长度。
+ */
+typedef struct {
+    size_t offset;                    /* NALU 负载（不含起始码）在原帧中的偏移。 */
+    size_t length;                    /* NALU 负载长度。 */
+    uint8_t type;                     /* nal_unit_type。 */
+} Gb28181PsNalu;
+
+/**
+ * @brief PS 字节流中的一段：要么指向头部暂存区，要么直接指向原始 NALU 内存。
+ */
+typedef struct {
+    const uint8_t *data;              /* 分段起始地址。 */
+    size_t length;                    /* 分段长度。 */
+} Gb28181PsSegment;
+
+/**
+ * @brief 每个媒体会话常驻一份的 PS 封装状态。
+ *
+ * 一帧只生成头部字节，负载以分段形式引用调用方传入的 H264 数据，
+ * 分包时按 RTP 负载大小切出 iovec，由发送方 sendmsg 聚合发送，全程不拷贝整帧、不分配堆内存。
+ * 分段引用的 H264 数据必须在 packetize 完成前保持有效。
+ */
+typedef struct {
+    Gb28181PsNalu nalus[GB28181_PS_MUXER_MAX_NALUS];           /* 当前帧解析出的 NALU 列表。 */
+    size_t nalu_count;                                         /* 当前帧 NALU 数。 */
+    uint8_t headers[GB28181_PS_MUXER_HEADER_SCRATCH];          /* 当前帧全部 PS/PES 头部。 */
+    size_t headers_len;                                        /* headers 已使用长度。 */
+    Gb28181PsSegment segments[GB28181_PS_MUXER_MAX_NALUS * 2 + 1]; /* 当前帧 PS 字节流的分段视图。 */
+    size_t segment_count;                                      /* 分段数。 */
+    size_t frame_len;                                          /* 当前帧 PS 总长度。 */
+    uint64_t frames;                                           /* 累计封装帧数。 */
+    uint64_t packets;                                          /* 累计切出的 RTP 包数。 */
+    uint64_t ps_bytes;                                         /* 累计 PS 字节数。 */
+    uint64_t copied_bytes;                                     /* 累计写入暂存区的字节数（只有头部）。 */
+    uint64_t key_frames;                                       /* 累计关键帧数。 */
+    uint64_t nalu_types[32];                                   /* 按 NALU 类型累计的个数，替代逐帧打印 NALU 列表。 */
+} Gb28181PsMuxer;
+
+/**
+ * @brief 分包回调：一个 RTP 负载由若干 iovec 组成。
+ * @param user 调用方上下文。
+ * @param iov 负载分段，仅在回调期间有效。
+ * @param iov_count 分段数。
+ * @param payload_len 负载总长度。
+ * @param marker 是否为本帧最后一个包。
+ * @return 0 继续，<0 中止本帧分包。
+ */
+typedef int (*Gb28181PsPacketFn)(void *user, const struct iovec *iov, int iov_count, size_t payload_len, int marker);
+
+/**
+ * @brief 初始化封装状态。
+ * @param muxer 封装状态。
+ */
+void gb28181_ps_muxer_init(Gb28181PsMuxer *muxer);
+
+/**
+ * @brief 把一帧 Annex-B H264 组装成 PS 分段视图。关键帧前附带 system header + PSM，AUD 被丢弃。
+ * @param muxer 封装状态。
+ * @param annexb_data 帧数据，packetize 完成前必须保持有效。
+ * @param annexb_len 帧长度。
+ * @param is_key_frame 是否关键帧。
+ * @param pts_90k 90kHz 时间戳，同时用作 SCR 和 PES PTS。
+ * @return 0 成功，<0 失败。
+ */
+int gb28181_ps_muxer_build(Gb28181PsMuxer *muxer, const uint8_t *annexb_data, size_t annexb_len, int is_key_frame, uint64_t pts_90k);
+
+/**
+ * @brief 按 max_payload 把当前帧切成 RTP 负载，每个包调用一次回调。
+ * @param muxer 封装状态，需先 build。
+ * @param max_payload 单包最大负载。
+ * @param fn 分包回调。
+ * @param user 回调上下文。
+ * @return 0 成功，<0 回调中止或参数错误。
+ */
+int gb28181_ps_muxer_packetize(Gb28181PsMuxer *muxer, size_t max_payload, Gb28181PsPacketFn fn, void *user);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
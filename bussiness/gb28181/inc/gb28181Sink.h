@@ -17,7 +17,7 @@ typedef struct {
     const char *device_domain;         /* 设备所属域，未配置时默认跟随 server_domain。 */
     const char *device_password;       /* SIP Digest 鉴权密码。 */
     const char *bind_ip;               /* 本地 SIP 监听绑定地址，通常使用 0.0.0.0。 */
-    int local_sip_port;                /* 本地 SIP 监听端口。 */
+    int local_sip_port;                /* 本地 SIP 监听端口，端口相同的 sink 共用一个设备注册。 */
     const char *sip_contact_ip;        /* SIP Contact 头中对外声明的设备 IP。 */
     const char *media_ip;              /* SDP 中对外声明的媒体发送 IP。 */
     int media_port;                    /* 本地 RTP 绑定端口，同时也是 SDP 中声明的媒体端口。 */
@@ -28,9 +28,26 @@ typedef struct {
     const char *manufacturer;          /* DeviceInfo/Catalog 响应里的厂商字段。 */
     const char *model;                 /* DeviceInfo/Catalog 响应里的型号字段。 */
     const char *firmware;              /* DeviceInfo 响应里的固件版本字段。 */
-    const char *channel_id;            /* 当前单通道实现里的通道编码。 */
+    const char *channel_id;            /* 本 sink 对应的通道编码，同一设备下各 sink 必须不同。 */
+    const char *channel_name;          /* Catalog 响应里的通道名，默认同 device_name。 */
     const char *user_agent;            /* SIP User-Agent。 */
     int queue_capacity;                /* GB28181 sink 自己的发送队列容量。 */
+    int rtp_gso;                       /* RTP 发送是否尝试 UDP GSO，不支持时自动退回 sendmmsg。 */
+    int video_fps;                     /* 码流帧率，用于计算发送平滑窗口。 */
+    int video_bitrate;                 /* 码流码率（bps），用于计算发送平滑速率。 */
+    int rtp_pacing;                    /* RTP 发送是否做令牌桶平滑。 */
+    int rtp_pacing_rate_percent;       /* 平滑基础速率占码率的百分比。 */
+    int rtp_pacing_burst_bytes;        /* 令牌桶容量（字节）。 */
+    int rtp_pacing_spread_percent;     /* 大帧最多摊到帧间隔的百分之多少。 */
+    int rtp_nack;                      /* UDP 会话是否按 RTCP NACK 重传丢包。 */
+    int rtp_nack_history_kb;           /* 每通道重传负载缓冲大小（KB）。 */
+    int rtp_fec;                       /* UDP 会话是否附带 XOR FEC。 */
+    int rtp_fec_payload_type;          /* FEC 包的 RTP 负载类型。 */
+    int rtp_fec_key_percent;           /* 关键帧 FEC 包数占媒体包数的百分比。 */
+    int rtp_fec_delta_percent;         /* 非关键帧 FEC 包数占媒体包数的百分比。 */
+    int rtp_rtcp;                      /* UDP 会话是否发 RTCP SR 并统计平台的接收报告。 */
+    int rtp_rtcp_interval_ms;          /* SR 发送周期（毫秒）。 */
+    const char *log_level;             /* GB28181 模块日志级别：debug/info/warn/error/off。 */
 } Gb28181SinkConfig;
 
 int gb28181_sink_setup(MediaSink *sink, const Gb28181SinkConfig *config);
@@ -38,6 +55,12 @@ int gb28181_sink_setup(MediaSink *sink, const Gb28181SinkConfig *config);
 /* external 模式下供 mediaGateway 轮询：是否需要立刻请求一次 IDR。 */
 int gb28181_sink_consume_external_idr_request(MediaSink *sink);
 
+/* 是否有会话正在收流；有则不能把关键帧缓存回放进共用的发送队列。 */
+int gb28181_sink_has_live_session(MediaSink *sink);
+
+/* 上游编码器码率/帧率变化后调用，RTP 发送平滑随之按新码率计算。 */
+void gb28181_sink_update_rate(MediaSink *sink, int bitrate, int fps);
+
 #ifdef __cplusplus
 }
 #endif
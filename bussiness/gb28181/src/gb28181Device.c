@@ -1,4 +1,5 @@
 ﻿#include "gb28181Device.h"
+#include "gb28181Log.h"
 
 #include <arpa/inet.h>
 #include <eXosip2/eXosip.h>
@@ -6,6 +7,8 @@
 #include <osipparser2/osip_message.h>
 #include <osipparser2/osip_parser.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -40,35 +43,30 @@
 #define GB28181_DEFAULT_H264_CABAC_EN 1
 #define GB28181_RTP_PAYLOAD_TYPE 96
 #define GB28181_RTP_MAX_PAYLOAD 1400
-#define GB28181_PS_STREAM_ID_VIDEO 0xE0
-#define GB28181_PS_BUFFER_INIT_SIZE (2 * 1024 * 1024)
+#define GB28181_EGRESS_LOG_INTERVAL_FRAMES 250
+/* TCP 媒体连接的发送缓冲：约 1s 的 4Mbps 码流，超出时按帧丢弃而不是无限堆积时延。 */
+#define GB28181_RTP_TCP_SNDBUF (512 * 1024)
+#define GB28181_RTP_TCP_CONNECT_RETRY_MS 1000
+#define GB28181_DEFAULT_NACK_HISTORY_KB 1024
+/* 每个会话最多记录的重传包数，超过负载缓冲能容纳的包数即可。 */
+#define GB28181_NACK_HISTORY_ENTRIES 2048
+#define GB28181_TCP_IDLE 0
+#define GB28181_TCP_CONNECTING 1
+#define GB28181_TCP_CONNECTED 2
 
 /*
  * 本文件实现 GB28181 设备端核心能力，包含两条主线：
  * 1. SIP 信令：REGISTER、鉴权、Keepalive、Catalog、DeviceInfo、INVITE/BYE；
- * 2. 媒体发送：H264(Annex-B) -> PS 封装 -> RTP 分包发送。
+ * 2. 媒体发送：H264(Annex-B) -> PS 封装 -> RTP 分包发送（UDP，或 TCP/RTP/AVP 主动/被动连接）。
  *
  * 运行模式：
- * - 内部媒体模式：本模块自行初始化 V4L2 + MPP，并由 media_thread 抓帧编码后发送；
- * - 外部媒体模式：由外部模块调用 gb28181_device_send_h264() 注入编码帧。
+ * - 内部媒体模式：本模块自行初始化 V4L2 + MPP，并由 media_thread 抓帧编码后发送（只用通道 0）；
+ * - 外部媒体模式：由外部模块调用 gb28181_device_send_h264() 按通道注入编码帧。
+ *
+ * 一个上下文只有一个 SIP UA，多个通道共用注册与 Keepalive，Catalog 逐个列出通道，
+ * INVITE 按 Request-URI（缺省时 To）中的通道 ID 路由到对应通道的会话表。
  */
 
-/* 动态缓存：用于组装 PS 帧，避免频繁临时 malloc/free。 */
-typedef struct
-{
-    uint8_t *data;
-    size_t size;
-    size_t capacity;
-} Gb28181Buffer;
-
-/* NALU 描述：记录 Annex-B 一帧中每个 NALU 的偏移与长度。 */
-typedef struct
-{
-    size_t offset;
-    size_t length;
-    uint8_t type;
-} Gb28181NaluUnit;
-
 static const char *h264_nalu_type_name(uint8_t type)
 {
     switch (type)
@@ -90,7 +88,7 @@ static const char *h264_nalu_type_name(uint8_t type)
     }
 }
 
-static void log_h264_nalu_summary(const Gb28181NaluUnit *nalus, size_t nalu_count, int is_key_frame, uint64_t pts_us, uint64_t pts_90k)
+static void log_h264_nalu_summary(const Gb28181PsNalu *nalus, size_t nalu_count, int is_key_frame, uint64_t pts_us, uint64_t pts_90k)
 {
     char type_log[512];
     size_t pos = 0;
@@ -118,12 +116,12 @@ static void log_h264_nalu_summary(const Gb28181NaluUnit *nalus, size_t nalu_coun
         pos += (size_t)written;
     }
     type_log[sizeof(type_log) - 1] = '\0';
-    printf("[GB28181][H264] pts_us=%llu pts_90k=%llu key=%d nalu_count=%zu types=%s\n",
-           (unsigned long long)pts_us,
-           (unsigned long long)pts_90k,
-           is_key_frame ? 1 : 0,
-           nalu_count,
-           (type_log[0] != '\0') ? type_log : "N/A");
+    GB28181_LOGD("[GB28181][H264] pts_us=%llu pts_90k=%llu key=%d nalu_count=%zu types=%s\n",
+                 (unsigned long long)pts_us,
+                 (unsigned long long)pts_90k,
+                 is_key_frame ? 1 : 0,
+                 nalu_count,
+                 (type_log[0] != '\0') ? type_log : "N/A");
 }
 
 /* 获取当前毫秒时间戳（单调递增相对时间）。 */
@@ -134,6 +132,14 @@ static long long get_now_ms(void)
     return (long long)tv.tv_sec * 1000LL + (long long)(tv.tv_usec / 1000);
 }
 
+/* 获取单调时钟微秒，与采集/上游 pts 同一时基，用于推算 SR 的 RTP 时间戳。 */
+static uint64_t get_monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
 /* 周期性 re-REGISTER：在过期前预留 5 秒；最小不低于失败重试周期。 */
 static long long get_register_refresh_interval_ms(const Gb28181DeviceCtx *ctx)
 {
@@ -161,6 +167,8 @@ static void reset_media_session(Gb28181MediaSession *session)
         return;
     memset(session, 0, sizeof(*session));
     session->rtp_socket_fd = -1;
+    session->rtp_listen_fd = -1;
+    session->rtcp_socket_fd = -1;
 }
 
 /* 将用户输入配置补齐为可运行的完整配置。 */
@@ -195,6 +203,7 @@ static void fill_default_config(Gb28181DeviceConfig *dst, const Gb28181DeviceCon
     dst->model = safe_str(dst->model, GB28181_DEFAULT_MODEL);
     dst->firmware = safe_str(dst->firmware, GB28181_DEFAULT_FIRMWARE);
     dst->channel_id = safe_str(dst->channel_id, dst->device_id);
+    dst->channel_name = safe_str(dst->channel_name, dst->device_name);
     dst->user_agent = safe_str(dst->user_agent, GB28181_DEFAULT_USER_AGENT);
     if (dst->fps <= 0)
         dst->fps = GB28181_DEFAULT_FPS;
@@ -208,6 +217,15 @@ static void fill_default_config(Gb28181DeviceConfig *dst, const Gb28181DeviceCon
         dst->h264_level = GB28181_DEFAULT_H264_LEVEL;
     if (dst->h264_cabac_en < 0)
         dst->h264_cabac_en = GB28181_DEFAULT_H264_CABAC_EN;
+    dst->rtp_gso = dst->rtp_gso ? 1 : 0;
+    dst->rtp_pacing = dst->rtp_pacing ? 1 : 0;
+    dst->rtp_nack = dst->rtp_nack ? 1 : 0;
+    dst->rtp_fec = dst->rtp_fec ? 1 : 0;
+    dst->rtp_rtcp = dst->rtp_rtcp ? 1 : 0;
+    if (dst->rtp_nack_history_kb <= 0)
+        dst->rtp_nack_history_kb = GB28181_DEFAULT_NACK_HISTORY_KB;
+    if (dst->rtp_rtcp_interval_ms <= 0)
+        dst->rtp_rtcp_interval_ms = MEDIA_RTCP_DEFAULT_INTERVAL_MS;
 }
 
 /* 构建 REGISTER 所需的 from/proxy/contact 三个 URI。 */
@@ -276,13 +294,14 @@ static int extract_line_after_prefix(const char *text, const char *prefix, char
     return 0;
 }
 
-/* 解析 INVITE SDP，提取对端媒体地址、端口、SSRC。 */
+/* 解析 INVITE SDP，提取对端媒体地址、端口、SSRC 以及 TCP 连接方向。 */
 static int parse_invite_sdp(const char *sdp_body, Gb28181MediaSession *session)
 {
     char media_line[128];
+    char setup[32];
     if (!sdp_body || !session)
     {
-        fprintf(stderr, "[GB28181][ERROR] parse_invite_sdp invalid args\n");
+        GB28181_LOGE("[GB28181][ERROR] parse_invite_sdp invalid args\n");
         return -1;
     }
     memset(session->remote_ip, 0, sizeof(session->remote_ip));
@@ -294,23 +313,32 @@ static int parse_invite_sdp(const char *sdp_body, Gb28181MediaSession *session)
     {
         if (sscanf(media_line, "%d %31s", &session->remote_port, session->transport) < 2)
         {
-            fprintf(stderr, "[GB28181][ERROR] parse_invite_sdp invalid m=video line: %s\n", media_line);
+            GB28181_LOGE("[GB28181][ERROR] parse_invite_sdp invalid m=video line: %s\n", media_line);
             return -1;
         }
     }
     extract_line_after_prefix(sdp_body, "y=", session->remote_ssrc, sizeof(session->remote_ssrc));
-    if (session->remote_port <= 0)
+    session->rtp_tcp = (strncmp(session->transport, "TCP/", 4) == 0) ? 1 : 0;
+    if (session->rtp_tcp)
+    {
+        /* 平台 a=setup:active 表示由平台来连，本端监听；passive/actpass/缺省时本端主动连接。 */
+        memset(setup, 0, sizeof(setup));
+        extract_line_after_prefix(sdp_body, "a=setup:", setup, sizeof(setup));
+        session->tcp_active = (strncmp(setup, "active", 6) == 0) ? 0 : 1;
+    }
+    /* 本端被动监听时对端端口只是占位，不参与发送。 */
+    if (session->remote_port <= 0 && !(session->rtp_tcp && !session->tcp_active))
     {
-        fprintf(stderr, "[GB28181][ERROR] parse_invite_sdp remote_port invalid: %d\n", session->remote_port);
+        GB28181_LOGE("[GB28181][ERROR] parse_invite_sdp remote_port invalid: %d\n", session->remote_port);
         return -1;
     }
     return 0;
 }
 
-/* 生成本端会话 SSRC（字符串与数值同时保存）。 */
+/* 生成本端会话 SSRC（字符串与数值同时保存），混入 cid 保证同一秒内建立的多个会话互不相同。 */
 static void generate_local_ssrc(Gb28181MediaSession *session)
 {
-    unsigned int value = (unsigned int)((time(NULL) ^ getpid()) & 0x3FFFFFFF);
+    unsigned int value = (unsigned int)((time(NULL) ^ getpid() ^ ((unsigned int)session->cid * 2654435761U)) & 0x3FFFFFFF);
     if (value == 0)
         value = 1;
     session->rtp_ssrc = value;
@@ -348,429 +376,872 @@ static int use_invite_ssrc_if_valid(Gb28181MediaSession *session)
     return 0;
 }
 
-/* 初始化可增长缓存。 */
-static int gb_buffer_init(Gb28181Buffer *buffer, size_t initial_capacity)
+/* 本帧扇出的一个目标会话：会话快照 + 所属发送器，序号在快照上递增，发完再写回会话表。 */
+typedef struct
 {
-    if (!buffer)
-    {
-        fprintf(stderr, "[GB28181][ERROR] gb_buffer_init buffer is NULL\n");
-        return -1;
-    }
-    memset(buffer, 0, sizeof(*buffer));
-    buffer->data = (uint8_t *)malloc(initial_capacity);
-    if (!buffer->data)
-    {
-        fprintf(stderr, "[GB28181][ERROR] gb_buffer_init alloc failed size=%zu\n", initial_capacity);
-        return -1;
-    }
-    buffer->capacity = initial_capacity;
-    return 0;
+    Gb28181MediaSession session;
+    MediaRtpEgress *egress;
+    MediaRtpHistory *history;
+    MediaRtpFecStream *fec;
+    MediaRtcpPeer *rtcp;
+    unsigned short first_seq;
+    int dropped;
+    int failed;
+} Gb28181RtpTarget;
+
+/* RTP 分包发送上下文：一帧内所有包共用同一时间戳，每个分片排进所有目标会话。 */
+typedef struct
+{
+    Gb28181RtpTarget *targets;
+    int target_count;
+    uint32_t rtp_timestamp;
+    size_t ps_len;
+    MediaRtpHistoryArena *nack_arena;
+    MediaRtpFecEncoder *fec;
+} Gb28181RtpSendCtx;
+
+/* 组 12 字节 RTP 头，会话之间只有序号和 SSRC 不同。 */
+static void build_rtp_header(uint8_t *header, const Gb28181MediaSession *session, uint32_t rtp_timestamp, int marker)
+{
+    unsigned short seq = session->rtp_sequence;
+    header[0] = 0x80;
+    header[1] = (uint8_t)((marker ? 0x80 : 0x00) | GB28181_RTP_PAYLOAD_TYPE);
+    header[2] = (uint8_t)((seq >> 8) & 0xFF);
+    header[3] = (uint8_t)(seq & 0xFF);
+    header[4] = (uint8_t)((rtp_timestamp >> 24) & 0xFF);
+    header[5] = (uint8_t)((rtp_timestamp >> 16) & 0xFF);
+    header[6] = (uint8_t)((rtp_timestamp >> 8) & 0xFF);
+    header[7] = (uint8_t)(rtp_timestamp & 0xFF);
+    header[8] = (uint8_t)((session->rtp_ssrc >> 24) & 0xFF);
+    header[9] = (uint8_t)((session->rtp_ssrc >> 16) & 0xFF);
+    header[10] = (uint8_t)((session->rtp_ssrc >> 8) & 0xFF);
+    header[11] = (uint8_t)(session->rtp_ssrc & 0xFF);
 }
 
-/* 释放可增长缓存。 */
-static void gb_buffer_deinit(Gb28181Buffer *buffer)
+/*
+ * 把各目标会话已排队的包放进同一个平滑窗口交错发出：每个会话仍按自己的令牌桶节奏，
+ * 但不再一个会话发完才轮到下一个，I 帧扇出到 N 个会话的总耗时约为一个平滑窗口。
+ * 发送失败的会话标记 failed。
+ */
+static void flush_rtp_targets(Gb28181RtpTarget *targets, int target_count)
 {
-    if (!buffer)
+    MediaRtpEgress *egresses[GB28181_MAX_MEDIA_SESSIONS];
+    int index[GB28181_MAX_MEDIA_SESSIONS];
+    int results[GB28181_MAX_MEDIA_SESSIONS];
+    int count = 0;
+    int i;
+    for (i = 0; i < target_count && count < GB28181_MAX_MEDIA_SESSIONS; ++i)
+    {
+        if (targets[i].dropped || targets[i].failed)
+            continue;
+        egresses[count] = targets[i].egress;
+        index[count] = i;
+        count++;
+    }
+    if (count == 0)
         return;
-    free(buffer->data);
-    memset(buffer, 0, sizeof(*buffer));
+    media_rtp_egress_flush_group(egresses, count, results);
+    for (i = 0; i < count; ++i)
+    {
+        if (results[i] != 0)
+            targets[index[i]].failed = 1;
+    }
 }
 
-/* 确保缓存至少还能追加 append_size 字节。 */
-static int gb_buffer_reserve(Gb28181Buffer *buffer, size_t append_size)
+/*
+ * PS 分包回调：负载 iovec 直接指向 PS 头部暂存区和原始 NALU，只切一次，
+ * 同一组 iovec 配上各会话自己的 RTP 头排进各自的 egress，整帧切完后批量发出。
+ * 单个会话排队失败只标记该会话，全部失败才中止分包。
+ * 开启 NACK 时负载只往共享重传缓冲拷一次，各 UDP 会话只记录自己的 RTP 头和负载位置。
+ */
+static int queue_rtp_packet(void *user, const struct iovec *iov, int iov_count, size_t payload_len, int marker)
 {
-    size_t need_size = 0;
-    size_t new_capacity = 0;
-    uint8_t *new_data = NULL;
-    if (!buffer)
+    Gb28181RtpSendCtx *send_ctx = (Gb28181RtpSendCtx *)user;
+    uint32_t rtp_timestamp = send_ctx->rtp_timestamp;
+    uint64_t history_pos = 0;
+    int alive = 0;
+    int i;
+    /* 各会话批次同时排满时一起交错发出，避免由单个 egress 自动 flush 时独占整段平滑等待。 */
+    for (i = 0; i < send_ctx->target_count; ++i)
+    {
+        const Gb28181RtpTarget *target = &send_ctx->targets[i];
+        if (!target->dropped && !target->failed && target->egress->count >= MEDIA_RTP_EGRESS_MAX_BATCH)
+        {
+            flush_rtp_targets(send_ctx->targets, send_ctx->target_count);
+            break;
+        }
+    }
+    if (send_ctx->nack_arena)
+        history_pos = media_rtp_history_arena_append(send_ctx->nack_arena, iov, iov_count);
+    if (send_ctx->fec)
     {
-        fprintf(stderr, "[GB28181][ERROR] gb_buffer_reserve buffer is NULL\n");
-        return -1;
+        /* FEC 只用到 RTP 头里与会话无关的字段（P/X/CC/M/PT/时间戳），取第一个目标的头即可。 */
+        uint8_t header[12];
+        build_rtp_header(header, &send_ctx->targets[0].session, rtp_timestamp, marker);
+        media_rtp_fec_add_packet(send_ctx->fec, header, iov, iov_count, payload_len);
     }
-    need_size = buffer->size + append_size;
-    if (need_size <= buffer->capacity)
-        return 0;
-    new_capacity = buffer->capacity;
-    while (new_capacity < need_size)
-        new_capacity *= 2;
-    new_data = (uint8_t *)realloc(buffer->data, new_capacity);
-    if (!new_data)
+    for (i = 0; i < send_ctx->target_count; ++i)
     {
-        fprintf(stderr, "[GB28181][ERROR] gb_buffer_reserve realloc failed need=%zu cap=%zu\n", need_size, new_capacity);
-        return -1;
+        Gb28181RtpTarget *target = &send_ctx->targets[i];
+        Gb28181MediaSession *session = &target->session;
+        uint8_t header[12];
+        if (target->dropped || target->failed)
+            continue;
+        build_rtp_header(header, session, rtp_timestamp, marker);
+        if (session->rtp_sequence == 0 && target->egress->frames == 0)
+        {
+            GB28181_LOGI("[GB28181][RTP] first_packet channel=%d slot=%d remote=%s:%d ps_len=%zu chunk=%zu seq=%u ts=%u ssrc=%u marker=%d\n",
+                         session->channel, session->slot, session->remote_ip, session->remote_port, send_ctx->ps_len, payload_len,
+                         session->rtp_sequence, rtp_timestamp, session->rtp_ssrc, marker);
+        }
+        if (media_rtp_egress_queue(target->egress, header, sizeof(header), iov, iov_count) != 0)
+        {
+            GB28181_LOGW("[GB28181][RTP] send failed slot=%d remote=%s:%d seq=%u ts=%u\n",
+                         session->slot, session->remote_ip, session->remote_port, session->rtp_sequence, rtp_timestamp);
+            target->failed = 1;
+            continue;
+        }
+        if (target->history)
+            media_rtp_history_record(target->history, header, history_pos, payload_len);
+        session->rtp_sequence++;
+        alive++;
     }
-    buffer->data = new_data;
-    buffer->capacity = new_capacity;
-    return 0;
+    return alive > 0 ? 0 : -1;
 }
 
-/* 向缓存尾部追加数据。 */
-static int gb_buffer_append(Gb28181Buffer *buffer, const void *data, size_t len)
+/* 把 egress 指向会话的传输目标：UDP 按地址缓存，TCP 在连接建立时已设置，这里只兜底 fd 不一致。 */
+static int bind_target_egress(Gb28181RtpTarget *target)
 {
-    if (!buffer || !data)
+    Gb28181MediaSession *session = &target->session;
+    MediaRtpEgress *egress = target->egress;
+    if (session->rtp_tcp)
     {
-        fprintf(stderr, "[GB28181][ERROR] gb_buffer_append invalid args len=%zu\n", len);
-        return -1;
+        if (egress->transport == MEDIA_RTP_TRANSPORT_TCP && egress->fd == session->rtp_socket_fd)
+            return 0;
+        return media_rtp_egress_set_tcp_target(egress, session->rtp_socket_fd);
     }
-    if (gb_buffer_reserve(buffer, len) != 0)
+    if (media_rtp_egress_set_target(egress, session->rtp_socket_fd, session->remote_ip, session->remote_port) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] gb_buffer_append reserve failed len=%zu\n", len);
+        GB28181_LOGE("[GB28181][ERROR] bind_target_egress invalid remote ip: %s\n", session->remote_ip);
         return -1;
     }
-    memcpy(buffer->data + buffer->size, data, len);
-    buffer->size += len;
-    return 0;
-}
-
-/* 清空缓存长度（保留容量）。 */
-static void gb_buffer_reset(Gb28181Buffer *buffer)
-{
-    if (buffer)
-        buffer->size = 0;
-}
-
-/* 判断当前位置是否是 H264 起始码并返回长度（3/4 字节）。 */
-static int h264_start_code_len(const uint8_t *data, size_t len)
-{
-    if (len >= 4 && data[0] == 0 && data[1] == 0 && data[2] == 0 && data[3] == 1)
-        return 4;
-    if (len >= 3 && data[0] == 0 && data[1] == 0 && data[2] == 1)
-        return 3;
     return 0;
 }
 
-/* 解析 Annex-B 一帧，输出 NALU 列表。 */
-static int parse_annexb_nalus(const uint8_t *annexb_data, size_t annexb_len, Gb28181NaluUnit *nalus, size_t max_nalus, size_t *nalu_count)
+/*
+ * 发送 PS over RTP（扇出）：
+ * - PS 已封装好，这里按固定 MTU 切片一次，每片同时排进所有目标会话；
+ * - 最后一片 marker=1，每个会话各自 sequence++；
+ * - 整帧切完后各会话批量发出；开启平滑时各会话按各自令牌桶节奏在同一个窗口内交错放行；
+ * - TCP 会话发送缓冲拥塞时该会话整帧丢弃（dropped=1），不影响其它会话；
+ * - 有 UDP 会话开启 NACK/FEC 时，负载顺带写入通道重传缓冲、异或进通道 FEC 生成器，FEC 包随本帧同批发出。
+ * 返回 0 表示至少处理完一个目标（单个目标的结果看 dropped/failed），-1 表示参数错误。
+ */
+static int send_ps_over_rtp(Gb28181Channel *channel, Gb28181RtpTarget *targets, int target_count, int is_key_frame, uint32_t rtp_timestamp)
 {
-    size_t pos = 0;
-    size_t count = 0;
-    if (!annexb_data || !nalus || !nalu_count)
+    Gb28181PsMuxer *muxer = channel ? &channel->ps_muxer : NULL;
+    Gb28181RtpSendCtx send_ctx;
+    int pending = 0;
+    int i;
+    if (!targets || target_count <= 0 || !muxer || muxer->frame_len == 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] parse_annexb_nalus invalid args len=%zu\n", annexb_len);
+        GB28181_LOGE("[GB28181][ERROR] send_ps_over_rtp invalid args targets=%d ps_len=%zu\n",
+                     target_count, muxer ? muxer->frame_len : 0);
         return -1;
     }
-    *nalu_count = 0;
-    while (pos + 3 < annexb_len)
+    for (i = 0; i < target_count; ++i)
     {
-        int code_len = h264_start_code_len(annexb_data + pos, annexb_len - pos);
-        size_t payload_start = 0;
-        size_t next = 0;
-        if (code_len == 0)
+        Gb28181RtpTarget *target = &targets[i];
+        if (bind_target_egress(target) != 0)
         {
-            pos++;
+            target->failed = 1;
             continue;
         }
-        payload_start = pos + (size_t)code_len;
-        next = payload_start;
-        while (next + 3 < annexb_len)
+        /* TCP 发送缓冲拥塞时整帧丢弃，不占用 RTP 序号，由调用方等下一个关键帧恢复。 */
+        if (media_rtp_egress_begin_frame(target->egress, muxer->frame_len) != 0)
         {
-            if (h264_start_code_len(annexb_data + next, annexb_len - next) > 0)
-                break;
-            next++;
+            MediaRtpEgress *egress = target->egress;
+            target->dropped = 1;
+            if (egress->dropped_frames == 1 || (egress->dropped_frames % GB28181_EGRESS_LOG_INTERVAL_FRAMES) == 0)
+            {
+                GB28181_LOGW("[GB28181][RTP] tcp send buffer congested, drop frame slot=%d ps_len=%zu dropped_frames=%llu\n",
+                             target->session.slot, muxer->frame_len, (unsigned long long)egress->dropped_frames);
+            }
+            continue;
+        }
+        pending++;
+    }
+    if (pending > 0)
+    {
+        memset(&send_ctx, 0, sizeof(send_ctx));
+        send_ctx.targets = targets;
+        send_ctx.target_count = target_count;
+        send_ctx.rtp_timestamp = rtp_timestamp;
+        send_ctx.ps_len = muxer->frame_len;
+        for (i = 0; i < target_count; ++i)
+        {
+            Gb28181RtpTarget *target = &targets[i];
+            target->first_seq = target->session.rtp_sequence;
+            if (target->history)
+                send_ctx.nack_arena = &channel->nack_arena;
+            if (target->fec && !target->dropped && !target->failed)
+                send_ctx.fec = &channel->fec;
         }
-        if (next + 3 >= annexb_len)
-            next = annexb_len;
-        if (payload_start < next && count < max_nalus)
+        if (send_ctx.fec)
         {
-            nalus[count].offset = payload_start;
-            nalus[count].length = next - payload_start;
-            nalus[count].type = annexb_data[payload_start] & 0x1F;
-            count++;
+            int expected = (int)((muxer->frame_len + GB28181_RTP_MAX_PAYLOAD - 1) / GB28181_RTP_MAX_PAYLOAD);
+            media_rtp_fec_begin_frame(send_ctx.fec, expected, is_key_frame);
         }
-        pos = next;
+        /*
+         * GB28181 这里走最常见的 PS over RTP。
+         * 一帧 PS 会被拆成多个 RTP 包，最后一个包带 marker=1。
+         */
+        gb28181_ps_muxer_packetize(muxer, GB28181_RTP_MAX_PAYLOAD, queue_rtp_packet, &send_ctx);
+        if (send_ctx.fec)
+            media_rtp_fec_end_frame(send_ctx.fec);
+    }
+    for (i = 0; pending > 0 && i < target_count; ++i)
+    {
+        Gb28181RtpTarget *target = &targets[i];
+        if (target->failed || target->dropped || !target->fec)
+            continue;
+        if (media_rtp_fec_queue(&channel->fec, target->fec, target->egress, target->first_seq, rtp_timestamp) != 0)
+            target->failed = 1;
     }
-    *nalu_count = count;
-    if (count <= 0)
+    if (pending > 0)
+        flush_rtp_targets(targets, target_count);
+    for (i = 0; i < target_count; ++i)
     {
-        fprintf(stderr, "[GB28181][ERROR] parse_annexb_nalus no valid NALU found len=%zu\n", annexb_len);
-        return -1;
+        Gb28181RtpTarget *target = &targets[i];
+        if (target->failed)
+            continue;
+        if (media_rtp_egress_end_frame(target->egress) != 0)
+        {
+            target->failed = 1;
+            continue;
+        }
+        if (!target->dropped)
+            target->session.last_rtp_timestamp = rtp_timestamp;
     }
     return 0;
 }
 
-/* 写入 PS pack header。 */
-static int ps_write_pack_header(Gb28181Buffer *buffer, uint64_t scr_90k)
+/*
+ * 周期打印单个会话的 RTP 发送开销：每帧系统调用次数与发送耗费的 CPU 时间，
+ * 开启平滑时附带平滑时延与排队深度，开启 NACK/FEC 时附带重传统计和 FEC 开销，
+ * 开启 RTCP 时附带平台接收报告里的丢包率、抖动和 RTT。
+ * 通道累计的 NALU 类型计数也在这里输出，代替逐帧的 NALU 列表。
+ */
+static void log_rtp_egress_if_due(const Gb28181Channel *channel, const Gb28181RtpTarget *target)
 {
-    uint8_t pack[14];
-    uint64_t scr = scr_90k & 0x1FFFFFFFFULL;
-    pack[0] = 0x00;
-    pack[1] = 0x00;
-    pack[2] = 0x01;
-    pack[3] = 0xBA;
-    pack[4] = (uint8_t)(0x44 | ((scr >> 27) & 0x38) | ((scr >> 28) & 0x03));
-    pack[5] = (uint8_t)(scr >> 20);
-    pack[6] = (uint8_t)(((scr >> 12) & 0xF8) | 0x04 | ((scr >> 13) & 0x03));
-    pack[7] = (uint8_t)(scr >> 5);
-    pack[8] = (uint8_t)(((scr << 3) & 0xF8) | 0x04);
-    pack[9] = 0x01;
-    pack[10] = 0x89;
-    pack[11] = 0xC3;
-    pack[12] = 0xF8;
-    pack[13] = 0x00;
-    return gb_buffer_append(buffer, pack, sizeof(pack));
+    const MediaRtpEgress *egress = target->egress;
+    const MediaRtpHistory *history = target->history;
+    const Gb28181MediaSession *session = &target->session;
+    const Gb28181PsMuxer *muxer = &channel->ps_muxer;
+    if (egress->frames == 0 || (egress->frames % GB28181_EGRESS_LOG_INTERVAL_FRAMES) != 0)
+        return;
+    if (!GB28181_LOG_ENABLED(GB28181_LOG_LEVEL_INFO))
+        return;
+    GB28181_LOGI("[GB28181][H264] summary channel=%d slot=%d cid=%d frames=%llu key_frames=%llu sps=%llu pps=%llu idr=%llu slice=%llu sei=%llu aud=%llu\n",
+                 session->channel,
+                 session->slot,
+                 session->cid,
+                 (unsigned long long)muxer->frames,
+                 (unsigned long long)muxer->key_frames,
+                 (unsigned long long)muxer->nalu_types[7],
+                 (unsigned long long)muxer->nalu_types[8],
+                 (unsigned long long)muxer->nalu_types[5],
+                 (unsigned long long)muxer->nalu_types[1],
+                 (unsigned long long)muxer->nalu_types[6],
+                 (unsigned long long)muxer->nalu_types[9]);
+    if (egress->pacing)
+    {
+        const MediaRtpPacer *pacer = &egress->pacer;
+        GB28181_LOGI("[GB28181][RTP] pacing channel=%d slot=%d cid=%d paced=%llu delayed=%llu avg_delay_us=%.1f max_delay_us=%llu avg_queue=%.1f max_queue=%d\n",
+                     session->channel,
+                     session->slot,
+                     session->cid,
+                     (unsigned long long)pacer->paced_packets,
+                     (unsigned long long)pacer->delayed_packets,
+                     pacer->delayed_packets ? (double)pacer->delay_us_sum / (double)pacer->delayed_packets : 0.0,
+                     (unsigned long long)pacer->delay_us_max,
+                     pacer->occupancy_samples ? (double)pacer->occupancy_sum / (double)pacer->occupancy_samples : 0.0,
+                     pacer->occupancy_max);
+    }
+    if (history)
+    {
+        GB28181_LOGI("[GB28181][RTP] nack channel=%d slot=%d cid=%d nack_packets=%llu requested=%llu retransmitted=%llu too_late=%llu\n",
+                     session->channel,
+                     session->slot,
+                     session->cid,
+                     (unsigned long long)history->nack_packets,
+                     (unsigned long long)history->nack_requested,
+                     (unsigned long long)history->retransmitted,
+                     (unsigned long long)history->too_late);
+    }
+    if (target->rtcp)
+    {
+        const MediaRtcpPeer *rtcp = target->rtcp;
+        GB28181_LOGI("[GB28181][RTP] rtcp channel=%d slot=%d cid=%d sr_sent=%llu reports=%llu fraction_lost=%.1f%% cumulative_lost=%d jitter_ms=%.1f rtt_ms=%d\n",
+                     session->channel,
+                     session->slot,
+                     session->cid,
+                     (unsigned long long)rtcp->sr_sent,
+                     (unsigned long long)rtcp->reports,
+                     rtcp->loss_percent,
+                     (int)rtcp->cumulative_lost,
+                     rtcp->jitter_ms,
+                     rtcp->rtt_ms);
+    }
+    if (target->fec)
+    {
+        const MediaRtpFecEncoder *fec = &channel->fec;
+        GB28181_LOGI("[GB28181][RTP] fec channel=%d slot=%d cid=%d fec_packets=%llu fec_bytes=%llu overhead=%.1f%% encode_us_per_frame=%.1f unprotected=%llu\n",
+                     session->channel,
+                     session->slot,
+                     session->cid,
+                     (unsigned long long)target->fec->packets,
+                     (unsigned long long)target->fec->bytes,
+                     (egress->bytes > target->fec->bytes) ? (double)target->fec->bytes * 100.0 / (double)(egress->bytes - target->fec->bytes) : 0.0,
+                     fec->frames ? (double)fec->encode_ns / 1000.0 / (double)fec->frames : 0.0,
+                     (unsigned long long)fec->unprotected_packets);
+    }
+    GB28181_LOGI("[GB28181][RTP] egress channel=%d slot=%d cid=%d ssrc=%u remote=%s:%d transport=%s frames=%llu packets=%llu syscalls_per_frame=%.2f send_cpu_us_per_frame=%.1f gso=%d gso_sends=%llu dropped_frames=%llu tcp_partial_writes=%llu errors=%llu\n",
+                 session->channel,
+                 session->slot,
+                 session->cid,
+                 session->rtp_ssrc,
+                 session->remote_ip,
+                 session->remote_port,
+                 (egress->transport == MEDIA_RTP_TRANSPORT_TCP) ? "tcp" : "udp",
+                 (unsigned long long)egress->frames,
+                 (unsigned long long)egress->packets,
+                 (double)egress->syscalls / (double)egress->frames,
+                 (double)egress->send_cpu_us / (double)egress->frames,
+                 (egress->gso_supported == 1) ? 1 : 0,
+                 (unsigned long long)egress->gso_sends,
+                 (unsigned long long)egress->dropped_frames,
+                 (unsigned long long)egress->tcp_partial_writes,
+                 (unsigned long long)egress->errors);
 }
 
-/* 写入 PS system header（关键帧前附带）。 */
-static int ps_write_system_header(Gb28181Buffer *buffer)
+/*
+ * 重置通道某个槽位的发送器：目标、续写缓冲和统计清零，再按通道码率/帧率配置 RTP 发送平滑，
+ * I 帧分片摊到帧间隔的一部分内发出。只在发流线程内（或通道挂入前）调用。
+ */
+static void reset_session_egress(const Gb28181DeviceCtx *ctx, Gb28181Channel *channel, int slot)
 {
-    const uint8_t system_header[] = {0x00, 0x00, 0x01, 0xBB, 0x00, 0x0C, 0x80, 0x04, 0x04, 0xE1, 0x7F, 0xE0, 0xE0, 0xE8, 0xC0, 0x20, 0xBD, 0xE0};
-    return gb_buffer_append(buffer, system_header, sizeof(system_header));
+    MediaRtpPacerConfig pacing;
+    MediaRtpEgress *egress = &channel->rtp_egress[slot];
+    media_rtp_egress_deinit(egress);
+    media_rtp_egress_init(egress, ctx->config.rtp_gso);
+    memset(&pacing, 0, sizeof(pacing));
+    pacing.enabled = ctx->config.rtp_pacing;
+    pacing.rate_percent = ctx->config.rtp_pacing_rate_percent;
+    pacing.burst_bytes = ctx->config.rtp_pacing_burst_bytes;
+    pacing.spread_percent = ctx->config.rtp_pacing_spread_percent;
+    media_rtp_pacer_fill_default(&pacing);
+    media_rtp_egress_set_pacing(egress, &pacing, channel->bitrate, channel->fps);
 }
 
-/* 写入 PS program stream map（关键帧前附带）。 */
-static int ps_write_program_stream_map(Gb28181Buffer *buffer)
+/*
+ * 将一帧 Annex-B H264 封装为 PS 分段视图。
+ * 关键帧时会附带 system header + PSM，提升下游识别成功率。
+ */
+static int build_ps_frame(const uint8_t *annexb_data, size_t annexb_len, int is_key_frame, uint64_t pts_us, Gb28181PsMuxer *muxer)
 {
-    const uint8_t psm[] = {0x00, 0x00, 0x01, 0xBC, 0x00, 0x12, 0xE0, 0xFF, 0x00, 0x00, 0x00, 0x08, 0x1B, 0xE0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x45, 0xBD, 0xDC, 0xF4};
-    return gb_buffer_append(buffer, psm, sizeof(psm));
+    uint64_t pts_90k = pts_us * 90ULL / 1000ULL;
+    if (gb28181_ps_muxer_build(muxer, annexb_data, annexb_len, is_key_frame, pts_90k) != 0)
+    {
+        GB28181_LOGE("[GB28181][ERROR] build_ps_frame failed len=%zu\n", annexb_len);
+        return -1;
+    }
+    /* 逐帧 NALU 列表只在 DEBUG 下拼接，默认级别只留 muxer 里的类型计数，由周期统计输出。 */
+    if (GB28181_LOG_ENABLED(GB28181_LOG_LEVEL_DEBUG))
+        log_h264_nalu_summary(muxer->nalus, muxer->nalu_count, is_key_frame, pts_us, pts_90k);
+    return 0;
 }
 
-/* 写入 PTS 字段（5 字节格式）。 */
-static void ps_write_pts_field(uint8_t *dst, uint8_t prefix, uint64_t pts)
+/*
+ * 绑定 RTP 端口 + 1 的非阻塞 RTCP socket，接收平台的 NACK/RR 反馈，SR 也从这里发出。
+ * 绑定失败不影响发流：平台若走 rtcp-mux，反馈仍会从 RTP socket 读到，SR 改从 RTP socket 发。
+ */
+static void setup_rtcp_socket(Gb28181MediaSession *session, const struct sockaddr_in *rtp_addr)
 {
-    uint64_t value = pts & 0x1FFFFFFFFULL;
-    dst[0] = (uint8_t)((prefix << 4) | (((value >> 30) & 0x07) << 1) | 0x01);
-    dst[1] = (uint8_t)(value >> 22);
-    dst[2] = (uint8_t)((((value >> 15) & 0x7F) << 1) | 0x01);
-    dst[3] = (uint8_t)(value >> 7);
-    dst[4] = (uint8_t)(((value & 0x7F) << 1) | 0x01);
+    struct sockaddr_in rtcp_addr = *rtp_addr;
+    int reuse_addr = 1;
+    int socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socket_fd < 0)
+        return;
+    setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &reuse_addr, sizeof(reuse_addr));
+    rtcp_addr.sin_port = htons((uint16_t)(session->local_media_port + 1));
+    if (bind(socket_fd, (const struct sockaddr *)&rtcp_addr, sizeof(rtcp_addr)) != 0)
+    {
+        GB28181_LOGW("[GB28181][WARN] setup_rtcp_socket bind failed port=%d errno=%d(%s), RTCP feedback only via rtcp-mux\n",
+                     session->local_media_port + 1, errno, strerror(errno));
+        close(socket_fd);
+        return;
+    }
+    fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL, 0) | O_NONBLOCK);
+    session->rtcp_socket_fd = socket_fd;
 }
 
-/* 写入视频 PES 包头与 payload。 */
-static int ps_write_video_pes(Gb28181Buffer *buffer, const uint8_t *payload, size_t payload_len, uint64_t pts_90k)
+/* 创建并绑定本地 RTP UDP socket。 */
+static int setup_rtp_socket(Gb28181MediaSession *session, const Gb28181DeviceConfig *config)
 {
-    uint8_t header[14];
-    static const uint8_t annexb_start_code[4] = {0x00, 0x00, 0x00, 0x01};
-    size_t pes_packet_length = payload_len + sizeof(annexb_start_code) + 8;
-    if (!buffer || !payload || payload_len == 0)
+    struct sockaddr_in local_addr;
+    int socket_fd = -1;
+    int reuse_addr = 1;
+    int sndbuf = GB28181_RTP_TCP_SNDBUF;
+    if (!session || !config)
     {
-        fprintf(stderr, "[GB28181][ERROR] ps_write_video_pes invalid args payload_len=%zu\n", payload_len);
+        GB28181_LOGE("[GB28181][ERROR] setup_rtp_socket invalid args\n");
         return -1;
     }
-    if (pes_packet_length > 0xFFFF)
-        pes_packet_length = 0;
-    memset(header, 0, sizeof(header));
-    header[0] = 0x00;
-    header[1] = 0x00;
-    header[2] = 0x01;
-    header[3] = GB28181_PS_STREAM_ID_VIDEO;
-    header[4] = (uint8_t)((pes_packet_length >> 8) & 0xFF);
-    header[5] = (uint8_t)(pes_packet_length & 0xFF);
-    header[6] = 0x80;
-    header[7] = 0x80;
-    header[8] = 0x05;
-    ps_write_pts_field(header + 9, 0x02, pts_90k);
-    if (gb_buffer_append(buffer, header, sizeof(header)) != 0)
-    {
-        fprintf(stderr, "[GB28181][ERROR] ps_write_video_pes append header failed\n");
+    if (session->rtp_socket_fd >= 0 || session->rtp_listen_fd >= 0)
+        return 0;
+    socket_fd = socket(AF_INET, session->rtp_tcp ? SOCK_STREAM : SOCK_DGRAM, 0);
+    if (socket_fd < 0)
+    {
+        GB28181_LOGE("[GB28181][ERROR] setup_rtp_socket socket failed errno=%d(%s)\n", errno, strerror(errno));
         return -1;
     }
-    /*
-     * 为提升下游 PS 解复用兼容性，这里输出 H264 字节流格式：
-     * 每个 NAL 前补 00 00 00 01 起始码，再写 NAL payload。
-     */
-    if (gb_buffer_append(buffer, annexb_start_code, sizeof(annexb_start_code)) != 0)
+    setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &reuse_addr, sizeof(reuse_addr));
+    memset(&local_addr, 0, sizeof(local_addr));
+    local_addr.sin_family = AF_INET;
+    local_addr.sin_port = htons((uint16_t)session->local_media_port);
+    if (strcmp(config->bind_ip, "0.0.0.0") == 0)
+        local_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    else if (inet_aton(config->bind_ip, &local_addr.sin_addr) == 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] ps_write_video_pes append startcode failed\n");
+        GB28181_LOGE("[GB28181][ERROR] setup_rtp_socket invalid bind ip: %s\n", config->bind_ip);
+        close(socket_fd);
         return -1;
     }
-    if (gb_buffer_append(buffer, payload, payload_len) != 0)
+    if (bind(socket_fd, (const struct sockaddr *)&local_addr, sizeof(local_addr)) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] ps_write_video_pes append payload failed len=%zu\n", payload_len);
+        GB28181_LOGE("[GB28181][ERROR] setup_rtp_socket bind failed %s:%d errno=%d(%s)\n",
+                     config->bind_ip,
+                     session->local_media_port,
+                     errno,
+                     strerror(errno));
+        close(socket_fd);
         return -1;
     }
-    return 0;
-}
-
-/*
- * 将一帧 Annex-B H264 封装为 PS。
- * 关键帧时会附带 system header + PSM，提升下游识别成功率。
- */
-static int build_ps_frame(const uint8_t *annexb_data, size_t annexb_len, int is_key_frame, uint64_t pts_us, Gb28181Buffer *ps_buffer)
-{
-    Gb28181NaluUnit nalus[64];
-    size_t nalu_count = 0;
-    size_t i = 0;
-    uint64_t pts_90k = pts_us * 90ULL / 1000ULL;
-    if (!annexb_data || annexb_len == 0 || !ps_buffer)
+    if (!session->rtp_tcp)
     {
-        fprintf(stderr, "[GB28181][ERROR] build_ps_frame invalid args len=%zu\n", annexb_len);
-        return -1;
+        session->rtp_socket_fd = socket_fd;
+        if (config->rtp_nack || config->rtp_rtcp)
+            setup_rtcp_socket(session, &local_addr);
+        return 0;
     }
-    gb_buffer_reset(ps_buffer);
     /*
-     * 把一帧 Annex-B 拆成 NALU 后再封装成 PS。
-     * 关键帧前附带 system header + PSM，便于 WVP/下游更快识别流类型。
-     * 每个 NALU 独立作为一个 PES，逻辑简单，也能规避大帧导致的 PES 长度上限问题。
+     * TCP 模式：固定发送缓冲，拥塞时由 egress 按帧丢弃；socket 全程非阻塞，
+     * 建连在发流线程里推进（poll_rtp_tcp_connection），不阻塞 SIP 线程。
+     * 被动模式监听 socket 的缓冲设置会被 accept 出来的连接继承。
      */
-    if (parse_annexb_nalus(annexb_data, annexb_len, nalus, 64, &nalu_count) != 0)
+    setsockopt(socket_fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL, 0) | O_NONBLOCK);
+    if (!session->tcp_active)
     {
-        fprintf(stderr, "[GB28181][ERROR] build_ps_frame parse_annexb_nalus failed len=%zu\n", annexb_len);
-        return -1;
+        if (listen(socket_fd, 1) != 0)
+        {
+            GB28181_LOGE("[GB28181][ERROR] setup_rtp_socket listen failed %s:%d errno=%d(%s)\n",
+                         config->bind_ip, session->local_media_port, errno, strerror(errno));
+            close(socket_fd);
+            return -1;
+        }
+        session->rtp_listen_fd = socket_fd;
     }
-    log_h264_nalu_summary(nalus, nalu_count, is_key_frame, pts_us, pts_90k);
-    if (ps_write_pack_header(ps_buffer, pts_90k) != 0)
+    else
     {
-        fprintf(stderr, "[GB28181][ERROR] build_ps_frame write pack header failed\n");
-        return -1;
+        session->rtp_socket_fd = socket_fd;
+    }
+    session->tcp_state = GB28181_TCP_IDLE;
+    return 0;
+}
+
+/* 关闭 RTP socket（含 TCP 监听 socket 与 RTCP socket）。 */
+static void close_rtp_socket(Gb28181MediaSession *session)
+{
+    if (!session)
+        return;
+    if (session->rtp_socket_fd >= 0)
+        close(session->rtp_socket_fd);
+    if (session->rtp_listen_fd >= 0)
+        close(session->rtp_listen_fd);
+    if (session->rtcp_socket_fd >= 0)
+        close(session->rtcp_socket_fd);
+    session->rtp_socket_fd = -1;
+    session->rtp_listen_fd = -1;
+    session->rtcp_socket_fd = -1;
+    session->tcp_state = GB28181_TCP_IDLE;
+}
+
+/*
+ * 推进 TCP 媒体连接（调用方持有 session_lock，只做非阻塞操作）：
+ * - 被动模式：accept 平台发起的连接，随后关闭监听 socket；
+ * - 主动模式：发起非阻塞 connect，之后用 poll 检查是否完成，失败按固定间隔重试。
+ * 新连接建立时重置 egress 的 TCP 目标，保证从干净的分帧边界开始写。
+ */
+static void poll_rtp_tcp_connection(Gb28181MediaSession *session, MediaRtpEgress *egress)
+{
+    if (!session->rtp_tcp || session->tcp_state == GB28181_TCP_CONNECTED)
+        return;
+    if (!session->tcp_active)
+    {
+        int conn_fd;
+        if (session->rtp_listen_fd < 0)
+            return;
+        conn_fd = accept(session->rtp_listen_fd, NULL, NULL);
+        if (conn_fd < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                GB28181_LOGE("[GB28181][ERROR] rtp tcp accept failed errno=%d(%s)\n", errno, strerror(errno));
+            return;
+        }
+        fcntl(conn_fd, F_SETFL, fcntl(conn_fd, F_GETFL, 0) | O_NONBLOCK);
+        close(session->rtp_listen_fd);
+        session->rtp_listen_fd = -1;
+        session->rtp_socket_fd = conn_fd;
     }
-    if (is_key_frame)
+    else
     {
-        if (ps_write_system_header(ps_buffer) != 0)
+        if (session->rtp_socket_fd < 0)
+            return;
+        if (session->tcp_state == GB28181_TCP_IDLE)
         {
-            fprintf(stderr, "[GB28181][ERROR] build_ps_frame write system header failed\n");
-            return -1;
+            struct sockaddr_in remote_addr;
+            long long now_ms = get_now_ms();
+            if (now_ms < session->tcp_next_connect_ms)
+                return;
+            session->tcp_next_connect_ms = now_ms + GB28181_RTP_TCP_CONNECT_RETRY_MS;
+            memset(&remote_addr, 0, sizeof(remote_addr));
+            remote_addr.sin_family = AF_INET;
+            remote_addr.sin_port = htons((uint16_t)session->remote_port);
+            if (inet_aton(session->remote_ip, &remote_addr.sin_addr) == 0)
+            {
+                GB28181_LOGE("[GB28181][ERROR] rtp tcp connect invalid remote ip: %s\n", session->remote_ip);
+                return;
+            }
+            if (connect(session->rtp_socket_fd, (const struct sockaddr *)&remote_addr, sizeof(remote_addr)) != 0)
+            {
+                if (errno != EINPROGRESS)
+                {
+                    GB28181_LOGE("[GB28181][ERROR] rtp tcp connect %s:%d failed errno=%d(%s)\n",
+                                 session->remote_ip, session->remote_port, errno, strerror(errno));
+                    return;
+                }
+                session->tcp_state = GB28181_TCP_CONNECTING;
+                return;
+            }
         }
-        if (ps_write_program_stream_map(ps_buffer) != 0)
+        else
         {
-            fprintf(stderr, "[GB28181][ERROR] build_ps_frame write program stream map failed\n");
-            return -1;
+            struct pollfd pfd;
+            int so_error = 0;
+            socklen_t len = sizeof(so_error);
+            pfd.fd = session->rtp_socket_fd;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            if (poll(&pfd, 1, 0) <= 0)
+                return;
+            getsockopt(session->rtp_socket_fd, SOL_SOCKET, SO_ERROR, &so_error, &len);
+            if (so_error != 0)
+            {
+                GB28181_LOGE("[GB28181][ERROR] rtp tcp connect %s:%d failed errno=%d(%s), retry in %dms\n",
+                             session->remote_ip, session->remote_port, so_error, strerror(so_error), GB28181_RTP_TCP_CONNECT_RETRY_MS);
+                session->tcp_state = GB28181_TCP_IDLE;
+                return;
+            }
         }
     }
-    for (i = 0; i < nalu_count; ++i)
+    session->tcp_state = GB28181_TCP_CONNECTED;
+    media_rtp_egress_set_tcp_target(egress, session->rtp_socket_fd);
+    GB28181_LOGI("[GB28181][RTP] tcp media connected channel=%d slot=%d cid=%d mode=%s remote=%s:%d fd=%d\n",
+                 session->channel, session->slot, session->cid, session->tcp_active ? "active" : "passive",
+                 session->remote_ip, session->remote_port, session->rtp_socket_fd);
+}
+
+/* 会话的媒体传输是否可以发流：UDP 有 socket 即可，TCP 需要连接已建立。 */
+static int media_transport_ready(const Gb28181MediaSession *session)
+{
+    if (session->rtp_socket_fd < 0)
+        return 0;
+    return session->rtp_tcp ? (session->tcp_state == GB28181_TCP_CONNECTED) : 1;
+}
+
+/* 按 cid 在所有通道里查找会话，找不到返回 NULL（调用方持有 session_lock）。 */
+static Gb28181MediaSession *find_session(Gb28181DeviceCtx *ctx, int cid)
+{
+    int c;
+    int i;
+    for (c = 0; c < GB28181_MAX_CHANNELS; ++c)
     {
-        const uint8_t *payload = annexb_data + nalus[i].offset;
-        size_t payload_len = nalus[i].length;
-        if (nalus[i].type == 9)
+        Gb28181Channel *channel = &ctx->channels[c];
+        if (!channel->in_use)
             continue;
-        if (ps_write_video_pes(ps_buffer, payload, payload_len, pts_90k) != 0)
+        for (i = 0; i < GB28181_MAX_MEDIA_SESSIONS; ++i)
         {
-            fprintf(stderr, "[GB28181][ERROR] build_ps_frame write video PES failed nalu_type=%u len=%zu\n",
-                    (unsigned int)nalus[i].type,
-                    payload_len);
-            return -1;
+            if (channel->media_sessions[i].active && channel->media_sessions[i].cid == cid)
+                return &channel->media_sessions[i];
         }
     }
-    if (ps_buffer->size <= 0)
-    {
-        fprintf(stderr, "[GB28181][ERROR] build_ps_frame result is empty\n");
+    return NULL;
+}
+
+/* 按通道 ID 查找通道下标，找不到返回 -1（调用方持有 session_lock）。 */
+static int find_channel(const Gb28181DeviceCtx *ctx, const char *channel_id)
+{
+    int c;
+    if (!channel_id || channel_id[0] == '\0')
         return -1;
+    for (c = 0; c < GB28181_MAX_CHANNELS; ++c)
+    {
+        if (ctx->channels[c].in_use && strcmp(ctx->channels[c].channel_id, channel_id) == 0)
+            return c;
     }
-    return 0;
+    return -1;
 }
 
-/*
- * 发送 PS over RTP：
- * - 按固定 MTU 大小分片；
- * - 最后一片 marker=1；
- * - 每片发送后 sequence++。
- */
-static int send_ps_over_rtp(Gb28181MediaSession *session, const uint8_t *ps_data, size_t ps_len, uint32_t rtp_timestamp)
+/* 校验通道下标并返回已挂入的通道，否则返回 NULL。 */
+static Gb28181Channel *get_channel(Gb28181DeviceCtx *ctx, int channel)
 {
-    struct sockaddr_in remote_addr;
-    size_t offset = 0;
-    if (!session || session->rtp_socket_fd < 0 || !ps_data || ps_len == 0)
+    if (!ctx || channel < 0 || channel >= GB28181_MAX_CHANNELS || !ctx->channels[channel].in_use)
+        return NULL;
+    return &ctx->channels[channel];
+}
+
+/* 查找通道空闲槽位，会话表满时返回 -1（调用方持有 session_lock）。 */
+static int find_free_session_slot(const Gb28181Channel *channel)
+{
+    int i;
+    for (i = 0; i < GB28181_MAX_MEDIA_SESSIONS; ++i)
     {
-        fprintf(stderr, "[GB28181][ERROR] send_ps_over_rtp invalid args fd=%d ps_len=%zu\n",
-                session ? session->rtp_socket_fd : -1, ps_len);
-        return -1;
+        if (!channel->media_sessions[i].active)
+            return i;
     }
-    memset(&remote_addr, 0, sizeof(remote_addr));
-    remote_addr.sin_family = AF_INET;
-    remote_addr.sin_port = htons((uint16_t)session->remote_port);
-    if (inet_aton(session->remote_ip, &remote_addr.sin_addr) == 0)
+    return -1;
+}
+
+/* 通道上是否存在已收到 ACK 的会话（调用方持有 session_lock）。 */
+static int has_established_session(const Gb28181Channel *channel)
+{
+    int i;
+    for (i = 0; i < GB28181_MAX_MEDIA_SESSIONS; ++i)
     {
-        fprintf(stderr, "[GB28181][ERROR] send_ps_over_rtp invalid remote ip: %s\n", session->remote_ip);
-        return -1;
-    }
-    /*
-     * GB28181 这里走最常见的 PS over RTP。
-     * 一帧 PS 会被拆成多个 RTP 包，最后一个包带 marker=1。
-     */
-    while (offset < ps_len)
-    {
-        uint8_t packet[12 + GB28181_RTP_MAX_PAYLOAD];
-        size_t chunk = ps_len - offset;
-        unsigned short seq = session->rtp_sequence;
-        int marker = 0;
-        ssize_t sent = 0;
-        if (chunk > GB28181_RTP_MAX_PAYLOAD)
-            chunk = GB28181_RTP_MAX_PAYLOAD;
-        marker = ((offset + chunk) >= ps_len) ? 1 : 0;
-        packet[0] = 0x80;
-        packet[1] = (uint8_t)((marker ? 0x80 : 0x00) | GB28181_RTP_PAYLOAD_TYPE);
-        packet[2] = (uint8_t)((session->rtp_sequence >> 8) & 0xFF);
-        packet[3] = (uint8_t)(session->rtp_sequence & 0xFF);
-        packet[4] = (uint8_t)((rtp_timestamp >> 24) & 0xFF);
-        packet[5] = (uint8_t)((rtp_timestamp >> 16) & 0xFF);
-        packet[6] = (uint8_t)((rtp_timestamp >> 8) & 0xFF);
-        packet[7] = (uint8_t)(rtp_timestamp & 0xFF);
-        packet[8] = (uint8_t)((session->rtp_ssrc >> 24) & 0xFF);
-        packet[9] = (uint8_t)((session->rtp_ssrc >> 16) & 0xFF);
-        packet[10] = (uint8_t)((session->rtp_ssrc >> 8) & 0xFF);
-        packet[11] = (uint8_t)(session->rtp_ssrc & 0xFF);
-        memcpy(packet + 12, ps_data + offset, chunk);
-        if (seq == 0)
-        {
-            printf("[GB28181][RTP] first_packet remote=%s:%d ps_len=%zu chunk=%zu seq=%u ts=%u ssrc=%u marker=%d\n",
-                   session->remote_ip, session->remote_port, ps_len, chunk, seq, rtp_timestamp, session->rtp_ssrc, marker);
-        }
-        sent = sendto(session->rtp_socket_fd, packet, (int)(12 + chunk), 0, (const struct sockaddr *)&remote_addr, sizeof(remote_addr));
-        if (sent < 0)
-        {
-            fprintf(stderr, "[GB28181][RTP] sendto failed remote=%s:%d seq=%u ts=%u errno=%d(%s)\n",
-                    session->remote_ip, session->remote_port, seq, rtp_timestamp, errno, strerror(errno));
-            return -1;
-        }
-        session->rtp_sequence++;
-        offset += chunk;
+        if (channel->media_sessions[i].active && channel->media_sessions[i].established)
+            return 1;
     }
-    session->last_rtp_timestamp = rtp_timestamp;
     return 0;
 }
 
-/* 创建并绑定本地 RTP UDP socket。 */
-static int setup_rtp_socket(Gb28181MediaSession *session, const Gb28181DeviceConfig *config)
+/* 读到的 RTCP 报文在 NACK 处理之后交到这里，按 RR 更新接收端统计。 */
+static void on_rtcp_packet(void *user, const uint8_t *buf, size_t len)
 {
-    struct sockaddr_in local_addr;
-    int socket_fd = -1;
-    int reuse_addr = 1;
-    if (!session || !config)
+    Gb28181RtpTarget *target = (Gb28181RtpTarget *)user;
+    if (target->rtcp &&
+        media_rtcp_peer_on_packet(target->rtcp, buf, len, target->session.rtp_ssrc,
+                                  MEDIA_RTCP_VIDEO_CLOCK_RATE, get_now_ms()) &&
+        target->rtcp->reports == 1)
     {
-        fprintf(stderr, "[GB28181][ERROR] setup_rtp_socket invalid args\n");
-        return -1;
+        GB28181_LOGI("[GB28181][RTP] first receiver report channel=%d slot=%d cid=%d fraction_lost=%.1f%% jitter_ms=%.1f rtt_ms=%d\n",
+                     target->session.channel, target->session.slot, target->session.cid,
+                     target->rtcp->loss_percent, target->rtcp->jitter_ms, target->rtcp->rtt_ms);
     }
-    if (session->rtp_socket_fd >= 0)
-        return 0;
-    socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
-    if (socket_fd < 0)
+}
+
+/* 非阻塞读空一个 socket 上的 RTCP 报文：NACK 交给重传历史，RR 更新接收端统计。返回重传的包数。 */
+static int drain_rtcp_socket(Gb28181RtpTarget *target, int fd)
+{
+    int served = media_rtp_history_serve_rtcp(target->history, target->egress, fd, on_rtcp_packet, target);
+    return (served > 0) ? served : 0;
+}
+
+/*
+ * 处理单个 UDP 会话积压的 RTCP 反馈：按 NACK 原样重传历史里的包，按 RR 更新丢包/抖动/RTT。
+ * 独立 RTCP 端口和 RTP 端口（rtcp-mux）都读；在发流线程里、帧与帧之间调用，不另起线程。
+ */
+static void serve_rtcp_feedback(Gb28181RtpTarget *target)
+{
+    const Gb28181MediaSession *session = &target->session;
+    int served = 0;
+    if (!target->history && !target->rtcp)
+        return;
+    if (target->egress->transport != MEDIA_RTP_TRANSPORT_UDP || !target->egress->target_ready)
+        return;
+    if (session->rtcp_socket_fd >= 0)
+        served += drain_rtcp_socket(target, session->rtcp_socket_fd);
+    served += drain_rtcp_socket(target, session->rtp_socket_fd);
+    if (target->history && served > 0 && target->history->retransmitted == (uint64_t)served)
     {
-        fprintf(stderr, "[GB28181][ERROR] setup_rtp_socket socket failed errno=%d(%s)\n", errno, strerror(errno));
-        return -1;
+        GB28181_LOGI("[GB28181][RTP] first nack served channel=%d slot=%d cid=%d retransmitted=%d\n",
+                     session->channel, session->slot, session->cid, served);
     }
-    setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &reuse_addr, sizeof(reuse_addr));
-    memset(&local_addr, 0, sizeof(local_addr));
-    local_addr.sin_family = AF_INET;
-    local_addr.sin_port = htons((uint16_t)config->media_port);
-    if (strcmp(config->bind_ip, "0.0.0.0") == 0)
-        local_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    else if (inet_aton(config->bind_ip, &local_addr.sin_addr) == 0)
+}
+
+/*
+ * SR 到期时给 UDP 会话发一份 SR + SDES(CNAME)，发往平台 RTP 端口 + 1。
+ * RTP 时间戳由本帧时间戳按 pts 推到当前时刻；包数/字节数取 egress 累计值并扣掉独立 SSRC 的 FEC 包。
+ */
+static void send_sender_report(const Gb28181DeviceCtx *ctx, Gb28181RtpTarget *target, uint32_t rtp_timestamp, uint64_t pts_us)
+{
+    const Gb28181MediaSession *session = &target->session;
+    const MediaRtpEgress *egress = target->egress;
+    struct sockaddr_in addr;
+    uint8_t sr[MEDIA_RTCP_SR_MAX];
+    uint64_t packets = egress->packets;
+    uint64_t bytes = egress->bytes;
+    int socket_fd = session->rtcp_socket_fd >= 0 ? session->rtcp_socket_fd : session->rtp_socket_fd;
+    int sr_len;
+    if (!target->rtcp || target->failed || socket_fd < 0)
+        return;
+    if (!media_rtcp_peer_sr_due(target->rtcp, get_now_ms(), ctx->config.rtp_rtcp_interval_ms))
+        return;
+    if (target->fec)
     {
-        fprintf(stderr, "[GB28181][ERROR] setup_rtp_socket invalid bind ip: %s\n", config->bind_ip);
-        close(socket_fd);
-        return -1;
+        packets -= target->fec->packets;
+        bytes -= target->fec->bytes;
     }
-    if (bind(socket_fd, (const struct sockaddr *)&local_addr, sizeof(local_addr)) != 0)
+    /* SR 的字节数只计负载，不含 12 字节 RTP 头。 */
+    bytes = bytes > packets * 12ULL ? bytes - packets * 12ULL : 0;
+    sr_len = media_rtcp_build_sr(sr, sizeof(sr), session->rtp_ssrc, media_rtcp_ntp_now(),
+                                 media_rtcp_rtp_timestamp_at(rtp_timestamp, pts_us, get_monotonic_us(), MEDIA_RTCP_VIDEO_CLOCK_RATE),
+                                 (uint32_t)packets, (uint32_t)bytes, ctx->config.device_id);
+    if (sr_len <= 0)
+        return;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)(session->remote_port + 1));
+    if (inet_aton(session->remote_ip, &addr.sin_addr) == 0)
+        return;
+    if (sendto(socket_fd, sr, (size_t)sr_len, MSG_DONTWAIT, (const struct sockaddr *)&addr, sizeof(addr)) == sr_len)
+        target->rtcp->sr_sent++;
+}
+
+/*
+ * 发流线程在持锁状态下刷新通道会话表：
+ * - 槽位换了会话（cid 变化）时重置该槽位的发送器；
+ * - 上游码率/帧率变化后更新在用发送器的平滑速率；
+ * - 推进 TCP 建连。
+ * 返回传输已就绪、可以发流的会话数。
+ */
+static int refresh_media_targets(const Gb28181DeviceCtx *ctx, Gb28181Channel *channel)
+{
+    int ready = 0;
+    int i;
+    if (channel->rate_changed)
     {
-        fprintf(stderr, "[GB28181][ERROR] setup_rtp_socket bind failed %s:%d errno=%d(%s)\n",
-                config->bind_ip,
-                config->media_port,
-                errno,
-                strerror(errno));
-        close(socket_fd);
-        return -1;
+        for (i = 0; i < GB28181_MAX_MEDIA_SESSIONS; ++i)
+            media_rtp_egress_update_pacing_rate(&channel->rtp_egress[i], channel->bitrate, channel->fps);
+        channel->rate_changed = 0;
     }
-    session->rtp_socket_fd = socket_fd;
-    return 0;
+    for (i = 0; i < GB28181_MAX_MEDIA_SESSIONS; ++i)
+    {
+        Gb28181MediaSession *session = &channel->media_sessions[i];
+        if (!session->active || !session->established)
+            continue;
+        if (channel->egress_cid[i] != session->cid)
+        {
+            reset_session_egress(ctx, channel, i);
+            if (channel->nack_enabled)
+                media_rtp_history_reset(&channel->nack_history[i], session->rtp_ssrc);
+            /* FEC 走独立 SSRC，避免打乱媒体流的序号连续性。 */
+            if (channel->fec_enabled)
+                media_rtp_fec_stream_reset(&channel->fec_streams[i], session->rtp_ssrc + 1);
+            media_rtcp_peer_reset(&channel->rtcp_peers[i]);
+            channel->egress_cid[i] = session->cid;
+        }
+        poll_rtp_tcp_connection(session, &channel->rtp_egress[i]);
+        if (media_transport_ready(session))
+            ready++;
+    }
+    return ready;
 }
 
-/* 关闭 RTP socket。 */
-static void close_rtp_socket(Gb28181MediaSession *session)
+/*
+ * 把通道上已封装好的一帧 PS 扇出到该通道所有就绪会话：
+ * 1. 持锁挑选目标并快照（新会话和丢过帧的会话要等关键帧），给选中的槽位记一次 slot_sending；
+ * 2. 不持锁切片发送，PS 只切一次；
+ * 3. 持锁放下槽位并广播 send_done_cond，写回各会话的序号/时间戳，丢帧的会话重新等关键帧并请求 IDR，
+ *    发送失败的会话单独关闭。SIP 线程关闭会话时等 slot_sending 归零，fd 不会在发送途中被关掉复用。
+ * 开启 NACK/RTCP 时，新帧发出前先把各 UDP 会话积压的 RTCP 反馈处理掉，发完后按周期补发 SR。
+ * 返回本帧实际发出的会话数。
+ */
+static int send_frame_to_sessions(Gb28181DeviceCtx *ctx, Gb28181Channel *channel, int is_key_frame, uint32_t rtp_timestamp, uint64_t pts_us)
 {
-    if (!session)
-        return;
-    if (session->rtp_socket_fd >= 0)
-        close(session->rtp_socket_fd);
-    session->rtp_socket_fd = -1;
+    Gb28181RtpTarget targets[GB28181_MAX_MEDIA_SESSIONS];
+    int target_count = 0;
+    int sent = 0;
+    int i;
+
+    pthread_mutex_lock(&ctx->session_lock);
+    refresh_media_targets(ctx, channel);
+    for (i = 0; i < GB28181_MAX_MEDIA_SESSIONS; ++i)
+    {
+        Gb28181MediaSession *session = &channel->media_sessions[i];
+        if (!session->active || !session->established || channel->slot_closing[i] || !media_transport_ready(session))
+            continue;
+        if (session->wait_keyframe && !is_key_frame)
+            continue;
+        session->wait_keyframe = 0;
+        channel->slot_sending[i]++;
+        memset(&targets[target_count], 0, sizeof(targets[target_count]));
+        targets[target_count].session = *session;
+        targets[target_count].egress = &channel->rtp_egress[i];
+        if (channel->nack_enabled && !session->rtp_tcp)
+            targets[target_count].history = &channel->nack_history[i];
+        if (channel->fec_enabled && !session->rtp_tcp)
+            targets[target_count].fec = &channel->fec_streams[i];
+        if (ctx->config.rtp_rtcp && !session->rtp_tcp)
+            targets[target_count].rtcp = &channel->rtcp_peers[i];
+        target_count++;
+    }
+    pthread_mutex_unlock(&ctx->session_lock);
+    if (target_count == 0)
+        return 0;
+
+    for (i = 0; i < target_count; ++i)
+        serve_rtcp_feedback(&targets[i]);
+    send_ps_over_rtp(channel, targets, target_count, is_key_frame, rtp_timestamp);
+    for (i = 0; i < target_count; ++i)
+        send_sender_report(ctx, &targets[i], rtp_timestamp, pts_us);
+
+    pthread_mutex_lock(&ctx->session_lock);
+    for (i = 0; i < target_count; ++i)
+        channel->slot_sending[targets[i].session.slot]--;
+    pthread_cond_broadcast(&ctx->send_done_cond);
+    for (i = 0; i < target_count; ++i)
+    {
+        Gb28181RtpTarget *target = &targets[i];
+        Gb28181MediaSession *session = &channel->media_sessions[target->session.slot];
+        if (!session->active || session->cid != target->session.cid)
+            continue;
+        if (target->failed)
+        {
+            /* 单个会话发送失败时只关闭它，促使对应平台重新点播。 */
+            GB28181_LOGE("[GB28181][ERROR] media send failed, close session channel=%d slot=%d cid=%d remote=%s:%d\n",
+                         session->channel, session->slot, session->cid, session->remote_ip, session->remote_port);
+            close_rtp_socket(session);
+            reset_media_session(session);
+            continue;
+        }
+        session->rtp_sequence = target->session.rtp_sequence;
+        session->last_rtp_timestamp = target->session.last_rtp_timestamp;
+        if (target->dropped)
+        {
+            /* TCP 拥塞丢帧：该会话后续 P 帧直到关键帧都跳过，并重新请求 IDR。 */
+            session->wait_keyframe = 1;
+            channel->pending_force_idr = 1;
+            channel->external_idr_requested = 0;
+            continue;
+        }
+        sent++;
+    }
+    pthread_mutex_unlock(&ctx->session_lock);
+    for (i = 0; i < target_count; ++i)
+        log_rtp_egress_if_due(channel, &targets[i]);
+    return sent;
 }
 
 /* 补齐 GB28181 XML 声明头。 */
@@ -788,7 +1259,7 @@ static int send_message_request(Gb28181DeviceCtx *ctx, const char *content_type,
     osip_message_t *message = NULL;
     if (!ctx || !ctx->sip_context || !content_type || !body)
     {
-        fprintf(stderr, "[GB28181][ERROR] send_message_request invalid args\n");
+        GB28181_LOGE("[GB28181][ERROR] send_message_request invalid args\n");
         return -1;
     }
     snprintf(from_uri, sizeof(from_uri), "sip:%s@%s", ctx->config.device_id, ctx->config.device_domain);
@@ -796,7 +1267,7 @@ static int send_message_request(Gb28181DeviceCtx *ctx, const char *content_type,
     eXosip_lock(ctx->sip_context);
     if (eXosip_message_build_request(ctx->sip_context, &message, "MESSAGE", server_uri, from_uri, NULL) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] send_message_request build MESSAGE failed target=%s\n", server_uri);
+        GB28181_LOGE("[GB28181][ERROR] send_message_request build MESSAGE failed target=%s\n", server_uri);
         eXosip_unlock(ctx->sip_context);
         return -1;
     }
@@ -804,7 +1275,7 @@ static int send_message_request(Gb28181DeviceCtx *ctx, const char *content_type,
     osip_message_set_body(message, body, strlen(body));
     if (eXosip_message_send_request(ctx->sip_context, message) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] send_message_request send MESSAGE failed target=%s\n", server_uri);
+        GB28181_LOGE("[GB28181][ERROR] send_message_request send MESSAGE failed target=%s\n", server_uri);
         eXosip_unlock(ctx->sip_context);
         return -1;
     }
@@ -822,35 +1293,76 @@ static int send_keepalive(Gb28181DeviceCtx *ctx)
                            ++ctx->xml_sn, ctx->config.device_id);
     if (written < 0 || (size_t)written >= sizeof(inner_xml))
     {
-        fprintf(stderr, "[GB28181][ERROR] send_keepalive build xml failed\n");
+        GB28181_LOGE("[GB28181][ERROR] send_keepalive build xml failed\n");
         return -1;
     }
     if (build_xml_body(xml_body, sizeof(xml_body), inner_xml) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] send_keepalive build_xml_body failed\n");
+        GB28181_LOGE("[GB28181][ERROR] send_keepalive build_xml_body failed\n");
         return -1;
     }
     return send_message_request(ctx, "Application/MANSCDP+xml", xml_body);
 }
 
-/* 发送 Catalog 应答。 */
+/* 发送 Catalog 应答：每个已挂入的通道一个 Item。 */
 static int send_catalog_response(Gb28181DeviceCtx *ctx, const char *sn)
 {
-    char inner_xml[2048];
-    char xml_body[2304];
-    int written = snprintf(inner_xml, sizeof(inner_xml),
-                           "<Response>\r\n  <CmdType>Catalog</CmdType>\r\n  <SN>%s</SN>\r\n  <DeviceID>%s</DeviceID>\r\n  <SumNum>1</SumNum>\r\n  <DeviceList Num=\"1\">\r\n    <Item>\r\n      <DeviceID>%s</DeviceID>\r\n      <Name>%s</Name>\r\n      <Manufacturer>%s</Manufacturer>\r\n      <Model>%s</Model>\r\n      <Owner>RKMediaGateway</Owner>\r\n      <CivilCode>%s</CivilCode>\r\n      <Address>%s</Address>\r\n      <Parental>0</Parental>\r\n      <SafetyWay>0</SafetyWay>\r\n      <RegisterWay>1</RegisterWay>\r\n      <Secrecy>0</Secrecy>\r\n      <Status>ON</Status>\r\n    </Item>\r\n  </DeviceList>\r\n</Response>\r\n",
-                           sn, ctx->config.device_id, ctx->config.channel_id, ctx->config.device_name, ctx->config.manufacturer, ctx->config.model, ctx->config.device_domain, ctx->config.server_ip);
+    char item_xml[GB28181_MAX_CHANNELS][768];
+    char inner_xml[4096];
+    char xml_body[4352];
+    int item_count = 0;
+    size_t pos = 0;
+    int written;
+    int c;
+    pthread_mutex_lock(&ctx->session_lock);
+    for (c = 0; c < GB28181_MAX_CHANNELS; ++c)
+    {
+        const Gb28181Channel *channel = &ctx->channels[c];
+        if (!channel->in_use)
+            continue;
+        written = snprintf(item_xml[item_count], sizeof(item_xml[item_count]),
+                           "    <Item>\r\n      <DeviceID>%s</DeviceID>\r\n      <Name>%s</Name>\r\n      <Manufacturer>%s</Manufacturer>\r\n      <Model>%s</Model>\r\n      <Owner>RKMediaGateway</Owner>\r\n      <CivilCode>%s</CivilCode>\r\n      <Address>%s</Address>\r\n      <Parental>0</Parental>\r\n      <ParentID>%s</ParentID>\r\n      <SafetyWay>0</SafetyWay>\r\n      <RegisterWay>1</RegisterWay>\r\n      <Secrecy>0</Secrecy>\r\n      <Status>ON</Status>\r\n    </Item>\r\n",
+                           channel->channel_id, channel->name, ctx->config.manufacturer, ctx->config.model, ctx->config.device_domain, ctx->config.server_ip, ctx->config.device_id);
+        if (written < 0 || (size_t)written >= sizeof(item_xml[item_count]))
+        {
+            pthread_mutex_unlock(&ctx->session_lock);
+            GB28181_LOGE("[GB28181][ERROR] send_catalog_response build item failed channel=%d\n", c);
+            return -1;
+        }
+        item_count++;
+    }
+    pthread_mutex_unlock(&ctx->session_lock);
+    written = snprintf(inner_xml, sizeof(inner_xml),
+                       "<Response>\r\n  <CmdType>Catalog</CmdType>\r\n  <SN>%s</SN>\r\n  <DeviceID>%s</DeviceID>\r\n  <SumNum>%d</SumNum>\r\n  <DeviceList Num=\"%d\">\r\n",
+                       sn, ctx->config.device_id, item_count, item_count);
     if (written < 0 || (size_t)written >= sizeof(inner_xml))
     {
-        fprintf(stderr, "[GB28181][ERROR] send_catalog_response build xml failed\n");
+        GB28181_LOGE("[GB28181][ERROR] send_catalog_response build xml failed\n");
+        return -1;
+    }
+    pos = (size_t)written;
+    for (c = 0; c < item_count; ++c)
+    {
+        written = snprintf(inner_xml + pos, sizeof(inner_xml) - pos, "%s", item_xml[c]);
+        if (written < 0 || (size_t)written >= sizeof(inner_xml) - pos)
+        {
+            GB28181_LOGE("[GB28181][ERROR] send_catalog_response build xml failed\n");
+            return -1;
+        }
+        pos += (size_t)written;
+    }
+    written = snprintf(inner_xml + pos, sizeof(inner_xml) - pos, "  </DeviceList>\r\n</Response>\r\n");
+    if (written < 0 || (size_t)written >= sizeof(inner_xml) - pos)
+    {
+        GB28181_LOGE("[GB28181][ERROR] send_catalog_response build xml failed\n");
         return -1;
     }
     if (build_xml_body(xml_body, sizeof(xml_body), inner_xml) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] send_catalog_response build_xml_body failed\n");
+        GB28181_LOGE("[GB28181][ERROR] send_catalog_response build_xml_body failed\n");
         return -1;
     }
+    GB28181_LOGI("[GB28181] catalog response sn=%s channels=%d\n", sn, item_count);
     return send_message_request(ctx, "Application/MANSCDP+xml", xml_body);
 }
 
@@ -859,17 +1371,27 @@ static int send_device_info_response(Gb28181DeviceCtx *ctx, const char *sn)
 {
     char inner_xml[1024];
     char xml_body[1280];
-    int written = snprintf(inner_xml, sizeof(inner_xml),
-                           "<Response>\r\n  <CmdType>DeviceInfo</CmdType>\r\n  <SN>%s</SN>\r\n  <DeviceID>%s</DeviceID>\r\n  <DeviceName>%s</DeviceName>\r\n  <Manufacturer>%s</Manufacturer>\r\n  <Model>%s</Model>\r\n  <Firmware>%s</Firmware>\r\n  <Channel>1</Channel>\r\n</Response>\r\n",
-                           sn, ctx->config.device_id, ctx->config.device_name, ctx->config.manufacturer, ctx->config.model, ctx->config.firmware);
+    int channel_count = 0;
+    int written;
+    int c;
+    pthread_mutex_lock(&ctx->session_lock);
+    for (c = 0; c < GB28181_MAX_CHANNELS; ++c)
+    {
+        if (ctx->channels[c].in_use)
+            channel_count++;
+    }
+    pthread_mutex_unlock(&ctx->session_lock);
+    written = snprintf(inner_xml, sizeof(inner_xml),
+                       "<Response>\r\n  <CmdType>DeviceInfo</CmdType>\r\n  <SN>%s</SN>\r\n  <DeviceID>%s</DeviceID>\r\n  <DeviceName>%s</DeviceName>\r\n  <Manufacturer>%s</Manufacturer>\r\n  <Model>%s</Model>\r\n  <Firmware>%s</Firmware>\r\n  <Channel>%d</Channel>\r\n</Response>\r\n",
+                       sn, ctx->config.device_id, ctx->config.device_name, ctx->config.manufacturer, ctx->config.model, ctx->config.firmware, channel_count);
     if (written < 0 || (size_t)written >= sizeof(inner_xml))
     {
-        fprintf(stderr, "[GB28181][ERROR] send_device_info_response build xml failed\n");
+        GB28181_LOGE("[GB28181][ERROR] send_device_info_response build xml failed\n");
         return -1;
     }
     if (build_xml_body(xml_body, sizeof(xml_body), inner_xml) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] send_device_info_response build_xml_body failed\n");
+        GB28181_LOGE("[GB28181][ERROR] send_device_info_response build_xml_body failed\n");
         return -1;
     }
     return send_message_request(ctx, "Application/MANSCDP+xml", xml_body);
@@ -885,7 +1407,7 @@ static int send_register_request(Gb28181DeviceCtx *ctx, int expires)
     int rid = -1;
     if (!ctx || !ctx->sip_context)
     {
-        fprintf(stderr, "[GB28181][ERROR] send_register_request invalid ctx\n");
+        GB28181_LOGE("[GB28181][ERROR] send_register_request invalid ctx\n");
         return -1;
     }
     build_register_identity(ctx, from_uri, sizeof(from_uri), proxy_uri, sizeof(proxy_uri), contact_uri, sizeof(contact_uri));
@@ -895,7 +1417,7 @@ static int send_register_request(Gb28181DeviceCtx *ctx, int expires)
         rid = eXosip_register_build_initial_register(ctx->sip_context, from_uri, proxy_uri, contact_uri, expires, &register_message);
         if (rid <= 0 || !register_message)
         {
-            fprintf(stderr, "[GB28181][ERROR] send_register_request build initial failed rid=%d\n", rid);
+            GB28181_LOGE("[GB28181][ERROR] send_register_request build initial failed rid=%d\n", rid);
             eXosip_unlock(ctx->sip_context);
             return -1;
         }
@@ -905,14 +1427,14 @@ static int send_register_request(Gb28181DeviceCtx *ctx, int expires)
     {
         if (eXosip_register_build_register(ctx->sip_context, ctx->rid, expires, &register_message) != 0 || !register_message)
         {
-            fprintf(stderr, "[GB28181][ERROR] send_register_request build refresh failed rid=%d\n", ctx->rid);
+            GB28181_LOGE("[GB28181][ERROR] send_register_request build refresh failed rid=%d\n", ctx->rid);
             eXosip_unlock(ctx->sip_context);
             return -1;
         }
     }
     if (eXosip_register_send_register(ctx->sip_context, ctx->rid, register_message) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] send_register_request send failed rid=%d\n", ctx->rid);
+        GB28181_LOGE("[GB28181][ERROR] send_register_request send failed rid=%d\n", ctx->rid);
         eXosip_unlock(ctx->sip_context);
         return -1;
     }
@@ -940,13 +1462,13 @@ static int answer_simple_request(Gb28181DeviceCtx *ctx, eXosip_event_t *event, i
 {
     if (!ctx || !event)
     {
-        fprintf(stderr, "[GB28181][ERROR] answer_simple_request invalid args\n");
+        GB28181_LOGE("[GB28181][ERROR] answer_simple_request invalid args\n");
         return -1;
     }
     eXosip_lock(ctx->sip_context);
     if (eXosip_message_send_answer(ctx->sip_context, event->tid, status_code, NULL) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] answer_simple_request failed tid=%d status=%d\n", event->tid, status_code);
+        GB28181_LOGE("[GB28181][ERROR] answer_simple_request failed tid=%d status=%d\n", event->tid, status_code);
         eXosip_unlock(ctx->sip_context);
         return -1;
     }
@@ -959,13 +1481,13 @@ static int answer_call_request(Gb28181DeviceCtx *ctx, eXosip_event_t *event, int
 {
     if (!ctx || !event)
     {
-        fprintf(stderr, "[GB28181][ERROR] answer_call_request invalid args\n");
+        GB28181_LOGE("[GB28181][ERROR] answer_call_request invalid args\n");
         return -1;
     }
     eXosip_lock(ctx->sip_context);
     if (eXosip_call_send_answer(ctx->sip_context, event->tid, status_code, NULL) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] answer_call_request failed tid=%d status=%d\n", event->tid, status_code);
+        GB28181_LOGE("[GB28181][ERROR] answer_call_request failed tid=%d status=%d\n", event->tid, status_code);
         eXosip_unlock(ctx->sip_context);
         return -1;
     }
@@ -981,7 +1503,7 @@ static int handle_query_message(Gb28181DeviceCtx *ctx, eXosip_event_t *event)
     char sn[64];
     if (!ctx || !event || !event->request)
     {
-        fprintf(stderr, "[GB28181][ERROR] handle_query_message invalid args\n");
+        GB28181_LOGE("[GB28181][ERROR] handle_query_message invalid args\n");
         return -1;
     }
     memset(cmd_type, 0, sizeof(cmd_type));
@@ -995,7 +1517,7 @@ static int handle_query_message(Gb28181DeviceCtx *ctx, eXosip_event_t *event)
         snprintf(sn, sizeof(sn), "%u", ++ctx->xml_sn);
     if (answer_simple_request(ctx, event, 200) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] handle_query_message answer 200 failed\n");
+        GB28181_LOGE("[GB28181][ERROR] handle_query_message answer 200 failed\n");
         return -1;
     }
     if (strcmp(cmd_type, "Catalog") == 0)
@@ -1007,28 +1529,27 @@ static int handle_query_message(Gb28181DeviceCtx *ctx, eXosip_event_t *event)
 
 /*
  * 本地媒体线程：
- * 仅在 internal mode（external_media_input=0）使用。
+ * 仅在 internal mode（external_media_input=0）使用，本地采集只对应通道 0。
  * 主流程：采集 NV12 -> MPP 编码 H264 -> PS 封装 -> RTP 发送。
  */
 static void *media_thread_main(void *arg)
 {
     Gb28181DeviceCtx *ctx = (Gb28181DeviceCtx *)arg;
-    Gb28181Buffer ps_buffer;
-    if (!ctx || gb_buffer_init(&ps_buffer, GB28181_PS_BUFFER_INIT_SIZE) != 0)
+    Gb28181Channel *channel = NULL;
+    if (!ctx)
         return NULL;
+    channel = &ctx->channels[0];
     while (ctx->running)
     {
-        Gb28181MediaSession session_snapshot;
         /* 没有点播会话时线程休眠，避免空转占用 CPU。 */
         pthread_mutex_lock(&ctx->session_lock);
-        while (ctx->running && (!ctx->media_session.active || !ctx->media_session.established))
+        while (ctx->running && !has_established_session(channel))
             pthread_cond_wait(&ctx->session_cond, &ctx->session_lock);
         if (!ctx->running)
         {
             pthread_mutex_unlock(&ctx->session_lock);
             break;
         }
-        session_snapshot = ctx->media_session;
         pthread_mutex_unlock(&ctx->session_lock);
         while (ctx->running)
         {
@@ -1043,29 +1564,35 @@ static void *media_thread_main(void *arg)
             uint32_t rtp_timestamp = 0;
             int request_idr_now = 0;
             pthread_mutex_lock(&ctx->session_lock);
-            if (!ctx->media_session.active || !ctx->media_session.established)
+            if (!has_established_session(channel))
             {
                 pthread_mutex_unlock(&ctx->session_lock);
                 break;
             }
-            session_snapshot = ctx->media_session;
-            if (ctx->pending_force_idr)
+            if (refresh_media_targets(ctx, channel) == 0)
+            {
+                /* 会话的 TCP 连接都还没建立，先不抓帧编码。 */
+                pthread_mutex_unlock(&ctx->session_lock);
+                usleep(10000);
+                continue;
+            }
+            if (channel->pending_force_idr)
             {
                 request_idr_now = 1;
-                ctx->pending_force_idr = 0;
+                channel->pending_force_idr = 0;
             }
             pthread_mutex_unlock(&ctx->session_lock);
             if (request_idr_now)
             {
                 if (mpp_encoder_request_idr(ctx->encoder) == 0)
                 {
-                    printf("[GB28181] request IDR after call established (internal mode)\n");
+                    GB28181_LOGI("[GB28181] request IDR after call established (internal mode)\n");
                 }
                 else
                 {
-                    fprintf(stderr, "[GB28181] request IDR failed, will retry next frame\n");
+                    GB28181_LOGW("[GB28181] request IDR failed, will retry next frame\n");
                     pthread_mutex_lock(&ctx->session_lock);
-                    ctx->pending_force_idr = 1;
+                    channel->pending_force_idr = 1;
                     pthread_mutex_unlock(&ctx->session_lock);
                 }
             }
@@ -1087,108 +1614,205 @@ static void *media_thread_main(void *arg)
                 continue;
             if (!h264_data || h264_len == 0)
                 continue;
-            if (build_ps_frame(h264_data, h264_len, is_key_frame, dqbuf_ts_us, &ps_buffer) != 0)
+            if (build_ps_frame(h264_data, h264_len, is_key_frame, dqbuf_ts_us, &channel->ps_muxer) != 0)
                 continue;
             /* PTS 主要给解复用/解码链路用；RTP timestamp 主要给网络抖动缓冲和同步排序用。 */
             rtp_timestamp = (uint32_t)((dqbuf_ts_us * 90ULL / 1000ULL) & 0xFFFFFFFFU);
-            if (send_ps_over_rtp(&session_snapshot, ps_buffer.data, ps_buffer.size, rtp_timestamp) != 0)
-            {
-                usleep(10000);
-                continue;
-            }
-            pthread_mutex_lock(&ctx->session_lock);
-            if (ctx->media_session.active && ctx->media_session.established && ctx->media_session.cid == session_snapshot.cid)
-            {
-                ctx->media_session.rtp_sequence = session_snapshot.rtp_sequence;
-                ctx->media_session.last_rtp_timestamp = session_snapshot.last_rtp_timestamp;
-            }
-            pthread_mutex_unlock(&ctx->session_lock);
+            send_frame_to_sessions(ctx, channel, is_key_frame, rtp_timestamp, dqbuf_ts_us);
         }
     }
-    gb_buffer_deinit(&ps_buffer);
     return NULL;
 }
 
-/* 安全停止当前媒体会话并清理 RTP 资源。 */
-static void stop_media_session(Gb28181DeviceCtx *ctx)
+/*
+ * 关闭通道的一个会话槽位（调用方持有 session_lock）；通道最后一个会话关闭时清掉待发的 IDR 请求。
+ * 发流线程可能正不持锁地用该槽位的 socket 收发，先标记 closing 让它不再挑选，再等它放下后才 close，
+ * 否则 fd 号被新 socket 复用后，残余的发送会落到别的连接上。
+ */
+static void close_session_slot(Gb28181DeviceCtx *ctx, Gb28181Channel *channel, int slot)
+{
+    int i;
+    channel->slot_closing[slot] = 1;
+    while (ctx->sync_ready && channel->slot_sending[slot] > 0)
+        pthread_cond_wait(&ctx->send_done_cond, &ctx->session_lock);
+    channel->slot_closing[slot] = 0;
+    close_rtp_socket(&channel->media_sessions[slot]);
+    reset_media_session(&channel->media_sessions[slot]);
+    for (i = 0; i < GB28181_MAX_MEDIA_SESSIONS; ++i)
+    {
+        if (channel->media_sessions[i].active)
+            return;
+    }
+    channel->pending_force_idr = 0;
+    channel->external_idr_requested = 0;
+}
+
+/* 关闭通道上的全部会话（调用方持有 session_lock）。 */
+static void close_channel_sessions(Gb28181DeviceCtx *ctx, Gb28181Channel *channel)
 {
+    int i;
+    for (i = 0; i < GB28181_MAX_MEDIA_SESSIONS; ++i)
+        close_session_slot(ctx, channel, i);
+}
+
+/* 安全停止 cid 对应的媒体会话并清理 RTP 资源；cid < 0 时停止所有通道的全部会话。 */
+static void stop_media_session(Gb28181DeviceCtx *ctx, int cid)
+{
+    Gb28181MediaSession *session = NULL;
+    int c;
     if (!ctx)
         return;
-    if (!ctx->sync_ready)
+    if (ctx->sync_ready)
+        pthread_mutex_lock(&ctx->session_lock);
+    if (cid < 0)
     {
-        close_rtp_socket(&ctx->media_session);
-        reset_media_session(&ctx->media_session);
-        return;
+        for (c = 0; c < GB28181_MAX_CHANNELS; ++c)
+            close_channel_sessions(ctx, &ctx->channels[c]);
+    }
+    else if ((session = find_session(ctx, cid)) != NULL)
+    {
+        close_session_slot(ctx, &ctx->channels[session->channel], session->slot);
     }
+    if (ctx->sync_ready)
+        pthread_mutex_unlock(&ctx->session_lock);
+}
+
+/*
+ * 从 INVITE 中取被叫通道 ID：优先 Request-URI 的用户部分，缺省时用 To。
+ * 目标是设备 ID 本身（老平台按设备点播）时落到通道 0。
+ */
+static int resolve_invite_channel(Gb28181DeviceCtx *ctx, osip_message_t *request, char *channel_id, size_t channel_id_size)
+{
+    osip_uri_t *uri = osip_message_get_uri(request);
+    osip_to_t *to = osip_message_get_to(request);
+    int channel = -1;
+    channel_id[0] = '\0';
+    if (uri && uri->username)
+        snprintf(channel_id, channel_id_size, "%s", uri->username);
+    else if (to && to->url && to->url->username)
+        snprintf(channel_id, channel_id_size, "%s", to->url->username);
     pthread_mutex_lock(&ctx->session_lock);
-    ctx->pending_force_idr = 0;
-    ctx->external_idr_requested = 0;
-    close_rtp_socket(&ctx->media_session);
-    reset_media_session(&ctx->media_session);
+    channel = find_channel(ctx, channel_id);
+    if (channel < 0 && strcmp(channel_id, ctx->config.device_id) == 0 && ctx->channels[0].in_use)
+        channel = 0;
     pthread_mutex_unlock(&ctx->session_lock);
+    return channel;
 }
 
 /*
  * 处理 INVITE：
- * 1. 解析对端 SDP；
- * 2. 分配本地 SSRC 与 RTP socket；
- * 3. 回复 200 OK（SDP 声明 PS/90000）。
+ * 1. 按被叫通道 ID 路由到通道，未知通道回 404；
+ * 2. 解析对端 SDP；
+ * 3. 按 cid 找会话槽位（re-INVITE 复用原槽位，新点播占用空闲槽位，满了回 486）；
+ * 4. 分配本地 SSRC 与 RTP socket，端口为通道 media_port + 2 * slot；
+ * 5. 回复 200 OK（SDP 声明 PS/90000）。
  */
 static int handle_invite(Gb28181DeviceCtx *ctx, eXosip_event_t *event)
 {
     osip_body_t *body = NULL;
     osip_message_t *answer = NULL;
     char sdp_body[512];
+    char fec_format[16] = "";
+    char fec_attrs[128] = "";
+    char channel_id[64];
     Gb28181MediaSession new_session;
+    Gb28181MediaSession *old_session = NULL;
+    int channel = -1;
+    int slot = -1;
     int ret = -1;
     if (!ctx || !event || !event->request)
     {
-        fprintf(stderr, "[GB28181][ERROR] handle_invite invalid args\n");
+        GB28181_LOGE("[GB28181][ERROR] handle_invite invalid args\n");
         return -1;
     }
     reset_media_session(&new_session);
+    channel = resolve_invite_channel(ctx, event->request, channel_id, sizeof(channel_id));
+    if (channel < 0)
+    {
+        GB28181_LOGI("[GB28181][INVITE] reject cid=%d: unknown channel %s\n", event->cid, channel_id[0] ? channel_id : "N/A");
+        return answer_call_request(ctx, event, 404);
+    }
     if (osip_message_get_body(event->request, 0, &body) != 0 || !body || !body->body)
         return answer_call_request(ctx, event, 400);
-    printf("[GB28181][INVITE] raw_sdp_begin\n%s\n[GB28181][INVITE] raw_sdp_end\n", body->body);
+    GB28181_LOGD("[GB28181][INVITE] raw_sdp_begin\n%s\n[GB28181][INVITE] raw_sdp_end\n", body->body);
     if (parse_invite_sdp(body->body, &new_session) != 0)
         return answer_call_request(ctx, event, 488);
-    printf("[GB28181][INVITE] parsed remote=%s:%d transport=%s y=%s\n",
-           new_session.remote_ip,
-           new_session.remote_port,
-           new_session.transport[0] ? new_session.transport : "N/A",
-           new_session.remote_ssrc[0] ? new_session.remote_ssrc : "N/A");
+    GB28181_LOGI("[GB28181][INVITE] parsed remote=%s:%d transport=%s tcp_mode=%s y=%s\n",
+                 new_session.remote_ip,
+                 new_session.remote_port,
+                 new_session.transport[0] ? new_session.transport : "N/A",
+                 new_session.rtp_tcp ? (new_session.tcp_active ? "active" : "passive") : "N/A",
+                 new_session.remote_ssrc[0] ? new_session.remote_ssrc : "N/A");
     if (strstr(new_session.transport, "RTP/AVP") == NULL)
         return answer_call_request(ctx, event, 488);
+    /* 只有 SIP 线程分配槽位，选定后到写回会话表之间不会被别的 INVITE 抢占。 */
     pthread_mutex_lock(&ctx->session_lock);
-    if (ctx->media_session.active && ctx->media_session.cid != event->cid)
+    old_session = find_session(ctx, event->cid);
+    if (old_session)
+    {
+        /* re-INVITE：先释放原会话的端口再重新绑定。 */
+        int old_channel = old_session->channel;
+        int old_slot = old_session->slot;
+        close_session_slot(ctx, &ctx->channels[old_channel], old_slot);
+        if (old_channel == channel)
+            slot = old_slot;
+    }
+    if (slot < 0)
+        slot = find_free_session_slot(&ctx->channels[channel]);
+    new_session.local_media_port = ctx->channels[channel].media_port + 2 * slot;
+    pthread_mutex_unlock(&ctx->session_lock);
+    if (slot < 0)
     {
-        pthread_mutex_unlock(&ctx->session_lock);
+        GB28181_LOGI("[GB28181][INVITE] reject cid=%d channel=%s: all %d media sessions busy\n", event->cid, channel_id, GB28181_MAX_MEDIA_SESSIONS);
         return answer_call_request(ctx, event, 486);
     }
-    pthread_mutex_unlock(&ctx->session_lock);
+    new_session.channel = channel;
+    new_session.slot = slot;
+    new_session.cid = event->cid;
     if (use_invite_ssrc_if_valid(&new_session) == 0)
-        printf("[GB28181] use invite ssrc=%s rtp_ssrc=%u\n", new_session.local_ssrc, new_session.rtp_ssrc);
+        GB28181_LOGI("[GB28181] use invite ssrc=%s rtp_ssrc=%u\n", new_session.local_ssrc, new_session.rtp_ssrc);
     else
         generate_local_ssrc(&new_session);
     if (setup_rtp_socket(&new_session, &ctx->config) != 0)
         return answer_call_request(ctx, event, 500);
     new_session.active = 1;
     new_session.established = 0;
-    new_session.cid = event->cid;
     new_session.did = event->did;
     new_session.tid = event->tid;
     /*
      * 当前设备对外声明自己发送的是 PS/90000。
      * 这和后面的实际发送格式保持一致，避免 SIP/媒体面不一致。
      */
-    snprintf(sdp_body, sizeof(sdp_body),
-             "v=0\r\no=%s 0 0 IN IP4 %s\r\ns=Play\r\nc=IN IP4 %s\r\nt=0 0\r\nm=video %d RTP/AVP 96\r\na=sendonly\r\na=rtpmap:96 PS/90000\r\ny=%s\r\n",
-             ctx->config.device_id, ctx->config.media_ip, ctx->config.media_ip, ctx->config.media_port, new_session.local_ssrc);
+    if (new_session.rtp_tcp)
+    {
+        /* TCP 模式回应与平台相反的 setup 方向，a=connection:new 表示每次点播新建连接。 */
+        snprintf(sdp_body, sizeof(sdp_body),
+                 "v=0\r\no=%s 0 0 IN IP4 %s\r\ns=Play\r\nc=IN IP4 %s\r\nt=0 0\r\nm=video %d TCP/RTP/AVP 96\r\na=setup:%s\r\na=connection:new\r\na=sendonly\r\na=rtpmap:96 PS/90000\r\ny=%s\r\n",
+                 ctx->config.device_id, ctx->config.media_ip, ctx->config.media_ip, new_session.local_media_port,
+                 new_session.tcp_active ? "active" : "passive", new_session.local_ssrc);
+    }
+    else
+    {
+        /*
+         * UDP 会话开启 FEC 时，把 ulpfec 负载类型一并写进 m= 行并声明 rtpmap，
+         * FEC 走独立 SSRC（媒体 SSRC + 1），用 ssrc-group:FEC 把两路关联起来。
+         */
+        if (ctx->channels[channel].fec_enabled)
+        {
+            snprintf(fec_format, sizeof(fec_format), " %d", ctx->config.rtp_fec_payload_type);
+            snprintf(fec_attrs, sizeof(fec_attrs), "a=rtpmap:%d ulpfec/90000\r\na=ssrc-group:FEC %u %u\r\n",
+                     ctx->config.rtp_fec_payload_type, new_session.rtp_ssrc, new_session.rtp_ssrc + 1);
+        }
+        snprintf(sdp_body, sizeof(sdp_body),
+                 "v=0\r\no=%s 0 0 IN IP4 %s\r\ns=Play\r\nc=IN IP4 %s\r\nt=0 0\r\nm=video %d RTP/AVP 96%s\r\na=sendonly\r\na=rtpmap:96 PS/90000\r\n%sy=%s\r\n",
+                 ctx->config.device_id, ctx->config.media_ip, ctx->config.media_ip, new_session.local_media_port,
+                 fec_format, fec_attrs, new_session.local_ssrc);
+    }
     eXosip_lock(ctx->sip_context);
     eXosip_call_send_answer(ctx->sip_context, event->tid, 180, NULL);
     if (eXosip_call_build_answer(ctx->sip_context, event->tid, 200, &answer) != 0 || !answer)
     {
-        fprintf(stderr, "[GB28181][ERROR] handle_invite build 200 answer failed tid=%d\n", event->tid);
+        GB28181_LOGE("[GB28181][ERROR] handle_invite build 200 answer failed tid=%d\n", event->tid);
         eXosip_unlock(ctx->sip_context);
         close_rtp_socket(&new_session);
         return -1;
@@ -1199,15 +1823,17 @@ static int handle_invite(Gb28181DeviceCtx *ctx, eXosip_event_t *event)
     eXosip_unlock(ctx->sip_context);
     if (ret != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] handle_invite send 200 answer failed tid=%d ret=%d\n", event->tid, ret);
+        GB28181_LOGE("[GB28181][ERROR] handle_invite send 200 answer failed tid=%d ret=%d\n", event->tid, ret);
         close_rtp_socket(&new_session);
         return -1;
     }
     pthread_mutex_lock(&ctx->session_lock);
-    close_rtp_socket(&ctx->media_session);
-    ctx->media_session = new_session;
+    if (ctx->channels[channel].in_use)
+        ctx->channels[channel].media_sessions[slot] = new_session;
+    else
+        close_rtp_socket(&new_session);
     pthread_mutex_unlock(&ctx->session_lock);
-    printf("[GB28181] invite accepted remote=%s:%d transport=%s local_media=%s:%d local_ssrc=%s\n", new_session.remote_ip, new_session.remote_port, new_session.transport, ctx->config.media_ip, ctx->config.media_port, new_session.local_ssrc);
+    GB28181_LOGI("[GB28181] invite accepted channel=%s slot=%d cid=%d remote=%s:%d transport=%s local_media=%s:%d local_ssrc=%s\n", channel_id, slot, new_session.cid, new_session.remote_ip, new_session.remote_port, new_session.transport, ctx->config.media_ip, new_session.local_media_port, new_session.local_ssrc);
     return 0;
 }
 
@@ -1224,34 +1850,41 @@ static void process_event(Gb28181DeviceCtx *ctx, eXosip_event_t *event)
         ctx->registered_ok = 1;
         ctx->next_keepalive_ms = now_ms + (long long)ctx->config.keepalive_interval_sec * 1000LL;
         ctx->next_register_retry_ms = now_ms + get_register_refresh_interval_ms(ctx);
-        printf("[GB28181] register success rid=%d\n", event->rid);
+        GB28181_LOGI("[GB28181] register success rid=%d\n", event->rid);
         break;
     }
     case EXOSIP_REGISTRATION_FAILURE:
         ctx->registered_ok = 0;
         ctx->next_register_retry_ms = get_now_ms() + (long long)ctx->config.register_retry_interval_sec * 1000LL;
-        printf("[GB28181] register failure rid=%d status=%d\n", event->rid, event->response ? event->response->status_code : 0);
+        GB28181_LOGI("[GB28181] register failure rid=%d status=%d\n", event->rid, event->response ? event->response->status_code : 0);
         handle_auth_failure(ctx, event);
         break;
     case EXOSIP_CALL_INVITE:
         handle_invite(ctx, event);
         break;
     case EXOSIP_CALL_ACK:
+    {
+        Gb28181MediaSession *session;
         pthread_mutex_lock(&ctx->session_lock);
-        if (ctx->media_session.cid == event->cid)
+        session = find_session(ctx, event->cid);
+        if (session)
         {
-            ctx->media_session.established = 1;
-            ctx->pending_force_idr = 1;
-            ctx->external_idr_requested = 0;
+            Gb28181Channel *channel = &ctx->channels[session->channel];
+            /* 新会话先等关键帧，其它已在发流的会话不受影响。 */
+            session->established = 1;
+            session->wait_keyframe = 1;
+            channel->pending_force_idr = 1;
+            channel->external_idr_requested = 0;
             pthread_cond_signal(&ctx->session_cond);
-            printf("[GB28181] call established cid=%d did=%d remote=%s:%d\n", ctx->media_session.cid, ctx->media_session.did, ctx->media_session.remote_ip, ctx->media_session.remote_port);
+            GB28181_LOGI("[GB28181] call established channel=%s slot=%d cid=%d did=%d remote=%s:%d\n", channel->channel_id, session->slot, session->cid, session->did, session->remote_ip, session->remote_port);
             if (ctx->config.external_media_input)
             {
-                printf("[GB28181] external mode: pending upstream IDR request armed\n");
+                GB28181_LOGI("[GB28181] external mode: pending upstream IDR request armed\n");
             }
         }
         pthread_mutex_unlock(&ctx->session_lock);
         break;
+    }
     case EXOSIP_CALL_CLOSED:
     case EXOSIP_CALL_RELEASED:
     case EXOSIP_CALL_CANCELLED:
@@ -1259,17 +1892,18 @@ static void process_event(Gb28181DeviceCtx *ctx, eXosip_event_t *event)
     case EXOSIP_CALL_REQUESTFAILURE:
     case EXOSIP_CALL_SERVERFAILURE:
     case EXOSIP_CALL_GLOBALFAILURE:
+    {
+        Gb28181MediaSession *session;
         pthread_mutex_lock(&ctx->session_lock);
-        if (ctx->media_session.cid == event->cid)
+        session = find_session(ctx, event->cid);
+        if (session)
         {
-            printf("[GB28181] call closed cid=%d did=%d\n", event->cid, event->did);
-            ctx->pending_force_idr = 0;
-            ctx->external_idr_requested = 0;
-            close_rtp_socket(&ctx->media_session);
-            reset_media_session(&ctx->media_session);
+            GB28181_LOGI("[GB28181] call closed channel=%d slot=%d cid=%d did=%d\n", session->channel, session->slot, event->cid, event->did);
+            close_session_slot(ctx, &ctx->channels[session->channel], session->slot);
         }
         pthread_mutex_unlock(&ctx->session_lock);
         break;
+    }
     case EXOSIP_MESSAGE_NEW:
         if (event->request && MSG_IS_MESSAGE(event->request))
             handle_query_message(ctx, event);
@@ -1285,7 +1919,7 @@ static void process_event(Gb28181DeviceCtx *ctx, eXosip_event_t *event)
         if (event->request && MSG_IS_BYE(event->request))
         {
             answer_call_request(ctx, event, 200);
-            stop_media_session(ctx);
+            stop_media_session(ctx, event->cid);
         }
         else if (event->request && (MSG_IS_INFO(event->request) || MSG_IS_OPTIONS(event->request)))
         {
@@ -1303,13 +1937,13 @@ static int init_media_modules(Gb28181DeviceCtx *ctx)
     MppEncoderOptions options;
     if (!ctx)
     {
-        fprintf(stderr, "[GB28181][ERROR] init_media_modules ctx is NULL\n");
+        GB28181_LOGE("[GB28181][ERROR] init_media_modules ctx is NULL\n");
         return -1;
     }
     /* SIP 注册成功前就把采集+编码链路准备好，这样 INVITE 建立后可以尽快开始送流。 */
     if (v4l2_capture_init(ctx->capture) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] init_media_modules v4l2_capture_init failed\n");
+        GB28181_LOGE("[GB28181][ERROR] init_media_modules v4l2_capture_init failed\n");
         return -1;
     }
     ctx->capture_ready = 1;
@@ -1320,29 +1954,111 @@ static int init_media_modules(Gb28181DeviceCtx *ctx)
     options.h264_cabac_en = ctx->config.h264_cabac_en;
     if (mpp_encoder_init(ctx->encoder, CAPTURE_WIDTH, CAPTURE_HEIGHT, ctx->config.fps, ctx->config.bitrate, ctx->config.gop, &options) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] init_media_modules mpp_encoder_init failed fps=%d bitrate=%d gop=%d\n",
-                ctx->config.fps, ctx->config.bitrate, ctx->config.gop);
+        GB28181_LOGE("[GB28181][ERROR] init_media_modules mpp_encoder_init failed fps=%d bitrate=%d gop=%d\n",
+                     ctx->config.fps, ctx->config.bitrate, ctx->config.gop);
         return -1;
     }
     ctx->encoder_ready = 1;
     return 0;
 }
 
+/* 释放通道的重传缓冲与各槽位历史。 */
+static void release_channel_nack(Gb28181Channel *channel)
+{
+    int i;
+    if (!channel->nack_enabled)
+        return;
+    for (i = 0; i < GB28181_MAX_MEDIA_SESSIONS; ++i)
+        media_rtp_history_deinit(&channel->nack_history[i]);
+    media_rtp_history_arena_deinit(&channel->nack_arena);
+    channel->nack_enabled = 0;
+}
+
+/* 按配置分配通道的 FEC 生成器，失败时该通道不发 FEC。 */
+static void init_channel_fec(const Gb28181DeviceCtx *ctx, Gb28181Channel *channel)
+{
+    MediaRtpFecConfig fec;
+    if (!ctx->config.rtp_fec)
+        return;
+    memset(&fec, 0, sizeof(fec));
+    fec.enabled = 1;
+    fec.payload_type = ctx->config.rtp_fec_payload_type;
+    fec.key_percent = ctx->config.rtp_fec_key_percent;
+    fec.delta_percent = ctx->config.rtp_fec_delta_percent;
+    channel->fec_enabled = (media_rtp_fec_init(&channel->fec, &fec) == 0);
+}
+
+/* 释放通道的 FEC 生成器。 */
+static void release_channel_fec(Gb28181Channel *channel)
+{
+    if (!channel->fec_enabled)
+        return;
+    media_rtp_fec_deinit(&channel->fec);
+    channel->fec_enabled = 0;
+}
+
+/* 按配置分配通道的重传缓冲，失败时该通道不做重传，照常发流。 */
+static void init_channel_nack(const Gb28181DeviceCtx *ctx, Gb28181Channel *channel)
+{
+    int i;
+    if (!ctx->config.rtp_nack)
+        return;
+    if (media_rtp_history_arena_init(&channel->nack_arena, (size_t)ctx->config.rtp_nack_history_kb * 1024) != 0)
+        return;
+    channel->nack_enabled = 1;
+    for (i = 0; i < GB28181_MAX_MEDIA_SESSIONS; ++i)
+    {
+        if (media_rtp_history_init(&channel->nack_history[i], &channel->nack_arena, GB28181_NACK_HISTORY_ENTRIES) != 0)
+        {
+            release_channel_nack(channel);
+            return;
+        }
+    }
+}
+
+/*
+ * 初始化通道下标 index（调用方持有 session_lock 或 SIP 线程尚未启动）：
+ * 会话表、发送器、PS 封装、重传缓冲与 FEC 全部复位后再置 in_use，SIP 线程看到通道时它已可用。
+ */
+static void init_channel(Gb28181DeviceCtx *ctx, int index, const Gb28181ChannelConfig *config)
+{
+    Gb28181Channel *channel = &ctx->channels[index];
+    int i;
+    memset(channel, 0, sizeof(*channel));
+    snprintf(channel->channel_id, sizeof(channel->channel_id), "%s", config->channel_id);
+    snprintf(channel->name, sizeof(channel->name), "%s", safe_str(config->name, ctx->config.device_name));
+    channel->fps = (config->fps > 0) ? config->fps : ctx->config.fps;
+    channel->bitrate = (config->bitrate > 0) ? config->bitrate : ctx->config.bitrate;
+    channel->media_port = ctx->config.media_port + index * 2 * GB28181_MAX_MEDIA_SESSIONS;
+    for (i = 0; i < GB28181_MAX_MEDIA_SESSIONS; ++i)
+    {
+        reset_media_session(&channel->media_sessions[i]);
+        reset_session_egress(ctx, channel, i);
+        channel->egress_cid[i] = -1;
+    }
+    gb28181_ps_muxer_init(&channel->ps_muxer);
+    init_channel_nack(ctx, channel);
+    init_channel_fec(ctx, channel);
+    channel->in_use = 1;
+}
+
 /*
  * 初始化 GB28181 设备模块。
  * 若 external_media_input=1，将跳过 V4L2/MPP 初始化与媒体线程启动。
  */
 int gb28181_device_init(Gb28181DeviceCtx *ctx, const Gb28181DeviceConfig *config)
 {
+    Gb28181ChannelConfig channel0;
     int use_rport = 1;
     int udp_keepalive = 25;
     if (!ctx)
     {
-        fprintf(stderr, "[GB28181][ERROR] gb28181_device_init ctx is NULL\n");
+        GB28181_LOGE("[GB28181][ERROR] gb28181_device_init ctx is NULL\n");
         return -1;
     }
     memset(ctx, 0, sizeof(*ctx));
     fill_default_config(&ctx->config, config);
+    gb28181_log_set_level(gb28181_log_parse_level(ctx->config.log_level));
     /*
      * external_media_input=1: 由外部模块提供 H264（例如 mediaGateway 的共享编码输出）；
      * external_media_input=0: 本模块自管 V4L2 + MPP。
@@ -1353,15 +2069,42 @@ int gb28181_device_init(Gb28181DeviceCtx *ctx, const Gb28181DeviceConfig *config
         ctx->encoder = (MppEncoderCtx *)calloc(1, sizeof(MppEncoderCtx));
         if (!ctx->capture || !ctx->encoder)
         {
-            fprintf(stderr, "[GB28181][ERROR] gb28181_device_init alloc capture/encoder failed\n");
+            GB28181_LOGE("[GB28181][ERROR] gb28181_device_init alloc capture/encoder failed\n");
             gb28181_device_deinit(ctx);
             return -1;
         }
     }
     pthread_mutex_init(&ctx->session_lock, NULL);
     pthread_cond_init(&ctx->session_cond, NULL);
+    pthread_cond_init(&ctx->send_done_cond, NULL);
     ctx->sync_ready = 1;
-    reset_media_session(&ctx->media_session);
+    memset(&channel0, 0, sizeof(channel0));
+    channel0.channel_id = ctx->config.channel_id;
+    channel0.name = ctx->config.channel_name;
+    channel0.fps = ctx->config.fps;
+    channel0.bitrate = ctx->config.bitrate;
+    init_channel(ctx, 0, &channel0);
+    if (ctx->config.rtp_nack)
+    {
+        GB28181_LOGI("[GB28181] rtp nack %s history_kb=%d entries=%d\n",
+                     ctx->channels[0].nack_enabled ? "enabled" : "alloc failed, disabled",
+                     ctx->config.rtp_nack_history_kb, GB28181_NACK_HISTORY_ENTRIES);
+    }
+    if (ctx->config.rtp_rtcp)
+        GB28181_LOGI("[GB28181] rtcp sender reports enabled interval_ms=%d\n", ctx->config.rtp_rtcp_interval_ms);
+    if (ctx->config.rtp_fec)
+    {
+        const MediaRtpFecConfig *fec = &ctx->channels[0].fec.config;
+        GB28181_LOGI("[GB28181] rtp fec %s payload_type=%d key_percent=%d delta_percent=%d\n",
+                     ctx->channels[0].fec_enabled ? "enabled" : "alloc failed, disabled",
+                     fec->payload_type, fec->key_percent, fec->delta_percent);
+    }
+    if (ctx->config.rtp_pacing)
+    {
+        const MediaRtpPacerConfig *pacing = &ctx->channels[0].rtp_egress[0].pacer.config;
+        GB28181_LOGI("[GB28181] rtp pacing enabled bitrate=%d fps=%d rate_percent=%d burst_bytes=%d spread_percent=%d\n",
+                     ctx->config.bitrate, ctx->config.fps, pacing->rate_percent, pacing->burst_bytes, pacing->spread_percent);
+    }
     ctx->rid = -1;
     ctx->xml_sn = 1;
     ctx->next_register_retry_ms = get_now_ms();
@@ -1370,7 +2113,7 @@ int gb28181_device_init(Gb28181DeviceCtx *ctx, const Gb28181DeviceConfig *config
     {
         if (init_media_modules(ctx) != 0)
         {
-            fprintf(stderr, "[GB28181][ERROR] gb28181_device_init init_media_modules failed\n");
+            GB28181_LOGE("[GB28181][ERROR] gb28181_device_init init_media_modules failed\n");
             gb28181_device_deinit(ctx);
             return -1;
         }
@@ -1378,13 +2121,13 @@ int gb28181_device_init(Gb28181DeviceCtx *ctx, const Gb28181DeviceConfig *config
     ctx->sip_context = eXosip_malloc();
     if (!ctx->sip_context)
     {
-        fprintf(stderr, "[GB28181][ERROR] gb28181_device_init eXosip_malloc failed\n");
+        GB28181_LOGE("[GB28181][ERROR] gb28181_device_init eXosip_malloc failed\n");
         gb28181_device_deinit(ctx);
         return -1;
     }
     if (eXosip_init(ctx->sip_context) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] gb28181_device_init eXosip_init failed\n");
+        GB28181_LOGE("[GB28181][ERROR] gb28181_device_init eXosip_init failed\n");
         gb28181_device_deinit(ctx);
         return -1;
     }
@@ -1393,8 +2136,8 @@ int gb28181_device_init(Gb28181DeviceCtx *ctx, const Gb28181DeviceConfig *config
     eXosip_set_option(ctx->sip_context, EXOSIP_OPT_SET_HEADER_USER_AGENT, ctx->config.user_agent);
     if (eXosip_listen_addr(ctx->sip_context, IPPROTO_UDP, ctx->config.bind_ip, ctx->config.local_sip_port, AF_INET, 0) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] gb28181_device_init eXosip_listen_addr failed bind=%s:%d\n",
-                ctx->config.bind_ip, ctx->config.local_sip_port);
+        GB28181_LOGE("[GB28181][ERROR] gb28181_device_init eXosip_listen_addr failed bind=%s:%d\n",
+                     ctx->config.bind_ip, ctx->config.local_sip_port);
         gb28181_device_deinit(ctx);
         return -1;
     }
@@ -1408,7 +2151,7 @@ int gb28181_device_init(Gb28181DeviceCtx *ctx, const Gb28181DeviceConfig *config
     {
         if (pthread_create(&ctx->media_thread, NULL, media_thread_main, ctx) != 0)
         {
-            fprintf(stderr, "[GB28181][ERROR] gb28181_device_init pthread_create media_thread failed\n");
+            GB28181_LOGE("[GB28181][ERROR] gb28181_device_init pthread_create media_thread failed\n");
             gb28181_device_deinit(ctx);
             return -1;
         }
@@ -1416,27 +2159,90 @@ int gb28181_device_init(Gb28181DeviceCtx *ctx, const Gb28181DeviceConfig *config
     }
     if (send_register_request(ctx, ctx->config.register_expires) != 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] gb28181_device_init initial register failed expires=%d\n",
-                ctx->config.register_expires);
+        GB28181_LOGE("[GB28181][ERROR] gb28181_device_init initial register failed expires=%d\n",
+                     ctx->config.register_expires);
         gb28181_device_deinit(ctx);
         return -1;
     }
     ctx->next_register_retry_ms = get_now_ms() + get_register_refresh_interval_ms(ctx);
-    printf("[GB28181] start server=%s:%d device=%s domain=%s bind=%s:%d contact_ip=%s media_ip=%s:%d fps=%d bitrate=%d gop=%d\n",
-           ctx->config.server_ip, ctx->config.server_port, ctx->config.device_id, ctx->config.server_domain,
-           ctx->config.bind_ip, ctx->config.local_sip_port, ctx->config.sip_contact_ip,
-           ctx->config.media_ip, ctx->config.media_port, ctx->config.fps, ctx->config.bitrate, ctx->config.gop);
+    GB28181_LOGI("[GB28181] start server=%s:%d device=%s channel=%s domain=%s bind=%s:%d contact_ip=%s media_ip=%s:%d fps=%d bitrate=%d gop=%d\n",
+                 ctx->config.server_ip, ctx->config.server_port, ctx->config.device_id, ctx->config.channel_id, ctx->config.server_domain,
+                 ctx->config.bind_ip, ctx->config.local_sip_port, ctx->config.sip_contact_ip,
+                 ctx->config.media_ip, ctx->config.media_port, ctx->config.fps, ctx->config.bitrate, ctx->config.gop);
     return 0;
 }
 
+/* 运行期挂入通道：占第一个空闲下标，通道 ID 重复时拒绝。 */
+int gb28181_device_add_channel(Gb28181DeviceCtx *ctx, const Gb28181ChannelConfig *channel)
+{
+    int index = -1;
+    int c;
+    if (!ctx || !ctx->sync_ready || !channel || !channel->channel_id || channel->channel_id[0] == '\0')
+    {
+        GB28181_LOGE("[GB28181][ERROR] gb28181_device_add_channel invalid args\n");
+        return -1;
+    }
+    pthread_mutex_lock(&ctx->session_lock);
+    if (find_channel(ctx, channel->channel_id) >= 0)
+    {
+        pthread_mutex_unlock(&ctx->session_lock);
+        GB28181_LOGE("[GB28181][ERROR] gb28181_device_add_channel duplicate channel id=%s device=%s\n",
+                     channel->channel_id, ctx->config.device_id);
+        return -1;
+    }
+    for (c = 0; c < GB28181_MAX_CHANNELS; ++c)
+    {
+        if (!ctx->channels[c].in_use)
+        {
+            index = c;
+            break;
+        }
+    }
+    if (index >= 0)
+        init_channel(ctx, index, channel);
+    pthread_mutex_unlock(&ctx->session_lock);
+    if (index < 0)
+    {
+        GB28181_LOGE("[GB28181][ERROR] gb28181_device_add_channel channel table full max=%d id=%s\n",
+                     GB28181_MAX_CHANNELS, channel->channel_id);
+        return -1;
+    }
+    GB28181_LOGI("[GB28181] channel added index=%d id=%s device=%s media_port=%d fps=%d bitrate=%d\n",
+                 index, ctx->channels[index].channel_id, ctx->config.device_id, ctx->channels[index].media_port,
+                 ctx->channels[index].fps, ctx->channels[index].bitrate);
+    return index;
+}
+
+/* 摘除通道：关闭会话后释放发送器，通道下标可被后续 add_channel 复用。 */
+void gb28181_device_remove_channel(Gb28181DeviceCtx *ctx, int channel)
+{
+    Gb28181Channel *ch = NULL;
+    int i;
+    if (!ctx || !ctx->sync_ready)
+        return;
+    pthread_mutex_lock(&ctx->session_lock);
+    ch = get_channel(ctx, channel);
+    if (ch)
+    {
+        close_channel_sessions(ctx, ch);
+        ch->in_use = 0;
+        for (i = 0; i < GB28181_MAX_MEDIA_SESSIONS; ++i)
+            media_rtp_egress_deinit(&ch->rtp_egress[i]);
+        release_channel_nack(ch);
+        release_channel_fec(ch);
+        GB28181_LOGI("[GB28181] channel removed index=%d id=%s\n", channel, ch->channel_id);
+    }
+    pthread_mutex_unlock(&ctx->session_lock);
+}
+
 /* SIP 主循环（阻塞），持续处理事件与周期任务。 */
 int gb28181_device_run(Gb28181DeviceCtx *ctx)
 {
     if (!ctx || !ctx->sip_context || !ctx->running)
     {
-        fprintf(stderr, "[GB28181][ERROR] gb28181_device_run invalid state sip=%p running=%d\n",
-                (void *)(ctx ? ctx->sip_context : NULL),
-                ctx ? ctx->running : 0);
+        GB28181_LOGE("[GB28181][ERROR] gb28181_device_run invalid state sip=%p running=%d\n",
+                     (void *)(ctx ? ctx->sip_context : NULL),
+                     ctx ? ctx->running : 0);
         return -1;
     }
     while (ctx->running)
@@ -1478,99 +2284,134 @@ int gb28181_device_run(Gb28181DeviceCtx *ctx)
  * 会在函数内快照当前会话，避免长时间持锁执行网络发送。
  */
 int gb28181_device_send_h264(Gb28181DeviceCtx *ctx,
+                             int channel,
                              const uint8_t *h264_data,
                              size_t h264_len,
                              int is_key_frame,
                              uint64_t pts_us)
 {
-    Gb28181MediaSession session_snapshot;
-    Gb28181Buffer ps_buffer;
+    Gb28181Channel *ch = NULL;
     uint32_t rtp_timestamp = 0;
+    int targets = 0;
+    int i;
 
     if (!ctx || !h264_data || h264_len == 0)
     {
-        fprintf(stderr, "[GB28181][ERROR] gb28181_device_send_h264 invalid args len=%zu\n", h264_len);
+        GB28181_LOGE("[GB28181][ERROR] gb28181_device_send_h264 invalid args len=%zu\n", h264_len);
         return -1;
     }
 
     /*
-     * 发送前先快照会话，避免后续 PS 封装与 RTP 发送阶段长期占用锁，
-     * 减少与 SIP 线程（会话切换）的竞争。
+     * 先在锁内确认有会话要这一帧（新会话/丢过帧的会话只收关键帧），
+     * 没有目标时连 PS 封装都省掉；真正的切片发送在 send_frame_to_sessions 里不持锁进行。
      */
     pthread_mutex_lock(&ctx->session_lock);
-    if (!ctx->media_session.active || !ctx->media_session.established || ctx->media_session.rtp_socket_fd < 0)
+    ch = get_channel(ctx, channel);
+    if (!ch)
     {
         pthread_mutex_unlock(&ctx->session_lock);
         return 0;
     }
-    if (ctx->pending_force_idr && !is_key_frame)
+    refresh_media_targets(ctx, ch);
+    for (i = 0; i < GB28181_MAX_MEDIA_SESSIONS; ++i)
     {
-        pthread_mutex_unlock(&ctx->session_lock);
-        return 0;
+        const Gb28181MediaSession *session = &ch->media_sessions[i];
+        if (session->active && session->established && media_transport_ready(session) &&
+            (!session->wait_keyframe || is_key_frame))
+            targets++;
     }
-    if (ctx->pending_force_idr && is_key_frame)
+    if (ch->pending_force_idr && is_key_frame)
     {
-        ctx->pending_force_idr = 0;
-        ctx->external_idr_requested = 0;
-        printf("[GB28181] pending IDR request satisfied by upstream keyframe\n");
+        ch->pending_force_idr = 0;
+        ch->external_idr_requested = 0;
+        GB28181_LOGI("[GB28181] pending IDR request satisfied by upstream keyframe channel=%s\n", ch->channel_id);
     }
-    session_snapshot = ctx->media_session;
     pthread_mutex_unlock(&ctx->session_lock);
+    if (targets == 0)
+        return 0;
 
-    if (gb_buffer_init(&ps_buffer, GB28181_PS_BUFFER_INIT_SIZE) != 0)
+    /* external 模式下每个通道只有对应 sink 的发送线程调用本函数，通道的 ps_muxer 和各会话 egress 不需要额外加锁。 */
+    if (build_ps_frame(h264_data, h264_len, is_key_frame, pts_us, &ch->ps_muxer) != 0)
+        return 0;
+
+    rtp_timestamp = (uint32_t)((pts_us * 90ULL / 1000ULL) & 0xFFFFFFFFU);
+    send_frame_to_sessions(ctx, ch, is_key_frame, rtp_timestamp, pts_us);
+    return 0;
+}
+
+int gb28181_device_has_media_session(Gb28181DeviceCtx *ctx, int channel)
+{
+    Gb28181Channel *ch = NULL;
+    int active = 0;
+    int i;
+    if (!ctx)
+        return 0;
+
+    pthread_mutex_lock(&ctx->session_lock);
+    ch = get_channel(ctx, channel);
+    for (i = 0; ch && i < GB28181_MAX_MEDIA_SESSIONS; ++i)
     {
-        fprintf(stderr, "[GB28181][ERROR] gb28181_device_send_h264 ps buffer init failed\n");
-        return -1;
+        if (ch->media_sessions[i].active)
+            active = 1;
     }
-    if (build_ps_frame(h264_data, h264_len, is_key_frame, pts_us, &ps_buffer) != 0)
-    {
-        gb_buffer_deinit(&ps_buffer);
+    pthread_mutex_unlock(&ctx->session_lock);
+    return active ? 1 : 0;
+}
+
+int gb28181_device_has_live_session(Gb28181DeviceCtx *ctx, int channel)
+{
+    Gb28181Channel *ch = NULL;
+    int live = 0;
+    int i;
+    if (!ctx)
         return 0;
-    }
 
-    rtp_timestamp = (uint32_t)((pts_us * 90ULL / 1000ULL) & 0xFFFFFFFFU);
-    if (send_ps_over_rtp(&session_snapshot, ps_buffer.data, ps_buffer.size, rtp_timestamp) != 0)
+    pthread_mutex_lock(&ctx->session_lock);
+    ch = get_channel(ctx, channel);
+    for (i = 0; ch && i < GB28181_MAX_MEDIA_SESSIONS; ++i)
     {
-        gb_buffer_deinit(&ps_buffer);
-        fprintf(stderr, "[GB28181][ERROR] gb28181_device_send_h264 send_ps_over_rtp failed cid=%d size=%zu\n",
-                session_snapshot.cid,
-                ps_buffer.size);
-        /* 发送失败时主动关闭当前会话，促使上层重新拉起点播。 */
-        pthread_mutex_lock(&ctx->session_lock);
-        if (ctx->media_session.cid == session_snapshot.cid)
-        {
-            close_rtp_socket(&ctx->media_session);
-            reset_media_session(&ctx->media_session);
-        }
-        pthread_mutex_unlock(&ctx->session_lock);
-        return -1;
+        const Gb28181MediaSession *session = &ch->media_sessions[i];
+        if (session->active && session->established && !session->wait_keyframe)
+            live = 1;
     }
-    gb_buffer_deinit(&ps_buffer);
+    pthread_mutex_unlock(&ctx->session_lock);
+    return live;
+}
+
+void gb28181_device_update_channel_rate(Gb28181DeviceCtx *ctx, int channel, int bitrate, int fps)
+{
+    Gb28181Channel *ch = NULL;
+    if (!ctx || bitrate <= 0 || fps <= 0)
+        return;
 
     pthread_mutex_lock(&ctx->session_lock);
-    if (ctx->media_session.active && ctx->media_session.established && ctx->media_session.cid == session_snapshot.cid)
+    ch = get_channel(ctx, channel);
+    if (ch && (ch->bitrate != bitrate || ch->fps != fps))
     {
-        ctx->media_session.rtp_sequence = session_snapshot.rtp_sequence;
-        ctx->media_session.last_rtp_timestamp = session_snapshot.last_rtp_timestamp;
+        ch->bitrate = bitrate;
+        ch->fps = fps;
+        ch->rate_changed = 1;
+        GB28181_LOGI("[GB28181] channel rate updated channel=%s bitrate=%d fps=%d\n", ch->channel_id, bitrate, fps);
     }
     pthread_mutex_unlock(&ctx->session_lock);
-    return 0;
 }
 
-int gb28181_device_consume_external_idr_request(Gb28181DeviceCtx *ctx)
+int gb28181_device_consume_external_idr_request(Gb28181DeviceCtx *ctx, int channel)
 {
+    Gb28181Channel *ch = NULL;
     int need_request = 0;
     if (!ctx)
         return 0;
 
     pthread_mutex_lock(&ctx->session_lock);
-    if (ctx->config.external_media_input &&
-        ctx->media_session.active &&
-        ctx->media_session.established &&
-        ctx->pending_force_idr &&
-        !ctx->external_idr_requested)
-    {
-        ctx->external_idr_requested = 1;
+    ch = get_channel(ctx, channel);
+    if (ch &&
+        ctx->config.external_media_input &&
+        has_established_session(ch) &&
+        ch->pending_force_idr &&
+        !ch->external_idr_requested)
+    {
+        ch->external_idr_requested = 1;
         need_request = 1;
     }
     pthread_mutex_unlock(&ctx->session_lock);
@@ -1594,6 +2435,8 @@ void gb28181_device_stop(Gb28181DeviceCtx *ctx)
 /* 释放模块资源。 */
 void gb28181_device_deinit(Gb28181DeviceCtx *ctx)
 {
+    int c;
+    int i;
     if (!ctx)
         return;
     gb28181_device_stop(ctx);
@@ -1603,7 +2446,15 @@ void gb28181_device_deinit(Gb28181DeviceCtx *ctx)
         ctx->media_thread = 0;
         ctx->media_thread_started = 0;
     }
-    stop_media_session(ctx);
+    stop_media_session(ctx, -1);
+    for (c = 0; c < GB28181_MAX_CHANNELS; ++c)
+    {
+        for (i = 0; i < GB28181_MAX_MEDIA_SESSIONS; ++i)
+            media_rtp_egress_deinit(&ctx->channels[c].rtp_egress[i]);
+        release_channel_nack(&ctx->channels[c]);
+        release_channel_fec(&ctx->channels[c]);
+        ctx->channels[c].in_use = 0;
+    }
     if (ctx->sip_context)
     {
         eXosip_quit(ctx->sip_context);
@@ -1626,6 +2477,7 @@ void gb28181_device_deinit(Gb28181DeviceCtx *ctx)
     if (ctx->sync_ready)
     {
         pthread_cond_destroy(&ctx->session_cond);
+        pthread_cond_destroy(&ctx->send_done_cond);
         pthread_mutex_destroy(&ctx->session_lock);
         ctx->sync_ready = 0;
     }
@@ -1634,17 +2486,32 @@ void gb28181_device_deinit(Gb28181DeviceCtx *ctx)
     ctx->rid = -1;
 }
 
-/* 读取当前会话快照（线程安全）。 */
-void gb28181_device_get_media_session(const Gb28181DeviceCtx *ctx, Gb28181MediaSession *session)
+/* 读取通道第一个活跃会话的快照（线程安全）。 */
+void gb28181_device_get_media_session(const Gb28181DeviceCtx *ctx, int channel, Gb28181MediaSession *session)
 {
     if (!ctx || !session)
         return;
-    if (!ctx->sync_ready)
+    reset_media_session(session);
+    gb28181_device_get_media_sessions(ctx, channel, session, 1);
+}
+
+/* 读取通道全部活跃会话的快照（线程安全）。 */
+int gb28181_device_get_media_sessions(const Gb28181DeviceCtx *ctx, int channel, Gb28181MediaSession *sessions, int max_sessions)
+{
+    const Gb28181Channel *ch = NULL;
+    int count = 0;
+    int i;
+    if (!ctx || !sessions || max_sessions <= 0 || channel < 0 || channel >= GB28181_MAX_CHANNELS)
+        return 0;
+    if (ctx->sync_ready)
+        pthread_mutex_lock((pthread_mutex_t *)&ctx->session_lock);
+    ch = &ctx->channels[channel];
+    for (i = 0; ch->in_use && i < GB28181_MAX_MEDIA_SESSIONS && count < max_sessions; ++i)
     {
-        *session = ctx->media_session;
-        return;
+        if (ch->media_sessions[i].active)
+            sessions[count++] = ch->media_sessions[i];
     }
-    pthread_mutex_lock((pthread_mutex_t *)&ctx->session_lock);
-    *session = ctx->media_session;
-    pthread_mutex_unlock((pthread_mutex_t *)&ctx->session_lock);
+    if (ctx->sync_ready)
+        pthread_mutex_unlock((pthread_mutex_t *)&ctx->session_lock);
+    return count;
 }
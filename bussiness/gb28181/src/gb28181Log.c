@@ -0,0 +1,27 @@
+#include "gb28181Log.h"
+
+#include <strings.h>
+
+int g_gb28181_log_level = GB28181_LOG_LEVEL_INFO;
+
+void gb28181_log_set_level(int level)
+{
+    if (level < GB28181_LOG_LEVEL_DEBUG || level > GB28181_LOG_LEVEL_OFF)
+        level = GB28181_LOG_LEVEL_INFO;
+    g_gb28181_log_level = level;
+}
+
+int gb28181_log_parse_level(const char *name)
+{
+    if (!name)
+        return GB28181_LOG_LEVEL_INFO;
+    if (strcasecmp(name, "debug") == 0)
+        return GB28181_LOG_LEVEL_DEBUG;
+    if (strcasecmp(name, "warn") == 0)
+        return GB28181_LOG_LEVEL_WARN;
+    if (strcasecmp(name, "error") == 0)
+        return GB28181_LOG_LEVEL_ERROR;
+    if (strcasecmp(name, "off") == 0)
+        return GB28181_LOG_LEVEL_OFF;
+    return GB28181_LOG_LEVEL_INFO;
+}
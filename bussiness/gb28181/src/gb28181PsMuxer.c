@@ -0,0 +1,248 @@
+#include "gb28181PsMuxer.h"
+#include "gb28181Log.h"
+#include "mediaPacket.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define GB28181_PS_STREAM_ID_VIDEO 0xE0
+
+/*
+ * PS 封装按“头部暂存 + 负载引用”的方式组织一帧：
+ * pack header、system header、PSM、每个 PES 头和补的起始码写进 headers 暂存区，
+ * NALU 负载不拷贝，只记录指向原始编码数据的分段。分包时把分段切成 RTP 负载大小的 iovec。
+ */
+
+/*
+ * 用共享的 Annex-B 拆分器解析一帧，输出 NALU 列表。
+ * 分段数组按 max_nalus 定长，超出时整帧报错，不能静默丢掉后面的 NALU。
+ */
+static int parse_annexb_nalus(const uint8_t *annexb_data, size_t annexb_len, Gb28181PsNalu *nalus, size_t max_nalus, size_t *nalu_count)
+{
+    MediaNaluView nalu;
+    size_t pos = 0;
+    size_t count = 0;
+    *nalu_count = 0;
+    while (media_annexb_next_nalu(annexb_data, annexb_len, &pos, &nalu))
+    {
+        if (count >= max_nalus)
+        {
+            GB28181_LOGE("[GB28181][ERROR] parse_annexb_nalus too many NALUs max=%zu len=%zu\n", max_nalus, annexb_len);
+            return -1;
+        }
+        nalus[count].offset = (size_t)(nalu.data - annexb_data);
+        nalus[count].length = nalu.size;
+        nalus[count].type = nalu.data[0] & 0x1F;
+        count++;
+    }
+    *nalu_count = count;
+    if (count <= 0)
+    {
+        GB28181_LOGE("[GB28181][ERROR] parse_annexb_nalus no valid NALU found len=%zu\n", annexb_len);
+        return -1;
+    }
+    return 0;
+}
+
+/* 追加一个分段；与上一段在内存中首尾相接时直接合并。 */
+static void ps_add_segment(Gb28181PsMuxer *muxer, const uint8_t *data, size_t length)
+{
+    Gb28181PsSegment *last = NULL;
+    if (length == 0)
+        return;
+    if (muxer->segment_count > 0)
+    {
+        last = &muxer->segments[muxer->segment_count - 1];
+        if (last->data + last->length == data)
+        {
+            last->length += length;
+            muxer->frame_len += length;
+            return;
+        }
+    }
+    muxer->segments[muxer->segment_count].data = data;
+    muxer->segments[muxer->segment_count].length = length;
+    muxer->segment_count++;
+    muxer->frame_len += length;
+}
+
+/* 在头部暂存区写入一段固定字节并登记为分段。 */
+static int ps_add_header(Gb28181PsMuxer *muxer, const uint8_t *bytes, size_t length)
+{
+    uint8_t *dst = NULL;
+    if (muxer->headers_len + length > sizeof(muxer->headers))
+    {
+        GB28181_LOGE("[GB28181][ERROR] ps_add_header scratch overflow used=%zu need=%zu\n", muxer->headers_len, length);
+        return -1;
+    }
+    dst = muxer->headers + muxer->headers_len;
+    memcpy(dst, bytes, length);
+    muxer->headers_len += length;
+    ps_add_segment(muxer, dst, length);
+    return 0;
+}
+
+/* 写入 PS pack header。 */
+static int ps_write_pack_header(Gb28181PsMuxer *muxer, uint64_t scr_90k)
+{
+    uint8_t pack[14];
+    uint64_t scr = scr_90k & 0x1FFFFFFFFULL;
+    pack[0] = 0x00;
+    pack[1] = 0x00;
+    pack[2] = 0x01;
+    pack[3] = 0xBA;
+    pack[4] = (uint8_t)(0x44 | ((scr >> 27) & 0x38) | ((scr >> 28) & 0x03));
+    pack[5] = (uint8_t)(scr >> 20);
+    pack[6] = (uint8_t)(((scr >> 12) & 0xF8) | 0x04 | ((scr >> 13) & 0x03));
+    pack[7] = (uint8_t)(scr >> 5);
+    pack[8] = (uint8_t)(((scr << 3) & 0xF8) | 0x04);
+    pack[9] = 0x01;
+    pack[10] = 0x89;
+    pack[11] = 0xC3;
+    pack[12] = 0xF8;
+    pack[13] = 0x00;
+    return ps_add_header(muxer, pack, sizeof(pack));
+}
+
+/* 写入 PS system header（关键帧前附带）。 */
+static int ps_write_system_header(Gb28181PsMuxer *muxer)
+{
+    static const uint8_t system_header[] = {0x00, 0x00, 0x01, 0xBB, 0x00, 0x0C, 0x80, 0x04, 0x04, 0xE1, 0x7F, 0xE0, 0xE0, 0xE8, 0xC0, 0x20, 0xBD, 0xE0};
+    return ps_add_header(muxer, system_header, sizeof(system_header));
+}
+
+/* 写入 PS program stream map（关键帧前附带）。 */
+static int ps_write_program_stream_map(Gb28181PsMuxer *muxer)
+{
+    static const uint8_t psm[] = {0x00, 0x00, 0x01, 0xBC, 0x00, 0x12, 0xE0, 0xFF, 0x00, 0x00, 0x00, 0x08, 0x1B, 0xE0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x45, 0xBD, 0xDC, 0xF4};
+    return ps_add_header(muxer, psm, sizeof(psm));
+}
+
+/* 写入 PTS 字段（5 字节格式）。 */
+static void ps_write_pts_field(uint8_t *dst, uint8_t prefix, uint64_t pts)
+{
+    uint64_t value = pts & 0x1FFFFFFFFULL;
+    dst[0] = (uint8_t)((prefix << 4) | (((value >> 30) & 0x07) << 1) | 0x01);
+    dst[1] = (uint8_t)(value >> 22);
+    dst[2] = (uint8_t)((((value >> 15) & 0x7F) << 1) | 0x01);
+    dst[3] = (uint8_t)(value >> 7);
+    dst[4] = (uint8_t)(((value & 0x7F) << 1) | 0x01);
+}
+
+/*
+ * 写入视频 PES 包头，负载只登记引用。
+ * 为提升下游 PS 解复用兼容性，每个 NAL 前补 00 00 00 01 起始码，与包头一起写入暂存区。
+ */
+static int ps_write_video_pes(Gb28181PsMuxer *muxer, const uint8_t *payload, size_t payload_len, uint64_t pts_90k)
+{
+    uint8_t header[18];
+    size_t pes_packet_length = payload_len + 4 + 8;
+    if (pes_packet_length > 0xFFFF)
+        pes_packet_length = 0;
+    memset(header, 0, sizeof(header));
+    header[0] = 0x00;
+    header[1] = 0x00;
+    header[2] = 0x01;
+    header[3] = GB28181_PS_STREAM_ID_VIDEO;
+    header[4] = (uint8_t)((pes_packet_length >> 8) & 0xFF);
+    header[5] = (uint8_t)(pes_packet_length & 0xFF);
+    header[6] = 0x80;
+    header[7] = 0x80;
+    header[8] = 0x05;
+    ps_write_pts_field(header + 9, 0x02, pts_90k);
+    header[17] = 0x01;
+    if (ps_add_header(muxer, header, sizeof(header)) != 0)
+        return -1;
+    ps_add_segment(muxer, payload, payload_len);
+    return 0;
+}
+
+void gb28181_ps_muxer_init(Gb28181PsMuxer *muxer)
+{
+    if (!muxer)
+        return;
+    memset(muxer, 0, sizeof(*muxer));
+}
+
+int gb28181_ps_muxer_build(Gb28181PsMuxer *muxer, const uint8_t *annexb_data, size_t annexb_len, int is_key_frame, uint64_t pts_90k)
+{
+    size_t i = 0;
+    if (!muxer || !annexb_data || annexb_len == 0)
+    {
+        GB28181_LOGE("[GB28181][ERROR] gb28181_ps_muxer_build invalid args len=%zu\n", annexb_len);
+        return -1;
+    }
+    muxer->headers_len = 0;
+    muxer->segment_count = 0;
+    muxer->frame_len = 0;
+    if (parse_annexb_nalus(annexb_data, annexb_len, muxer->nalus, GB28181_PS_MUXER_MAX_NALUS, &muxer->nalu_count) != 0)
+        return -1;
+    if (ps_write_pack_header(muxer, pts_90k) != 0)
+        return -1;
+    if (is_key_frame)
+    {
+        if (ps_write_system_header(muxer) != 0 || ps_write_program_stream_map(muxer) != 0)
+            return -1;
+    }
+    /* 每个 NALU 独立作为一个 PES，逻辑简单，也能规避大帧导致的 PES 长度上限问题。 */
+    for (i = 0; i < muxer->nalu_count; ++i)
+    {
+        muxer->nalu_types[muxer->nalus[i].type & 0x1F]++;
+        if (muxer->nalus[i].type == 9)
+            continue;
+        if (ps_write_video_pes(muxer, annexb_data + muxer->nalus[i].offset, muxer->nalus[i].length, pts_90k) != 0)
+        {
+            GB28181_LOGE("[GB28181][ERROR] gb28181_ps_muxer_build write video PES failed nalu_type=%u len=%zu\n",
+                         (unsigned int)muxer->nalus[i].type,
+                         muxer->nalus[i].length);
+            return -1;
+        }
+    }
+    muxer->frames++;
+    if (is_key_frame)
+        muxer->key_frames++;
+    muxer->ps_bytes += muxer->frame_len;
+    muxer->copied_bytes += muxer->headers_len;
+    return 0;
+}
+
+int gb28181_ps_muxer_packetize(Gb28181PsMuxer *muxer, size_t max_payload, Gb28181PsPacketFn fn, void *user)
+{
+    struct iovec iov[GB28181_PS_MUXER_MAX_PACKET_IOV];
+    size_t seg_idx = 0;
+    size_t seg_off = 0;
+    size_t done = 0;
+    if (!muxer || !fn || max_payload == 0 || muxer->frame_len == 0)
+    {
+        GB28181_LOGE("[GB28181][ERROR] gb28181_ps_muxer_packetize invalid args frame_len=%zu\n",
+                     muxer ? muxer->frame_len : 0);
+        return -1;
+    }
+    while (done < muxer->frame_len)
+    {
+        int iov_count = 0;
+        size_t payload_len = 0;
+        while (payload_len < max_payload && seg_idx < muxer->segment_count && iov_count < GB28181_PS_MUXER_MAX_PACKET_IOV)
+        {
+            const Gb28181PsSegment *seg = &muxer->segments[seg_idx];
+            size_t take = seg->length - seg_off;
+            if (take > max_payload - payload_len)
+                take = max_payload - payload_len;
+            iov[iov_count].iov_base = (void *)(seg->data + seg_off);
+            iov[iov_count].iov_len = take;
+            iov_count++;
+            payload_len += take;
+            seg_off += take;
+            if (seg_off == seg->length)
+            {
+                seg_idx++;
+                seg_off = 0;
+            }
+        }
+        done += payload_len;
+        muxer->packets++;
+        if (fn(user, iov, iov_count, payload_len, (done >= muxer->frame_len) ? 1 : 0) != 0)
+            return -1;
+    }
+    return 0;
+}
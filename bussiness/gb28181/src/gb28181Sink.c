@@ -11,18 +11,35 @@
 /*
  * GB28181 sink 的职责：
  * 1. 作为 mediaGateway 的一个输出通道（MediaSink）接收编码后的视频包；
- * 2. 将 MediaPacket(H264 Annex-B) 转交给 gb28181Device 模块封装并发送；
- * 3. 管理 gb28181Device 的生命周期与 SIP 事件线程。
+ * 2. 将 MediaPacket(H264 Annex-B) 转交给 gb28181Device 模块对应通道封装并发送；
+ * 3. 管理共享 gb28181Device 的生命周期与 SIP 事件线程。
+ *
+ * 同一本地 SIP 端口上的多个 sink（主/子码流）共用一个 gb28181Device：
+ * 只有一个 eXosip 上下文、一个 SIP 线程、一次注册和一路 Keepalive，
+ * 每个 sink 只是该设备下的一个通道。第一个启动的 sink 创建设备，最后一个停止的 sink 释放设备。
  */
 
+#define GB28181_SINK_MAX_DEVICES 4
+
 typedef struct {
-    Gb28181SinkConfig config;     /* sink 配置副本，避免外部临时配置对象失效。 */
     Gb28181DeviceCtx device_ctx;  /* 底层 GB28181 设备模块上下文。 */
     pthread_t sip_thread;         /* 运行 gb28181_device_run() 的线程句柄。 */
     int sip_thread_started;       /* SIP 线程是否已创建成功。 */
+    int refs;                     /* 挂在该设备上的 sink 数。 */
+    char bind_ip[64];             /* 设备 SIP 监听地址，与端口一起作为共享键。 */
+    int local_sip_port;           /* 设备 SIP 监听端口。 */
+} Gb28181SharedDevice;
+
+typedef struct {
+    Gb28181SinkConfig config;     /* sink 配置副本，避免外部临时配置对象失效。 */
+    Gb28181SharedDevice *device;  /* 所挂的共享设备。 */
+    int channel;                  /* 本 sink 在设备中的通道下标。 */
     int started;                  /* sink 是否已进入启动完成状态。 */
 } Gb28181SinkImpl;
 
+static pthread_mutex_t g_shared_device_lock = PTHREAD_MUTEX_INITIALIZER;
+static Gb28181SharedDevice *g_shared_devices[GB28181_SINK_MAX_DEVICES];
+
 /* 字符串兜底：value 为空时返回 fallback。 */
 static const char *safe_str(const char *value, const char *fallback) {
     return (value && value[0] != '\0') ? value : fallback;
@@ -58,6 +75,7 @@ static void fill_default_config(Gb28181SinkConfig *dst, const Gb28181SinkConfig
     dst->model = safe_str(dst->model, "RKMediaGateway");
     dst->firmware = safe_str(dst->firmware, "1.0.0");
     dst->channel_id = safe_str(dst->channel_id, dst->device_id);
+    dst->channel_name = safe_str(dst->channel_name, dst->device_name);
     dst->user_agent = safe_str(dst->user_agent, "RKMediaGateway-GB28181/1.0");
 }
 
@@ -88,29 +106,174 @@ static void build_device_config(const Gb28181SinkConfig *src, Gb28181DeviceConfi
     dst->model = src->model;
     dst->firmware = src->firmware;
     dst->channel_id = src->channel_id;
+    dst->channel_name = src->channel_name;
     dst->user_agent = src->user_agent;
+    dst->rtp_gso = src->rtp_gso;
+    dst->fps = src->video_fps;
+    dst->bitrate = src->video_bitrate;
+    dst->rtp_pacing = src->rtp_pacing;
+    dst->rtp_pacing_rate_percent = src->rtp_pacing_rate_percent;
+    dst->rtp_pacing_burst_bytes = src->rtp_pacing_burst_bytes;
+    dst->rtp_pacing_spread_percent = src->rtp_pacing_spread_percent;
+    dst->rtp_nack = src->rtp_nack;
+    dst->rtp_nack_history_kb = src->rtp_nack_history_kb;
+    dst->rtp_fec = src->rtp_fec;
+    dst->rtp_fec_payload_type = src->rtp_fec_payload_type;
+    dst->rtp_fec_key_percent = src->rtp_fec_key_percent;
+    dst->rtp_fec_delta_percent = src->rtp_fec_delta_percent;
+    dst->rtp_rtcp = src->rtp_rtcp;
+    dst->rtp_rtcp_interval_ms = src->rtp_rtcp_interval_ms;
+    dst->log_level = src->log_level;
     dst->external_media_input = 1;
 }
 
 /* SIP 线程入口：阻塞运行 gb28181_device_run() 直到 stop。 */
 static void *gb28181_sink_sip_loop(void *arg) {
-    Gb28181SinkImpl *impl = (Gb28181SinkImpl *)arg;
-    if (!impl) {
+    Gb28181SharedDevice *device = (Gb28181SharedDevice *)arg;
+    if (!device) {
         return NULL;
     }
-    gb28181_device_run(&impl->device_ctx);
+    gb28181_device_run(&device->device_ctx);
     return NULL;
 }
 
+/* 创建共享设备：初始化 gb28181Device（通道 0 即本 sink 的通道）并拉起 SIP 线程。 */
+static Gb28181SharedDevice *create_shared_device(const Gb28181SinkConfig *config) {
+    Gb28181SharedDevice *device = (Gb28181SharedDevice *)calloc(1, sizeof(*device));
+    Gb28181DeviceConfig device_config;
+    int ret;
+    if (!device) {
+        fprintf(stderr, "[ERROR] create_shared_device failed: alloc\n");
+        return NULL;
+    }
+    build_device_config(config, &device_config);
+    if (gb28181_device_init(&device->device_ctx, &device_config) != 0) {
+        fprintf(stderr,
+                "[ERROR] create_shared_device failed: gb28181_device_init server=%s:%d device=%s local_sip=%d\n",
+                config->server_ip ? config->server_ip : "unknown",
+                config->server_port,
+                config->device_id ? config->device_id : "unknown",
+                config->local_sip_port);
+        free(device);
+        return NULL;
+    }
+    ret = pthread_create(&device->sip_thread, NULL, gb28181_sink_sip_loop, device);
+    if (ret != 0) {
+        fprintf(stderr, "[ERROR] create_shared_device failed: pthread_create ret=%d\n", ret);
+        gb28181_device_deinit(&device->device_ctx);
+        free(device);
+        return NULL;
+    }
+    device->sip_thread_started = 1;
+    snprintf(device->bind_ip, sizeof(device->bind_ip), "%s", config->bind_ip);
+    device->local_sip_port = config->local_sip_port;
+    return device;
+}
+
+/*
+ * 把 sink 挂到共享设备上：同一 bind_ip:local_sip_port 已有设备时作为新通道加入，
+ * 否则创建设备。设备级参数（平台地址、设备 ID、鉴权等）以第一个 sink 为准。
+ */
+static int attach_shared_device(Gb28181SinkImpl *impl) {
+    Gb28181SharedDevice *device = NULL;
+    int free_slot = -1;
+    int i;
+
+    pthread_mutex_lock(&g_shared_device_lock);
+    for (i = 0; i < GB28181_SINK_MAX_DEVICES; ++i) {
+        Gb28181SharedDevice *d = g_shared_devices[i];
+        if (!d) {
+            if (free_slot < 0) free_slot = i;
+            continue;
+        }
+        if (d->local_sip_port == impl->config.local_sip_port && strcmp(d->bind_ip, impl->config.bind_ip) == 0) {
+            device = d;
+            break;
+        }
+    }
+
+    if (device) {
+        Gb28181ChannelConfig channel;
+        memset(&channel, 0, sizeof(channel));
+        channel.channel_id = impl->config.channel_id;
+        channel.name = impl->config.channel_name;
+        channel.fps = impl->config.video_fps;
+        channel.bitrate = impl->config.video_bitrate;
+        if (strcmp(device->device_ctx.config.device_id, impl->config.device_id) != 0) {
+            printf("[GB28181] sink=%s device_id=%s ignored, joins device %s on sip port %d as a channel\n",
+                   impl->config.name, impl->config.device_id, device->device_ctx.config.device_id,
+                   device->local_sip_port);
+        }
+        impl->channel = gb28181_device_add_channel(&device->device_ctx, &channel);
+        if (impl->channel < 0) {
+            pthread_mutex_unlock(&g_shared_device_lock);
+            fprintf(stderr, "[ERROR] attach_shared_device failed: add_channel sink=%s channel=%s\n",
+                    impl->config.name, impl->config.channel_id);
+            return -1;
+        }
+    } else {
+        if (free_slot < 0) {
+            pthread_mutex_unlock(&g_shared_device_lock);
+            fprintf(stderr, "[ERROR] attach_shared_device failed: too many devices max=%d\n", GB28181_SINK_MAX_DEVICES);
+            return -1;
+        }
+        device = create_shared_device(&impl->config);
+        if (!device) {
+            pthread_mutex_unlock(&g_shared_device_lock);
+            return -1;
+        }
+        g_shared_devices[free_slot] = device;
+        impl->channel = 0;
+    }
+    device->refs++;
+    impl->device = device;
+    pthread_mutex_unlock(&g_shared_device_lock);
+    printf("[GB28181] sink=%s attached device=%s channel=%s index=%d sip_port=%d sinks_on_device=%d\n",
+           impl->config.name, device->device_ctx.config.device_id, impl->config.channel_id,
+           impl->channel, device->local_sip_port, device->refs);
+    return 0;
+}
+
+/* 摘下 sink 的通道；设备上最后一个 sink 离开时停止 SIP 线程并释放设备。 */
+static void detach_shared_device(Gb28181SinkImpl *impl) {
+    Gb28181SharedDevice *device = impl->device;
+    int i;
+    if (!device) {
+        return;
+    }
+    pthread_mutex_lock(&g_shared_device_lock);
+    device->refs--;
+    if (device->refs > 0) {
+        gb28181_device_remove_channel(&device->device_ctx, impl->channel);
+        device = NULL;
+    } else {
+        for (i = 0; i < GB28181_SINK_MAX_DEVICES; ++i) {
+            if (g_shared_devices[i] == device) g_shared_devices[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&g_shared_device_lock);
+    impl->device = NULL;
+    impl->channel = -1;
+    if (!device) {
+        return;
+    }
+
+    gb28181_device_stop(&device->device_ctx);
+    if (device->sip_thread_started) {
+        pthread_join(device->sip_thread, NULL);
+        device->sip_thread_started = 0;
+    }
+    gb28181_device_deinit(&device->device_ctx);
+    free(device);
+}
+
 /*
  * sink start：
- * 1. 初始化 gb28181Device；
- * 2. 拉起 SIP 事件线程；
- * 3. 进入 started 状态。
+ * 1. 挂到共享 gb28181Device（必要时初始化设备并拉起 SIP 事件线程）；
+ * 2. 进入 started 状态。
  */
 static int gb28181_sink_start(MediaSink *sink) {
     Gb28181SinkImpl *impl = (Gb28181SinkImpl *)sink->impl;
-    Gb28181DeviceConfig device_config;
     if (!impl) {
         fprintf(stderr, "[ERROR] gb28181_sink_start failed: impl is NULL\n");
         return -1;
@@ -118,27 +281,11 @@ static int gb28181_sink_start(MediaSink *sink) {
     if (impl->started) {
         return 0;
     }
-
-    build_device_config(&impl->config, &device_config);
-    if (gb28181_device_init(&impl->device_ctx, &device_config) != 0) {
-        fprintf(stderr,
-                "[ERROR] gb28181_sink_start failed: gb28181_device_init server=%s:%d device=%s local_sip=%d\n",
-                impl->config.server_ip ? impl->config.server_ip : "unknown",
-                impl->config.server_port,
-                impl->config.device_id ? impl->config.device_id : "unknown",
-                impl->config.local_sip_port);
+    if (attach_shared_device(impl) != 0) {
+        fprintf(stderr, "[ERROR] gb28181_sink_start failed: sink=%s device=%s channel=%s local_sip=%d\n",
+                impl->config.name, impl->config.device_id, impl->config.channel_id, impl->config.local_sip_port);
         return -1;
     }
-    {
-        int ret = pthread_create(&impl->sip_thread, NULL, gb28181_sink_sip_loop, impl);
-        if (ret != 0) {
-            fprintf(stderr, "[ERROR] gb28181_sink_start failed: pthread_create ret=%d\n", ret);
-            gb28181_device_deinit(&impl->device_ctx);
-            return -1;
-        }
-    }
-
-    impl->sip_thread_started = 1;
     impl->started = 1;
     return 0;
 }
@@ -170,7 +317,8 @@ static int gb28181_sink_send_packet(MediaSink *sink, const MediaPacket *packet)
         return 0;
     }
 
-    if (gb28181_device_send_h264(&impl->device_ctx,
+    if (gb28181_device_send_h264(&impl->device->device_ctx,
+                                 impl->channel,
                                  packet->buffer->data,
                                  packet->buffer->size,
                                  packet->is_key_frame,
@@ -191,9 +339,8 @@ static void gb28181_sink_disconnect(MediaSink *sink) {
 
 /*
  * sink stop：
- * 1. 请求 gb28181Device 停止；
- * 2. 等待 SIP 线程退出；
- * 3. 释放 gb28181Device 资源。
+ * 1. 从共享 gb28181Device 摘下本通道并关闭其会话；
+ * 2. 最后一个 sink 停止时请求设备停止、等待 SIP 线程退出并释放设备。
  */
 static void gb28181_sink_stop(MediaSink *sink) {
     Gb28181SinkImpl *impl = (Gb28181SinkImpl *)sink->impl;
@@ -201,15 +348,19 @@ static void gb28181_sink_stop(MediaSink *sink) {
         return;
     }
 
-    gb28181_device_stop(&impl->device_ctx);
-    if (impl->sip_thread_started) {
-        pthread_join(impl->sip_thread, NULL);
-        impl->sip_thread_started = 0;
-    }
-    gb28181_device_deinit(&impl->device_ctx);
+    detach_shared_device(impl);
     impl->started = 0;
 }
 
+/* 按需编码查询：平台点播会话存在即视为有观看端。 */
+static int gb28181_sink_has_consumer(MediaSink *sink) {
+    Gb28181SinkImpl *impl = (Gb28181SinkImpl *)sink->impl;
+    if (!impl || !impl->started) {
+        return 0;
+    }
+    return gb28181_device_has_media_session(&impl->device->device_ctx, impl->channel);
+}
+
 /*
  * 创建并初始化 GB28181 sink。
  * 该函数只做对象构建与通用队列初始化，不会真正建立 SIP/RTP 连接。
@@ -220,7 +371,9 @@ int gb28181_sink_setup(MediaSink *sink, const Gb28181SinkConfig *config) {
         gb28181_sink_connect,
         gb28181_sink_send_packet,
         gb28181_sink_disconnect,
-        gb28181_sink_stop
+        gb28181_sink_stop,
+        gb28181_sink_has_consumer,
+        NULL
     };
     MediaSinkConfig sink_config;
     Gb28181SinkImpl *impl = NULL;
@@ -236,6 +389,7 @@ int gb28181_sink_setup(MediaSink *sink, const Gb28181SinkConfig *config) {
         return -1;
     }
     fill_default_config(&impl->config, config);
+    impl->channel = -1;
 
     memset(&sink_config, 0, sizeof(sink_config));
     sink_config.name = impl->config.name;
@@ -262,5 +416,29 @@ int gb28181_sink_consume_external_idr_request(MediaSink *sink) {
     if (!impl || !impl->started) {
         return 0;
     }
-    return gb28181_device_consume_external_idr_request(&impl->device_ctx);
+    return gb28181_device_consume_external_idr_request(&impl->device->device_ctx, impl->channel);
+}
+
+int gb28181_sink_has_live_session(MediaSink *sink) {
+    Gb28181SinkImpl *impl = NULL;
+    if (!sink) {
+        return 0;
+    }
+    impl = (Gb28181SinkImpl *)sink->impl;
+    if (!impl || !impl->started) {
+        return 0;
+    }
+    return gb28181_device_has_live_session(&impl->device->device_ctx, impl->channel);
+}
+
+void gb28181_sink_update_rate(MediaSink *sink, int bitrate, int fps) {
+    Gb28181SinkImpl *impl = NULL;
+    if (!sink) {
+        return;
+    }
+    impl = (Gb28181SinkImpl *)sink->impl;
+    if (!impl || !impl->started) {
+        return;
+    }
+    gb28181_device_update_channel_rate(&impl->device->device_ctx, impl->channel, bitrate, fps);
 }
@@ -0,0 +1,104 @@
+#ifndef __FMP4_MUXER_H__
+#define __FMP4_MUXER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 视频轨时间基，与 MPEG 系统时钟一致。 */
+#define FMP4_TIMESCALE 90000
+/* 缓存的 SPS/PPS 最大长度。 */
+#define FMP4_PARAM_SET_MAX 256
+/* 每个 avcC 长度前缀的字节数。 */
+#define FMP4_NALU_LENGTH_SIZE 4
+/* 片段头（moof + mdat 头）的固定部分和每个样本增加的字节数。 */
+#define FMP4_FRAGMENT_HEADER_BASE 96
+#define FMP4_FRAGMENT_HEADER_PER_SAMPLE 12
+/* init 段除 SPS/PPS 外的固定部分（实测约 640 字节，留出余量），加上两个最长参数集即为 init 段上限。 */
+#define FMP4_INIT_SEGMENT_BASE 768
+#define FMP4_INIT_SEGMENT_MAX (FMP4_INIT_SEGMENT_BASE + 2 * FMP4_PARAM_SET_MAX)
+
+/**
+ * @brief 最近一次出现的 SPS/PPS，init 段的 avcC 由它生成。
+ */
+typedef struct {
+    uint8_t sps[FMP4_PARAM_SET_MAX];  /* SPS（不含起始码）。 */
+    size_t sps_len;                   /* sps 长度，0 表示还没有。 */
+    uint8_t pps[FMP4_PARAM_SET_MAX];  /* PPS（不含起始码）。 */
+    size_t pps_len;                   /* pps 长度，0 表示还没有。 */
+} Fmp4ParamSets;
+
+/**
+ * @brief 片段中的一个样本（一帧）。
+ */
+typedef struct {
+    uint32_t size;                    /* 样本字节数（avcC 格式）。 */
+    uint32_t duration;                /* 样本时长（FMP4_TIMESCALE）。 */
+    int is_key_frame;                 /* 是否关键帧。 */
+} Fmp4Sample;
+
+/**
+ * @brief 从一帧 Annex-B H264 中提取 SPS/PPS 更新缓存。
+ * @param annexb_data 帧数据。
+ * @param annexb_len 帧长度。
+ * @param params 参数集缓存。
+ * @return 1 SPS/PPS 与缓存不同并已更新，0 没有变化。
+ */
+int fmp4_cache_param_sets(const uint8_t *annexb_data, size_t annexb_len, Fmp4ParamSets *params);
+
+/**
+ * @brief 把一帧 Annex-B H264 转成 avcC 长度前缀格式写入 dst，跳过 AUD。
+ * @param annexb_data 帧数据。
+ * @param annexb_len 帧长度。
+ * @param dst 输出位置。
+ * @param cap 输出容量。
+ * @param nalu_count 输出：写入的 NALU 数，可为 NULL。
+ * @return 写入字节数，0 表示容量不足或没有可用 NALU（由 nalu_count 区分）。
+ */
+size_t fmp4_annexb_to_avcc(const uint8_t *annexb_data,
+                           size_t annexb_len,
+                           uint8_t *dst,
+                           size_t cap,
+                           int *nalu_count);
+
+/**
+ * @brief 生成 init 段（ftyp + moov），单视频轨，时间基 FMP4_TIMESCALE。
+ * @param dst 输出位置。
+ * @param cap 输出容量。
+ * @param params 已缓存 SPS/PPS 的参数集。
+ * @param width 视频宽度。
+ * @param height 视频高度。
+ * @return 写入字节数，-1 参数集不全或容量不足。
+ */
+int fmp4_build_init_segment(uint8_t *dst, size_t cap, const Fmp4ParamSets *params, int width, int height);
+
+/**
+ * @brief 计算 count 个样本的片段头（moof + mdat 头）长度。
+ * @param count 样本数。
+ * @return 字节数。
+ */
+size_t fmp4_fragment_header_size(int count);
+
+/**
+ * @brief 写片段头（moof + mdat 头），样本数据须紧跟其后，调用方可先写样本再回填片段头。
+ * @param dst 输出位置，长度为 fmp4_fragment_header_size(count)。
+ * @param sequence 片段序号（mfhd），从 1 开始递增。
+ * @param base_decode_time 首个样本的解码时间（FMP4_TIMESCALE）。
+ * @param samples 样本表。
+ * @param count 样本数。
+ * @return 0 成功，-1 参数错误。
+ */
+int fmp4_write_fragment_header(uint8_t *dst,
+                               uint32_t sequence,
+                               uint64_t base_decode_time,
+                               const Fmp4Sample *samples,
+                               int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef __LL_HLS_SINK_H__
+#define __LL_HLS_SINK_H__
+
+#include <stdint.h>
+
+#include "mediaSink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char *name;          /* sink 名称，用于日志和统计信息。 */
+    const char *listen_ip;     /* HTTP 监听地址，默认 0.0.0.0。 */
+    int listen_port;           /* HTTP 监听端口，默认 8088。 */
+    const char *stream_name;   /* 播放路径 /hls/<stream_name>/index.m3u8 中的流名。 */
+    int queue_capacity;        /* 编码线程到服务线程之间的帧队列容量。 */
+    int max_clients;           /* 同时保持的最大连接数，超出时直接关闭新连接。 */
+    int segment_target_ms;     /* 目标分段时长，分段在达到该时长后的第一个关键帧处切开。 */
+    int part_target_ms;        /* 目标部分分段（part）时长，决定最低可达的延迟。 */
+    int playlist_segments;     /* 播放列表保留的完整分段数。 */
+    int segment_max_bytes;     /* 每个分段槽位的字节数，0 按码率自动估算。 */
+    int video_width;           /* init 段中的视频宽度。 */
+    int video_height;          /* init 段中的视频高度。 */
+    int video_fps;             /* 码流帧率，用于估算最后一帧时长。 */
+    int video_bitrate;         /* 码流码率，用于估算分段槽位大小。 */
+} LlHlsSinkConfig;
+
+typedef struct {
+    int clients;               /* 当前保持的 HTTP 连接数。 */
+    uint64_t requests;         /* 累计处理的请求数。 */
+    uint64_t playlist_requests; /* 其中播放列表请求数。 */
+    uint64_t blocked_reloads;  /* 需要挂起等待新 part 的阻塞式播放列表请求数。 */
+    uint64_t part_requests;    /* part 请求数。 */
+    uint64_t segment_requests; /* 完整分段请求数。 */
+    uint64_t not_found;        /* 回 404 的请求数（已淘汰或不存在）。 */
+    uint64_t frames;           /* 已封装的视频帧数。 */
+    uint64_t segments;         /* 已完成的分段数。 */
+    uint64_t parts;            /* 已完成的 part 数。 */
+    uint64_t overflow_drops;   /* 分段槽位放不下而丢弃的帧数。 */
+    uint64_t bytes_sent;       /* 已写给所有客户端的字节数。 */
+    uint64_t ring_bytes;       /* 分段环形缓冲占用的内存字节数。 */
+} LlHlsSinkStats;
+
+/**
+ * @description: 创建 LL-HLS 输出通道：内置单线程 epoll HTTP 服务，按 /hls/<stream>/index.m3u8 提供低延迟 HLS。
+ *               编码帧直接封装为 fMP4 part 写进按媒体序号索引的内存环形缓冲，完整分段由各 part 拼接而成，不落盘；
+ *               播放列表支持阻塞式刷新（_HLS_msn/_HLS_part）和 PRELOAD-HINT，正在生成的 part 请求会挂起到生成完为止。
+ * @param {MediaSink *} sink 输出通道。
+ * @param {const LlHlsSinkConfig *} config 配置。
+ * @return {int} 0 成功，-1 失败。
+ */
+int ll_hls_sink_setup(MediaSink *sink, const LlHlsSinkConfig *config);
+
+/**
+ * @description: 获取 LL-HLS 输出通道的运行统计。
+ * @param {MediaSink *} sink 由 ll_hls_sink_setup 创建的通道。
+ * @param {LlHlsSinkStats *} stats 输出统计。
+ * @return {int} 0 成功，-1 参数非法。
+ */
+int ll_hls_sink_get_stats(MediaSink *sink, LlHlsSinkStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,372 @@
+#include "fmp4Muxer.h"
+
+#include <string.h>
+
+#include "mediaPacket.h"
+
+#define FMP4_TRACK_ID 1
+#define H264_NALU_AUD 9
+#define H264_NALU_SPS 7
+#define H264_NALU_PPS 8
+/* trun 标志：data_offset、sample_duration、sample_size、sample_flags。 */
+#define FMP4_TRUN_FLAGS 0x000701
+/* tfhd 标志：default-base-is-moof，data_offset 相对本片段的 moof。 */
+#define FMP4_TFHD_FLAGS 0x020000
+/* sample_flags：关键帧不依赖其他帧；非关键帧依赖其他帧且不是同步样本。 */
+#define FMP4_SAMPLE_FLAGS_KEY 0x02000000U
+#define FMP4_SAMPLE_FLAGS_DELTA 0x01010000U
+
+/* 顺序写 box 的游标，越界后只置 overflow，最后统一检查。 */
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    int overflow;
+} Fmp4Writer;
+
+static void put_bytes(Fmp4Writer *w, const void *data, size_t len) {
+    if (w->overflow || w->len + len > w->cap) {
+        w->overflow = 1;
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+static void put_zero(Fmp4Writer *w, size_t len) {
+    if (w->overflow || w->len + len > w->cap) {
+        w->overflow = 1;
+        return;
+    }
+    memset(w->buf + w->len, 0, len);
+    w->len += len;
+}
+
+static void put_u8(Fmp4Writer *w, uint8_t v) {
+    put_bytes(w, &v, 1);
+}
+
+static void put_u16(Fmp4Writer *w, uint16_t v) {
+    uint8_t b[2] = {(uint8_t)(v >> 8), (uint8_t)v};
+    put_bytes(w, b, sizeof(b));
+}
+
+static void put_u32(Fmp4Writer *w, uint32_t v) {
+    uint8_t b[4] = {(uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v};
+    put_bytes(w, b, sizeof(b));
+}
+
+static void put_u64(Fmp4Writer *w, uint64_t v) {
+    put_u32(w, (uint32_t)(v >> 32));
+    put_u32(w, (uint32_t)v);
+}
+
+static void write_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/* 开始一个 box，返回 box 起始偏移，结束时由 box_end 回填长度。 */
+static size_t box_begin(Fmp4Writer *w, const char *type) {
+    size_t start = w->len;
+    put_u32(w, 0);
+    put_bytes(w, type, 4);
+    return start;
+}
+
+static size_t full_box_begin(Fmp4Writer *w, const char *type, uint8_t version, uint32_t flags) {
+    size_t start = box_begin(w, type);
+    put_u32(w, ((uint32_t)version << 24) | (flags & 0xFFFFFF));
+    return start;
+}
+
+static void box_end(Fmp4Writer *w, size_t start) {
+    if (!w->overflow) {
+        write_be32(w->buf + start, (uint32_t)(w->len - start));
+    }
+}
+
+/* 单位矩阵，mvhd/tkhd 共用。 */
+static void put_matrix(Fmp4Writer *w) {
+    put_u32(w, 0x00010000);
+    put_u32(w, 0);
+    put_u32(w, 0);
+    put_u32(w, 0);
+    put_u32(w, 0x00010000);
+    put_u32(w, 0);
+    put_u32(w, 0);
+    put_u32(w, 0);
+    put_u32(w, 0x40000000);
+}
+
+static int cache_param_set(uint8_t *dst, size_t *dst_len, const uint8_t *nalu, size_t len) {
+    if (len == 0 || len > FMP4_PARAM_SET_MAX) return 0;
+    if (*dst_len == len && memcmp(dst, nalu, len) == 0) return 0;
+    memcpy(dst, nalu, len);
+    *dst_len = len;
+    return 1;
+}
+
+int fmp4_cache_param_sets(const uint8_t *annexb_data, size_t annexb_len, Fmp4ParamSets *params) {
+    MediaNaluView nalu;
+    size_t pos = 0;
+    int changed = 0;
+
+    if (!annexb_data || !params) return 0;
+    while (media_annexb_next_nalu(annexb_data, annexb_len, &pos, &nalu)) {
+        uint8_t type = nalu.data[0] & 0x1F;
+
+        if (type == H264_NALU_SPS) {
+            changed |= cache_param_set(params->sps, &params->sps_len, nalu.data, nalu.size);
+        } else if (type == H264_NALU_PPS) {
+            changed |= cache_param_set(params->pps, &params->pps_len, nalu.data, nalu.size);
+        } else if (type >= 1 && type <= 5) {
+            /* 参数集总在图像数据之前，遇到 slice 即可停止扫描。 */
+            break;
+        }
+    }
+    return changed;
+}
+
+size_t fmp4_annexb_to_avcc(const uint8_t *annexb_data,
+                           size_t annexb_len,
+                           uint8_t *dst,
+                           size_t cap,
+                           int *nalu_count) {
+    MediaNaluView nalu;
+    size_t pos = 0;
+    size_t out = 0;
+    int count = 0;
+
+    if (nalu_count) *nalu_count = 0;
+    if (!annexb_data || !dst) return 0;
+
+    while (media_annexb_next_nalu(annexb_data, annexb_len, &pos, &nalu)) {
+        /* 分片格式里访问单元边界由样本表给出，AUD 没有用处。 */
+        if ((nalu.data[0] & 0x1F) == H264_NALU_AUD) continue;
+        count++;
+        if (out + FMP4_NALU_LENGTH_SIZE + nalu.size > cap) {
+            if (nalu_count) *nalu_count = count;
+            return 0;
+        }
+        write_be32(dst + out, (uint32_t)nalu.size);
+        memcpy(dst + out + FMP4_NALU_LENGTH_SIZE, nalu.data, nalu.size);
+        out += FMP4_NALU_LENGTH_SIZE + nalu.size;
+    }
+    if (nalu_count) *nalu_count = count;
+    return out;
+}
+
+int fmp4_build_init_segment(uint8_t *dst, size_t cap, const Fmp4ParamSets *params, int width, int height) {
+    static const uint8_t compressor[32] = {0};
+    Fmp4Writer w;
+    size_t moov, trak, mdia, minf, dinf, dref, stbl, stsd, avc1, avcc, box, mvex;
+    uint8_t profile;
+
+    if (!dst || !params || params->sps_len < 4 || params->pps_len == 0) return -1;
+    memset(&w, 0, sizeof(w));
+    w.buf = dst;
+    w.cap = cap;
+    profile = params->sps[1];
+
+    box = box_begin(&w, "ftyp");
+    put_bytes(&w, "iso5", 4);
+    put_u32(&w, 512);
+    put_bytes(&w, "iso5", 4);
+    put_bytes(&w, "iso6", 4);
+    put_bytes(&w, "mp41", 4);
+    box_end(&w, box);
+
+    moov = box_begin(&w, "moov");
+
+    box = full_box_begin(&w, "mvhd", 0, 0);
+    put_u32(&w, 0);
+    put_u32(&w, 0);
+    put_u32(&w, 1000);
+    put_u32(&w, 0);
+    put_u32(&w, 0x00010000);
+    put_u16(&w, 0x0100);
+    put_zero(&w, 10);
+    put_matrix(&w);
+    put_zero(&w, 24);
+    put_u32(&w, FMP4_TRACK_ID + 1);
+    box_end(&w, box);
+
+    trak = box_begin(&w, "trak");
+    /* flags：track_enabled | track_in_movie。 */
+    box = full_box_begin(&w, "tkhd", 0, 0x000003);
+    put_u32(&w, 0);
+    put_u32(&w, 0);
+    put_u32(&w, FMP4_TRACK_ID);
+    put_u32(&w, 0);
+    put_u32(&w, 0);
+    put_zero(&w, 8);
+    put_u16(&w, 0);
+    put_u16(&w, 0);
+    put_u16(&w, 0);
+    put_u16(&w, 0);
+    put_matrix(&w);
+    put_u32(&w, (uint32_t)width << 16);
+    put_u32(&w, (uint32_t)height << 16);
+    box_end(&w, box);
+
+    mdia = box_begin(&w, "mdia");
+    box = full_box_begin(&w, "mdhd", 0, 0);
+    put_u32(&w, 0);
+    put_u32(&w, 0);
+    put_u32(&w, FMP4_TIMESCALE);
+    put_u32(&w, 0);
+    /* 语言 "und"。 */
+    put_u16(&w, 0x55C4);
+    put_u16(&w, 0);
+    box_end(&w, box);
+
+    box = full_box_begin(&w, "hdlr", 0, 0);
+    put_u32(&w, 0);
+    put_bytes(&w, "vide", 4);
+    put_zero(&w, 12);
+    put_bytes(&w, "VideoHandler", 13);
+    box_end(&w, box);
+
+    minf = box_begin(&w, "minf");
+    box = full_box_begin(&w, "vmhd", 0, 1);
+    put_zero(&w, 8);
+    box_end(&w, box);
+
+    dinf = box_begin(&w, "dinf");
+    dref = full_box_begin(&w, "dref", 0, 0);
+    put_u32(&w, 1);
+    /* flags=1：媒体数据就在本文件里。 */
+    box = full_box_begin(&w, "url ", 0, 1);
+    box_end(&w, box);
+    box_end(&w, dref);
+    box_end(&w, dinf);
+
+    stbl = box_begin(&w, "stbl");
+    stsd = full_box_begin(&w, "stsd", 0, 0);
+    put_u32(&w, 1);
+    avc1 = box_begin(&w, "avc1");
+    put_zero(&w, 6);
+    put_u16(&w, 1);
+    put_zero(&w, 16);
+    put_u16(&w, (uint16_t)width);
+    put_u16(&w, (uint16_t)height);
+    put_u32(&w, 0x00480000);
+    put_u32(&w, 0x00480000);
+    put_u32(&w, 0);
+    put_u16(&w, 1);
+    put_bytes(&w, compressor, sizeof(compressor));
+    put_u16(&w, 0x0018);
+    put_u16(&w, 0xFFFF);
+
+    avcc = box_begin(&w, "avcC");
+    put_u8(&w, 1);
+    put_u8(&w, params->sps[1]);
+    put_u8(&w, params->sps[2]);
+    put_u8(&w, params->sps[3]);
+    put_u8(&w, 0xFC | (FMP4_NALU_LENGTH_SIZE - 1));
+    put_u8(&w, 0xE1);
+    put_u16(&w, (uint16_t)params->sps_len);
+    put_bytes(&w, params->sps, params->sps_len);
+    put_u8(&w, 1);
+    put_u16(&w, (uint16_t)params->pps_len);
+    put_bytes(&w, params->pps, params->pps_len);
+    if (profile == 100 || profile == 110 || profile == 122 || profile == 144) {
+        /* High 系列 profile 的扩展字段：编码器输出固定为 4:2:0、8bit。 */
+        put_u8(&w, 0xFC | 1);
+        put_u8(&w, 0xF8);
+        put_u8(&w, 0xF8);
+        put_u8(&w, 0);
+    }
+    box_end(&w, avcc);
+    box_end(&w, avc1);
+    box_end(&w, stsd);
+
+    /* 分片文件的样本表都在 moof 里，这里只放空表。 */
+    box = full_box_begin(&w, "stts", 0, 0);
+    put_u32(&w, 0);
+    box_end(&w, box);
+    box = full_box_begin(&w, "stsc", 0, 0);
+    put_u32(&w, 0);
+    box_end(&w, box);
+    box = full_box_begin(&w, "stsz", 0, 0);
+    put_u32(&w, 0);
+    put_u32(&w, 0);
+    box_end(&w, box);
+    box = full_box_begin(&w, "stco", 0, 0);
+    put_u32(&w, 0);
+    box_end(&w, box);
+    box_end(&w, stbl);
+    box_end(&w, minf);
+    box_end(&w, mdia);
+    box_end(&w, trak);
+
+    mvex = box_begin(&w, "mvex");
+    box = full_box_begin(&w, "trex", 0, 0);
+    put_u32(&w, FMP4_TRACK_ID);
+    put_u32(&w, 1);
+    put_u32(&w, 0);
+    put_u32(&w, 0);
+    put_u32(&w, 0);
+    box_end(&w, box);
+    box_end(&w, mvex);
+    box_end(&w, moov);
+
+    return w.overflow ? -1 : (int)w.len;
+}
+
+size_t fmp4_fragment_header_size(int count) {
+    return FMP4_FRAGMENT_HEADER_BASE + (size_t)count * FMP4_FRAGMENT_HEADER_PER_SAMPLE;
+}
+
+int fmp4_write_fragment_header(uint8_t *dst,
+                               uint32_t sequence,
+                               uint64_t base_decode_time,
+                               const Fmp4Sample *samples,
+                               int count) {
+    Fmp4Writer w;
+    size_t moof, traf, box;
+    size_t data_offset_pos;
+    uint64_t mdat_size = 8;
+    int i;
+
+    if (!dst || !samples || count <= 0) return -1;
+    memset(&w, 0, sizeof(w));
+    w.buf = dst;
+    w.cap = fmp4_fragment_header_size(count);
+
+    moof = box_begin(&w, "moof");
+    box = full_box_begin(&w, "mfhd", 0, 0);
+    put_u32(&w, sequence);
+    box_end(&w, box);
+
+    traf = box_begin(&w, "traf");
+    box = full_box_begin(&w, "tfhd", 0, FMP4_TFHD_FLAGS);
+    put_u32(&w, FMP4_TRACK_ID);
+    box_end(&w, box);
+    box = full_box_begin(&w, "tfdt", 1, 0);
+    put_u64(&w, base_decode_time);
+    box_end(&w, box);
+    box = full_box_begin(&w, "trun", 0, FMP4_TRUN_FLAGS);
+    put_u32(&w, (uint32_t)count);
+    data_offset_pos = w.len;
+    put_u32(&w, 0);
+    for (i = 0; i < count; ++i) {
+        put_u32(&w, samples[i].duration);
+        put_u32(&w, samples[i].size);
+        put_u32(&w, samples[i].is_key_frame ? FMP4_SAMPLE_FLAGS_KEY : FMP4_SAMPLE_FLAGS_DELTA);
+        mdat_size += samples[i].size;
+    }
+    box_end(&w, box);
+    box_end(&w, traf);
+    box_end(&w, moof);
+
+    put_u32(&w, (uint32_t)mdat_size);
+    put_bytes(&w, "mdat", 4);
+    if (w.overflow || w.len != w.cap) return -1;
+    /* 样本数据紧跟 mdat 头，偏移从 moof 起算。 */
+    write_be32(dst + data_offset_pos, (uint32_t)w.len);
+    return 0;
+}
@@ -0,0 +1,1854 @@
+#define _GNU_SOURCE
+#include "llHlsSink.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fmp4Muxer.h"
+
+#define DEFAULT_LL_HLS_NAME "ll-hls"
+#define DEFAULT_LL_HLS_LISTEN_IP "0.0.0.0"
+#define DEFAULT_LL_HLS_PORT 8088
+#define DEFAULT_LL_HLS_STREAM_NAME "main"
+#define DEFAULT_LL_HLS_QUEUE_CAPACITY 64
+#define DEFAULT_LL_HLS_MAX_CLIENTS 32
+#define DEFAULT_LL_HLS_SEGMENT_TARGET_MS 2000
+#define DEFAULT_LL_HLS_PART_TARGET_MS 200
+#define DEFAULT_LL_HLS_PLAYLIST_SEGMENTS 6
+#define DEFAULT_LL_HLS_FPS 25
+#define DEFAULT_LL_HLS_BITRATE (4 * 1024 * 1024)
+#define DEFAULT_LL_HLS_RECONNECT_INTERVAL_MS 1000
+#define LL_HLS_SEGMENT_MIN_BYTES (256 * 1024)
+#define LL_HLS_SPARE_SLOTS 3
+#define LL_HLS_MAX_PARTS 64
+#define LL_HLS_MAX_PART_SAMPLES 64
+#define LL_HLS_PART_LIST_SEGMENTS 3
+/* clients 数组在 max_clients 之外多留的位置，给已关闭、等本轮事件处理完才回收的连接。 */
+#define LL_HLS_PENDING_CONNECTIONS 16
+#define LL_HLS_REQUEST_MAX 2048
+#define LL_HLS_REQUEST_TIMEOUT_MS 5000
+#define LL_HLS_IDLE_TIMEOUT_MS 30000
+#define LL_HLS_CONSUMER_IDLE_MS 10000
+#define LL_HLS_INIT_MAX FMP4_INIT_SEGMENT_MAX
+#define LL_HLS_HEADER_MAX 512
+#define LL_HLS_EPOLL_EVENTS 64
+#define LL_HLS_EPOLL_TIMEOUT_MS 50
+#define LL_HLS_PATH_MAX 256
+
+static const char LL_HLS_RESPONSE_400[] =
+    "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+static const char LL_HLS_RESPONSE_404[] =
+    "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nAccess-Control-Allow-Origin: *\r\n\r\n";
+static const char LL_HLS_RESPONSE_503[] =
+    "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nAccess-Control-Allow-Origin: *\r\n\r\n";
+
+typedef enum {
+    LL_HLS_CLIENT_READING = 0,     /* 等待/读取请求头。 */
+    LL_HLS_CLIENT_WAITING = 1,     /* 请求的播放列表版本或 part 还没生成，挂起中。 */
+    LL_HLS_CLIENT_REPLYING = 2     /* 正在写响应。 */
+} LlHlsClientState;
+
+typedef enum {
+    LL_HLS_WAIT_PLAYLIST = 0,      /* 阻塞式播放列表刷新。 */
+    LL_HLS_WAIT_MEDIA = 1          /* 正在生成的 part 或分段。 */
+} LlHlsWaitKind;
+
+/* 分段内的一个 part：moof + mdat，字节连续存放在分段槽位里。 */
+typedef struct {
+    size_t offset;                 /* moof 在槽位中的偏移。 */
+    size_t size;                   /* moof + mdat 总字节数。 */
+    uint32_t duration;             /* 时长（FMP4_TIMESCALE）。 */
+    int independent;               /* 是否以关键帧开头。 */
+} LlHlsPart;
+
+/* 环形缓冲中的一个分段槽位，按 msn % 槽位数 索引，只在服务线程访问。 */
+typedef struct {
+    int64_t msn;                   /* 媒体序号，-1 表示未使用。 */
+    int generation;                /* 对应的 init 段版本（EXT-X-MAP）。 */
+    int discontinuity;             /* 参数集变化后的第一个分段，需要 EXT-X-DISCONTINUITY。 */
+    uint64_t discontinuity_seq;    /* 截至本分段的不连续次数。 */
+    int complete;                  /* 分段已结束，可整段下载。 */
+    uint8_t *data;                 /* 槽位内存。 */
+    LlHlsPart parts[LL_HLS_MAX_PARTS]; /* 已完成的 part。 */
+    int part_count;                /* 已完成的 part 数。 */
+    uint64_t duration;             /* 已完成 part 的总时长（FMP4_TIMESCALE）。 */
+    long long pdt_ms;              /* 首帧的墙上时间，用于 EXT-X-PROGRAM-DATE-TIME。 */
+    int readers;                   /* 正在从槽位写数据的客户端数。 */
+} LlHlsSegment;
+
+typedef struct {
+    int fd;                        /* 客户端连接。 */
+    int closed;                    /* 已关闭，等本轮事件处理完再回收。 */
+    int close_after_reply;         /* 响应写完后关闭。 */
+    int want_write;                /* 是否需要关注可写。 */
+    uint32_t watch_events;         /* 当前注册在 epoll 上的事件。 */
+    int state;                     /* LlHlsClientState。 */
+    long long request_ms;          /* 进入收请求状态的时间，用于请求超时和空闲超时。 */
+    char request[LL_HLS_REQUEST_MAX]; /* 已读到的请求数据。 */
+    size_t request_len;            /* 已读字节数。 */
+    size_t request_consumed;       /* 当前请求头占用的字节数，响应完后剩余部分作为下一个请求。 */
+    int wait_kind;                 /* 挂起时等待的对象，LlHlsWaitKind。 */
+    int64_t wait_msn;              /* 挂起等待的媒体序号，-1 表示播放列表非阻塞请求。 */
+    int wait_part;                 /* 挂起等待的 part 序号，-1 表示整段。 */
+    long long wait_deadline_ms;    /* 挂起截止时间，超时回 503。 */
+    char header[LL_HLS_HEADER_MAX]; /* 响应头。 */
+    struct iovec iov[LL_HLS_MAX_PARTS + 1]; /* 响应分段：响应头 + 响应体（直接指向槽位）。 */
+    int iov_count;                 /* iov 有效分段数。 */
+    int iov_index;                 /* 第一个未写完的分段。 */
+    size_t pending_bytes;          /* 响应尚未写出的字节数。 */
+    uint8_t *owned;                /* 播放列表、init 段等响应自有的内存。 */
+    LlHlsSegment *segment;         /* 响应体所在的分段槽位。 */
+} LlHlsClient;
+
+typedef struct {
+    LlHlsSinkConfig config;        /* 配置副本。 */
+    char prefix[LL_HLS_PATH_MAX];  /* 请求路径前缀 /hls/<stream>/。 */
+    int listen_fd;                 /* 监听 socket。 */
+    int event_fd;                  /* 发送线程投递新帧后唤醒服务线程。 */
+    int epoll_fd;                  /* 服务线程的 epoll。 */
+    pthread_t thread;              /* 服务线程。 */
+    int running;                   /* 服务线程是否已启动。 */
+    volatile int stop_requested;   /* 是否已请求服务线程退出。 */
+    pthread_mutex_t lock;          /* 保护 inbox、stats 和 last_request_ms。 */
+    MediaPacket *inbox;            /* 发送线程到服务线程的帧引用环形队列。 */
+    int inbox_capacity;            /* inbox 容量。 */
+    int inbox_head;                /* inbox 队头下标。 */
+    int inbox_size;                /* inbox 有效元素数。 */
+    uint64_t inbox_drops;          /* inbox 满导致丢弃的帧数，受 lock 保护。 */
+    LlHlsSinkStats stats;          /* 对外统计。 */
+    long long last_request_ms;     /* 最近一次请求的时间，受 lock 保护。 */
+    /* 以下字段只在发送线程使用。 */
+    int inbox_need_keyframe;       /* inbox 满丢帧后，直到下一个关键帧前不再投递。 */
+    /* 以下字段只在服务线程使用。 */
+    LlHlsSinkStats counters;       /* 服务线程内累计的统计，每轮发布到 stats。 */
+    long long request_seen_ms;     /* 本轮最近一次请求的时间。 */
+    LlHlsClient **clients;         /* 所有连接。 */
+    int client_capacity;           /* clients 容量。 */
+    int client_count;              /* clients 中的元素数，含已关闭未回收的连接。 */
+    int live_clients;              /* 未关闭的连接数，按 max_clients 限制。 */
+    LlHlsSegment *ring;            /* 分段槽位。 */
+    int slot_count;                /* 槽位数 = 播放列表分段数 + 备用。 */
+    size_t slot_bytes;             /* 每个槽位的字节数。 */
+    uint8_t *ring_data;            /* 所有槽位共用的一整块内存。 */
+    Fmp4ParamSets params;          /* 缓存的 SPS/PPS。 */
+    uint8_t init[2][LL_HLS_INIT_MAX]; /* 当前和上一版 init 段，按 generation % 2 存放。 */
+    int init_len[2];               /* init 段长度，0 表示还没有。 */
+    int generation;                /* 当前 init 段版本。 */
+    int pending_discontinuity;     /* 下一个分段需要标记不连续。 */
+    uint64_t discontinuity_seq;    /* 累计不连续次数。 */
+    LlHlsSegment *cur;             /* 正在生成的分段，NULL 表示等待关键帧。 */
+    int64_t next_msn;              /* 下一个分段的媒体序号。 */
+    int mux_need_keyframe;         /* 槽位放不下丢帧后等下一个关键帧。 */
+    size_t write_pos;              /* 当前分段槽位的写入位置。 */
+    size_t part_payload;           /* 当前 part 样本数据的起始偏移，片段头回填在它前面。 */
+    Fmp4Sample samples[LL_HLS_MAX_PART_SAMPLES]; /* 当前 part 的样本表。 */
+    int sample_count;              /* 当前 part 的样本数。 */
+    uint64_t part_base_dts;        /* 当前 part 首个样本的解码时间。 */
+    uint32_t part_duration;        /* 当前 part 已确定时长的样本累计时长。 */
+    int sample_held;               /* 当前 part 最后一个样本的时长未定，等下一帧的 DTS 到达后按差值确定。 */
+    uint32_t sample_estimate;      /* 最近一次按 DTS 差得到的帧时长，判断 part 能否再放一帧、补未定时长时使用。 */
+    long long part_start_ms;       /* 当前 part 首个样本写入时的单调时钟，下一帧迟迟不到时按墙钟结束 part。 */
+    uint64_t part_end_dts;         /* 上一个 part 的结束时间，新样本的 DTS 不早于它。 */
+    uint32_t fragment_sequence;    /* mfhd 序号。 */
+    int have_timeline;             /* 是否已记录时间轴起点。 */
+    uint64_t dts_base_us;          /* 时间轴起点。 */
+    uint64_t last_dts;             /* 上一帧解码时间（FMP4_TIMESCALE）。 */
+    uint32_t frame_duration;       /* 默认帧时长（FMP4_TIMESCALE）。 */
+    uint32_t part_target;          /* part 目标时长（FMP4_TIMESCALE）。 */
+    uint64_t segment_target;       /* 分段目标时长（FMP4_TIMESCALE）。 */
+    uint64_t max_segment_ms;       /* 出现过的最长分段，用于 EXT-X-TARGETDURATION。 */
+} LlHlsImpl;
+
+static void ll_hls_client_resume(LlHlsImpl *impl, LlHlsClient *client);
+static void ll_hls_client_handle_request(LlHlsImpl *impl, LlHlsClient *client);
+
+/**
+ * @description: 获取单调时钟毫秒数
+ * @return {static long long}
+ */
+static long long ll_hls_now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+/**
+ * @description: 获取墙上时钟毫秒数
+ * @return {static long long}
+ */
+static long long ll_hls_wall_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+/**
+ * @description: 按 msn 查找仍在环形缓冲中的分段
+ * @param {LlHlsImpl *} impl
+ * @param {int64_t} msn
+ * @return {static LlHlsSegment *} 已被覆盖或不存在时返回 NULL
+ */
+static LlHlsSegment *ll_hls_find_segment(LlHlsImpl *impl, int64_t msn) {
+    LlHlsSegment *seg;
+
+    if (msn < 0 || !impl->ring) {
+        return NULL;
+    }
+    seg = &impl->ring[msn % impl->slot_count];
+    return seg->msn == msn ? seg : NULL;
+}
+
+/**
+ * @description: 当前正在生成（或即将生成）的分段序号
+ * @param {LlHlsImpl *} impl
+ * @return {static int64_t}
+ */
+static int64_t ll_hls_live_msn(LlHlsImpl *impl) {
+    return impl->cur ? impl->cur->msn : impl->next_msn;
+}
+
+/**
+ * @description: 更新 epoll 关注的事件：收请求时关注可读，积压时关注可写，始终关注对端关闭
+ * @param {LlHlsImpl *} impl
+ * @param {LlHlsClient *} client
+ * @return {static void}
+ */
+static void ll_hls_client_watch(LlHlsImpl *impl, LlHlsClient *client) {
+    struct epoll_event ev;
+    uint32_t events = EPOLLRDHUP;
+
+    if (client->closed) {
+        return;
+    }
+    if (client->state == LL_HLS_CLIENT_READING) {
+        events |= EPOLLIN;
+    }
+    if (client->want_write) {
+        events |= EPOLLOUT;
+    }
+    if (client->watch_events == events) {
+        return;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = client;
+    epoll_ctl(impl->epoll_fd, EPOLL_CTL_MOD, client->fd, &ev);
+    client->watch_events = events;
+}
+
+/**
+ * @description: 释放响应持有的内存和槽位引用
+ * @param {LlHlsClient *} client
+ * @return {static void}
+ */
+static void ll_hls_client_drop_reply(LlHlsClient *client) {
+    free(client->owned);
+    client->owned = NULL;
+    if (client->segment) {
+        client->segment->readers--;
+        client->segment = NULL;
+    }
+    client->iov_count = 0;
+    client->iov_index = 0;
+    client->pending_bytes = 0;
+}
+
+/**
+ * @description: 关闭客户端，内存等本轮事件处理完再回收
+ * @param {LlHlsImpl *} impl
+ * @param {LlHlsClient *} client
+ * @param {const char *} reason 日志中的关闭原因
+ * @return {static void}
+ */
+static void ll_hls_client_close(LlHlsImpl *impl, LlHlsClient *client, const char *reason) {
+    if (client->closed) {
+        return;
+    }
+    if (client->state != LL_HLS_CLIENT_READING || client->request_len > 0) {
+        printf("[LL-HLS] event=client_closed fd=%d reason=%s state=%d pending=%zu\n",
+               client->fd,
+               reason,
+               client->state,
+               client->pending_bytes);
+    }
+    epoll_ctl(impl->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    client->fd = -1;
+    client->closed = 1;
+    impl->live_clients--;
+    ll_hls_client_drop_reply(client);
+}
+
+/**
+ * @description: 回收已关闭的客户端
+ * @param {LlHlsImpl *} impl
+ * @return {static void}
+ */
+static void ll_hls_reap_clients(LlHlsImpl *impl) {
+    int i = 0;
+
+    while (i < impl->client_count) {
+        if (!impl->clients[i]->closed) {
+            i++;
+            continue;
+        }
+        free(impl->clients[i]);
+        impl->clients[i] = impl->clients[impl->client_count - 1];
+        impl->clients[impl->client_count - 1] = NULL;
+        impl->client_count--;
+    }
+}
+
+/**
+ * @description: 响应写完：回到收请求状态，已经收到的下一个请求立即处理
+ * @param {LlHlsImpl *} impl
+ * @param {LlHlsClient *} client
+ * @return {static void}
+ */
+static void ll_hls_client_finish_reply(LlHlsImpl *impl, LlHlsClient *client) {
+    size_t left;
+
+    ll_hls_client_drop_reply(client);
+    if (client->close_after_reply) {
+        ll_hls_client_close(impl, client, "replied");
+        return;
+    }
+    left = client->request_len - client->request_consumed;
+    memmove(client->request, client->request + client->request_consumed, left);
+    client->request_len = left;
+    client->request_consumed = 0;
+    client->request[client->request_len] = '\0';
+    client->request_ms = ll_hls_now_ms();
+    client->state = LL_HLS_CLIENT_READING;
+    client->want_write = 0;
+    ll_hls_client_watch(impl, client);
+    if (strstr(client->request, "\r\n\r\n")) {
+        ll_hls_client_handle_request(impl, client);
+    }
+}
+
+/**
+ * @description: 把已写出的字节从响应分段中扣除
+ * @param {LlHlsClient *} client
+ * @param {size_t} written
+ * @return {static void}
+ */
+static void ll_hls_client_consume(LlHlsClient *client, size_t written) {
+    client->pending_bytes -= written;
+    while (written > 0 && client->iov_index < client->iov_count) {
+        struct iovec *iov = &client->iov[client->iov_index];
+
+        if (written < iov->iov_len) {
+            iov->iov_base = (uint8_t *)iov->iov_base + written;
+            iov->iov_len -= written;
+            return;
+        }
+        written -= iov->iov_len;
+        client->iov_index++;
+    }
+}
+
+/**
+ * @description: 尽量把响应写进 socket，写不动时注册 EPOLLOUT 等待
+ * @param {LlHlsImpl *} impl
+ * @param {LlHlsClient *} client
+ * @return {static void}
+ */
+static void ll_hls_client_flush(LlHlsImpl *impl, LlHlsClient *client) {
+    struct msghdr msg;
+
+    while (client->pending_bytes > 0) {
+        ssize_t written;
+
+        /* 响应头和槽位里的各个 part 一次聚合写出，分段数据不再拷贝。 */
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &client->iov[client->iov_index];
+        msg.msg_iovlen = (size_t)(client->iov_count - client->iov_index);
+        written = sendmsg(client->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                client->want_write = 1;
+                ll_hls_client_watch(impl, client);
+                return;
+            }
+            ll_hls_client_close(impl, client, "send_error");
+            return;
+        }
+        impl->counters.bytes_sent += (uint64_t)written;
+        ll_hls_client_consume(client, (size_t)written);
+    }
+    ll_hls_client_finish_reply(impl, client);
+}
+
+/**
+ * @description: 发送固定的错误响应
+ * @param {LlHlsImpl *} impl
+ * @param {LlHlsClient *} client
+ * @param {const char *} response
+ * @param {int} close_after 写完后是否关闭连接
+ * @return {static void}
+ */
+static void ll_hls_client_reply_error(LlHlsImpl *impl, LlHlsClient *client, const char *response, int close_after) {
+    ll_hls_client_drop_reply(client);
+    if (response == LL_HLS_RESPONSE_404) {
+        impl->counters.not_found++;
+    }
+    client->iov[0].iov_base = (void *)response;
+    client->iov[0].iov_len = strlen(response);
+    client->iov_count = 1;
+    client->pending_bytes = client->iov[0].iov_len;
+    client->close_after_reply = close_after;
+    client->state = LL_HLS_CLIENT_REPLYING;
+    ll_hls_client_watch(impl, client);
+    ll_hls_client_flush(impl, client);
+}
+
+/**
+ * @description: 发送 200 响应，响应体是已经填好的 iov[1..iov_count-1]
+ * @param {LlHlsImpl *} impl
+ * @param {LlHlsClient *} client
+ * @param {const char *} content_type
+ * @param {const char *} cache_control
+ * @return {static void}
+ */
+static void ll_hls_client_reply(LlHlsImpl *impl, LlHlsClient *client, const char *content_type, const char *cache_control) {
+    size_t body = 0;
+    int len;
+    int i;
+
+    for (i = 1; i < client->iov_count; ++i) {
+        body += client->iov[i].iov_len;
+    }
+    len = snprintf(client->header,
+                   sizeof(client->header),
+                   "HTTP/1.1 200 OK\r\n"
+                   "Content-Type: %s\r\n"
+                   "Content-Length: %zu\r\n"
+                   "Cache-Control: %s\r\n"
+                   "Access-Control-Allow-Origin: *\r\n"
+                   "\r\n",
+                   content_type,
+                   body,
+                   cache_control);
+    client->iov[0].iov_base = client->header;
+    client->iov[0].iov_len = (size_t)len;
+    client->iov_index = 0;
+    client->pending_bytes = (size_t)len + body;
+    client->state = LL_HLS_CLIENT_REPLYING;
+    ll_hls_client_watch(impl, client);
+    ll_hls_client_flush(impl, client);
+}
+
+/**
+ * @description: 挂起请求直到新数据生成，已到截止时间则回 503
+ * @param {LlHlsImpl *} impl
+ * @param {LlHlsClient *} client
+ * @param {int} kind LlHlsWaitKind
+ * @param {int64_t} msn
+ * @param {int} part
+ * @return {static void}
+ */
+static void ll_hls_client_wait(LlHlsImpl *impl, LlHlsClient *client, int kind, int64_t msn, int part) {
+    if (client->state == LL_HLS_CLIENT_WAITING) {
+        if (ll_hls_now_ms() >= client->wait_deadline_ms) {
+            ll_hls_client_reply_error(impl, client, LL_HLS_RESPONSE_503, 0);
+        }
+        return;
+    }
+    /* 规范要求服务端最多挂起三个目标分段时长。 */
+    client->wait_deadline_ms = ll_hls_now_ms() + 3LL * impl->config.segment_target_ms;
+    client->wait_kind = kind;
+    client->wait_msn = msn;
+    client->wait_part = part;
+    client->state = LL_HLS_CLIENT_WAITING;
+    if (kind == LL_HLS_WAIT_PLAYLIST) {
+        impl->counters.blocked_reloads++;
+    }
+    ll_hls_client_watch(impl, client);
+}
+
+/**
+ * @description: 追加格式化文本，超出容量时截断（调用方按最坏情况分配容量）
+ * @param {char *} buf
+ * @param {size_t} cap
+ * @param {size_t *} len
+ * @param {const char *} fmt
+ * @return {static void}
+ */
+static void ll_hls_append(char *buf, size_t cap, size_t *len, const char *fmt, ...) {
+    va_list ap;
+    int n;
+
+    if (*len >= cap) {
+        return;
+    }
+    va_start(ap, fmt);
+    n = vsnprintf(buf + *len, cap - *len, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        *len += (size_t)n;
+        if (*len > cap - 1) {
+            *len = cap - 1;
+        }
+    }
+}
+
+/**
+ * @description: 生成 EXT-X-PROGRAM-DATE-TIME 的 ISO 8601 时间
+ * @param {long long} wall_ms
+ * @param {char *} out
+ * @param {size_t} cap
+ * @return {static void}
+ */
+static void ll_hls_format_pdt(long long wall_ms, char *out, size_t cap) {
+    time_t sec = (time_t)(wall_ms / 1000);
+    struct tm tm;
+    size_t len;
+
+    gmtime_r(&sec, &tm);
+    len = strftime(out, cap, "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(out + len, cap - len, ".%03dZ", (int)(wall_ms % 1000));
+}
+
+/**
+ * @description: 按当前环形缓冲内容生成媒体播放列表
+ * @param {LlHlsImpl *} impl
+ * @param {size_t *} out_len
+ * @return {static char *} 调用方负责释放，内存不足返回 NULL
+ */
+static char *ll_hls_build_playlist(LlHlsImpl *impl, size_t *out_len) {
+    int64_t live = ll_hls_live_msn(impl);
+    int64_t first = live - impl->config.playlist_segments;
+    uint64_t target_ms = impl->max_segment_ms;
+    size_t cap = 1024 + (size_t)(impl->config.playlist_segments + 1) * 256 +
+                 (size_t)LL_HLS_PART_LIST_SEGMENTS * LL_HLS_MAX_PARTS * 96;
+    char *buf;
+    size_t len = 0;
+    int64_t msn;
+    int first_listed = 1;
+
+    buf = (char *)malloc(cap);
+    if (!buf) {
+        return NULL;
+    }
+    while (first < live && !ll_hls_find_segment(impl, first)) {
+        first++;
+    }
+    if (target_ms < (uint64_t)impl->config.segment_target_ms) {
+        target_ms = (uint64_t)impl->config.segment_target_ms;
+    }
+    ll_hls_append(buf, cap, &len,
+                  "#EXTM3U\n"
+                  "#EXT-X-VERSION:9\n"
+                  "#EXT-X-TARGETDURATION:%d\n"
+                  "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=%.3f\n"
+                  "#EXT-X-PART-INF:PART-TARGET=%.3f\n"
+                  "#EXT-X-MEDIA-SEQUENCE:%" PRId64 "\n",
+                  (int)((target_ms + 999) / 1000),
+                  3.0 * impl->config.part_target_ms / 1000.0,
+                  impl->config.part_target_ms / 1000.0,
+                  first);
+    for (msn = first; msn <= live; ++msn) {
+        LlHlsSegment *seg = ll_hls_find_segment(impl, msn);
+        char pdt[40];
+        int i;
+
+        if (!seg) {
+            continue;
+        }
+        if (first_listed) {
+            if (seg->discontinuity_seq > 0) {
+                ll_hls_append(buf, cap, &len, "#EXT-X-DISCONTINUITY-SEQUENCE:%" PRIu64 "\n", seg->discontinuity_seq);
+            }
+            ll_hls_append(buf, cap, &len, "#EXT-X-MAP:URI=\"init-%d.mp4\"\n", seg->generation);
+            first_listed = 0;
+        } else if (seg->discontinuity) {
+            ll_hls_append(buf, cap, &len, "#EXT-X-DISCONTINUITY\n#EXT-X-MAP:URI=\"init-%d.mp4\"\n", seg->generation);
+        }
+        ll_hls_format_pdt(seg->pdt_ms, pdt, sizeof(pdt));
+        ll_hls_append(buf, cap, &len, "#EXT-X-PROGRAM-DATE-TIME:%s\n", pdt);
+        /* 只为最近几个分段列出 part，更早的分段播放器只会整段下载。 */
+        if (msn > live - LL_HLS_PART_LIST_SEGMENTS) {
+            for (i = 0; i < seg->part_count; ++i) {
+                ll_hls_append(buf, cap, &len,
+                              "#EXT-X-PART:DURATION=%.3f,URI=\"%" PRId64 ".%d.m4s\"%s\n",
+                              (double)seg->parts[i].duration / FMP4_TIMESCALE,
+                              msn,
+                              i,
+                              seg->parts[i].independent ? ",INDEPENDENT=YES" : "");
+            }
+        }
+        if (seg->complete) {
+            ll_hls_append(buf, cap, &len, "#EXTINF:%.3f,\n%" PRId64 ".m4s\n",
+                          (double)seg->duration / FMP4_TIMESCALE,
+                          msn);
+        }
+    }
+    if (impl->cur) {
+        ll_hls_append(buf, cap, &len, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%" PRId64 ".%d.m4s\"\n",
+                      impl->cur->msn,
+                      impl->cur->part_count);
+    } else {
+        ll_hls_append(buf, cap, &len, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%" PRId64 ".0.m4s\"\n", impl->next_msn);
+    }
+    *out_len = len;
+    return buf;
+}
+
+/**
+ * @description: 阻塞式刷新请求的播放列表版本是否已经生成
+ * @param {LlHlsImpl *} impl
+ * @param {int64_t} msn -1 表示不阻塞
+ * @param {int} part -1 表示等整段
+ * @return {static int}
+ */
+static int ll_hls_playlist_ready(LlHlsImpl *impl, int64_t msn, int part) {
+    int64_t live = ll_hls_live_msn(impl);
+
+    if (impl->counters.parts == 0) {
+        return 0;
+    }
+    if (msn < 0 || msn < live) {
+        return 1;
+    }
+    return msn == live && part >= 0 && impl->cur && impl->cur->part_count > part;
+}
+
+/**
+ * @description: 处理播放列表请求：数据还没到所请求的版本时挂起
+ * @param {LlHlsImpl *} impl
+ * @param {LlHlsClient *} client
+ * @param {int64_t} msn
+ * @param {int} part
+ * @return {static void}
+ */
+static void ll_hls_serve_playlist(LlHlsImpl *impl, LlHlsClient *client, int64_t msn, int part) {
+    size_t len = 0;
+    char *playlist;
+
+    if (!ll_hls_playlist_ready(impl, msn, part)) {
+        ll_hls_client_wait(impl, client, LL_HLS_WAIT_PLAYLIST, msn, part);
+        return;
+    }
+    playlist = ll_hls_build_playlist(impl, &len);
+    if (!playlist) {
+        fprintf(stderr, "[LL-HLS][ERROR] playlist alloc failed\n");
+        ll_hls_client_reply_error(impl, client, LL_HLS_RESPONSE_503, 0);
+        return;
+    }
+    client->owned = (uint8_t *)playlist;
+    client->iov[1].iov_base = playlist;
+    client->iov[1].iov_len = len;
+    client->iov_count = 2;
+    ll_hls_client_reply(impl, client, "application/vnd.apple.mpegurl", "no-cache");
+}
+
+/**
+ * @description: 处理 part / 分段请求：已生成的直接从槽位写出，正在生成的挂起，已淘汰的回 404
+ * @param {LlHlsImpl *} impl
+ * @param {LlHlsClient *} client
+ * @param {int64_t} msn
+ * @param {int} part -1 表示整段
+ * @return {static void}
+ */
+static void ll_hls_serve_media(LlHlsImpl *impl, LlHlsClient *client, int64_t msn, int part) {
+    LlHlsSegment *seg = ll_hls_find_segment(impl, msn);
+    int i;
+
+    if (!seg) {
+        /* 上一个分段刚结束时 PRELOAD-HINT 指向下一个分段的第一个 part。 */
+        if (msn == impl->next_msn && part <= 0) {
+            ll_hls_client_wait(impl, client, LL_HLS_WAIT_MEDIA, msn, part);
+        } else {
+            ll_hls_client_reply_error(impl, client, LL_HLS_RESPONSE_404, 0);
+        }
+        return;
+    }
+    if (part >= 0) {
+        if (part < seg->part_count) {
+            client->iov[1].iov_base = seg->data + seg->parts[part].offset;
+            client->iov[1].iov_len = seg->parts[part].size;
+            client->iov_count = 2;
+        } else if (seg == impl->cur && part == seg->part_count) {
+            ll_hls_client_wait(impl, client, LL_HLS_WAIT_MEDIA, msn, part);
+            return;
+        } else {
+            /* 分段在 hint 指向的 part 之前就在关键帧处结束了，播放器会重新拉播放列表。 */
+            ll_hls_client_reply_error(impl, client, LL_HLS_RESPONSE_404, 0);
+            return;
+        }
+    } else {
+        if (!seg->complete) {
+            ll_hls_client_wait(impl, client, LL_HLS_WAIT_MEDIA, msn, part);
+            return;
+        }
+        for (i = 0; i < seg->part_count; ++i) {
+            client->iov[i + 1].iov_base = seg->data + seg->parts[i].offset;
+            client->iov[i + 1].iov_len = seg->parts[i].size;
+        }
+        client->iov_count = seg->part_count + 1;
+    }
+    client->segment = seg;
+    seg->readers++;
+    ll_hls_client_reply(impl, client, "video/mp4", "max-age=60");
+}
+
+/**
+ * @description: 处理 init 段请求，init 段很小，直接拷贝一份给响应
+ * @param {LlHlsImpl *} impl
+ * @param {LlHlsClient *} client
+ * @param {int} generation
+ * @return {static void}
+ */
+static void ll_hls_serve_init(LlHlsImpl *impl, LlHlsClient *client, int generation) {
+    int slot = generation & 1;
+    int len = impl->init_len[slot];
+
+    if (generation < 0 || generation > impl->generation || generation < impl->generation - 1 || len <= 0) {
+        ll_hls_client_reply_error(impl, client, LL_HLS_RESPONSE_404, 0);
+        return;
+    }
+    client->owned = (uint8_t *)malloc((size_t)len);
+    if (!client->owned) {
+        ll_hls_client_reply_error(impl, client, LL_HLS_RESPONSE_503, 0);
+        return;
+    }
+    memcpy(client->owned, impl->init[slot], (size_t)len);
+    client->iov[1].iov_base = client->owned;
+    client->iov[1].iov_len = (size_t)len;
+    client->iov_count = 2;
+    ll_hls_client_reply(impl, client, "video/mp4", "max-age=60");
+}
+
+/**
+ * @description: 重新检查挂起的请求，数据已生成或已超时时给出响应
+ * @param {LlHlsImpl *} impl
+ * @param {LlHlsClient *} client
+ * @return {static void}
+ */
+static void ll_hls_client_resume(LlHlsImpl *impl, LlHlsClient *client) {
+    if (client->closed || client->state != LL_HLS_CLIENT_WAITING) {
+        return;
+    }
+    if (client->wait_kind == LL_HLS_WAIT_PLAYLIST) {
+        ll_hls_serve_playlist(impl, client, client->wait_msn, client->wait_part);
+    } else {
+        ll_hls_serve_media(impl, client, client->wait_msn, client->wait_part);
+    }
+}
+
+/**
+ * @description: 新 part 或分段完成后唤醒挂起的请求
+ * @param {LlHlsImpl *} impl
+ * @return {static void}
+ */
+static void ll_hls_wake_waiters(LlHlsImpl *impl) {
+    int i;
+
+    for (i = 0; i < impl->client_count; ++i) {
+        ll_hls_client_resume(impl, impl->clients[i]);
+    }
+}
+
+/**
+ * @description: 从查询串中读取整数参数
+ * @param {const char *} query
+ * @param {const char *} key 形如 "_HLS_msn="
+ * @param {long long *} value
+ * @return {static int} 1 找到，0 没有，-1 格式错误
+ */
+static int ll_hls_query_int(const char *query, const char *key, long long *value) {
+    const char *p;
+    char *end;
+
+    if (!query) {
+        return 0;
+    }
+    p = strstr(query, key);
+    if (!p) {
+        return 0;
+    }
+    p += strlen(key);
+    *value = strtoll(p, &end, 10);
+    if (end == p || *value < 0 || (*end != '\0' && *end != '&')) {
+        return -1;
+    }
+    return 1;
+}
+
+/**
+ * @description: 解析请求行并分派：播放列表、init 段、分段或 part
+ * @param {LlHlsImpl *} impl
+ * @param {LlHlsClient *} client
+ * @return {static void}
+ */
+static void ll_hls_client_handle_request(LlHlsImpl *impl, LlHlsClient *client) {
+    char *header_end = strstr(client->request, "\r\n\r\n");
+    size_t prefix_len = strlen(impl->prefix);
+    char *target;
+    char *target_end;
+    char *query;
+    char *name;
+    long long msn = -1;
+    long long part = -1;
+    int generation;
+    int consumed;
+    int has_msn;
+    int has_part;
+
+    client->request_consumed = (size_t)(header_end - client->request) + 4;
+    impl->counters.requests++;
+    impl->request_seen_ms = ll_hls_now_ms();
+    if (strncmp(client->request, "GET ", 4) != 0) {
+        ll_hls_client_reply_error(impl, client, LL_HLS_RESPONSE_400, 1);
+        return;
+    }
+    target = client->request + 4;
+    target_end = strpbrk(target, " \r\n");
+    *target_end = '\0';
+    query = strchr(target, '?');
+    if (query) {
+        *query++ = '\0';
+    }
+    if (strncmp(target, impl->prefix, prefix_len) != 0) {
+        fprintf(stderr, "[WARN] LL-HLS reject fd=%d path=%s expect=%s*\n", client->fd, target, impl->prefix);
+        ll_hls_client_reply_error(impl, client, LL_HLS_RESPONSE_404, 0);
+        return;
+    }
+    name = target + prefix_len;
+
+    if (strcmp(name, "index.m3u8") == 0) {
+        impl->counters.playlist_requests++;
+        has_msn = ll_hls_query_int(query, "_HLS_msn=", &msn);
+        has_part = ll_hls_query_int(query, "_HLS_part=", &part);
+        /* _HLS_part 必须和 _HLS_msn 一起出现；请求过远的未来版本直接回 400。 */
+        if (has_msn < 0 || has_part < 0 || (has_part > 0 && has_msn <= 0) ||
+            (has_msn > 0 && msn > ll_hls_live_msn(impl) + 2)) {
+            ll_hls_client_reply_error(impl, client, LL_HLS_RESPONSE_400, 1);
+            return;
+        }
+        ll_hls_serve_playlist(impl, client, has_msn > 0 ? msn : -1, has_part > 0 ? (int)part : -1);
+        return;
+    }
+    consumed = 0;
+    if (sscanf(name, "init-%d.mp4%n", &generation, &consumed) == 1 && consumed > 0 && name[consumed] == '\0') {
+        ll_hls_serve_init(impl, client, generation);
+        return;
+    }
+    consumed = 0;
+    if (sscanf(name, "%lld.%lld.m4s%n", &msn, &part, &consumed) == 2 && consumed > 0 && name[consumed] == '\0' &&
+        msn >= 0 && part >= 0 && part < LL_HLS_MAX_PARTS) {
+        impl->counters.part_requests++;
+        ll_hls_serve_media(impl, client, msn, (int)part);
+        return;
+    }
+    consumed = 0;
+    if (sscanf(name, "%lld.m4s%n", &msn, &consumed) == 1 && consumed > 0 && name[consumed] == '\0' && msn >= 0) {
+        impl->counters.segment_requests++;
+        ll_hls_serve_media(impl, client, msn, -1);
+        return;
+    }
+    ll_hls_client_reply_error(impl, client, LL_HLS_RESPONSE_404, 0);
+}
+
+/**
+ * @description: 处理客户端可读事件：收请求头，收齐后分派
+ * @param {LlHlsImpl *} impl
+ * @param {LlHlsClient *} client
+ * @return {static void}
+ */
+static void ll_hls_client_read(LlHlsImpl *impl, LlHlsClient *client) {
+    while (!client->closed && client->state == LL_HLS_CLIENT_READING) {
+        size_t room = sizeof(client->request) - 1 - client->request_len;
+        ssize_t n;
+
+        if (room == 0) {
+            ll_hls_client_reply_error(impl, client, LL_HLS_RESPONSE_400, 1);
+            return;
+        }
+        n = recv(client->fd, client->request + client->request_len, room, MSG_DONTWAIT);
+        if (n == 0) {
+            ll_hls_client_close(impl, client, "peer_closed");
+            return;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                ll_hls_client_close(impl, client, "recv_error");
+            }
+            return;
+        }
+        if (client->request_len == 0) {
+            client->request_ms = ll_hls_now_ms();
+        }
+        client->request_len += (size_t)n;
+        client->request[client->request_len] = '\0';
+        if (strstr(client->request, "\r\n\r\n")) {
+            ll_hls_client_handle_request(impl, client);
+        }
+    }
+}
+
+/**
+ * @description: 接入新连接，连接数超出上限时直接关闭
+ * @param {LlHlsImpl *} impl
+ * @return {static void}
+ */
+static void ll_hls_accept(LlHlsImpl *impl) {
+    while (1) {
+        struct epoll_event ev;
+        LlHlsClient *client;
+        int one = 1;
+        int fd;
+
+        fd = accept4(impl->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        /* 只按未关闭的连接数限制；数组位置不够（同一轮关闭过多）时同样拒绝。 */
+        if (impl->live_clients >= impl->config.max_clients || impl->client_count >= impl->client_capacity) {
+            close(fd);
+            continue;
+        }
+        client = (LlHlsClient *)calloc(1, sizeof(*client));
+        if (!client) {
+            fprintf(stderr, "[LL-HLS][ERROR] client alloc failed\n");
+            close(fd);
+            continue;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        client->fd = fd;
+        client->request_ms = ll_hls_now_ms();
+        client->watch_events = EPOLLIN | EPOLLRDHUP;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = client->watch_events;
+        ev.data.ptr = client;
+        if (epoll_ctl(impl->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            fprintf(stderr, "[LL-HLS][ERROR] epoll add client failed errno=%d\n", errno);
+            close(fd);
+            free(client);
+            continue;
+        }
+        impl->clients[impl->client_count++] = client;
+        impl->live_clients++;
+    }
+}
+
+/**
+ * @description: 关闭超时的请求和长时间空闲的长连接，挂起到期的请求回 503
+ * @param {LlHlsImpl *} impl
+ * @return {static void}
+ */
+static void ll_hls_expire_clients(LlHlsImpl *impl) {
+    long long now = ll_hls_now_ms();
+    int i;
+
+    for (i = 0; i < impl->client_count; ++i) {
+        LlHlsClient *client = impl->clients[i];
+
+        if (client->closed) {
+            continue;
+        }
+        if (client->state == LL_HLS_CLIENT_WAITING) {
+            if (now >= client->wait_deadline_ms) {
+                ll_hls_client_resume(impl, client);
+            }
+        } else if (client->state == LL_HLS_CLIENT_READING) {
+            if (client->request_len > 0 && now - client->request_ms > LL_HLS_REQUEST_TIMEOUT_MS) {
+                ll_hls_client_close(impl, client, "request_timeout");
+            } else if (client->request_len == 0 && now - client->request_ms > LL_HLS_IDLE_TIMEOUT_MS) {
+                ll_hls_client_close(impl, client, "idle_timeout");
+            }
+        }
+    }
+}
+
+/**
+ * @description: 确定当前 part 最后一个样本的时长并计入 part 时长
+ * @param {LlHlsImpl *} impl
+ * @param {uint32_t} duration 样本时长（FMP4_TIMESCALE）
+ * @return {static void}
+ */
+static void ll_hls_settle_sample(LlHlsImpl *impl, uint32_t duration) {
+    if (!impl->sample_held || impl->sample_count == 0) {
+        return;
+    }
+    if (duration == 0) {
+        duration = 1;
+    }
+    impl->samples[impl->sample_count - 1].duration = duration;
+    impl->part_duration += duration;
+    impl->sample_held = 0;
+}
+
+/**
+ * @description: 结束当前 part：在样本数据前回填 moof + mdat 头，并唤醒等它的请求
+ * @param {LlHlsImpl *} impl
+ * @return {static void}
+ */
+static void ll_hls_close_part(LlHlsImpl *impl) {
+    LlHlsSegment *seg = impl->cur;
+    LlHlsPart *part;
+    size_t header_size;
+
+    if (!seg || impl->sample_count == 0) {
+        return;
+    }
+    /* 换 init 段、槽位写满等情况下没等到下一帧，最后一个样本按最近的帧时长计。 */
+    ll_hls_settle_sample(impl, impl->sample_estimate);
+    header_size = fmp4_fragment_header_size(impl->sample_count);
+    part = &seg->parts[seg->part_count];
+    part->offset = impl->part_payload - header_size;
+    part->size = header_size + (impl->write_pos - impl->part_payload);
+    part->duration = impl->part_duration;
+    part->independent = impl->samples[0].is_key_frame;
+    fmp4_write_fragment_header(seg->data + part->offset,
+                               ++impl->fragment_sequence,
+                               impl->part_base_dts,
+                               impl->samples,
+                               impl->sample_count);
+    seg->part_count++;
+    seg->duration += impl->part_duration;
+    impl->part_end_dts = impl->part_base_dts + impl->part_duration;
+    impl->sample_count = 0;
+    impl->part_duration = 0;
+    impl->counters.parts++;
+    ll_hls_wake_waiters(impl);
+}
+
+/**
+ * @description: 结束当前分段，没有任何 part 的空分段直接作废并回收序号
+ * @param {LlHlsImpl *} impl
+ * @return {static void}
+ */
+static void ll_hls_close_segment(LlHlsImpl *impl) {
+    LlHlsSegment *seg = impl->cur;
+    uint64_t duration_ms;
+
+    if (!seg) {
+        return;
+    }
+    ll_hls_close_part(impl);
+    impl->cur = NULL;
+    if (seg->part_count == 0) {
+        impl->next_msn = seg->msn;
+        if (seg->discontinuity) {
+            impl->pending_discontinuity = 1;
+            impl->discontinuity_seq--;
+        }
+        seg->msn = -1;
+        return;
+    }
+    seg->complete = 1;
+    duration_ms = seg->duration * 1000 / FMP4_TIMESCALE;
+    if (duration_ms > impl->max_segment_ms) {
+        impl->max_segment_ms = duration_ms;
+    }
+    impl->counters.segments++;
+    ll_hls_wake_waiters(impl);
+}
+
+/**
+ * @description: 在下一个槽位开始新分段，槽位里旧分段还有客户端在读时断开这些客户端
+ * @param {LlHlsImpl *} impl
+ * @return {static void}
+ */
+static void ll_hls_start_segment(LlHlsImpl *impl) {
+    LlHlsSegment *seg = &impl->ring[impl->next_msn % impl->slot_count];
+    int i;
+
+    if (seg->readers > 0) {
+        for (i = 0; i < impl->client_count; ++i) {
+            if (impl->clients[i]->segment == seg) {
+                ll_hls_client_close(impl, impl->clients[i], "segment_evicted");
+            }
+        }
+    }
+    seg->msn = impl->next_msn++;
+    seg->generation = impl->generation;
+    seg->discontinuity = impl->pending_discontinuity;
+    seg->discontinuity_seq = impl->discontinuity_seq;
+    seg->complete = 0;
+    seg->part_count = 0;
+    seg->duration = 0;
+    seg->pdt_ms = ll_hls_wall_ms();
+    impl->pending_discontinuity = 0;
+    impl->cur = seg;
+    impl->write_pos = 0;
+    impl->sample_count = 0;
+    impl->part_duration = 0;
+    impl->sample_held = 0;
+}
+
+/**
+ * @description: 把一帧写进当前 part，必要时先开一个新 part
+ * @param {LlHlsImpl *} impl
+ * @param {const MediaPacket *} packet
+ * @param {uint64_t} dts 解码时间（FMP4_TIMESCALE）
+ * @return {static int} 0 成功，1 帧里没有可写的 NALU，-1 槽位剩余空间不足
+ */
+static int ll_hls_append_sample(LlHlsImpl *impl, const MediaPacket *packet, uint64_t dts) {
+    LlHlsSegment *seg = impl->cur;
+    size_t reserve = fmp4_fragment_header_size(LL_HLS_MAX_PART_SAMPLES);
+    size_t start = impl->write_pos;
+    size_t written;
+    int nalu_count = 0;
+
+    if (impl->sample_count == 0) {
+        /* 片段头长度取决于样本数，先按最大样本数预留，part 结束时回填到紧贴样本数据的位置。 */
+        if (start + reserve >= impl->slot_bytes) {
+            return -1;
+        }
+        impl->part_payload = start + reserve;
+        impl->write_pos = impl->part_payload;
+        impl->part_base_dts = dts;
+        impl->part_start_ms = ll_hls_now_ms();
+    }
+    written = fmp4_annexb_to_avcc(packet->buffer->data,
+                                  packet->buffer->size,
+                                  seg->data + impl->write_pos,
+                                  impl->slot_bytes - impl->write_pos,
+                                  &nalu_count);
+    if (written == 0) {
+        if (impl->sample_count == 0) {
+            impl->write_pos = start;
+        }
+        return nalu_count == 0 ? 1 : -1;
+    }
+    /* 时长等下一帧的 DTS 到达后再定，见 ll_hls_settle_sample。 */
+    impl->samples[impl->sample_count].size = (uint32_t)written;
+    impl->samples[impl->sample_count].duration = 0;
+    impl->samples[impl->sample_count].is_key_frame = packet->is_key_frame;
+    impl->sample_count++;
+    impl->sample_held = 1;
+    impl->write_pos += written;
+    return 0;
+}
+
+/**
+ * @description: SPS/PPS 变化时重建 init 段，已有分段的话结束它并让下一个分段标记不连续
+ * @param {LlHlsImpl *} impl
+ * @return {static int} 0 成功，-1 参数集不完整
+ */
+static int ll_hls_rebuild_init(LlHlsImpl *impl) {
+    int generation = impl->init_len[impl->generation & 1] > 0 ? impl->generation + 1 : impl->generation;
+    int slot = generation & 1;
+    int len;
+
+    len = fmp4_build_init_segment(impl->init[slot],
+                                  sizeof(impl->init[slot]),
+                                  &impl->params,
+                                  impl->config.video_width,
+                                  impl->config.video_height);
+    if (len < 0) {
+        fprintf(stderr, "[LL-HLS][ERROR] init segment build failed path=%sinit-%d.mp4 sps=%zu pps=%zu cap=%zu\n",
+                impl->prefix,
+                generation,
+                impl->params.sps_len,
+                impl->params.pps_len,
+                sizeof(impl->init[slot]));
+        return -1;
+    }
+    impl->init_len[slot] = len;
+    if (generation != impl->generation) {
+        ll_hls_close_segment(impl);
+        impl->generation = generation;
+        impl->pending_discontinuity = 1;
+        impl->discontinuity_seq++;
+    }
+    printf("[LL-HLS] event=init_segment path=%sinit-%d.mp4 bytes=%d\n", impl->prefix, generation, len);
+    return 0;
+}
+
+/**
+ * @description: 把一帧封装进环形缓冲：先用这一帧的 DTS 确定上一个样本的时长，part 按 DTS 已满目标时长
+ *               （再放一帧会超出）时结束；关键帧且当前分段达到目标时长时切分段
+ * @param {LlHlsImpl *} impl
+ * @param {const MediaPacket *} packet
+ * @return {static void}
+ */
+static void ll_hls_mux_frame(LlHlsImpl *impl, const MediaPacket *packet) {
+    uint64_t dts_us = packet->dts_us ? packet->dts_us : packet->pts_us;
+    uint64_t dts;
+    int rc;
+
+    if (packet->is_key_frame && fmp4_cache_param_sets(packet->buffer->data, packet->buffer->size, &impl->params)) {
+        ll_hls_rebuild_init(impl);
+    }
+    if (impl->init_len[impl->generation & 1] == 0) {
+        return;
+    }
+    if (impl->mux_need_keyframe) {
+        if (!packet->is_key_frame) {
+            impl->counters.overflow_drops++;
+            return;
+        }
+        impl->mux_need_keyframe = 0;
+    }
+    if (!impl->cur && !packet->is_key_frame) {
+        return;
+    }
+
+    if (!impl->have_timeline) {
+        impl->dts_base_us = dts_us;
+        impl->have_timeline = 1;
+    }
+    dts = dts_us > impl->dts_base_us ? (dts_us - impl->dts_base_us) * 9 / 100 : 0;
+    if (impl->cur && dts <= impl->last_dts) {
+        dts = impl->last_dts + impl->frame_duration;
+    }
+    if (impl->cur && dts < impl->part_end_dts) {
+        /* 上一个 part 按墙钟结束时最后一帧的时长是补的，新样本不能落进它的时间范围。 */
+        dts = impl->part_end_dts;
+    }
+    if (impl->cur && impl->sample_held) {
+        /* 上一帧的时长取实际的 DTS 差，异常跳变时用最近的帧时长。 */
+        uint64_t delta = dts - impl->last_dts;
+        uint32_t duration = impl->sample_estimate;
+
+        if (delta > 0 && delta <= 10ULL * impl->frame_duration) {
+            duration = (uint32_t)delta;
+            impl->sample_estimate = duration;
+        }
+        ll_hls_settle_sample(impl, duration);
+    }
+    if (impl->cur && impl->sample_count > 0 &&
+        (impl->part_duration + impl->sample_estimate > impl->part_target ||
+         impl->sample_count >= LL_HLS_MAX_PART_SAMPLES)) {
+        ll_hls_close_part(impl);
+    }
+    if (impl->cur && packet->is_key_frame && impl->cur->duration + impl->part_duration >= impl->segment_target) {
+        ll_hls_close_segment(impl);
+    }
+    if (impl->cur && impl->sample_count == 0 && impl->cur->part_count >= LL_HLS_MAX_PARTS) {
+        /* GOP 远长于目标分段时只能在非关键帧处切开，新分段的 part 不标 INDEPENDENT。 */
+        ll_hls_close_segment(impl);
+    }
+    if (!impl->cur) {
+        ll_hls_start_segment(impl);
+    }
+
+    rc = ll_hls_append_sample(impl, packet, dts);
+    if (rc < 0 && (impl->cur->part_count > 0 || impl->sample_count > 0)) {
+        /* 槽位写满就提前结束分段，换下一个槽位继续。 */
+        ll_hls_close_segment(impl);
+        ll_hls_start_segment(impl);
+        rc = ll_hls_append_sample(impl, packet, dts);
+    }
+    if (rc < 0) {
+        fprintf(stderr, "[WARN] LL-HLS frame=%" PRIu64 " size=%zu exceeds segment slot=%zu, wait next keyframe\n",
+                packet->frame_id,
+                packet->buffer->size,
+                impl->slot_bytes);
+        impl->counters.overflow_drops++;
+        impl->mux_need_keyframe = 1;
+        ll_hls_close_segment(impl);
+        return;
+    }
+    if (rc > 0) {
+        return;
+    }
+    impl->last_dts = dts;
+    impl->counters.frames++;
+}
+
+/**
+ * @description: 下一帧迟迟不到（断流、实际帧率低于配置）时按墙钟结束 part，挂起的请求不必一直等；
+ *               part 开始后超过目标时长再加一帧仍没有新帧时触发，最后一帧的时长补到 part 目标时长
+ * @param {LlHlsImpl *} impl
+ * @return {static void}
+ */
+static void ll_hls_close_stale_part(LlHlsImpl *impl) {
+    long long frame_ms = (long long)impl->frame_duration * 1000 / FMP4_TIMESCALE;
+    uint64_t elapsed;
+
+    if (!impl->cur || impl->sample_count == 0 || !impl->sample_held) {
+        return;
+    }
+    if (ll_hls_now_ms() - impl->part_start_ms < (long long)impl->config.part_target_ms + frame_ms) {
+        return;
+    }
+    elapsed = impl->last_dts - impl->part_base_dts;
+    ll_hls_settle_sample(impl,
+                         elapsed < impl->part_target ? (uint32_t)(impl->part_target - elapsed) : impl->sample_estimate);
+    ll_hls_close_part(impl);
+}
+
+/**
+ * @description: 取出 inbox 队头的帧引用
+ * @param {LlHlsImpl *} impl
+ * @param {MediaPacket *} packet 输出，引用转交给调用方
+ * @return {static int} 1 取到，0 队列为空
+ */
+static int ll_hls_inbox_pop(LlHlsImpl *impl, MediaPacket *packet) {
+    int got = 0;
+
+    pthread_mutex_lock(&impl->lock);
+    if (impl->inbox_size > 0) {
+        *packet = impl->inbox[impl->inbox_head];
+        media_packet_init(&impl->inbox[impl->inbox_head]);
+        impl->inbox_head = (impl->inbox_head + 1) % impl->inbox_capacity;
+        impl->inbox_size--;
+        got = 1;
+    }
+    pthread_mutex_unlock(&impl->lock);
+    return got;
+}
+
+/**
+ * @description: 把服务线程的累计统计发布给外部
+ * @param {LlHlsImpl *} impl
+ * @return {static void}
+ */
+static void ll_hls_publish_stats(LlHlsImpl *impl) {
+    impl->counters.clients = impl->live_clients;
+    pthread_mutex_lock(&impl->lock);
+    impl->stats = impl->counters;
+    if (impl->request_seen_ms > impl->last_request_ms) {
+        impl->last_request_ms = impl->request_seen_ms;
+    }
+    pthread_mutex_unlock(&impl->lock);
+}
+
+/**
+ * @description: 服务线程主函数：单个 epoll 同时处理监听、新帧封装和所有客户端读写
+ * @param {void *} arg
+ * @return {static void *}
+ */
+static void *ll_hls_server_thread(void *arg) {
+    LlHlsImpl *impl = (LlHlsImpl *)arg;
+    struct epoll_event events[LL_HLS_EPOLL_EVENTS];
+
+    while (!impl->stop_requested) {
+        int n = epoll_wait(impl->epoll_fd, events, LL_HLS_EPOLL_EVENTS, LL_HLS_EPOLL_TIMEOUT_MS);
+        int i;
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "[LL-HLS][ERROR] epoll_wait failed errno=%d\n", errno);
+            break;
+        }
+        for (i = 0; i < n; ++i) {
+            void *ptr = events[i].data.ptr;
+
+            if (ptr == &impl->listen_fd) {
+                ll_hls_accept(impl);
+            } else if (ptr == &impl->event_fd) {
+                MediaPacket packet;
+                uint64_t value;
+
+                if (read(impl->event_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                    fprintf(stderr, "[LL-HLS][ERROR] eventfd read failed errno=%d\n", errno);
+                }
+                while (!impl->stop_requested && ll_hls_inbox_pop(impl, &packet)) {
+                    ll_hls_mux_frame(impl, &packet);
+                    media_packet_reset(&packet);
+                }
+            } else {
+                LlHlsClient *client = (LlHlsClient *)ptr;
+
+                if (client->closed) {
+                    continue;
+                }
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    ll_hls_client_close(impl, client, "socket_error");
+                    continue;
+                }
+                if (events[i].events & EPOLLIN) {
+                    ll_hls_client_read(impl, client);
+                } else if ((events[i].events & EPOLLRDHUP) && client->state != LL_HLS_CLIENT_READING) {
+                    /* 挂起或写响应时不读 socket，对端关闭只能从 RDHUP 得知。 */
+                    ll_hls_client_close(impl, client, "peer_closed");
+                    continue;
+                }
+                if (!client->closed && client->state == LL_HLS_CLIENT_REPLYING && (events[i].events & EPOLLOUT)) {
+                    ll_hls_client_flush(impl, client);
+                }
+            }
+        }
+        ll_hls_close_stale_part(impl);
+        ll_hls_expire_clients(impl);
+        ll_hls_reap_clients(impl);
+        ll_hls_publish_stats(impl);
+    }
+    return NULL;
+}
+
+/**
+ * @description: 打印运行统计
+ * @param {LlHlsImpl *} impl
+ * @return {static void}
+ */
+static void ll_hls_print_stats(LlHlsImpl *impl) {
+    LlHlsSinkStats stats;
+    uint64_t inbox_drops;
+
+    pthread_mutex_lock(&impl->lock);
+    stats = impl->stats;
+    inbox_drops = impl->inbox_drops;
+    pthread_mutex_unlock(&impl->lock);
+    printf("[LL-HLS] event=stats path=%sindex.m3u8 clients=%d requests=%llu playlists=%llu blocked=%llu parts_req=%llu segments_req=%llu not_found=%llu frames=%llu segments=%llu parts=%llu overflow_drops=%llu inbox_drops=%llu bytes_sent=%llu ring_bytes=%llu\n",
+           impl->prefix,
+           stats.clients,
+           (unsigned long long)stats.requests,
+           (unsigned long long)stats.playlist_requests,
+           (unsigned long long)stats.blocked_reloads,
+           (unsigned long long)stats.part_requests,
+           (unsigned long long)stats.segment_requests,
+           (unsigned long long)stats.not_found,
+           (unsigned long long)stats.frames,
+           (unsigned long long)stats.segments,
+           (unsigned long long)stats.parts,
+           (unsigned long long)stats.overflow_drops,
+           (unsigned long long)inbox_drops,
+           (unsigned long long)stats.bytes_sent,
+           (unsigned long long)stats.ring_bytes);
+}
+
+/**
+ * @description: 周期统计钩子
+ * @param {MediaSink *} sink
+ * @return {static void}
+ */
+static void ll_hls_log_stats(MediaSink *sink) {
+    LlHlsImpl *impl = (LlHlsImpl *)sink->impl;
+
+    if (impl && impl->running) {
+        ll_hls_print_stats(impl);
+    }
+}
+
+/**
+ * @description: 关闭服务端 socket，释放连接、inbox 和分段环形缓冲，可重复调用
+ * @param {LlHlsImpl *} impl
+ * @return {static void}
+ */
+static void ll_hls_release_server(LlHlsImpl *impl) {
+    MediaPacket packet;
+    int i;
+
+    for (i = 0; i < impl->client_count; ++i) {
+        ll_hls_client_close(impl, impl->clients[i], "shutdown");
+    }
+    ll_hls_reap_clients(impl);
+    if (impl->inbox) {
+        while (ll_hls_inbox_pop(impl, &packet)) {
+            media_packet_reset(&packet);
+        }
+    }
+    if (impl->epoll_fd >= 0) {
+        close(impl->epoll_fd);
+        impl->epoll_fd = -1;
+    }
+    if (impl->event_fd >= 0) {
+        close(impl->event_fd);
+        impl->event_fd = -1;
+    }
+    if (impl->listen_fd >= 0) {
+        close(impl->listen_fd);
+        impl->listen_fd = -1;
+    }
+    free(impl->inbox);
+    impl->inbox = NULL;
+    free(impl->clients);
+    impl->clients = NULL;
+    free(impl->ring);
+    impl->ring = NULL;
+    free(impl->ring_data);
+    impl->ring_data = NULL;
+    impl->cur = NULL;
+    pthread_mutex_lock(&impl->lock);
+    impl->inbox_head = 0;
+    impl->inbox_size = 0;
+    impl->stats.clients = 0;
+    pthread_mutex_unlock(&impl->lock);
+}
+
+/**
+ * @description: 复位封装状态，重新启动后从新的 init 段和分段序号开始
+ * @param {LlHlsImpl *} impl
+ * @return {static void}
+ */
+static void ll_hls_reset_mux(LlHlsImpl *impl) {
+    memset(&impl->params, 0, sizeof(impl->params));
+    memset(&impl->counters, 0, sizeof(impl->counters));
+    impl->init_len[0] = 0;
+    impl->init_len[1] = 0;
+    impl->generation = 0;
+    impl->pending_discontinuity = 0;
+    impl->discontinuity_seq = 0;
+    impl->cur = NULL;
+    impl->next_msn = 0;
+    impl->mux_need_keyframe = 0;
+    impl->sample_count = 0;
+    impl->part_duration = 0;
+    impl->sample_held = 0;
+    impl->sample_estimate = impl->frame_duration;
+    impl->part_end_dts = 0;
+    impl->fragment_sequence = 0;
+    impl->have_timeline = 0;
+    impl->last_dts = 0;
+    impl->max_segment_ms = 0;
+    impl->request_seen_ms = 0;
+}
+
+/**
+ * @description: 创建非阻塞监听 socket
+ * @param {const LlHlsSinkConfig *} config
+ * @return {static int} socket，失败返回 -1
+ */
+static int ll_hls_listen(const LlHlsSinkConfig *config) {
+    struct sockaddr_in addr;
+    int one = 1;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)config->listen_port);
+    if (inet_pton(AF_INET, config->listen_ip, &addr.sin_addr) != 1) {
+        fprintf(stderr, "[LL-HLS][ERROR] invalid listen_ip=%s\n", config->listen_ip);
+        return -1;
+    }
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "[LL-HLS][ERROR] socket failed errno=%d\n", errno);
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+        fprintf(stderr, "[LL-HLS][ERROR] bind/listen %s:%d failed errno=%d\n",
+                config->listen_ip,
+                config->listen_port,
+                errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @description: 启动 HTTP 服务：分配分段环形缓冲、监听端口、创建 epoll 并拉起服务线程
+ * @param {MediaSink *} sink
+ * @return {static int}
+ */
+static int ll_hls_start(MediaSink *sink) {
+    LlHlsImpl *impl = (LlHlsImpl *)sink->impl;
+    struct epoll_event ev;
+    int i;
+
+    ll_hls_reset_mux(impl);
+    impl->inbox = (MediaPacket *)calloc((size_t)impl->inbox_capacity, sizeof(MediaPacket));
+    impl->clients = (LlHlsClient **)calloc((size_t)impl->client_capacity, sizeof(LlHlsClient *));
+    impl->ring = (LlHlsSegment *)calloc((size_t)impl->slot_count, sizeof(LlHlsSegment));
+    impl->ring_data = (uint8_t *)malloc((size_t)impl->slot_count * impl->slot_bytes);
+    if (!impl->inbox || !impl->clients || !impl->ring || !impl->ring_data) {
+        fprintf(stderr, "[LL-HLS][ERROR] start failed: ring alloc slots=%d slot_bytes=%zu\n",
+                impl->slot_count,
+                impl->slot_bytes);
+        ll_hls_release_server(impl);
+        return -1;
+    }
+    for (i = 0; i < impl->inbox_capacity; ++i) {
+        media_packet_init(&impl->inbox[i]);
+    }
+    for (i = 0; i < impl->slot_count; ++i) {
+        impl->ring[i].msn = -1;
+        impl->ring[i].data = impl->ring_data + (size_t)i * impl->slot_bytes;
+    }
+    impl->counters.ring_bytes = (uint64_t)impl->slot_count * impl->slot_bytes;
+
+    impl->listen_fd = ll_hls_listen(&impl->config);
+    if (impl->listen_fd < 0) {
+        ll_hls_release_server(impl);
+        return -1;
+    }
+    impl->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    impl->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (impl->event_fd < 0 || impl->epoll_fd < 0) {
+        fprintf(stderr, "[LL-HLS][ERROR] eventfd/epoll create failed errno=%d\n", errno);
+        ll_hls_release_server(impl);
+        return -1;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = &impl->listen_fd;
+    if (epoll_ctl(impl->epoll_fd, EPOLL_CTL_ADD, impl->listen_fd, &ev) != 0) {
+        fprintf(stderr, "[LL-HLS][ERROR] epoll add listen failed errno=%d\n", errno);
+        ll_hls_release_server(impl);
+        return -1;
+    }
+    ev.data.ptr = &impl->event_fd;
+    if (epoll_ctl(impl->epoll_fd, EPOLL_CTL_ADD, impl->event_fd, &ev) != 0) {
+        fprintf(stderr, "[LL-HLS][ERROR] epoll add eventfd failed errno=%d\n", errno);
+        ll_hls_release_server(impl);
+        return -1;
+    }
+    ll_hls_publish_stats(impl);
+
+    impl->stop_requested = 0;
+    if (pthread_create(&impl->thread, NULL, ll_hls_server_thread, impl) != 0) {
+        fprintf(stderr, "[LL-HLS][ERROR] start failed: pthread_create\n");
+        ll_hls_release_server(impl);
+        return -1;
+    }
+    impl->running = 1;
+    printf("[INFO] LL-HLS serving http://%s:%d%sindex.m3u8 ring=%d x %zu bytes (%llu KB)\n",
+           impl->config.listen_ip,
+           impl->config.listen_port,
+           impl->prefix,
+           impl->slot_count,
+           impl->slot_bytes,
+           (unsigned long long)(impl->counters.ring_bytes / 1024));
+    return 0;
+}
+
+/**
+ * @description: LL-HLS 由客户端拉流，没有需要建立的下游连接
+ * @param {MediaSink *} sink
+ * @return {static int}
+ */
+static int ll_hls_connect(MediaSink *sink) {
+    (void)sink;
+    return 0;
+}
+
+/**
+ * @description: 把帧引用投递给服务线程封装，服务线程跟不上时丢到下一个关键帧
+ * @param {MediaSink *} sink
+ * @param {const MediaPacket *} packet
+ * @return {static int}
+ */
+static int ll_hls_send_packet(MediaSink *sink, const MediaPacket *packet) {
+    LlHlsImpl *impl = (LlHlsImpl *)sink->impl;
+    uint64_t one = 1;
+    int tail;
+
+    if (!impl || !packet || !packet->buffer) {
+        return -1;
+    }
+    if (packet->frame_type != MEDIA_FRAME_TYPE_VIDEO || packet->codec != MEDIA_CODEC_H264) {
+        return 0;
+    }
+    if (impl->inbox_need_keyframe && !packet->is_key_frame) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&impl->lock);
+    if (impl->inbox_size >= impl->inbox_capacity) {
+        impl->inbox_drops++;
+        pthread_mutex_unlock(&impl->lock);
+        impl->inbox_need_keyframe = 1;
+        return 0;
+    }
+    tail = (impl->inbox_head + impl->inbox_size) % impl->inbox_capacity;
+    media_packet_copy_ref(&impl->inbox[tail], packet);
+    impl->inbox_size++;
+    pthread_mutex_unlock(&impl->lock);
+    impl->inbox_need_keyframe = 0;
+
+    if (write(impl->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        fprintf(stderr, "[LL-HLS][ERROR] eventfd write failed errno=%d\n", errno);
+    }
+    return 0;
+}
+
+/**
+ * @description: 最近一段时间内是否有播放器来拉过流；HLS 是短请求，不能按当前连接数判断
+ * @param {MediaSink *} sink
+ * @return {static int}
+ */
+static int ll_hls_has_consumer(MediaSink *sink) {
+    LlHlsImpl *impl = (LlHlsImpl *)sink->impl;
+    long long last;
+
+    if (!impl) {
+        return 0;
+    }
+    pthread_mutex_lock(&impl->lock);
+    last = impl->last_request_ms;
+    pthread_mutex_unlock(&impl->lock);
+    return last > 0 && ll_hls_now_ms() - last < LL_HLS_CONSUMER_IDLE_MS;
+}
+
+/**
+ * @description: 停止服务线程并释放所有连接和分段缓存，可重复调用
+ * @param {MediaSink *} sink
+ * @return {static void}
+ */
+static void ll_hls_stop(MediaSink *sink) {
+    LlHlsImpl *impl = (LlHlsImpl *)sink->impl;
+    uint64_t one = 1;
+
+    if (!impl) {
+        return;
+    }
+    if (impl->running) {
+        impl->stop_requested = 1;
+        if (write(impl->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            fprintf(stderr, "[LL-HLS][ERROR] eventfd wake failed errno=%d\n", errno);
+        }
+        pthread_join(impl->thread, NULL);
+        impl->running = 0;
+        ll_hls_print_stats(impl);
+    }
+    ll_hls_release_server(impl);
+    impl->inbox_need_keyframe = 0;
+}
+
+int ll_hls_sink_get_stats(MediaSink *sink, LlHlsSinkStats *stats) {
+    LlHlsImpl *impl = sink ? (LlHlsImpl *)sink->impl : NULL;
+
+    if (!impl || !stats) {
+        return -1;
+    }
+    pthread_mutex_lock(&impl->lock);
+    *stats = impl->stats;
+    pthread_mutex_unlock(&impl->lock);
+    return 0;
+}
+
+/**
+ * @description: 根据配置创建 LL-HLS 输出通道
+ * @param {MediaSink *} sink
+ * @param {const LlHlsSinkConfig *} config
+ * @return {int}
+ */
+int ll_hls_sink_setup(MediaSink *sink, const LlHlsSinkConfig *config) {
+    static const MediaSinkVTable vtable = {
+        ll_hls_start,
+        ll_hls_connect,
+        ll_hls_send_packet,
+        NULL,
+        ll_hls_stop,
+        ll_hls_has_consumer,
+        ll_hls_log_stats
+    };
+    MediaSinkConfig sink_config;
+    LlHlsImpl *impl;
+    uint64_t slot_bytes;
+    int frame_ms;
+
+    if (!sink || !config) {
+        fprintf(stderr, "[LL-HLS][ERROR] setup failed: invalid arguments\n");
+        return -1;
+    }
+
+    impl = (LlHlsImpl *)calloc(1, sizeof(*impl));
+    if (!impl) {
+        fprintf(stderr, "[LL-HLS][ERROR] setup failed: impl alloc\n");
+        return -1;
+    }
+    impl->config = *config;
+    if (!impl->config.name) {
+        impl->config.name = DEFAULT_LL_HLS_NAME;
+    }
+    if (!impl->config.listen_ip || impl->config.listen_ip[0] == '\0') {
+        impl->config.listen_ip = DEFAULT_LL_HLS_LISTEN_IP;
+    }
+    if (impl->config.listen_port <= 0) {
+        impl->config.listen_port = DEFAULT_LL_HLS_PORT;
+    }
+    if (!impl->config.stream_name || impl->config.stream_name[0] == '\0') {
+        impl->config.stream_name = DEFAULT_LL_HLS_STREAM_NAME;
+    }
+    if (impl->config.queue_capacity <= 0) {
+        impl->config.queue_capacity = DEFAULT_LL_HLS_QUEUE_CAPACITY;
+    }
+    if (impl->config.max_clients <= 0) {
+        impl->config.max_clients = DEFAULT_LL_HLS_MAX_CLIENTS;
+    }
+    if (impl->config.segment_target_ms <= 0) {
+        impl->config.segment_target_ms = DEFAULT_LL_HLS_SEGMENT_TARGET_MS;
+    }
+    if (impl->config.part_target_ms <= 0) {
+        impl->config.part_target_ms = DEFAULT_LL_HLS_PART_TARGET_MS;
+    }
+    if (impl->config.playlist_segments <= 0) {
+        impl->config.playlist_segments = DEFAULT_LL_HLS_PLAYLIST_SEGMENTS;
+    }
+    if (impl->config.video_fps <= 0) {
+        impl->config.video_fps = DEFAULT_LL_HLS_FPS;
+    }
+    if (impl->config.video_bitrate <= 0) {
+        impl->config.video_bitrate = DEFAULT_LL_HLS_BITRATE;
+    }
+    /* part 至少容纳一帧，分段至少容纳一个 part。 */
+    frame_ms = (1000 + impl->config.video_fps - 1) / impl->config.video_fps;
+    if (impl->config.part_target_ms < frame_ms) {
+        impl->config.part_target_ms = frame_ms;
+    }
+    if (impl->config.segment_target_ms < impl->config.part_target_ms) {
+        impl->config.segment_target_ms = impl->config.part_target_ms;
+    }
+    if (impl->config.segment_max_bytes <= 0) {
+        /* 按两倍目标时长的码流估算，再加上每个 part 预留的片段头；关键帧偏大时分段会提前切开。 */
+        slot_bytes = (uint64_t)impl->config.video_bitrate / 8 * (uint64_t)impl->config.segment_target_ms * 2 / 1000 +
+                     (uint64_t)LL_HLS_MAX_PARTS * fmp4_fragment_header_size(LL_HLS_MAX_PART_SAMPLES);
+        if (slot_bytes < LL_HLS_SEGMENT_MIN_BYTES) {
+            slot_bytes = LL_HLS_SEGMENT_MIN_BYTES;
+        }
+        impl->config.segment_max_bytes = (int)slot_bytes;
+    }
+    snprintf(impl->prefix, sizeof(impl->prefix), "/hls/%s/", impl->config.stream_name);
+
+    impl->frame_duration = (uint32_t)(FMP4_TIMESCALE / impl->config.video_fps);
+    impl->part_target = (uint32_t)((uint64_t)impl->config.part_target_ms * FMP4_TIMESCALE / 1000);
+    impl->segment_target = (uint64_t)impl->config.segment_target_ms * FMP4_TIMESCALE / 1000;
+    impl->slot_bytes = (size_t)impl->config.segment_max_bytes;
+    impl->slot_count = impl->config.playlist_segments + LL_HLS_SPARE_SLOTS;
+    impl->listen_fd = -1;
+    impl->event_fd = -1;
+    impl->epoll_fd = -1;
+    impl->inbox_capacity = impl->config.queue_capacity;
+    impl->client_capacity = impl->config.max_clients + LL_HLS_PENDING_CONNECTIONS;
+    pthread_mutex_init(&impl->lock, NULL);
+
+    memset(&sink_config, 0, sizeof(sink_config));
+    sink_config.name = impl->config.name;
+    sink_config.queue_capacity = impl->config.queue_capacity;
+    sink_config.reconnect_interval_ms = DEFAULT_LL_HLS_RECONNECT_INTERVAL_MS;
+    sink_config.drop_until_keyframe_after_reconnect = 1;
+
+    if (media_sink_init(sink, &sink_config, &vtable, impl) != 0) {
+        fprintf(stderr, "[LL-HLS][ERROR] setup failed: media_sink_init name=%s\n", impl->config.name);
+        pthread_mutex_destroy(&impl->lock);
+        free(impl);
+        return -1;
+    }
+    printf("[INFO] LL-HLS configured name=%s listen=%s:%d path=%sindex.m3u8 segment=%dms part=%dms playlist=%d slot_bytes=%d\n",
+           impl->config.name,
+           impl->config.listen_ip,
+           impl->config.listen_port,
+           impl->prefix,
+           impl->config.segment_target_ms,
+           impl->config.part_target_ms,
+           impl->config.playlist_segments,
+           impl->config.segment_max_bytes);
+    return 0;
+}
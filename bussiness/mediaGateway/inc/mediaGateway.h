@@ -1,22 +1,31 @@
 ﻿#ifndef __MEDIA_GATEWAY_H__
 #define __MEDIA_GATEWAY_H__
 
+#include <pthread.h>
 #include <stdio.h>
 
 #include "mppEncoder.h"
 #include "v4l2Capture.h"
 #include "mediaSink.h"
+#include "mediaGatewayAbr.h"
+#include "mediaGatewayIdr.h"
+#include "mediaGatewayMotion.h"
 #include "rtspSink.h"
 #include "rtmpSink.h"
+#include "httpFlvSink.h"
 #include "gb28181Sink.h"
+#include "tsUdpSink.h"
+#include "llHlsSink.h"
+#include "webrtcSink.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #define MEDIA_GATEWAY_MAX_STREAMS 2
-#define MEDIA_GATEWAY_MAX_SINKS 8
+#define MEDIA_GATEWAY_MAX_SINKS 14
 #define MEDIA_GATEWAY_MAX_CAPTURE_SOURCES MEDIA_GATEWAY_MAX_STREAMS
+#define MEDIA_GATEWAY_IDR_CACHE_FRAMES 32
 
 typedef struct {
     int enabled;                     /* 该采集源是否启用。 */
@@ -47,19 +56,37 @@ typedef struct {
     int qp_min_i;                    /* 该码流 I 帧最小 QP。 */
     int qp_max_i;                    /* 该码流 I 帧最大 QP。 */
     int qp_max_step;                 /* 该码流相邻帧最大 QP 变化步长。 */
+    MediaGatewayAbrConfig abr;       /* 该码流拥塞自适应码率配置。 */
+    MediaGatewayIdrConfig idr;       /* 该码流外部 IDR 请求仲裁配置。 */
+    MediaGatewayMotionConfig motion; /* 该码流静止画面降帧配置，每个码流按自己的参数独立检测。 */
+    int on_demand;                   /* 无人观看时是否暂停该码流的缩放和编码。 */
+    int on_demand_linger_ms;         /* 最后一个观看端离开后继续编码多久再暂停。 */
+    int on_demand_pause_capture;     /* 绑定同一采集源的码流全部暂停时，是否同时暂停取帧。 */
 
     int enable_rtsp;                 /* 该码流是否启用 RTSP sink。 */
     int enable_rtmp;                 /* 该码流是否启用 RTMP sink。 */
     int enable_gb28181;              /* 该码流是否启用 GB28181 sink。 */
+    int enable_http_flv;             /* 该码流是否启用 HTTP-FLV sink。 */
+    int enable_ts_udp;               /* 该码流是否启用 MPEG-TS over UDP sink。 */
+    int enable_ll_hls;               /* 该码流是否启用 LL-HLS sink。 */
+    int enable_webrtc;               /* 该码流是否启用 WebRTC WHEP sink。 */
     RtspSinkConfig rtsp;             /* 该码流 RTSP 配置。 */
     RtmpSinkConfig rtmp;             /* 该码流 RTMP 配置。 */
     Gb28181SinkConfig gb28181;       /* 该码流 GB28181 配置。 */
+    HttpFlvSinkConfig http_flv;      /* 该码流 HTTP-FLV 配置。 */
+    TsUdpSinkConfig ts_udp;          /* 该码流 MPEG-TS over UDP 配置。 */
+    LlHlsSinkConfig ll_hls;          /* 该码流 LL-HLS 配置。 */
+    WebrtcSinkConfig webrtc;         /* 该码流 WebRTC 配置。 */
 } MediaGatewayStreamConfig;
 
 typedef struct {
     int enable_rtsp;                 /* 是否启用 RTSP 输出链路。 */
     int enable_rtmp;                 /* 是否启用 RTMP 输出链路。 */
     int enable_gb28181;              /* 是否启用 GB28181 设备输出链路。 */
+    int enable_http_flv;             /* 是否启用 HTTP-FLV 拉流输出链路。 */
+    int enable_ts_udp;               /* 是否启用 MPEG-TS over UDP/组播输出链路。 */
+    int enable_ll_hls;               /* 是否启用低延迟 HLS 拉流输出链路。 */
+    int enable_webrtc;               /* 是否启用 WebRTC（WHEP）亚秒级播放输出链路。 */
     int fps;                         /* 全局编码帧率，所有输出协议共用。 */
     int bitrate;                     /* 全局编码目标码率，单位 bit/s。 */
     int gop;                         /* GOP 长度，影响关键帧间隔和恢复速度。 */
@@ -90,6 +117,10 @@ typedef struct {
     RtspSinkConfig rtsp;             /* RTSP 协议专用配置块。 */
     RtmpSinkConfig rtmp;             /* RTMP 协议专用配置块。 */
     Gb28181SinkConfig gb28181;       /* GB28181/SIP+RTP 协议专用配置块。 */
+    HttpFlvSinkConfig http_flv;      /* HTTP-FLV 协议专用配置块。 */
+    TsUdpSinkConfig ts_udp;          /* MPEG-TS over UDP 协议专用配置块。 */
+    LlHlsSinkConfig ll_hls;          /* LL-HLS 协议专用配置块。 */
+    WebrtcSinkConfig webrtc;         /* WebRTC 协议专用配置块。 */
 } MediaGatewayConfig;
 
 typedef struct {
@@ -99,6 +130,20 @@ typedef struct {
     uint64_t bytes;        /* 当前统计窗口内累计处理字节数。 */
 } MediaGatewayThroughput;
 
+typedef struct {
+    int width;                       /* 新编码宽度；<=0 表示保持不变，变化时会重建编码器。 */
+    int height;                      /* 新编码高度；<=0 表示保持不变。 */
+    int fps;                         /* 新帧率；<=0 表示保持不变。 */
+    int bitrate;                     /* 新目标码率，单位 bit/s；<=0 表示保持不变。 */
+    int gop;                         /* 新 GOP 长度；<=0 表示保持不变。 */
+    int qp_init;                     /* 新初始 QP；<=0 表示保持不变。 */
+    int qp_min;                      /* 新 P/B 最小 QP；<=0 表示保持不变。 */
+    int qp_max;                      /* 新 P/B 最大 QP；<=0 表示保持不变。 */
+    int qp_min_i;                    /* 新 I 帧最小 QP；<=0 表示保持不变。 */
+    int qp_max_i;                    /* 新 I 帧最大 QP；<=0 表示保持不变。 */
+    int qp_max_step;                 /* 新 QP 最大步长；<=0 表示保持不变。 */
+} MediaGatewayStreamTuning;
+
 typedef struct {
     V4L2CaptureCtx captures[MEDIA_GATEWAY_MAX_CAPTURE_SOURCES]; /* 各采集源 V4L2 上下文。 */
     MppEncoderCtx encoders[MEDIA_GATEWAY_MAX_STREAMS]; /* 各码流编码模块上下文。 */
@@ -110,6 +155,8 @@ typedef struct {
     MediaGatewayConfig config;                 /* 归一化后的网关配置副本。 */
     int rtsp_sink_index[MEDIA_GATEWAY_MAX_STREAMS]; /* 各码流 rtsp sink 索引。 */
     int gb28181_sink_index[MEDIA_GATEWAY_MAX_STREAMS]; /* 各码流 gb28181 sink 索引。 */
+    int webrtc_sink_index[MEDIA_GATEWAY_MAX_STREAMS]; /* 各码流 webrtc sink 索引。 */
+    int ts_udp_sink_index[MEDIA_GATEWAY_MAX_STREAMS]; /* 各码流 ts_udp sink 索引，码率变化时通知其发送平滑。 */
     int encoder_ready[MEDIA_GATEWAY_MAX_STREAMS]; /* 各码流编码模块是否已初始化成功。 */
     int running;                               /* 主循环是否正在运行。 */
     FILE *record_fp;                           /* 本地录像文件句柄。 */
@@ -118,6 +165,42 @@ typedef struct {
     uint64_t stat_bytes;                       /* 当前统计窗口内累计字节数。 */
     uint64_t stream_stat_frames[MEDIA_GATEWAY_MAX_STREAMS]; /* 各码流窗口内累计帧数。 */
     uint64_t stream_stat_bytes[MEDIA_GATEWAY_MAX_STREAMS];  /* 各码流窗口内累计字节数。 */
+    pthread_mutex_t tuning_lock;               /* 保护 pending_tuning 和调参写回 config.streams，允许其它线程在线调参。 */
+    int tuning_lock_ready;                     /* tuning_lock 是否已初始化。 */
+    int tuning_pending[MEDIA_GATEWAY_MAX_STREAMS]; /* 各码流是否有待应用的调参请求。 */
+    MediaGatewayStreamTuning pending_tuning[MEDIA_GATEWAY_MAX_STREAMS]; /* 各码流待应用的调参请求。 */
+    uint64_t reconfig_inplace_count[MEDIA_GATEWAY_MAX_STREAMS];  /* 原地重配置次数。 */
+    uint64_t reconfig_recreate_count[MEDIA_GATEWAY_MAX_STREAMS]; /* 重建编码器的重配置次数。 */
+    uint64_t reconfig_start_frame_id[MEDIA_GATEWAY_MAX_STREAMS]; /* 最近一次重配置时的采集帧号。 */
+    uint64_t reconfig_start_ts_us[MEDIA_GATEWAY_MAX_STREAMS];    /* 最近一次重配置开始时间。 */
+    uint64_t reconfig_stall_us[MEDIA_GATEWAY_MAX_STREAMS];       /* 最近一次重配置调用本身耗时。 */
+    int reconfig_measuring[MEDIA_GATEWAY_MAX_STREAMS];           /* 是否正在等待重配置后的首个输出包。 */
+    int reconfig_empty_frames[MEDIA_GATEWAY_MAX_STREAMS];        /* 重配置后未产出码流的帧数。 */
+    MediaGatewayAbr abr[MEDIA_GATEWAY_MAX_STREAMS];        /* 各码流拥塞自适应码率控制器，current_* 即编码器运行码率和帧率。 */
+    int abr_rate_pending[MEDIA_GATEWAY_MAX_STREAMS];       /* ABR 改了运行码率或帧率、尚未下发给编码器；不改 config.streams 里的配置值。 */
+    MediaGatewayAbrSinkCursor abr_cursors[MEDIA_GATEWAY_MAX_SINKS]; /* 各 sink 的 ABR 统计窗口基线。 */
+    uint64_t next_encode_ts_us[MEDIA_GATEWAY_MAX_STREAMS]; /* ABR 降帧率时下一帧允许编码的采集时间。 */
+    MediaGatewayIdrArbiter idr[MEDIA_GATEWAY_MAX_STREAMS]; /* 各码流外部 IDR 请求仲裁器。 */
+    uint64_t last_encode_ts_us[MEDIA_GATEWAY_MAX_STREAMS]; /* 最近一帧送入编码器的采集时间。 */
+    uint64_t encode_interval_us[MEDIA_GATEWAY_MAX_STREAMS]; /* 实测送编码帧间隔的平滑值，含 ABR 和静止降帧。 */
+    MediaPacket idr_cache[MEDIA_GATEWAY_MAX_STREAMS][MEDIA_GATEWAY_IDR_CACHE_FRAMES]; /* 最近关键帧及其后续帧的引用。 */
+    int idr_cache_count[MEDIA_GATEWAY_MAX_STREAMS];        /* idr_cache 中有效包数量。 */
+    MediaGatewayMotion motion[MEDIA_GATEWAY_MAX_STREAMS];  /* 各码流运动检测器，分析所属采集源的帧。 */
+    int motion_ready[MEDIA_GATEWAY_MAX_STREAMS];           /* 各码流运动检测器是否已初始化。 */
+    int motion_static[MEDIA_GATEWAY_MAX_STREAMS];          /* 各码流当前帧是否判定为静止。 */
+    uint64_t paced_gop_idr_count[MEDIA_GATEWAY_MAX_STREAMS]; /* 静止或 ABR 降帧期间按 GOP 时长补发的关键帧数。 */
+    uint64_t motion_skipped_frames[MEDIA_GATEWAY_MAX_STREAMS]; /* 因画面静止跳过编码的帧数。 */
+    uint64_t motion_saved_bytes[MEDIA_GATEWAY_MAX_STREAMS];    /* 按近期 P 帧平均大小估算的节省字节数。 */
+    uint64_t motion_avg_frame_bytes[MEDIA_GATEWAY_MAX_STREAMS]; /* 近期非关键帧平均大小，用于估算节省量。 */
+    int ondemand_suspended[MEDIA_GATEWAY_MAX_STREAMS];         /* 按需编码：当前是否因无人观看而暂停。 */
+    uint64_t ondemand_idle_since_ts_us[MEDIA_GATEWAY_MAX_STREAMS]; /* 变为无人观看的时间，0 表示有人观看。 */
+    uint64_t ondemand_suspend_ts_us[MEDIA_GATEWAY_MAX_STREAMS];    /* 本次暂停开始时间。 */
+    uint64_t ondemand_suspended_us[MEDIA_GATEWAY_MAX_STREAMS];     /* 已结束的暂停段累计时长。 */
+    uint64_t ondemand_suspend_count[MEDIA_GATEWAY_MAX_STREAMS];    /* 累计暂停次数。 */
+    uint64_t ondemand_skipped_frames[MEDIA_GATEWAY_MAX_STREAMS];   /* 暂停期间到达但未缩放/编码的采集帧数。 */
+    uint64_t ondemand_last_poll_ts_us;                             /* 上次轮询各 sink 观看端的时间。 */
+    int ondemand_capture_paused[MEDIA_GATEWAY_MAX_CAPTURE_SOURCES]; /* 各采集源是否已随码流一起暂停取帧。 */
+    uint64_t stream_frame_cost_us[MEDIA_GATEWAY_MAX_STREAMS];      /* 近期单帧缩放+编码平均耗时，用于估算暂停节省的 CPU。 */
     uint8_t *scaled_frame_cache[MEDIA_GATEWAY_MAX_STREAMS]; /* 缩放后的 NV12 帧缓存。 */
     size_t scaled_frame_cache_size[MEDIA_GATEWAY_MAX_STREAMS]; /* 缩放缓存容量。 */
 
@@ -178,6 +261,16 @@ void media_gateway_stop(MediaGatewayCtx *ctx);
 void media_gateway_deinit(MediaGatewayCtx *ctx);
 void media_gateway_get_throughput(MediaGatewayCtx *ctx, MediaGatewayThroughput *throughput);
 
+/**
+ * @description: 请求在线调整指定码流的编码参数，可在任意线程调用。
+ *               请求在主循环处理该码流下一帧前生效；分辨率不变时原地生效，不会重建编码器。
+ * @param {MediaGatewayCtx *} ctx 网关上下文。
+ * @param {int} stream_idx 码流下标。
+ * @param {const MediaGatewayStreamTuning *} tuning 调参内容，<=0 的字段保持不变。
+ * @return {int} 0 成功，-1 参数非法。
+ */
+int media_gateway_request_stream_tuning(MediaGatewayCtx *ctx, int stream_idx, const MediaGatewayStreamTuning *tuning);
+
 #ifdef __cplusplus
 }
 #endif
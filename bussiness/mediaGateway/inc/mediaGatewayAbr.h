@@ -0,0 +1,150 @@
+#ifndef __MEDIA_GATEWAY_ABR_H__
+#define __MEDIA_GATEWAY_ABR_H__
+
+#include <stdint.h>
+
+#include "mediaSink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int enabled;                     /* 是否启用拥塞自适应码率。 */
+    int min_bitrate;                 /* 允许下调到的最低码率，单位 bit/s。 */
+    int max_bitrate;                 /* 允许上调到的最高码率，单位 bit/s。 */
+    int min_fps;                     /* 码率已到下限仍拥塞时，允许下调到的最低帧率；<=0 表示不调帧率。 */
+    int step_down_percent;           /* 每次下调的比例，百分比。 */
+    int step_up_percent;             /* 每次上调的比例，百分比。 */
+    int queue_high_percent;          /* 队列深度占容量比例达到该值视为拥塞。 */
+    int queue_low_percent;           /* 队列深度占容量比例低于该值才视为通畅（滞回下沿）。 */
+    int age_high_ms;                 /* 队头包积压时长达到该值视为拥塞。 */
+    int down_hold_ms;                /* 两次下调之间的最小间隔。 */
+    int up_hold_ms;                  /* 持续通畅多久才允许上调一步。 */
+    int eval_interval_ms;            /* 评估周期。 */
+} MediaGatewayAbrConfig;
+
+typedef struct {
+    int connected;                   /* 参与评估的 sink 是否至少有一个已连接。 */
+    int queue_depth;                 /* 最拥塞 sink 的队列深度。 */
+    int queue_capacity;              /* 最拥塞 sink 的队列容量。 */
+    uint64_t oldest_packet_age_us;   /* 已连接 sink 中最旧队头包的积压时长。 */
+    uint64_t window_drops;           /* 评估窗口内已连接 sink 新增丢帧数之和。 */
+    double send_kbps;                /* 评估窗口内发送最慢的已连接 sink 的发送速率，<0 表示未知。 */
+} MediaGatewayAbrSample;
+
+typedef struct {
+    uint64_t sent_bytes;             /* 上次采样时该 sink 的累计发送字节数。 */
+    uint64_t dropped_frames;         /* 上次采样时该 sink 的累计丢帧数。 */
+    uint64_t ts_us;                  /* 上次采样时间。 */
+    int valid;                       /* 基线是否有效；sink 断开后失效，重连后重新建立。 */
+} MediaGatewayAbrSinkCursor;
+
+typedef enum {
+    MEDIA_GATEWAY_ABR_HOLD = 0,      /* 保持不变。 */
+    MEDIA_GATEWAY_ABR_DOWN = 1,      /* 下调码率或帧率。 */
+    MEDIA_GATEWAY_ABR_UP = 2         /* 上调码率或帧率。 */
+} MediaGatewayAbrAction;
+
+typedef struct {
+    MediaGatewayAbrAction action;    /* 本次决策动作。 */
+    const char *reason;              /* 决策原因：queue/age/drops/recovered。 */
+    int old_bitrate;                 /* 决策前码率。 */
+    int new_bitrate;                 /* 决策后码率。 */
+    int old_fps;                     /* 决策前帧率。 */
+    int new_fps;                     /* 决策后帧率。 */
+    double send_kbps;                /* 评估窗口内实测发送速率。 */
+    uint64_t window_drops;           /* 评估窗口内新增丢帧数。 */
+} MediaGatewayAbrDecision;
+
+typedef struct {
+    MediaGatewayAbrConfig config;    /* 归一化后的控制参数。 */
+    int nominal_bitrate;             /* 配置码率，码率上下限按它生成，手动调码率时随之缩放。 */
+    int nominal_fps;                 /* 配置帧率，上调帧率时不会超过该值。 */
+    int current_bitrate;             /* 当前目标码率，即编码器实际运行码率。 */
+    int current_fps;                 /* 当前目标帧率，即编码器实际运行帧率。 */
+    uint64_t last_eval_ts_us;        /* 上次评估时间。 */
+    uint64_t last_change_ts_us;      /* 上次调整时间。 */
+    uint64_t clear_since_ts_us;      /* 连续通畅的起始时间，0 表示当前不通畅。 */
+    double send_kbps;                /* 最近一次评估的实测发送速率。 */
+    uint64_t last_age_us;            /* 上次评估时的队头积压时长，用于判断积压是否在消化。 */
+    uint64_t step_down_count;        /* 累计下调次数。 */
+    uint64_t step_up_count;          /* 累计上调次数。 */
+} MediaGatewayAbr;
+
+/**
+ * @description: 归一化 ABR 配置，未配置的字段填默认值，码率上下限围绕 initial_bitrate 生成。
+ * @param {MediaGatewayAbrConfig *} config 待归一化的配置。
+ * @param {int} initial_bitrate 码流配置码率。
+ * @return {void}
+ */
+void media_gateway_abr_fill_default(MediaGatewayAbrConfig *config, int initial_bitrate);
+
+/**
+ * @description: 初始化码率控制器。
+ * @param {MediaGatewayAbr *} abr 控制器。
+ * @param {const MediaGatewayAbrConfig *} config 已归一化的配置。
+ * @param {int} initial_bitrate 初始码率。
+ * @param {int} initial_fps 初始帧率，同时作为上调帧率的上限。
+ * @return {void}
+ */
+void media_gateway_abr_init(MediaGatewayAbr *abr, const MediaGatewayAbrConfig *config, int initial_bitrate, int initial_fps);
+
+/**
+ * @description: 手动调参后重设控制器的配置值：帧率上限跟随新帧率，码率上下限按新旧码率比例缩放，
+ *               当前值回到新配置值，之后的恢复不会再回到旧配置。
+ * @param {MediaGatewayAbr *} abr 控制器。
+ * @param {int} bitrate 新配置码率，<=0 表示保持不变。
+ * @param {int} fps 新配置帧率，<=0 表示保持不变。
+ * @return {void}
+ */
+void media_gateway_abr_retune(MediaGatewayAbr *abr, int bitrate, int fps);
+
+/**
+ * @description: 判断是否到了评估周期，未到期时调用方无需采集 sink 统计。
+ * @param {const MediaGatewayAbr *} abr 控制器。
+ * @param {uint64_t} now_us 当前单调时钟时间。
+ * @return {int} 1 到期，0 未到期或未启用。
+ */
+int media_gateway_abr_due(const MediaGatewayAbr *abr, uint64_t now_us);
+
+/**
+ * @description: 清空一次观测值，准备逐个累加 sink。
+ * @param {MediaGatewayAbrSample *} sample 观测值。
+ * @return {void}
+ */
+void media_gateway_abr_sample_reset(MediaGatewayAbrSample *sample);
+
+/**
+ * @description: 把一个 sink 的统计并入观测值。未连接的 sink 不参与评估，避免连接阶段的积压压低码率。
+ * @param {MediaGatewayAbrSample *} sample 观测值。
+ * @param {MediaGatewayAbrSinkCursor *} cursor 该 sink 的窗口基线。
+ * @param {const MediaSinkStats *} stats 该 sink 当前统计。
+ * @param {int} queue_capacity 该 sink 队列容量。
+ * @param {uint64_t} now_us 当前单调时钟时间。
+ * @return {void}
+ */
+void media_gateway_abr_sample_add_sink(MediaGatewayAbrSample *sample,
+                                       MediaGatewayAbrSinkCursor *cursor,
+                                       const MediaSinkStats *stats,
+                                       int queue_capacity,
+                                       uint64_t now_us);
+
+/**
+ * @description: 输入一次 sink 观测值并给出决策，内部按 eval_interval_ms 限频。
+ * @param {MediaGatewayAbr *} abr 控制器。
+ * @param {const MediaGatewayAbrSample *} sample 聚合后的 sink 观测值。
+ * @param {uint64_t} now_us 当前单调时钟时间。
+ * @param {MediaGatewayAbrDecision *} decision 输出决策，可为 NULL。
+ * @return {int} 1 表示码率或帧率发生变化，0 表示保持。
+ */
+int media_gateway_abr_update(MediaGatewayAbr *abr,
+                             const MediaGatewayAbrSample *sample,
+                             uint64_t now_us,
+                             MediaGatewayAbrDecision *decision);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
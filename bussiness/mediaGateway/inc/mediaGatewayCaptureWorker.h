@@ -42,6 +42,8 @@ typedef struct {
     int running;                    /* worker 是否应继续运行。 */
     int started;                    /* 采集线程是否已成功启动。 */
     int fatal_error;                /* 采集线程是否遇到不可恢复错误。 */
+    int paused;                     /* 是否暂停取帧（按需编码时绑定的码流都无人观看）。 */
+    int resume_drop_budget;         /* 恢复时登记的旧帧丢弃上限，由采集线程取走后清零。 */
 } MediaGatewayCaptureWorker;
 
 /**
@@ -85,6 +87,14 @@ int media_gateway_capture_worker_acquire_latest(MediaGatewayCaptureWorker *worke
  */
 void media_gateway_capture_worker_release(MediaGatewayCaptureWorker *worker, int slot_index);
 
+/**
+ * @description: 暂停或恢复取帧。暂停期间采集线程不再 DQBUF，恢复后丢弃暂停前积压在驱动队列里的旧帧。
+ * @param {MediaGatewayCaptureWorker *} worker 采集 worker。
+ * @param {int} paused 1 暂停，0 恢复。
+ * @return {void}
+ */
+void media_gateway_capture_worker_set_paused(MediaGatewayCaptureWorker *worker, int paused);
+
 /**
  * @description: 停止采集线程并等待线程退出。
  * @param {MediaGatewayCaptureWorker *} worker 采集 worker。
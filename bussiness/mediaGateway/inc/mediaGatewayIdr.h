@@ -0,0 +1,92 @@
+#ifndef __MEDIA_GATEWAY_IDR_H__
+#define __MEDIA_GATEWAY_IDR_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int coalesce_ms;                 /* 首个请求到达后等待合并的窗口；0 使用默认值，负数表示不等待。 */
+    int min_interval_ms;             /* 两次强制 IDR 之间的最小间隔；0 使用默认值，负数表示不限制。 */
+    int reuse_window_ms;             /* 最近关键帧在该时长内可直接复用满足请求；0 使用默认值，负数表示不复用。 */
+} MediaGatewayIdrConfig;
+
+typedef struct {
+    MediaGatewayIdrConfig config;    /* 归一化后的仲裁参数，已不含 0 和负数语义。 */
+    int pending;                     /* 是否有尚未满足的 IDR 请求。 */
+    int in_flight;                   /* 已向编码器请求 IDR、尚未看到关键帧输出。 */
+    uint64_t first_request_ts_us;    /* 当前待处理请求中最早一个的到达时间。 */
+    uint64_t last_forced_ts_us;      /* 上次向编码器强制请求 IDR 的时间。 */
+    uint64_t last_keyframe_ts_us;    /* 最近一个关键帧（自然或强制）的输出时间。 */
+    uint64_t requested_count;        /* 累计收到的 IDR 请求数。 */
+    uint64_t coalesced_count;        /* 并入已有待处理/在途请求的次数。 */
+    uint64_t reused_count;           /* 由最近关键帧缓存直接满足的次数。 */
+    uint64_t natural_count;          /* 等待期间被周期性关键帧顺带满足的次数。 */
+    uint64_t issued_count;           /* 实际向编码器强制请求 IDR 的次数。 */
+} MediaGatewayIdrArbiter;
+
+/**
+ * @description: 归一化 IDR 仲裁配置，0 填默认值，负数归零表示关闭对应机制。
+ * @param {MediaGatewayIdrConfig *} config 待归一化的配置。
+ * @return {void}
+ */
+void media_gateway_idr_fill_default(MediaGatewayIdrConfig *config);
+
+/**
+ * @description: 初始化 IDR 仲裁器。
+ * @param {MediaGatewayIdrArbiter *} arbiter 仲裁器。
+ * @param {const MediaGatewayIdrConfig *} config 配置，可为 NULL 表示全部默认。
+ * @return {void}
+ */
+void media_gateway_idr_init(MediaGatewayIdrArbiter *arbiter, const MediaGatewayIdrConfig *config);
+
+/**
+ * @description: 判断最近关键帧是否仍在复用窗口内，调用方据此决定能否回放缓存代替新 IDR。
+ * @param {const MediaGatewayIdrArbiter *} arbiter 仲裁器。
+ * @param {uint64_t} now_us 当前单调时钟时间。
+ * @return {int} 1 可复用，0 不可复用。
+ */
+int media_gateway_idr_fresh(const MediaGatewayIdrArbiter *arbiter, uint64_t now_us);
+
+/**
+ * @description: 登记一次 IDR 请求。已由缓存满足的请求只计数；否则并入待处理请求，由 poll 决定何时真正下发。
+ * @param {MediaGatewayIdrArbiter *} arbiter 仲裁器。
+ * @param {uint64_t} now_us 当前单调时钟时间。
+ * @param {int} served_from_cache 调用方是否已用最近关键帧缓存满足该请求。
+ * @return {void}
+ */
+void media_gateway_idr_request(MediaGatewayIdrArbiter *arbiter, uint64_t now_us, int served_from_cache);
+
+/**
+ * @description: 每帧编码前调用，判断此刻是否应向编码器强制请求 IDR。
+ *               合并窗口和最小间隔都满足后才下发；周期关键帧马上就到时让它顺带满足请求。
+ * @param {MediaGatewayIdrArbiter *} arbiter 仲裁器。
+ * @param {uint64_t} now_us 当前单调时钟时间。
+ * @param {uint64_t} natural_idr_in_us 距下一个周期关键帧的预计时长，未知时传 UINT64_MAX。
+ * @return {int} 1 需要立即请求 IDR，0 不需要。
+ */
+int media_gateway_idr_poll(MediaGatewayIdrArbiter *arbiter, uint64_t now_us, uint64_t natural_idr_in_us);
+
+/**
+ * @description: 绕过合并窗口和最小间隔立即下发一次 IDR，例如按需编码恢复后的首帧；计入 issued。
+ * @param {MediaGatewayIdrArbiter *} arbiter 仲裁器。
+ * @param {uint64_t} now_us 当前单调时钟时间。
+ * @return {void}
+ */
+void media_gateway_idr_force(MediaGatewayIdrArbiter *arbiter, uint64_t now_us);
+
+/**
+ * @description: 编码器输出关键帧时调用，刷新最近关键帧时间并清除被它满足的请求。
+ * @param {MediaGatewayIdrArbiter *} arbiter 仲裁器。
+ * @param {uint64_t} now_us 当前单调时钟时间。
+ * @return {void}
+ */
+void media_gateway_idr_on_keyframe(MediaGatewayIdrArbiter *arbiter, uint64_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
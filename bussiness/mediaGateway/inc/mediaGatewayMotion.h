@@ -0,0 +1,115 @@
+#ifndef __MEDIA_GATEWAY_MOTION_H__
+#define __MEDIA_GATEWAY_MOTION_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 亮度平面水平、垂直各按该倍数抽样后再比较。 */
+#define MEDIA_GATEWAY_MOTION_DOWNSAMPLE 4
+/* 抽样平面上的块边长（抽样点数），对应原图 64x64 像素。 */
+#define MEDIA_GATEWAY_MOTION_BLOCK 16
+
+typedef struct {
+    int enabled;                     /* 是否启用静止画面降帧。 */
+    int idle_fps;                    /* 画面静止时的编码帧率。 */
+    int sad_threshold;               /* 块内平均亮度差达到该值视为该块有变化，取值 0~255。 */
+    int min_changed_blocks;          /* 有变化的块数达到该值视为画面运动。 */
+    int static_hold_ms;              /* 连续无运动多久才进入静止状态。 */
+} MediaGatewayMotionConfig;
+
+typedef struct {
+    MediaGatewayMotionConfig config; /* 归一化后的检测参数。 */
+    int width;                       /* 采集宽度。 */
+    int height;                      /* 采集高度。 */
+    int cols;                        /* 抽样平面宽度，按块对齐。 */
+    int rows;                        /* 抽样平面高度。 */
+    int blocks_x;                    /* 水平块数。 */
+    int blocks_y;                    /* 垂直块数。 */
+    uint8_t *reference;              /* 上一帧的抽样亮度平面。 */
+    uint32_t *block_sad;             /* 当前帧各块的 SAD 累加。 */
+    int has_reference;               /* reference 是否已有有效数据。 */
+    int is_static;                   /* 当前是否处于静止状态。 */
+    int last_changed_blocks;         /* 最近一帧有变化的块数。 */
+    uint64_t last_motion_ts_us;      /* 最近一次检测到运动的时间。 */
+    uint64_t analyzed_frames;        /* 累计分析帧数。 */
+    uint64_t analyze_us_sum;         /* 累计分析耗时。 */
+    uint64_t static_enter_count;     /* 累计进入静止状态次数。 */
+} MediaGatewayMotion;
+
+/**
+ * @description: 归一化运动检测配置，未配置的字段填默认值。
+ * @param {MediaGatewayMotionConfig *} config 待归一化的配置。
+ * @param {int} fps 码流帧率，idle_fps 不会超过该值。
+ * @return {void}
+ */
+void media_gateway_motion_fill_default(MediaGatewayMotionConfig *config, int fps);
+
+/**
+ * @description: 按采集分辨率初始化运动检测器并分配抽样缓存。
+ * @param {MediaGatewayMotion *} motion 检测器。
+ * @param {const MediaGatewayMotionConfig *} config 已归一化的配置。
+ * @param {int} width 采集宽度。
+ * @param {int} height 采集高度。
+ * @return {int} 0 成功，-1 失败。
+ */
+int media_gateway_motion_init(MediaGatewayMotion *motion, const MediaGatewayMotionConfig *config, int width, int height);
+
+/**
+ * @description: 释放运动检测器缓存。
+ * @param {MediaGatewayMotion *} motion 检测器。
+ * @return {void}
+ */
+void media_gateway_motion_deinit(MediaGatewayMotion *motion);
+
+/**
+ * @description: 分析一帧亮度平面并更新静止/运动状态。检测到运动时立即退出静止状态。
+ * @param {MediaGatewayMotion *} motion 检测器。
+ * @param {const uint8_t *} y_plane 亮度平面起始地址。
+ * @param {int} stride 亮度平面行跨度。
+ * @param {uint64_t} now_us 当前单调时钟时间。
+ * @return {int} 1 静止，0 运动。
+ */
+int media_gateway_motion_analyze(MediaGatewayMotion *motion, const uint8_t *y_plane, int stride, uint64_t now_us);
+
+/**
+ * @description: 选出降帧目标帧率：ABR 降帧和静止降帧取较低者。
+ * @param {const MediaGatewayMotionConfig *} config 静止降帧配置，可为 NULL。
+ * @param {int} is_static 画面当前是否静止。
+ * @param {int} abr_fps ABR 当前低于配置帧率时的运行帧率，<=0 表示 ABR 未降帧。
+ * @param {int *} idle 输出是否由静止降帧决定，可为 NULL。
+ * @return {int} 目标帧率，<=0 表示不降帧、每帧都编码。
+ */
+int media_gateway_motion_target_fps(const MediaGatewayMotionConfig *config, int is_static, int abr_fps, int *idle);
+
+/**
+ * @description: 按目标帧率决定当前采集帧是否跳过，并推进下一帧允许编码的时间。
+ * @param {uint64_t *} next_encode_ts_us 下一帧允许编码的采集时间，0 表示节拍未开始；不降帧时清零。
+ * @param {int} target_fps 目标帧率，<=0 表示不降帧。
+ * @param {uint64_t} frame_ts_us 当前帧采集时间。
+ * @return {int} 1 跳过该帧，0 编码该帧。
+ */
+int media_gateway_motion_pace(uint64_t *next_encode_ts_us, int target_fps, uint64_t frame_ts_us);
+
+/**
+ * @description: 降帧期间距离按配置帧率折算的 GOP 时长用完还剩多久，为 0 时应补发关键帧保活。
+ * @param {uint64_t} next_encode_ts_us 降帧节拍，0 表示当前未降帧。
+ * @param {uint64_t} last_keyframe_ts_us 最近一个关键帧时间，0 表示还没有关键帧。
+ * @param {int} fps 配置帧率（不是降帧后的运行帧率）。
+ * @param {int} gop 配置 GOP 帧数。
+ * @param {uint64_t} now_us 当前单调时钟时间。
+ * @return {uint64_t} 剩余微秒；未降帧或参数无效时返回 UINT64_MAX。
+ */
+uint64_t media_gateway_motion_gop_left_us(uint64_t next_encode_ts_us,
+                                          uint64_t last_keyframe_ts_us,
+                                          int fps,
+                                          int gop,
+                                          uint64_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
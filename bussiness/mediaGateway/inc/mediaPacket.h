@@ -37,6 +37,11 @@ typedef struct {
     int is_key_frame;          /* 是否为关键帧，便于丢帧和重连恢复 */
 } MediaPacket;
 
+typedef struct {
+    const uint8_t *data;       /* NALU 起始（NALU 头），不含起始码 */
+    size_t size;               /* NALU 长度 */
+} MediaNaluView;
+
 int media_buffer_create_copy(const uint8_t *data, size_t size, MediaBuffer **out_buffer);
 void media_buffer_retain(MediaBuffer *buffer);
 void media_buffer_release(MediaBuffer *buffer);
@@ -44,6 +49,28 @@ void media_packet_init(MediaPacket *packet);
 void media_packet_copy_ref(MediaPacket *dst, const MediaPacket *src);
 void media_packet_reset(MediaPacket *packet);
 
+/**
+ * @description: 从 Annex-B 数据的 *offset 处取下一个 NALU，跳过起始码和空 NALU，第一个起始码之前的数据忽略。
+ *               返回时 *offset 指向下一个起始码（或数据末尾），即本 NALU 的结束位置。
+ * @param {const uint8_t *} data Annex-B 数据。
+ * @param {size_t} len 数据长度。
+ * @param {size_t *} offset 输入查找起点，输出本 NALU 的结束位置。
+ * @param {MediaNaluView *} nalu 输出 NALU 视图。
+ * @return {int} 1 取到 NALU，0 没有更多 NALU。
+ */
+int media_annexb_next_nalu(const uint8_t *data, size_t len, size_t *offset, MediaNaluView *nalu);
+
+/**
+ * @description: 把一帧 Annex-B 数据切成 NALU 视图，整块没有起始码时视为一个 NALU。
+ * @param {const uint8_t *} data Annex-B 数据。
+ * @param {size_t} len 数据长度。
+ * @param {MediaNaluView *} nalus 输出数组。
+ * @param {size_t} capacity 输出数组容量。
+ * @param {size_t *} out_count 输出 NALU 数。
+ * @return {int} 0 成功，-1 NALU 数超出容量。
+ */
+int media_annexb_split(const uint8_t *data, size_t len, MediaNaluView *nalus, size_t capacity, size_t *out_count);
+
 #ifdef __cplusplus
 }
 #endif
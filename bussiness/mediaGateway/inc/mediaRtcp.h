@@ -0,0 +1,134 @@
+#ifndef __MEDIA_RTCP_H__
+#define __MEDIA_RTCP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* RTCP 报文类型（RFC 3550）。 */
+#define MEDIA_RTCP_PT_SR 200
+#define MEDIA_RTCP_PT_RR 201
+#define MEDIA_RTCP_PT_SDES 202
+/* SR + SDES(CNAME) 复合包的最大长度。 */
+#define MEDIA_RTCP_SR_MAX 128
+/* SDES CNAME 最大长度，超出截断。 */
+#define MEDIA_RTCP_CNAME_MAX 64
+/* 默认 SR 周期：视频码率下 SR 的带宽可以忽略，1 秒让丢包/RTT 统计足够及时。 */
+#define MEDIA_RTCP_DEFAULT_INTERVAL_MS 1000
+/* 超过该时长没有新的接收报告，汇总统计不再计入该接收端。 */
+#define MEDIA_RTCP_REPORT_STALE_MS 10000
+/* 视频 RTP 时钟频率。 */
+#define MEDIA_RTCP_VIDEO_CLOCK_RATE 90000
+
+typedef struct {
+    uint32_t reporter_ssrc;          /* 发出报告的接收端 SSRC。 */
+    uint8_t fraction_lost;           /* 上个报告周期的丢包比例，x/256。 */
+    int32_t cumulative_lost;         /* 累计丢包数（24 位有符号）。 */
+    uint32_t highest_seq;            /* 收到的最高扩展序号。 */
+    uint32_t jitter;                 /* 到达间隔抖动，RTP 时间戳单位。 */
+    uint32_t lsr;                    /* 接收端最近收到的 SR 的 NTP 中间 32 位，0 表示还没收到 SR。 */
+    uint32_t dlsr;                   /* 收到该 SR 到发出本报告的延时，1/65536 秒。 */
+} MediaRtcpReportBlock;
+
+typedef struct {
+    long long next_sr_ms;            /* 下一次发送 SR 的单调时钟毫秒，0 表示立即发送。 */
+    uint64_t sr_sent;                /* 已发给该接收端的 SR 数。 */
+    uint64_t reports;                /* 收到的针对本发送 SSRC 的接收报告数。 */
+    long long last_report_ms;        /* 最近一次收到报告的单调时钟毫秒，0 表示从未收到。 */
+    uint32_t reporter_ssrc;          /* 接收端 SSRC。 */
+    double loss_percent;             /* 最近报告的丢包率（百分比）。 */
+    int32_t cumulative_lost;         /* 最近报告的累计丢包数。 */
+    uint32_t highest_seq;            /* 最近报告的最高扩展序号。 */
+    double jitter_ms;                /* 最近报告的到达抖动（毫秒）。 */
+    int rtt_ms;                      /* 由 LSR/DLSR 算出的往返时延，-1 表示未知（接收端还没收到 SR）。 */
+} MediaRtcpPeer;
+
+/**
+ * @description: 取当前墙钟对应的 64 位 NTP 时间戳（高 32 位秒，低 32 位小数）。
+ * @return {uint64_t}
+ */
+uint64_t media_rtcp_ntp_now(void);
+
+/**
+ * @description: 把最近一帧的 RTP 时间戳按单调时钟推算到 now_us 时刻，用于 SR 的 NTP↔RTP 对应关系。
+ *   pts_us 与 now_us 同为采集侧单调时钟，SR 里的 NTP 与 RTP 因此都对应采集时刻，播放端可据此做音画同步与端到端时延测量。
+ * @param {uint32_t} rtp_timestamp 最近一帧的 RTP 时间戳。
+ * @param {uint64_t} pts_us 该帧 pts（单调时钟微秒）。
+ * @param {uint64_t} now_us 当前单调时钟微秒。
+ * @param {uint32_t} clock_rate RTP 时钟频率。
+ * @return {uint32_t}
+ */
+uint32_t media_rtcp_rtp_timestamp_at(uint32_t rtp_timestamp, uint64_t pts_us, uint64_t now_us, uint32_t clock_rate);
+
+/**
+ * @description: 生成 SR + SDES(CNAME) 复合包，SR 不带接收报告块。
+ * @param {uint8_t *} buf 输出缓冲，至少 MEDIA_RTCP_SR_MAX 字节。
+ * @param {size_t} cap 缓冲大小。
+ * @param {uint32_t} ssrc 发送端 SSRC。
+ * @param {uint64_t} ntp NTP 时间戳（media_rtcp_ntp_now）。
+ * @param {uint32_t} rtp_timestamp 与 ntp 对应的 RTP 时间戳。
+ * @param {uint32_t} packets 累计发送的 RTP 包数。
+ * @param {uint32_t} octets 累计发送的 RTP 负载字节数（不含 RTP 头）。
+ * @param {const char *} cname SDES CNAME，NULL 或空字符串时不带 SDES。
+ * @return {int} 报文长度，-1 缓冲不足。
+ */
+int media_rtcp_build_sr(uint8_t *buf,
+                        size_t cap,
+                        uint32_t ssrc,
+                        uint64_t ntp,
+                        uint32_t rtp_timestamp,
+                        uint32_t packets,
+                        uint32_t octets,
+                        const char *cname);
+
+/**
+ * @description: 在 RTCP 复合包的 SR/RR 中查找针对 media_ssrc 的接收报告块。
+ * @param {const uint8_t *} buf RTCP 报文。
+ * @param {size_t} len 报文长度。
+ * @param {uint32_t} media_ssrc 本端发送 SSRC。
+ * @param {MediaRtcpReportBlock *} block 输出报告块。
+ * @return {int} 1 找到，0 没有针对该 SSRC 的报告或不是 RTCP。
+ */
+int media_rtcp_parse_report(const uint8_t *buf, size_t len, uint32_t media_ssrc, MediaRtcpReportBlock *block);
+
+/**
+ * @description: 清空接收端状态，新会话或新客户端开始时调用。
+ * @param {MediaRtcpPeer *} peer 接收端状态。
+ * @return {void}
+ */
+void media_rtcp_peer_reset(MediaRtcpPeer *peer);
+
+/**
+ * @description: 判断是否该给该接收端发 SR，到期时顺延下一次。
+ * @param {MediaRtcpPeer *} peer 接收端状态。
+ * @param {long long} now_ms 当前单调时钟毫秒。
+ * @param {int} interval_ms SR 周期。
+ * @return {int} 1 到期，0 未到期。
+ */
+int media_rtcp_peer_sr_due(MediaRtcpPeer *peer, long long now_ms, int interval_ms);
+
+/**
+ * @description: 解析一个 RTCP 报文，找到针对 media_ssrc 的接收报告时更新丢包率、抖动和 RTT。
+ * @param {MediaRtcpPeer *} peer 接收端状态。
+ * @param {const uint8_t *} buf RTCP 报文。
+ * @param {size_t} len 报文长度。
+ * @param {uint32_t} media_ssrc 本端发送 SSRC。
+ * @param {uint32_t} clock_rate RTP 时钟频率，用于把抖动换算成毫秒。
+ * @param {long long} now_ms 当前单调时钟毫秒。
+ * @return {int} 1 已更新，0 报文中没有针对该 SSRC 的报告。
+ */
+int media_rtcp_peer_on_packet(MediaRtcpPeer *peer,
+                              const uint8_t *buf,
+                              size_t len,
+                              uint32_t media_ssrc,
+                              uint32_t clock_rate,
+                              long long now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef __MEDIA_RTP_EGRESS_H__
+#define __MEDIA_RTP_EGRESS_H__
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "mediaRtpPacer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 一次批量发送最多攒的 RTP 包数。 */
+#define MEDIA_RTP_EGRESS_MAX_BATCH 64
+/* 单个 RTP 包最多由多少段组成（含 RTP 头）。 */
+#define MEDIA_RTP_EGRESS_MAX_PACKET_IOV 18
+/* 可缓存的 RTP 头（含扩展）最大长度。 */
+#define MEDIA_RTP_EGRESS_MAX_HEADER 16
+/* 一次分组平滑发送最多交错的发送器数，超出的按普通 flush 依次发送。 */
+#define MEDIA_RTP_EGRESS_MAX_GROUP 16
+
+typedef enum {
+    MEDIA_RTP_TRANSPORT_UDP = 0,     /* RTP over UDP，批量 sendmmsg / GSO。 */
+    MEDIA_RTP_TRANSPORT_TCP = 1      /* RTP over TCP，RFC 4571 两字节长度前缀，非阻塞写。 */
+} MediaRtpTransport;
+
+typedef struct {
+    int fd;                                  /* 发送用 socket（UDP 或已连接的 TCP），由调用方创建和关闭。 */
+    MediaRtpTransport transport;             /* 当前传输方式。 */
+    struct sockaddr_in remote_addr;          /* 已解析的目标地址。 */
+    char remote_ip[64];                      /* 目标地址缓存键，变化时才重新解析。 */
+    int remote_port;                         /* 目标端口缓存键。 */
+    int target_ready;                        /* remote_addr 是否有效。 */
+    int gso_requested;                       /* 调用方是否希望使用 UDP GSO。 */
+    int gso_supported;                       /* 内核是否支持 UDP_SEGMENT：-1 未探测，0 不支持，1 支持。 */
+    int count;                               /* 当前批次已排队的包数。 */
+    size_t packet_len[MEDIA_RTP_EGRESS_MAX_BATCH];                               /* 各包总长度。 */
+    int packet_iov_count[MEDIA_RTP_EGRESS_MAX_BATCH];                            /* 各包分段数。 */
+    uint8_t headers[MEDIA_RTP_EGRESS_MAX_BATCH][MEDIA_RTP_EGRESS_MAX_HEADER];    /* 各包 RTP 头副本。 */
+    struct iovec iov[MEDIA_RTP_EGRESS_MAX_BATCH][MEDIA_RTP_EGRESS_MAX_PACKET_IOV]; /* 各包分段，负载只引用调用方内存。 */
+    uint64_t frames;                         /* 累计结束的帧数。 */
+    uint64_t packets;                        /* 累计发出的包数。 */
+    uint64_t bytes;                          /* 累计发出的字节数（含 RTP 头）。 */
+    uint64_t syscalls;                       /* 累计发送系统调用次数。 */
+    uint64_t gso_sends;                      /* 其中走 UDP GSO 的次数。 */
+    uint64_t send_cpu_us;                    /* 发送系统调用累计消耗的线程 CPU 时间。 */
+    uint64_t errors;                         /* 累计发送失败次数。 */
+    int pacing;                              /* 是否启用令牌桶平滑。 */
+    MediaRtpPacer pacer;                     /* 发送平滑器，pacing 为 1 时有效。 */
+    uint8_t prefixes[MEDIA_RTP_EGRESS_MAX_BATCH][2]; /* TCP 模式下各包的 RFC 4571 长度前缀。 */
+    uint8_t *tcp_pending;                    /* TCP 写不完的帧尾，下次发送前优先续写，保证流内分帧完整。 */
+    size_t tcp_pending_len;                  /* tcp_pending 中待写字节数。 */
+    size_t tcp_pending_off;                  /* tcp_pending 已写出的偏移。 */
+    size_t tcp_pending_cap;                  /* tcp_pending 容量。 */
+    int frame_dropped;                       /* 当前帧是否已被拥塞策略丢弃，丢弃期间 queue 只计数不发送。 */
+    uint64_t dropped_frames;                 /* 累计因发送缓冲拥塞丢弃的帧数。 */
+    uint64_t tcp_partial_writes;             /* 累计 TCP 部分写次数（帧尾转入 tcp_pending）。 */
+} MediaRtpEgress;
+
+/**
+ * @description: 初始化 RTP 批量发送器。
+ * @param {MediaRtpEgress *} egress 发送器。
+ * @param {int} enable_gso 1 尝试使用 UDP GSO，内核不支持时自动退回 sendmmsg。
+ * @return {void}
+ */
+void media_rtp_egress_init(MediaRtpEgress *egress, int enable_gso);
+
+/**
+ * @description: 设置 socket 和目标地址。参数与上次相同时直接复用已解析的地址。
+ * @param {MediaRtpEgress *} egress 发送器。
+ * @param {int} fd UDP socket。
+ * @param {const char *} remote_ip 目标 IPv4 地址。
+ * @param {int} remote_port 目标端口。
+ * @return {int} 0 成功，-1 地址非法。
+ */
+int media_rtp_egress_set_target(MediaRtpEgress *egress, int fd, const char *remote_ip, int remote_port);
+
+/**
+ * @description: 设置 TCP 目标：fd 为已建立的非阻塞 TCP 连接，每个 RTP 包前加两字节长度（RFC 4571）。
+ *   每次调用都会丢弃排队包和未写完的帧尾，应只在新连接建立时调用一次。
+ * @param {MediaRtpEgress *} egress 发送器。
+ * @param {int} fd 已连接的 TCP socket。
+ * @return {int} 0 成功，-1 参数错误。
+ */
+int media_rtp_egress_set_tcp_target(MediaRtpEgress *egress, int fd);
+
+/**
+ * @description: 释放 TCP 续写缓冲。
+ * @param {MediaRtpEgress *} egress 发送器。
+ * @return {void}
+ */
+void media_rtp_egress_deinit(MediaRtpEgress *egress);
+
+/**
+ * @description: 启用或关闭发送平滑。启用后 flush 按令牌桶节奏分批放行，会在调用线程内等待。
+ * @param {MediaRtpEgress *} egress 发送器。
+ * @param {const MediaRtpPacerConfig *} config 平滑配置，enabled 为 0 时关闭。
+ * @param {int} bitrate 码流码率（bps）。
+ * @param {int} fps 码流帧率。
+ * @return {void}
+ */
+void media_rtp_egress_set_pacing(MediaRtpEgress *egress, const MediaRtpPacerConfig *config, int bitrate, int fps);
+
+/**
+ * @description: 码流码率或帧率被重新配置后更新平滑速率，未启用平滑时什么也不做。
+ * @param {MediaRtpEgress *} egress 发送器。
+ * @param {int} bitrate 新码率（bps）。
+ * @param {int} fps 新帧率。
+ * @return {void}
+ */
+void media_rtp_egress_update_pacing_rate(MediaRtpEgress *egress, int bitrate, int fps);
+
+/**
+ * @description: 通知即将发送的一帧总长度，用于计算本帧平滑速率。
+ *   TCP 模式下同时做拥塞判断：上一帧尾还没写完，或内核发送队列放不下本帧时整帧丢弃，
+ *   之后的 queue 直到 end_frame 都不会发送，调用方应等下一个关键帧再恢复。
+ * @param {MediaRtpEgress *} egress 发送器。
+ * @param {size_t} frame_bytes 本帧负载字节数。
+ * @return {int} 0 正常发送，1 本帧被丢弃。
+ */
+int media_rtp_egress_begin_frame(MediaRtpEgress *egress, size_t frame_bytes);
+
+/**
+ * @description: 排队一个 RTP 包。头部会被拷贝，负载分段只保存引用，必须在 flush/end_frame 前保持有效；批次满时自动发送。
+ * @param {MediaRtpEgress *} egress 发送器。
+ * @param {const uint8_t *} header RTP 头。
+ * @param {size_t} header_len RTP 头长度，不超过 MEDIA_RTP_EGRESS_MAX_HEADER。
+ * @param {const struct iovec *} payload 负载分段。
+ * @param {int} payload_iov_count 负载分段数，不超过 MEDIA_RTP_EGRESS_MAX_PACKET_IOV - 1。
+ * @return {int} 0 成功，-1 参数错误或自动发送失败。
+ */
+int media_rtp_egress_queue(MediaRtpEgress *egress,
+                           const uint8_t *header,
+                           size_t header_len,
+                           const struct iovec *payload,
+                           int payload_iov_count);
+
+/**
+ * @description: 立即发送当前批次；TCP 模式下批次为空时尝试续写上次的帧尾。
+ * @param {MediaRtpEgress *} egress 发送器。
+ * @return {int} 0 成功，-1 发送失败（批次被丢弃）。
+ */
+int media_rtp_egress_flush(MediaRtpEgress *egress);
+
+/**
+ * @description: 在同一个平滑窗口内交错发送多个发送器的当前批次：各自按自己的令牌桶放行，
+ *   调用线程只按其中最短的等待时间睡眠，扇出到 N 个目标时总耗时约为一个平滑窗口而不是 N 个。
+ *   未启用平滑的发送器直接 flush。
+ * @param {MediaRtpEgress **} egresses 发送器数组。
+ * @param {int} count 发送器个数。
+ * @param {int *} results 可为 NULL，输出各发送器的结果：0 成功，-1 发送失败（批次被丢弃）。
+ * @return {int} 0 全部成功，-1 至少一个失败。
+ */
+int media_rtp_egress_flush_group(MediaRtpEgress **egresses, int count, int *results);
+
+/**
+ * @description: 发送本帧剩余的包并计入帧数，调用后负载引用可以释放。
+ * @param {MediaRtpEgress *} egress 发送器。
+ * @return {int} 0 成功，-1 发送失败。
+ */
+int media_rtp_egress_end_frame(MediaRtpEgress *egress);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
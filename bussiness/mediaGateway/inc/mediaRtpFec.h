@@ -0,0 +1,167 @@
+#ifndef __MEDIA_RTP_FEC_H__
+#define __MEDIA_RTP_FEC_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "mediaRtpEgress.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 单帧最多生成的 FEC 包数（保护组数）。 */
+#define MEDIA_RTP_FEC_MAX_GROUPS 128
+/* 一个保护组最多覆盖的媒体包数，对应 RFC 5109 长掩码（L=1）的 48 位。 */
+#define MEDIA_RTP_FEC_MAX_GROUP_SIZE 48
+/* 可保护的最大媒体负载长度。 */
+#define MEDIA_RTP_FEC_MAX_PAYLOAD 1500
+/* FEC 头（10 字节）+ 长掩码 level 0 头（8 字节）。 */
+#define MEDIA_RTP_FEC_HEADER_MAX 18
+
+typedef struct {
+    int enabled;                     /* 是否生成 FEC。 */
+    int payload_type;                /* FEC 包的 RTP 负载类型。 */
+    int key_percent;                 /* 关键帧的 FEC 包数占媒体包数的百分比，0 表示不保护。 */
+    int delta_percent;               /* 非关键帧的 FEC 包数占媒体包数的百分比，0 表示不保护。 */
+} MediaRtpFecConfig;
+
+typedef struct {
+    int first;                       /* 组内首包在本帧中的下标。 */
+    int count;                       /* 组内媒体包数。 */
+    uint64_t mask;                   /* 受保护包掩码，bit 47 对应首包，依次递减。 */
+    uint8_t b0_recovery;             /* 各包 RTP 头第 0 字节（P/X/CC）的异或。 */
+    uint8_t b1_recovery;             /* 各包 RTP 头第 1 字节（M/PT）的异或。 */
+    uint32_t ts_recovery;            /* 各包时间戳的异或。 */
+    uint16_t length_recovery;        /* 各包负载长度的异或。 */
+    size_t protect_len;              /* 组内最长负载，即校验负载长度。 */
+} MediaRtpFecGroup;
+
+/*
+ * 每路源共用一份的 XOR 校验生成器：负载异或只做一次，
+ * 各会话的差异（序号、SSRC）只体现在各自 MediaRtpFecStream 写出的头里。
+ */
+typedef struct {
+    MediaRtpFecConfig config;        /* 归一化后的参数。 */
+    uint8_t *parity;                 /* 各组校验负载，MEDIA_RTP_FEC_MAX_GROUPS * MEDIA_RTP_FEC_MAX_PAYLOAD。 */
+    MediaRtpFecGroup groups[MEDIA_RTP_FEC_MAX_GROUPS]; /* 本帧的保护组。 */
+    int group_count;                 /* 本帧已打开的组数。 */
+    int group_size;                  /* 本帧每组媒体包数，0 表示本帧不保护。 */
+    int frame_packets;               /* 本帧已加入的媒体包数。 */
+    uint64_t frames;                 /* 生成过 FEC 的帧数。 */
+    uint64_t media_packets;          /* 受保护的媒体包数。 */
+    uint64_t fec_packets;            /* 生成的 FEC 包数。 */
+    uint64_t unprotected_packets;    /* 超出组数上限、未受保护的媒体包数。 */
+    uint64_t encode_ns;              /* 累计异或耗时（单调时钟）。 */
+} MediaRtpFecEncoder;
+
+/* 单个会话的 FEC 输出流：独立 SSRC 和序号，不打乱媒体流的序号连续性。 */
+typedef struct {
+    uint32_t ssrc;                   /* FEC 流 SSRC。 */
+    uint16_t seq;                    /* FEC 流下一个序号。 */
+    uint64_t packets;                /* 已排队的 FEC 包数。 */
+    uint64_t bytes;                  /* 已排队的 FEC 字节数（含 RTP 头）。 */
+    uint8_t headers[MEDIA_RTP_FEC_MAX_GROUPS][MEDIA_RTP_FEC_HEADER_MAX]; /* 本帧各 FEC 包的 FEC 头，发出前保持有效。 */
+} MediaRtpFecStream;
+
+/**
+ * @description: 归一化 FEC 配置，未配置的字段填默认值。
+ * @param {MediaRtpFecConfig *} config 待归一化的配置。
+ * @return {void}
+ */
+void media_rtp_fec_fill_default(MediaRtpFecConfig *config);
+
+/**
+ * @description: 初始化校验生成器并分配校验缓冲。
+ * @param {MediaRtpFecEncoder *} encoder 生成器。
+ * @param {const MediaRtpFecConfig *} config 配置。
+ * @return {int} 0 成功，-1 分配失败。
+ */
+int media_rtp_fec_init(MediaRtpFecEncoder *encoder, const MediaRtpFecConfig *config);
+
+/**
+ * @description: 释放校验生成器。
+ * @param {MediaRtpFecEncoder *} encoder 生成器。
+ * @return {void}
+ */
+void media_rtp_fec_deinit(MediaRtpFecEncoder *encoder);
+
+/**
+ * @description: 新帧开始时按帧类型的保护比例划分保护组：FEC 包数 = ceil(媒体包数 * 比例)，组内为连续的媒体包。
+ * @param {MediaRtpFecEncoder *} encoder 生成器。
+ * @param {int} expected_packets 本帧预计的媒体包数。
+ * @param {int} is_key_frame 是否关键帧。
+ * @return {void}
+ */
+void media_rtp_fec_begin_frame(MediaRtpFecEncoder *encoder, int expected_packets, int is_key_frame);
+
+/**
+ * @description: 把一个媒体包异或进当前保护组，必须按发送顺序调用。
+ * @param {MediaRtpFecEncoder *} encoder 生成器。
+ * @param {const uint8_t *} header 12 字节 RTP 头，只用到会话无关的字段。
+ * @param {const struct iovec *} payload 负载分段。
+ * @param {int} payload_iov_count 负载分段数。
+ * @param {size_t} payload_len 负载总长度，不超过 MEDIA_RTP_FEC_MAX_PAYLOAD。
+ * @return {void}
+ */
+void media_rtp_fec_add_packet(MediaRtpFecEncoder *encoder,
+                              const uint8_t *header,
+                              const struct iovec *payload,
+                              int payload_iov_count,
+                              size_t payload_len);
+
+/**
+ * @description: 结束本帧，返回生成的 FEC 包数。
+ * @param {MediaRtpFecEncoder *} encoder 生成器。
+ * @return {int} 本帧保护组数。
+ */
+int media_rtp_fec_end_frame(MediaRtpFecEncoder *encoder);
+
+/**
+ * @description: 写出某个保护组的 FEC 头（RFC 5109 FEC header + level 0 header）。
+ * @param {const MediaRtpFecEncoder *} encoder 生成器。
+ * @param {int} group 组下标。
+ * @param {uint16_t} frame_first_seq 该会话本帧首个媒体包的序号。
+ * @param {uint8_t *} out 输出，至少 MEDIA_RTP_FEC_HEADER_MAX 字节。
+ * @return {size_t} 写出的字节数。
+ */
+size_t media_rtp_fec_write_header(const MediaRtpFecEncoder *encoder, int group, uint16_t frame_first_seq, uint8_t *out);
+
+/**
+ * @description: 取某个保护组的校验负载。
+ * @param {const MediaRtpFecEncoder *} encoder 生成器。
+ * @param {int} group 组下标。
+ * @param {size_t *} len 输出校验负载长度。
+ * @return {const uint8_t *} 校验负载，下一帧 begin 前有效。
+ */
+const uint8_t *media_rtp_fec_parity(const MediaRtpFecEncoder *encoder, int group, size_t *len);
+
+/**
+ * @description: 会话切换时重置 FEC 输出流。
+ * @param {MediaRtpFecStream *} stream 输出流。
+ * @param {uint32_t} ssrc FEC 流 SSRC。
+ * @return {void}
+ */
+void media_rtp_fec_stream_reset(MediaRtpFecStream *stream, uint32_t ssrc);
+
+/**
+ * @description: 把本帧的 FEC 包排进会话的 egress，随媒体包同批发出；负载直接引用生成器的校验缓冲。
+ * @param {const MediaRtpFecEncoder *} encoder 生成器，本帧已 end。
+ * @param {MediaRtpFecStream *} stream 会话的 FEC 输出流。
+ * @param {MediaRtpEgress *} egress 会话的发送器，本帧 end_frame 之前调用。
+ * @param {uint16_t} frame_first_seq 该会话本帧首个媒体包的序号。
+ * @param {uint32_t} rtp_timestamp 本帧 RTP 时间戳。
+ * @return {int} 0 成功，-1 排队失败。
+ */
+int media_rtp_fec_queue(const MediaRtpFecEncoder *encoder,
+                        MediaRtpFecStream *stream,
+                        MediaRtpEgress *egress,
+                        uint16_t frame_first_seq,
+                        uint32_t rtp_timestamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef __MEDIA_RTP_HISTORY_H__
+#define __MEDIA_RTP_HISTORY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "mediaRtpEgress.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 历史里保存的 RTP 头长度（固定 12 字节，无 CSRC/扩展）。 */
+#define MEDIA_RTP_HISTORY_HEADER 12
+
+/* 读到的每个 RTCP 报文在 NACK 处理之后交给调用方，做接收报告等其它处理。 */
+typedef void (*MediaRtcpPacketFn)(void *user, const uint8_t *buf, size_t len);
+
+typedef struct {
+    uint8_t *data;                   /* 负载环形缓冲，同一路源的多个会话共用一份。 */
+    size_t capacity;                 /* 缓冲容量（字节），决定能回溯多久。 */
+    uint64_t write_pos;              /* 累计写入字节数，对 capacity 取模得到实际偏移。 */
+} MediaRtpHistoryArena;
+
+typedef struct {
+    uint64_t pos;                    /* 负载在 arena 中的绝对位置。 */
+    uint32_t len;                    /* 负载长度。 */
+    uint16_t seq;                    /* 该槽位保存的 RTP 序号，与请求序号不一致说明已被覆盖。 */
+    uint8_t valid;                   /* 槽位是否写过。 */
+    uint8_t header[MEDIA_RTP_HISTORY_HEADER]; /* 原样重发用的 RTP 头。 */
+} MediaRtpHistoryEntry;
+
+typedef struct {
+    const MediaRtpHistoryArena *arena; /* 负载所在的共享缓冲。 */
+    MediaRtpHistoryEntry *entries;   /* 按 seq % entry_count 索引的包记录。 */
+    int entry_count;                 /* 记录槽位数，2 的幂。 */
+    uint32_t ssrc;                   /* 本发送流 SSRC，只处理针对它的 NACK。 */
+    uint64_t nack_packets;           /* 收到的 NACK 报文数。 */
+    uint64_t nack_requested;         /* NACK 请求重传的序号总数。 */
+    uint64_t retransmitted;          /* 已重传的包数。 */
+    uint64_t too_late;               /* 请求的包已被覆盖、无法重传的次数。 */
+} MediaRtpHistory;
+
+/**
+ * @description: 分配负载环形缓冲。
+ * @param {MediaRtpHistoryArena *} arena 缓冲。
+ * @param {size_t} capacity 容量（字节）。
+ * @return {int} 0 成功，-1 分配失败。
+ */
+int media_rtp_history_arena_init(MediaRtpHistoryArena *arena, size_t capacity);
+
+/**
+ * @description: 释放负载环形缓冲。
+ * @param {MediaRtpHistoryArena *} arena 缓冲。
+ * @return {void}
+ */
+void media_rtp_history_arena_deinit(MediaRtpHistoryArena *arena);
+
+/**
+ * @description: 追加一个 RTP 包的负载，一个包只拷一次，所有会话的记录都引用这份数据。
+ * @param {MediaRtpHistoryArena *} arena 缓冲。
+ * @param {const struct iovec *} payload 负载分段。
+ * @param {int} payload_iov_count 负载分段数。
+ * @return {uint64_t} 负载起始的绝对位置。
+ */
+uint64_t media_rtp_history_arena_append(MediaRtpHistoryArena *arena, const struct iovec *payload, int payload_iov_count);
+
+/**
+ * @description: 初始化会话重传历史，entry_count 向上取 2 的幂。
+ * @param {MediaRtpHistory *} history 历史。
+ * @param {const MediaRtpHistoryArena *} arena 负载所在的共享缓冲。
+ * @param {int} entry_count 最多记录的包数。
+ * @return {int} 0 成功，-1 分配失败。
+ */
+int media_rtp_history_init(MediaRtpHistory *history, const MediaRtpHistoryArena *arena, int entry_count);
+
+/**
+ * @description: 释放会话重传历史。
+ * @param {MediaRtpHistory *} history 历史。
+ * @return {void}
+ */
+void media_rtp_history_deinit(MediaRtpHistory *history);
+
+/**
+ * @description: 会话切换时清空记录和统计，并绑定新的 SSRC。
+ * @param {MediaRtpHistory *} history 历史。
+ * @param {uint32_t} ssrc 新会话的发送 SSRC。
+ * @return {void}
+ */
+void media_rtp_history_reset(MediaRtpHistory *history, uint32_t ssrc);
+
+/**
+ * @description: 记录一个已排队发送的包。
+ * @param {MediaRtpHistory *} history 历史。
+ * @param {const uint8_t *} header 12 字节 RTP 头。
+ * @param {uint64_t} pos 负载在 arena 中的位置（media_rtp_history_arena_append 返回值）。
+ * @param {size_t} len 负载长度。
+ * @return {void}
+ */
+void media_rtp_history_record(MediaRtpHistory *history, const uint8_t *header, uint64_t pos, size_t len);
+
+/**
+ * @description: 按序号取出仍在历史里的包，供需要改写后再发送的调用方使用（如 SRTP 逐会话重新加密）。
+ * @param {const MediaRtpHistory *} history 历史。
+ * @param {uint16_t} seq RTP 序号。
+ * @param {const MediaRtpHistoryEntry **} entry 输出包记录，header 为原始 RTP 头。
+ * @param {struct iovec *} payload 输出负载分段，至少 2 个（环形缓冲回绕时分成两段）。
+ * @return {int} 负载分段数，包已被覆盖或从未记录时返回 -1。
+ */
+int media_rtp_history_lookup(const MediaRtpHistory *history, uint16_t seq, const MediaRtpHistoryEntry **entry, struct iovec payload[2]);
+
+/**
+ * @description: 解析 RTCP 复合包中针对 media_ssrc 的 Generic NACK（RFC 4585，PT=205 FMT=1），展开 PID/BLP。
+ * @param {const uint8_t *} buf RTCP 报文。
+ * @param {size_t} len 报文长度。
+ * @param {uint32_t} media_ssrc 只接受针对该 SSRC 的反馈。
+ * @param {uint16_t *} seqs 输出丢失序号。
+ * @param {int} max_seqs seqs 容量。
+ * @return {int} 输出的序号数，不是 NACK 或 SSRC 不符时为 0。
+ */
+int media_rtcp_parse_nack(const uint8_t *buf, size_t len, uint32_t media_ssrc, uint16_t *seqs, int max_seqs);
+
+/**
+ * @description: 处理一个已读到的 RTCP 报文，是 NACK 时从历史里取包交给 egress 原样重发。
+ *   供自己读 socket、还要把同一报文交给其他 RTCP 处理（如接收报告）的调用方使用。
+ * @param {MediaRtpHistory *} history 历史。
+ * @param {MediaRtpEgress *} egress 该会话的发送器，目标已设置。
+ * @param {const uint8_t *} buf RTCP 报文。
+ * @param {size_t} len 报文长度。
+ * @return {int} 本次重传的包数，不是针对该 SSRC 的 NACK 时为 0，-1 参数错误。
+ */
+int media_rtp_history_handle_nack(MediaRtpHistory *history, MediaRtpEgress *egress, const uint8_t *buf, size_t len);
+
+/**
+ * @description: 非阻塞读空 fd 上的 RTCP 反馈：history 非空时按 NACK 从历史里取包交给 egress 原样重发，
+ *   每个报文再交给 on_packet（可为 NULL）。单次最多读固定个数的报文，避免反馈风暴占住发送线程。
+ *   只在 egress 所属的发送线程调用；fd 可以是独立 RTCP socket，也可以是 rtcp-mux 的 RTP socket。
+ * @param {MediaRtpHistory *} history 历史，可为 NULL（只转交报文、不重传）。
+ * @param {MediaRtpEgress *} egress 该会话的发送器，目标已设置。
+ * @param {int} fd 接收 RTCP 的 UDP socket。
+ * @param {MediaRtcpPacketFn} on_packet 报文回调，可为 NULL。
+ * @param {void *} user 回调参数。
+ * @return {int} 本次重传的包数，-1 参数错误。
+ */
+int media_rtp_history_serve_rtcp(MediaRtpHistory *history, MediaRtpEgress *egress, int fd, MediaRtcpPacketFn on_packet, void *user);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef __MEDIA_RTP_PACER_H__
+#define __MEDIA_RTP_PACER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int enabled;                     /* 是否对 RTP 发送做平滑。 */
+    int rate_percent;                /* 基础发送速率占码流码率的百分比。 */
+    int burst_bytes;                 /* 令牌桶容量，允许不等待直接发出的突发字节数。 */
+    int spread_percent;              /* 大帧最多摊到帧间隔的百分之多少内发完。 */
+} MediaRtpPacerConfig;
+
+typedef struct {
+    MediaRtpPacerConfig config;      /* 归一化后的平滑参数。 */
+    uint64_t base_rate_bps;          /* 由码率推出的基础速率（字节/秒）。 */
+    uint64_t frame_interval_us;      /* 帧间隔。 */
+    uint64_t rate_bps;               /* 当前帧使用的速率（字节/秒）。 */
+    double tokens;                   /* 当前可用令牌（字节）。 */
+    uint64_t last_refill_us;         /* 上次补充令牌的时间。 */
+    uint64_t paced_packets;          /* 累计经过平滑器的包数。 */
+    uint64_t delayed_packets;        /* 其中需要等待令牌的包数。 */
+    uint64_t delay_us_sum;           /* 累计因平滑增加的排队时延。 */
+    uint64_t delay_us_max;           /* 单包最大平滑时延。 */
+    uint64_t occupancy_sum;          /* 每次放行时排队包数之和。 */
+    uint64_t occupancy_samples;      /* 放行次数。 */
+    int occupancy_max;               /* 最大排队包数。 */
+} MediaRtpPacer;
+
+/**
+ * @description: 归一化平滑配置，未配置的字段填默认值。
+ * @param {MediaRtpPacerConfig *} config 待归一化的配置。
+ * @return {void}
+ */
+void media_rtp_pacer_fill_default(MediaRtpPacerConfig *config);
+
+/**
+ * @description: 按码流码率和帧率初始化平滑器，令牌桶初始为满。
+ * @param {MediaRtpPacer *} pacer 平滑器。
+ * @param {const MediaRtpPacerConfig *} config 已归一化的配置。
+ * @param {int} bitrate 码流码率（bps）。
+ * @param {int} fps 码流帧率。
+ * @return {void}
+ */
+void media_rtp_pacer_init(MediaRtpPacer *pacer, const MediaRtpPacerConfig *config, int bitrate, int fps);
+
+/**
+ * @description: 码流码率或帧率调整后重算基础速率和帧间隔，令牌和统计保持不变，从下一帧起生效。
+ * @param {MediaRtpPacer *} pacer 平滑器。
+ * @param {int} bitrate 新码率（bps）。
+ * @param {int} fps 新帧率。
+ * @return {void}
+ */
+void media_rtp_pacer_set_rate(MediaRtpPacer *pacer, int bitrate, int fps);
+
+/**
+ * @description: 新帧开始时调用，速率取基础速率与“整帧在 spread 窗口内发完”所需速率中的较大值。
+ * @param {MediaRtpPacer *} pacer 平滑器。
+ * @param {size_t} frame_bytes 本帧待发送字节数。
+ * @return {void}
+ */
+void media_rtp_pacer_begin_frame(MediaRtpPacer *pacer, size_t frame_bytes);
+
+/**
+ * @description: 尝试为一个包扣除令牌。
+ * @param {MediaRtpPacer *} pacer 平滑器。
+ * @param {size_t} bytes 包长度。
+ * @param {uint64_t} now_us 当前单调时钟时间。
+ * @param {uint64_t *} wait_us 令牌不足时输出还需等待的时长。
+ * @return {int} 1 可以立即发送（已扣除令牌），0 需要等待。
+ */
+int media_rtp_pacer_try_consume(MediaRtpPacer *pacer, size_t bytes, uint64_t now_us, uint64_t *wait_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
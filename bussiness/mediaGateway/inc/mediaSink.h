@@ -31,6 +31,7 @@ typedef struct {
     uint64_t reconnect_count;   /* 成功重连的次数。 */
     uint64_t send_failures;     /* 发送失败次数。 */
     int queue_depth;            /* 当前队列深度。 */
+    uint64_t oldest_packet_age_us; /* 队头（最旧）媒体包距采集时刻的时长，队列为空时为 0。 */
     int connected;                       /* 当前 sink 的发送通道是否已就绪（如 session 已创建，可发送数据）。 */
     int waiting_for_keyframe;   /* 当前是否处于等待关键帧恢复发送的状态。 */
 } MediaSinkStats;
@@ -41,6 +42,8 @@ typedef struct {
     int (*send_packet)(MediaSink *sink, const MediaPacket *packet); /* sink 发送钩子，负责输出单帧数据。 */
     void (*disconnect)(MediaSink *sink);                      /* sink 断开钩子，用于释放连接态资源。 */
     void (*stop)(MediaSink *sink);                            /* sink 停止钩子，用于整体退出前清理。 */
+    int (*has_consumer)(MediaSink *sink);                     /* 可选：下游当前是否有观看端；为 NULL 视为始终有（如 RTMP 推流）。 */
+    void (*log_stats)(MediaSink *sink);                       /* 可选：周期统计时打印协议自身的细分统计（如每个观看端），可为 NULL。 */
 } MediaSinkVTable;
 
 struct MediaSink {
@@ -71,6 +74,30 @@ void media_sink_stop(MediaSink *sink);
 void media_sink_deinit(MediaSink *sink);
 void media_sink_get_stats(MediaSink *sink, MediaSinkStats *stats);
 
+/**
+ * @description: 查询 sink 下游当前是否有观看端，供按需编码判断码流是否可以暂停。
+ * @param {MediaSink *} sink 输出通道。
+ * @return {int} 1 有观看端或无法判断，0 无观看端。
+ */
+int media_sink_has_consumer(MediaSink *sink);
+
+/**
+ * @description: 打印 sink 协议层的细分统计，sink 没有实现时什么也不做。
+ * @param {MediaSink *} sink 输出通道。
+ * @return {void}
+ */
+void media_sink_log_stats(MediaSink *sink);
+
+/**
+ * @description: 用一段以关键帧开头的连续媒体包替换发送队列中尚未发送的数据。
+ *               用于新接入的独占下游直接从最近关键帧开始播放，而不必等编码器再出一个 IDR。
+ * @param {MediaSink *} sink 输出通道。
+ * @param {const MediaPacket *} packets 按解码顺序排列的媒体包，首个必须是关键帧。
+ * @param {int} count 媒体包数量，不能超过队列容量。
+ * @return {int} 0 成功，-1 参数非法或超出队列容量。
+ */
+int media_sink_prime(MediaSink *sink, const MediaPacket *packets, int count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -4,6 +4,10 @@
 
 #include "logger.h"
 
+#if defined(ENABLE_RTMP_SINK)
+#include "rtmpFanoutSink.h"
+#endif
+
 #include <errno.h>
 #include <inttypes.h>
 #include <stdio.h>
@@ -28,6 +32,8 @@
 #define DEFAULT_BENCH_ENABLE 0
 #define DEFAULT_BENCH_SAMPLE_EVERY 1
 #define DEFAULT_BENCH_PRINT_INTERVAL_SEC 1
+#define DEFAULT_ON_DEMAND_LINGER_MS 3000
+#define ON_DEMAND_POLL_INTERVAL_MS 100
 
 static const char *safe_str(const char *value, const char *fallback) {
     /* Return configured string when valid; otherwise use fallback. */
@@ -284,6 +290,12 @@ static void fill_default_stream(MediaGatewayStreamConfig *dst,
     if (dst->h264_profile <= 0) dst->h264_profile = DEFAULT_H264_PROFILE;
     if (dst->h264_level <= 0) dst->h264_level = DEFAULT_H264_LEVEL;
     if (dst->h264_cabac_en <= 0) dst->h264_cabac_en = DEFAULT_H264_CABAC_EN;
+    media_gateway_abr_fill_default(&dst->abr, dst->bitrate);
+    media_gateway_idr_fill_default(&dst->idr);
+    media_gateway_motion_fill_default(&dst->motion, dst->fps);
+    dst->on_demand = dst->on_demand ? 1 : 0;
+    if (dst->on_demand_linger_ms <= 0) dst->on_demand_linger_ms = DEFAULT_ON_DEMAND_LINGER_MS;
+    dst->on_demand_pause_capture = dst->on_demand_pause_capture ? 1 : 0;
 
     dst->rtsp.name = safe_str(dst->rtsp.name, (stream_idx == 0) ? "rtsp-main" : "rtsp-sub");
     dst->rtsp.session_name = safe_str(dst->rtsp.session_name, (stream_idx == 0) ? "live_main" : "live_sub");
@@ -293,18 +305,76 @@ static void fill_default_stream(MediaGatewayStreamConfig *dst,
     dst->rtsp.password = safe_str(dst->rtsp.password, "123456");
     if (dst->rtsp.queue_capacity <= 0) dst->rtsp.queue_capacity = 32;
     if (dst->rtsp.immediate_sps_pps_on_new_client != 0) dst->rtsp.immediate_sps_pps_on_new_client = 1;
+    if (dst->rtsp.gop_cache_max_frames < 0) dst->rtsp.gop_cache_max_frames = 0;
+    if (dst->rtsp.gop_cache_max_age_ms <= 0) dst->rtsp.gop_cache_max_age_ms = 2000;
+    dst->rtsp.multicast_group = safe_str(dst->rtsp.multicast_group, "");
+    if (dst->rtsp.multicast_port <= 0) dst->rtsp.multicast_port = (stream_idx == 0) ? 5004 : 5006;
+    if (dst->rtsp.multicast_ttl <= 0) dst->rtsp.multicast_ttl = 1;
+    dst->rtsp.multicast_interface = safe_str(dst->rtsp.multicast_interface, "");
 
     dst->rtmp.name = safe_str(dst->rtmp.name, (stream_idx == 0) ? "rtmp-main" : "rtmp-sub");
     dst->rtmp.video_codec_name = safe_str(dst->rtmp.video_codec_name, "H264");
     dst->rtmp.encoder_name = safe_str(dst->rtmp.encoder_name, "RKMediaGateway");
     if (dst->rtmp.queue_capacity <= 0) dst->rtmp.queue_capacity = 64;
     if (dst->rtmp.reconnect_interval_ms <= 0) dst->rtmp.reconnect_interval_ms = 1000;
+    if (dst->rtmp.max_reconnect_interval_ms <= 0) dst->rtmp.max_reconnect_interval_ms = 30000;
     if (dst->rtmp.connect_timeout_ms <= 0) dst->rtmp.connect_timeout_ms = 3000;
     if (dst->rtmp.video_width <= 0) dst->rtmp.video_width = dst->width;
     if (dst->rtmp.video_height <= 0) dst->rtmp.video_height = dst->height;
     if (dst->rtmp.video_fps <= 0) dst->rtmp.video_fps = dst->fps;
     if (dst->rtmp.video_bitrate <= 0) dst->rtmp.video_bitrate = dst->bitrate;
 
+    dst->http_flv.name = safe_str(dst->http_flv.name, (stream_idx == 0) ? "http-flv-main" : "http-flv-sub");
+    dst->http_flv.listen_ip = safe_str(dst->http_flv.listen_ip, "0.0.0.0");
+    if (dst->http_flv.listen_port <= 0) dst->http_flv.listen_port = (stream_idx == 0) ? 8080 : 8081;
+    dst->http_flv.stream_name = safe_str(dst->http_flv.stream_name, safe_str(dst->name, (stream_idx == 0) ? "main" : "sub"));
+    dst->http_flv.encoder_name = safe_str(dst->http_flv.encoder_name, "RKMediaGateway");
+    if (dst->http_flv.queue_capacity <= 0) dst->http_flv.queue_capacity = 64;
+    if (dst->http_flv.max_clients <= 0) dst->http_flv.max_clients = 32;
+    if (dst->http_flv.client_budget_bytes <= 0) dst->http_flv.client_budget_bytes = 4 * 1024 * 1024;
+    if (dst->http_flv.gop_cache_max_frames <= 0) dst->http_flv.gop_cache_max_frames = dst->gop * 2;
+    if (dst->http_flv.video_width <= 0) dst->http_flv.video_width = dst->width;
+    if (dst->http_flv.video_height <= 0) dst->http_flv.video_height = dst->height;
+    if (dst->http_flv.video_fps <= 0) dst->http_flv.video_fps = dst->fps;
+    if (dst->http_flv.video_bitrate <= 0) dst->http_flv.video_bitrate = dst->bitrate;
+
+    dst->ts_udp.name = safe_str(dst->ts_udp.name, (stream_idx == 0) ? "ts-udp-main" : "ts-udp-sub");
+    dst->ts_udp.dest_ip = safe_str(dst->ts_udp.dest_ip, "239.0.0.1");
+    if (dst->ts_udp.dest_port <= 0) dst->ts_udp.dest_port = (stream_idx == 0) ? 1234 : 1236;
+    if (dst->ts_udp.multicast_ttl <= 0) dst->ts_udp.multicast_ttl = 1;
+    dst->ts_udp.multicast_interface = safe_str(dst->ts_udp.multicast_interface, "");
+    if (dst->ts_udp.queue_capacity <= 0) dst->ts_udp.queue_capacity = 64;
+    if (dst->ts_udp.packets_per_datagram <= 0) dst->ts_udp.packets_per_datagram = 7;
+    if (dst->ts_udp.video_fps <= 0) dst->ts_udp.video_fps = dst->fps;
+    if (dst->ts_udp.video_bitrate <= 0) dst->ts_udp.video_bitrate = dst->bitrate;
+
+    dst->ll_hls.name = safe_str(dst->ll_hls.name, (stream_idx == 0) ? "ll-hls-main" : "ll-hls-sub");
+    dst->ll_hls.listen_ip = safe_str(dst->ll_hls.listen_ip, "0.0.0.0");
+    if (dst->ll_hls.listen_port <= 0) dst->ll_hls.listen_port = (stream_idx == 0) ? 8088 : 8089;
+    dst->ll_hls.stream_name = safe_str(dst->ll_hls.stream_name, safe_str(dst->name, (stream_idx == 0) ? "main" : "sub"));
+    if (dst->ll_hls.queue_capacity <= 0) dst->ll_hls.queue_capacity = 64;
+    if (dst->ll_hls.max_clients <= 0) dst->ll_hls.max_clients = 32;
+    if (dst->ll_hls.segment_target_ms <= 0) dst->ll_hls.segment_target_ms = 2000;
+    if (dst->ll_hls.part_target_ms <= 0) dst->ll_hls.part_target_ms = 200;
+    if (dst->ll_hls.playlist_segments <= 0) dst->ll_hls.playlist_segments = 6;
+    if (dst->ll_hls.video_width <= 0) dst->ll_hls.video_width = dst->width;
+    if (dst->ll_hls.video_height <= 0) dst->ll_hls.video_height = dst->height;
+    if (dst->ll_hls.video_fps <= 0) dst->ll_hls.video_fps = dst->fps;
+    if (dst->ll_hls.video_bitrate <= 0) dst->ll_hls.video_bitrate = dst->bitrate;
+
+    dst->webrtc.name = safe_str(dst->webrtc.name, (stream_idx == 0) ? "webrtc-main" : "webrtc-sub");
+    dst->webrtc.listen_ip = safe_str(dst->webrtc.listen_ip, "0.0.0.0");
+    if (dst->webrtc.http_port <= 0) dst->webrtc.http_port = (stream_idx == 0) ? 8090 : 8091;
+    if (dst->webrtc.media_port <= 0) dst->webrtc.media_port = (stream_idx == 0) ? 8092 : 8093;
+    dst->webrtc.announce_ip = safe_str(dst->webrtc.announce_ip, "");
+    dst->webrtc.stream_name = safe_str(dst->webrtc.stream_name, safe_str(dst->name, (stream_idx == 0) ? "main" : "sub"));
+    if (dst->webrtc.queue_capacity <= 0) dst->webrtc.queue_capacity = 64;
+    if (dst->webrtc.max_peers <= 0) dst->webrtc.max_peers = 8;
+    if (dst->webrtc.rtp_max_payload <= 0) dst->webrtc.rtp_max_payload = 1200;
+    if (dst->webrtc.nack_history_ms <= 0) dst->webrtc.nack_history_ms = 1000;
+    if (dst->webrtc.video_fps <= 0) dst->webrtc.video_fps = dst->fps;
+    if (dst->webrtc.video_bitrate <= 0) dst->webrtc.video_bitrate = dst->bitrate;
+
     dst->gb28181.name = safe_str(dst->gb28181.name, (stream_idx == 0) ? "gb28181-main" : "gb28181-sub");
     dst->gb28181.server_ip = safe_str(dst->gb28181.server_ip, "192.168.1.1");
     if (dst->gb28181.server_port <= 0) dst->gb28181.server_port = 5060;
@@ -326,8 +396,11 @@ static void fill_default_stream(MediaGatewayStreamConfig *dst,
     dst->gb28181.model = safe_str(dst->gb28181.model, "RKMediaGateway");
     dst->gb28181.firmware = safe_str(dst->gb28181.firmware, "1.0.0");
     dst->gb28181.channel_id = safe_str(dst->gb28181.channel_id, dst->gb28181.device_id);
+    dst->gb28181.channel_name = safe_str(dst->gb28181.channel_name, dst->gb28181.device_name);
     dst->gb28181.user_agent = safe_str(dst->gb28181.user_agent, "RKMediaGateway-GB28181/1.0");
     if (dst->gb28181.queue_capacity <= 0) dst->gb28181.queue_capacity = 64;
+    if (dst->gb28181.video_fps <= 0) dst->gb28181.video_fps = dst->fps;
+    if (dst->gb28181.video_bitrate <= 0) dst->gb28181.video_bitrate = dst->bitrate;
 }
 
 static void fill_default_config(MediaGatewayConfig *dst, const MediaGatewayConfig *src) {
@@ -382,10 +455,19 @@ static void fill_default_config(MediaGatewayConfig *dst, const MediaGatewayConfi
         s0.enable_rtsp = dst->enable_rtsp;
         s0.enable_rtmp = dst->enable_rtmp;
         s0.enable_gb28181 = dst->enable_gb28181;
+        s0.enable_http_flv = dst->enable_http_flv;
+        s0.enable_ts_udp = dst->enable_ts_udp;
+        s0.enable_ll_hls = dst->enable_ll_hls;
+        s0.enable_webrtc = dst->enable_webrtc;
         s0.rtsp = dst->rtsp;
         s0.rtmp = dst->rtmp;
         s0.gb28181 = dst->gb28181;
-        if (s0.enable_rtsp == 0 && s0.enable_rtmp == 0 && s0.enable_gb28181 == 0) {
+        s0.http_flv = dst->http_flv;
+        s0.ts_udp = dst->ts_udp;
+        s0.ll_hls = dst->ll_hls;
+        s0.webrtc = dst->webrtc;
+        if (s0.enable_rtsp == 0 && s0.enable_rtmp == 0 && s0.enable_gb28181 == 0 && s0.enable_http_flv == 0 &&
+            s0.enable_ts_udp == 0 && s0.enable_ll_hls == 0 && s0.enable_webrtc == 0) {
             s0.enable_rtsp = DEFAULT_ENABLE_RTSP;
         }
         fill_default_stream(&dst->streams[0], &s0, 0);
@@ -551,38 +633,174 @@ static void bench_log_and_reset_if_due(MediaGatewayCtx *ctx) {
     bench_reset_window(ctx);
 }
 
+static void release_idr_cache(MediaGatewayCtx *ctx, int stream_idx) {
+    /* Drop the cached keyframe run and release its buffer references. */
+    int i;
+    for (i = 0; i < ctx->idr_cache_count[stream_idx]; ++i) {
+        media_packet_reset(&ctx->idr_cache[stream_idx][i]);
+    }
+    ctx->idr_cache_count[stream_idx] = 0;
+}
+
+static void cache_idr_packet(MediaGatewayCtx *ctx, int stream_idx, const MediaPacket *packet) {
+    /* Keep the latest keyframe and the frames after it while it is fresh enough to replay. */
+    uint64_t now = get_now_us();
+    int count;
+
+    if (packet->is_key_frame) {
+        media_gateway_idr_on_keyframe(&ctx->idr[stream_idx], now);
+        release_idr_cache(ctx, stream_idx);
+    } else if (ctx->idr_cache_count[stream_idx] == 0) {
+        return;
+    }
+    /* 目前只有 GB28181 sink 会回放缓存（且仅在没有会话正在收流时），没有它就不必持有引用。 */
+    if (ctx->gb28181_sink_index[stream_idx] < 0) return;
+    count = ctx->idr_cache_count[stream_idx];
+    /* 关键帧过了复用窗口或后续帧超出容量后，缓存已不可能被回放，尽早释放 buffer 引用。 */
+    if (!media_gateway_idr_fresh(&ctx->idr[stream_idx], now) || count >= MEDIA_GATEWAY_IDR_CACHE_FRAMES) {
+        release_idr_cache(ctx, stream_idx);
+        return;
+    }
+    media_packet_copy_ref(&ctx->idr_cache[stream_idx][count], packet);
+    ctx->idr_cache_count[stream_idx] = count + 1;
+}
+
+static uint64_t paced_gop_left_us(const MediaGatewayCtx *ctx, int stream_idx, uint64_t now) {
+    /* Time until the GOP duration implied by the configured fps runs out, while pacing runs below that fps. */
+    const MediaGatewayStreamConfig *stream_cfg = &ctx->config.streams[stream_idx];
+    return media_gateway_motion_gop_left_us(ctx->next_encode_ts_us[stream_idx],
+                                            ctx->idr[stream_idx].last_keyframe_ts_us,
+                                            stream_cfg->fps,
+                                            stream_cfg->gop,
+                                            now);
+}
+
+static void keep_paced_gop_duration(MediaGatewayCtx *ctx, int stream_idx) {
+    /*
+     * GOP 按帧数计，静止降到 1fps 时 30 帧的 GOP 会拉长到 30 秒，新观看端恢复和各 sink 的 GOP 缓存都随之膨胀。
+     * 降帧期间按配置帧率下的 GOP 时长补发关键帧，让关键帧间隔在时间上保持不变。
+     */
+    uint64_t now = get_now_us();
+    if (ctx->idr[stream_idx].in_flight || paced_gop_left_us(ctx, stream_idx, now) != 0) return;
+    if (mpp_encoder_request_idr(&ctx->encoders[stream_idx]) != 0) {
+        fprintf(stderr, "[WARN] stream=%d failed to request paced GOP IDR\n", stream_idx);
+        return;
+    }
+    ctx->paced_gop_idr_count[stream_idx]++;
+}
+
+static uint64_t natural_idr_in_us(const MediaGatewayCtx *ctx, int stream_idx, uint64_t now) {
+    /* Estimate when mpp_encoder_encode_frame will force its next periodic IDR. */
+    const MppEncoderCtx *enc = &ctx->encoders[stream_idx];
+    uint64_t interval_us = ctx->encode_interval_us[stream_idx];
+    uint64_t last_us = ctx->last_encode_ts_us[stream_idx];
+    uint64_t gop_left_us;
+    int64_t frames;
+    if (enc->gop <= 0 || enc->fps <= 0) return UINT64_MAX;
+    frames = enc->pts % enc->gop;
+    if (frames != 0) frames = enc->gop - frames;
+    /*
+     * GOP 按送编码的帧数计，剩余帧数要乘实际帧间隔而不是配置帧率：ABR 降帧或静止降帧时实际间隔可能是配置的数十倍。
+     * 刚进入降帧时平滑值还没跟上，距上一帧已过去的时长是当前间隔的下限。
+     */
+    if (interval_us == 0) interval_us = 1000000ULL / (uint64_t)enc->fps;
+    if (last_us != 0 && now > last_us && now - last_us > interval_us) interval_us = now - last_us;
+    gop_left_us = paced_gop_left_us(ctx, stream_idx, now);
+    if (gop_left_us < (uint64_t)frames * interval_us) return gop_left_us;
+    return (uint64_t)frames * interval_us;
+}
+
+static void track_encode_interval(MediaGatewayCtx *ctx, int stream_idx, uint64_t ts_us) {
+    /* Smooth the interval between frames actually handed to the encoder. */
+    uint64_t last_us = ctx->last_encode_ts_us[stream_idx];
+    ctx->last_encode_ts_us[stream_idx] = ts_us;
+    if (last_us == 0 || ts_us <= last_us) return;
+    ctx->encode_interval_us[stream_idx] = (ctx->encode_interval_us[stream_idx] == 0)
+                                              ? ts_us - last_us
+                                              : (ctx->encode_interval_us[stream_idx] * 7 + (ts_us - last_us)) / 8;
+}
+
 static void trigger_external_idr_if_needed(MediaGatewayCtx *ctx, int stream_idx) {
-    /* Bridge external sink key-frame request to encoder IDR request. */
+    /* Arbitrate external sink key-frame requests before they reach the encoder. */
+    MediaGatewayIdrArbiter *arbiter;
     int sink_idx;
-    int need_idr = 0;
+    uint64_t now;
     if (!ctx || stream_idx < 0 || stream_idx >= MEDIA_GATEWAY_MAX_STREAMS) return;
 
-    /* GB28181: 点播建立后可请求上游尽快补关键帧。 */
+    arbiter = &ctx->idr[stream_idx];
+    now = get_now_us();
+
+    /*
+     * GB28181: 点播建立后可请求上游尽快补关键帧。
+     * 通道内所有点播会话共用该 sink 的发送队列：只有在没有会话正在收流时（都在等关键帧），
+     * 最近关键帧还新鲜才把缓存回放进队列，省掉一次 IDR；否则已在观看的会话会重复收到旧帧，只能走仲裁后的新 IDR。
+     */
     sink_idx = ctx->gb28181_sink_index[stream_idx];
     if (sink_idx >= 0 && sink_idx < ctx->sink_count) {
         if (gb28181_sink_consume_external_idr_request(&ctx->sinks[sink_idx])) {
-            need_idr = 1;
+            int reused = (media_gateway_idr_fresh(arbiter, now) &&
+                          !gb28181_sink_has_live_session(&ctx->sinks[sink_idx]) &&
+                          media_sink_prime(&ctx->sinks[sink_idx],
+                                           ctx->idr_cache[stream_idx],
+                                           ctx->idr_cache_count[stream_idx]) == 0);
+            media_gateway_idr_request(arbiter, now, reused);
+            if (reused) {
+                printf("[IDR] stream=%d sink=%s event=reuse frames=%d age_ms=%" PRIu64 "\n",
+                       stream_idx,
+                       ctx->sinks[sink_idx].config.name ? ctx->sinks[sink_idx].config.name : "unknown",
+                       ctx->idr_cache_count[stream_idx],
+                       (uint64_t)((now - arbiter->last_keyframe_ts_us) / 1000ULL));
+            }
         }
     }
 
     /*
      * RTSP: 检测到“新客户端连入”后，也触发一次 IDR。
      * 这样新观看端不必长时间等待下一个自然 GOP 关键帧。
+     * RTSP 会话内所有客户端共用一路发送，回放缓存会让已在观看的客户端画面回退，只能走仲裁后的新 IDR。
      */
     sink_idx = ctx->rtsp_sink_index[stream_idx];
     if (sink_idx >= 0 && sink_idx < ctx->sink_count) {
         if (rtsp_sink_consume_external_idr_request(&ctx->sinks[sink_idx])) {
-            need_idr = 1;
+            media_gateway_idr_request(arbiter, now, 0);
+        }
+    }
+
+    /*
+     * WebRTC: 新会话 DTLS 建立、播放端 PLI/FIR 都要求关键帧。
+     * 各对端共用一路打包和序号，且解码器已丢失参考帧，回放缓存帮不上，同样走仲裁后的新 IDR。
+     */
+    sink_idx = ctx->webrtc_sink_index[stream_idx];
+    if (sink_idx >= 0 && sink_idx < ctx->sink_count) {
+        if (webrtc_sink_consume_external_idr_request(&ctx->sinks[sink_idx])) {
+            media_gateway_idr_request(arbiter, now, 0);
         }
     }
 
-    if (need_idr) {
+    if (media_gateway_idr_poll(arbiter, now, natural_idr_in_us(ctx, stream_idx, now))) {
+        printf("[IDR] stream=%d event=issue requested=%" PRIu64 " coalesced=%" PRIu64 " issued=%" PRIu64 "\n",
+               stream_idx,
+               arbiter->requested_count,
+               arbiter->coalesced_count,
+               arbiter->issued_count);
         if (mpp_encoder_request_idr(&ctx->encoders[stream_idx]) != 0) {
             fprintf(stderr, "[WARN] stream=%d failed to request IDR from external sink event\n", stream_idx);
         }
     }
 }
 
+static int stream_encode_bitrate(const MediaGatewayCtx *ctx, int stream_idx) {
+    /* 编码器运行码率：ABR 下调时低于配置码率；控制器尚未初始化时取配置值。 */
+    int bitrate = ctx->abr[stream_idx].current_bitrate;
+    return (bitrate > 0) ? bitrate : ctx->config.streams[stream_idx].bitrate;
+}
+
+static int stream_encode_fps(const MediaGatewayCtx *ctx, int stream_idx) {
+    /* 编码器运行帧率：ABR 降帧时低于配置帧率；GOP 时长等按配置帧率计算的地方不要用它。 */
+    int fps = ctx->abr[stream_idx].current_fps;
+    return (fps > 0) ? fps : ctx->config.streams[stream_idx].fps;
+}
+
 static int reset_encoder(MediaGatewayCtx *ctx, int stream_idx) {
     /* Recreate one encoder instance using current stream settings. */
     MppEncoderOptions options;
@@ -590,6 +808,7 @@ static int reset_encoder(MediaGatewayCtx *ctx, int stream_idx) {
     if (!ctx || stream_idx < 0 || stream_idx >= MEDIA_GATEWAY_MAX_STREAMS) return -1;
     stream_cfg = &ctx->config.streams[stream_idx];
     build_encoder_options(stream_cfg, &options);
+    release_idr_cache(ctx, stream_idx);
     if (ctx->encoder_ready[stream_idx]) {
         mpp_encoder_deinit(&ctx->encoders[stream_idx]);
         ctx->encoder_ready[stream_idx] = 0;
@@ -597,8 +816,8 @@ static int reset_encoder(MediaGatewayCtx *ctx, int stream_idx) {
     if (mpp_encoder_init(&ctx->encoders[stream_idx],
                          stream_cfg->width,
                          stream_cfg->height,
-                         stream_cfg->fps,
-                         stream_cfg->bitrate,
+                         stream_encode_fps(ctx, stream_idx),
+                         stream_encode_bitrate(ctx, stream_idx),
                          stream_cfg->gop,
                          &options) < 0) {
         return -1;
@@ -607,13 +826,354 @@ static int reset_encoder(MediaGatewayCtx *ctx, int stream_idx) {
     return 0;
 }
 
+static void update_sink_pacing_rate(MediaGatewayCtx *ctx, int stream_idx) {
+    /* Let the RTP/UDP pacers follow the bitrate and fps the encoder now runs at. */
+    int bitrate = stream_encode_bitrate(ctx, stream_idx);
+    int fps = stream_encode_fps(ctx, stream_idx);
+    int sink_idx;
+
+    sink_idx = ctx->gb28181_sink_index[stream_idx];
+    if (sink_idx >= 0 && sink_idx < ctx->sink_count) {
+        gb28181_sink_update_rate(&ctx->sinks[sink_idx], bitrate, fps);
+    }
+    sink_idx = ctx->ts_udp_sink_index[stream_idx];
+    if (sink_idx >= 0 && sink_idx < ctx->sink_count) {
+        ts_udp_sink_update_rate(&ctx->sinks[sink_idx], bitrate, fps);
+    }
+}
+
+static int apply_pending_stream_tuning(MediaGatewayCtx *ctx,
+                                       int stream_idx,
+                                       const MediaGatewayCapturedFrame *frame) {
+    /* Apply queued runtime tuning in place; only a resolution change recreates the encoder. */
+    MediaGatewayStreamTuning tuning;
+    MediaGatewayStreamConfig *stream_cfg;
+    MediaGatewayStreamConfig next_cfg;
+    MppEncoderOptions options;
+    uint64_t start_us;
+    int encode_bitrate;
+    int encode_fps;
+    int ret;
+
+    if (!ctx->tuning_lock_ready) return 0;
+    memset(&tuning, 0, sizeof(tuning));
+    pthread_mutex_lock(&ctx->tuning_lock);
+    if (!ctx->tuning_pending[stream_idx] && !ctx->abr_rate_pending[stream_idx]) {
+        pthread_mutex_unlock(&ctx->tuning_lock);
+        return 0;
+    }
+    if (ctx->tuning_pending[stream_idx]) {
+        tuning = ctx->pending_tuning[stream_idx];
+        memset(&ctx->pending_tuning[stream_idx], 0, sizeof(ctx->pending_tuning[stream_idx]));
+        ctx->tuning_pending[stream_idx] = 0;
+    }
+    ctx->abr_rate_pending[stream_idx] = 0;
+    pthread_mutex_unlock(&ctx->tuning_lock);
+
+    /* 先在副本上合并调参，编码器接受后才写回码流配置，失败时配置始终与编码器实际参数一致。 */
+    stream_cfg = &ctx->config.streams[stream_idx];
+    next_cfg = *stream_cfg;
+    if (tuning.width > 0) next_cfg.width = tuning.width & ~1;
+    if (tuning.height > 0) next_cfg.height = tuning.height & ~1;
+    if (tuning.fps > 0) next_cfg.fps = tuning.fps;
+    if (tuning.bitrate > 0) next_cfg.bitrate = tuning.bitrate;
+    if (tuning.gop > 0) next_cfg.gop = tuning.gop;
+    if (tuning.qp_init > 0) next_cfg.qp_init = tuning.qp_init;
+    if (tuning.qp_min > 0) next_cfg.qp_min = tuning.qp_min;
+    if (tuning.qp_max > 0) next_cfg.qp_max = tuning.qp_max;
+    if (tuning.qp_min_i > 0) next_cfg.qp_min_i = tuning.qp_min_i;
+    if (tuning.qp_max_i > 0) next_cfg.qp_max_i = tuning.qp_max_i;
+    if (tuning.qp_max_step > 0) next_cfg.qp_max_step = tuning.qp_max_step;
+
+    /*
+     * 配置值和运行值分开：手动改了帧率或码率，编码器直接按新配置运行；
+     * 否则沿用 ABR 当前的运行值，ABR 升降只改运行值，不覆盖配置帧率和码率。
+     */
+    encode_bitrate = (tuning.bitrate > 0) ? next_cfg.bitrate : stream_encode_bitrate(ctx, stream_idx);
+    encode_fps = (tuning.fps > 0) ? next_cfg.fps : stream_encode_fps(ctx, stream_idx);
+
+    build_encoder_options(&next_cfg, &options);
+    start_us = get_now_us();
+    ret = mpp_encoder_reconfigure(&ctx->encoders[stream_idx],
+                                  next_cfg.width,
+                                  next_cfg.height,
+                                  encode_fps,
+                                  encode_bitrate,
+                                  next_cfg.gop,
+                                  &options);
+    if (ret < 0) {
+        fprintf(stderr, "[WARN] stream=%d reconfigure failed, keep previous settings\n", stream_idx);
+        /* Resolution path tears the encoder down before init, rebuild it with the old settings. */
+        if (!ctx->encoders[stream_idx].ctx) return (reset_encoder(ctx, stream_idx) != 0) ? -1 : 0;
+        /* 原地调参失败时编码器仍按旧值运行，ABR 的运行值要跟它对齐，下次决策才从真实码率起步。 */
+        ctx->abr[stream_idx].current_bitrate = ctx->encoders[stream_idx].bitrate;
+        ctx->abr[stream_idx].current_fps = ctx->encoders[stream_idx].fps;
+        return 0;
+    }
+    pthread_mutex_lock(&ctx->tuning_lock);
+    *stream_cfg = next_cfg;
+    pthread_mutex_unlock(&ctx->tuning_lock);
+
+    /* 手动调参后 ABR 的配置值、调节上下限和当前值一起换成新配置，恢复时不会再回到旧帧率或旧码率。 */
+    media_gateway_abr_retune(&ctx->abr[stream_idx], tuning.bitrate, tuning.fps);
+    /* ABR 升降码率也走这里，发送平滑速率必须跟着变，否则大帧摊开的窗口还按旧码率算。 */
+    update_sink_pacing_rate(ctx, stream_idx);
+    if (ret == 0) {
+        ctx->reconfig_inplace_count[stream_idx]++;
+    } else {
+        /* 分辨率已变，旧关键帧缓存不能再回放给新接入的下游。 */
+        release_idr_cache(ctx, stream_idx);
+        ctx->reconfig_recreate_count[stream_idx]++;
+    }
+    ctx->reconfig_start_frame_id[stream_idx] = frame->frame_id;
+    ctx->reconfig_start_ts_us[stream_idx] = start_us;
+    ctx->reconfig_stall_us[stream_idx] = get_now_us() - start_us;
+    ctx->reconfig_empty_frames[stream_idx] = 0;
+    ctx->reconfig_measuring[stream_idx] = 1;
+    printf("[RECONFIG] stream=%d name=%s mode=%s size=%dx%d fps=%d/%d bitrate=%d/%d gop=%d qp=%d..%d stall_us=%" PRIu64 "\n",
+           stream_idx,
+           stream_cfg->name ? stream_cfg->name : "unknown",
+           (ret == 0) ? "inplace" : "recreate",
+           stream_cfg->width,
+           stream_cfg->height,
+           encode_fps,
+           stream_cfg->fps,
+           encode_bitrate,
+           stream_cfg->bitrate,
+           stream_cfg->gop,
+           stream_cfg->qp_min,
+           stream_cfg->qp_max,
+           ctx->reconfig_stall_us[stream_idx]);
+    return 0;
+}
+
+static void track_reconfigure_recovery(MediaGatewayCtx *ctx,
+                                       int stream_idx,
+                                       const MediaGatewayCapturedFrame *frame,
+                                       int has_packet,
+                                       int is_key_frame) {
+    /* Measure how many frames a reconfigure cost until the encoder emits output again. */
+    uint64_t elapsed_frames;
+    uint64_t dropped_frames;
+
+    if (!ctx->reconfig_measuring[stream_idx]) return;
+    if (!has_packet) {
+        ctx->reconfig_empty_frames[stream_idx]++;
+        return;
+    }
+
+    elapsed_frames = frame->frame_id - ctx->reconfig_start_frame_id[stream_idx] + 1;
+    dropped_frames = elapsed_frames - (uint64_t)(ctx->reconfig_empty_frames[stream_idx] + 1);
+    printf("[RECONFIG] stream=%d first_packet key=%d stall_us=%" PRIu64 " recover_us=%" PRIu64
+           " dropped_capture=%" PRIu64 " empty_output=%d inplace=%" PRIu64 " recreate=%" PRIu64 "\n",
+           stream_idx,
+           is_key_frame,
+           ctx->reconfig_stall_us[stream_idx],
+           get_now_us() - ctx->reconfig_start_ts_us[stream_idx],
+           dropped_frames,
+           ctx->reconfig_empty_frames[stream_idx],
+           ctx->reconfig_inplace_count[stream_idx],
+           ctx->reconfig_recreate_count[stream_idx]);
+    ctx->reconfig_measuring[stream_idx] = 0;
+}
+
+static void update_stream_motion(MediaGatewayCtx *ctx, int stream_idx, const MediaGatewayCapturedFrame *frame) {
+    /* Classify the latest capture frame as static or moving with this stream's own detector settings. */
+    int source_idx = ctx->config.streams[stream_idx].source_index;
+    const MediaGatewayCaptureSourceConfig *source = &ctx->config.capture_sources[source_idx];
+    MediaGatewayMotion *motion = &ctx->motion[stream_idx];
+    int was_static = ctx->motion_static[stream_idx];
+
+    if (!ctx->motion_ready[stream_idx]) return;
+    if (!frame->raw_frame || frame->raw_len < source->width * source->height) return;
+
+    ctx->motion_static[stream_idx] = media_gateway_motion_analyze(motion,
+                                                                  frame->raw_frame,
+                                                                  source->width,
+                                                                  frame->dqbuf_ts_us);
+    if (ctx->motion_static[stream_idx] == was_static) return;
+
+    printf("[MOTION] stream=%d source=%d event=%s changed_blocks=%d frame=%" PRIu64 "\n",
+           stream_idx,
+           source_idx,
+           ctx->motion_static[stream_idx] ? "static" : "motion",
+           motion->last_changed_blocks,
+           frame->frame_id);
+    /* 画面一动就清掉降帧节拍，当前帧立即编码，不等下一个空闲节拍。 */
+    if (!ctx->motion_static[stream_idx]) ctx->next_encode_ts_us[stream_idx] = 0;
+}
+
+static int skip_frame_for_pacing(MediaGatewayCtx *ctx, int stream_idx, const MediaGatewayCapturedFrame *frame) {
+    /* Decimate capture frames while ABR or a static scene runs the stream below its configured fps. */
+    const MediaGatewayAbr *abr = &ctx->abr[stream_idx];
+    int abr_fps = 0;
+    int target_fps;
+    int idle;
+
+    if (abr->config.enabled && abr->current_fps > 0 && abr->current_fps < abr->nominal_fps) {
+        abr_fps = abr->current_fps;
+    }
+    target_fps = media_gateway_motion_target_fps(&ctx->config.streams[stream_idx].motion,
+                                                 ctx->motion_static[stream_idx],
+                                                 abr_fps,
+                                                 &idle);
+    if (!media_gateway_motion_pace(&ctx->next_encode_ts_us[stream_idx], target_fps, frame->dqbuf_ts_us)) return 0;
+    if (idle) {
+        ctx->motion_skipped_frames[stream_idx]++;
+        ctx->motion_saved_bytes[stream_idx] += ctx->motion_avg_frame_bytes[stream_idx];
+    }
+    return 1;
+}
+
+static int stream_has_consumer(MediaGatewayCtx *ctx, int stream_idx, const char **consumer_name) {
+    /* Ask every sink of a stream whether someone is watching; local recording of stream 0 always counts. */
+    int i;
+    if (stream_idx == 0 && ctx->record_fp) {
+        *consumer_name = "record";
+        return 1;
+    }
+    for (i = 0; i < ctx->sink_count; ++i) {
+        if (ctx->sink_stream_index[i] != stream_idx) continue;
+        if (media_sink_has_consumer(&ctx->sinks[i])) {
+            *consumer_name = ctx->sinks[i].config.name ? ctx->sinks[i].config.name : "unknown";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void update_stream_demand(MediaGatewayCtx *ctx) {
+    /* Suspend scaling/encoding of on-demand streams nobody watches and resume them with an IDR. */
+    uint64_t now = get_now_us();
+    int i;
+
+    if (now - ctx->ondemand_last_poll_ts_us < (uint64_t)ON_DEMAND_POLL_INTERVAL_MS * 1000ULL) return;
+    ctx->ondemand_last_poll_ts_us = now;
+
+    for (i = 0; i < ctx->config.stream_count; ++i) {
+        const MediaGatewayStreamConfig *stream_cfg = &ctx->config.streams[i];
+        const char *consumer = NULL;
+
+        if (!ctx->stream_enabled[i] || !stream_cfg->on_demand) continue;
+        if (stream_has_consumer(ctx, i, &consumer)) {
+            ctx->ondemand_idle_since_ts_us[i] = 0;
+            if (!ctx->ondemand_suspended[i]) continue;
+
+            ctx->ondemand_suspended[i] = 0;
+            ctx->ondemand_suspended_us[i] += now - ctx->ondemand_suspend_ts_us[i];
+            ctx->next_encode_ts_us[i] = 0;
+            /* 暂停段不算帧间隔，否则恢复后首个间隔会把平滑值拉成暂停时长。 */
+            ctx->last_encode_ts_us[i] = 0;
+            /* 暂停期间没有参考帧，恢复后第一帧必须是 IDR，不走合并窗口。 */
+            media_gateway_idr_force(&ctx->idr[i], now);
+            if (mpp_encoder_request_idr(&ctx->encoders[i]) != 0) {
+                fprintf(stderr, "[WARN] stream=%d failed to request IDR on on-demand resume\n", i);
+            }
+            printf("[ONDEMAND] stream=%d event=resume consumer=%s suspended_ms=%" PRIu64 "\n",
+                   i,
+                   consumer,
+                   (uint64_t)((now - ctx->ondemand_suspend_ts_us[i]) / 1000ULL));
+            continue;
+        }
+
+        if (ctx->ondemand_suspended[i]) continue;
+        if (ctx->ondemand_idle_since_ts_us[i] == 0) {
+            ctx->ondemand_idle_since_ts_us[i] = now;
+            continue;
+        }
+        if (now - ctx->ondemand_idle_since_ts_us[i] < (uint64_t)stream_cfg->on_demand_linger_ms * 1000ULL) continue;
+
+        ctx->ondemand_suspended[i] = 1;
+        ctx->ondemand_suspend_ts_us[i] = now;
+        ctx->ondemand_suspend_count[i]++;
+        /* 暂停后缓存的关键帧已过时，恢复时一定会重新出 IDR，提前释放 buffer 引用。 */
+        release_idr_cache(ctx, i);
+        printf("[ONDEMAND] stream=%d event=suspend idle_ms=%" PRIu64 " suspends=%" PRIu64 "\n",
+               i,
+               (uint64_t)((now - ctx->ondemand_idle_since_ts_us[i]) / 1000ULL),
+               ctx->ondemand_suspend_count[i]);
+    }
+}
+
+static void update_capture_pause(MediaGatewayCtx *ctx, MediaGatewayCaptureWorker *workers, const int *worker_started) {
+    /* Stop dequeuing a capture source once every stream bound to it is suspended and allows it. */
+    int source_idx;
+    int i;
+
+    for (source_idx = 0; source_idx < ctx->config.capture_source_count; ++source_idx) {
+        int bound = 0;
+        int pause = 1;
+
+        if (!worker_started[source_idx]) continue;
+        for (i = 0; i < ctx->config.stream_count; ++i) {
+            if (!ctx->stream_enabled[i] || ctx->config.streams[i].source_index != source_idx) continue;
+            bound++;
+            if (!ctx->ondemand_suspended[i] || !ctx->config.streams[i].on_demand_pause_capture) pause = 0;
+        }
+        if (bound == 0) pause = 0;
+        if (pause == ctx->ondemand_capture_paused[source_idx]) continue;
+
+        ctx->ondemand_capture_paused[source_idx] = pause;
+        media_gateway_capture_worker_set_paused(&workers[source_idx], pause);
+        printf("[ONDEMAND] source=%d event=%s\n", source_idx, pause ? "capture_pause" : "capture_resume");
+    }
+}
+
+static void update_stream_abr(MediaGatewayCtx *ctx, int stream_idx) {
+    /* Feed sink queue feedback into the stream ABR and hand decisions to the tuning path. */
+    MediaGatewayAbr *abr = &ctx->abr[stream_idx];
+    MediaGatewayAbrSample sample;
+    MediaGatewayAbrDecision decision;
+    uint64_t now = get_now_us();
+    int i;
+
+    if (!media_gateway_abr_due(abr, now)) return;
+
+    media_gateway_abr_sample_reset(&sample);
+    for (i = 0; i < ctx->sink_count; ++i) {
+        MediaSinkStats stats;
+        if (ctx->sink_stream_index[i] != stream_idx) continue;
+        media_sink_get_stats(&ctx->sinks[i], &stats);
+        media_gateway_abr_sample_add_sink(&sample, &ctx->abr_cursors[i], &stats, ctx->sinks[i].queue_capacity, now);
+    }
+    if (!media_gateway_abr_update(abr, &sample, now, &decision)) return;
+
+    printf("[ABR] stream=%d action=%s reason=%s bitrate=%d->%d fps=%d->%d queue=%d/%d age_ms=%" PRIu64
+           " drops=%" PRIu64 " send_kbps=%.1f\n",
+           stream_idx,
+           (decision.action == MEDIA_GATEWAY_ABR_DOWN) ? "down" : "up",
+           decision.reason ? decision.reason : "unknown",
+           decision.old_bitrate,
+           decision.new_bitrate,
+           decision.old_fps,
+           decision.new_fps,
+           sample.queue_depth,
+           sample.queue_capacity,
+           (uint64_t)(sample.oldest_packet_age_us / 1000ULL),
+           decision.window_drops,
+           decision.send_kbps);
+
+    /* 决策已写进 abr->current_*，只标记待下发，由调参路径按运行值重配编码器，配置帧率和码率保持不变。 */
+    pthread_mutex_lock(&ctx->tuning_lock);
+    ctx->abr_rate_pending[stream_idx] = 1;
+    pthread_mutex_unlock(&ctx->tuning_lock);
+}
+
 /**
  * @description: sinks[0] = rtspSink     sink_stream_index[0] = 0         
  *               sinks[1] = rtmpSink     sink_stream_index[1] = 0
  *               sinks[2] = gb28181Sink  sink_stream_index[2] = 0
- *               sinks[3] = rtspSink     sink_stream_index[3] = 1
- *               sinks[4] = rtmpSink     sink_stream_index[4] = 1
- *               sinks[5] = gb28181Sink  sink_stream_index[5] = 1
+ *               sinks[3] = httpFlvSink  sink_stream_index[3] = 0
+ *               sinks[4] = tsUdpSink    sink_stream_index[4] = 0
+ *               sinks[5] = llHlsSink    sink_stream_index[5] = 0
+ *               sinks[6] = webrtcSink   sink_stream_index[6] = 0
+ *               sinks[7] = rtspSink     sink_stream_index[7] = 1
+ *               sinks[8] = rtmpSink     sink_stream_index[8] = 1
+ *               sinks[9] = gb28181Sink  sink_stream_index[9] = 1
+ *               sinks[10] = httpFlvSink sink_stream_index[10] = 1
+ *               sinks[11] = tsUdpSink   sink_stream_index[11] = 1
+ *               sinks[12] = llHlsSink   sink_stream_index[12] = 1
+ *               sinks[13] = webrtcSink  sink_stream_index[13] = 1
  * @param {MediaGatewayCtx} *ctx
  * @param {int} stream_idx
  * @return {*}
@@ -655,7 +1215,10 @@ static int setup_sinks_for_stream(MediaGatewayCtx *ctx, int stream_idx) {
                     MEDIA_GATEWAY_MAX_SINKS);
             return -1;
         }
-        if (rtmp_sink_setup(&ctx->sinks[ctx->sink_count], &s->rtmp) != 0) {
+        /* 配置了多个推流地址时走扇出通道：每帧只封装一次，再分发给各目的地。 */
+        if ((rtmp_fanout_url_count(s->rtmp.publish_url) > 1)
+                ? rtmp_fanout_sink_setup(&ctx->sinks[ctx->sink_count], &s->rtmp) != 0
+                : rtmp_sink_setup(&ctx->sinks[ctx->sink_count], &s->rtmp) != 0) {
             fprintf(stderr,
                     "[ERROR] setup_sinks_for_stream failed: rtmp_sink_setup stream=%d name=%s url=%s\n",
                     stream_idx,
@@ -690,6 +1253,93 @@ static int setup_sinks_for_stream(MediaGatewayCtx *ctx, int stream_idx) {
         ctx->gb28181_sink_index[stream_idx] = ctx->sink_count;
         ctx->sink_count++;
     }
+    if (s->enable_http_flv) {
+#if defined(ENABLE_RTMP_SINK)
+        if (ctx->sink_count >= MEDIA_GATEWAY_MAX_SINKS) {
+            fprintf(stderr,
+                    "[ERROR] setup_sinks_for_stream failed: too many sinks stream=%d name=%s type=http_flv max=%d\n",
+                    stream_idx,
+                    s->name ? s->name : "unknown",
+                    MEDIA_GATEWAY_MAX_SINKS);
+            return -1;
+        }
+        if (http_flv_sink_setup(&ctx->sinks[ctx->sink_count], &s->http_flv) != 0) {
+            fprintf(stderr,
+                    "[ERROR] setup_sinks_for_stream failed: http_flv_sink_setup stream=%d name=%s port=%d\n",
+                    stream_idx,
+                    s->name ? s->name : "unknown",
+                    s->http_flv.listen_port);
+            return -1;
+        }
+        ctx->sink_stream_index[ctx->sink_count] = stream_idx;
+        ctx->sink_count++;
+#endif
+    }
+    if (s->enable_ts_udp) {
+        if (ctx->sink_count >= MEDIA_GATEWAY_MAX_SINKS) {
+            fprintf(stderr,
+                    "[ERROR] setup_sinks_for_stream failed: too many sinks stream=%d name=%s type=ts_udp max=%d\n",
+                    stream_idx,
+                    s->name ? s->name : "unknown",
+                    MEDIA_GATEWAY_MAX_SINKS);
+            return -1;
+        }
+        if (ts_udp_sink_setup(&ctx->sinks[ctx->sink_count], &s->ts_udp) != 0) {
+            fprintf(stderr,
+                    "[ERROR] setup_sinks_for_stream failed: ts_udp_sink_setup stream=%d name=%s dest=%s:%d\n",
+                    stream_idx,
+                    s->name ? s->name : "unknown",
+                    s->ts_udp.dest_ip,
+                    s->ts_udp.dest_port);
+            return -1;
+        }
+        ctx->sink_stream_index[ctx->sink_count] = stream_idx;
+        ctx->ts_udp_sink_index[stream_idx] = ctx->sink_count;
+        ctx->sink_count++;
+    }
+    if (s->enable_ll_hls) {
+        if (ctx->sink_count >= MEDIA_GATEWAY_MAX_SINKS) {
+            fprintf(stderr,
+                    "[ERROR] setup_sinks_for_stream failed: too many sinks stream=%d name=%s type=ll_hls max=%d\n",
+                    stream_idx,
+                    s->name ? s->name : "unknown",
+                    MEDIA_GATEWAY_MAX_SINKS);
+            return -1;
+        }
+        if (ll_hls_sink_setup(&ctx->sinks[ctx->sink_count], &s->ll_hls) != 0) {
+            fprintf(stderr,
+                    "[ERROR] setup_sinks_for_stream failed: ll_hls_sink_setup stream=%d name=%s listen=%s:%d\n",
+                    stream_idx,
+                    s->name ? s->name : "unknown",
+                    s->ll_hls.listen_ip,
+                    s->ll_hls.listen_port);
+            return -1;
+        }
+        ctx->sink_stream_index[ctx->sink_count] = stream_idx;
+        ctx->sink_count++;
+    }
+    if (s->enable_webrtc) {
+        if (ctx->sink_count >= MEDIA_GATEWAY_MAX_SINKS) {
+            fprintf(stderr,
+                    "[ERROR] setup_sinks_for_stream failed: too many sinks stream=%d name=%s type=webrtc max=%d\n",
+                    stream_idx,
+                    s->name ? s->name : "unknown",
+                    MEDIA_GATEWAY_MAX_SINKS);
+            return -1;
+        }
+        if (webrtc_sink_setup(&ctx->sinks[ctx->sink_count], &s->webrtc) != 0) {
+            fprintf(stderr,
+                    "[ERROR] setup_sinks_for_stream failed: webrtc_sink_setup stream=%d name=%s listen=%s:%d\n",
+                    stream_idx,
+                    s->name ? s->name : "unknown",
+                    s->webrtc.listen_ip,
+                    s->webrtc.http_port);
+            return -1;
+        }
+        ctx->sink_stream_index[ctx->sink_count] = stream_idx;
+        ctx->webrtc_sink_index[stream_idx] = ctx->sink_count;
+        ctx->sink_count++;
+    }
     return 0;
 }
 
@@ -761,6 +1411,7 @@ static void log_sink_stats(MediaGatewayCtx *ctx) {
                stats.sent_bytes,
                stats.reconnect_count,
                stats.waiting_for_keyframe);
+        media_sink_log_stats(&ctx->sinks[i]);
     }
 }
 
@@ -813,31 +1464,118 @@ static void log_effective_config(const MediaGatewayConfig *cfg) {
                s->bitrate,
                s->gop,
                s->rc_mode);
-        printf("[CFG] stream=%d outputs rtsp=%d rtmp=%d gb28181=%d\n",
+        if (s->abr.enabled) {
+            printf("[CFG] stream=%d abr bitrate=%d..%d min_fps=%d step=-%d%%/+%d%% queue=%d%%/%d%% age_ms=%d hold_ms=%d/%d\n",
+                   i,
+                   s->abr.min_bitrate,
+                   s->abr.max_bitrate,
+                   s->abr.min_fps,
+                   s->abr.step_down_percent,
+                   s->abr.step_up_percent,
+                   s->abr.queue_high_percent,
+                   s->abr.queue_low_percent,
+                   s->abr.age_high_ms,
+                   s->abr.down_hold_ms,
+                   s->abr.up_hold_ms);
+        }
+        if (s->motion.enabled) {
+            printf("[CFG] stream=%d motion idle_fps=%d sad_threshold=%d min_changed_blocks=%d static_hold_ms=%d\n",
+                   i,
+                   s->motion.idle_fps,
+                   s->motion.sad_threshold,
+                   s->motion.min_changed_blocks,
+                   s->motion.static_hold_ms);
+        }
+        if (s->on_demand) {
+            printf("[CFG] stream=%d on_demand linger_ms=%d pause_capture=%d\n",
+                   i,
+                   s->on_demand_linger_ms,
+                   s->on_demand_pause_capture);
+        }
+        printf("[CFG] stream=%d idr coalesce_ms=%d min_interval_ms=%d reuse_window_ms=%d\n",
+               i,
+               s->idr.coalesce_ms,
+               s->idr.min_interval_ms,
+               s->idr.reuse_window_ms);
+        printf("[CFG] stream=%d outputs rtsp=%d rtmp=%d gb28181=%d http_flv=%d ts_udp=%d ll_hls=%d webrtc=%d\n",
                i,
                s->enable_rtsp,
                s->enable_rtmp,
-               s->enable_gb28181);
+               s->enable_gb28181,
+               s->enable_http_flv,
+               s->enable_ts_udp,
+               s->enable_ll_hls,
+               s->enable_webrtc);
         if (s->enable_rtsp) {
-            printf("[CFG] stream=%d rtsp url=rtsp://%s:%d/%s auth=%d immediate_sps_pps=%d\n",
+            printf("[CFG] stream=%d rtsp url=rtsp://%s:%d/%s auth=%d immediate_sps_pps=%d gop_cache=%d gop_cache_max_age_ms=%d multicast=%s:%d ttl=%d\n",
                    i,
                    s->rtsp.server_ip ? s->rtsp.server_ip : "0.0.0.0",
                    s->rtsp.server_port,
                    s->rtsp.session_name ? s->rtsp.session_name : "live",
                    s->rtsp.auth_enable,
-                   s->rtsp.immediate_sps_pps_on_new_client);
+                   s->rtsp.immediate_sps_pps_on_new_client,
+                   s->rtsp.gop_cache_max_frames,
+                   s->rtsp.gop_cache_max_age_ms,
+                   s->rtsp.multicast_group[0] ? s->rtsp.multicast_group : "off",
+                   s->rtsp.multicast_port,
+                   s->rtsp.multicast_ttl);
         }
         if (s->enable_rtmp) {
             printf("[CFG] stream=%d rtmp publish_url=%s\n",
                    i,
                    (s->rtmp.publish_url && s->rtmp.publish_url[0] != '\0') ? s->rtmp.publish_url : "(empty)");
         }
+        if (s->enable_http_flv) {
+            printf("[CFG] stream=%d http_flv url=http://%s:%d/live/%s.flv max_clients=%d budget=%d gop_cache=%d\n",
+                   i,
+                   s->http_flv.listen_ip,
+                   s->http_flv.listen_port,
+                   s->http_flv.stream_name,
+                   s->http_flv.max_clients,
+                   s->http_flv.client_budget_bytes,
+                   s->http_flv.gop_cache_max_frames);
+        }
+        if (s->enable_ts_udp) {
+            printf("[CFG] stream=%d ts_udp url=udp://%s:%d ttl=%d interface=%s packets_per_datagram=%d gso=%d pacing=%d\n",
+                   i,
+                   s->ts_udp.dest_ip,
+                   s->ts_udp.dest_port,
+                   s->ts_udp.multicast_ttl,
+                   s->ts_udp.multicast_interface[0] ? s->ts_udp.multicast_interface : "default",
+                   s->ts_udp.packets_per_datagram,
+                   s->ts_udp.gso,
+                   s->ts_udp.pacing);
+        }
+        if (s->enable_ll_hls) {
+            printf("[CFG] stream=%d ll_hls url=http://%s:%d/hls/%s/index.m3u8 segment_ms=%d part_ms=%d playlist=%d max_clients=%d\n",
+                   i,
+                   s->ll_hls.listen_ip,
+                   s->ll_hls.listen_port,
+                   s->ll_hls.stream_name,
+                   s->ll_hls.segment_target_ms,
+                   s->ll_hls.part_target_ms,
+                   s->ll_hls.playlist_segments,
+                   s->ll_hls.max_clients);
+        }
+        if (s->enable_webrtc) {
+            printf("[CFG] stream=%d webrtc whep=http://%s:%d/whep/%s media_udp=%d announce=%s max_peers=%d rtp_payload=%d nack_history_ms=%d\n",
+                   i,
+                   s->webrtc.listen_ip,
+                   s->webrtc.http_port,
+                   s->webrtc.stream_name,
+                   s->webrtc.media_port,
+                   s->webrtc.announce_ip[0] ? s->webrtc.announce_ip : "auto",
+                   s->webrtc.max_peers,
+                   s->webrtc.rtp_max_payload,
+                   s->webrtc.nack_history_ms);
+        }
         if (s->enable_gb28181) {
-            printf("[CFG] stream=%d gb28181 server=%s:%d device=%s local_sip=%d media=%s:%d\n",
+            printf("[CFG] stream=%d gb28181 server=%s:%d device=%s channel=%s local_sip=%d media=%s:%d\n",
                    i,
                    s->gb28181.server_ip ? s->gb28181.server_ip : "unknown",
                    s->gb28181.server_port,
                    s->gb28181.device_id ? s->gb28181.device_id : "unknown",
+                   s->gb28181.channel_id ? s->gb28181.channel_id : "unknown",
                    s->gb28181.local_sip_port,
                    s->gb28181.media_ip ? s->gb28181.media_ip : "unknown",
                    s->gb28181.media_port);
@@ -854,11 +1592,18 @@ int media_gateway_init(MediaGatewayCtx *ctx, const MediaGatewayConfig *config) {
     }
 
     memset(ctx, 0, sizeof(*ctx));
+    if (pthread_mutex_init(&ctx->tuning_lock, NULL) != 0) {
+        fprintf(stderr, "[ERROR] media_gateway_init failed: tuning lock init\n");
+        return -1;
+    }
+    ctx->tuning_lock_ready = 1;
     fill_default_config(&ctx->config, config);
     log_effective_config(&ctx->config);
     for (i = 0; i < MEDIA_GATEWAY_MAX_STREAMS; ++i) {
         ctx->rtsp_sink_index[i] = -1;
         ctx->gb28181_sink_index[i] = -1;
+        ctx->webrtc_sink_index[i] = -1;
+        ctx->ts_udp_sink_index[i] = -1;
     }
 
     for (i = 0; i < ctx->config.capture_source_count; ++i) {
@@ -910,6 +1655,23 @@ int media_gateway_init(MediaGatewayCtx *ctx, const MediaGatewayConfig *config) {
             goto fail;
         }
         ctx->stream_enabled[i] = 1;
+        media_gateway_abr_init(&ctx->abr[i],
+                               &ctx->config.streams[i].abr,
+                               ctx->config.streams[i].bitrate,
+                               ctx->config.streams[i].fps);
+        media_gateway_idr_init(&ctx->idr[i], &ctx->config.streams[i].idr);
+        if (ctx->config.streams[i].motion.enabled) {
+            if (media_gateway_motion_init(&ctx->motion[i],
+                                          &ctx->config.streams[i].motion,
+                                          ctx->config.capture_sources[source_idx].width,
+                                          ctx->config.capture_sources[source_idx].height) != 0) {
+                fprintf(stderr, "[ERROR] media_gateway_init failed: motion detector stream=%d source=%d\n",
+                        i,
+                        source_idx);
+                goto fail;
+            }
+            ctx->motion_ready[i] = 1;
+        }
     }
 
     if (setup_sinks(ctx) != 0) {
@@ -1096,6 +1858,7 @@ static int enqueue_stream_packet(MediaGatewayCtx *ctx,
         sink_hit = 1;
         media_sink_enqueue(&ctx->sinks[i], &packet);
     }
+    cache_idr_packet(ctx, stream_idx, &packet);
 
     if (sink_hit) {
         ctx->stat_frames++;
@@ -1226,13 +1989,24 @@ static int process_gateway_stream(MediaGatewayCtx *ctx,
     uint64_t encode_put_ts_us = 0;
     uint64_t encode_get_ts_us = 0;
     MppEncoderTiming mpp_timing;
+    uint64_t work_start_us;
+    uint64_t work_cost_us;
     int encode_ret;
 
     if (!ctx->stream_enabled[stream_idx]) {
         return 0;
     }
 
+    if (apply_pending_stream_tuning(ctx, stream_idx, frame) != 0) return -1;
+    if (ctx->ondemand_suspended[stream_idx]) {
+        ctx->ondemand_skipped_frames[stream_idx]++;
+        return 0;
+    }
+    if (skip_frame_for_pacing(ctx, stream_idx, frame)) return 0;
+    work_start_us = get_now_us();
     if (ensure_stream_input(ctx, state, stream_idx, frame, &encode_input, &encode_input_len) != 0) return -1;
+    track_encode_interval(ctx, stream_idx, frame->dqbuf_ts_us);
+    keep_paced_gop_duration(ctx, stream_idx);
 
     encode_ret = encode_stream_frame(ctx,
                                      state,
@@ -1247,7 +2021,17 @@ static int process_gateway_stream(MediaGatewayCtx *ctx,
                                      &encode_get_ts_us,
                                      &mpp_timing);
     if (encode_ret != 0) return (encode_ret < 0) ? -1 : 0;
+    work_cost_us = get_now_us() - work_start_us;
+    ctx->stream_frame_cost_us[stream_idx] = (ctx->stream_frame_cost_us[stream_idx] == 0)
+                                                ? work_cost_us
+                                                : (ctx->stream_frame_cost_us[stream_idx] * 7 + work_cost_us) / 8;
+    track_reconfigure_recovery(ctx, stream_idx, frame, (h264_data && h264_len > 0) ? 1 : 0, is_key_frame);
     if (!h264_data || h264_len == 0) return 0;
+    /* 静止画面下被跳过的帧原本也只是 P 帧，用近期 P 帧平均大小估算节省量。 */
+    if (!is_key_frame) {
+        uint64_t avg = ctx->motion_avg_frame_bytes[stream_idx];
+        ctx->motion_avg_frame_bytes[stream_idx] = (avg == 0) ? h264_len : (avg * 7 + h264_len) / 8;
+    }
 
     if (enqueue_stream_packet(ctx, stream_idx, frame, h264_data, h264_len, is_key_frame) != 0) {
         return -1;
@@ -1307,6 +2091,54 @@ static void log_throughput_if_due(MediaGatewayCtx *ctx) {
                skbps,
                ctx->stream_stat_frames[i],
                ctx->stream_stat_bytes[i]);
+        if (ctx->abr[i].config.enabled) {
+            fprintf(stderr, "[STAT] stream=%d abr bitrate=%d fps=%d range=%d..%d downs=%" PRIu64 " ups=%" PRIu64 " send_kbps=%.1f\n",
+                    i,
+                    ctx->abr[i].current_bitrate,
+                    ctx->abr[i].current_fps,
+                    ctx->abr[i].config.min_bitrate,
+                    ctx->abr[i].config.max_bitrate,
+                    ctx->abr[i].step_down_count,
+                    ctx->abr[i].step_up_count,
+                    ctx->abr[i].send_kbps);
+        }
+        if (ctx->config.streams[i].motion.enabled) {
+            const MediaGatewayMotion *motion = &ctx->motion[i];
+            fprintf(stderr, "[STAT] stream=%d motion state=%s skipped=%" PRIu64 " saved_bytes=%" PRIu64
+                    " static_enters=%" PRIu64 " gop_idr=%" PRIu64 " analyze_avg_us=%.1f\n",
+                    i,
+                    ctx->motion_static[i] ? "static" : "active",
+                    ctx->motion_skipped_frames[i],
+                    ctx->motion_saved_bytes[i],
+                    motion->static_enter_count,
+                    ctx->paced_gop_idr_count[i],
+                    (motion->analyzed_frames > 0) ? ((double)motion->analyze_us_sum / (double)motion->analyzed_frames) : 0.0);
+        }
+        if (ctx->config.streams[i].on_demand) {
+            uint64_t suspended_us = ctx->ondemand_suspended_us[i];
+            if (ctx->ondemand_suspended[i]) suspended_us += now - ctx->ondemand_suspend_ts_us[i];
+            /* 暂停时长按配置帧率折算成未编码的帧数，再乘近期单帧缩放+编码耗时，作为节省 CPU 的估算。 */
+            fprintf(stderr, "[STAT] stream=%d ondemand state=%s suspends=%" PRIu64 " suspended_ms=%" PRIu64
+                    " skipped=%" PRIu64 " frame_cost_us=%" PRIu64 " est_cpu_saved_ms=%.0f\n",
+                    i,
+                    ctx->ondemand_suspended[i] ? "suspended" : "active",
+                    ctx->ondemand_suspend_count[i],
+                    (uint64_t)(suspended_us / 1000ULL),
+                    ctx->ondemand_skipped_frames[i],
+                    ctx->stream_frame_cost_us[i],
+                    (double)suspended_us / 1000000.0 * (double)ctx->config.streams[i].fps *
+                        (double)ctx->stream_frame_cost_us[i] / 1000.0);
+        }
+        if (ctx->idr[i].requested_count > 0) {
+            fprintf(stderr, "[STAT] stream=%d idr requested=%" PRIu64 " issued=%" PRIu64 " coalesced=%" PRIu64
+                    " reused=%" PRIu64 " natural=%" PRIu64 "\n",
+                    i,
+                    ctx->idr[i].requested_count,
+                    ctx->idr[i].issued_count,
+                    ctx->idr[i].coalesced_count,
+                    ctx->idr[i].reused_count,
+                    ctx->idr[i].natural_count);
+        }
     }
 
     log_sink_stats(ctx);
@@ -1389,6 +2221,7 @@ int media_gateway_run(MediaGatewayCtx *ctx) {
             for (stream_idx = 0; stream_idx < ctx->config.stream_count; ++stream_idx) {
                 if (!ctx->stream_enabled[stream_idx]) continue;
                 if (ctx->config.streams[stream_idx].source_index != source_idx) continue;
+                update_stream_motion(ctx, stream_idx, &frame);
                 if (process_gateway_stream(ctx, &state, &frame, stream_idx) != 0) {
                     fprintf(stderr,
                             "[ERROR] media_gateway_run failed: process_gateway_stream source=%d stream=%d\n",
@@ -1403,6 +2236,11 @@ int media_gateway_run(MediaGatewayCtx *ctx) {
             if (ret != 0) break;
         }
 
+        for (stream_idx = 0; stream_idx < ctx->config.stream_count; ++stream_idx) {
+            if (ctx->stream_enabled[stream_idx]) update_stream_abr(ctx, stream_idx);
+        }
+        update_stream_demand(ctx);
+        update_capture_pause(ctx, capture_workers, worker_started);
         log_throughput_if_due(ctx);
         if (!got_frame) usleep(1000);
         if (ret != 0) break;
@@ -1435,6 +2273,7 @@ void media_gateway_deinit(MediaGatewayCtx *ctx) {
         ctx->record_fp = NULL;
     }
     for (i = 0; i < MEDIA_GATEWAY_MAX_STREAMS; ++i) {
+        release_idr_cache(ctx, i);
         if (ctx->encoder_ready[i]) {
             mpp_encoder_deinit(&ctx->encoders[i]);
             ctx->encoder_ready[i] = 0;
@@ -1444,6 +2283,10 @@ void media_gateway_deinit(MediaGatewayCtx *ctx) {
             ctx->scaled_frame_cache[i] = NULL;
         }
         ctx->scaled_frame_cache_size[i] = 0;
+        if (ctx->motion_ready[i]) {
+            media_gateway_motion_deinit(&ctx->motion[i]);
+            ctx->motion_ready[i] = 0;
+        }
     }
     for (i = 0; i < MEDIA_GATEWAY_MAX_CAPTURE_SOURCES; ++i) {
         if (ctx->capture_ready[i]) {
@@ -1453,6 +2296,10 @@ void media_gateway_deinit(MediaGatewayCtx *ctx) {
     }
     memset(&ctx->config, 0, sizeof(ctx->config));
     ctx->running = 0;
+    if (ctx->tuning_lock_ready) {
+        pthread_mutex_destroy(&ctx->tuning_lock);
+        ctx->tuning_lock_ready = 0;
+    }
 }
 
 void media_gateway_get_throughput(MediaGatewayCtx *ctx, MediaGatewayThroughput *throughput) {
@@ -1472,3 +2319,27 @@ void media_gateway_get_throughput(MediaGatewayCtx *ctx, MediaGatewayThroughput *
         throughput->bitrate_kbps = (double)ctx->stat_bytes * 8.0 / 1000.0 / span_sec;
     }
 }
+
+int media_gateway_request_stream_tuning(MediaGatewayCtx *ctx, int stream_idx, const MediaGatewayStreamTuning *tuning) {
+    /* Merge request into pending slot; main loop applies it before the next frame of that stream. */
+    MediaGatewayStreamTuning *pending;
+    if (!ctx || !tuning || !ctx->tuning_lock_ready) return -1;
+    if (stream_idx < 0 || stream_idx >= MEDIA_GATEWAY_MAX_STREAMS || !ctx->stream_enabled[stream_idx]) return -1;
+
+    pthread_mutex_lock(&ctx->tuning_lock);
+    pending = &ctx->pending_tuning[stream_idx];
+    if (tuning->width > 0) pending->width = tuning->width;
+    if (tuning->height > 0) pending->height = tuning->height;
+    if (tuning->fps > 0) pending->fps = tuning->fps;
+    if (tuning->bitrate > 0) pending->bitrate = tuning->bitrate;
+    if (tuning->gop > 0) pending->gop = tuning->gop;
+    if (tuning->qp_init > 0) pending->qp_init = tuning->qp_init;
+    if (tuning->qp_min > 0) pending->qp_min = tuning->qp_min;
+    if (tuning->qp_max > 0) pending->qp_max = tuning->qp_max;
+    if (tuning->qp_min_i > 0) pending->qp_min_i = tuning->qp_min_i;
+    if (tuning->qp_max_i > 0) pending->qp_max_i = tuning->qp_max_i;
+    if (tuning->qp_max_step > 0) pending->qp_max_step = tuning->qp_max_step;
+    ctx->tuning_pending[stream_idx] = 1;
+    pthread_mutex_unlock(&ctx->tuning_lock);
+    return 0;
+}
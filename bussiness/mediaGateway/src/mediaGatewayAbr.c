@@ -0,0 +1,252 @@
+#include "mediaGatewayAbr.h"
+
+#include <string.h>
+
+#define DEFAULT_ABR_MIN_BITRATE_PERCENT 25
+#define DEFAULT_ABR_STEP_DOWN_PERCENT 20
+#define DEFAULT_ABR_STEP_UP_PERCENT 10
+#define DEFAULT_ABR_QUEUE_HIGH_PERCENT 50
+#define DEFAULT_ABR_QUEUE_LOW_PERCENT 10
+#define DEFAULT_ABR_AGE_HIGH_MS 500
+#define DEFAULT_ABR_DOWN_HOLD_MS 1000
+#define DEFAULT_ABR_UP_HOLD_MS 5000
+#define DEFAULT_ABR_EVAL_INTERVAL_MS 500
+/* 拥塞时目标码率不高于实测发送速率的 90%，给队列留出排空余量。 */
+#define ABR_DRAIN_HEADROOM_PERCENT 90
+
+void media_gateway_abr_fill_default(MediaGatewayAbrConfig *config, int initial_bitrate) {
+    if (!config) return;
+    config->enabled = config->enabled ? 1 : 0;
+    if (config->max_bitrate <= 0) config->max_bitrate = initial_bitrate;
+    if (config->min_bitrate <= 0) config->min_bitrate = initial_bitrate / 100 * DEFAULT_ABR_MIN_BITRATE_PERCENT;
+    if (config->min_bitrate > config->max_bitrate) config->min_bitrate = config->max_bitrate;
+    if (config->min_fps < 0) config->min_fps = 0;
+    if (config->step_down_percent <= 0 || config->step_down_percent >= 100) {
+        config->step_down_percent = DEFAULT_ABR_STEP_DOWN_PERCENT;
+    }
+    if (config->step_up_percent <= 0) config->step_up_percent = DEFAULT_ABR_STEP_UP_PERCENT;
+    if (config->queue_high_percent <= 0 || config->queue_high_percent > 100) {
+        config->queue_high_percent = DEFAULT_ABR_QUEUE_HIGH_PERCENT;
+    }
+    if (config->queue_low_percent <= 0) config->queue_low_percent = DEFAULT_ABR_QUEUE_LOW_PERCENT;
+    if (config->queue_low_percent >= config->queue_high_percent) {
+        config->queue_low_percent = config->queue_high_percent / 2;
+    }
+    if (config->age_high_ms <= 0) config->age_high_ms = DEFAULT_ABR_AGE_HIGH_MS;
+    if (config->down_hold_ms <= 0) config->down_hold_ms = DEFAULT_ABR_DOWN_HOLD_MS;
+    if (config->up_hold_ms <= 0) config->up_hold_ms = DEFAULT_ABR_UP_HOLD_MS;
+    if (config->eval_interval_ms <= 0) config->eval_interval_ms = DEFAULT_ABR_EVAL_INTERVAL_MS;
+}
+
+void media_gateway_abr_init(MediaGatewayAbr *abr, const MediaGatewayAbrConfig *config, int initial_bitrate, int initial_fps) {
+    if (!abr) return;
+    memset(abr, 0, sizeof(*abr));
+    if (config) abr->config = *config;
+    media_gateway_abr_fill_default(&abr->config, initial_bitrate);
+    abr->nominal_bitrate = initial_bitrate;
+    abr->nominal_fps = initial_fps;
+    abr->current_bitrate = initial_bitrate;
+    abr->current_fps = initial_fps;
+}
+
+void media_gateway_abr_retune(MediaGatewayAbr *abr, int bitrate, int fps) {
+    if (!abr) return;
+    if (bitrate > 0) {
+        if (abr->nominal_bitrate > 0 && bitrate != abr->nominal_bitrate) {
+            /* 上下限是围绕配置码率生成的，按同一比例缩放，保持原来的调节区间形状。 */
+            abr->config.min_bitrate = (int)((int64_t)abr->config.min_bitrate * bitrate / abr->nominal_bitrate);
+            abr->config.max_bitrate = (int)((int64_t)abr->config.max_bitrate * bitrate / abr->nominal_bitrate);
+        }
+        if (abr->config.max_bitrate < bitrate) abr->config.max_bitrate = bitrate;
+        if (abr->config.min_bitrate > bitrate) abr->config.min_bitrate = bitrate;
+        abr->nominal_bitrate = bitrate;
+        abr->current_bitrate = bitrate;
+    }
+    if (fps > 0) {
+        abr->nominal_fps = fps;
+        abr->current_fps = fps;
+        if (abr->config.min_fps > fps) abr->config.min_fps = fps;
+    }
+}
+
+/**
+ * @description: 判断当前观测值是否拥塞，返回拥塞原因；通畅返回 NULL。
+ * @param {const MediaGatewayAbr *} abr 控制器。
+ * @param {const MediaGatewayAbrSample *} sample 观测值。
+ * @param {uint64_t} window_drops 评估窗口内新增丢帧数。
+ * @return {const char *} 拥塞原因。
+ */
+static const char *abr_congestion_reason(const MediaGatewayAbr *abr,
+                                         const MediaGatewayAbrSample *sample,
+                                         uint64_t window_drops) {
+    int queue_percent = (sample->queue_capacity > 0) ? (sample->queue_depth * 100 / sample->queue_capacity) : 0;
+    if (queue_percent >= abr->config.queue_high_percent) return "queue";
+    if (sample->oldest_packet_age_us >= (uint64_t)abr->config.age_high_ms * 1000ULL) return "age";
+    if (window_drops > 0) return "drops";
+    return NULL;
+}
+
+/**
+ * @description: 判断是否处于滞回下沿以下，只有足够通畅才累计上调计时。
+ * @param {const MediaGatewayAbr *} abr 控制器。
+ * @param {const MediaGatewayAbrSample *} sample 观测值。
+ * @return {int} 1 通畅，0 处于滞回区间。
+ */
+static int abr_is_clear(const MediaGatewayAbr *abr, const MediaGatewayAbrSample *sample) {
+    int queue_percent = (sample->queue_capacity > 0) ? (sample->queue_depth * 100 / sample->queue_capacity) : 0;
+    if (queue_percent > abr->config.queue_low_percent) return 0;
+    if (sample->oldest_packet_age_us * 2 >= (uint64_t)abr->config.age_high_ms * 1000ULL) return 0;
+    return 1;
+}
+
+int media_gateway_abr_due(const MediaGatewayAbr *abr, uint64_t now_us) {
+    if (!abr || !abr->config.enabled) return 0;
+    if (abr->last_eval_ts_us == 0) return 1;
+    return (now_us - abr->last_eval_ts_us >= (uint64_t)abr->config.eval_interval_ms * 1000ULL) ? 1 : 0;
+}
+
+void media_gateway_abr_sample_reset(MediaGatewayAbrSample *sample) {
+    if (!sample) return;
+    memset(sample, 0, sizeof(*sample));
+    sample->send_kbps = -1.0;
+}
+
+void media_gateway_abr_sample_add_sink(MediaGatewayAbrSample *sample,
+                                       MediaGatewayAbrSinkCursor *cursor,
+                                       const MediaSinkStats *stats,
+                                       int queue_capacity,
+                                       uint64_t now_us) {
+    if (!sample || !cursor || !stats) return;
+    if (!stats->connected) {
+        cursor->valid = 0;
+        return;
+    }
+
+    sample->connected = 1;
+    if (queue_capacity > 0 &&
+        (sample->queue_capacity <= 0 ||
+         (int64_t)stats->queue_depth * sample->queue_capacity > (int64_t)sample->queue_depth * queue_capacity)) {
+        sample->queue_depth = stats->queue_depth;
+        sample->queue_capacity = queue_capacity;
+    }
+    if (stats->oldest_packet_age_us > sample->oldest_packet_age_us) {
+        sample->oldest_packet_age_us = stats->oldest_packet_age_us;
+    }
+
+    if (cursor->valid && now_us > cursor->ts_us) {
+        uint64_t bytes = (stats->sent_bytes >= cursor->sent_bytes) ? (stats->sent_bytes - cursor->sent_bytes) : 0;
+        double kbps = (double)bytes * 8.0 * 1000.0 / (double)(now_us - cursor->ts_us);
+        if (stats->dropped_frames > cursor->dropped_frames) {
+            sample->window_drops += stats->dropped_frames - cursor->dropped_frames;
+        }
+        if (sample->send_kbps < 0.0 || kbps < sample->send_kbps) sample->send_kbps = kbps;
+    }
+    cursor->sent_bytes = stats->sent_bytes;
+    cursor->dropped_frames = stats->dropped_frames;
+    cursor->ts_us = now_us;
+    cursor->valid = 1;
+}
+
+int media_gateway_abr_update(MediaGatewayAbr *abr,
+                             const MediaGatewayAbrSample *sample,
+                             uint64_t now_us,
+                             MediaGatewayAbrDecision *decision) {
+    uint64_t window_drops;
+    uint64_t prev_age_us;
+    const char *reason;
+    int new_bitrate;
+    int new_fps;
+
+    if (decision) memset(decision, 0, sizeof(*decision));
+    if (!abr || !sample || !media_gateway_abr_due(abr, now_us)) return 0;
+
+    /* 首次评估只建立各 sink 的窗口基线；下游都未连接时不做判断。 */
+    if (abr->last_eval_ts_us == 0 || !sample->connected) {
+        abr->last_eval_ts_us = now_us;
+        abr->clear_since_ts_us = 0;
+        return 0;
+    }
+    abr->last_eval_ts_us = now_us;
+    window_drops = sample->window_drops;
+    abr->send_kbps = (sample->send_kbps > 0.0) ? sample->send_kbps : 0.0;
+    prev_age_us = abr->last_age_us;
+    abr->last_age_us = sample->oldest_packet_age_us;
+
+    new_bitrate = abr->current_bitrate;
+    new_fps = abr->current_fps;
+    reason = abr_congestion_reason(abr, sample, window_drops);
+    if (reason) {
+        int draining;
+        abr->clear_since_ts_us = 0;
+        /* 码率已低于链路能力且积压在缩短，说明队列正在消化，继续下调只会过冲。 */
+        draining = (abr->send_kbps > 0.0 &&
+                    (double)abr->current_bitrate <= abr->send_kbps * 1000.0 * ABR_DRAIN_HEADROOM_PERCENT / 100.0 &&
+                    sample->oldest_packet_age_us < prev_age_us);
+        if (draining) return 0;
+        if (now_us - abr->last_change_ts_us < (uint64_t)abr->config.down_hold_ms * 1000ULL) return 0;
+
+        new_bitrate = (int)((int64_t)abr->current_bitrate * (100 - abr->config.step_down_percent) / 100);
+        if (abr->send_kbps > 0.0) {
+            /* 实测发送速率就是当前链路能力的估计，直接跳到它附近，比逐级下探收敛更快。 */
+            double drain_bps = abr->send_kbps * 1000.0 * ABR_DRAIN_HEADROOM_PERCENT / 100.0;
+            if (drain_bps < (double)new_bitrate) new_bitrate = (int)drain_bps;
+        }
+        if (new_bitrate < abr->config.min_bitrate) new_bitrate = abr->config.min_bitrate;
+
+        /* 码率已到下限仍拥塞，再降帧率。 */
+        if (new_bitrate == abr->current_bitrate &&
+            abr->config.min_fps > 0 &&
+            abr->current_fps > abr->config.min_fps) {
+            new_fps = abr->current_fps * (100 - abr->config.step_down_percent) / 100;
+            if (new_fps >= abr->current_fps) new_fps = abr->current_fps - 1;
+            if (new_fps < abr->config.min_fps) new_fps = abr->config.min_fps;
+        }
+    } else if (abr_is_clear(abr, sample)) {
+        if (abr->clear_since_ts_us == 0) {
+            abr->clear_since_ts_us = now_us;
+            return 0;
+        }
+        if (now_us - abr->clear_since_ts_us < (uint64_t)abr->config.up_hold_ms * 1000ULL) return 0;
+        if (now_us - abr->last_change_ts_us < (uint64_t)abr->config.up_hold_ms * 1000ULL) return 0;
+
+        reason = "recovered";
+        /* 恢复时先把帧率还原，再逐步抬码率。 */
+        if (abr->current_fps < abr->nominal_fps) {
+            new_fps = abr->current_fps * (100 + abr->config.step_up_percent) / 100;
+            if (new_fps <= abr->current_fps) new_fps = abr->current_fps + 1;
+            if (new_fps > abr->nominal_fps) new_fps = abr->nominal_fps;
+        } else {
+            new_bitrate = (int)((int64_t)abr->current_bitrate * (100 + abr->config.step_up_percent) / 100);
+            if (new_bitrate > abr->config.max_bitrate) new_bitrate = abr->config.max_bitrate;
+        }
+        abr->clear_since_ts_us = now_us;
+    } else {
+        /* 滞回区间内既不升也不降，通畅计时重新开始。 */
+        abr->clear_since_ts_us = 0;
+        return 0;
+    }
+
+    if (new_bitrate == abr->current_bitrate && new_fps == abr->current_fps) return 0;
+
+    if (decision) {
+        decision->action = (new_bitrate < abr->current_bitrate || new_fps < abr->current_fps)
+            ? MEDIA_GATEWAY_ABR_DOWN
+            : MEDIA_GATEWAY_ABR_UP;
+        decision->reason = reason;
+        decision->old_bitrate = abr->current_bitrate;
+        decision->new_bitrate = new_bitrate;
+        decision->old_fps = abr->current_fps;
+        decision->new_fps = new_fps;
+        decision->send_kbps = abr->send_kbps;
+        decision->window_drops = window_drops;
+    }
+    if (new_bitrate < abr->current_bitrate || new_fps < abr->current_fps) {
+        abr->step_down_count++;
+    } else {
+        abr->step_up_count++;
+    }
+    abr->current_bitrate = new_bitrate;
+    abr->current_fps = new_fps;
+    abr->last_change_ts_us = now_us;
+    return 1;
+}
@@ -8,6 +8,9 @@
 #include <time.h>
 #include <unistd.h>
 
+/* 恢复取帧后，驱动时间戳早于该时长的帧视为暂停前积压的旧帧。 */
+#define CAPTURE_WORKER_STALE_FRAME_US 200000ULL
+
 /**
  * @description: 获取单调时钟时间，单位微秒，用于采集链路耗时统计。
  * @return {uint64_t} 当前单调时钟时间戳。
@@ -188,8 +191,20 @@ static void *capture_worker_thread(void *arg) {
     uint64_t capture_start_us;
     uint64_t capture_end_us;
     MediaGatewayCapturedFrame frame;
+    int resume_drop_budget = 0;
 
     while (capture_worker_should_run(worker)) {
+        // 暂停期间不取帧，驱动缓冲区占满后由驱动自行丢帧，省掉 DQBUF 和两次整帧拷贝。
+        pthread_mutex_lock(&worker->lock);
+        while (worker->running && worker->paused) {
+            pthread_cond_wait(&worker->cond, &worker->lock);
+        }
+        if (worker->resume_drop_budget > 0) {
+            resume_drop_budget = worker->resume_drop_budget;
+            worker->resume_drop_budget = 0;
+        }
+        pthread_mutex_unlock(&worker->lock);
+
         memset(&frame, 0, sizeof(frame));
         capture_start_us = capture_worker_now_us();
         if (v4l2_capture_frame(worker->capture,
@@ -222,6 +237,16 @@ static void *capture_worker_thread(void *arg) {
         if (!capture_worker_should_run(worker)) {
             break;
         }
+        if (resume_drop_budget > 0) {
+            if (frame.driver_to_dqbuf_us >= CAPTURE_WORKER_STALE_FRAME_US) {
+                resume_drop_budget--;
+                pthread_mutex_lock(&worker->lock);
+                worker->dropped_frames++;
+                pthread_mutex_unlock(&worker->lock);
+                continue;
+            }
+            resume_drop_budget = 0;
+        }
         if (capture_worker_publish_frame(worker, &frame) != 0) {
             break;
         }
@@ -354,6 +379,25 @@ void media_gateway_capture_worker_release(MediaGatewayCaptureWorker *worker, int
 /**
  * @description: 请求采集线程退出，并等待线程结束。
  */
+/**
+ * @description: 暂停或恢复采集线程取帧。
+ */
+void media_gateway_capture_worker_set_paused(MediaGatewayCaptureWorker *worker, int paused) {
+    if (!worker) return;
+    pthread_mutex_lock(&worker->lock);
+    if (worker->paused != (paused ? 1 : 0)) {
+        worker->paused = paused ? 1 : 0;
+        if (!worker->paused) {
+            worker->resume_drop_budget = (worker->capture && worker->capture->buf_count > 0)
+                ? worker->capture->buf_count
+                : 4;
+        }
+        pthread_cond_broadcast(&worker->cond);
+        LOG_INFO("capture worker %s", worker->paused ? "paused" : "resumed");
+    }
+    pthread_mutex_unlock(&worker->lock);
+}
+
 void media_gateway_capture_worker_stop(MediaGatewayCaptureWorker *worker) {
     if (!worker) return;
     pthread_mutex_lock(&worker->lock);
@@ -0,0 +1,95 @@
+#include "mediaGatewayIdr.h"
+
+#include <string.h>
+
+#define DEFAULT_IDR_COALESCE_MS 100
+#define DEFAULT_IDR_MIN_INTERVAL_MS 1000
+#define DEFAULT_IDR_REUSE_WINDOW_MS 500
+/* 强制 IDR 后迟迟没有关键帧输出（例如编码器被重建），超过该时长不再把后续请求并入。 */
+#define IDR_IN_FLIGHT_TIMEOUT_MS 1000
+
+static int normalize_ms(int value, int default_value) {
+    if (value == 0) return default_value;
+    return (value < 0) ? 0 : value;
+}
+
+void media_gateway_idr_fill_default(MediaGatewayIdrConfig *config) {
+    if (!config) return;
+    config->coalesce_ms = normalize_ms(config->coalesce_ms, DEFAULT_IDR_COALESCE_MS);
+    config->min_interval_ms = normalize_ms(config->min_interval_ms, DEFAULT_IDR_MIN_INTERVAL_MS);
+    config->reuse_window_ms = normalize_ms(config->reuse_window_ms, DEFAULT_IDR_REUSE_WINDOW_MS);
+}
+
+void media_gateway_idr_init(MediaGatewayIdrArbiter *arbiter, const MediaGatewayIdrConfig *config) {
+    if (!arbiter) return;
+    memset(arbiter, 0, sizeof(*arbiter));
+    if (config) arbiter->config = *config;
+    media_gateway_idr_fill_default(&arbiter->config);
+}
+
+int media_gateway_idr_fresh(const MediaGatewayIdrArbiter *arbiter, uint64_t now_us) {
+    if (!arbiter || arbiter->config.reuse_window_ms <= 0 || arbiter->last_keyframe_ts_us == 0) return 0;
+    if (now_us < arbiter->last_keyframe_ts_us) return 0;
+    return (now_us - arbiter->last_keyframe_ts_us <= (uint64_t)arbiter->config.reuse_window_ms * 1000ULL) ? 1 : 0;
+}
+
+void media_gateway_idr_request(MediaGatewayIdrArbiter *arbiter, uint64_t now_us, int served_from_cache) {
+    if (!arbiter) return;
+    arbiter->requested_count++;
+    if (served_from_cache) {
+        arbiter->reused_count++;
+        return;
+    }
+    /* 已有请求在等待或已下发但关键帧还没出来，新的请求由同一个 IDR 满足。 */
+    if (arbiter->pending || arbiter->in_flight) {
+        arbiter->coalesced_count++;
+        return;
+    }
+    arbiter->pending = 1;
+    arbiter->first_request_ts_us = now_us;
+}
+
+int media_gateway_idr_poll(MediaGatewayIdrArbiter *arbiter, uint64_t now_us, uint64_t natural_idr_in_us) {
+    uint64_t issue_at_us;
+
+    if (!arbiter) return 0;
+    if (arbiter->in_flight &&
+        now_us - arbiter->last_forced_ts_us >= (uint64_t)IDR_IN_FLIGHT_TIMEOUT_MS * 1000ULL) {
+        arbiter->in_flight = 0;
+    }
+    if (!arbiter->pending) return 0;
+
+    issue_at_us = arbiter->first_request_ts_us + (uint64_t)arbiter->config.coalesce_ms * 1000ULL;
+    if (arbiter->last_forced_ts_us > 0 &&
+        arbiter->last_forced_ts_us + (uint64_t)arbiter->config.min_interval_ms * 1000ULL > issue_at_us) {
+        issue_at_us = arbiter->last_forced_ts_us + (uint64_t)arbiter->config.min_interval_ms * 1000ULL;
+    }
+    if (now_us < issue_at_us) return 0;
+
+    /* 周期关键帧在合并窗口内就会到来，不必再额外插一个 IDR。 */
+    if (natural_idr_in_us <= (uint64_t)arbiter->config.coalesce_ms * 1000ULL) return 0;
+
+    arbiter->pending = 0;
+    arbiter->in_flight = 1;
+    arbiter->last_forced_ts_us = now_us;
+    arbiter->issued_count++;
+    return 1;
+}
+
+void media_gateway_idr_force(MediaGatewayIdrArbiter *arbiter, uint64_t now_us) {
+    if (!arbiter) return;
+    arbiter->pending = 0;
+    arbiter->in_flight = 1;
+    arbiter->last_forced_ts_us = now_us;
+    arbiter->issued_count++;
+}
+
+void media_gateway_idr_on_keyframe(MediaGatewayIdrArbiter *arbiter, uint64_t now_us) {
+    if (!arbiter) return;
+    arbiter->last_keyframe_ts_us = now_us;
+    if (arbiter->pending) {
+        arbiter->natural_count++;
+        arbiter->pending = 0;
+    }
+    arbiter->in_flight = 0;
+}
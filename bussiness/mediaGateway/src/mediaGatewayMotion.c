@@ -0,0 +1,193 @@
+#include "mediaGatewayMotion.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define DEFAULT_MOTION_IDLE_FPS 1
+#define DEFAULT_MOTION_SAD_THRESHOLD 8
+#define DEFAULT_MOTION_MIN_CHANGED_BLOCKS 1
+#define DEFAULT_MOTION_STATIC_HOLD_MS 2000
+
+/* 一个块行在原图上覆盖的像素宽度。 */
+#define MOTION_BLOCK_PIXELS (MEDIA_GATEWAY_MOTION_BLOCK * MEDIA_GATEWAY_MOTION_DOWNSAMPLE)
+
+static uint64_t get_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+/**
+ * @description: 对一行亮度做水平抽样，逐块累加与参考行的 SAD，并把抽样结果写回参考行。
+ * @param {const uint8_t *} src 原图中被抽样的一行。
+ * @param {uint8_t *} ref 参考抽样行，长度 blocks * MEDIA_GATEWAY_MOTION_BLOCK。
+ * @param {int} blocks 水平块数。
+ * @param {uint32_t *} block_sad 当前块行的 SAD 累加数组。
+ * @return {void}
+ */
+#if defined(__aarch64__)
+static void sad_row_update(const uint8_t *src, uint8_t *ref, int blocks, uint32_t *block_sad) {
+    int bx;
+    for (bx = 0; bx < blocks; ++bx) {
+        /* vld4 按 4 字节交织拆分，val[0] 正好是每 4 个像素取 1 个的抽样结果。 */
+        uint8x16x4_t px = vld4q_u8(src + bx * MOTION_BLOCK_PIXELS);
+        uint8x16_t old = vld1q_u8(ref + bx * MEDIA_GATEWAY_MOTION_BLOCK);
+        block_sad[bx] += vaddlvq_u8(vabdq_u8(px.val[0], old));
+        vst1q_u8(ref + bx * MEDIA_GATEWAY_MOTION_BLOCK, px.val[0]);
+    }
+}
+#else
+static void sad_row_update(const uint8_t *src, uint8_t *ref, int blocks, uint32_t *block_sad) {
+    int bx;
+    int i;
+    for (bx = 0; bx < blocks; ++bx) {
+        const uint8_t *s = src + bx * MOTION_BLOCK_PIXELS;
+        uint8_t *r = ref + bx * MEDIA_GATEWAY_MOTION_BLOCK;
+        uint32_t sad = 0;
+        for (i = 0; i < MEDIA_GATEWAY_MOTION_BLOCK; ++i) {
+            uint8_t cur = s[i * MEDIA_GATEWAY_MOTION_DOWNSAMPLE];
+            sad += (cur > r[i]) ? (uint32_t)(cur - r[i]) : (uint32_t)(r[i] - cur);
+            r[i] = cur;
+        }
+        block_sad[bx] += sad;
+    }
+}
+#endif
+
+void media_gateway_motion_fill_default(MediaGatewayMotionConfig *config, int fps) {
+    if (!config) return;
+    config->enabled = config->enabled ? 1 : 0;
+    if (config->idle_fps <= 0) config->idle_fps = DEFAULT_MOTION_IDLE_FPS;
+    if (fps > 0 && config->idle_fps > fps) config->idle_fps = fps;
+    if (config->sad_threshold <= 0) config->sad_threshold = DEFAULT_MOTION_SAD_THRESHOLD;
+    if (config->min_changed_blocks <= 0) config->min_changed_blocks = DEFAULT_MOTION_MIN_CHANGED_BLOCKS;
+    if (config->static_hold_ms <= 0) config->static_hold_ms = DEFAULT_MOTION_STATIC_HOLD_MS;
+}
+
+int media_gateway_motion_init(MediaGatewayMotion *motion, const MediaGatewayMotionConfig *config, int width, int height) {
+    if (!motion || !config) return -1;
+    memset(motion, 0, sizeof(*motion));
+    motion->config = *config;
+    motion->width = width;
+    motion->height = height;
+    motion->blocks_x = width / MOTION_BLOCK_PIXELS;
+    motion->cols = motion->blocks_x * MEDIA_GATEWAY_MOTION_BLOCK;
+    motion->rows = height / MEDIA_GATEWAY_MOTION_DOWNSAMPLE;
+    motion->blocks_y = (motion->rows + MEDIA_GATEWAY_MOTION_BLOCK - 1) / MEDIA_GATEWAY_MOTION_BLOCK;
+    if (motion->blocks_x <= 0 || motion->rows <= 0) {
+        fprintf(stderr, "[ERROR] media_gateway_motion_init failed: frame too small %dx%d\n", width, height);
+        return -1;
+    }
+
+    motion->reference = (uint8_t *)calloc((size_t)motion->cols * (size_t)motion->rows, 1);
+    motion->block_sad = (uint32_t *)calloc((size_t)motion->blocks_x * (size_t)motion->blocks_y, sizeof(uint32_t));
+    if (!motion->reference || !motion->block_sad) {
+        fprintf(stderr, "[ERROR] media_gateway_motion_init failed: alloc %dx%d\n", motion->cols, motion->rows);
+        media_gateway_motion_deinit(motion);
+        return -1;
+    }
+    return 0;
+}
+
+void media_gateway_motion_deinit(MediaGatewayMotion *motion) {
+    if (!motion) return;
+    free(motion->reference);
+    free(motion->block_sad);
+    memset(motion, 0, sizeof(*motion));
+}
+
+int media_gateway_motion_analyze(MediaGatewayMotion *motion, const uint8_t *y_plane, int stride, uint64_t now_us) {
+    uint64_t start_us;
+    int changed = 0;
+    int r;
+    int by;
+    int bx;
+
+    if (!motion || !motion->reference || !y_plane) return 0;
+
+    start_us = get_now_us();
+    memset(motion->block_sad, 0, (size_t)motion->blocks_x * (size_t)motion->blocks_y * sizeof(uint32_t));
+    for (r = 0; r < motion->rows; ++r) {
+        sad_row_update(y_plane + (size_t)r * MEDIA_GATEWAY_MOTION_DOWNSAMPLE * (size_t)stride,
+                       motion->reference + (size_t)r * (size_t)motion->cols,
+                       motion->blocks_x,
+                       motion->block_sad + (size_t)(r / MEDIA_GATEWAY_MOTION_BLOCK) * (size_t)motion->blocks_x);
+    }
+
+    for (by = 0; by < motion->blocks_y; ++by) {
+        int block_rows = motion->rows - by * MEDIA_GATEWAY_MOTION_BLOCK;
+        uint32_t limit;
+        if (block_rows > MEDIA_GATEWAY_MOTION_BLOCK) block_rows = MEDIA_GATEWAY_MOTION_BLOCK;
+        /* 块内平均差 >= sad_threshold 等价于块 SAD >= sad_threshold * 抽样点数。 */
+        limit = (uint32_t)motion->config.sad_threshold * (uint32_t)(block_rows * MEDIA_GATEWAY_MOTION_BLOCK);
+        for (bx = 0; bx < motion->blocks_x; ++bx) {
+            if (motion->block_sad[by * motion->blocks_x + bx] >= limit) changed++;
+        }
+    }
+    motion->analyzed_frames++;
+    motion->analyze_us_sum += get_now_us() - start_us;
+    motion->last_changed_blocks = changed;
+
+    /* 第一帧只建立参考，按运动处理，保证启动阶段满帧率输出。 */
+    if (!motion->has_reference || changed >= motion->config.min_changed_blocks) {
+        motion->has_reference = 1;
+        motion->last_motion_ts_us = now_us;
+        motion->is_static = 0;
+        return 0;
+    }
+    if (!motion->is_static &&
+        now_us - motion->last_motion_ts_us >= (uint64_t)motion->config.static_hold_ms * 1000ULL) {
+        motion->is_static = 1;
+        motion->static_enter_count++;
+    }
+    return motion->is_static;
+}
+
+int media_gateway_motion_target_fps(const MediaGatewayMotionConfig *config, int is_static, int abr_fps, int *idle) {
+    int target_fps = (abr_fps > 0) ? abr_fps : 0;
+
+    if (idle) *idle = 0;
+    if (config && config->enabled && is_static && (target_fps == 0 || config->idle_fps < target_fps)) {
+        target_fps = config->idle_fps;
+        if (idle) *idle = 1;
+    }
+    return target_fps;
+}
+
+int media_gateway_motion_pace(uint64_t *next_encode_ts_us, int target_fps, uint64_t frame_ts_us) {
+    uint64_t interval_us;
+
+    if (!next_encode_ts_us) return 0;
+    if (target_fps <= 0) {
+        *next_encode_ts_us = 0;
+        return 0;
+    }
+
+    interval_us = 1000000ULL / (uint64_t)target_fps;
+    /* 允许 1/4 帧间隔的采集抖动，避免节拍边缘的帧被误丢。 */
+    if (*next_encode_ts_us != 0 && frame_ts_us + interval_us / 4 < *next_encode_ts_us) return 1;
+    if (*next_encode_ts_us != 0 && frame_ts_us < *next_encode_ts_us + interval_us) {
+        *next_encode_ts_us += interval_us;
+    } else {
+        *next_encode_ts_us = frame_ts_us + interval_us;
+    }
+    return 0;
+}
+
+uint64_t media_gateway_motion_gop_left_us(uint64_t next_encode_ts_us,
+                                          uint64_t last_keyframe_ts_us,
+                                          int fps,
+                                          int gop,
+                                          uint64_t now_us) {
+    uint64_t gop_us;
+
+    if (next_encode_ts_us == 0 || last_keyframe_ts_us == 0 || fps <= 0 || gop <= 0) return UINT64_MAX;
+    gop_us = (uint64_t)gop * 1000000ULL / (uint64_t)fps;
+    return (now_us >= last_keyframe_ts_us + gop_us) ? 0 : last_keyframe_ts_us + gop_us - now_us;
+}
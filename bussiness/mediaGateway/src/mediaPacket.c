@@ -126,3 +126,113 @@ void media_packet_reset(MediaPacket *packet) {
     memset(packet, 0, sizeof(*packet));
 }
 
+
+/**
+ * @description: 从 offset 开始查找下一个起始码，先用 memchr 找 0x01 再回看前面的 0
+ * @param {const uint8_t *} data
+ * @param {size_t} len
+ * @param {size_t} offset
+ * @param {size_t *} pos 起始码位置
+ * @param {size_t *} code_len 起始码长度 3 或 4
+ * @return {static int} 0 找到，-1 没有
+ */
+static int find_start_code(const uint8_t *data, size_t len, size_t offset, size_t *pos, size_t *code_len) {
+    size_t i = offset + 2;
+
+    while (i < len) {
+        const uint8_t *one = (const uint8_t *)memchr(data + i, 1, len - i);
+
+        if (!one) {
+            return -1;
+        }
+        i = (size_t)(one - data);
+        if (data[i - 1] == 0 && data[i - 2] == 0) {
+            if (i >= offset + 3 && data[i - 3] == 0) {
+                *pos = i - 3;
+                *code_len = 4;
+            } else {
+                *pos = i - 2;
+                *code_len = 3;
+            }
+            return 0;
+        }
+        i++;
+    }
+    return -1;
+}
+
+/**
+ * @description: 取下一个 NALU 视图
+ * @param {const uint8_t *} data
+ * @param {size_t} len
+ * @param {size_t *} offset
+ * @param {MediaNaluView *} nalu
+ * @return {int}
+ */
+int media_annexb_next_nalu(const uint8_t *data, size_t len, size_t *offset, MediaNaluView *nalu) {
+    size_t start = 0;
+    size_t code_len = 0;
+
+    if (!data || !offset || !nalu) {
+        return 0;
+    }
+    while (*offset < len && find_start_code(data, len, *offset, &start, &code_len) == 0) {
+        size_t payload = start + code_len;
+        size_t next = len;
+        size_t next_code_len = 0;
+
+        if (payload >= len) {
+            break;
+        }
+        if (find_start_code(data, len, payload, &next, &next_code_len) != 0) {
+            next = len;
+        }
+        *offset = next;
+        if (next > payload) {
+            nalu->data = data + payload;
+            nalu->size = next - payload;
+            return 1;
+        }
+    }
+    *offset = len;
+    return 0;
+}
+
+/**
+ * @description: 把 Annex-B 数据切成 NALU 视图
+ * @param {const uint8_t *} data
+ * @param {size_t} len
+ * @param {MediaNaluView *} nalus
+ * @param {size_t} capacity
+ * @param {size_t *} out_count
+ * @return {int}
+ */
+int media_annexb_split(const uint8_t *data, size_t len, MediaNaluView *nalus, size_t capacity, size_t *out_count) {
+    MediaNaluView nalu;
+    size_t offset = 0;
+    size_t start = 0;
+    size_t code_len = 0;
+    size_t count = 0;
+
+    *out_count = 0;
+    if (!data || len == 0) {
+        return 0;
+    }
+    if (find_start_code(data, len, 0, &start, &code_len) != 0) {
+        if (capacity == 0) {
+            return -1;
+        }
+        nalus[0].data = data;
+        nalus[0].size = len;
+        *out_count = 1;
+        return 0;
+    }
+    while (media_annexb_next_nalu(data, len, &offset, &nalu)) {
+        if (count >= capacity) {
+            return -1;
+        }
+        nalus[count++] = nalu;
+    }
+    *out_count = count;
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include "mediaRtcp.h"
+
+#include <string.h>
+#include <time.h>
+
+/* 1900-01-01（NTP 纪元）到 1970-01-01 的秒数。 */
+#define NTP_UNIX_EPOCH_OFFSET 2208988800ULL
+#define RTCP_SR_LEN 28
+#define RTCP_RR_HEADER_LEN 8
+#define RTCP_REPORT_BLOCK_LEN 24
+#define RTCP_SDES_CNAME 1
+
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void write_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+uint64_t media_rtcp_ntp_now(void) {
+    struct timespec ts;
+    uint64_t frac;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    frac = ((uint64_t)ts.tv_nsec << 32) / 1000000000ULL;
+    return (((uint64_t)ts.tv_sec + NTP_UNIX_EPOCH_OFFSET) << 32) | (frac & 0xFFFFFFFFULL);
+}
+
+uint32_t media_rtcp_rtp_timestamp_at(uint32_t rtp_timestamp, uint64_t pts_us, uint64_t now_us, uint32_t clock_rate) {
+    /* pts 可能略晚于 now（编码器时间戳抖动），按有符号差值推算，RTP 时间戳按 32 位回绕。 */
+    int64_t delta_us = (int64_t)(now_us - pts_us);
+    int64_t delta_ticks = delta_us * (int64_t)clock_rate / 1000000LL;
+    return rtp_timestamp + (uint32_t)delta_ticks;
+}
+
+int media_rtcp_build_sr(uint8_t *buf,
+                        size_t cap,
+                        uint32_t ssrc,
+                        uint64_t ntp,
+                        uint32_t rtp_timestamp,
+                        uint32_t packets,
+                        uint32_t octets,
+                        const char *cname) {
+    size_t cname_len = cname ? strlen(cname) : 0;
+    size_t sdes_len = 0;
+    size_t total;
+    if (!buf) return -1;
+    if (cname_len > MEDIA_RTCP_CNAME_MAX) cname_len = MEDIA_RTCP_CNAME_MAX;
+    if (cname_len > 0) {
+        /* SDES 头 4 + SSRC 4 + CNAME 类型/长度 2 + 文本 + 结束符 1，补齐到 4 字节。 */
+        sdes_len = (4 + 4 + 2 + cname_len + 1 + 3) & ~(size_t)3;
+    }
+    total = RTCP_SR_LEN + sdes_len;
+    if (cap < total) return -1;
+    memset(buf, 0, total);
+    buf[0] = 0x80;
+    buf[1] = MEDIA_RTCP_PT_SR;
+    buf[2] = 0;
+    buf[3] = RTCP_SR_LEN / 4 - 1;
+    write_be32(buf + 4, ssrc);
+    write_be32(buf + 8, (uint32_t)(ntp >> 32));
+    write_be32(buf + 12, (uint32_t)ntp);
+    write_be32(buf + 16, rtp_timestamp);
+    write_be32(buf + 20, packets);
+    write_be32(buf + 24, octets);
+    if (sdes_len > 0) {
+        uint8_t *p = buf + RTCP_SR_LEN;
+        p[0] = 0x81;
+        p[1] = MEDIA_RTCP_PT_SDES;
+        p[2] = (uint8_t)((sdes_len / 4 - 1) >> 8);
+        p[3] = (uint8_t)(sdes_len / 4 - 1);
+        write_be32(p + 4, ssrc);
+        p[8] = RTCP_SDES_CNAME;
+        p[9] = (uint8_t)cname_len;
+        memcpy(p + 10, cname, cname_len);
+    }
+    return (int)total;
+}
+
+int media_rtcp_parse_report(const uint8_t *buf, size_t len, uint32_t media_ssrc, MediaRtcpReportBlock *block) {
+    size_t off = 0;
+    if (!buf || !block) return 0;
+    while (len - off >= 4) {
+        const uint8_t *p = buf + off;
+        size_t pkt_len = ((size_t)((p[2] << 8) | p[3]) + 1) * 4;
+        size_t first = 0;
+        int count = p[0] & 0x1F;
+        int i;
+        if ((p[0] >> 6) != 2 || pkt_len > len - off) break;
+        if (p[1] == MEDIA_RTCP_PT_SR) {
+            first = RTCP_SR_LEN;
+        } else if (p[1] == MEDIA_RTCP_PT_RR) {
+            first = RTCP_RR_HEADER_LEN;
+        }
+        for (i = 0; first > 0 && i < count && first + (size_t)(i + 1) * RTCP_REPORT_BLOCK_LEN <= pkt_len; ++i) {
+            const uint8_t *b = p + first + (size_t)i * RTCP_REPORT_BLOCK_LEN;
+            uint32_t lost;
+            if (read_be32(b) != media_ssrc) continue;
+            block->reporter_ssrc = read_be32(p + 4);
+            block->fraction_lost = b[4];
+            lost = ((uint32_t)b[5] << 16) | ((uint32_t)b[6] << 8) | (uint32_t)b[7];
+            /* 24 位有符号数：重复包可能让累计丢包为负。 */
+            block->cumulative_lost = (lost & 0x800000U) ? (int32_t)(lost | 0xFF000000U) : (int32_t)lost;
+            block->highest_seq = read_be32(b + 8);
+            block->jitter = read_be32(b + 12);
+            block->lsr = read_be32(b + 16);
+            block->dlsr = read_be32(b + 20);
+            return 1;
+        }
+        off += pkt_len;
+    }
+    return 0;
+}
+
+void media_rtcp_peer_reset(MediaRtcpPeer *peer) {
+    if (!peer) return;
+    memset(peer, 0, sizeof(*peer));
+    peer->rtt_ms = -1;
+}
+
+int media_rtcp_peer_sr_due(MediaRtcpPeer *peer, long long now_ms, int interval_ms) {
+    if (!peer || interval_ms <= 0 || now_ms < peer->next_sr_ms) return 0;
+    peer->next_sr_ms = now_ms + interval_ms;
+    return 1;
+}
+
+int media_rtcp_peer_on_packet(MediaRtcpPeer *peer,
+                              const uint8_t *buf,
+                              size_t len,
+                              uint32_t media_ssrc,
+                              uint32_t clock_rate,
+                              long long now_ms) {
+    MediaRtcpReportBlock block;
+    if (!peer || clock_rate == 0 || !media_rtcp_parse_report(buf, len, media_ssrc, &block)) return 0;
+    peer->reports++;
+    peer->last_report_ms = now_ms;
+    peer->reporter_ssrc = block.reporter_ssrc;
+    peer->loss_percent = (double)block.fraction_lost * 100.0 / 256.0;
+    peer->cumulative_lost = block.cumulative_lost;
+    peer->highest_seq = block.highest_seq;
+    peer->jitter_ms = (double)block.jitter * 1000.0 / (double)clock_rate;
+    if (block.lsr != 0) {
+        /* RFC 3550 6.4.1：RTT = 收到 RR 的时刻 - LSR - DLSR，均为 NTP 中间 32 位（1/65536 秒）。 */
+        uint32_t arrival = (uint32_t)(media_rtcp_ntp_now() >> 16);
+        uint32_t rtt = arrival - block.lsr - block.dlsr;
+        peer->rtt_ms = ((int32_t)rtt < 0) ? 0 : (int)(((uint64_t)rtt * 1000ULL) >> 16);
+    }
+    return 1;
+}
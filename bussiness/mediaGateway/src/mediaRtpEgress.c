@@ -0,0 +1,611 @@
+#define _GNU_SOURCE
+#include "mediaRtpEgress.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/sockios.h>
+#include <netinet/udp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+/* 内核对单次 GSO 发送的限制：最多 64 个分段，总长度不超过一个 UDP 报文。 */
+#define RTP_EGRESS_GSO_MAX_SEGMENTS 64
+#define RTP_EGRESS_GSO_MAX_BYTES 65000
+/* 单次 sendmsg 的 iovec 上限（UIO_MAXIOV）。 */
+#define RTP_EGRESS_MAX_MSG_IOV 1024
+/* RFC 4571 每包两字节长度前缀。 */
+#define RTP_EGRESS_TCP_PREFIX 2
+
+static uint64_t get_thread_cpu_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static uint64_t get_monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static void sleep_us(uint64_t us) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(us / 1000000ULL);
+    ts.tv_nsec = (long)(us % 1000000ULL) * 1000L;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+static void probe_gso(MediaRtpEgress *egress) {
+    /* 每个 socket 只探测一次 UDP_SEGMENT 支持；设置 0 表示 socket 级别不开 GSO。 */
+    int zero = 0;
+    if (!egress->gso_requested) {
+        egress->gso_supported = 0;
+        return;
+    }
+    egress->gso_supported = (setsockopt(egress->fd, SOL_UDP, UDP_SEGMENT, &zero, sizeof(zero)) == 0) ? 1 : 0;
+    if (!egress->gso_supported) {
+        printf("[RTP_EGRESS] UDP GSO unavailable on fd=%d errno=%d(%s), using sendmmsg\n",
+               egress->fd, errno, strerror(errno));
+    }
+}
+
+static int send_mmsg_range(MediaRtpEgress *egress, int first, int count) {
+    /* 发送队列中 [first, first + count) 的包，按内核上限尽量少调用 sendmmsg。 */
+    struct mmsghdr msgs[MEDIA_RTP_EGRESS_MAX_BATCH];
+    int done = 0;
+    int i;
+
+    memset(msgs, 0, sizeof(struct mmsghdr) * (size_t)count);
+    for (i = 0; i < count; ++i) {
+        msgs[i].msg_hdr.msg_name = &egress->remote_addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(egress->remote_addr);
+        msgs[i].msg_hdr.msg_iov = egress->iov[first + i];
+        msgs[i].msg_hdr.msg_iovlen = (size_t)egress->packet_iov_count[first + i];
+    }
+    while (done < count) {
+        int ret = sendmmsg(egress->fd, &msgs[done], (unsigned int)(count - done), 0);
+        egress->syscalls++;
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "[ERROR] media_rtp_egress sendmmsg failed fd=%d queued=%d errno=%d(%s)\n",
+                    egress->fd, count - done, errno, strerror(errno));
+            egress->errors++;
+            return -1;
+        }
+        done += ret;
+    }
+    return 0;
+}
+
+static int send_gso_range(MediaRtpEgress *egress, int first, int count, size_t segment_size) {
+    /* 把等长的包合成一次 GSO 发送，最后一个可以更短。 */
+    struct iovec iov[RTP_EGRESS_MAX_MSG_IOV];
+    char control[CMSG_SPACE(sizeof(uint16_t))];
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    int iov_count = 0;
+    int i;
+    int j;
+
+    for (i = first; i < first + count; ++i) {
+        for (j = 0; j < egress->packet_iov_count[i]; ++j) iov[iov_count++] = egress->iov[i][j];
+    }
+    memset(&msg, 0, sizeof(msg));
+    memset(control, 0, sizeof(control));
+    msg.msg_name = &egress->remote_addr;
+    msg.msg_namelen = sizeof(egress->remote_addr);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = (size_t)iov_count;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    *(uint16_t *)CMSG_DATA(cmsg) = (uint16_t)segment_size;
+
+    for (;;) {
+        ssize_t ret = sendmsg(egress->fd, &msg, 0);
+        egress->syscalls++;
+        if (ret >= 0) break;
+        if (errno == EINTR) continue;
+        /* 网卡/驱动不支持时内核返回 EIO 等错误，之后固定走 sendmmsg，本批由调用方重发。 */
+        if (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP) {
+            printf("[RTP_EGRESS] UDP GSO send rejected fd=%d errno=%d(%s), falling back to sendmmsg\n",
+                   egress->fd, errno, strerror(errno));
+            egress->gso_supported = 0;
+            return 1;
+        }
+        fprintf(stderr, "[ERROR] media_rtp_egress GSO sendmsg failed fd=%d packets=%d errno=%d(%s)\n",
+                egress->fd, count, errno, strerror(errno));
+        egress->errors++;
+        return -1;
+    }
+    egress->gso_sends++;
+    return 0;
+}
+
+static int gso_run_length(const MediaRtpEgress *egress, int first) {
+    /* 统计从 first 开始有多少个包能合进同一次 GSO 发送。 */
+    size_t segment_size = egress->packet_len[first];
+    size_t total = segment_size;
+    int iov_count = egress->packet_iov_count[first];
+    int i = first + 1;
+
+    while (i < egress->count && i - first < RTP_EGRESS_GSO_MAX_SEGMENTS) {
+        if (egress->packet_len[i] > segment_size) break;
+        if (total + egress->packet_len[i] > RTP_EGRESS_GSO_MAX_BYTES) break;
+        if (iov_count + egress->packet_iov_count[i] > RTP_EGRESS_MAX_MSG_IOV) break;
+        total += egress->packet_len[i];
+        iov_count += egress->packet_iov_count[i];
+        /* 只有最后一个分段可以比 segment_size 短。 */
+        if (egress->packet_len[i++] < segment_size) break;
+    }
+    return i - first;
+}
+
+void media_rtp_egress_init(MediaRtpEgress *egress, int enable_gso) {
+    if (!egress) return;
+    memset(egress, 0, sizeof(*egress));
+    egress->fd = -1;
+    egress->transport = MEDIA_RTP_TRANSPORT_UDP;
+    egress->gso_requested = enable_gso ? 1 : 0;
+    egress->gso_supported = -1;
+}
+
+void media_rtp_egress_deinit(MediaRtpEgress *egress) {
+    if (!egress) return;
+    free(egress->tcp_pending);
+    egress->tcp_pending = NULL;
+    egress->tcp_pending_cap = 0;
+    egress->tcp_pending_len = 0;
+    egress->tcp_pending_off = 0;
+}
+
+int media_rtp_egress_set_target(MediaRtpEgress *egress, int fd, const char *remote_ip, int remote_port) {
+    if (!egress || fd < 0 || !remote_ip) return -1;
+    if (egress->target_ready && egress->transport == MEDIA_RTP_TRANSPORT_UDP && egress->fd == fd &&
+        egress->remote_port == remote_port && strcmp(egress->remote_ip, remote_ip) == 0) {
+        return 0;
+    }
+
+    /* 目标变化前排队的包属于旧会话，直接丢弃。 */
+    egress->count = 0;
+    egress->tcp_pending_len = 0;
+    egress->tcp_pending_off = 0;
+    if (egress->transport != MEDIA_RTP_TRANSPORT_UDP) {
+        egress->transport = MEDIA_RTP_TRANSPORT_UDP;
+        egress->fd = -1;
+    }
+    egress->target_ready = 0;
+    memset(&egress->remote_addr, 0, sizeof(egress->remote_addr));
+    egress->remote_addr.sin_family = AF_INET;
+    egress->remote_addr.sin_port = htons((uint16_t)remote_port);
+    if (inet_aton(remote_ip, &egress->remote_addr.sin_addr) == 0) {
+        fprintf(stderr, "[ERROR] media_rtp_egress_set_target invalid remote ip: %s\n", remote_ip);
+        return -1;
+    }
+    if (egress->fd != fd) {
+        egress->fd = fd;
+        probe_gso(egress);
+    }
+    snprintf(egress->remote_ip, sizeof(egress->remote_ip), "%s", remote_ip);
+    egress->remote_port = remote_port;
+    egress->target_ready = 1;
+    return 0;
+}
+
+int media_rtp_egress_set_tcp_target(MediaRtpEgress *egress, int fd) {
+    if (!egress || fd < 0) return -1;
+    /* 新连接从干净的分帧边界开始，旧连接的排队包和帧尾都丢弃。 */
+    egress->count = 0;
+    egress->tcp_pending_len = 0;
+    egress->tcp_pending_off = 0;
+    egress->frame_dropped = 0;
+    memset(&egress->remote_addr, 0, sizeof(egress->remote_addr));
+    egress->remote_ip[0] = '\0';
+    egress->remote_port = 0;
+    egress->fd = fd;
+    egress->transport = MEDIA_RTP_TRANSPORT_TCP;
+    egress->gso_supported = 0;
+    egress->target_ready = 1;
+    return 0;
+}
+
+int media_rtp_egress_queue(MediaRtpEgress *egress,
+                           const uint8_t *header,
+                           size_t header_len,
+                           const struct iovec *payload,
+                           int payload_iov_count) {
+    size_t len = header_len;
+    int slot;
+    int i;
+
+    if (!egress || !egress->target_ready || !header || header_len > MEDIA_RTP_EGRESS_MAX_HEADER ||
+        payload_iov_count < 0 || payload_iov_count > MEDIA_RTP_EGRESS_MAX_PACKET_IOV - 1) {
+        fprintf(stderr, "[ERROR] media_rtp_egress_queue invalid args header_len=%zu iov=%d\n", header_len, payload_iov_count);
+        return -1;
+    }
+    if (egress->frame_dropped) return 0;
+    if (egress->count >= MEDIA_RTP_EGRESS_MAX_BATCH && media_rtp_egress_flush(egress) != 0) return -1;
+
+    slot = egress->count;
+    memcpy(egress->headers[slot], header, header_len);
+    egress->iov[slot][0].iov_base = egress->headers[slot];
+    egress->iov[slot][0].iov_len = header_len;
+    for (i = 0; i < payload_iov_count; ++i) {
+        egress->iov[slot][i + 1] = payload[i];
+        len += payload[i].iov_len;
+    }
+    egress->packet_iov_count[slot] = payload_iov_count + 1;
+    egress->packet_len[slot] = len;
+    egress->count++;
+    return 0;
+}
+
+static int tcp_drain_pending(MediaRtpEgress *egress) {
+    /* 续写上一批没写完的字节；仍有剩余时返回 1。 */
+    while (egress->tcp_pending_off < egress->tcp_pending_len) {
+        ssize_t ret = send(egress->fd,
+                           egress->tcp_pending + egress->tcp_pending_off,
+                           egress->tcp_pending_len - egress->tcp_pending_off,
+                           MSG_NOSIGNAL | MSG_DONTWAIT);
+        egress->syscalls++;
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 1;
+            fprintf(stderr, "[ERROR] media_rtp_egress tcp send failed fd=%d pending=%zu errno=%d(%s)\n",
+                    egress->fd, egress->tcp_pending_len - egress->tcp_pending_off, errno, strerror(errno));
+            egress->errors++;
+            return -1;
+        }
+        egress->tcp_pending_off += (size_t)ret;
+    }
+    egress->tcp_pending_len = 0;
+    egress->tcp_pending_off = 0;
+    return 0;
+}
+
+static int tcp_stash(MediaRtpEgress *egress, const struct iovec *iov, int iov_count, size_t skip) {
+    /* 把 iov 中跳过前 skip 字节后的剩余内容拷进 tcp_pending，保证 RFC 4571 分帧不被打断。 */
+    size_t total = 0;
+    size_t need;
+    int i;
+
+    for (i = 0; i < iov_count; ++i) total += iov[i].iov_len;
+    if (skip >= total) return 0;
+    need = egress->tcp_pending_len + total - skip;
+    if (need > egress->tcp_pending_cap) {
+        size_t cap = egress->tcp_pending_cap ? egress->tcp_pending_cap : 64 * 1024;
+        uint8_t *buf;
+        while (cap < need) cap *= 2;
+        buf = (uint8_t *)realloc(egress->tcp_pending, cap);
+        if (!buf) {
+            fprintf(stderr, "[ERROR] media_rtp_egress tcp pending alloc failed size=%zu\n", cap);
+            egress->errors++;
+            return -1;
+        }
+        egress->tcp_pending = buf;
+        egress->tcp_pending_cap = cap;
+    }
+    for (i = 0; i < iov_count; ++i) {
+        size_t len = iov[i].iov_len;
+        const uint8_t *src = (const uint8_t *)iov[i].iov_base;
+        if (skip >= len) {
+            skip -= len;
+            continue;
+        }
+        memcpy(egress->tcp_pending + egress->tcp_pending_len, src + skip, len - skip);
+        egress->tcp_pending_len += len - skip;
+        skip = 0;
+    }
+    return 0;
+}
+
+static int send_tcp_range(MediaRtpEgress *egress, int first, int count) {
+    /* 用非阻塞 sendmsg 写带长度前缀的包，socket 收不下的部分暂存到续写缓冲。 */
+    struct iovec iov[RTP_EGRESS_MAX_MSG_IOV];
+    int end = first + count;
+    int i = first;
+
+    if (tcp_drain_pending(egress) < 0) return -1;
+    while (i < end) {
+        struct msghdr msg;
+        size_t total = 0;
+        int iov_count = 0;
+        int next = i;
+        ssize_t ret;
+
+        while (next < end && iov_count + 1 + egress->packet_iov_count[next] <= RTP_EGRESS_MAX_MSG_IOV) {
+            int j;
+            egress->prefixes[next][0] = (uint8_t)(egress->packet_len[next] >> 8);
+            egress->prefixes[next][1] = (uint8_t)egress->packet_len[next];
+            iov[iov_count].iov_base = egress->prefixes[next];
+            iov[iov_count++].iov_len = RTP_EGRESS_TCP_PREFIX;
+            for (j = 0; j < egress->packet_iov_count[next]; ++j) iov[iov_count++] = egress->iov[next][j];
+            total += RTP_EGRESS_TCP_PREFIX + egress->packet_len[next];
+            ++next;
+        }
+        /* 前面还有没写完的字节时不能插队，整段追加到续写缓冲。 */
+        if (egress->tcp_pending_len > 0) {
+            if (tcp_stash(egress, iov, iov_count, 0) != 0) return -1;
+            i = next;
+            continue;
+        }
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)iov_count;
+        for (;;) {
+            ret = sendmsg(egress->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+            egress->syscalls++;
+            if (ret >= 0) break;
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                ret = 0;
+                break;
+            }
+            fprintf(stderr, "[ERROR] media_rtp_egress tcp sendmsg failed fd=%d packets=%d errno=%d(%s)\n",
+                    egress->fd, next - i, errno, strerror(errno));
+            egress->errors++;
+            return -1;
+        }
+        if ((size_t)ret < total) {
+            egress->tcp_partial_writes++;
+            if (tcp_stash(egress, iov, iov_count, (size_t)ret) != 0) return -1;
+        }
+        i = next;
+    }
+    return 0;
+}
+
+static int tcp_frame_blocked(MediaRtpEgress *egress, size_t frame_bytes) {
+    /* 上一帧的尾巴已写完且内核发送队列放得下这一帧时才接收新帧。 */
+    int outq = 0;
+    int sndbuf = 0;
+    socklen_t len = sizeof(sndbuf);
+    int drain = tcp_drain_pending(egress);
+
+    if (drain > 0) return 1;
+    /* 连接已出错时放行，让 flush 把错误报给调用方。 */
+    if (drain < 0) return 0;
+    if (ioctl(egress->fd, SIOCOUTQ, &outq) != 0 ||
+        getsockopt(egress->fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, &len) != 0) {
+        return 0;
+    }
+    /* 队列为空时总是放行（写不完的部分进续写缓冲）；SO_SNDBUF 读回值含内核开销，按一半估算负载容量。 */
+    frame_bytes += frame_bytes / 64;
+    return (outq > 0 && (size_t)outq + frame_bytes > (size_t)sndbuf / 2) ? 1 : 0;
+}
+
+static int send_range(MediaRtpEgress *egress, int first, int count, int *sent) {
+    /* 发送队列中 [first, first + count) 的包，socket 支持时优先按 GSO 成组发送。 */
+    int end = first + count;
+    uint64_t cpu_start = get_thread_cpu_us();
+    int ret = 0;
+
+    *sent = 0;
+    if (egress->transport == MEDIA_RTP_TRANSPORT_TCP) {
+        ret = send_tcp_range(egress, first, count);
+        if (ret == 0) *sent = count;
+        egress->send_cpu_us += get_thread_cpu_us() - cpu_start;
+        return ret;
+    }
+    while (first < end) {
+        int run = 1;
+        if (egress->gso_supported == 1) {
+            run = gso_run_length(egress, first);
+            if (run > end - first) run = end - first;
+            if (run >= 2) {
+                int gso_ret = send_gso_range(egress, first, run, egress->packet_len[first]);
+                if (gso_ret == 0) {
+                    first += run;
+                    *sent += run;
+                    continue;
+                }
+                if (gso_ret < 0) {
+                    ret = -1;
+                    break;
+                }
+            }
+        } else {
+            run = end - first;
+        }
+        if (send_mmsg_range(egress, first, run) != 0) {
+            ret = -1;
+            break;
+        }
+        first += run;
+        *sent += run;
+    }
+    egress->send_cpu_us += get_thread_cpu_us() - cpu_start;
+    return ret;
+}
+
+static int send_paced_step(MediaRtpEgress *egress, int *first, uint64_t now_us, uint64_t delay_us, int waited,
+                           uint64_t *wait_us, int *sent) {
+    /* 按当前令牌放行从 *first 开始的一段包；返回放行个数，令牌不足时返回 0 并写 *wait_us，出错返回 -1。 */
+    MediaRtpPacer *pacer = &egress->pacer;
+    int occupancy = egress->count - *first;
+    int n = 0;
+    int done = 0;
+    int ret;
+
+    while (*first + n < egress->count &&
+           media_rtp_pacer_try_consume(pacer, egress->packet_len[*first + n], now_us, wait_us)) {
+        ++n;
+    }
+    if (n == 0) return 0;
+    pacer->paced_packets += (uint64_t)n;
+    if (waited) {
+        pacer->delayed_packets += (uint64_t)n;
+        pacer->delay_us_sum += delay_us * (uint64_t)n;
+        if (delay_us > pacer->delay_us_max) pacer->delay_us_max = delay_us;
+    }
+    pacer->occupancy_sum += (uint64_t)occupancy;
+    pacer->occupancy_samples++;
+    if (occupancy > pacer->occupancy_max) pacer->occupancy_max = occupancy;
+
+    ret = send_range(egress, *first, n, &done);
+    *sent += done;
+    if (ret != 0) return -1;
+    *first += n;
+    return n;
+}
+
+static int send_paced(MediaRtpEgress *egress, int *sent) {
+    /* 按令牌分段放行，段间睡眠；时延从 flush 开始时计算。 */
+    uint64_t flush_start_us = get_monotonic_us();
+    int waited = 0;
+    int first = 0;
+
+    *sent = 0;
+    while (first < egress->count) {
+        uint64_t now_us = get_monotonic_us();
+        uint64_t wait_us = 0;
+        int n = send_paced_step(egress, &first, now_us, now_us - flush_start_us, waited, &wait_us, sent);
+        if (n < 0) return -1;
+        if (n == 0) {
+            sleep_us(wait_us);
+            waited = 1;
+        }
+    }
+    return 0;
+}
+
+static void finish_batch(MediaRtpEgress *egress, int sent) {
+    /* 统计已经发出的包并清空本批。 */
+    int i;
+    for (i = 0; i < sent; ++i) egress->bytes += egress->packet_len[i];
+    egress->packets += (uint64_t)sent;
+    egress->count = 0;
+}
+
+void media_rtp_egress_set_pacing(MediaRtpEgress *egress, const MediaRtpPacerConfig *config, int bitrate, int fps) {
+    if (!egress) return;
+    egress->pacing = (config && config->enabled) ? 1 : 0;
+    media_rtp_pacer_init(&egress->pacer, config, bitrate, fps);
+}
+
+void media_rtp_egress_update_pacing_rate(MediaRtpEgress *egress, int bitrate, int fps) {
+    if (!egress || !egress->pacing) return;
+    media_rtp_pacer_set_rate(&egress->pacer, bitrate, fps);
+}
+
+int media_rtp_egress_begin_frame(MediaRtpEgress *egress, size_t frame_bytes) {
+    if (!egress) return 0;
+    egress->frame_dropped = 0;
+    if (egress->transport == MEDIA_RTP_TRANSPORT_TCP && egress->target_ready && tcp_frame_blocked(egress, frame_bytes)) {
+        egress->frame_dropped = 1;
+        egress->dropped_frames++;
+        return 1;
+    }
+    if (egress->pacing) media_rtp_pacer_begin_frame(&egress->pacer, frame_bytes);
+    return 0;
+}
+
+int media_rtp_egress_flush(MediaRtpEgress *egress) {
+    int sent = 0;
+    int ret;
+
+    if (!egress) return 0;
+    if (egress->count == 0) {
+        /* TCP 下没有新包时也把上次的帧尾推出去。 */
+        if (egress->transport == MEDIA_RTP_TRANSPORT_TCP && egress->tcp_pending_len > 0) {
+            return (tcp_drain_pending(egress) < 0) ? -1 : 0;
+        }
+        return 0;
+    }
+    if (egress->pacing) {
+        ret = send_paced(egress, &sent);
+    } else {
+        ret = send_range(egress, 0, egress->count, &sent);
+    }
+    finish_batch(egress, sent);
+    return ret;
+}
+
+int media_rtp_egress_flush_group(MediaRtpEgress **egresses, int count, int *results) {
+    int first[MEDIA_RTP_EGRESS_MAX_GROUP];
+    int sent[MEDIA_RTP_EGRESS_MAX_GROUP];
+    int active[MEDIA_RTP_EGRESS_MAX_GROUP];
+    uint64_t flush_start_us = get_monotonic_us();
+    int pending = 0;
+    int waited = 0;
+    int ret = 0;
+    int i;
+
+    if (!egresses || count <= 0) return 0;
+    memset(active, 0, sizeof(active));
+    for (i = 0; i < count; ++i) {
+        MediaRtpEgress *egress = egresses[i];
+        if (results) results[i] = 0;
+        /* 不平滑、批次为空或超出分组上限的发送器直接走普通 flush。 */
+        if (!egress || !egress->pacing || egress->count == 0 || i >= MEDIA_RTP_EGRESS_MAX_GROUP) {
+            if (media_rtp_egress_flush(egress) != 0) {
+                if (results) results[i] = -1;
+                ret = -1;
+            }
+            continue;
+        }
+        first[i] = 0;
+        sent[i] = 0;
+        active[i] = 1;
+        pending++;
+    }
+    if (count > MEDIA_RTP_EGRESS_MAX_GROUP) count = MEDIA_RTP_EGRESS_MAX_GROUP;
+
+    /* 每轮各发送器按自己的令牌放行一段，线程只按最短的等待时间睡眠，N 路共用一个平滑窗口。 */
+    while (pending > 0) {
+        uint64_t now_us = get_monotonic_us();
+        uint64_t min_wait_us = 0;
+        int progressed = 0;
+        for (i = 0; i < count; ++i) {
+            MediaRtpEgress *egress = egresses[i];
+            uint64_t wait_us = 0;
+            int n;
+            if (!active[i]) continue;
+            n = send_paced_step(egress, &first[i], now_us, now_us - flush_start_us, waited, &wait_us, &sent[i]);
+            if (n < 0 || first[i] >= egress->count) {
+                if (n < 0) {
+                    if (results) results[i] = -1;
+                    ret = -1;
+                }
+                finish_batch(egress, sent[i]);
+                active[i] = 0;
+                pending--;
+                progressed = 1;
+                continue;
+            }
+            if (n > 0) {
+                progressed = 1;
+            } else if (min_wait_us == 0 || wait_us < min_wait_us) {
+                min_wait_us = wait_us;
+            }
+        }
+        if (pending > 0 && !progressed) {
+            sleep_us(min_wait_us);
+            waited = 1;
+        }
+    }
+    return ret;
+}
+
+int media_rtp_egress_end_frame(MediaRtpEgress *egress) {
+    int ret;
+    if (!egress) return -1;
+    ret = media_rtp_egress_flush(egress);
+    egress->frame_dropped = 0;
+    egress->frames++;
+    return ret;
+}
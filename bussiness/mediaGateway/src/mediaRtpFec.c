@@ -0,0 +1,211 @@
+#include "mediaRtpFec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_FEC_PAYLOAD_TYPE 127
+#define DEFAULT_FEC_KEY_PERCENT 20
+#define DEFAULT_FEC_DELTA_PERCENT 10
+#define FEC_RTP_HEADER 12
+#define FEC_SHORT_MASK_BITS 16
+
+static uint64_t get_monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* dst ^= src，按 8 字节成块异或，交给编译器向量化。 */
+static void xor_bytes(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t a;
+        uint64_t b;
+        memcpy(&a, dst + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dst + i, &a, 8);
+    }
+    for (; i < len; ++i) dst[i] ^= src[i];
+}
+
+void media_rtp_fec_fill_default(MediaRtpFecConfig *config) {
+    if (!config) return;
+    config->enabled = config->enabled ? 1 : 0;
+    if (config->payload_type <= 0 || config->payload_type > 127) config->payload_type = DEFAULT_FEC_PAYLOAD_TYPE;
+    if (config->key_percent < 0 || config->key_percent > 100) config->key_percent = DEFAULT_FEC_KEY_PERCENT;
+    if (config->delta_percent < 0 || config->delta_percent > 100) config->delta_percent = DEFAULT_FEC_DELTA_PERCENT;
+}
+
+int media_rtp_fec_init(MediaRtpFecEncoder *encoder, const MediaRtpFecConfig *config) {
+    if (!encoder) return -1;
+    memset(encoder, 0, sizeof(*encoder));
+    if (config) encoder->config = *config;
+    media_rtp_fec_fill_default(&encoder->config);
+    encoder->parity = (uint8_t *)malloc((size_t)MEDIA_RTP_FEC_MAX_GROUPS * MEDIA_RTP_FEC_MAX_PAYLOAD);
+    if (!encoder->parity) {
+        fprintf(stderr, "[ERROR] media_rtp_fec_init alloc parity failed\n");
+        return -1;
+    }
+    return 0;
+}
+
+void media_rtp_fec_deinit(MediaRtpFecEncoder *encoder) {
+    if (!encoder) return;
+    free(encoder->parity);
+    memset(encoder, 0, sizeof(*encoder));
+}
+
+void media_rtp_fec_begin_frame(MediaRtpFecEncoder *encoder, int expected_packets, int is_key_frame) {
+    int percent;
+    int fec_count;
+    int group_size;
+    if (!encoder) return;
+    encoder->group_count = 0;
+    encoder->group_size = 0;
+    encoder->frame_packets = 0;
+    percent = is_key_frame ? encoder->config.key_percent : encoder->config.delta_percent;
+    if (!encoder->config.enabled || !encoder->parity || percent <= 0 || expected_packets <= 0) return;
+    fec_count = (expected_packets * percent + 99) / 100;
+    if (fec_count < 1) fec_count = 1;
+    group_size = (expected_packets + fec_count - 1) / fec_count;
+    /* 组数有上限时放大组；组大小受掩码位数限制，超出部分在 add_packet 里计为未保护。 */
+    if (group_size < (expected_packets + MEDIA_RTP_FEC_MAX_GROUPS - 1) / MEDIA_RTP_FEC_MAX_GROUPS) {
+        group_size = (expected_packets + MEDIA_RTP_FEC_MAX_GROUPS - 1) / MEDIA_RTP_FEC_MAX_GROUPS;
+    }
+    if (group_size > MEDIA_RTP_FEC_MAX_GROUP_SIZE) group_size = MEDIA_RTP_FEC_MAX_GROUP_SIZE;
+    encoder->group_size = group_size;
+}
+
+void media_rtp_fec_add_packet(MediaRtpFecEncoder *encoder,
+                              const uint8_t *header,
+                              const struct iovec *payload,
+                              int payload_iov_count,
+                              size_t payload_len) {
+    MediaRtpFecGroup *group;
+    uint8_t *parity;
+    uint64_t start_ns;
+    size_t off = 0;
+    int index;
+    int i;
+
+    if (!encoder || !header || encoder->group_size == 0) return;
+    index = encoder->frame_packets++;
+    if (index / encoder->group_size >= MEDIA_RTP_FEC_MAX_GROUPS || payload_len > MEDIA_RTP_FEC_MAX_PAYLOAD) {
+        encoder->unprotected_packets++;
+        return;
+    }
+    start_ns = get_monotonic_ns();
+    if (index / encoder->group_size == encoder->group_count) {
+        group = &encoder->groups[encoder->group_count];
+        memset(group, 0, sizeof(*group));
+        group->first = index;
+        memset(encoder->parity + (size_t)encoder->group_count * MEDIA_RTP_FEC_MAX_PAYLOAD, 0, MEDIA_RTP_FEC_MAX_PAYLOAD);
+        encoder->group_count++;
+    }
+    group = &encoder->groups[encoder->group_count - 1];
+    parity = encoder->parity + (size_t)(encoder->group_count - 1) * MEDIA_RTP_FEC_MAX_PAYLOAD;
+    group->mask |= 1ULL << (47 - (index - group->first));
+    group->count++;
+    group->b0_recovery ^= header[0];
+    group->b1_recovery ^= header[1];
+    group->ts_recovery ^= ((uint32_t)header[4] << 24) | ((uint32_t)header[5] << 16) | ((uint32_t)header[6] << 8) | header[7];
+    group->length_recovery ^= (uint16_t)payload_len;
+    if (payload_len > group->protect_len) group->protect_len = payload_len;
+    for (i = 0; i < payload_iov_count; ++i) {
+        xor_bytes(parity + off, (const uint8_t *)payload[i].iov_base, payload[i].iov_len);
+        off += payload[i].iov_len;
+    }
+    encoder->media_packets++;
+    encoder->encode_ns += get_monotonic_ns() - start_ns;
+}
+
+int media_rtp_fec_end_frame(MediaRtpFecEncoder *encoder) {
+    if (!encoder) return 0;
+    if (encoder->group_count > 0) {
+        encoder->frames++;
+        encoder->fec_packets += (uint64_t)encoder->group_count;
+    }
+    return encoder->group_count;
+}
+
+size_t media_rtp_fec_write_header(const MediaRtpFecEncoder *encoder, int group, uint16_t frame_first_seq, uint8_t *out) {
+    const MediaRtpFecGroup *g;
+    uint16_t sn_base;
+    int long_mask;
+    if (!encoder || !out || group < 0 || group >= encoder->group_count) return 0;
+    g = &encoder->groups[group];
+    sn_base = (uint16_t)(frame_first_seq + g->first);
+    /* 组内跨度不超过 16 个包时用短掩码，否则 L=1 用 48 位长掩码。 */
+    long_mask = (g->mask & ((1ULL << (48 - FEC_SHORT_MASK_BITS)) - 1)) != 0;
+    out[0] = (uint8_t)((long_mask ? 0x40 : 0x00) | (g->b0_recovery & 0x3F));
+    out[1] = g->b1_recovery;
+    out[2] = (uint8_t)(sn_base >> 8);
+    out[3] = (uint8_t)sn_base;
+    out[4] = (uint8_t)(g->ts_recovery >> 24);
+    out[5] = (uint8_t)(g->ts_recovery >> 16);
+    out[6] = (uint8_t)(g->ts_recovery >> 8);
+    out[7] = (uint8_t)g->ts_recovery;
+    out[8] = (uint8_t)(g->length_recovery >> 8);
+    out[9] = (uint8_t)g->length_recovery;
+    out[10] = (uint8_t)(g->protect_len >> 8);
+    out[11] = (uint8_t)g->protect_len;
+    out[12] = (uint8_t)(g->mask >> 40);
+    out[13] = (uint8_t)(g->mask >> 32);
+    if (!long_mask) return 14;
+    out[14] = (uint8_t)(g->mask >> 24);
+    out[15] = (uint8_t)(g->mask >> 16);
+    out[16] = (uint8_t)(g->mask >> 8);
+    out[17] = (uint8_t)g->mask;
+    return MEDIA_RTP_FEC_HEADER_MAX;
+}
+
+const uint8_t *media_rtp_fec_parity(const MediaRtpFecEncoder *encoder, int group, size_t *len) {
+    if (!encoder || group < 0 || group >= encoder->group_count) return NULL;
+    if (len) *len = encoder->groups[group].protect_len;
+    return encoder->parity + (size_t)group * MEDIA_RTP_FEC_MAX_PAYLOAD;
+}
+
+void media_rtp_fec_stream_reset(MediaRtpFecStream *stream, uint32_t ssrc) {
+    if (!stream) return;
+    stream->ssrc = ssrc;
+    stream->seq = 0;
+    stream->packets = 0;
+    stream->bytes = 0;
+}
+
+int media_rtp_fec_queue(const MediaRtpFecEncoder *encoder,
+                        MediaRtpFecStream *stream,
+                        MediaRtpEgress *egress,
+                        uint16_t frame_first_seq,
+                        uint32_t rtp_timestamp) {
+    int g;
+    if (!encoder || !stream || !egress) return -1;
+    for (g = 0; g < encoder->group_count; ++g) {
+        uint8_t header[FEC_RTP_HEADER];
+        struct iovec payload[2];
+        size_t fec_header_len = media_rtp_fec_write_header(encoder, g, frame_first_seq, stream->headers[g]);
+        header[0] = 0x80;
+        header[1] = (uint8_t)(encoder->config.payload_type & 0x7F);
+        header[2] = (uint8_t)(stream->seq >> 8);
+        header[3] = (uint8_t)stream->seq;
+        header[4] = (uint8_t)(rtp_timestamp >> 24);
+        header[5] = (uint8_t)(rtp_timestamp >> 16);
+        header[6] = (uint8_t)(rtp_timestamp >> 8);
+        header[7] = (uint8_t)rtp_timestamp;
+        header[8] = (uint8_t)(stream->ssrc >> 24);
+        header[9] = (uint8_t)(stream->ssrc >> 16);
+        header[10] = (uint8_t)(stream->ssrc >> 8);
+        header[11] = (uint8_t)stream->ssrc;
+        payload[0].iov_base = stream->headers[g];
+        payload[0].iov_len = fec_header_len;
+        payload[1].iov_base = (void *)media_rtp_fec_parity(encoder, g, &payload[1].iov_len);
+        if (media_rtp_egress_queue(egress, header, sizeof(header), payload, 2) != 0) return -1;
+        stream->seq++;
+        stream->packets++;
+        stream->bytes += sizeof(header) + fec_header_len + payload[1].iov_len;
+    }
+    return 0;
+}
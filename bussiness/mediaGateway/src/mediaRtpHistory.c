@@ -0,0 +1,199 @@
+#include "mediaRtpHistory.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+/* RTCP 传输层反馈（RTPFB）报文类型，Generic NACK 的 FMT。 */
+#define RTCP_PT_RTPFB 205
+#define RTCP_FMT_GENERIC_NACK 1
+/* 单次 serve 最多读取的 RTCP 报文数，避免反馈风暴时长时间占住发送线程。 */
+#define RTP_HISTORY_MAX_FEEDBACK_READS 32
+#define RTP_HISTORY_MAX_NACK_SEQS 256
+
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+int media_rtp_history_arena_init(MediaRtpHistoryArena *arena, size_t capacity) {
+    if (!arena || capacity == 0) return -1;
+    memset(arena, 0, sizeof(*arena));
+    arena->data = (uint8_t *)malloc(capacity);
+    if (!arena->data) {
+        fprintf(stderr, "[ERROR] media_rtp_history_arena_init alloc failed capacity=%zu\n", capacity);
+        return -1;
+    }
+    arena->capacity = capacity;
+    return 0;
+}
+
+void media_rtp_history_arena_deinit(MediaRtpHistoryArena *arena) {
+    if (!arena) return;
+    free(arena->data);
+    memset(arena, 0, sizeof(*arena));
+}
+
+uint64_t media_rtp_history_arena_append(MediaRtpHistoryArena *arena, const struct iovec *payload, int payload_iov_count) {
+    uint64_t start;
+    int i;
+    if (!arena || !arena->data) return 0;
+    start = arena->write_pos;
+    for (i = 0; i < payload_iov_count; ++i) {
+        const uint8_t *src = (const uint8_t *)payload[i].iov_base;
+        size_t left = payload[i].iov_len;
+        while (left > 0) {
+            size_t off = (size_t)(arena->write_pos % arena->capacity);
+            size_t n = arena->capacity - off;
+            if (n > left) n = left;
+            memcpy(arena->data + off, src, n);
+            src += n;
+            left -= n;
+            arena->write_pos += n;
+        }
+    }
+    return start;
+}
+
+int media_rtp_history_init(MediaRtpHistory *history, const MediaRtpHistoryArena *arena, int entry_count) {
+    int count = 1;
+    if (!history || !arena || entry_count <= 0) return -1;
+    memset(history, 0, sizeof(*history));
+    while (count < entry_count) count <<= 1;
+    history->entries = (MediaRtpHistoryEntry *)calloc((size_t)count, sizeof(MediaRtpHistoryEntry));
+    if (!history->entries) {
+        fprintf(stderr, "[ERROR] media_rtp_history_init alloc failed entries=%d\n", count);
+        return -1;
+    }
+    history->arena = arena;
+    history->entry_count = count;
+    return 0;
+}
+
+void media_rtp_history_deinit(MediaRtpHistory *history) {
+    if (!history) return;
+    free(history->entries);
+    memset(history, 0, sizeof(*history));
+}
+
+void media_rtp_history_reset(MediaRtpHistory *history, uint32_t ssrc) {
+    if (!history || !history->entries) return;
+    memset(history->entries, 0, sizeof(MediaRtpHistoryEntry) * (size_t)history->entry_count);
+    history->ssrc = ssrc;
+    history->nack_packets = 0;
+    history->nack_requested = 0;
+    history->retransmitted = 0;
+    history->too_late = 0;
+}
+
+void media_rtp_history_record(MediaRtpHistory *history, const uint8_t *header, uint64_t pos, size_t len) {
+    MediaRtpHistoryEntry *entry;
+    uint16_t seq;
+    if (!history || !history->entries || !header) return;
+    seq = (uint16_t)((header[2] << 8) | header[3]);
+    entry = &history->entries[seq & (uint16_t)(history->entry_count - 1)];
+    memcpy(entry->header, header, MEDIA_RTP_HISTORY_HEADER);
+    entry->pos = pos;
+    entry->len = (uint32_t)len;
+    entry->seq = seq;
+    entry->valid = 1;
+}
+
+int media_rtp_history_lookup(const MediaRtpHistory *history, uint16_t seq, const MediaRtpHistoryEntry **out, struct iovec payload[2]) {
+    /* 槽位里必须仍是这个序号，且负载没有被后来的包覆盖。 */
+    const MediaRtpHistoryArena *arena = history->arena;
+    const MediaRtpHistoryEntry *entry = &history->entries[seq & (uint16_t)(history->entry_count - 1)];
+    size_t off;
+    size_t first;
+    if (!entry->valid || entry->seq != seq) return -1;
+    if (arena->write_pos - entry->pos > arena->capacity) return -1;
+    off = (size_t)(entry->pos % arena->capacity);
+    first = arena->capacity - off;
+    if (first > entry->len) first = entry->len;
+    payload[0].iov_base = arena->data + off;
+    payload[0].iov_len = first;
+    payload[1].iov_base = arena->data;
+    payload[1].iov_len = entry->len - first;
+    *out = entry;
+    return (payload[1].iov_len > 0) ? 2 : 1;
+}
+
+int media_rtcp_parse_nack(const uint8_t *buf, size_t len, uint32_t media_ssrc, uint16_t *seqs, int max_seqs) {
+    size_t off = 0;
+    int count = 0;
+    if (!buf || !seqs || max_seqs <= 0) return 0;
+    while (len - off >= 4) {
+        const uint8_t *p = buf + off;
+        size_t pkt_len = ((size_t)((p[2] << 8) | p[3]) + 1) * 4;
+        size_t fci;
+        if ((p[0] >> 6) != 2 || pkt_len > len - off) break;
+        if (p[1] == RTCP_PT_RTPFB && (p[0] & 0x1F) == RTCP_FMT_GENERIC_NACK && pkt_len >= 12 &&
+            read_be32(p + 8) == media_ssrc) {
+            for (fci = 12; fci + 4 <= pkt_len; fci += 4) {
+                uint16_t pid = (uint16_t)((p[fci] << 8) | p[fci + 1]);
+                uint16_t blp = (uint16_t)((p[fci + 2] << 8) | p[fci + 3]);
+                int bit;
+                if (count < max_seqs) seqs[count++] = pid;
+                for (bit = 0; bit < 16; ++bit) {
+                    if ((blp & (1U << bit)) && count < max_seqs) seqs[count++] = (uint16_t)(pid + bit + 1);
+                }
+            }
+        }
+        off += pkt_len;
+    }
+    return count;
+}
+
+int media_rtp_history_handle_nack(MediaRtpHistory *history, MediaRtpEgress *egress, const uint8_t *buf, size_t len) {
+    uint16_t seqs[RTP_HISTORY_MAX_NACK_SEQS];
+    int served = 0;
+    int count;
+    int i;
+
+    if (!history || !history->entries || !egress || !buf) return -1;
+    if (egress->transport != MEDIA_RTP_TRANSPORT_UDP || !egress->target_ready) return 0;
+    count = media_rtcp_parse_nack(buf, len, history->ssrc, seqs, RTP_HISTORY_MAX_NACK_SEQS);
+    if (count == 0) return 0;
+    history->nack_packets++;
+    history->nack_requested += (uint64_t)count;
+    for (i = 0; i < count; ++i) {
+        const MediaRtpHistoryEntry *entry = NULL;
+        struct iovec payload[2];
+        int iov_count = media_rtp_history_lookup(history, seqs[i], &entry, payload);
+        if (iov_count < 0) {
+            history->too_late++;
+            continue;
+        }
+        /* 原样重发（seq/ts/ssrc 都不变），GB28181 接收端按原序号补洞。 */
+        if (media_rtp_egress_queue(egress, entry->header, MEDIA_RTP_HISTORY_HEADER, payload, iov_count) == 0) {
+            history->retransmitted++;
+            served++;
+        }
+    }
+    /* 负载引用指向 arena，必须在下一次追加覆盖之前发出去。 */
+    media_rtp_egress_flush(egress);
+    return served;
+}
+
+int media_rtp_history_serve_rtcp(MediaRtpHistory *history, MediaRtpEgress *egress, int fd, MediaRtcpPacketFn on_packet, void *user) {
+    uint8_t buf[1500];
+    int served = 0;
+    int reads;
+
+    if ((history && !history->entries) || !egress || fd < 0) return -1;
+    if (egress->transport != MEDIA_RTP_TRANSPORT_UDP || !egress->target_ready) return 0;
+    for (reads = 0; reads < RTP_HISTORY_MAX_FEEDBACK_READS; ++reads) {
+        ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (history) {
+            int n_served = media_rtp_history_handle_nack(history, egress, buf, (size_t)n);
+            if (n_served > 0) served += n_served;
+        }
+        if (on_packet) on_packet(user, buf, (size_t)n);
+    }
+    return served;
+}
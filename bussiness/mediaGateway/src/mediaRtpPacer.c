@@ -0,0 +1,64 @@
+#include "mediaRtpPacer.h"
+
+#include <string.h>
+
+#define DEFAULT_PACER_RATE_PERCENT 200
+#define DEFAULT_PACER_BURST_BYTES (16 * 1024)
+#define DEFAULT_PACER_SPREAD_PERCENT 50
+#define DEFAULT_PACER_FPS 25
+#define DEFAULT_PACER_BITRATE (2 * 1024 * 1024)
+
+void media_rtp_pacer_fill_default(MediaRtpPacerConfig *config) {
+    if (!config) return;
+    config->enabled = config->enabled ? 1 : 0;
+    if (config->rate_percent <= 0) config->rate_percent = DEFAULT_PACER_RATE_PERCENT;
+    if (config->burst_bytes <= 0) config->burst_bytes = DEFAULT_PACER_BURST_BYTES;
+    if (config->spread_percent <= 0 || config->spread_percent > 100) config->spread_percent = DEFAULT_PACER_SPREAD_PERCENT;
+}
+
+void media_rtp_pacer_init(MediaRtpPacer *pacer, const MediaRtpPacerConfig *config, int bitrate, int fps) {
+    if (!pacer) return;
+    memset(pacer, 0, sizeof(*pacer));
+    if (config) pacer->config = *config;
+    media_rtp_pacer_fill_default(&pacer->config);
+    media_rtp_pacer_set_rate(pacer, bitrate, fps);
+    pacer->tokens = (double)pacer->config.burst_bytes;
+}
+
+void media_rtp_pacer_set_rate(MediaRtpPacer *pacer, int bitrate, int fps) {
+    if (!pacer) return;
+    if (bitrate <= 0) bitrate = DEFAULT_PACER_BITRATE;
+    if (fps <= 0) fps = DEFAULT_PACER_FPS;
+    pacer->base_rate_bps = (uint64_t)bitrate / 8ULL * (uint64_t)pacer->config.rate_percent / 100ULL;
+    pacer->frame_interval_us = 1000000ULL / (uint64_t)fps;
+    pacer->rate_bps = pacer->base_rate_bps;
+}
+
+void media_rtp_pacer_begin_frame(MediaRtpPacer *pacer, size_t frame_bytes) {
+    uint64_t window_us;
+    uint64_t spread_rate;
+    if (!pacer) return;
+    /* 小帧走基础速率；大帧（通常是 IDR）按 spread 窗口反推速率，保证不拖到下一帧。 */
+    window_us = pacer->frame_interval_us * (uint64_t)pacer->config.spread_percent / 100ULL;
+    if (window_us == 0) window_us = 1;
+    spread_rate = (uint64_t)frame_bytes * 1000000ULL / window_us;
+    pacer->rate_bps = (spread_rate > pacer->base_rate_bps) ? spread_rate : pacer->base_rate_bps;
+}
+
+int media_rtp_pacer_try_consume(MediaRtpPacer *pacer, size_t bytes, uint64_t now_us, uint64_t *wait_us) {
+    double deficit;
+    if (!pacer) return 1;
+    if (pacer->last_refill_us != 0 && now_us > pacer->last_refill_us) {
+        pacer->tokens += (double)(now_us - pacer->last_refill_us) * (double)pacer->rate_bps / 1000000.0;
+        if (pacer->tokens > (double)pacer->config.burst_bytes) pacer->tokens = (double)pacer->config.burst_bytes;
+    }
+    pacer->last_refill_us = now_us;
+    /* 单包大于桶容量时只要桶满就放行，避免永远等不到。 */
+    if (pacer->tokens >= (double)bytes || pacer->tokens >= (double)pacer->config.burst_bytes) {
+        pacer->tokens -= (double)bytes;
+        return 1;
+    }
+    deficit = (double)bytes - pacer->tokens;
+    if (wait_us) *wait_us = (uint64_t)(deficit * 1000000.0 / (double)(pacer->rate_bps ? pacer->rate_bps : 1)) + 1;
+    return 0;
+}
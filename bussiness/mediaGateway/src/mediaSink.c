@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #define DEFAULT_SINK_QUEUE_CAPACITY 32
@@ -264,6 +265,70 @@ int media_sink_enqueue(MediaSink *sink, const MediaPacket *packet) {
     return 0;
 }
 
+/**
+ * @description: 查询下游是否有观看端
+ * @param {MediaSink *} sink
+ * @return {int}
+ */
+int media_sink_has_consumer(MediaSink *sink) {
+    if (!sink || !sink->vtable) {
+        return 0;
+    }
+    /* 推流类 sink 不知道下游有没有人看，保守地认为一直有。 */
+    if (!sink->vtable->has_consumer) {
+        return 1;
+    }
+    return sink->vtable->has_consumer(sink) ? 1 : 0;
+}
+
+/**
+ * @description: 打印 sink 协议层的细分统计
+ * @param {MediaSink *} sink
+ * @return {void}
+ */
+void media_sink_log_stats(MediaSink *sink) {
+    if (!sink || !sink->vtable || !sink->vtable->log_stats) {
+        return;
+    }
+    sink->vtable->log_stats(sink);
+}
+
+/**
+ * @description: 用缓存的关键帧序列替换发送队列
+ * @param {MediaSink *} sink
+ * @param {const MediaPacket *} packets
+ * @param {int} count
+ * @return {int}
+ */
+int media_sink_prime(MediaSink *sink, const MediaPacket *packets, int count) {
+    MediaPacket packet;
+    int i;
+
+    if (!sink || !packets || count <= 0 || !packets[0].buffer || !packets[0].is_key_frame) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&sink->lock);
+    if (count > sink->queue_capacity) {
+        pthread_mutex_unlock(&sink->lock);
+        return -1;
+    }
+    /* 被替换的旧包都包含在缓存序列里，或早于缓存的关键帧，不计入丢帧。 */
+    media_packet_init(&packet);
+    while (media_sink_pop_locked(sink, &packet) == 0) {
+        media_packet_reset(&packet);
+    }
+    sink->queue_head = 0;
+    for (i = 0; i < count; ++i) {
+        media_packet_copy_ref(&sink->queue[i], &packets[i]);
+    }
+    sink->queue_size = count;
+    sink->stats.queue_depth = sink->queue_size;
+    pthread_cond_signal(&sink->cond);
+    pthread_mutex_unlock(&sink->lock);
+    return 0;
+}
+
 /**
  * @description: 停止媒体输出通道
  * @param {MediaSink *} sink
@@ -328,5 +393,16 @@ void media_sink_get_stats(MediaSink *sink, MediaSinkStats *stats) {
     /* 统计信息和工作线程共享，读取时同样需要加锁。 */
     pthread_mutex_lock(&sink->lock);
     *stats = sink->stats;
+    stats->oldest_packet_age_us = 0;
+    if (sink->queue_size > 0 && sink->queue[sink->queue_head].pts_us > 0) {
+        /* pts_us 来自采集侧单调时钟，这里直接换算成队头包的积压时长。 */
+        struct timespec ts;
+        uint64_t now_us;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        now_us = (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+        if (now_us > sink->queue[sink->queue_head].pts_us) {
+            stats->oldest_packet_age_us = now_us - sink->queue[sink->queue_head].pts_us;
+        }
+    }
     pthread_mutex_unlock(&sink->lock);
 }
@@ -10,6 +10,26 @@
 extern "C" {
 #endif
 
+typedef struct {
+    int rc_mode;        /* MPP_ENC_RC_MODE_*；<=0 表示使用默认 CBR。 */
+    int h264_profile;   /* H264 profile，例如 66/77/100；<=0 表示默认 100。 */
+    int h264_level;     /* H264 level，例如 40；<=0 表示默认 40。 */
+    int h264_cabac_en;  /* 是否启用 CABAC；<0 表示默认 1。 */
+    int qp_init;        /* 初始 QP；<=0 表示使用 MPP 默认值。 */
+    int qp_min;         /* P/B 帧最小 QP；<=0 表示使用 MPP 默认值。 */
+    int qp_max;         /* P/B 帧最大 QP；<=0 表示使用 MPP 默认值。 */
+    int qp_min_i;       /* I 帧最小 QP；<=0 表示使用 MPP 默认值。 */
+    int qp_max_i;       /* I 帧最大 QP；<=0 表示使用 MPP 默认值。 */
+    int qp_max_step;    /* 相邻帧最大 QP 变化步长；<=0 表示使用 MPP 默认值。 */
+} MppEncoderOptions;
+
+/* set_rate_control_cfg 会写入的码控键个数（rc:mode、GOP、帧率、码率和全部 QP 键）。 */
+#define MPP_ENCODER_RC_CFG_KEYS 17
+
+typedef struct {
+    RK_S32 values[MPP_ENCODER_RC_CFG_KEYS]; /* 各码控键在配置对象里的值，顺序与 mppEncoder.c 的键表一致。 */
+} MppEncoderRcSnapshot;
+
 typedef struct {
     MppCtx ctx;                 /* MPP 编码上下文句柄。 */
     MppApi *mpi;                /* MPP 提供的接口函数表。 */
@@ -26,25 +46,13 @@ typedef struct {
     int fps;                    /* 编码帧率。 */
     int bitrate;                /* 目标码率。 */
     int gop;                    /* GOP 长度。 */
+    MppEncoderOptions options;  /* 当前生效的码控参数；调参失败时 options 不变，配置对象按快照还原。 */
     int64_t pts;                /* 送入 MPP 的时间戳计数。 */
 
     uint8_t *packet_cache;      /* 编码输出缓存，保存导出的 Annex-B 码流。 */
     size_t packet_cache_size;   /* packet_cache 当前容量。 */
 } MppEncoderCtx;
 
-typedef struct {
-    int rc_mode;        /* MPP_ENC_RC_MODE_*；<=0 表示使用默认 CBR。 */
-    int h264_profile;   /* H264 profile，例如 66/77/100；<=0 表示默认 100。 */
-    int h264_level;     /* H264 level，例如 40；<=0 表示默认 40。 */
-    int h264_cabac_en;  /* 是否启用 CABAC；<0 表示默认 1。 */
-    int qp_init;        /* 初始 QP；<=0 表示使用 MPP 默认值。 */
-    int qp_min;         /* P/B 帧最小 QP；<=0 表示使用 MPP 默认值。 */
-    int qp_max;         /* P/B 帧最大 QP；<=0 表示使用 MPP 默认值。 */
-    int qp_min_i;       /* I 帧最小 QP；<=0 表示使用 MPP 默认值。 */
-    int qp_max_i;       /* I 帧最大 QP；<=0 表示使用 MPP 默认值。 */
-    int qp_max_step;    /* 相邻帧最大 QP 变化步长；<=0 表示使用 MPP 默认值。 */
-} MppEncoderOptions;
-
 typedef struct {
     uint64_t input_copy_us;   /* NV12 copy into MPP input buffer. */
     uint64_t put_frame_us;    /* encode_put_frame call duration. */
@@ -85,6 +93,26 @@ int mpp_encoder_encode_frame(MppEncoderCtx *enc,
  */
 int mpp_encoder_request_idr(MppEncoderCtx *enc);
 
+/*
+ * 在线调整码率、帧率、GOP 和 QP 范围。
+ * 分辨率不变时通过 MPP_ENC_SET_CFG 原地生效，不重建上下文、不强制 IDR；
+ * 分辨率变化时内部执行 deinit + init。
+ * 返回 0 表示原地生效，1 表示已重建编码器，-1 表示失败。
+ */
+int mpp_encoder_reconfigure(MppEncoderCtx *enc,
+                            int width,
+                            int height,
+                            int fps,
+                            int bitrate,
+                            int gop,
+                            const MppEncoderOptions *options);
+
+/*
+ * 读出配置对象里全部码控键的当前值。
+ * 原地调参被 MPP 拒绝时据此整体还原，测试也用它比较还原前后的配置。
+ */
+void mpp_encoder_snapshot_rc_cfg(const MppEncoderCtx *enc, MppEncoderRcSnapshot *snapshot);
+
 #ifdef __cplusplus
 }
 #endif
@@ -10,6 +10,27 @@
 
 #define MPP_ALIGN(x, a) (((x) + (a)-1) & ~((a)-1))
 
+/* set_rate_control_cfg 写入的全部码控键，调参失败时按这张表整体还原。 */
+static const char *const g_rc_cfg_keys[MPP_ENCODER_RC_CFG_KEYS] = {
+    "rc:mode",
+    "rc:gop",
+    "rc:fps_in_flex",
+    "rc:fps_in_num",
+    "rc:fps_in_denorm",
+    "rc:fps_out_flex",
+    "rc:fps_out_num",
+    "rc:fps_out_denorm",
+    "rc:bps_target",
+    "rc:bps_max",
+    "rc:bps_min",
+    "rc:qp_init",
+    "rc:qp_min",
+    "rc:qp_max",
+    "rc:qp_min_i",
+    "rc:qp_max_i",
+    "rc:qp_max_step",
+};
+
 /**
  * @description: 输出 MPP 接口错误日志
  * @param {const char *} msg
@@ -83,6 +104,84 @@ static void copy_nv12_to_mpp_buffer(MppEncoderCtx *enc, uint8_t *dst, const uint
     }
 }
 
+/**
+ * @description: 把码率控制、GOP 和 QP 相关参数写入 enc->cfg，init 与在线重配置共用
+ * @param {MppEncoderCtx *} enc
+ * @param {const MppEncoderOptions *} options
+ * @return {static void}
+ */
+static void set_rate_control_cfg(MppEncoderCtx *enc, const MppEncoderOptions *options) {
+    /* Rate Control(RC) 模块 */
+    mpp_enc_cfg_set_s32(enc->cfg, "rc:mode", (options && options->rc_mode > 0) ? options->rc_mode : MPP_ENC_RC_MODE_CBR); /* 码率控制模式 */
+    mpp_enc_cfg_set_s32(enc->cfg, "rc:gop", enc->gop); /*两个I帧之间的间隔 */
+    mpp_enc_cfg_set_s32(enc->cfg, "rc:fps_in_flex", 0); /* 输入帧率是否可变, fps_in_flex=0 表示固定输入帧率 */
+
+    mpp_enc_cfg_set_s32(enc->cfg, "rc:fps_in_num", enc->fps); /* 输入帧率分数值的分子部分，默认值为30 */
+    mpp_enc_cfg_set_s32(enc->cfg, "rc:fps_in_denorm", 1); /* 输入帧率分数值的分母部分，默认值为1 */
+    mpp_enc_cfg_set_s32(enc->cfg, "rc:fps_out_flex", 0); /* 输出帧率是否可变的标志位，默认为0,fps_out_flex=0 表示固定输出帧率 */
+    mpp_enc_cfg_set_s32(enc->cfg, "rc:fps_out_num", enc->fps); /* 输出帧率分数值的分子部分，默认值为30 */
+    mpp_enc_cfg_set_s32(enc->cfg, "rc:fps_out_denorm", 1); /* 输出帧率分数值的分母部分，默认值为1 */
+    mpp_enc_cfg_set_s32(enc->cfg, "rc:bps_target", enc->bitrate); /* 定码率(CBR)模式下的目标码率 */
+    mpp_enc_cfg_set_s32(enc->cfg, "rc:bps_max", enc->bitrate * 17 / 16); /* 变码率(VBR)和自适应码率模式(AVBR)下的最高码率 */
+    mpp_enc_cfg_set_s32(enc->cfg, "rc:bps_min", enc->bitrate * 15 / 16); /* 变码率(VBR)和自适应码率模式(AVBR)下的最低码率 */
+
+    if (options) {
+        if (options->qp_init > 0) {
+            mpp_enc_cfg_set_s32(enc->cfg, "rc:qp_init", options->qp_init); /* 初始QP值 */
+        }
+        if (options->qp_min > 0) {
+            mpp_enc_cfg_set_s32(enc->cfg, "rc:qp_min", options->qp_min); /* P、B帧的最小QP值 */
+        }
+        if (options->qp_max > 0) {
+            mpp_enc_cfg_set_s32(enc->cfg, "rc:qp_max", options->qp_max); /* P、B帧的最大QP值 */
+        }
+        if (options->qp_min_i > 0) {
+            mpp_enc_cfg_set_s32(enc->cfg, "rc:qp_min_i", options->qp_min_i); /* I帧的最小QP值 */
+        }
+        if (options->qp_max_i > 0) {
+            mpp_enc_cfg_set_s32(enc->cfg, "rc:qp_max_i", options->qp_max_i); /* I帧的最大QP值 */
+        }
+        if (options->qp_max_step > 0) {
+            mpp_enc_cfg_set_s32(enc->cfg, "rc:qp_max_step", options->qp_max_step);
+        }
+    }
+}
+
+/**
+ * @description: 读出配置对象里全部码控键的当前值
+ * @param {const MppEncoderCtx *} enc
+ * @param {MppEncoderRcSnapshot *} snapshot
+ * @return {void}
+ */
+void mpp_encoder_snapshot_rc_cfg(const MppEncoderCtx *enc, MppEncoderRcSnapshot *snapshot) {
+    int i;
+
+    if (!snapshot) {
+        return;
+    }
+    memset(snapshot, 0, sizeof(*snapshot));
+    if (!enc || !enc->cfg) {
+        return;
+    }
+    for (i = 0; i < MPP_ENCODER_RC_CFG_KEYS; ++i) {
+        mpp_enc_cfg_get_s32(enc->cfg, g_rc_cfg_keys[i], &snapshot->values[i]);
+    }
+}
+
+/**
+ * @description: 把快照里的码控键逐个写回配置对象，不论取值是否为 0
+ * @param {MppEncoderCtx *} enc
+ * @param {const MppEncoderRcSnapshot *} snapshot
+ * @return {static void}
+ */
+static void restore_rate_control_cfg(MppEncoderCtx *enc, const MppEncoderRcSnapshot *snapshot) {
+    int i;
+
+    for (i = 0; i < MPP_ENCODER_RC_CFG_KEYS; ++i) {
+        mpp_enc_cfg_set_s32(enc->cfg, g_rc_cfg_keys[i], snapshot->values[i]);
+    }
+}
+
 /**
  * @description: 初始化 MPP 编码器
  * @param {MppEncoderCtx *} enc
@@ -108,6 +207,7 @@ int mpp_encoder_init(MppEncoderCtx *enc, int width, int height, int fps, int bit
     enc->fps = fps;
     enc->bitrate = bitrate;
     enc->gop = gop;
+    if (options) enc->options = *options;
     enc->pts = 0;
 
     // 1) 创建编码上下文并初始化为 H264 编码器。
@@ -139,40 +239,7 @@ int mpp_encoder_init(MppEncoderCtx *enc, int width, int height, int fps, int bit
     mpp_enc_cfg_set_s32(enc->cfg, "prep:hor_stride", enc->hor_stride);
     mpp_enc_cfg_set_s32(enc->cfg, "prep:ver_stride", enc->ver_stride);
     mpp_enc_cfg_set_s32(enc->cfg, "prep:format", MPP_FMT_YUV420SP); /* 图像色彩空间格式以及内存排布方式 */
-    /* Rate Control(RC) 模块 */
-    mpp_enc_cfg_set_s32(enc->cfg, "rc:mode", (options && options->rc_mode > 0) ? options->rc_mode : MPP_ENC_RC_MODE_CBR); /* 码率控制模式 */
-    mpp_enc_cfg_set_s32(enc->cfg, "rc:gop", enc->gop); /*两个I帧之间的间隔 */
-    mpp_enc_cfg_set_s32(enc->cfg, "rc:fps_in_flex", 0); /* 输入帧率是否可变, fps_in_flex=0 表示固定输入帧率 */
-
-    mpp_enc_cfg_set_s32(enc->cfg, "rc:fps_in_num", enc->fps); /* 输入帧率分数值的分子部分，默认值为30 */
-    mpp_enc_cfg_set_s32(enc->cfg, "rc:fps_in_denorm", 1); /* 输入帧率分数值的分母部分，默认值为1 */
-    mpp_enc_cfg_set_s32(enc->cfg, "rc:fps_out_flex", 0); /* 输出帧率是否可变的标志位，默认为0,fps_out_flex=0 表示固定输出帧率 */
-    mpp_enc_cfg_set_s32(enc->cfg, "rc:fps_out_num", enc->fps); /* 输出帧率分数值的分子部分，默认值为30 */
-    mpp_enc_cfg_set_s32(enc->cfg, "rc:fps_out_denorm", 1); /* 输出帧率分数值的分母部分，默认值为1 */
-    mpp_enc_cfg_set_s32(enc->cfg, "rc:bps_target", enc->bitrate); /* 定码率(CBR)模式下的目标码率 */
-    mpp_enc_cfg_set_s32(enc->cfg, "rc:bps_max", enc->bitrate * 17 / 16); /* 变码率(VBR)和自适应码率模式(AVBR)下的最高码率 */
-    mpp_enc_cfg_set_s32(enc->cfg, "rc:bps_min", enc->bitrate * 15 / 16); /* 变码率(VBR)和自适应码率模式(AVBR)下的最低码率 */
-
-    if (options) {
-        if (options->qp_init > 0) {
-            mpp_enc_cfg_set_s32(enc->cfg, "rc:qp_init", options->qp_init); /* 初始QP值 */
-        }
-        if (options->qp_min > 0) {
-            mpp_enc_cfg_set_s32(enc->cfg, "rc:qp_min", options->qp_min); /* P、B帧的最小QP值 */
-        }
-        if (options->qp_max > 0) {
-            mpp_enc_cfg_set_s32(enc->cfg, "rc:qp_max", options->qp_max); /* P、B帧的最大QP值 */
-        }
-        if (options->qp_min_i > 0) {
-            mpp_enc_cfg_set_s32(enc->cfg, "rc:qp_min_i", options->qp_min_i); /* I帧的最小QP值 */
-        }
-        if (options->qp_max_i > 0) {
-            mpp_enc_cfg_set_s32(enc->cfg, "rc:qp_max_i", options->qp_max_i); /* I帧的最大QP值 */
-        }
-        if (options->qp_max_step > 0) {
-            mpp_enc_cfg_set_s32(enc->cfg, "rc:qp_max_step", options->qp_max_step);
-        }
-    }
+    set_rate_control_cfg(enc, options);
     mpp_enc_cfg_set_s32(enc->cfg, "codec:type", MPP_VIDEO_CodingAVC); /* 表示MppEncCodecCfg对应的协议类型，需要与MppCtx初始化函数mpp_init的参数一致 */
     // 低延时思路：
     // RTSP 推流链路按 Annex-B 拆 NALU 发包，强制编码器输出 Annex-B，
@@ -416,6 +483,73 @@ int mpp_encoder_request_idr(MppEncoderCtx *enc) {
     return 0;
 }
 
+/**
+ * @description: 在线调整编码参数。分辨率不变时通过 MPP_ENC_SET_CFG 原地更新码率/帧率/GOP/QP，
+ *               不重建上下文和输入缓冲，也不强制 IDR；分辨率变化时才退化为 deinit + init。
+ * @param {MppEncoderCtx *} enc
+ * @param {int} width
+ * @param {int} height
+ * @param {int} fps
+ * @param {int} bitrate
+ * @param {int} gop
+ * @param {const MppEncoderOptions *} options
+ * @return {int} 0 原地生效；1 已重建编码器；-1 失败
+ */
+int mpp_encoder_reconfigure(MppEncoderCtx *enc,
+                            int width,
+                            int height,
+                            int fps,
+                            int bitrate,
+                            int gop,
+                            const MppEncoderOptions *options) {
+    MppEncoderRcSnapshot previous;
+    MPP_RET ret;
+    int old_fps;
+    int old_bitrate;
+    int old_gop;
+
+    if (!enc || !enc->ctx || !enc->mpi || !enc->cfg ||
+        width <= 0 || height <= 0 || fps <= 0 || bitrate <= 0 || gop <= 0) {
+        fprintf(stderr, "[ERROR] invalid encoder reconfigure parameters\n");
+        return -1;
+    }
+
+    // 输入缓冲、MppFrame 和 prep 配置都和分辨率绑定，只能整体重建。
+    if (width != enc->width || height != enc->height) {
+        mpp_encoder_deinit(enc);
+        if (mpp_encoder_init(enc, width, height, fps, bitrate, gop, options) < 0) {
+            return -1;
+        }
+        return 1;
+    }
+
+    old_fps = enc->fps;
+    old_bitrate = enc->bitrate;
+    old_gop = enc->gop;
+    /* QP 键只在取值大于 0 时写入，按旧 options 重写无法撤掉新写进去的键，先整体快照。 */
+    mpp_encoder_snapshot_rc_cfg(enc, &previous);
+    enc->fps = fps;
+    enc->bitrate = bitrate;
+    enc->gop = gop;
+
+    set_rate_control_cfg(enc, options);
+    ret = enc->mpi->control(enc->ctx, MPP_ENC_SET_CFG, enc->cfg);
+    if (ret != MPP_OK) {
+        mpp_log_error("MPP_ENC_SET_CFG (reconfigure) failed", ret);
+        enc->fps = old_fps;
+        enc->bitrate = old_bitrate;
+        enc->gop = old_gop;
+        // 编码器仍按旧参数运行，配置对象里的码控键也要还原，否则下次 SET_CFG 会把失败的值一并带上。
+        restore_rate_control_cfg(enc, &previous);
+        return -1;
+    }
+    if (options) enc->options = *options;
+
+    printf("[INFO] mpp encoder reconfigured in place: %dx%d fps=%d bitrate=%d gop=%d\n",
+           enc->width, enc->height, enc->fps, enc->bitrate, enc->gop);
+    return 0;
+}
+
 /**
  * @description: 释放 MPP 编码器资源
  * @param {MppEncoderCtx *} enc
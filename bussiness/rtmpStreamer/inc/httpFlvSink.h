@@ -0,0 +1,60 @@
+#ifndef __HTTP_FLV_SINK_H__
+#define __HTTP_FLV_SINK_H__
+
+#include <stdint.h>
+
+#include "mediaSink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char *name;          /* sink 名称，用于日志和统计信息。 */
+    const char *listen_ip;     /* HTTP 监听地址，默认 0.0.0.0。 */
+    int listen_port;           /* HTTP 监听端口，默认 8080。 */
+    const char *stream_name;   /* 播放路径 /live/<stream_name>.flv 中的流名。 */
+    int queue_capacity;        /* 编码线程到服务线程之间的帧队列容量。 */
+    int max_clients;           /* 同时服务的最大客户端数，超出时回 503。 */
+    int client_budget_bytes;   /* 单个客户端允许积压的最大字节数（接入时补发的 GOP 缓存不计入），超出视为慢客户端并断开。 */
+    int gop_cache_max_frames;  /* GOP 缓存最多保留的帧数，新客户端从缓存的关键帧开始播放。 */
+    int video_width;           /* onMetaData 中的视频宽度。 */
+    int video_height;          /* onMetaData 中的视频高度。 */
+    int video_fps;             /* onMetaData 中的视频帧率。 */
+    int video_bitrate;         /* onMetaData 中的视频码率。 */
+    const char *encoder_name;  /* onMetaData 中的编码器名称。 */
+} HttpFlvSinkConfig;
+
+typedef struct {
+    int clients;               /* 当前正在播放的客户端数。 */
+    uint64_t accepted;         /* 累计接入的连接数。 */
+    uint64_t rejected;         /* 因客户端数达到上限或请求路径不匹配被拒绝的连接数。 */
+    uint64_t slow_drops;       /* 超出积压预算被断开的客户端数。 */
+    uint64_t frames;           /* 已封装的视频帧数，每帧无论客户端多少只计一次。 */
+    uint64_t bytes_sent;       /* 已写给所有客户端的字节数。 */
+    uint64_t write_calls;      /* 分段聚合写（sendmsg + iovec）调用次数。 */
+} HttpFlvSinkStats;
+
+/**
+ * @description: 创建 HTTP-FLV 输出通道：内置单线程 epoll HTTP 服务，按 /live/<stream>.flv 提供直播流。
+ *               每帧只生成一次 FLV tag，所有客户端共享同一份 tag 字节并以 iovec 分段聚合写出；
+ *               新客户端从内存中缓存的最近一个 GOP 开始播放，积压超过预算的慢客户端会被断开。
+ * @param {MediaSink *} sink 输出通道。
+ * @param {const HttpFlvSinkConfig *} config 配置。
+ * @return {int} 0 成功，-1 失败。
+ */
+int http_flv_sink_setup(MediaSink *sink, const HttpFlvSinkConfig *config);
+
+/**
+ * @description: 获取 HTTP-FLV 输出通道的运行统计。
+ * @param {MediaSink *} sink 由 http_flv_sink_setup 创建的通道。
+ * @param {HttpFlvSinkStats *} stats 输出统计。
+ * @return {int} 0 成功，-1 参数非法。
+ */
+int http_flv_sink_get_stats(MediaSink *sink, HttpFlvSinkStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
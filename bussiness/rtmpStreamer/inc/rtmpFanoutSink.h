@@ -0,0 +1,72 @@
+#ifndef __RTMP_FANOUT_SINK_H__
+#define __RTMP_FANOUT_SINK_H__
+
+#include <stdint.h>
+
+#include "mediaSink.h"
+#include "rtmpSink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 扇出推流最多支持的目的地数量。 */
+#define RTMP_FANOUT_MAX_DESTINATIONS 4
+
+typedef struct {
+    int connected;              /* 当前是否已完成 publish。 */
+    int waiting_for_keyframe;   /* 是否在等待关键帧恢复发送。 */
+    int queue_depth;            /* 当前排队帧数。 */
+    int backoff_ms;             /* 下一次重连失败后的等待间隔。 */
+    uint64_t sent_frames;       /* 已发送的视频帧数。 */
+    uint64_t dropped_frames;    /* 队列满、等待关键帧或退避期间丢弃的帧数。 */
+    uint64_t connect_attempts;  /* 发起连接的次数。 */
+    uint64_t connect_failures;  /* 连接失败次数。 */
+    uint64_t send_failures;     /* 发送失败（含发送超时）次数。 */
+} RtmpFanoutDestinationStats;
+
+/**
+ * @description: 统计推流地址列表中的地址个数，地址以逗号分隔，忽略空项和首尾空白。
+ * @param {const char *} urls 推流地址列表。
+ * @return {int} 地址个数。
+ */
+int rtmp_fanout_url_count(const char *urls);
+
+/**
+ * @description: 创建多目的地 RTMP 推流通道：每帧只拆分一次 Annex-B 并生成一次 FLV 视频消息分段，
+ *               再把同一份帧引用投递给各目的地；每个目的地有独立的连接、发送线程、队列和重连退避，
+ *               某个目的地阻塞或断线不会拖慢其他目的地。
+ * @param {MediaSink *} sink 输出通道。
+ * @param {const RtmpSinkConfig *} config publish_url 为逗号分隔的地址列表，其余字段对所有目的地生效。
+ * @return {int} 0 成功，-1 失败。
+ */
+int rtmp_fanout_sink_setup(MediaSink *sink, const RtmpSinkConfig *config);
+
+/**
+ * @description: 查询扇出推流通道的目的地数量。
+ * @param {MediaSink *} sink 由 rtmp_fanout_sink_setup 创建的通道。
+ * @return {int} 目的地数量。
+ */
+int rtmp_fanout_sink_destination_count(MediaSink *sink);
+
+/**
+ * @description: 获取单个目的地的运行统计。
+ * @param {MediaSink *} sink 由 rtmp_fanout_sink_setup 创建的通道。
+ * @param {int} index 目的地下标。
+ * @param {RtmpFanoutDestinationStats *} stats 输出统计。
+ * @return {int} 0 成功，-1 下标越界。
+ */
+int rtmp_fanout_sink_get_destination_stats(MediaSink *sink, int index, RtmpFanoutDestinationStats *stats);
+
+/**
+ * @description: 获取已封装的帧数，每帧无论目的地多少只计一次。
+ * @param {MediaSink *} sink 由 rtmp_fanout_sink_setup 创建的通道。
+ * @return {uint64_t} 封装帧数。
+ */
+uint64_t rtmp_fanout_sink_packetized_frames(MediaSink *sink);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef __RTMP_FLV_H__
+#define __RTMP_FLV_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "mediaPacket.h"
+#include "rtmpSink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLV_VIDEO_CODEC_AVC 7
+#define FLV_FRAME_KEY 1
+#define FLV_FRAME_INTER 2
+#define FLV_AVC_SEQ_HEADER 0
+#define FLV_AVC_NALU 1
+
+/* 单帧最多处理的 NALU 数。 */
+#define RTMP_FLV_MAX_NALUS 64
+/* 视频消息负载分段上限：tag 头 + 长度前缀/NALU 交替。 */
+#define RTMP_FLV_MAX_IOV (RTMP_FLV_MAX_NALUS * 2 + 1)
+/* onMetaData 消息体缓冲大小。 */
+#define RTMP_FLV_METADATA_MAX 512
+
+/* 去掉 Annex-B 起始码后的单个 NALU 负载视图，与共享拆分器的视图同构，不拥有底层内存。 */
+typedef MediaNaluView RtmpNaluView;
+
+typedef struct {
+    uint8_t *sps;   /* 缓存的 SPS 数据，用于 sequence header 和重连恢复。 */
+    size_t sps_len; /* SPS 数据长度。 */
+    uint8_t *pps;   /* 缓存的 PPS 数据，用于 sequence header 和重连恢复。 */
+    size_t pps_len; /* PPS 数据长度。 */
+} RtmpAvcParamSets;
+
+/**
+ * @description: 将 Annex-B 码流拆分为多个 NALU 视图，不拷贝负载；拆分走 media_annexb_split。
+ * @param {const uint8_t *} data 一帧 Annex-B 数据。
+ * @param {size_t} len 数据长度。
+ * @param {RtmpNaluView *} nalus 调用方提供的视图数组。
+ * @param {size_t} capacity 视图数组容量。
+ * @param {size_t *} out_count 输出 NALU 数。
+ * @return {int} 0 成功，-1 参数非法或 NALU 过多。
+ */
+int rtmp_flv_split_annexb(const uint8_t *data, size_t len, RtmpNaluView *nalus, size_t capacity, size_t *out_count);
+
+/**
+ * @description: 从 NALU 列表中缓存 SPS/PPS，只有内容变化时才刷新。
+ * @param {RtmpAvcParamSets *} sets 参数集缓存。
+ * @param {const RtmpNaluView *} nalus NALU 视图。
+ * @param {size_t} count NALU 数。
+ * @param {int *} changed 输出是否有参数集变化，可为 NULL。
+ * @return {int} 0 成功，-1 内存不足。
+ */
+int rtmp_flv_cache_parameter_sets(RtmpAvcParamSets *sets, const RtmpNaluView *nalus, size_t count, int *changed);
+
+/**
+ * @description: 释放缓存的 SPS/PPS。
+ * @param {RtmpAvcParamSets *} sets 参数集缓存。
+ * @return {void}
+ */
+void rtmp_flv_free_parameter_sets(RtmpAvcParamSets *sets);
+
+/**
+ * @description: 按 sink 配置生成 AMF0 onMetaData 消息体。
+ * @param {uint8_t *} body 输出缓冲，至少 RTMP_FLV_METADATA_MAX 字节。
+ * @param {const RtmpSinkConfig *} config 元数据来源。
+ * @return {size_t} 消息体长度。
+ */
+size_t rtmp_flv_build_metadata(uint8_t *body, const RtmpSinkConfig *config);
+
+/**
+ * @description: 生成 AVC sequence header 的负载分段，SPS/PPS 直接引用缓存。
+ * @param {const RtmpAvcParamSets *} sets 参数集缓存。
+ * @param {uint8_t *} header 调用方提供的 13 字节头部缓冲。
+ * @param {uint8_t *} pps_header 调用方提供的 3 字节 PPS 头缓冲。
+ * @param {struct iovec *} iov 输出 4 个分段。
+ * @return {int} 0 成功，-1 SPS/PPS 未就绪。
+ */
+int rtmp_flv_build_sequence_header(const RtmpAvcParamSets *sets, uint8_t *header, uint8_t *pps_header, struct iovec *iov);
+
+/**
+ * @description: 生成 AVC 视频消息的负载分段：5 字节 tag 头 + 每个媒体 NALU 的 [4 字节长度][NALU]。
+ *               SPS/PPS/AUD 已在 sequence header 中发送，这里跳过；NALU 负载直接引用原始缓冲。
+ * @param {const RtmpNaluView *} nalus NALU 视图。
+ * @param {size_t} count NALU 数。
+ * @param {int} is_key_frame 是否关键帧。
+ * @param {uint8_t *} tag_header 调用方提供的 5 字节 tag 头缓冲。
+ * @param {uint8_t (*)[4]} prefix 调用方提供的长度前缀数组，至少 count 项。
+ * @param {struct iovec *} iov 输出分段，至少 count * 2 + 1 项。
+ * @return {int} 分段数，1 表示没有需要发送的媒体 NALU。
+ */
+int rtmp_flv_build_avc_payload(const RtmpNaluView *nalus,
+                               size_t count,
+                               int is_key_frame,
+                               uint8_t *tag_header,
+                               uint8_t (*prefix)[4],
+                               struct iovec *iov);
+
+/**
+ * @description: 将媒体包时间戳转换为 RTMP 毫秒时间戳，优先使用 DTS。
+ * @param {const MediaPacket *} packet 媒体包。
+ * @return {uint32_t} 毫秒时间戳。
+ */
+uint32_t rtmp_flv_packet_timestamp_ms(const MediaPacket *packet);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
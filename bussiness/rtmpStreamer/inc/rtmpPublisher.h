@@ -0,0 +1,155 @@
+#ifndef __RTMP_PUBLISHER_H__
+#define __RTMP_PUBLISHER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* RTMP 消息类型。 */
+#define RTMP_MSG_SET_CHUNK_SIZE 1
+#define RTMP_MSG_ABORT 2
+#define RTMP_MSG_ACK 3
+#define RTMP_MSG_USER_CONTROL 4
+#define RTMP_MSG_WINDOW_ACK_SIZE 5
+#define RTMP_MSG_SET_PEER_BANDWIDTH 6
+#define RTMP_MSG_AUDIO 8
+#define RTMP_MSG_VIDEO 9
+#define RTMP_MSG_DATA_AMF0 18
+#define RTMP_MSG_COMMAND_AMF0 20
+
+/* AMF0 类型标记。 */
+#define RTMP_AMF0_NUMBER 0x00
+#define RTMP_AMF0_BOOLEAN 0x01
+#define RTMP_AMF0_STRING 0x02
+#define RTMP_AMF0_OBJECT 0x03
+#define RTMP_AMF0_NULL 0x05
+#define RTMP_AMF0_UNDEFINED 0x06
+#define RTMP_AMF0_ECMA_ARRAY 0x08
+#define RTMP_AMF0_OBJECT_END 0x09
+#define RTMP_AMF0_STRICT_ARRAY 0x0A
+
+/* 同时跟踪的对端 chunk stream 数，推流端只会收到控制和命令消息，少量即可。 */
+#define RTMP_PUBLISHER_MAX_IN_STREAMS 8
+/* 对端单条消息的长度上限，超过视为协议错误。 */
+#define RTMP_PUBLISHER_MAX_IN_MESSAGE (64 * 1024)
+
+typedef struct {
+    int csid;                        /* chunk stream id，0 表示空闲。 */
+    uint32_t timestamp;              /* 当前消息时间戳（fmt 1/2 为增量累加后的值）。 */
+    uint32_t timestamp_delta;        /* 最近一次的时间戳增量，fmt 3 新消息沿用。 */
+    uint32_t length;                 /* 当前消息长度。 */
+    uint8_t type;                    /* 当前消息类型。 */
+    uint32_t stream_id;              /* 当前消息流 ID。 */
+    int extended_timestamp;          /* 当前消息是否带扩展时间戳。 */
+    uint8_t *body;                   /* 消息体拼装缓冲。 */
+    uint32_t received;               /* 已收到的消息体字节数。 */
+} RtmpInChunkStream;
+
+/*
+ * 原生 RTMP 推流客户端：非阻塞 socket，握手和 connect/createStream/publish 受连接超时约束，
+ * 发送时把 chunk 头和调用方给出的负载分段交错成 iovec 一次 sendmsg 发出（等价 writev，但可带 MSG_NOSIGNAL），负载本身不拷贝；
+ * 每条消息有独立的发送截止时间，对端停止读取时按时返回失败而不是无限阻塞。
+ */
+typedef struct {
+    int fd;                          /* TCP socket，-1 表示未连接。 */
+    char host[128];                  /* 服务器地址。 */
+    int port;                        /* 服务器端口。 */
+    char app[128];                   /* 应用名，例如 live。 */
+    char stream[256];                /* 流名（含查询参数）。 */
+    char tc_url[512];                /* connect 命令里的 tcUrl。 */
+    int out_chunk_size;              /* 发送方向 chunk 大小，连接后通过 Set Chunk Size 通告。 */
+    int in_chunk_size;               /* 接收方向 chunk 大小，随对端 Set Chunk Size 更新。 */
+    int send_timeout_ms;             /* 单条消息的发送截止时间。 */
+    uint32_t stream_id;              /* createStream 返回的消息流 ID。 */
+    int published;                   /* 是否已收到 NetStream.Publish.Start。 */
+    double last_transaction;         /* 最近一次命令的事务号。 */
+    uint8_t *recv_buf;               /* 接收原始字节缓冲。 */
+    size_t recv_len;                 /* recv_buf 中未解析的字节数。 */
+    size_t recv_cap;                 /* recv_buf 容量。 */
+    RtmpInChunkStream in[RTMP_PUBLISHER_MAX_IN_STREAMS]; /* 对端 chunk stream 状态。 */
+    uint32_t window_ack_size;        /* 对端要求的确认窗口，0 表示不回确认。 */
+    uint64_t bytes_received;         /* 累计收到的字节数。 */
+    uint64_t bytes_acked;            /* 最近一次确认时的 bytes_received。 */
+    const uint8_t *msg_body;         /* 最近收齐的一条命令/数据消息体，下次读取前有效。 */
+    uint32_t msg_len;                /* msg_body 长度。 */
+    uint8_t msg_type;                /* msg_body 的消息类型。 */
+    struct iovec *iov;               /* 聚合发送的分段表，按需增长后常驻。 */
+    int iov_cap;                     /* iov 容量。 */
+    uint8_t *chunk_headers;          /* 本条消息的全部 chunk 头，按需增长后常驻。 */
+    size_t chunk_headers_cap;        /* chunk_headers 容量。 */
+    uint64_t messages_sent;          /* 已发送的消息数。 */
+    uint64_t bytes_sent;             /* 已发送的字节数（含 chunk 头）。 */
+    uint64_t send_calls;             /* 聚合发送（sendmsg）调用次数。 */
+    uint64_t send_waits;             /* 发送缓冲满、等待可写的次数。 */
+    uint64_t send_timeouts;          /* 超过发送截止时间的次数。 */
+} RtmpPublisher;
+
+/**
+ * @description: 初始化推流客户端，不建立连接。
+ * @param {RtmpPublisher *} pub 客户端。
+ * @param {int} chunk_size 发送方向 chunk 大小，<=0 用默认 4096。
+ * @param {int} send_timeout_ms 单条消息发送截止时间，<=0 用默认 2000。
+ * @return {void}
+ */
+void rtmp_publisher_init(RtmpPublisher *pub, int chunk_size, int send_timeout_ms);
+
+/**
+ * @description: 解析 rtmp://host[:port]/app/stream 形式的推流地址。
+ * @param {RtmpPublisher *} pub 客户端，结果写入 host/port/app/stream/tc_url。
+ * @param {const char *} url 推流地址。
+ * @return {int} 0 成功，-1 地址非法。
+ */
+int rtmp_publisher_parse_url(RtmpPublisher *pub, const char *url);
+
+/**
+ * @description: 连接服务器并完成握手、connect、createStream、publish，全程不超过 timeout_ms。
+ * @param {RtmpPublisher *} pub 客户端。
+ * @param {const char *} url 推流地址。
+ * @param {int} timeout_ms 总超时。
+ * @return {int} 0 可以推流，-1 失败（连接已关闭）。
+ */
+int rtmp_publisher_connect(RtmpPublisher *pub, const char *url, int timeout_ms);
+
+/**
+ * @description: 发送一条消息：按 out_chunk_size 切 chunk，头部与负载分段交错后聚合发出。
+ *               发送前顺带处理对端的控制消息（Set Chunk Size、Ping、确认窗口）。
+ * @param {RtmpPublisher *} pub 客户端，已 publish。
+ * @param {uint8_t} type 消息类型 RTMP_MSG_*。
+ * @param {uint32_t} timestamp_ms 消息时间戳。
+ * @param {const struct iovec *} payload 负载分段，发送期间保持有效。
+ * @param {int} iov_count 负载分段数。
+ * @return {int} 0 成功，-1 发送失败或超过截止时间（连接需重建）。
+ */
+int rtmp_publisher_send(RtmpPublisher *pub, uint8_t type, uint32_t timestamp_ms, const struct iovec *payload, int iov_count);
+
+/**
+ * @description: 关闭连接，保留常驻缓冲以便重连复用。
+ * @param {RtmpPublisher *} pub 客户端。
+ * @return {void}
+ */
+void rtmp_publisher_close(RtmpPublisher *pub);
+
+/**
+ * @description: 关闭连接并释放全部缓冲。
+ * @param {RtmpPublisher *} pub 客户端。
+ * @return {void}
+ */
+void rtmp_publisher_deinit(RtmpPublisher *pub);
+
+/* AMF0 写入工具，返回写入后的位置；调用方保证缓冲足够。 */
+uint8_t *rtmp_amf_write_number(uint8_t *dst, double value);
+uint8_t *rtmp_amf_write_bool(uint8_t *dst, int value);
+uint8_t *rtmp_amf_write_string(uint8_t *dst, const char *str);
+uint8_t *rtmp_amf_write_null(uint8_t *dst);
+uint8_t *rtmp_amf_write_key(uint8_t *dst, const char *name);
+uint8_t *rtmp_amf_write_object_end(uint8_t *dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -9,10 +9,13 @@ extern "C" {
 
 typedef struct {
     const char *name;          /* sink 名称，用于日志和统计信息。 */
-    const char *publish_url;   /* RTMP 推流地址，例如 rtmp://host/app/stream。 */
-    int queue_capacity;        /* 该 sink 独立的发送队列容量。 */
+    const char *publish_url;   /* RTMP 推流地址，例如 rtmp://host/app/stream；多个地址以逗号分隔时走扇出推流。 */
+    int queue_capacity;        /* 该 sink 独立的发送队列容量；扇出推流时为每个目的地的队列容量。 */
     int reconnect_interval_ms; /* 连接失败后的重连间隔，单位毫秒。 */
+    int max_reconnect_interval_ms; /* 扇出推流时单个目的地连续失败后重连间隔倍增的上限，单位毫秒。 */
     int connect_timeout_ms;    /* 建立 RTMP 连接的超时时间，单位毫秒。 */
+    int chunk_size;            /* 发送方向 RTMP chunk 大小，越大每帧 chunk 头越少。 */
+    int send_timeout_ms;       /* 单条 RTMP 消息的发送截止时间，超时视为链路阻塞并触发重连。 */
     int audio_enabled;         /* 音频通路预留开关，当前主要用于元数据描述。 */
     int video_width;           /* 元数据中的视频宽度。 */
     int video_height;          /* 元数据中的视频高度。 */
@@ -0,0 +1,1345 @@
+#define _GNU_SOURCE
+#include "httpFlvSink.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rtmpFlv.h"
+
+#define DEFAULT_HTTP_FLV_NAME "http-flv"
+#define DEFAULT_HTTP_FLV_LISTEN_IP "0.0.0.0"
+#define DEFAULT_HTTP_FLV_PORT 8080
+#define DEFAULT_HTTP_FLV_STREAM_NAME "main"
+#define DEFAULT_HTTP_FLV_QUEUE_CAPACITY 64
+#define DEFAULT_HTTP_FLV_MAX_CLIENTS 32
+#define DEFAULT_HTTP_FLV_CLIENT_BUDGET_BYTES (4 * 1024 * 1024)
+#define DEFAULT_HTTP_FLV_GOP_CACHE_MAX_FRAMES 300
+#define DEFAULT_HTTP_FLV_RECONNECT_INTERVAL_MS 1000
+#define HTTP_FLV_PENDING_CONNECTIONS 16
+#define HTTP_FLV_REQUEST_MAX 2048
+#define HTTP_FLV_REQUEST_TIMEOUT_MS 5000
+#define HTTP_FLV_CLIENT_QUEUE_MAX 1024
+#define HTTP_FLV_WRITE_MAX_IOV 1024
+#define HTTP_FLV_EPOLL_EVENTS 64
+#define HTTP_FLV_EPOLL_TIMEOUT_MS 1000
+#define HTTP_FLV_PATH_MAX 256
+#define HTTP_FLV_PREAMBLE_MAX 1024
+#define HTTP_FLV_STATS_INTERVAL_FRAMES 900
+#define FLV_TAG_TYPE_VIDEO 9
+#define FLV_TAG_TYPE_SCRIPT 18
+#define FLV_TAG_HEADER_SIZE 11
+
+static const char HTTP_FLV_RESPONSE_HEADER[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: video/x-flv\r\n"
+    "Connection: close\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "\r\n";
+static const char HTTP_FLV_RESPONSE_400[] =
+    "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+static const char HTTP_FLV_RESPONSE_404[] =
+    "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+static const char HTTP_FLV_RESPONSE_503[] =
+    "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+/* 一个完整的 FLV tag（tag 头 + 数据 + PreviousTagSize），由所有客户端共享，只在服务线程里增减引用。 */
+typedef struct {
+    int ref_count;                 /* 引用数：GOP 缓存和各客户端发送队列各持一份。 */
+    int is_sequence_header;        /* 是否 AVC sequence header。 */
+    int is_key_frame;              /* 是否关键帧。 */
+    MediaPacket packet;            /* 视频帧的原始帧引用，NALU 分段直接指向它的 buffer。 */
+    uint8_t *owned;                /* sequence header 自有的整块 tag 字节。 */
+    size_t size;                   /* tag 总字节数。 */
+    uint8_t header[FLV_TAG_HEADER_SIZE]; /* FLV tag 头。 */
+    uint8_t tag_header[5];         /* AVC 视频 tag 头。 */
+    uint8_t nalu_prefix[RTMP_FLV_MAX_NALUS][4]; /* 每个 NALU 的 4 字节长度前缀。 */
+    uint8_t trailer[4];            /* PreviousTagSize。 */
+    struct iovec iov[RTMP_FLV_MAX_IOV + 2]; /* tag 分段：tag 头、视频负载分段、PreviousTagSize。 */
+    int iov_count;                 /* iov 有效分段数。 */
+} HttpFlvTag;
+
+typedef struct {
+    int fd;                        /* 客户端连接。 */
+    int closed;                    /* 已关闭，等本轮事件处理完再回收。 */
+    int streaming;                 /* 已通过请求校验，正在播放。 */
+    int close_after_reply;         /* 错误响应写完后关闭。 */
+    int want_write;                /* 是否已注册 EPOLLOUT。 */
+    int waiting_for_keyframe;      /* 没拿到 GOP 缓存的新客户端要等下一个关键帧。 */
+    long long accepted_ms;         /* 接入时间，用于请求超时。 */
+    char request[HTTP_FLV_REQUEST_MAX]; /* 已读到的请求头。 */
+    size_t request_len;            /* 请求头长度。 */
+    const uint8_t *reply;          /* 待写的响应头/FLV 文件头，或错误响应。 */
+    size_t reply_len;              /* reply 长度。 */
+    size_t reply_offset;           /* reply 已写字节数。 */
+    HttpFlvTag *queue[HTTP_FLV_CLIENT_QUEUE_MAX]; /* 待写 tag 的环形队列。 */
+    int queue_head;                /* 队头下标。 */
+    int queue_size;                /* 队列有效元素数。 */
+    size_t tag_offset;             /* 队头 tag 已写字节数。 */
+    size_t pending_bytes;          /* 尚未写出的字节数，超过预算即为慢客户端。 */
+    size_t burst_bytes;            /* pending_bytes 中接入时补发（文件头、sequence header、GOP 缓存）还没写完的部分，不计入预算。 */
+} HttpFlvClient;
+
+typedef struct {
+    HttpFlvSinkConfig config;      /* 配置副本。 */
+    char path[HTTP_FLV_PATH_MAX];  /* 播放路径 /live/<stream>.flv。 */
+    uint8_t preamble[HTTP_FLV_PREAMBLE_MAX]; /* HTTP 响应头 + FLV 文件头 + onMetaData tag，setup 时生成后只读。 */
+    size_t preamble_len;           /* preamble 长度。 */
+    int listen_fd;                 /* 监听 socket。 */
+    int event_fd;                  /* 封装线程投递新 tag 后唤醒服务线程。 */
+    int epoll_fd;                  /* 服务线程的 epoll。 */
+    pthread_t thread;              /* 服务线程。 */
+    int running;                   /* 服务线程是否已启动。 */
+    volatile int stop_requested;   /* 是否已请求服务线程退出。 */
+    pthread_mutex_t lock;          /* 保护 inbox 和 stats。 */
+    HttpFlvTag **inbox;            /* 封装线程到服务线程的 tag 环形队列。 */
+    int inbox_capacity;            /* inbox 容量。 */
+    int inbox_head;                /* inbox 队头下标。 */
+    int inbox_size;                /* inbox 有效元素数。 */
+    HttpFlvSinkStats stats;        /* 对外统计。 */
+    /* 以下字段只在封装线程（MediaSink 发送线程）使用。 */
+    RtmpAvcParamSets params;       /* 缓存的 SPS/PPS。 */
+    int sequence_dirty;            /* SPS/PPS 变化后尚未投递新的 sequence header。 */
+    int need_keyframe;             /* inbox 满丢帧后，直到下一个关键帧前不再投递。 */
+    RtmpNaluView nalus[RTMP_FLV_MAX_NALUS]; /* 当前帧的 NALU 视图。 */
+    uint64_t inbox_drops;          /* inbox 满导致丢弃的帧数，受 lock 保护。 */
+    /* 以下字段只在服务线程使用。 */
+    HttpFlvClient **clients;       /* 所有连接，含尚未发完请求的连接。 */
+    int client_capacity;           /* clients 容量。 */
+    int client_count;              /* 连接数。 */
+    int streaming_clients;         /* 正在播放的客户端数。 */
+    HttpFlvTag *sequence_header;   /* 当前 sequence header。 */
+    HttpFlvTag **gop;              /* 从最近关键帧开始的 tag 缓存。 */
+    int gop_size;                  /* GOP 缓存帧数。 */
+    uint64_t served_frames;        /* 服务线程已分发的视频帧数。 */
+    uint64_t bytes_sent;           /* 累计写出字节数。 */
+    uint64_t write_calls;          /* 累计聚合写调用次数。 */
+} HttpFlvImpl;
+
+/**
+ * @description: 获取单调时钟毫秒数
+ * @return {static long long}
+ */
+static long long http_flv_now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+/**
+ * @description: 按大端写入 32 位整数
+ * @param {uint8_t *} p
+ * @param {uint32_t} value
+ * @return {static void}
+ */
+static void http_flv_write_be32(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+}
+
+/**
+ * @description: 写 11 字节 FLV tag 头
+ * @param {uint8_t *} header
+ * @param {uint8_t} type tag 类型
+ * @param {size_t} data_size tag 数据长度
+ * @param {uint32_t} timestamp_ms 毫秒时间戳
+ * @return {static void}
+ */
+static void http_flv_write_tag_header(uint8_t *header, uint8_t type, size_t data_size, uint32_t timestamp_ms) {
+    header[0] = type;
+    header[1] = (uint8_t)(data_size >> 16);
+    header[2] = (uint8_t)(data_size >> 8);
+    header[3] = (uint8_t)data_size;
+    /* 低 24 位在前，高 8 位放扩展时间戳字节。 */
+    header[4] = (uint8_t)(timestamp_ms >> 16);
+    header[5] = (uint8_t)(timestamp_ms >> 8);
+    header[6] = (uint8_t)timestamp_ms;
+    header[7] = (uint8_t)(timestamp_ms >> 24);
+    header[8] = 0;
+    header[9] = 0;
+    header[10] = 0;
+}
+
+/**
+ * @description: 释放一个 tag 引用
+ * @param {HttpFlvTag *} tag
+ * @return {static void}
+ */
+static void http_flv_tag_release(HttpFlvTag *tag) {
+    if (!tag) {
+        return;
+    }
+    tag->ref_count--;
+    if (tag->ref_count > 0) {
+        return;
+    }
+    media_packet_reset(&tag->packet);
+    free(tag->owned);
+    free(tag);
+}
+
+/**
+ * @description: 按当前 SPS/PPS 生成 sequence header tag，字节整块拷贝，不再引用参数集缓存
+ * @param {HttpFlvImpl *} impl
+ * @param {uint32_t} timestamp_ms
+ * @param {HttpFlvTag **} out_tag SPS/PPS 未就绪时输出 NULL
+ * @return {static int} 0 成功或未就绪，-1 内存不足
+ */
+static int http_flv_make_sequence_tag(HttpFlvImpl *impl, uint32_t timestamp_ms, HttpFlvTag **out_tag) {
+    uint8_t header[13];
+    uint8_t pps_header[3];
+    struct iovec iov[4];
+    HttpFlvTag *tag;
+    size_t data_size = 0;
+    size_t offset;
+    int i;
+
+    *out_tag = NULL;
+    if (rtmp_flv_build_sequence_header(&impl->params, header, pps_header, iov) != 0) {
+        return 0;
+    }
+    for (i = 0; i < 4; ++i) {
+        data_size += iov[i].iov_len;
+    }
+    tag = (HttpFlvTag *)calloc(1, sizeof(*tag));
+    if (!tag) {
+        return -1;
+    }
+    tag->size = FLV_TAG_HEADER_SIZE + data_size + 4;
+    tag->owned = (uint8_t *)malloc(tag->size);
+    if (!tag->owned) {
+        free(tag);
+        return -1;
+    }
+    media_packet_init(&tag->packet);
+    http_flv_write_tag_header(tag->owned, FLV_TAG_TYPE_VIDEO, data_size, timestamp_ms);
+    offset = FLV_TAG_HEADER_SIZE;
+    for (i = 0; i < 4; ++i) {
+        memcpy(tag->owned + offset, iov[i].iov_base, iov[i].iov_len);
+        offset += iov[i].iov_len;
+    }
+    http_flv_write_be32(tag->owned + offset, (uint32_t)(FLV_TAG_HEADER_SIZE + data_size));
+    tag->iov[0].iov_base = tag->owned;
+    tag->iov[0].iov_len = tag->size;
+    tag->iov_count = 1;
+    tag->ref_count = 1;
+    tag->is_sequence_header = 1;
+    tag->is_key_frame = 1;
+    *out_tag = tag;
+    return 0;
+}
+
+/**
+ * @description: 把一帧封装为共享的视频 tag，NALU 负载直接引用原始帧
+ * @param {HttpFlvImpl *} impl
+ * @param {const MediaPacket *} packet
+ * @param {size_t} nalu_count
+ * @param {HttpFlvTag **} out_tag 没有媒体 NALU 时输出 NULL
+ * @return {static int} 0 成功，-1 内存不足
+ */
+static int http_flv_make_video_tag(HttpFlvImpl *impl, const MediaPacket *packet, size_t nalu_count, HttpFlvTag **out_tag) {
+    HttpFlvTag *tag;
+    size_t data_size = 0;
+    int payload_count;
+    int i;
+
+    *out_tag = NULL;
+    tag = (HttpFlvTag *)calloc(1, sizeof(*tag));
+    if (!tag) {
+        return -1;
+    }
+    payload_count = rtmp_flv_build_avc_payload(impl->nalus,
+                                               nalu_count,
+                                               packet->is_key_frame,
+                                               tag->tag_header,
+                                               tag->nalu_prefix,
+                                               &tag->iov[1]);
+    if (payload_count <= 1) {
+        free(tag);
+        return 0;
+    }
+    for (i = 1; i <= payload_count; ++i) {
+        data_size += tag->iov[i].iov_len;
+    }
+    http_flv_write_tag_header(tag->header, FLV_TAG_TYPE_VIDEO, data_size, rtmp_flv_packet_timestamp_ms(packet));
+    http_flv_write_be32(tag->trailer, (uint32_t)(FLV_TAG_HEADER_SIZE + data_size));
+    tag->iov[0].iov_base = tag->header;
+    tag->iov[0].iov_len = FLV_TAG_HEADER_SIZE;
+    tag->iov[payload_count + 1].iov_base = tag->trailer;
+    tag->iov[payload_count + 1].iov_len = sizeof(tag->trailer);
+    tag->iov_count = payload_count + 2;
+    tag->size = FLV_TAG_HEADER_SIZE + data_size + sizeof(tag->trailer);
+    tag->ref_count = 1;
+    tag->is_key_frame = packet->is_key_frame;
+    media_packet_init(&tag->packet);
+    media_packet_copy_ref(&tag->packet, packet);
+    *out_tag = tag;
+    return 0;
+}
+
+/**
+ * @description: 把 tag 投递给服务线程
+ * @param {HttpFlvImpl *} impl
+ * @param {HttpFlvTag *} tag 成功时引用转交给服务线程
+ * @return {static int} 0 成功，-1 inbox 已满
+ */
+static int http_flv_post(HttpFlvImpl *impl, HttpFlvTag *tag) {
+    uint64_t one = 1;
+    int tail;
+
+    pthread_mutex_lock(&impl->lock);
+    if (impl->inbox_size >= impl->inbox_capacity) {
+        pthread_mutex_unlock(&impl->lock);
+        return -1;
+    }
+    tail = (impl->inbox_head + impl->inbox_size) % impl->inbox_capacity;
+    impl->inbox[tail] = tag;
+    impl->inbox_size++;
+    pthread_mutex_unlock(&impl->lock);
+
+    if (write(impl->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        fprintf(stderr, "[HTTP-FLV][ERROR] eventfd write failed errno=%d\n", errno);
+    }
+    return 0;
+}
+
+/**
+ * @description: 取出 inbox 队头的 tag
+ * @param {HttpFlvImpl *} impl
+ * @return {static HttpFlvTag *}
+ */
+static HttpFlvTag *http_flv_inbox_pop(HttpFlvImpl *impl) {
+    HttpFlvTag *tag = NULL;
+
+    pthread_mutex_lock(&impl->lock);
+    if (impl->inbox_size > 0) {
+        tag = impl->inbox[impl->inbox_head];
+        impl->inbox[impl->inbox_head] = NULL;
+        impl->inbox_head = (impl->inbox_head + 1) % impl->inbox_capacity;
+        impl->inbox_size--;
+    }
+    pthread_mutex_unlock(&impl->lock);
+    return tag;
+}
+
+/**
+ * @description: 更新 epoll 关注的事件
+ * @param {HttpFlvImpl *} impl
+ * @param {HttpFlvClient *} client
+ * @param {int} want_write 是否关注可写
+ * @return {static void}
+ */
+static void http_flv_client_watch(HttpFlvImpl *impl, HttpFlvClient *client, int want_write) {
+    struct epoll_event ev;
+
+    if (client->want_write == want_write) {
+        return;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLRDHUP | (want_write ? EPOLLOUT : 0);
+    ev.data.ptr = client;
+    epoll_ctl(impl->epoll_fd, EPOLL_CTL_MOD, client->fd, &ev);
+    client->want_write = want_write;
+}
+
+/**
+ * @description: 关闭客户端并释放它持有的 tag 引用，内存等本轮事件处理完再回收
+ * @param {HttpFlvImpl *} impl
+ * @param {HttpFlvClient *} client
+ * @param {const char *} reason 日志中的关闭原因
+ * @return {static void}
+ */
+static void http_flv_client_close(HttpFlvImpl *impl, HttpFlvClient *client, const char *reason) {
+    if (client->closed) {
+        return;
+    }
+    if (client->streaming) {
+        impl->streaming_clients--;
+        printf("[HTTP-FLV] event=client_closed fd=%d reason=%s pending=%zu clients=%d\n",
+               client->fd,
+               reason,
+               client->pending_bytes,
+               impl->streaming_clients);
+    }
+    epoll_ctl(impl->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    client->fd = -1;
+    client->closed = 1;
+    while (client->queue_size > 0) {
+        http_flv_tag_release(client->queue[client->queue_head]);
+        client->queue[client->queue_head] = NULL;
+        client->queue_head = (client->queue_head + 1) % HTTP_FLV_CLIENT_QUEUE_MAX;
+        client->queue_size--;
+    }
+    client->pending_bytes = 0;
+    client->burst_bytes = 0;
+}
+
+/**
+ * @description: 回收已关闭的客户端
+ * @param {HttpFlvImpl *} impl
+ * @return {static void}
+ */
+static void http_flv_reap_clients(HttpFlvImpl *impl) {
+    int i = 0;
+
+    while (i < impl->client_count) {
+        if (!impl->clients[i]->closed) {
+            i++;
+            continue;
+        }
+        free(impl->clients[i]);
+        impl->clients[i] = impl->clients[impl->client_count - 1];
+        impl->clients[impl->client_count - 1] = NULL;
+        impl->client_count--;
+    }
+}
+
+/**
+ * @description: 把已写出的字节从 reply 和 tag 队列中扣除
+ * @param {HttpFlvClient *} client
+ * @param {size_t} written
+ * @return {static void}
+ */
+static void http_flv_client_consume(HttpFlvClient *client, size_t written) {
+    client->pending_bytes -= written;
+    /* 补发数据排在队列最前面，先写出的字节总是先从补发部分扣。 */
+    client->burst_bytes -= (written < client->burst_bytes) ? written : client->burst_bytes;
+    if (client->reply_offset < client->reply_len) {
+        size_t left = client->reply_len - client->reply_offset;
+        size_t step = written < left ? written : left;
+        client->reply_offset += step;
+        written -= step;
+    }
+    while (written > 0 && client->queue_size > 0) {
+        HttpFlvTag *tag = client->queue[client->queue_head];
+        size_t left = tag->size - client->tag_offset;
+
+        if (written < left) {
+            client->tag_offset += written;
+            return;
+        }
+        written -= left;
+        client->tag_offset = 0;
+        client->queue[client->queue_head] = NULL;
+        client->queue_head = (client->queue_head + 1) % HTTP_FLV_CLIENT_QUEUE_MAX;
+        client->queue_size--;
+        http_flv_tag_release(tag);
+    }
+}
+
+/**
+ * @description: 尽量把客户端积压的数据写进 socket，写不动时注册 EPOLLOUT 等待
+ * @param {HttpFlvImpl *} impl
+ * @param {HttpFlvClient *} client
+ * @return {static int} 0 成功，-1 连接已关闭
+ */
+static int http_flv_client_flush(HttpFlvImpl *impl, HttpFlvClient *client) {
+    struct iovec iov[HTTP_FLV_WRITE_MAX_IOV];
+    struct msghdr msg;
+
+    while (client->pending_bytes > 0) {
+        size_t skip = client->tag_offset;
+        size_t total = 0;
+        ssize_t written;
+        int n = 0;
+        int i;
+
+        if (client->reply_offset < client->reply_len) {
+            iov[n].iov_base = (void *)(client->reply + client->reply_offset);
+            iov[n].iov_len = client->reply_len - client->reply_offset;
+            total += iov[n].iov_len;
+            n++;
+        }
+        /* 直接拿共享 tag 的分段拼 iovec，队头 tag 跳过已写部分。 */
+        for (i = 0; i < client->queue_size && n < HTTP_FLV_WRITE_MAX_IOV; ++i) {
+            const HttpFlvTag *tag = client->queue[(client->queue_head + i) % HTTP_FLV_CLIENT_QUEUE_MAX];
+            int j;
+
+            for (j = 0; j < tag->iov_count && n < HTTP_FLV_WRITE_MAX_IOV; ++j) {
+                size_t len = tag->iov[j].iov_len;
+
+                if (skip >= len) {
+                    skip -= len;
+                    continue;
+                }
+                iov[n].iov_base = (uint8_t *)tag->iov[j].iov_base + skip;
+                iov[n].iov_len = len - skip;
+                total += iov[n].iov_len;
+                skip = 0;
+                n++;
+            }
+        }
+
+        /* sendmsg 与 writev 等价，另外可以带 MSG_NOSIGNAL，对端断开时不会触发 SIGPIPE。 */
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)n;
+        written = sendmsg(client->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                http_flv_client_watch(impl, client, 1);
+                return 0;
+            }
+            http_flv_client_close(impl, client, "send_error");
+            return -1;
+        }
+        impl->write_calls++;
+        impl->bytes_sent += (uint64_t)written;
+        http_flv_client_consume(client, (size_t)written);
+        if ((size_t)written < total) {
+            /* 内核发送缓冲已满，等可写事件再继续。 */
+            http_flv_client_watch(impl, client, 1);
+            return 0;
+        }
+    }
+
+    http_flv_client_watch(impl, client, 0);
+    if (client->close_after_reply) {
+        http_flv_client_close(impl, client, "replied");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @description: 把 tag 追加到客户端发送队列，积压超出预算的客户端直接断开。
+ *               接入时补发的 GOP 缓存可能比预算还大，补发 tag 和尚未写完的补发字节都不计入预算，
+ *               预算只约束实时 tag 的积压
+ * @param {HttpFlvImpl *} impl
+ * @param {HttpFlvClient *} client
+ * @param {HttpFlvTag *} tag
+ * @param {int} burst 是否为接入时补发的 tag
+ * @return {static int} 0 成功，-1 客户端因积压被断开
+ */
+static int http_flv_client_push(HttpFlvImpl *impl, HttpFlvClient *client, HttpFlvTag *tag, int burst) {
+    size_t live_bytes = client->pending_bytes - client->burst_bytes;
+    int tail;
+
+    if (client->queue_size >= HTTP_FLV_CLIENT_QUEUE_MAX ||
+        (!burst && live_bytes + tag->size > (size_t)impl->config.client_budget_bytes)) {
+        pthread_mutex_lock(&impl->lock);
+        impl->stats.slow_drops++;
+        pthread_mutex_unlock(&impl->lock);
+        http_flv_client_close(impl, client, "slow_client");
+        return -1;
+    }
+    tag->ref_count++;
+    tail = (client->queue_head + client->queue_size) % HTTP_FLV_CLIENT_QUEUE_MAX;
+    client->queue[tail] = tag;
+    client->queue_size++;
+    client->pending_bytes += tag->size;
+    if (burst) {
+        client->burst_bytes += tag->size;
+    }
+    return 0;
+}
+
+/**
+ * @description: 清空 GOP 缓存
+ * @param {HttpFlvImpl *} impl
+ * @return {static void}
+ */
+static void http_flv_gop_clear(HttpFlvImpl *impl) {
+    while (impl->gop_size > 0) {
+        impl->gop_size--;
+        http_flv_tag_release(impl->gop[impl->gop_size]);
+        impl->gop[impl->gop_size] = NULL;
+    }
+}
+
+/**
+ * @description: 用错误响应拒绝连接，写完后关闭
+ * @param {HttpFlvImpl *} impl
+ * @param {HttpFlvClient *} client
+ * @param {const char *} response
+ * @return {static void}
+ */
+static void http_flv_client_reject(HttpFlvImpl *impl, HttpFlvClient *client, const char *response) {
+    pthread_mutex_lock(&impl->lock);
+    impl->stats.rejected++;
+    pthread_mutex_unlock(&impl->lock);
+    client->reply = (const uint8_t *)response;
+    client->reply_len = strlen(response);
+    client->reply_offset = 0;
+    client->pending_bytes = client->reply_len;
+    client->close_after_reply = 1;
+    http_flv_client_flush(impl, client);
+}
+
+/**
+ * @description: 请求校验通过后开始播放：先发文件头和当前 sequence header，再补发缓存的 GOP
+ * @param {HttpFlvImpl *} impl
+ * @param {HttpFlvClient *} client
+ * @return {static void}
+ */
+static void http_flv_client_begin(HttpFlvImpl *impl, HttpFlvClient *client) {
+    int i;
+
+    client->streaming = 1;
+    impl->streaming_clients++;
+    client->reply = impl->preamble;
+    client->reply_len = impl->preamble_len;
+    client->reply_offset = 0;
+    client->pending_bytes = impl->preamble_len;
+    client->burst_bytes = impl->preamble_len;
+    client->waiting_for_keyframe = 1;
+    printf("[HTTP-FLV] event=client_play fd=%d path=%s gop_frames=%d clients=%d\n",
+           client->fd,
+           impl->path,
+           impl->gop_size,
+           impl->streaming_clients);
+
+    if (impl->sequence_header && http_flv_client_push(impl, client, impl->sequence_header, 1) != 0) {
+        return;
+    }
+    if (impl->gop_size > 0) {
+        for (i = 0; i < impl->gop_size; ++i) {
+            if (http_flv_client_push(impl, client, impl->gop[i], 1) != 0) {
+                return;
+            }
+        }
+        client->waiting_for_keyframe = 0;
+    }
+    http_flv_client_flush(impl, client);
+}
+
+/**
+ * @description: 解析请求行，只接受 GET <path>[?query]
+ * @param {HttpFlvImpl *} impl
+ * @param {HttpFlvClient *} client
+ * @return {static void}
+ */
+static void http_flv_client_handle_request(HttpFlvImpl *impl, HttpFlvClient *client) {
+    char *target;
+    char *target_end;
+    char *query;
+
+    client->request[client->request_len] = '\0';
+    if (strncmp(client->request, "GET ", 4) != 0) {
+        http_flv_client_reject(impl, client, HTTP_FLV_RESPONSE_400);
+        return;
+    }
+    target = client->request + 4;
+    target_end = strpbrk(target, " \r\n");
+    if (!target_end) {
+        http_flv_client_reject(impl, client, HTTP_FLV_RESPONSE_400);
+        return;
+    }
+    *target_end = '\0';
+    query = strchr(target, '?');
+    if (query) {
+        *query = '\0';
+    }
+    if (strcmp(target, impl->path) != 0) {
+        fprintf(stderr, "[WARN] HTTP-FLV reject fd=%d path=%s expect=%s\n", client->fd, target, impl->path);
+        http_flv_client_reject(impl, client, HTTP_FLV_RESPONSE_404);
+        return;
+    }
+    if (impl->streaming_clients >= impl->config.max_clients) {
+        fprintf(stderr, "[WARN] HTTP-FLV reject fd=%d: clients=%d reach max_clients=%d\n",
+                client->fd,
+                impl->streaming_clients,
+                impl->config.max_clients);
+        http_flv_client_reject(impl, client, HTTP_FLV_RESPONSE_503);
+        return;
+    }
+    http_flv_client_begin(impl, client);
+}
+
+/**
+ * @description: 处理客户端可读事件：收请求头，播放中则丢弃客户端发来的数据
+ * @param {HttpFlvImpl *} impl
+ * @param {HttpFlvClient *} client
+ * @return {static void}
+ */
+static void http_flv_client_read(HttpFlvImpl *impl, HttpFlvClient *client) {
+    char discard[512];
+
+    while (!client->closed) {
+        ssize_t n;
+
+        if (client->streaming || client->close_after_reply) {
+            n = recv(client->fd, discard, sizeof(discard), MSG_DONTWAIT);
+        } else {
+            size_t room = sizeof(client->request) - 1 - client->request_len;
+            if (room == 0) {
+                http_flv_client_reject(impl, client, HTTP_FLV_RESPONSE_400);
+                return;
+            }
+            n = recv(client->fd, client->request + client->request_len, room, MSG_DONTWAIT);
+        }
+        if (n == 0) {
+            http_flv_client_close(impl, client, "peer_closed");
+            return;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                http_flv_client_close(impl, client, "recv_error");
+            }
+            return;
+        }
+        if (client->streaming || client->close_after_reply) {
+            continue;
+        }
+        client->request_len += (size_t)n;
+        client->request[client->request_len] = '\0';
+        if (strstr(client->request, "\r\n\r\n")) {
+            http_flv_client_handle_request(impl, client);
+            return;
+        }
+    }
+}
+
+/**
+ * @description: 接入新连接，连接数超出上限时直接关闭
+ * @param {HttpFlvImpl *} impl
+ * @return {static void}
+ */
+static void http_flv_accept(HttpFlvImpl *impl) {
+    while (1) {
+        struct epoll_event ev;
+        HttpFlvClient *client;
+        int one = 1;
+        int fd;
+
+        fd = accept4(impl->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (impl->client_count >= impl->client_capacity) {
+            pthread_mutex_lock(&impl->lock);
+            impl->stats.rejected++;
+            pthread_mutex_unlock(&impl->lock);
+            close(fd);
+            continue;
+        }
+        client = (HttpFlvClient *)calloc(1, sizeof(*client));
+        if (!client) {
+            fprintf(stderr, "[HTTP-FLV][ERROR] client alloc failed\n");
+            close(fd);
+            continue;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        client->fd = fd;
+        client->accepted_ms = http_flv_now_ms();
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = client;
+        if (epoll_ctl(impl->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            fprintf(stderr, "[HTTP-FLV][ERROR] epoll add client failed errno=%d\n", errno);
+            close(fd);
+            free(client);
+            continue;
+        }
+        impl->clients[impl->client_count++] = client;
+        pthread_mutex_lock(&impl->lock);
+        impl->stats.accepted++;
+        pthread_mutex_unlock(&impl->lock);
+    }
+}
+
+/**
+ * @description: 打印运行统计
+ * @param {HttpFlvImpl *} impl
+ * @return {static void}
+ */
+static void http_flv_log_stats(HttpFlvImpl *impl) {
+    HttpFlvSinkStats stats;
+    uint64_t inbox_drops;
+
+    pthread_mutex_lock(&impl->lock);
+    stats = impl->stats;
+    inbox_drops = impl->inbox_drops;
+    pthread_mutex_unlock(&impl->lock);
+    printf("[HTTP-FLV] event=stats path=%s clients=%d accepted=%llu rejected=%llu slow_drops=%llu frames=%llu inbox_drops=%llu bytes_sent=%llu write_calls=%llu gop_frames=%d\n",
+           impl->path,
+           stats.clients,
+           (unsigned long long)stats.accepted,
+           (unsigned long long)stats.rejected,
+           (unsigned long long)stats.slow_drops,
+           (unsigned long long)stats.frames,
+           (unsigned long long)inbox_drops,
+           (unsigned long long)stats.bytes_sent,
+           (unsigned long long)stats.write_calls,
+           impl->gop_size);
+}
+
+/**
+ * @description: 分发一个 tag：更新 sequence header / GOP 缓存，再追加到各播放中客户端
+ * @param {HttpFlvImpl *} impl
+ * @param {HttpFlvTag *} tag 服务线程接管的引用
+ * @return {static void}
+ */
+static void http_flv_dispatch(HttpFlvImpl *impl, HttpFlvTag *tag) {
+    int i;
+
+    if (tag->is_sequence_header) {
+        /* 新的 SPS/PPS 后面紧跟关键帧，旧 GOP 对新参数集已无意义。 */
+        http_flv_tag_release(impl->sequence_header);
+        impl->sequence_header = tag;
+        tag->ref_count++;
+        http_flv_gop_clear(impl);
+    } else if (tag->is_key_frame) {
+        http_flv_gop_clear(impl);
+        impl->gop[impl->gop_size++] = tag;
+        tag->ref_count++;
+    } else if (impl->gop_size > 0) {
+        if (impl->gop_size < impl->config.gop_cache_max_frames) {
+            impl->gop[impl->gop_size++] = tag;
+            tag->ref_count++;
+        } else {
+            /* GOP 超出缓存上限时整体丢弃，新客户端改为等下一个关键帧，避免从半个 GOP 开始花屏。 */
+            http_flv_gop_clear(impl);
+        }
+    }
+
+    for (i = 0; i < impl->client_count; ++i) {
+        HttpFlvClient *client = impl->clients[i];
+
+        if (client->closed || !client->streaming) {
+            continue;
+        }
+        if (!tag->is_sequence_header && client->waiting_for_keyframe) {
+            if (!tag->is_key_frame) {
+                continue;
+            }
+            client->waiting_for_keyframe = 0;
+        }
+        if (http_flv_client_push(impl, client, tag, 0) != 0) {
+            continue;
+        }
+        if (!client->want_write) {
+            http_flv_client_flush(impl, client);
+        }
+    }
+
+    if (!tag->is_sequence_header) {
+        impl->served_frames++;
+        if ((impl->served_frames % HTTP_FLV_STATS_INTERVAL_FRAMES) == 0) {
+            http_flv_log_stats(impl);
+        }
+    }
+    http_flv_tag_release(tag);
+}
+
+/**
+ * @description: 关闭发请求超时的连接
+ * @param {HttpFlvImpl *} impl
+ * @return {static void}
+ */
+static void http_flv_expire_requests(HttpFlvImpl *impl) {
+    long long now = http_flv_now_ms();
+    int i;
+
+    for (i = 0; i < impl->client_count; ++i) {
+        HttpFlvClient *client = impl->clients[i];
+        if (!client->closed && !client->streaming && !client->close_after_reply &&
+            now - client->accepted_ms > HTTP_FLV_REQUEST_TIMEOUT_MS) {
+            http_flv_client_close(impl, client, "request_timeout");
+        }
+    }
+}
+
+/**
+ * @description: 服务线程主函数：单个 epoll 同时处理监听、新 tag 通知和所有客户端读写
+ * @param {void *} arg
+ * @return {static void *}
+ */
+static void *http_flv_server_thread(void *arg) {
+    HttpFlvImpl *impl = (HttpFlvImpl *)arg;
+    struct epoll_event events[HTTP_FLV_EPOLL_EVENTS];
+
+    while (!impl->stop_requested) {
+        int n = epoll_wait(impl->epoll_fd, events, HTTP_FLV_EPOLL_EVENTS, HTTP_FLV_EPOLL_TIMEOUT_MS);
+        int i;
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "[HTTP-FLV][ERROR] epoll_wait failed errno=%d\n", errno);
+            break;
+        }
+        for (i = 0; i < n; ++i) {
+            void *ptr = events[i].data.ptr;
+
+            if (ptr == &impl->listen_fd) {
+                http_flv_accept(impl);
+            } else if (ptr == &impl->event_fd) {
+                uint64_t value;
+                HttpFlvTag *tag;
+
+                if (read(impl->event_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                    fprintf(stderr, "[HTTP-FLV][ERROR] eventfd read failed errno=%d\n", errno);
+                }
+                while (!impl->stop_requested && (tag = http_flv_inbox_pop(impl)) != NULL) {
+                    http_flv_dispatch(impl, tag);
+                }
+            } else {
+                HttpFlvClient *client = (HttpFlvClient *)ptr;
+
+                if (client->closed) {
+                    continue;
+                }
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    http_flv_client_close(impl, client, "socket_error");
+                    continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+                    http_flv_client_read(impl, client);
+                }
+                if (!client->closed && (events[i].events & EPOLLOUT)) {
+                    http_flv_client_flush(impl, client);
+                }
+            }
+        }
+        http_flv_expire_requests(impl);
+        http_flv_reap_clients(impl);
+
+        pthread_mutex_lock(&impl->lock);
+        impl->stats.clients = impl->streaming_clients;
+        impl->stats.bytes_sent = impl->bytes_sent;
+        impl->stats.write_calls = impl->write_calls;
+        pthread_mutex_unlock(&impl->lock);
+    }
+    return NULL;
+}
+
+/**
+ * @description: 关闭服务端 socket 并释放服务线程持有的全部引用，可重复调用
+ * @param {HttpFlvImpl *} impl
+ * @return {static void}
+ */
+static void http_flv_release_server(HttpFlvImpl *impl) {
+    HttpFlvTag *tag;
+    int i;
+
+    for (i = 0; i < impl->client_count; ++i) {
+        http_flv_client_close(impl, impl->clients[i], "shutdown");
+    }
+    http_flv_reap_clients(impl);
+    impl->streaming_clients = 0;
+    http_flv_gop_clear(impl);
+    http_flv_tag_release(impl->sequence_header);
+    impl->sequence_header = NULL;
+    while ((tag = http_flv_inbox_pop(impl)) != NULL) {
+        http_flv_tag_release(tag);
+    }
+    if (impl->epoll_fd >= 0) {
+        close(impl->epoll_fd);
+        impl->epoll_fd = -1;
+    }
+    if (impl->event_fd >= 0) {
+        close(impl->event_fd);
+        impl->event_fd = -1;
+    }
+    if (impl->listen_fd >= 0) {
+        close(impl->listen_fd);
+        impl->listen_fd = -1;
+    }
+    pthread_mutex_lock(&impl->lock);
+    impl->stats.clients = 0;
+    pthread_mutex_unlock(&impl->lock);
+}
+
+/**
+ * @description: 创建非阻塞监听 socket
+ * @param {const HttpFlvSinkConfig *} config
+ * @return {static int} socket，失败返回 -1
+ */
+static int http_flv_listen(const HttpFlvSinkConfig *config) {
+    struct sockaddr_in addr;
+    int one = 1;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)config->listen_port);
+    if (inet_pton(AF_INET, config->listen_ip, &addr.sin_addr) != 1) {
+        fprintf(stderr, "[HTTP-FLV][ERROR] invalid listen_ip=%s\n", config->listen_ip);
+        return -1;
+    }
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "[HTTP-FLV][ERROR] socket failed errno=%d\n", errno);
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+        fprintf(stderr, "[HTTP-FLV][ERROR] bind/listen %s:%d failed errno=%d\n",
+                config->listen_ip,
+                config->listen_port,
+                errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @description: 启动 HTTP 服务：监听端口、创建 epoll 并拉起服务线程
+ * @param {MediaSink *} sink
+ * @return {static int}
+ */
+static int http_flv_start(MediaSink *sink) {
+    HttpFlvImpl *impl = (HttpFlvImpl *)sink->impl;
+    struct epoll_event ev;
+
+    impl->listen_fd = http_flv_listen(&impl->config);
+    if (impl->listen_fd < 0) {
+        return -1;
+    }
+    impl->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    impl->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (impl->event_fd < 0 || impl->epoll_fd < 0) {
+        fprintf(stderr, "[HTTP-FLV][ERROR] eventfd/epoll create failed errno=%d\n", errno);
+        http_flv_release_server(impl);
+        return -1;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = &impl->listen_fd;
+    if (epoll_ctl(impl->epoll_fd, EPOLL_CTL_ADD, impl->listen_fd, &ev) != 0) {
+        fprintf(stderr, "[HTTP-FLV][ERROR] epoll add listen failed errno=%d\n", errno);
+        http_flv_release_server(impl);
+        return -1;
+    }
+    ev.data.ptr = &impl->event_fd;
+    if (epoll_ctl(impl->epoll_fd, EPOLL_CTL_ADD, impl->event_fd, &ev) != 0) {
+        fprintf(stderr, "[HTTP-FLV][ERROR] epoll add eventfd failed errno=%d\n", errno);
+        http_flv_release_server(impl);
+        return -1;
+    }
+
+    impl->stop_requested = 0;
+    if (pthread_create(&impl->thread, NULL, http_flv_server_thread, impl) != 0) {
+        fprintf(stderr, "[HTTP-FLV][ERROR] start failed: pthread_create\n");
+        http_flv_release_server(impl);
+        return -1;
+    }
+    impl->running = 1;
+    printf("[INFO] HTTP-FLV serving http://%s:%d%s\n", impl->config.listen_ip, impl->config.listen_port, impl->path);
+    return 0;
+}
+
+/**
+ * @description: HTTP-FLV 由客户端拉流，没有需要建立的下游连接
+ * @param {MediaSink *} sink
+ * @return {static int}
+ */
+static int http_flv_connect(MediaSink *sink) {
+    (void)sink;
+    return 0;
+}
+
+/**
+ * @description: 封装一帧并投递给服务线程，SPS/PPS 变化时先投递新的 sequence header
+ * @param {MediaSink *} sink
+ * @param {const MediaPacket *} packet
+ * @return {static int}
+ */
+static int http_flv_send_packet(MediaSink *sink, const MediaPacket *packet) {
+    HttpFlvImpl *impl = (HttpFlvImpl *)sink->impl;
+    HttpFlvTag *tag = NULL;
+    size_t nalu_count = 0;
+    int params_changed = 0;
+
+    if (!impl || !packet || !packet->buffer) {
+        return -1;
+    }
+    if (packet->frame_type != MEDIA_FRAME_TYPE_VIDEO || packet->codec != MEDIA_CODEC_H264) {
+        return 0;
+    }
+
+    if (rtmp_flv_split_annexb(packet->buffer->data, packet->buffer->size, impl->nalus, RTMP_FLV_MAX_NALUS, &nalu_count) != 0) {
+        fprintf(stderr, "[HTTP-FLV][ERROR] split annexb failed frame=%" PRIu64 " size=%zu\n",
+                packet->frame_id,
+                packet->buffer->size);
+        return -1;
+    }
+    if (rtmp_flv_cache_parameter_sets(&impl->params, impl->nalus, nalu_count, &params_changed) != 0) {
+        return -1;
+    }
+    if (params_changed) {
+        impl->sequence_dirty = 1;
+    }
+    if (impl->need_keyframe && !packet->is_key_frame) {
+        return 0;
+    }
+
+    if (impl->sequence_dirty) {
+        if (http_flv_make_sequence_tag(impl, rtmp_flv_packet_timestamp_ms(packet), &tag) != 0) {
+            fprintf(stderr, "[HTTP-FLV][ERROR] sequence header alloc failed\n");
+            return -1;
+        }
+        if (!tag) {
+            fprintf(stderr, "[WARN] HTTP-FLV skip frame=%" PRIu64 " because SPS/PPS not ready\n", packet->frame_id);
+            return 0;
+        }
+        if (http_flv_post(impl, tag) != 0) {
+            http_flv_tag_release(tag);
+            pthread_mutex_lock(&impl->lock);
+            impl->inbox_drops++;
+            pthread_mutex_unlock(&impl->lock);
+            impl->need_keyframe = 1;
+            return 0;
+        }
+        impl->sequence_dirty = 0;
+    }
+
+    if (http_flv_make_video_tag(impl, packet, nalu_count, &tag) != 0) {
+        fprintf(stderr, "[HTTP-FLV][ERROR] tag alloc failed frame=%" PRIu64 "\n", packet->frame_id);
+        return -1;
+    }
+    if (!tag) {
+        return 0;
+    }
+    if (http_flv_post(impl, tag) != 0) {
+        /* 服务线程跟不上时丢到下一个关键帧，避免客户端收到缺参考帧的数据。 */
+        http_flv_tag_release(tag);
+        pthread_mutex_lock(&impl->lock);
+        impl->inbox_drops++;
+        pthread_mutex_unlock(&impl->lock);
+        impl->need_keyframe = 1;
+        return 0;
+    }
+    if (packet->is_key_frame) {
+        impl->need_keyframe = 0;
+    }
+    pthread_mutex_lock(&impl->lock);
+    impl->stats.frames++;
+    pthread_mutex_unlock(&impl->lock);
+    return 0;
+}
+
+/**
+ * @description: 当前是否有客户端在播放
+ * @param {MediaSink *} sink
+ * @return {static int}
+ */
+static int http_flv_has_consumer(MediaSink *sink) {
+    HttpFlvImpl *impl = (HttpFlvImpl *)sink->impl;
+    int clients;
+
+    if (!impl) {
+        return 0;
+    }
+    pthread_mutex_lock(&impl->lock);
+    clients = impl->stats.clients;
+    pthread_mutex_unlock(&impl->lock);
+    return clients > 0;
+}
+
+/**
+ * @description: 停止服务线程并释放所有连接和缓存，可重复调用
+ * @param {MediaSink *} sink
+ * @return {static void}
+ */
+static void http_flv_stop(MediaSink *sink) {
+    HttpFlvImpl *impl = (HttpFlvImpl *)sink->impl;
+    uint64_t one = 1;
+
+    if (!impl) {
+        return;
+    }
+    if (impl->running) {
+        impl->stop_requested = 1;
+        if (write(impl->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            fprintf(stderr, "[HTTP-FLV][ERROR] eventfd wake failed errno=%d\n", errno);
+        }
+        pthread_join(impl->thread, NULL);
+        impl->running = 0;
+        http_flv_log_stats(impl);
+    }
+    http_flv_release_server(impl);
+    rtmp_flv_free_parameter_sets(&impl->params);
+    impl->sequence_dirty = 0;
+    impl->need_keyframe = 0;
+}
+
+int http_flv_sink_get_stats(MediaSink *sink, HttpFlvSinkStats *stats) {
+    HttpFlvImpl *impl = sink ? (HttpFlvImpl *)sink->impl : NULL;
+
+    if (!impl || !stats) {
+        return -1;
+    }
+    pthread_mutex_lock(&impl->lock);
+    *stats = impl->stats;
+    pthread_mutex_unlock(&impl->lock);
+    return 0;
+}
+
+/**
+ * @description: 生成每个客户端开头都要发送的 HTTP 响应头、FLV 文件头和 onMetaData tag
+ * @param {HttpFlvImpl *} impl
+ * @return {static void}
+ */
+static void http_flv_build_preamble(HttpFlvImpl *impl) {
+    RtmpSinkConfig meta;
+    uint8_t *p = impl->preamble;
+    size_t header_len = sizeof(HTTP_FLV_RESPONSE_HEADER) - 1;
+    size_t metadata_len;
+
+    memcpy(p, HTTP_FLV_RESPONSE_HEADER, header_len);
+    p += header_len;
+
+    /* FLV 文件头：签名、版本 1、只有视频、头长度 9，随后是 PreviousTagSize0。 */
+    p[0] = 'F';
+    p[1] = 'L';
+    p[2] = 'V';
+    p[3] = 1;
+    p[4] = 0x01;
+    http_flv_write_be32(p + 5, 9);
+    http_flv_write_be32(p + 9, 0);
+    p += 13;
+
+    memset(&meta, 0, sizeof(meta));
+    meta.video_width = impl->config.video_width;
+    meta.video_height = impl->config.video_height;
+    meta.video_fps = impl->config.video_fps;
+    meta.video_bitrate = impl->config.video_bitrate;
+    meta.encoder_name = impl->config.encoder_name;
+    metadata_len = rtmp_flv_build_metadata(p + FLV_TAG_HEADER_SIZE, &meta);
+    http_flv_write_tag_header(p, FLV_TAG_TYPE_SCRIPT, metadata_len, 0);
+    p += FLV_TAG_HEADER_SIZE + metadata_len;
+    http_flv_write_be32(p, (uint32_t)(FLV_TAG_HEADER_SIZE + metadata_len));
+    p += 4;
+    impl->preamble_len = (size_t)(p - impl->preamble);
+}
+
+/**
+ * @description: 释放 setup 过程中已分配的资源
+ * @param {HttpFlvImpl *} impl
+ * @return {static void}
+ */
+static void http_flv_free(HttpFlvImpl *impl) {
+    pthread_mutex_destroy(&impl->lock);
+    free(impl->inbox);
+    free(impl->clients);
+    free(impl->gop);
+    free(impl);
+}
+
+/**
+ * @description: 根据配置创建 HTTP-FLV 输出通道
+ * @param {MediaSink *} sink
+ * @param {const HttpFlvSinkConfig *} config
+ * @return {int}
+ */
+int http_flv_sink_setup(MediaSink *sink, const HttpFlvSinkConfig *config) {
+    static const MediaSinkVTable vtable = {
+        http_flv_start,
+        http_flv_connect,
+        http_flv_send_packet,
+        NULL,
+        http_flv_stop,
+        http_flv_has_consumer,
+        NULL
+    };
+    MediaSinkConfig sink_config;
+    HttpFlvImpl *impl;
+
+    if (!sink || !config) {
+        fprintf(stderr, "[HTTP-FLV][ERROR] setup failed: invalid arguments\n");
+        return -1;
+    }
+
+    impl = (HttpFlvImpl *)calloc(1, sizeof(*impl));
+    if (!impl) {
+        fprintf(stderr, "[HTTP-FLV][ERROR] setup failed: impl alloc\n");
+        return -1;
+    }
+    impl->config = *config;
+    if (!impl->config.name) {
+        impl->config.name = DEFAULT_HTTP_FLV_NAME;
+    }
+    if (!impl->config.listen_ip || impl->config.listen_ip[0] == '\0') {
+        impl->config.listen_ip = DEFAULT_HTTP_FLV_LISTEN_IP;
+    }
+    if (impl->config.listen_port <= 0) {
+        impl->config.listen_port = DEFAULT_HTTP_FLV_PORT;
+    }
+    if (!impl->config.stream_name || impl->config.stream_name[0] == '\0') {
+        impl->config.stream_name = DEFAULT_HTTP_FLV_STREAM_NAME;
+    }
+    if (impl->config.queue_capacity <= 0) {
+        impl->config.queue_capacity = DEFAULT_HTTP_FLV_QUEUE_CAPACITY;
+    }
+    if (impl->config.max_clients <= 0) {
+        impl->config.max_clients = DEFAULT_HTTP_FLV_MAX_CLIENTS;
+    }
+    if (impl->config.client_budget_bytes <= 0) {
+        impl->config.client_budget_bytes = DEFAULT_HTTP_FLV_CLIENT_BUDGET_BYTES;
+    }
+    if (impl->config.gop_cache_max_frames <= 0) {
+        impl->config.gop_cache_max_frames = DEFAULT_HTTP_FLV_GOP_CACHE_MAX_FRAMES;
+    }
+    /* GOP 缓存整体要能放进新客户端的发送队列。 */
+    if (impl->config.gop_cache_max_frames > HTTP_FLV_CLIENT_QUEUE_MAX / 2) {
+        impl->config.gop_cache_max_frames = HTTP_FLV_CLIENT_QUEUE_MAX / 2;
+    }
+    snprintf(impl->path, sizeof(impl->path), "/live/%s.flv", impl->config.stream_name);
+    http_flv_build_preamble(impl);
+
+    impl->listen_fd = -1;
+    impl->event_fd = -1;
+    impl->epoll_fd = -1;
+    impl->inbox_capacity = impl->config.queue_capacity;
+    impl->client_capacity = impl->config.max_clients + HTTP_FLV_PENDING_CONNECTIONS;
+    impl->inbox = (HttpFlvTag **)calloc((size_t)impl->inbox_capacity, sizeof(HttpFlvTag *));
+    impl->clients = (HttpFlvClient **)calloc((size_t)impl->client_capacity, sizeof(HttpFlvClient *));
+    impl->gop = (HttpFlvTag **)calloc((size_t)impl->config.gop_cache_max_frames, sizeof(HttpFlvTag *));
+    pthread_mutex_init(&impl->lock, NULL);
+    if (!impl->inbox || !impl->clients || !impl->gop) {
+        fprintf(stderr, "[HTTP-FLV][ERROR] setup failed: queue alloc\n");
+        http_flv_free(impl);
+        return -1;
+    }
+
+    memset(&sink_config, 0, sizeof(sink_config));
+    sink_config.name = impl->config.name;
+    sink_config.queue_capacity = impl->config.queue_capacity;
+    sink_config.reconnect_interval_ms = DEFAULT_HTTP_FLV_RECONNECT_INTERVAL_MS;
+    sink_config.drop_until_keyframe_after_reconnect = 1;
+
+    if (media_sink_init(sink, &sink_config, &vtable, impl) != 0) {
+        fprintf(stderr, "[HTTP-FLV][ERROR] setup failed: media_sink_init name=%s\n", impl->config.name);
+        http_flv_free(impl);
+        return -1;
+    }
+    printf("[INFO] HTTP-FLV configured name=%s listen=%s:%d path=%s max_clients=%d budget=%d gop_cache=%d\n",
+           impl->config.name,
+           impl->config.listen_ip,
+           impl->config.listen_port,
+           impl->path,
+           impl->config.max_clients,
+           impl->config.client_budget_bytes,
+           impl->config.gop_cache_max_frames);
+    return 0;
+}
@@ -0,0 +1,818 @@
+#include "rtmpFanoutSink.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+
+#include "rtmpFlv.h"
+#include "rtmpPublisher.h"
+
+#define DEFAULT_RTMP_FANOUT_NAME "rtmp-fanout"
+#define DEFAULT_RTMP_FANOUT_QUEUE_CAPACITY 64
+#define DEFAULT_RTMP_FANOUT_RECONNECT_INTERVAL_MS 1000
+#define DEFAULT_RTMP_FANOUT_MAX_RECONNECT_INTERVAL_MS 30000
+#define DEFAULT_RTMP_FANOUT_CONNECT_TIMEOUT_MS 3000
+#define DEFAULT_RTMP_FANOUT_CHUNK_SIZE 4096
+#define DEFAULT_RTMP_FANOUT_SEND_TIMEOUT_MS 2000
+#define RTMP_FANOUT_STATS_INTERVAL_FRAMES 900
+#define RTMP_FANOUT_URL_MAX 512
+
+typedef struct RtmpFanoutFrame RtmpFanoutFrame;
+
+/* 一帧封装好的 FLV 视频消息，由各目的地共享，引用归零后回收到帧池。 */
+struct RtmpFanoutFrame {
+    int ref_count;                 /* 仍持有该帧的队列/发送线程数，受 pool_lock 保护。 */
+    MediaPacket packet;            /* 原始帧引用，iov 里的 NALU 分段直接指向它的 buffer。 */
+    MediaBuffer *sequence_header;  /* 该帧适用的 AVC sequence header 消息体。 */
+    uint32_t sequence_generation;  /* sequence header 版本号，SPS/PPS 变化时递增。 */
+    uint32_t timestamp_ms;         /* RTMP 时间戳。 */
+    int is_key_frame;              /* 是否关键帧。 */
+    uint8_t tag_header[5];         /* FLV 视频 tag 头。 */
+    uint8_t nalu_prefix[RTMP_FLV_MAX_NALUS][4]; /* 每个 NALU 的 4 字节长度前缀。 */
+    struct iovec iov[RTMP_FLV_MAX_IOV]; /* 视频消息负载分段，各目的地原样交给 rtmp_publisher_send。 */
+    int iov_count;                 /* iov 有效分段数。 */
+    RtmpFanoutFrame *next_free;    /* 帧池空闲链表。 */
+};
+
+struct RtmpFanoutImpl;
+
+typedef struct {
+    struct RtmpFanoutImpl *owner;  /* 所属扇出通道。 */
+    int index;                     /* 目的地下标，用于日志。 */
+    char url[RTMP_FANOUT_URL_MAX]; /* 推流地址。 */
+    RtmpPublisher publisher;       /* 该目的地独立的推流客户端。 */
+    pthread_t thread;              /* 发送线程。 */
+    int running;                   /* 发送线程是否已启动。 */
+    int stop_requested;            /* 是否已请求发送线程退出。 */
+    pthread_mutex_t lock;          /* 保护队列和统计。 */
+    pthread_cond_t cond;           /* 队列非空或退出时唤醒发送线程。 */
+    RtmpFanoutFrame **queue;       /* 环形队列，保存共享帧引用。 */
+    int queue_capacity;            /* 队列容量。 */
+    int queue_head;                /* 队头下标。 */
+    int queue_size;                /* 队列有效元素数。 */
+    int metadata_sent;             /* 本次连接是否已发送 onMetaData。 */
+    uint32_t sent_sequence_generation; /* 本次连接已发送的 sequence header 版本，0 表示未发送。 */
+    long long next_connect_ms;     /* 退避结束时间，之前不发起连接。 */
+    RtmpFanoutDestinationStats stats; /* 运行统计，connected/waiting_for_keyframe/backoff_ms 也记在这里。 */
+} RtmpFanoutDestination;
+
+typedef struct RtmpFanoutImpl {
+    RtmpSinkConfig config;         /* 配置副本，publish_url 为原始地址列表。 */
+    int destination_count;         /* 目的地数量。 */
+    RtmpFanoutDestination destinations[RTMP_FANOUT_MAX_DESTINATIONS]; /* 各目的地。 */
+    RtmpAvcParamSets params;       /* 缓存的 SPS/PPS。 */
+    MediaBuffer *sequence_header;  /* 当前 SPS/PPS 对应的 sequence header 消息体。 */
+    uint32_t sequence_generation;  /* 当前 sequence header 版本号。 */
+    RtmpNaluView nalus[RTMP_FLV_MAX_NALUS]; /* 当前帧的 NALU 视图，只在封装线程使用。 */
+    uint8_t metadata[RTMP_FLV_METADATA_MAX]; /* onMetaData 消息体，setup 时生成后只读。 */
+    size_t metadata_len;           /* onMetaData 消息体长度。 */
+    pthread_mutex_t pool_lock;     /* 保护帧池和帧引用计数。 */
+    RtmpFanoutFrame *pool;         /* 预分配的帧池。 */
+    RtmpFanoutFrame *free_frames;  /* 空闲帧链表。 */
+    int pool_size;                 /* 帧池大小。 */
+    uint64_t packetized_frames;    /* 已封装的帧数。 */
+    uint64_t pool_exhausted;       /* 帧池耗尽导致丢弃的帧数。 */
+} RtmpFanoutImpl;
+
+/**
+ * @description: 获取单调时钟毫秒数
+ * @return {static long long}
+ */
+static long long rtmp_fanout_now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+/**
+ * @description: 从地址列表中取出下一个地址并去掉首尾空白
+ * @param {const char **} cursor 列表当前位置，返回时指向下一项
+ * @param {char *} out 输出地址，可为 NULL
+ * @param {size_t} out_size 输出缓冲大小
+ * @return {static int} 1 取到地址，0 列表结束
+ */
+static int rtmp_fanout_next_url(const char **cursor, char *out, size_t out_size) {
+    while (**cursor) {
+        const char *begin = *cursor;
+        const char *end = strchr(begin, ',');
+        size_t len;
+
+        if (!end) {
+            end = begin + strlen(begin);
+        }
+        *cursor = (*end == ',') ? end + 1 : end;
+        while (begin < end && (*begin == ' ' || *begin == '\t')) {
+            begin++;
+        }
+        while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) {
+            end--;
+        }
+        len = (size_t)(end - begin);
+        if (len == 0) {
+            continue;
+        }
+        if (out) {
+            if (len >= out_size) {
+                len = out_size - 1;
+            }
+            memcpy(out, begin, len);
+            out[len] = '\0';
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int rtmp_fanout_url_count(const char *urls) {
+    int count = 0;
+
+    if (!urls) {
+        return 0;
+    }
+    while (rtmp_fanout_next_url(&urls, NULL, 0)) {
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @description: 从帧池取一个空闲帧
+ * @param {RtmpFanoutImpl *} impl
+ * @return {static RtmpFanoutFrame *}
+ */
+static RtmpFanoutFrame *rtmp_fanout_frame_take(RtmpFanoutImpl *impl) {
+    RtmpFanoutFrame *frame;
+
+    pthread_mutex_lock(&impl->pool_lock);
+    frame = impl->free_frames;
+    if (frame) {
+        impl->free_frames = frame->next_free;
+        frame->next_free = NULL;
+    }
+    pthread_mutex_unlock(&impl->pool_lock);
+    return frame;
+}
+
+/**
+ * @description: 释放一个帧引用，最后一个持有者负责释放底层 buffer 并把帧还回帧池
+ * @param {RtmpFanoutImpl *} impl
+ * @param {RtmpFanoutFrame *} frame
+ * @return {static void}
+ */
+static void rtmp_fanout_frame_release(RtmpFanoutImpl *impl, RtmpFanoutFrame *frame) {
+    pthread_mutex_lock(&impl->pool_lock);
+    frame->ref_count--;
+    if (frame->ref_count <= 0) {
+        media_packet_reset(&frame->packet);
+        if (frame->sequence_header) {
+            media_buffer_release(frame->sequence_header);
+            frame->sequence_header = NULL;
+        }
+        frame->next_free = impl->free_frames;
+        impl->free_frames = frame;
+    }
+    pthread_mutex_unlock(&impl->pool_lock);
+}
+
+/**
+ * @description: 在加锁状态下弹出目的地队头的帧
+ * @param {RtmpFanoutDestination *} dest
+ * @return {static RtmpFanoutFrame *}
+ */
+static RtmpFanoutFrame *rtmp_fanout_pop_locked(RtmpFanoutDestination *dest) {
+    RtmpFanoutFrame *frame;
+
+    if (dest->queue_size <= 0) {
+        return NULL;
+    }
+    frame = dest->queue[dest->queue_head];
+    dest->queue[dest->queue_head] = NULL;
+    dest->queue_head = (dest->queue_head + 1) % dest->queue_capacity;
+    dest->queue_size--;
+    dest->stats.queue_depth = dest->queue_size;
+    return frame;
+}
+
+/**
+ * @description: 把一帧投递到目的地队列，沿用 media_sink_enqueue 的丢帧策略
+ * @param {RtmpFanoutDestination *} dest
+ * @param {RtmpFanoutFrame *} frame 调用方已为该目的地计入一次引用
+ * @return {static void}
+ */
+static void rtmp_fanout_push(RtmpFanoutDestination *dest, RtmpFanoutFrame *frame) {
+    RtmpFanoutImpl *impl = dest->owner;
+    int tail;
+
+    pthread_mutex_lock(&dest->lock);
+    if (dest->queue_size >= dest->queue_capacity) {
+        /* 队列满时优先丢非关键帧；来的是关键帧则淘汰旧帧，保证关键帧能入队。 */
+        if (!frame->is_key_frame) {
+            dest->stats.dropped_frames++;
+            pthread_mutex_unlock(&dest->lock);
+            rtmp_fanout_frame_release(impl, frame);
+            return;
+        }
+        while (dest->queue_size >= dest->queue_capacity) {
+            RtmpFanoutFrame *old = rtmp_fanout_pop_locked(dest);
+            dest->stats.dropped_frames++;
+            rtmp_fanout_frame_release(impl, old);
+        }
+    }
+    tail = (dest->queue_head + dest->queue_size) % dest->queue_capacity;
+    dest->queue[tail] = frame;
+    dest->queue_size++;
+    dest->stats.queue_depth = dest->queue_size;
+    pthread_cond_signal(&dest->cond);
+    pthread_mutex_unlock(&dest->lock);
+}
+
+/**
+ * @description: 记录一次丢帧
+ * @param {RtmpFanoutDestination *} dest
+ * @return {static void}
+ */
+static void rtmp_fanout_count_drop(RtmpFanoutDestination *dest) {
+    pthread_mutex_lock(&dest->lock);
+    dest->stats.dropped_frames++;
+    pthread_mutex_unlock(&dest->lock);
+}
+
+/**
+ * @description: 连接失败或发送失败后安排下一次重连，并把退避间隔翻倍
+ * @param {RtmpFanoutDestination *} dest
+ * @return {static int} 本次等待的毫秒数
+ */
+static int rtmp_fanout_schedule_retry(RtmpFanoutDestination *dest) {
+    const RtmpSinkConfig *config = &dest->owner->config;
+    int wait_ms;
+
+    pthread_mutex_lock(&dest->lock);
+    wait_ms = dest->stats.backoff_ms;
+    dest->next_connect_ms = rtmp_fanout_now_ms() + wait_ms;
+    dest->stats.backoff_ms = (wait_ms > config->max_reconnect_interval_ms / 2)
+        ? config->max_reconnect_interval_ms
+        : wait_ms * 2;
+    dest->stats.connected = 0;
+    pthread_mutex_unlock(&dest->lock);
+    return wait_ms;
+}
+
+/**
+ * @description: 建立目的地的 RTMP 会话
+ * @param {RtmpFanoutDestination *} dest
+ * @return {static int}
+ */
+static int rtmp_fanout_destination_connect(RtmpFanoutDestination *dest) {
+    const RtmpSinkConfig *config = &dest->owner->config;
+    int retry_ms;
+
+    pthread_mutex_lock(&dest->lock);
+    dest->stats.connect_attempts++;
+    pthread_mutex_unlock(&dest->lock);
+
+    if (rtmp_publisher_connect(&dest->publisher, dest->url, config->connect_timeout_ms) != 0) {
+        pthread_mutex_lock(&dest->lock);
+        dest->stats.connect_failures++;
+        pthread_mutex_unlock(&dest->lock);
+        retry_ms = rtmp_fanout_schedule_retry(dest);
+        fprintf(stderr, "[RTMP] event=fanout_connect_failed dest=%d url=%s retry_ms=%d\n",
+                dest->index,
+                dest->url,
+                retry_ms);
+        return -1;
+    }
+
+    dest->metadata_sent = 0;
+    dest->sent_sequence_generation = 0;
+    pthread_mutex_lock(&dest->lock);
+    dest->stats.connected = 1;
+    dest->stats.waiting_for_keyframe = 1;
+    dest->stats.backoff_ms = config->reconnect_interval_ms;
+    pthread_mutex_unlock(&dest->lock);
+    printf("[RTMP] event=fanout_publish_ready dest=%d url=%s stream_id=%u\n",
+           dest->index,
+           dest->url,
+           dest->publisher.stream_id);
+    return 0;
+}
+
+/**
+ * @description: 向目的地发送一帧，按需先补发 onMetaData 和 sequence header
+ * @param {RtmpFanoutDestination *} dest
+ * @param {const RtmpFanoutFrame *} frame
+ * @return {static int}
+ */
+static int rtmp_fanout_destination_send(RtmpFanoutDestination *dest, const RtmpFanoutFrame *frame) {
+    RtmpFanoutImpl *impl = dest->owner;
+    struct iovec iov;
+
+    if (!dest->metadata_sent) {
+        iov.iov_base = impl->metadata;
+        iov.iov_len = impl->metadata_len;
+        if (rtmp_publisher_send(&dest->publisher, RTMP_MSG_DATA_AMF0, 0, &iov, 1) != 0) {
+            return -1;
+        }
+        dest->metadata_sent = 1;
+    }
+    if (dest->sent_sequence_generation != frame->sequence_generation) {
+        iov.iov_base = frame->sequence_header->data;
+        iov.iov_len = frame->sequence_header->size;
+        if (rtmp_publisher_send(&dest->publisher, RTMP_MSG_VIDEO, frame->timestamp_ms, &iov, 1) != 0) {
+            return -1;
+        }
+        dest->sent_sequence_generation = frame->sequence_generation;
+    }
+    return rtmp_publisher_send(&dest->publisher, RTMP_MSG_VIDEO, frame->timestamp_ms, frame->iov, frame->iov_count);
+}
+
+/**
+ * @description: 处理目的地队列中取出的一帧：按需重连、等关键帧、发送并在失败时退避
+ * @param {RtmpFanoutDestination *} dest
+ * @param {const RtmpFanoutFrame *} frame
+ * @return {static void}
+ */
+static void rtmp_fanout_destination_handle(RtmpFanoutDestination *dest, const RtmpFanoutFrame *frame) {
+    int retry_ms;
+
+    if (!dest->stats.connected) {
+        /* 退避期间不连接；非关键帧也不连接，因为连上后仍要等关键帧才能发送。 */
+        if (!frame->is_key_frame || rtmp_fanout_now_ms() < dest->next_connect_ms) {
+            rtmp_fanout_count_drop(dest);
+            return;
+        }
+        if (rtmp_fanout_destination_connect(dest) != 0) {
+            rtmp_fanout_count_drop(dest);
+            return;
+        }
+    }
+    if (dest->stats.waiting_for_keyframe) {
+        if (!frame->is_key_frame) {
+            rtmp_fanout_count_drop(dest);
+            return;
+        }
+        pthread_mutex_lock(&dest->lock);
+        dest->stats.waiting_for_keyframe = 0;
+        pthread_mutex_unlock(&dest->lock);
+    }
+
+    if (rtmp_fanout_destination_send(dest, frame) != 0) {
+        rtmp_publisher_close(&dest->publisher);
+        pthread_mutex_lock(&dest->lock);
+        dest->stats.send_failures++;
+        dest->stats.waiting_for_keyframe = 1;
+        pthread_mutex_unlock(&dest->lock);
+        retry_ms = rtmp_fanout_schedule_retry(dest);
+        fprintf(stderr, "[RTMP] event=fanout_send_failed dest=%d url=%s ts_ms=%u retry_ms=%d send_timeouts=%llu\n",
+                dest->index,
+                dest->url,
+                frame->timestamp_ms,
+                retry_ms,
+                (unsigned long long)dest->publisher.send_timeouts);
+        return;
+    }
+    pthread_mutex_lock(&dest->lock);
+    dest->stats.sent_frames++;
+    pthread_mutex_unlock(&dest->lock);
+}
+
+/**
+ * @description: 目的地发送线程主函数
+ * @param {void *} arg
+ * @return {static void *}
+ */
+static void *rtmp_fanout_destination_thread(void *arg) {
+    RtmpFanoutDestination *dest = (RtmpFanoutDestination *)arg;
+    RtmpFanoutFrame *frame;
+
+    while (1) {
+        pthread_mutex_lock(&dest->lock);
+        while (!dest->stop_requested && dest->queue_size == 0) {
+            pthread_cond_wait(&dest->cond, &dest->lock);
+        }
+        /* 退出时不再发送残留帧，残留引用由 stop 统一释放。 */
+        if (dest->stop_requested) {
+            pthread_mutex_unlock(&dest->lock);
+            break;
+        }
+        frame = rtmp_fanout_pop_locked(dest);
+        pthread_mutex_unlock(&dest->lock);
+
+        rtmp_fanout_destination_handle(dest, frame);
+        rtmp_fanout_frame_release(dest->owner, frame);
+    }
+
+    rtmp_publisher_close(&dest->publisher);
+    pthread_mutex_lock(&dest->lock);
+    dest->stats.connected = 0;
+    pthread_mutex_unlock(&dest->lock);
+    return NULL;
+}
+
+/**
+ * @description: 打印各目的地的运行统计
+ * @param {RtmpFanoutImpl *} impl
+ * @return {static void}
+ */
+static void rtmp_fanout_log_stats(RtmpFanoutImpl *impl) {
+    int i;
+
+    for (i = 0; i < impl->destination_count; ++i) {
+        RtmpFanoutDestinationStats stats;
+        RtmpFanoutDestination *dest = &impl->destinations[i];
+
+        pthread_mutex_lock(&dest->lock);
+        stats = dest->stats;
+        pthread_mutex_unlock(&dest->lock);
+        printf("[RTMP] event=fanout_stats dest=%d url=%s connected=%d sent=%llu dropped=%llu queue=%d connect_failures=%llu send_failures=%llu backoff_ms=%d packetized=%llu pool_exhausted=%llu\n",
+               i,
+               dest->url,
+               stats.connected,
+               (unsigned long long)stats.sent_frames,
+               (unsigned long long)stats.dropped_frames,
+               stats.queue_depth,
+               (unsigned long long)stats.connect_failures,
+               (unsigned long long)stats.send_failures,
+               stats.backoff_ms,
+               (unsigned long long)impl->packetized_frames,
+               (unsigned long long)impl->pool_exhausted);
+    }
+}
+
+/**
+ * @description: SPS/PPS 变化后重新生成共享的 sequence header 消息体
+ * @param {RtmpFanoutImpl *} impl
+ * @return {static int}
+ */
+static int rtmp_fanout_update_sequence_header(RtmpFanoutImpl *impl) {
+    uint8_t header[13];
+    uint8_t pps_header[3];
+    struct iovec iov[4];
+    uint8_t *body;
+    size_t len = 0;
+    MediaBuffer *buffer = NULL;
+    int i;
+
+    if (rtmp_flv_build_sequence_header(&impl->params, header, pps_header, iov) != 0) {
+        return 0;
+    }
+    for (i = 0; i < 4; ++i) {
+        len += iov[i].iov_len;
+    }
+    body = (uint8_t *)malloc(len);
+    if (!body) {
+        fprintf(stderr, "[RTMP][ERROR] fanout sequence header alloc failed size=%zu\n", len);
+        return -1;
+    }
+    len = 0;
+    for (i = 0; i < 4; ++i) {
+        memcpy(body + len, iov[i].iov_base, iov[i].iov_len);
+        len += iov[i].iov_len;
+    }
+    if (media_buffer_create_copy(body, len, &buffer) != 0) {
+        free(body);
+        fprintf(stderr, "[RTMP][ERROR] fanout sequence header buffer failed size=%zu\n", len);
+        return -1;
+    }
+    free(body);
+
+    if (impl->sequence_header) {
+        media_buffer_release(impl->sequence_header);
+    }
+    impl->sequence_header = buffer;
+    impl->sequence_generation++;
+    printf("[RTMP] event=fanout_sequence_header sps=%zu pps=%zu generation=%u\n",
+           impl->params.sps_len,
+           impl->params.pps_len,
+           impl->sequence_generation);
+    return 0;
+}
+
+/**
+ * @description: 启动扇出推流：校验地址并拉起各目的地发送线程
+ * @param {MediaSink *} sink
+ * @return {static int}
+ */
+static int rtmp_fanout_start(MediaSink *sink) {
+    RtmpFanoutImpl *impl = (RtmpFanoutImpl *)sink->impl;
+    int i;
+
+    for (i = 0; i < impl->destination_count; ++i) {
+        RtmpFanoutDestination *dest = &impl->destinations[i];
+        if (rtmp_publisher_parse_url(&dest->publisher, dest->url) != 0) {
+            fprintf(stderr, "[WARN] RTMP fanout disabled: invalid publish_url=%s, expect rtmp://host[:port]/app/stream\n",
+                    dest->url);
+            return -1;
+        }
+    }
+
+    for (i = 0; i < impl->destination_count; ++i) {
+        RtmpFanoutDestination *dest = &impl->destinations[i];
+        dest->stop_requested = 0;
+        if (pthread_create(&dest->thread, NULL, rtmp_fanout_destination_thread, dest) != 0) {
+            fprintf(stderr, "[RTMP][ERROR] fanout start failed: pthread_create dest=%d\n", i);
+            sink->vtable->stop(sink);
+            return -1;
+        }
+        dest->running = 1;
+        printf("[INFO] RTMP fanout destination=%d configured: %s\n", i, dest->url);
+    }
+    return 0;
+}
+
+/**
+ * @description: 扇出通道本身不持有网络连接，各目的地在自己的线程里连接
+ * @param {MediaSink *} sink
+ * @return {static int}
+ */
+static int rtmp_fanout_connect(MediaSink *sink) {
+    (void)sink;
+    return 0;
+}
+
+/**
+ * @description: 封装一帧并投递给所有目的地
+ * @param {MediaSink *} sink
+ * @param {const MediaPacket *} packet
+ * @return {static int}
+ */
+static int rtmp_fanout_send_packet(MediaSink *sink, const MediaPacket *packet) {
+    RtmpFanoutImpl *impl = (RtmpFanoutImpl *)sink->impl;
+    RtmpFanoutFrame *frame;
+    size_t nalu_count = 0;
+    int params_changed = 0;
+    int iov_count;
+    int i;
+
+    if (!impl || !packet || !packet->buffer) {
+        return -1;
+    }
+    if (packet->frame_type != MEDIA_FRAME_TYPE_VIDEO || packet->codec != MEDIA_CODEC_H264) {
+        return 0;
+    }
+
+    if (rtmp_flv_split_annexb(packet->buffer->data, packet->buffer->size, impl->nalus, RTMP_FLV_MAX_NALUS, &nalu_count) != 0) {
+        fprintf(stderr, "[RTMP][ERROR] fanout split annexb failed frame=%" PRIu64 " size=%zu\n",
+                packet->frame_id,
+                packet->buffer->size);
+        return -1;
+    }
+    if (rtmp_flv_cache_parameter_sets(&impl->params, impl->nalus, nalu_count, &params_changed) != 0) {
+        return -1;
+    }
+    if (params_changed && rtmp_fanout_update_sequence_header(impl) != 0) {
+        return -1;
+    }
+    if (!impl->sequence_header) {
+        fprintf(stderr, "[WARN] RTMP fanout skip frame=%" PRIu64 " because SPS/PPS not ready\n", packet->frame_id);
+        return 0;
+    }
+
+    frame = rtmp_fanout_frame_take(impl);
+    if (!frame) {
+        impl->pool_exhausted++;
+        return 0;
+    }
+    iov_count = rtmp_flv_build_avc_payload(impl->nalus,
+                                           nalu_count,
+                                           packet->is_key_frame,
+                                           frame->tag_header,
+                                           frame->nalu_prefix,
+                                           frame->iov);
+    frame->ref_count = 1;
+    if (iov_count == 1) {
+        rtmp_fanout_frame_release(impl, frame);
+        return 0;
+    }
+    frame->iov_count = iov_count;
+    frame->timestamp_ms = rtmp_flv_packet_timestamp_ms(packet);
+    frame->is_key_frame = packet->is_key_frame;
+    media_packet_copy_ref(&frame->packet, packet);
+    media_buffer_retain(impl->sequence_header);
+    frame->sequence_header = impl->sequence_header;
+    frame->sequence_generation = impl->sequence_generation;
+
+    /* 每个目的地各持一份引用，封装线程自己的引用在投递完成后释放。 */
+    frame->ref_count = impl->destination_count + 1;
+    for (i = 0; i < impl->destination_count; ++i) {
+        rtmp_fanout_push(&impl->destinations[i], frame);
+    }
+    rtmp_fanout_frame_release(impl, frame);
+
+    impl->packetized_frames++;
+    if ((impl->packetized_frames % RTMP_FANOUT_STATS_INTERVAL_FRAMES) == 0) {
+        rtmp_fanout_log_stats(impl);
+    }
+    return 0;
+}
+
+/**
+ * @description: 停止所有目的地线程并释放扇出通道资源
+ * @param {MediaSink *} sink
+ * @return {static void}
+ */
+static void rtmp_fanout_stop(MediaSink *sink) {
+    RtmpFanoutImpl *impl = (RtmpFanoutImpl *)sink->impl;
+    int was_running = 0;
+    int i;
+
+    if (!impl) {
+        return;
+    }
+
+    for (i = 0; i < impl->destination_count; ++i) {
+        RtmpFanoutDestination *dest = &impl->destinations[i];
+        RtmpFanoutFrame *frame;
+
+        if (dest->running) {
+            pthread_mutex_lock(&dest->lock);
+            dest->stop_requested = 1;
+            pthread_cond_broadcast(&dest->cond);
+            pthread_mutex_unlock(&dest->lock);
+            pthread_join(dest->thread, NULL);
+            dest->running = 0;
+            was_running = 1;
+        }
+        pthread_mutex_lock(&dest->lock);
+        while ((frame = rtmp_fanout_pop_locked(dest)) != NULL) {
+            rtmp_fanout_frame_release(impl, frame);
+        }
+        pthread_mutex_unlock(&dest->lock);
+        rtmp_publisher_deinit(&dest->publisher);
+    }
+    if (was_running && impl->packetized_frames > 0) {
+        rtmp_fanout_log_stats(impl);
+    }
+    rtmp_flv_free_parameter_sets(&impl->params);
+    if (impl->sequence_header) {
+        media_buffer_release(impl->sequence_header);
+        impl->sequence_header = NULL;
+    }
+}
+
+int rtmp_fanout_sink_destination_count(MediaSink *sink) {
+    RtmpFanoutImpl *impl = sink ? (RtmpFanoutImpl *)sink->impl : NULL;
+    return impl ? impl->destination_count : 0;
+}
+
+int rtmp_fanout_sink_get_destination_stats(MediaSink *sink, int index, RtmpFanoutDestinationStats *stats) {
+    RtmpFanoutImpl *impl = sink ? (RtmpFanoutImpl *)sink->impl : NULL;
+    RtmpFanoutDestination *dest;
+
+    if (!impl || !stats || index < 0 || index >= impl->destination_count) {
+        return -1;
+    }
+    dest = &impl->destinations[index];
+    pthread_mutex_lock(&dest->lock);
+    *stats = dest->stats;
+    pthread_mutex_unlock(&dest->lock);
+    return 0;
+}
+
+uint64_t rtmp_fanout_sink_packetized_frames(MediaSink *sink) {
+    RtmpFanoutImpl *impl = sink ? (RtmpFanoutImpl *)sink->impl : NULL;
+    return impl ? impl->packetized_frames : 0;
+}
+
+/**
+ * @description: 释放 setup 过程中已分配的资源
+ * @param {RtmpFanoutImpl *} impl
+ * @return {static void}
+ */
+static void rtmp_fanout_free(RtmpFanoutImpl *impl) {
+    int i;
+
+    for (i = 0; i < impl->destination_count; ++i) {
+        RtmpFanoutDestination *dest = &impl->destinations[i];
+        free(dest->queue);
+        pthread_cond_destroy(&dest->cond);
+        pthread_mutex_destroy(&dest->lock);
+    }
+    pthread_mutex_destroy(&impl->pool_lock);
+    free(impl->pool);
+    free(impl);
+}
+
+/**
+ * @description: 根据配置创建多目的地 RTMP 推流通道
+ * @param {MediaSink *} sink
+ * @param {const RtmpSinkConfig *} config
+ * @return {int}
+ */
+int rtmp_fanout_sink_setup(MediaSink *sink, const RtmpSinkConfig *config) {
+    static const MediaSinkVTable vtable = {
+        rtmp_fanout_start,
+        rtmp_fanout_connect,
+        rtmp_fanout_send_packet,
+        NULL,
+        rtmp_fanout_stop,
+        NULL,
+        NULL
+    };
+    MediaSinkConfig sink_config;
+    RtmpFanoutImpl *impl;
+    const char *cursor;
+    int count;
+    int i;
+
+    if (!sink || !config) {
+        fprintf(stderr, "[RTMP][ERROR] fanout_setup failed: invalid arguments\n");
+        return -1;
+    }
+    count = rtmp_fanout_url_count(config->publish_url);
+    if (count <= 0 || count > RTMP_FANOUT_MAX_DESTINATIONS) {
+        fprintf(stderr, "[RTMP][ERROR] fanout_setup failed: url count=%d max=%d\n", count, RTMP_FANOUT_MAX_DESTINATIONS);
+        return -1;
+    }
+
+    impl = (RtmpFanoutImpl *)calloc(1, sizeof(*impl));
+    if (!impl) {
+        fprintf(stderr, "[RTMP][ERROR] fanout_setup failed: impl alloc\n");
+        return -1;
+    }
+    impl->config = *config;
+    if (!impl->config.name) {
+        impl->config.name = DEFAULT_RTMP_FANOUT_NAME;
+    }
+    if (impl->config.queue_capacity <= 0) {
+        impl->config.queue_capacity = DEFAULT_RTMP_FANOUT_QUEUE_CAPACITY;
+    }
+    if (impl->config.reconnect_interval_ms <= 0) {
+        impl->config.reconnect_interval_ms = DEFAULT_RTMP_FANOUT_RECONNECT_INTERVAL_MS;
+    }
+    if (impl->config.max_reconnect_interval_ms <= 0) {
+        impl->config.max_reconnect_interval_ms = DEFAULT_RTMP_FANOUT_MAX_RECONNECT_INTERVAL_MS;
+    }
+    if (impl->config.max_reconnect_interval_ms < impl->config.reconnect_interval_ms) {
+        impl->config.max_reconnect_interval_ms = impl->config.reconnect_interval_ms;
+    }
+    if (impl->config.connect_timeout_ms <= 0) {
+        impl->config.connect_timeout_ms = DEFAULT_RTMP_FANOUT_CONNECT_TIMEOUT_MS;
+    }
+    if (impl->config.chunk_size <= 0) {
+        impl->config.chunk_size = DEFAULT_RTMP_FANOUT_CHUNK_SIZE;
+    }
+    if (impl->config.send_timeout_ms <= 0) {
+        impl->config.send_timeout_ms = DEFAULT_RTMP_FANOUT_SEND_TIMEOUT_MS;
+    }
+    impl->metadata_len = rtmp_flv_build_metadata(impl->metadata, &impl->config);
+
+    /* 每个目的地队列最多持有 queue_capacity 帧，另加各发送线程手里的一帧和封装中的一帧。 */
+    impl->pool_size = impl->config.queue_capacity * count + count + 1;
+    impl->pool = (RtmpFanoutFrame *)calloc((size_t)impl->pool_size, sizeof(RtmpFanoutFrame));
+    if (!impl->pool) {
+        fprintf(stderr, "[RTMP][ERROR] fanout_setup failed: frame pool alloc size=%d\n", impl->pool_size);
+        free(impl);
+        return -1;
+    }
+    for (i = 0; i < impl->pool_size; ++i) {
+        media_packet_init(&impl->pool[i].packet);
+        impl->pool[i].next_free = impl->free_frames;
+        impl->free_frames = &impl->pool[i];
+    }
+    pthread_mutex_init(&impl->pool_lock, NULL);
+
+    cursor = config->publish_url;
+    for (i = 0; i < count; ++i) {
+        RtmpFanoutDestination *dest = &impl->destinations[i];
+
+        rtmp_fanout_next_url(&cursor, dest->url, sizeof(dest->url));
+        dest->owner = impl;
+        dest->index = i;
+        dest->queue_capacity = impl->config.queue_capacity;
+        dest->queue = (RtmpFanoutFrame **)calloc((size_t)dest->queue_capacity, sizeof(RtmpFanoutFrame *));
+        pthread_mutex_init(&dest->lock, NULL);
+        pthread_cond_init(&dest->cond, NULL);
+        dest->stats.backoff_ms = impl->config.reconnect_interval_ms;
+        dest->stats.waiting_for_keyframe = 1;
+        rtmp_publisher_init(&dest->publisher, impl->config.chunk_size, impl->config.send_timeout_ms);
+        impl->destination_count++;
+        if (!dest->queue) {
+            fprintf(stderr, "[RTMP][ERROR] fanout_setup failed: queue alloc dest=%d\n", i);
+            rtmp_fanout_free(impl);
+            return -1;
+        }
+    }
+
+    memset(&sink_config, 0, sizeof(sink_config));
+    sink_config.name = impl->config.name;
+    sink_config.queue_capacity = impl->config.queue_capacity;
+    sink_config.reconnect_interval_ms = impl->config.reconnect_interval_ms;
+    sink_config.drop_until_keyframe_after_reconnect = 1;
+
+    if (media_sink_init(sink, &sink_config, &vtable, impl) != 0) {
+        fprintf(stderr, "[RTMP][ERROR] fanout_setup failed: media_sink_init name=%s\n", impl->config.name);
+        rtmp_fanout_free(impl);
+        return -1;
+    }
+    printf("[INFO] RTMP fanout configured name=%s destinations=%d queue=%d frame_pool=%d\n",
+           impl->config.name,
+           impl->destination_count,
+           impl->config.queue_capacity,
+           impl->pool_size);
+    return 0;
+}
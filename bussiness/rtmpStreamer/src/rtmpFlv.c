@@ -0,0 +1,246 @@
+#include "rtmpFlv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rtmpPublisher.h"
+
+/**
+ * @description: 按大端序写入 32 位整数
+ * @param {uint8_t *} dst
+ * @param {uint32_t} value
+ * @return {static void}
+ */
+static void write_be32(uint8_t *dst, uint32_t value) {
+    dst[0] = (uint8_t)((value >> 24) & 0xFF);
+    dst[1] = (uint8_t)((value >> 16) & 0xFF);
+    dst[2] = (uint8_t)((value >> 8) & 0xFF);
+    dst[3] = (uint8_t)(value & 0xFF);
+}
+
+/**
+ * @description: 按大端序写入 16 位整数
+ * @param {uint8_t *} dst
+ * @param {uint16_t} value
+ * @return {static void}
+ */
+static void write_be16(uint8_t *dst, uint16_t value) {
+    dst[0] = (uint8_t)((value >> 8) & 0xFF);
+    dst[1] = (uint8_t)(value & 0xFF);
+}
+
+/**
+ * @description: 释放缓存的 SPS 或 PPS 数据
+ * @param {uint8_t **} data
+ * @param {size_t *} size
+ * @return {static void}
+ */
+static void free_parameter_set(uint8_t **data, size_t *size) {
+    if (*data) {
+        free(*data);
+        *data = NULL;
+    }
+    *size = 0;
+}
+
+/**
+ * @description: 更新缓存的 SPS 或 PPS 数据
+ * @param {uint8_t **} dst
+ * @param {size_t *} dst_len
+ * @param {const uint8_t *} src
+ * @param {size_t} src_len
+ * @param {int *} changed
+ * @return {static int}
+ */
+static int update_parameter_set(uint8_t **dst, size_t *dst_len, const uint8_t *src, size_t src_len, int *changed) {
+    uint8_t *copy;
+
+    if (!dst || !dst_len || !src || src_len == 0) {
+        fprintf(stderr, "[RTMP][ERROR] update_parameter_set invalid args\n");
+        return -1;
+    }
+
+    if (*dst && *dst_len == src_len && memcmp(*dst, src, src_len) == 0) {
+        return 0;
+    }
+
+    copy = (uint8_t *)malloc(src_len);
+    if (!copy) {
+        fprintf(stderr, "[RTMP][ERROR] update_parameter_set alloc failed size=%zu\n", src_len);
+        return -1;
+    }
+    memcpy(copy, src, src_len);
+
+    free_parameter_set(dst, dst_len);
+    *dst = copy;
+    *dst_len = src_len;
+    if (changed) {
+        *changed = 1;
+    }
+    return 0;
+}
+
+int rtmp_flv_split_annexb(const uint8_t *data, size_t len, RtmpNaluView *nalus, size_t capacity, size_t *out_count) {
+    if (!data || len == 0 || !nalus || capacity == 0 || !out_count) {
+        fprintf(stderr, "[RTMP][ERROR] annexb_split_nalus invalid args len=%zu\n", len);
+        return -1;
+    }
+
+    /* 没有起始码的裸 NALU 由共享拆分器按整段处理，负载不拷贝。 */
+    if (media_annexb_split(data, len, nalus, capacity, out_count) != 0) {
+        fprintf(stderr, "[RTMP][ERROR] annexb_split_nalus too many NALUs capacity=%zu\n", capacity);
+        return -1;
+    }
+    return 0;
+}
+
+int rtmp_flv_cache_parameter_sets(RtmpAvcParamSets *sets, const RtmpNaluView *nalus, size_t count, int *changed) {
+    size_t i;
+
+    if (changed) {
+        *changed = 0;
+    }
+    for (i = 0; i < count; ++i) {
+        uint8_t nalu_type;
+
+        if (!nalus[i].data || nalus[i].size == 0) {
+            continue;
+        }
+        nalu_type = (uint8_t)(nalus[i].data[0] & 0x1F);
+        /* SPS/PPS 可能会随着 IDR 帧重复出现，只有内容真正变化时才刷新缓存。 */
+        if (nalu_type == 7) {
+            if (update_parameter_set(&sets->sps, &sets->sps_len, nalus[i].data, nalus[i].size, changed) != 0) {
+                fprintf(stderr, "[RTMP][ERROR] cache SPS failed size=%zu\n", nalus[i].size);
+                return -1;
+            }
+        } else if (nalu_type == 8) {
+            if (update_parameter_set(&sets->pps, &sets->pps_len, nalus[i].data, nalus[i].size, changed) != 0) {
+                fprintf(stderr, "[RTMP][ERROR] cache PPS failed size=%zu\n", nalus[i].size);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+void rtmp_flv_free_parameter_sets(RtmpAvcParamSets *sets) {
+    if (!sets) {
+        return;
+    }
+    free_parameter_set(&sets->sps, &sets->sps_len);
+    free_parameter_set(&sets->pps, &sets->pps_len);
+}
+
+size_t rtmp_flv_build_metadata(uint8_t *body, const RtmpSinkConfig *config) {
+    uint8_t *p = body;
+
+    /* 在 AVC 解码配置和视频帧之前先发送标准 AMF0 onMetaData 消息。
+     * 很多 RTMP 服务端和播放器会依赖这些字段做流信息展示、解码器预热，
+     * 或在控制台中显示分辨率、帧率、码率等运行信息。
+     */
+    p = rtmp_amf_write_string(p, "onMetaData");
+    *p++ = RTMP_AMF0_ECMA_ARRAY;
+    write_be32(p, 10);
+    p += 4;
+    p = rtmp_amf_write_number(rtmp_amf_write_key(p, "duration"), 0.0);
+    p = rtmp_amf_write_number(rtmp_amf_write_key(p, "width"), (double)config->video_width);
+    p = rtmp_amf_write_number(rtmp_amf_write_key(p, "height"), (double)config->video_height);
+    p = rtmp_amf_write_number(rtmp_amf_write_key(p, "framerate"), (double)config->video_fps);
+    p = rtmp_amf_write_number(rtmp_amf_write_key(p, "videodatarate"), (double)config->video_bitrate / 1000.0);
+    p = rtmp_amf_write_number(rtmp_amf_write_key(p, "videocodecid"), 7.0);
+    p = rtmp_amf_write_bool(rtmp_amf_write_key(p, "hasVideo"), 1);
+    p = rtmp_amf_write_bool(rtmp_amf_write_key(p, "hasAudio"), config->audio_enabled ? 1 : 0);
+    p = rtmp_amf_write_string(rtmp_amf_write_key(p, "encoder"), config->encoder_name ? config->encoder_name : "RKMediaGateway");
+    p = rtmp_amf_write_string(rtmp_amf_write_key(p, "videocodecname"), config->video_codec_name ? config->video_codec_name : "H264");
+    p = rtmp_amf_write_object_end(p);
+    return (size_t)(p - body);
+}
+
+int rtmp_flv_build_sequence_header(const RtmpAvcParamSets *sets, uint8_t *header, uint8_t *pps_header, struct iovec *iov) {
+    if (!sets || !sets->sps || !sets->pps || sets->sps_len < 4 || sets->pps_len == 0) {
+        return -1;
+    }
+
+    /* FLV 的 AVC sequence header 内部承载 AVCDecoderConfigurationRecord，
+     * 包含版本、profile、compatibility、level 以及原始 SPS/PPS 内容。
+     * RTMP 接收端必须先拿到这段信息，后续才能正确解码 AVCPacketType=1 的视频负载。
+     * SPS/PPS 直接引用缓存，不再拼接整块消息体。
+     */
+    header[0] = (uint8_t)((FLV_FRAME_KEY << 4) | FLV_VIDEO_CODEC_AVC);
+    header[1] = FLV_AVC_SEQ_HEADER;
+    header[2] = 0;
+    header[3] = 0;
+    header[4] = 0;
+    header[5] = 1;
+    header[6] = sets->sps[1];
+    header[7] = sets->sps[2];
+    header[8] = sets->sps[3];
+    header[9] = 0xFF;
+    header[10] = 0xE1;
+    write_be16(header + 11, (uint16_t)sets->sps_len);
+    pps_header[0] = 1;
+    write_be16(pps_header + 1, (uint16_t)sets->pps_len);
+    iov[0].iov_base = header;
+    iov[0].iov_len = 13;
+    iov[1].iov_base = sets->sps;
+    iov[1].iov_len = sets->sps_len;
+    iov[2].iov_base = pps_header;
+    iov[2].iov_len = 3;
+    iov[3].iov_base = sets->pps;
+    iov[3].iov_len = sets->pps_len;
+    return 0;
+}
+
+int rtmp_flv_build_avc_payload(const RtmpNaluView *nalus,
+                               size_t count,
+                               int is_key_frame,
+                               uint8_t *tag_header,
+                               uint8_t (*prefix)[4],
+                               struct iovec *iov) {
+    int iov_count = 1;
+    size_t i;
+
+    /* 把 Annex-B 帧负载转换成 FLV/AVC 负载格式：
+     * 每个媒体 NALU 会被编码成 [4 字节大端长度][nalu 数据]。
+     * SPS/PPS/AUD 不再重复写入，因为它们已经在 sequence header 中单独发送过。
+     * 长度前缀和 NALU 以分段形式交给发送端聚合写出，NALU 负载直接引用共享 MediaBuffer。
+     */
+    tag_header[0] = (uint8_t)(((is_key_frame ? FLV_FRAME_KEY : FLV_FRAME_INTER) << 4) | FLV_VIDEO_CODEC_AVC);
+    tag_header[1] = FLV_AVC_NALU;
+    tag_header[2] = 0;
+    tag_header[3] = 0;
+    tag_header[4] = 0;
+    iov[0].iov_base = tag_header;
+    iov[0].iov_len = 5;
+
+    for (i = 0; i < count; ++i) {
+        const RtmpNaluView *nalu = &nalus[i];
+        uint8_t nalu_type;
+
+        if (!nalu->data || nalu->size == 0) {
+            continue;
+        }
+        nalu_type = (uint8_t)(nalu->data[0] & 0x1F);
+        if (nalu_type == 7 || nalu_type == 8 || nalu_type == 9) {
+            continue;
+        }
+        write_be32(prefix[i], (uint32_t)nalu->size);
+        iov[iov_count].iov_base = prefix[i];
+        iov[iov_count].iov_len = 4;
+        iov[iov_count + 1].iov_base = (void *)nalu->data;
+        iov[iov_count + 1].iov_len = nalu->size;
+        iov_count += 2;
+    }
+    return iov_count;
+}
+
+uint32_t rtmp_flv_packet_timestamp_ms(const MediaPacket *packet) {
+    uint64_t ts_us;
+
+    if (!packet) {
+        return 0;
+    }
+    ts_us = packet->dts_us ? packet->dts_us : packet->pts_us;
+    return (uint32_t)(ts_us / 1000ULL);
+}
@@ -0,0 +1,1047 @@
+#include "rtmpPublisher.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_RTMP_PORT 1935
+#define DEFAULT_RTMP_CHUNK_SIZE 4096
+#define DEFAULT_RTMP_SEND_TIMEOUT_MS 2000
+#define RTMP_MAX_CHUNK_SIZE 65536
+#define RTMP_HANDSHAKE_SIZE 1536
+#define RTMP_CSID_CONTROL 2
+#define RTMP_CSID_COMMAND 3
+#define RTMP_CSID_AUDIO 4
+#define RTMP_CSID_DATA 5
+#define RTMP_CSID_VIDEO 6
+#define RTMP_MAX_SEND_IOV 1024
+#define RTMP_RECV_BUFFER (RTMP_PUBLISHER_MAX_IN_MESSAGE + 64)
+#define RTMP_USER_CONTROL_PING_REQUEST 6
+#define RTMP_USER_CONTROL_PING_RESPONSE 7
+
+typedef struct {
+    const uint8_t *p;   /* 当前读位置。 */
+    const uint8_t *end; /* 消息体结束位置。 */
+} AmfReader;
+
+/**
+ * @description: 获取单调时钟毫秒数
+ * @return {static long long}
+ */
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+/**
+ * @description: 按大端序读取 24 位整数
+ * @param {const uint8_t *} p
+ * @return {static uint32_t}
+ */
+static uint32_t read_be24(const uint8_t *p) {
+    return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+}
+
+/**
+ * @description: 按大端序读取 32 位整数
+ * @param {const uint8_t *} p
+ * @return {static uint32_t}
+ */
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/**
+ * @description: 按大端序写入 24 位整数
+ * @param {uint8_t *} p
+ * @param {uint32_t} v
+ * @return {static void}
+ */
+static void write_be24(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 16);
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)v;
+}
+
+/**
+ * @description: 按大端序写入 32 位整数
+ * @param {uint8_t *} p
+ * @param {uint32_t} v
+ * @return {static void}
+ */
+static void write_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+uint8_t *rtmp_amf_write_number(uint8_t *dst, double value) {
+    uint64_t bits;
+    int i;
+    memcpy(&bits, &value, sizeof(bits));
+    *dst++ = RTMP_AMF0_NUMBER;
+    for (i = 7; i >= 0; --i) *dst++ = (uint8_t)(bits >> (i * 8));
+    return dst;
+}
+
+uint8_t *rtmp_amf_write_bool(uint8_t *dst, int value) {
+    *dst++ = RTMP_AMF0_BOOLEAN;
+    *dst++ = value ? 1 : 0;
+    return dst;
+}
+
+uint8_t *rtmp_amf_write_string(uint8_t *dst, const char *str) {
+    size_t len = str ? strlen(str) : 0;
+    *dst++ = RTMP_AMF0_STRING;
+    *dst++ = (uint8_t)(len >> 8);
+    *dst++ = (uint8_t)len;
+    if (len > 0) memcpy(dst, str, len);
+    return dst + len;
+}
+
+uint8_t *rtmp_amf_write_null(uint8_t *dst) {
+    *dst++ = RTMP_AMF0_NULL;
+    return dst;
+}
+
+uint8_t *rtmp_amf_write_key(uint8_t *dst, const char *name) {
+    size_t len = name ? strlen(name) : 0;
+    *dst++ = (uint8_t)(len >> 8);
+    *dst++ = (uint8_t)len;
+    if (len > 0) memcpy(dst, name, len);
+    return dst + len;
+}
+
+uint8_t *rtmp_amf_write_object_end(uint8_t *dst) {
+    dst[0] = 0;
+    dst[1] = 0;
+    dst[2] = RTMP_AMF0_OBJECT_END;
+    return dst + 3;
+}
+
+/**
+ * @description: 读取一个 AMF0 字符串值
+ * @param {AmfReader *} r
+ * @param {char *} out 可为 NULL，只跳过
+ * @param {size_t} out_size
+ * @return {static int}
+ */
+static int amf_read_string(AmfReader *r, char *out, size_t out_size) {
+    size_t len;
+    if (r->end - r->p < 3 || r->p[0] != RTMP_AMF0_STRING) return -1;
+    len = ((size_t)r->p[1] << 8) | r->p[2];
+    r->p += 3;
+    if ((size_t)(r->end - r->p) < len) return -1;
+    if (out && out_size > 0) {
+        size_t n = (len < out_size - 1) ? len : out_size - 1;
+        memcpy(out, r->p, n);
+        out[n] = '\0';
+    }
+    r->p += len;
+    return 0;
+}
+
+/**
+ * @description: 读取一个 AMF0 数值
+ * @param {AmfReader *} r
+ * @param {double *} out
+ * @return {static int}
+ */
+static int amf_read_number(AmfReader *r, double *out) {
+    uint64_t bits = 0;
+    int i;
+    if (r->end - r->p < 9 || r->p[0] != RTMP_AMF0_NUMBER) return -1;
+    for (i = 1; i <= 8; ++i) bits = (bits << 8) | r->p[i];
+    memcpy(out, &bits, sizeof(*out));
+    r->p += 9;
+    return 0;
+}
+
+/**
+ * @description: 跳过一个 AMF0 值（对象和数组按属性递归跳过）
+ * @param {AmfReader *} r
+ * @param {int} depth 递归深度，防止恶意嵌套
+ * @return {static int}
+ */
+static int amf_skip_value(AmfReader *r, int depth) {
+    uint8_t marker;
+    if (r->p >= r->end || depth > 8) return -1;
+    marker = r->p[0];
+    switch (marker) {
+    case RTMP_AMF0_NUMBER:
+        if (r->end - r->p < 9) return -1;
+        r->p += 9;
+        return 0;
+    case RTMP_AMF0_BOOLEAN:
+        if (r->end - r->p < 2) return -1;
+        r->p += 2;
+        return 0;
+    case RTMP_AMF0_STRING:
+        return amf_read_string(r, NULL, 0);
+    case RTMP_AMF0_NULL:
+    case RTMP_AMF0_UNDEFINED:
+        r->p += 1;
+        return 0;
+    case RTMP_AMF0_ECMA_ARRAY:
+    case RTMP_AMF0_OBJECT:
+        if (r->end - r->p < ((marker == RTMP_AMF0_ECMA_ARRAY) ? 5 : 1)) return -1;
+        r->p += (marker == RTMP_AMF0_ECMA_ARRAY) ? 5 : 1;
+        while (r->end - r->p >= 3) {
+            size_t key_len = ((size_t)r->p[0] << 8) | r->p[1];
+            if (key_len == 0 && r->p[2] == RTMP_AMF0_OBJECT_END) {
+                r->p += 3;
+                return 0;
+            }
+            r->p += 2;
+            if ((size_t)(r->end - r->p) < key_len) return -1;
+            r->p += key_len;
+            if (amf_skip_value(r, depth + 1) != 0) return -1;
+        }
+        return -1;
+    case RTMP_AMF0_STRICT_ARRAY: {
+        uint32_t count;
+        uint32_t i;
+        if (r->end - r->p < 5) return -1;
+        count = read_be32(r->p + 1);
+        r->p += 5;
+        for (i = 0; i < count; ++i) {
+            if (amf_skip_value(r, depth + 1) != 0) return -1;
+        }
+        return 0;
+    }
+    default:
+        return -1;
+    }
+}
+
+/**
+ * @description: 读取 onStatus 信息对象里的 level 和 code 字段
+ * @param {AmfReader *} r
+ * @param {char *} level
+ * @param {size_t} level_size
+ * @param {char *} code
+ * @param {size_t} code_size
+ * @return {static int}
+ */
+static int amf_read_status(AmfReader *r, char *level, size_t level_size, char *code, size_t code_size) {
+    if (r->p >= r->end || r->p[0] != RTMP_AMF0_OBJECT) return -1;
+    r->p += 1;
+    while (r->end - r->p >= 3) {
+        size_t key_len = ((size_t)r->p[0] << 8) | r->p[1];
+        const char *key = (const char *)r->p + 2;
+        if (key_len == 0 && r->p[2] == RTMP_AMF0_OBJECT_END) {
+            r->p += 3;
+            return 0;
+        }
+        r->p += 2;
+        if ((size_t)(r->end - r->p) < key_len) return -1;
+        r->p += key_len;
+        if (key_len == 5 && memcmp(key, "level", 5) == 0 && r->p < r->end && r->p[0] == RTMP_AMF0_STRING) {
+            if (amf_read_string(r, level, level_size) != 0) return -1;
+        } else if (key_len == 4 && memcmp(key, "code", 4) == 0 && r->p < r->end && r->p[0] == RTMP_AMF0_STRING) {
+            if (amf_read_string(r, code, code_size) != 0) return -1;
+        } else if (amf_skip_value(r, 1) != 0) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @description: 等待 fd 就绪，超过截止时间返回 0
+ * @param {int} fd
+ * @param {short} events
+ * @param {long long} deadline_ms
+ * @return {static int} 1 就绪，0 超时，-1 出错
+ */
+static int wait_fd(int fd, short events, long long deadline_ms) {
+    for (;;) {
+        struct pollfd pfd;
+        long long remain = deadline_ms - now_ms();
+        int ret;
+        if (remain <= 0) return 0;
+        pfd.fd = fd;
+        pfd.events = events;
+        pfd.revents = 0;
+        ret = poll(&pfd, 1, (int)remain);
+        if (ret > 0) return 1;
+        if (ret == 0) return 0;
+        if (errno != EINTR) return -1;
+    }
+}
+
+/**
+ * @description: 确保 iov 表和 chunk 头缓冲容量足够，扩容后常驻复用
+ * @param {RtmpPublisher *} pub
+ * @param {int} iov_needed
+ * @param {size_t} headers_needed
+ * @return {static int}
+ */
+static int ensure_send_capacity(RtmpPublisher *pub, int iov_needed, size_t headers_needed) {
+    if (iov_needed > pub->iov_cap) {
+        int cap = pub->iov_cap ? pub->iov_cap : 64;
+        struct iovec *iov;
+        while (cap < iov_needed) cap *= 2;
+        iov = (struct iovec *)realloc(pub->iov, (size_t)cap * sizeof(*iov));
+        if (!iov) {
+            fprintf(stderr, "[RTMP][ERROR] ensure_send_capacity iov alloc failed count=%d\n", cap);
+            return -1;
+        }
+        pub->iov = iov;
+        pub->iov_cap = cap;
+    }
+    if (headers_needed > pub->chunk_headers_cap) {
+        size_t cap = pub->chunk_headers_cap ? pub->chunk_headers_cap : 512;
+        uint8_t *headers;
+        while (cap < headers_needed) cap *= 2;
+        headers = (uint8_t *)realloc(pub->chunk_headers, cap);
+        if (!headers) {
+            fprintf(stderr, "[RTMP][ERROR] ensure_send_capacity header alloc failed size=%zu\n", cap);
+            return -1;
+        }
+        pub->chunk_headers = headers;
+        pub->chunk_headers_cap = cap;
+    }
+    return 0;
+}
+
+/**
+ * @description: 在截止时间内把 iov 全部写出，部分写时原地推进 iov
+ * @param {RtmpPublisher *} pub
+ * @param {struct iovec *} iov 会被修改
+ * @param {int} count
+ * @param {long long} deadline_ms
+ * @return {static int}
+ */
+static int send_iov_all(RtmpPublisher *pub, struct iovec *iov, int count, long long deadline_ms) {
+    while (count > 0) {
+        struct msghdr msg;
+        ssize_t sent;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)((count > RTMP_MAX_SEND_IOV) ? RTMP_MAX_SEND_IOV : count);
+        sent = sendmsg(pub->fd, &msg, MSG_NOSIGNAL);
+        pub->send_calls++;
+        if (sent < 0) {
+            int ready;
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                fprintf(stderr, "[RTMP] event=send_failed errno=%d(%s)\n", errno, strerror(errno));
+                return -1;
+            }
+            pub->send_waits++;
+            ready = wait_fd(pub->fd, POLLOUT, deadline_ms);
+            if (ready == 0) {
+                pub->send_timeouts++;
+                fprintf(stderr, "[RTMP] event=send_timeout timeout_ms=%d pending_iov=%d\n", pub->send_timeout_ms, count);
+                return -1;
+            }
+            if (ready < 0) return -1;
+            continue;
+        }
+        pub->bytes_sent += (uint64_t)sent;
+        while (count > 0 && (size_t)sent >= iov->iov_len) {
+            sent -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0 && sent > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + sent;
+            iov->iov_len -= (size_t)sent;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @description: 切 chunk 并发送一条消息：首个 chunk 用 fmt 0 完整头，其余用 1 字节 fmt 3 头
+ * @param {RtmpPublisher *} pub
+ * @param {int} csid chunk stream id（2~63）
+ * @param {uint8_t} type
+ * @param {uint32_t} timestamp
+ * @param {uint32_t} stream_id
+ * @param {const struct iovec *} payload
+ * @param {int} payload_count
+ * @return {static int}
+ */
+static int send_message_raw(RtmpPublisher *pub,
+                            int csid,
+                            uint8_t type,
+                            uint32_t timestamp,
+                            uint32_t stream_id,
+                            const struct iovec *payload,
+                            int payload_count) {
+    size_t total = 0;
+    size_t chunk_size = (size_t)pub->out_chunk_size;
+    size_t chunks;
+    size_t ext = (timestamp >= 0xFFFFFF) ? 4 : 0;
+    size_t header_bytes;
+    uint8_t *h;
+    size_t in_chunk = 0;
+    size_t seg_off = 0;
+    int seg = 0;
+    int n = 0;
+    int i;
+
+    if (pub->fd < 0) return -1;
+    for (i = 0; i < payload_count; ++i) total += payload[i].iov_len;
+    if (total > 0xFFFFFF) {
+        fprintf(stderr, "[RTMP][ERROR] send_message message too large len=%zu\n", total);
+        return -1;
+    }
+    chunks = (total == 0) ? 1 : (total + chunk_size - 1) / chunk_size;
+    header_bytes = 12 + ext + (chunks - 1) * (1 + ext);
+    if (ensure_send_capacity(pub, (int)(chunks * 2) + payload_count, header_bytes) != 0) return -1;
+
+    h = pub->chunk_headers;
+    h[0] = (uint8_t)(csid & 0x3F);
+    write_be24(h + 1, ext ? 0xFFFFFF : timestamp);
+    write_be24(h + 4, (uint32_t)total);
+    h[7] = type;
+    /* 消息流 ID 是协议里唯一的小端字段。 */
+    h[8] = (uint8_t)stream_id;
+    h[9] = (uint8_t)(stream_id >> 8);
+    h[10] = (uint8_t)(stream_id >> 16);
+    h[11] = (uint8_t)(stream_id >> 24);
+    if (ext) write_be32(h + 12, timestamp);
+    pub->iov[n].iov_base = h;
+    pub->iov[n].iov_len = 12 + ext;
+    n++;
+    h += 12 + ext;
+
+    /* 负载分段按 chunk 边界切开，每个新 chunk 前插入 fmt 3 头（扩展时间戳时附带 4 字节时间戳）。 */
+    while (seg < payload_count) {
+        size_t take;
+        if (seg_off == payload[seg].iov_len) {
+            seg++;
+            seg_off = 0;
+            continue;
+        }
+        if (in_chunk == chunk_size) {
+            h[0] = (uint8_t)(0xC0 | (csid & 0x3F));
+            if (ext) write_be32(h + 1, timestamp);
+            pub->iov[n].iov_base = h;
+            pub->iov[n].iov_len = 1 + ext;
+            n++;
+            h += 1 + ext;
+            in_chunk = 0;
+        }
+        take = payload[seg].iov_len - seg_off;
+        if (take > chunk_size - in_chunk) take = chunk_size - in_chunk;
+        pub->iov[n].iov_base = (uint8_t *)payload[seg].iov_base + seg_off;
+        pub->iov[n].iov_len = take;
+        n++;
+        seg_off += take;
+        in_chunk += take;
+    }
+
+    if (send_iov_all(pub, pub->iov, n, now_ms() + pub->send_timeout_ms) != 0) return -1;
+    pub->messages_sent++;
+    return 0;
+}
+
+/**
+ * @description: 发送只含一段负载的控制/命令消息
+ * @param {RtmpPublisher *} pub
+ * @param {int} csid
+ * @param {uint8_t} type
+ * @param {uint32_t} stream_id
+ * @param {const uint8_t *} body
+ * @param {size_t} len
+ * @return {static int}
+ */
+static int send_simple(RtmpPublisher *pub, int csid, uint8_t type, uint32_t stream_id, const uint8_t *body, size_t len) {
+    struct iovec iov;
+    iov.iov_base = (void *)body;
+    iov.iov_len = len;
+    return send_message_raw(pub, csid, type, 0, stream_id, &iov, 1);
+}
+
+/**
+ * @description: 查找或分配对端 chunk stream 的接收状态
+ * @param {RtmpPublisher *} pub
+ * @param {int} csid
+ * @return {static RtmpInChunkStream *}
+ */
+static RtmpInChunkStream *find_in_stream(RtmpPublisher *pub, int csid) {
+    int i;
+    RtmpInChunkStream *free_slot = NULL;
+    for (i = 0; i < RTMP_PUBLISHER_MAX_IN_STREAMS; ++i) {
+        if (pub->in[i].csid == csid) return &pub->in[i];
+        if (!free_slot && pub->in[i].csid == 0) free_slot = &pub->in[i];
+    }
+    if (!free_slot) {
+        fprintf(stderr, "[RTMP][ERROR] too many peer chunk streams csid=%d\n", csid);
+        return NULL;
+    }
+    if (!free_slot->body) {
+        free_slot->body = (uint8_t *)malloc(RTMP_PUBLISHER_MAX_IN_MESSAGE);
+        if (!free_slot->body) {
+            fprintf(stderr, "[RTMP][ERROR] chunk stream alloc failed csid=%d\n", csid);
+            return NULL;
+        }
+    }
+    free_slot->csid = csid;
+    free_slot->received = 0;
+    return free_slot;
+}
+
+/**
+ * @description: 处理对端的协议控制消息
+ * @param {RtmpPublisher *} pub
+ * @param {const RtmpInChunkStream *} cs
+ * @return {static int}
+ */
+static int handle_control(RtmpPublisher *pub, const RtmpInChunkStream *cs) {
+    switch (cs->type) {
+    case RTMP_MSG_SET_CHUNK_SIZE:
+        if (cs->length >= 4) {
+            uint32_t size = read_be32(cs->body) & 0x7FFFFFFF;
+            if (size == 0 || size > RTMP_PUBLISHER_MAX_IN_MESSAGE) {
+                fprintf(stderr, "[RTMP][ERROR] peer chunk size unsupported size=%u\n", size);
+                return -1;
+            }
+            pub->in_chunk_size = (int)size;
+        }
+        break;
+    case RTMP_MSG_WINDOW_ACK_SIZE:
+        if (cs->length >= 4) pub->window_ack_size = read_be32(cs->body);
+        break;
+    case RTMP_MSG_USER_CONTROL:
+        if (cs->length >= 6 && cs->body[0] == 0 && cs->body[1] == RTMP_USER_CONTROL_PING_REQUEST) {
+            uint8_t pong[6];
+            pong[0] = 0;
+            pong[1] = RTMP_USER_CONTROL_PING_RESPONSE;
+            memcpy(pong + 2, cs->body + 2, 4);
+            return send_simple(pub, RTMP_CSID_CONTROL, RTMP_MSG_USER_CONTROL, 0, pong, sizeof(pong));
+        }
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+/**
+ * @description: 从接收缓冲解析一个完整 chunk；消息收齐时控制消息就地处理，命令/数据消息交给调用方
+ * @param {RtmpPublisher *} pub
+ * @return {static int} 1 有待处理的消息（pub->msg_*），2 消费了一个 chunk 但没有待处理消息，0 数据不足，-1 协议错误
+ */
+static int parse_chunk(RtmpPublisher *pub) {
+    static const size_t header_sizes[4] = {11, 7, 3, 0};
+    const uint8_t *p = pub->recv_buf;
+    size_t avail = pub->recv_len;
+    size_t basic = 1;
+    size_t need;
+    size_t chunk_len;
+    uint32_t ts_field = 0;
+    uint32_t length;
+    int fmt;
+    int csid;
+    int ext;
+    RtmpInChunkStream *cs;
+
+    if (avail < 1) return 0;
+    fmt = p[0] >> 6;
+    csid = p[0] & 0x3F;
+    if (csid == 0) {
+        if (avail < 2) return 0;
+        csid = 64 + p[1];
+        basic = 2;
+    } else if (csid == 1) {
+        if (avail < 3) return 0;
+        csid = 64 + p[1] + p[2] * 256;
+        basic = 3;
+    }
+    need = basic + header_sizes[fmt];
+    if (avail < need) return 0;
+    cs = find_in_stream(pub, csid);
+    if (!cs) return -1;
+    if (fmt <= 2) ts_field = read_be24(p + basic);
+    ext = (fmt <= 2) ? (ts_field == 0xFFFFFF) : cs->extended_timestamp;
+    length = (fmt <= 1) ? read_be24(p + basic + 3) : cs->length;
+    if (length > RTMP_PUBLISHER_MAX_IN_MESSAGE) {
+        fprintf(stderr, "[RTMP][ERROR] peer message too large csid=%d len=%u\n", csid, length);
+        return -1;
+    }
+    chunk_len = length - ((cs->received < length) ? cs->received : length);
+    if (chunk_len > (size_t)pub->in_chunk_size) chunk_len = (size_t)pub->in_chunk_size;
+    if (avail < need + (ext ? 4 : 0) + chunk_len) return 0;
+
+    /* 整个 chunk 已到齐，再提交头部字段，保证数据不足时状态不被半更新。 */
+    if (ext) ts_field = read_be32(p + need);
+    if (fmt <= 1) {
+        cs->length = length;
+        cs->type = p[basic + 6];
+    }
+    if (fmt == 0) {
+        cs->stream_id = (uint32_t)p[basic + 7] | ((uint32_t)p[basic + 8] << 8) | ((uint32_t)p[basic + 9] << 16) |
+                        ((uint32_t)p[basic + 10] << 24);
+    }
+    if (fmt <= 2) cs->extended_timestamp = ext;
+    if (cs->received == 0) {
+        if (fmt == 0) {
+            cs->timestamp = ts_field;
+            cs->timestamp_delta = 0;
+        } else if (fmt <= 2) {
+            cs->timestamp_delta = ts_field;
+            cs->timestamp += ts_field;
+        } else {
+            cs->timestamp += cs->timestamp_delta;
+        }
+    }
+    need += ext ? 4 : 0;
+    memcpy(cs->body + cs->received, p + need, chunk_len);
+    cs->received += (uint32_t)chunk_len;
+    need += chunk_len;
+    memmove(pub->recv_buf, pub->recv_buf + need, avail - need);
+    pub->recv_len = avail - need;
+
+    if (cs->received < cs->length) return 2;
+    cs->received = 0;
+    if (cs->type == RTMP_MSG_COMMAND_AMF0 || cs->type == RTMP_MSG_DATA_AMF0) {
+        pub->msg_body = cs->body;
+        pub->msg_len = cs->length;
+        pub->msg_type = cs->type;
+        return 1;
+    }
+    return (handle_control(pub, cs) == 0) ? 2 : -1;
+}
+
+/**
+ * @description: 读取下一条命令/数据消息；wait=0 时只消费已到达的数据
+ * @param {RtmpPublisher *} pub
+ * @param {long long} deadline_ms
+ * @param {int} wait
+ * @return {static int} 1 有消息，0 暂无（仅 wait=0），-1 出错、超时或对端关闭
+ */
+static int read_message(RtmpPublisher *pub, long long deadline_ms, int wait) {
+    for (;;) {
+        ssize_t n;
+        int ret = parse_chunk(pub);
+        if (ret == 2) continue;
+        if (ret != 0) return ret;
+        if (pub->recv_len > 0 && pub->recv_len == pub->recv_cap) {
+            fprintf(stderr, "[RTMP][ERROR] receive buffer full len=%zu\n", pub->recv_len);
+            return -1;
+        }
+        n = recv(pub->fd, pub->recv_buf + pub->recv_len, pub->recv_cap - pub->recv_len, 0);
+        if (n > 0) {
+            pub->recv_len += (size_t)n;
+            pub->bytes_received += (uint64_t)n;
+            /* 对端设置了确认窗口时，累计收到半个窗口就回一次 Acknowledgement。 */
+            if (pub->window_ack_size > 0 && pub->bytes_received - pub->bytes_acked >= pub->window_ack_size / 2) {
+                uint8_t ack[4];
+                write_be32(ack, (uint32_t)pub->bytes_received);
+                pub->bytes_acked = pub->bytes_received;
+                if (send_simple(pub, RTMP_CSID_CONTROL, RTMP_MSG_ACK, 0, ack, sizeof(ack)) != 0) return -1;
+            }
+            continue;
+        }
+        if (n == 0) {
+            fprintf(stderr, "[RTMP] event=peer_closed host=%s:%d\n", pub->host, pub->port);
+            return -1;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            fprintf(stderr, "[RTMP] event=recv_failed errno=%d(%s)\n", errno, strerror(errno));
+            return -1;
+        }
+        if (!wait) return 0;
+        n = wait_fd(pub->fd, POLLIN, deadline_ms);
+        if (n == 0) {
+            fprintf(stderr, "[RTMP] event=response_timeout host=%s:%d\n", pub->host, pub->port);
+            return -1;
+        }
+        if (n < 0) return -1;
+    }
+}
+
+/**
+ * @description: 发送 AMF0 命令，事务号递增
+ * @param {RtmpPublisher *} pub
+ * @param {const char *} name
+ * @param {uint32_t} stream_id
+ * @param {const char *} arg 可选的字符串参数，NULL 表示无
+ * @param {const char *} arg2 可选的第二个字符串参数
+ * @return {static int}
+ */
+static int send_command(RtmpPublisher *pub, const char *name, uint32_t stream_id, const char *arg, const char *arg2) {
+    uint8_t body[768];
+    uint8_t *p = body;
+    pub->last_transaction += 1.0;
+    p = rtmp_amf_write_string(p, name);
+    p = rtmp_amf_write_number(p, pub->last_transaction);
+    p = rtmp_amf_write_null(p);
+    if (arg) p = rtmp_amf_write_string(p, arg);
+    if (arg2) p = rtmp_amf_write_string(p, arg2);
+    return send_simple(pub, RTMP_CSID_COMMAND, RTMP_MSG_COMMAND_AMF0, stream_id, body, (size_t)(p - body));
+}
+
+/**
+ * @description: 等待指定事务号的 _result，可选取出命令对象之后的数值（createStream 的流 ID）
+ * @param {RtmpPublisher *} pub
+ * @param {const char *} what 日志用的命令名
+ * @param {double} transaction
+ * @param {long long} deadline_ms
+ * @param {double *} number 可为 NULL
+ * @return {static int}
+ */
+static int wait_result(RtmpPublisher *pub, const char *what, double transaction, long long deadline_ms, double *number) {
+    for (;;) {
+        AmfReader r;
+        char name[32];
+        double txn = 0.0;
+        if (read_message(pub, deadline_ms, 1) != 1) return -1;
+        if (pub->msg_type != RTMP_MSG_COMMAND_AMF0) continue;
+        r.p = pub->msg_body;
+        r.end = pub->msg_body + pub->msg_len;
+        if (amf_read_string(&r, name, sizeof(name)) != 0 || amf_read_number(&r, &txn) != 0) continue;
+        if (txn != transaction) continue;
+        if (strcmp(name, "_error") == 0) {
+            fprintf(stderr, "[RTMP] event=command_rejected command=%s\n", what);
+            return -1;
+        }
+        if (strcmp(name, "_result") != 0) continue;
+        if (number) {
+            if (amf_skip_value(&r, 0) != 0 || amf_read_number(&r, number) != 0) {
+                fprintf(stderr, "[RTMP][ERROR] %s result malformed\n", what);
+                return -1;
+            }
+        }
+        return 0;
+    }
+}
+
+/**
+ * @description: 等待 onStatus NetStream.Publish.Start
+ * @param {RtmpPublisher *} pub
+ * @param {long long} deadline_ms
+ * @return {static int}
+ */
+static int wait_publish_start(RtmpPublisher *pub, long long deadline_ms) {
+    for (;;) {
+        AmfReader r;
+        char name[32];
+        char level[32] = "";
+        char code[96] = "";
+        double txn = 0.0;
+        if (read_message(pub, deadline_ms, 1) != 1) return -1;
+        if (pub->msg_type != RTMP_MSG_COMMAND_AMF0) continue;
+        r.p = pub->msg_body;
+        r.end = pub->msg_body + pub->msg_len;
+        if (amf_read_string(&r, name, sizeof(name)) != 0 || strcmp(name, "onStatus") != 0) continue;
+        if (amf_read_number(&r, &txn) != 0 || amf_skip_value(&r, 0) != 0 ||
+            amf_read_status(&r, level, sizeof(level), code, sizeof(code)) != 0) {
+            continue;
+        }
+        if (strcmp(code, "NetStream.Publish.Start") == 0) return 0;
+        if (strcmp(level, "error") == 0) {
+            fprintf(stderr, "[RTMP] event=publish_rejected code=%s\n", code);
+            return -1;
+        }
+    }
+}
+
+/**
+ * @description: 在截止时间内精确读取 n 字节（握手阶段使用）
+ * @param {RtmpPublisher *} pub
+ * @param {uint8_t *} buf
+ * @param {size_t} len
+ * @param {long long} deadline_ms
+ * @return {static int}
+ */
+static int recv_exact(RtmpPublisher *pub, uint8_t *buf, size_t len, long long deadline_ms) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = recv(pub->fd, buf + got, len - got, 0);
+        if (n > 0) {
+            got += (size_t)n;
+            continue;
+        }
+        if (n == 0) return -1;
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+        if (wait_fd(pub->fd, POLLIN, deadline_ms) != 1) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @description: 简单握手：C0+C1 -> S0+S1 -> C2(回显 S1) -> S2
+ * @param {RtmpPublisher *} pub
+ * @param {long long} deadline_ms
+ * @return {static int}
+ */
+static int do_handshake(RtmpPublisher *pub, long long deadline_ms) {
+    uint8_t c0c1[1 + RTMP_HANDSHAKE_SIZE];
+    uint8_t s0s1[1 + RTMP_HANDSHAKE_SIZE];
+    uint8_t s2[RTMP_HANDSHAKE_SIZE];
+    struct iovec iov;
+    unsigned int seed = (unsigned int)now_ms();
+    int i;
+
+    c0c1[0] = 3;
+    write_be32(c0c1 + 1, (uint32_t)now_ms());
+    memset(c0c1 + 5, 0, 4);
+    for (i = 9; i < (int)sizeof(c0c1); ++i) c0c1[i] = (uint8_t)rand_r(&seed);
+    iov.iov_base = c0c1;
+    iov.iov_len = sizeof(c0c1);
+    if (send_iov_all(pub, &iov, 1, deadline_ms) != 0) return -1;
+    if (recv_exact(pub, s0s1, sizeof(s0s1), deadline_ms) != 0) return -1;
+    if (s0s1[0] != 3) {
+        fprintf(stderr, "[RTMP][ERROR] handshake unsupported version=%u\n", s0s1[0]);
+        return -1;
+    }
+    iov.iov_base = s0s1 + 1;
+    iov.iov_len = RTMP_HANDSHAKE_SIZE;
+    if (send_iov_all(pub, &iov, 1, deadline_ms) != 0) return -1;
+    return recv_exact(pub, s2, sizeof(s2), deadline_ms);
+}
+
+/**
+ * @description: 非阻塞连接 TCP，受截止时间约束
+ * @param {RtmpPublisher *} pub
+ * @param {long long} deadline_ms
+ * @return {static int}
+ */
+static int tcp_connect(RtmpPublisher *pub, long long deadline_ms) {
+    struct addrinfo hints;
+    struct addrinfo *res = NULL;
+    char port[16];
+    int one = 1;
+    int err = 0;
+    socklen_t err_len = sizeof(err);
+    int fd;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(port, sizeof(port), "%d", pub->port);
+    if (getaddrinfo(pub->host, port, &hints, &res) != 0 || !res) {
+        fprintf(stderr, "[RTMP] event=resolve_failed host=%s\n", pub->host);
+        return -1;
+    }
+    fd = socket(res->ai_family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        freeaddrinfo(res);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, res->ai_addr, res->ai_addrlen) != 0 && errno != EINPROGRESS) {
+        fprintf(stderr, "[RTMP] event=connect_failed host=%s:%d errno=%d(%s)\n", pub->host, pub->port, errno, strerror(errno));
+        freeaddrinfo(res);
+        close(fd);
+        return -1;
+    }
+    freeaddrinfo(res);
+    if (wait_fd(fd, POLLOUT, deadline_ms) != 1 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) != 0 || err != 0) {
+        fprintf(stderr, "[RTMP] event=connect_failed host=%s:%d errno=%d\n", pub->host, pub->port, err);
+        close(fd);
+        return -1;
+    }
+    pub->fd = fd;
+    return 0;
+}
+
+/**
+ * @description: 重置单次连接的协议状态
+ * @param {RtmpPublisher *} pub
+ * @return {static void}
+ */
+static void reset_session_state(RtmpPublisher *pub) {
+    int i;
+    pub->in_chunk_size = 128;
+    pub->stream_id = 0;
+    pub->published = 0;
+    pub->last_transaction = 0.0;
+    pub->recv_len = 0;
+    pub->window_ack_size = 0;
+    pub->bytes_received = 0;
+    pub->bytes_acked = 0;
+    for (i = 0; i < RTMP_PUBLISHER_MAX_IN_STREAMS; ++i) {
+        pub->in[i].csid = 0;
+        pub->in[i].received = 0;
+    }
+}
+
+void rtmp_publisher_init(RtmpPublisher *pub, int chunk_size, int send_timeout_ms) {
+    if (!pub) return;
+    memset(pub, 0, sizeof(*pub));
+    pub->fd = -1;
+    pub->out_chunk_size = (chunk_size > 0) ? chunk_size : DEFAULT_RTMP_CHUNK_SIZE;
+    if (pub->out_chunk_size < 128) pub->out_chunk_size = 128;
+    if (pub->out_chunk_size > RTMP_MAX_CHUNK_SIZE) pub->out_chunk_size = RTMP_MAX_CHUNK_SIZE;
+    pub->send_timeout_ms = (send_timeout_ms > 0) ? send_timeout_ms : DEFAULT_RTMP_SEND_TIMEOUT_MS;
+    pub->in_chunk_size = 128;
+}
+
+int rtmp_publisher_parse_url(RtmpPublisher *pub, const char *url) {
+    const char *host;
+    const char *host_end;
+    const char *path;
+    const char *slash;
+    const char *colon;
+    size_t host_len;
+    size_t app_len;
+
+    if (!pub || !url || strncmp(url, "rtmp://", 7) != 0) return -1;
+    host = url + 7;
+    path = strchr(host, '/');
+    if (!path) return -1;
+    colon = memchr(host, ':', (size_t)(path - host));
+    host_end = colon ? colon : path;
+    host_len = (size_t)(host_end - host);
+    if (host_len == 0 || host_len >= sizeof(pub->host)) return -1;
+    memcpy(pub->host, host, host_len);
+    pub->host[host_len] = '\0';
+    pub->port = colon ? atoi(colon + 1) : DEFAULT_RTMP_PORT;
+    if (pub->port <= 0 || pub->port > 65535) return -1;
+
+    /* app 取路径里最后一个 '/' 之前的部分，之后是流名，例如 live/stream、live/room/stream?key=x。 */
+    path++;
+    slash = strrchr(path, '/');
+    if (!slash) return -1;
+    app_len = (size_t)(slash - path);
+    if (app_len == 0 || app_len >= sizeof(pub->app) || slash[1] == '\0' || strlen(slash + 1) >= sizeof(pub->stream)) return -1;
+    memcpy(pub->app, path, app_len);
+    pub->app[app_len] = '\0';
+    snprintf(pub->stream, sizeof(pub->stream), "%s", slash + 1);
+    snprintf(pub->tc_url, sizeof(pub->tc_url), "rtmp://%s:%d/%s", pub->host, pub->port, pub->app);
+    return 0;
+}
+
+int rtmp_publisher_connect(RtmpPublisher *pub, const char *url, int timeout_ms) {
+    long long deadline_ms = now_ms() + ((timeout_ms > 0) ? timeout_ms : 3000);
+    uint8_t body[768];
+    uint8_t *p = body;
+    uint8_t chunk_size[4];
+    double stream_id = 0.0;
+
+    if (!pub) return -1;
+    rtmp_publisher_close(pub);
+    if (rtmp_publisher_parse_url(pub, url) != 0) {
+        fprintf(stderr, "[RTMP] event=invalid_url url=%s\n", url ? url : "");
+        return -1;
+    }
+    if (!pub->recv_buf) {
+        pub->recv_buf = (uint8_t *)malloc(RTMP_RECV_BUFFER);
+        if (!pub->recv_buf) {
+            fprintf(stderr, "[RTMP][ERROR] receive buffer alloc failed\n");
+            return -1;
+        }
+        pub->recv_cap = RTMP_RECV_BUFFER;
+    }
+    reset_session_state(pub);
+    if (tcp_connect(pub, deadline_ms) != 0) return -1;
+    if (do_handshake(pub, deadline_ms) != 0) {
+        fprintf(stderr, "[RTMP] event=handshake_failed host=%s:%d\n", pub->host, pub->port);
+        goto fail;
+    }
+
+    write_be32(chunk_size, (uint32_t)pub->out_chunk_size);
+    p = rtmp_amf_write_string(p, "connect");
+    pub->last_transaction = 1.0;
+    p = rtmp_amf_write_number(p, pub->last_transaction);
+    *p++ = RTMP_AMF0_OBJECT;
+    p = rtmp_amf_write_key(p, "app");
+    p = rtmp_amf_write_string(p, pub->app);
+    p = rtmp_amf_write_key(p, "type");
+    p = rtmp_amf_write_string(p, "nonprivate");
+    p = rtmp_amf_write_key(p, "flashVer");
+    p = rtmp_amf_write_string(p, "FMLE/3.0 (compatible; RKMediaGateway)");
+    p = rtmp_amf_write_key(p, "tcUrl");
+    p = rtmp_amf_write_string(p, pub->tc_url);
+    p = rtmp_amf_write_object_end(p);
+    /* Set Chunk Size 必须先于任何大于 128 字节的消息发出。 */
+    if (send_simple(pub, RTMP_CSID_CONTROL, RTMP_MSG_SET_CHUNK_SIZE, 0, chunk_size, sizeof(chunk_size)) != 0 ||
+        send_simple(pub, RTMP_CSID_COMMAND, RTMP_MSG_COMMAND_AMF0, 0, body, (size_t)(p - body)) != 0 ||
+        wait_result(pub, "connect", 1.0, deadline_ms, NULL) != 0) {
+        goto fail;
+    }
+    if (send_command(pub, "releaseStream", 0, pub->stream, NULL) != 0 ||
+        send_command(pub, "FCPublish", 0, pub->stream, NULL) != 0 ||
+        send_command(pub, "createStream", 0, NULL, NULL) != 0 ||
+        wait_result(pub, "createStream", pub->last_transaction, deadline_ms, &stream_id) != 0) {
+        goto fail;
+    }
+    pub->stream_id = (uint32_t)stream_id;
+    if (send_command(pub, "publish", pub->stream_id, pub->stream, "live") != 0 || wait_publish_start(pub, deadline_ms) != 0) {
+        goto fail;
+    }
+    pub->published = 1;
+    return 0;
+
+fail:
+    rtmp_publisher_close(pub);
+    return -1;
+}
+
+int rtmp_publisher_send(RtmpPublisher *pub, uint8_t type, uint32_t timestamp_ms, const struct iovec *payload, int iov_count) {
+    int csid;
+    if (!pub || pub->fd < 0 || !pub->published) return -1;
+
+    /* 顺带消费对端已发来的数据：回应 Ping/确认窗口，发现服务端中止推流时及时返回失败。 */
+    for (;;) {
+        int ret = read_message(pub, 0, 0);
+        if (ret < 0) return -1;
+        if (ret == 0) break;
+        if (pub->msg_type == RTMP_MSG_COMMAND_AMF0) {
+            AmfReader r;
+            char name[32];
+            char level[32] = "";
+            char code[96] = "";
+            double txn = 0.0;
+            r.p = pub->msg_body;
+            r.end = pub->msg_body + pub->msg_len;
+            if (amf_read_string(&r, name, sizeof(name)) == 0 && strcmp(name, "onStatus") == 0 &&
+                amf_read_number(&r, &txn) == 0 && amf_skip_value(&r, 0) == 0 &&
+                amf_read_status(&r, level, sizeof(level), code, sizeof(code)) == 0 && strcmp(level, "error") == 0) {
+                fprintf(stderr, "[RTMP] event=publish_aborted code=%s\n", code);
+                return -1;
+            }
+        }
+    }
+
+    if (type == RTMP_MSG_VIDEO) {
+        csid = RTMP_CSID_VIDEO;
+    } else if (type == RTMP_MSG_AUDIO) {
+        csid = RTMP_CSID_AUDIO;
+    } else {
+        csid = RTMP_CSID_DATA;
+    }
+    return send_message_raw(pub, csid, type, timestamp_ms, pub->stream_id, payload, iov_count);
+}
+
+void rtmp_publisher_close(RtmpPublisher *pub) {
+    if (!pub) return;
+    if (pub->fd >= 0) {
+        close(pub->fd);
+        pub->fd = -1;
+    }
+    pub->published = 0;
+}
+
+void rtmp_publisher_deinit(RtmpPublisher *pub) {
+    int i;
+    if (!pub) return;
+    rtmp_publisher_close(pub);
+    for (i = 0; i < RTMP_PUBLISHER_MAX_IN_STREAMS; ++i) free(pub->in[i].body);
+    free(pub->recv_buf);
+    free(pub->iov);
+    free(pub->chunk_headers);
+    memset(pub, 0, sizeof(*pub));
+    pub->fd = -1;
+}
@@ -0,0 +1,61 @@
+#ifndef __RTSP_DIGEST_H__
+#define __RTSP_DIGEST_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @description: 计算 MD5 并输出 32 位小写十六进制字符串。
+ * @param {const void *} data 输入数据。
+ * @param {size_t} len 输入长度。
+ * @param {char *} out_hex 输出缓冲，至少 33 字节。
+ * @return {void}
+ */
+void rtsp_digest_md5_hex(const void *data, size_t len, char *out_hex);
+
+/**
+ * @description: 校验 RFC 2617 Digest 鉴权头（不带 qop 的 MD5 方式）：
+ *   response = MD5(MD5(user:realm:password):nonce:MD5(method:uri))。
+ * @param {const char *} authorization Authorization 头的值，如 "Digest username=..., response=..."。
+ * @param {const char *} method 请求方法。
+ * @param {const char *} realm 服务端 realm。
+ * @param {const char *} nonce 服务端下发的 nonce。
+ * @param {const char *} user 用户名。
+ * @param {const char *} password 密码。
+ * @return {int} 1 通过，0 不通过。
+ */
+int rtsp_digest_verify(const char *authorization,
+                       const char *method,
+                       const char *realm,
+                       const char *nonce,
+                       const char *user,
+                       const char *password);
+
+/**
+ * @description: 按客户端视角计算 Digest response，用于测试和压测客户端。
+ * @param {const char *} method 请求方法。
+ * @param {const char *} uri 请求 URI。
+ * @param {const char *} realm realm。
+ * @param {const char *} nonce nonce。
+ * @param {const char *} user 用户名。
+ * @param {const char *} password 密码。
+ * @param {char *} out_hex 输出缓冲，至少 33 字节。
+ * @return {void}
+ */
+void rtsp_digest_response(const char *method,
+                          const char *uri,
+                          const char *realm,
+                          const char *nonce,
+                          const char *user,
+                          const char *password,
+                          char *out_hex);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
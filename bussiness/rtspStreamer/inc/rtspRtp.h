@@ -0,0 +1,129 @@
+#ifndef __RTSP_RTP_H__
+#define __RTSP_RTP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mediaPacket.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* RTP 头 12 字节 + FU-A 的 FU indicator / FU header 2 字节。 */
+#define RTSP_RTP_MAX_HEADER 14
+/* 单个 RTP 包负载上限，加上 RTP/UDP/IP 头后不超过常见 1500 MTU。 */
+#define RTSP_RTP_DEFAULT_MAX_PAYLOAD 1400
+/* H.264 动态负载类型。 */
+#define RTSP_RTP_PAYLOAD_TYPE_H264 96
+/* 参数集缓存的最大长度。 */
+#define RTSP_RTP_MAX_PARAMETER_SET 256
+
+typedef struct {
+    uint8_t header[RTSP_RTP_MAX_HEADER]; /* RTP 头，FU-A 分片时后面紧跟 2 字节 FU 头。 */
+    uint8_t header_len;                  /* header 有效长度，12 或 14。 */
+    const uint8_t *payload;              /* 负载，直接指向原始帧的 NALU 字节。 */
+    size_t payload_len;                  /* 负载长度。 */
+} RtspRtpPacket;
+
+/* 一帧打包后的全部 RTP 包，所有客户端共享同一份，只在 RTSP 服务线程里增减引用。 */
+typedef struct {
+    int ref_count;                 /* 引用数：服务线程和各客户端发送队列各持一份。 */
+    void *owner;                   /* 所属 session，由服务线程用来分发。 */
+    int is_key_frame;              /* 是否包含 IDR。 */
+    int is_parameter_sets;         /* 是否只含 SPS/PPS（新客户端补发参数集）。 */
+    int is_rtcp;                   /* 是否为单个 RTCP 报文（SR），TCP interleaved 时走 RTCP 通道。 */
+    uint32_t rtp_timestamp;        /* 本帧 RTP 时间戳（90kHz）。 */
+    uint16_t first_seq;            /* 首包序号。 */
+    uint64_t pts_us;               /* 原始帧 pts。 */
+    MediaPacket packet;            /* 原始帧引用，负载分段直接指向它的 buffer。 */
+    uint8_t *owned;                /* 参数集帧自有的 NALU 字节。 */
+    size_t bytes;                  /* 所有 RTP 包总字节数（不含 TCP interleaved 前缀）。 */
+    int packet_count;              /* RTP 包数。 */
+    RtspRtpPacket packets[];       /* RTP 包。 */
+} RtspRtpFrame;
+
+typedef struct {
+    uint32_t ssrc;                 /* 同步源标识。 */
+    uint16_t next_seq;             /* 下一个 RTP 序号。 */
+    uint32_t timestamp_base;       /* RTP 时间戳随机起点。 */
+    size_t max_payload;            /* 单包负载上限。 */
+    uint8_t sps[RTSP_RTP_MAX_PARAMETER_SET]; /* 最近的 SPS（不含起始码）。 */
+    size_t sps_len;
+    uint8_t pps[RTSP_RTP_MAX_PARAMETER_SET]; /* 最近的 PPS（不含起始码）。 */
+    size_t pps_len;
+    uint32_t parameter_version;    /* SPS/PPS 每变化一次加一，供 SDP 判断是否需要重建。 */
+} RtspRtpPacketizer;
+
+/**
+ * @description: 初始化 RFC 6184 H.264 打包器。
+ * @param {RtspRtpPacketizer *} packetizer 打包器。
+ * @param {uint32_t} ssrc 同步源标识。
+ * @param {uint16_t} initial_seq 起始序号。
+ * @param {uint32_t} timestamp_base RTP 时间戳起点。
+ * @param {size_t} max_payload 单包负载上限，0 使用默认值。
+ * @return {void}
+ */
+void rtsp_rtp_packetizer_init(RtspRtpPacketizer *packetizer,
+                              uint32_t ssrc,
+                              uint16_t initial_seq,
+                              uint32_t timestamp_base,
+                              size_t max_payload);
+
+/**
+ * @description: 把一帧 Annex-B H.264 打成 RTP 包：小 NALU 单包发送，大 NALU 走 FU-A 分片，
+ *   帧内最后一个包置 marker。负载不拷贝，帧持有 packet 的引用。同时更新 SPS/PPS 缓存。
+ * @param {RtspRtpPacketizer *} packetizer 打包器。
+ * @param {const MediaPacket *} packet 视频帧。
+ * @param {RtspRtpFrame **} out_frame 输出帧，引用数为 1；没有 NALU 时输出 NULL。
+ * @return {int} 0 成功，-1 内存不足。
+ */
+int rtsp_rtp_packetize(RtspRtpPacketizer *packetizer, const MediaPacket *packet, RtspRtpFrame **out_frame);
+
+/**
+ * @description: 用缓存的 SPS/PPS 生成一个只含参数集的帧，时间戳沿用上一帧。
+ * @param {RtspRtpPacketizer *} packetizer 打包器。
+ * @param {uint64_t} pts_us 时间戳。
+ * @param {RtspRtpFrame **} out_frame 输出帧；参数集未就绪时输出 NULL。
+ * @return {int} 0 成功或未就绪，-1 内存不足。
+ */
+int rtsp_rtp_packetize_parameter_sets(RtspRtpPacketizer *packetizer, uint64_t pts_us, RtspRtpFrame **out_frame);
+
+/**
+ * @description: 把一个 RTCP 报文包成只含一个包的帧，以便和媒体帧一样排进 TCP 客户端的发送队列。
+ * @param {const uint8_t *} data RTCP 报文，会被拷贝。
+ * @param {size_t} len 报文长度。
+ * @param {RtspRtpFrame **} out_frame 输出帧，引用数为 1。
+ * @return {int} 0 成功，-1 内存不足。
+ */
+int rtsp_rtp_wrap_rtcp(const uint8_t *data, size_t len, RtspRtpFrame **out_frame);
+
+/**
+ * @description: 生成 SDP fmtp 中的 profile-level-id 与 sprop-parameter-sets。
+ * @param {const RtspRtpPacketizer *} packetizer 打包器。
+ * @param {char *} out 输出缓冲。
+ * @param {size_t} out_size 缓冲大小。
+ * @return {int} 0 成功，-1 参数集未就绪或缓冲不足。
+ */
+int rtsp_rtp_format_sprop(const RtspRtpPacketizer *packetizer, char *out, size_t out_size);
+
+/**
+ * @description: 释放一个帧引用，引用归零时释放帧和原始帧引用。
+ * @param {RtspRtpFrame *} frame 帧，可为 NULL。
+ * @return {void}
+ */
+void rtsp_rtp_frame_release(RtspRtpFrame *frame);
+
+/**
+ * @description: pts 微秒换算为 90kHz RTP 时间戳。
+ * @param {const RtspRtpPacketizer *} packetizer 打包器。
+ * @param {uint64_t} pts_us 时间戳。
+ * @return {uint32_t}
+ */
+uint32_t rtsp_rtp_timestamp(const RtspRtpPacketizer *packetizer, uint64_t pts_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
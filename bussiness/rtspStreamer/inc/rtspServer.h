@@ -0,0 +1,239 @@
+#ifndef __RTSP_SERVER_H__
+#define __RTSP_SERVER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mediaPacket.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 一个服务最多挂载的 session 数（main/sub 等）。 */
+#define RTSP_SERVER_MAX_SESSIONS 8
+/* 每个 session 的 GOP 缓存最多帧数，不超过 TCP 客户端发送队列的一半，起播后仍有余量排实时帧。 */
+#define RTSP_SERVER_GOP_CACHE_MAX_FRAMES 128
+/* 每个 session 对外发布明细统计的客户端数上限，超出的客户端只计入汇总。 */
+#define RTSP_SERVER_CLIENT_STATS_MAX 32
+
+typedef struct RtspServer RtspServer;
+typedef struct RtspServerSession RtspServerSession;
+
+typedef struct {
+    const char *listen_ip;         /* RTSP 监听地址，默认 0.0.0.0。 */
+    int listen_port;               /* RTSP 监听端口，默认 8554。 */
+    int auth_enable;               /* 是否启用 Digest 鉴权。 */
+    const char *user;              /* 鉴权用户名。 */
+    const char *password;          /* 鉴权密码。 */
+    int max_clients;               /* 同时 SETUP 的最大客户端数，超出回 453。 */
+    int client_budget_bytes;       /* TCP interleaved 客户端发送队列的字节上限，超出时丢弃队列里未开始写的帧，改从下一个关键帧继续。 */
+    int inbox_capacity;            /* 打包线程到服务线程之间的帧队列容量。 */
+    int rtp_max_payload;           /* 单个 RTP 包负载上限，0 使用默认 1400。 */
+    int rtcp_interval_ms;          /* RTCP SR 发送周期，0 使用默认 1000，<0 不发 SR（仍解析客户端的接收报告）。 */
+    int slow_client_evict_drops;   /* 窗口内发送队列超限达到该次数的 TCP 客户端判定为持续过慢并断开，0 使用默认 3，<0 从不断开。 */
+    int slow_client_evict_window_ms; /* 超限次数的统计窗口，0 使用默认 30000。 */
+} RtspServerConfig;
+
+typedef struct {
+    const char *group;             /* 组播地址（224.0.0.0/4），如 239.255.0.1。 */
+    int port;                      /* 组播 RTP 端口，须为偶数，RTCP 为其加一。 */
+    int ttl;                       /* 组播 TTL，<=0 使用 1（只在本网段，不跨路由）。 */
+    const char *interface_ip;      /* 发送组播的本地网卡地址，NULL 或空字符串走系统路由。 */
+} RtspServerMulticastConfig;
+
+typedef struct {
+    int clients;                   /* 以组播方式播放的客户端数，为 0 时不向组内发送。 */
+    uint64_t frames;               /* 发往组内的帧数，与观看人数无关。 */
+    uint64_t rtp_packets;          /* 发往组内的 RTP 包数。 */
+    uint64_t bytes_sent;           /* 发往组内的字节数。 */
+    uint64_t send_drops;           /* 发送缓冲满导致组内丢帧（随后等下一个关键帧）的次数。 */
+} RtspServerMulticastStats;
+
+typedef struct {
+    int receivers;                 /* 最近 10 秒内回过接收报告的播放中单播客户端数。 */
+    uint64_t reports;              /* 这些客户端累计回来的接收报告数。 */
+    double max_loss_percent;       /* 其中最近一次报告丢包率的最大值（百分比）。 */
+    double max_jitter_ms;          /* 其中最近一次报告抖动的最大值（毫秒）。 */
+    int max_rtt_ms;                /* 其中 RTT 的最大值，-1 表示都还未知。 */
+} RtspServerReceiverStats;
+
+typedef struct {
+    char peer[16];                 /* 客户端 IP。 */
+    int transport;                 /* 0 UDP，1 TCP interleaved。 */
+    int queue_frames;              /* 发送队列中的帧数（UDP 不排队，恒为 0）。 */
+    size_t queue_bytes;            /* 发送队列中尚未写出的字节数。 */
+    size_t peak_queue_bytes;       /* 播放以来发送队列的最大积压字节数。 */
+    int waiting_for_keyframe;      /* 是否在丢帧后等下一个关键帧。 */
+    uint64_t sent_frames;          /* 完整写出的媒体帧数。 */
+    uint64_t bytes_sent;           /* 写给该客户端的字节数。 */
+    uint64_t dropped_frames;       /* 因积压或发送缓冲满丢弃的媒体帧数。 */
+    uint64_t drop_events;          /* 转为等关键帧的次数。 */
+} RtspServerClientStats;
+
+typedef struct {
+    int clients;                   /* 当前正在播放的客户端数。 */
+    uint64_t accepted;             /* 累计接入的 TCP 连接数。 */
+    uint64_t rejected;             /* 因连接数/客户端数达到上限或 session 不存在被拒绝的次数。 */
+    uint64_t auth_failures;        /* 鉴权失败次数。 */
+    uint64_t slow_drops;           /* 窗口内多次积压超限、判定为持续过慢被断开的 TCP 客户端数。 */
+    uint64_t queue_drops;          /* TCP 客户端发送队列超限、丢帧等下一个关键帧的次数（按客户端累计）。 */
+    uint64_t frames;               /* 已打包的帧数，每帧无论客户端多少只计一次。 */
+    uint64_t inbox_drops;          /* 服务线程跟不上导致丢弃的帧数。 */
+    uint64_t rtp_packets;          /* 写给所有客户端的 RTP 包数。 */
+    uint64_t bytes_sent;           /* 写给所有客户端的字节数。 */
+    uint64_t send_calls;           /* 发送系统调用次数（TCP sendmsg + UDP sendmmsg）。 */
+    uint64_t udp_drops;            /* UDP 发送缓冲满时被丢弃的帧次数（按客户端累计）。 */
+    uint64_t rtcp_sender_reports;  /* 发出的 RTCP SR 数（按客户端累计，组播按组计一次）。 */
+    uint64_t rtcp_receiver_reports;/* 收到并解析的客户端接收报告数。 */
+} RtspServerStats;
+
+/**
+ * @description: 客户端开始播放或断开时的回调，在服务线程内调用，不能阻塞。
+ * @param {void *} opaque add_session 时传入的上下文。
+ * @param {const char *} session_name session 名称。
+ * @param {int} connected 1 开始播放（PLAY），0 断开。
+ * @param {int} clients 回调时该 session 正在播放的客户端数。
+ * @param {int} need_keyframe 仅 connected=1 时有效：1 客户端在等下一个关键帧，需要尽快出 IDR；
+ *   0 已从 GOP 缓存起播，无需额外 IDR。
+ * @return {void}
+ */
+typedef void (*RtspServerClientCallback)(void *opaque,
+                                         const char *session_name,
+                                         int connected,
+                                         int clients,
+                                         int need_keyframe);
+
+/**
+ * @description: 创建并启动 RTSP 服务：单线程 epoll 处理 RTSP 信令、RTP over UDP 与 TCP interleaved 发送，
+ *   按周期给每个播放中的客户端发 RTCP SR，并解析客户端回来的 RR。
+ * @param {const RtspServerConfig *} config 配置。
+ * @return {RtspServer *} 成功返回服务句柄，失败返回 NULL。
+ */
+RtspServer *rtsp_server_create(const RtspServerConfig *config);
+
+/**
+ * @description: 停止服务线程，断开所有客户端并释放服务及其全部 session。
+ * @param {RtspServer *} server 服务句柄，可为 NULL。
+ * @return {void}
+ */
+void rtsp_server_destroy(RtspServer *server);
+
+/**
+ * @description: 挂载一个 session，客户端通过 rtsp://ip:port/<name> 播放。
+ * @param {RtspServer *} server 服务句柄。
+ * @param {const char *} name session 名称。
+ * @param {RtspServerClientCallback} callback 客户端播放/断开回调，可为 NULL。
+ * @param {void *} opaque 回调上下文。
+ * @return {RtspServerSession *} 成功返回 session，名称重复或数量超限返回 NULL。
+ */
+RtspServerSession *rtsp_server_add_session(RtspServer *server,
+                                           const char *name,
+                                           RtspServerClientCallback callback,
+                                           void *opaque);
+
+/**
+ * @description: 卸载 session，服务线程随后断开它的客户端。调用后不能再使用该 session。
+ * @param {RtspServer *} server 服务句柄。
+ * @param {RtspServerSession *} session session。
+ * @return {void}
+ */
+void rtsp_server_remove_session(RtspServer *server, RtspServerSession *session);
+
+/**
+ * @description: 配置 session 的 GOP 缓存：服务线程保留最近一个 GOP 的打包结果（引用，不拷贝），
+ *   新客户端 PLAY 时从缓存的 IDR 开始连续发送，不用等下一个关键帧；缓存的 IDR 超过 max_age_ms
+ *   时改为等新的关键帧。开启后即使没有客户端也持续投递帧，以保持缓存可用。
+ * @param {RtspServerSession *} session session。
+ * @param {int} max_frames 缓存帧数上限，0 关闭，最大 RTSP_SERVER_GOP_CACHE_MAX_FRAMES；GOP 超出上限时不缓存。
+ * @param {int} max_age_ms 缓存 IDR 的最长可用时间，<=0 不限制。
+ * @return {int} 0 成功，-1 参数非法。
+ */
+int rtsp_server_session_set_gop_cache(RtspServerSession *session, int max_frames, int max_age_ms);
+
+/**
+ * @description: 为 session 开启组播：DESCRIBE 的 SDP 带上组播地址/TTL，SETUP 请求 multicast 的客户端
+ *   加入该组，每帧只向组内发送一份，与组播观看人数无关；没有组播观众时不发送，避免无 IGMP snooping
+ *   的交换机泛洪。单播客户端不受影响。只能在 add_session 之后、客户端接入之前调用一次。
+ * @param {RtspServerSession *} session session。
+ * @param {const RtspServerMulticastConfig *} config 组播配置。
+ * @return {int} 0 成功，-1 参数非法、已配置或 socket 创建失败。
+ */
+int rtsp_server_session_set_multicast(RtspServerSession *session, const RtspServerMulticastConfig *config);
+
+/**
+ * @description: 获取 session 组播统计，可在任意线程调用。
+ * @param {RtspServerSession *} session session。
+ * @param {RtspServerMulticastStats *} stats 输出统计。
+ * @return {int} 0 成功，-1 参数非法或未开启组播。
+ */
+int rtsp_server_session_get_multicast_stats(RtspServerSession *session, RtspServerMulticastStats *stats);
+
+/**
+ * @description: 获取 session 单播客户端 RTCP 接收报告的汇总（最差的丢包率/抖动/RTT），可在任意线程调用。
+ *   单个客户端的明细见服务日志 event=client_rtcp；组播接收端的报告发往组地址，不计入。
+ * @param {RtspServerSession *} session session。
+ * @param {RtspServerReceiverStats *} stats 输出统计。
+ * @return {int} 0 成功，-1 参数非法。
+ */
+int rtsp_server_session_get_receiver_stats(RtspServerSession *session, RtspServerReceiverStats *stats);
+
+/**
+ * @description: 获取 session 内播放中单播客户端的逐个统计（队列深度、丢帧、字节数），可在任意线程调用。
+ *   每个客户端有独立的发送队列，积压超限只影响它自己：丢帧后从下一个关键帧继续，持续过慢时被断开。
+ * @param {RtspServerSession *} session session。
+ * @param {RtspServerClientStats *} stats 输出数组。
+ * @param {int} max_stats 数组容量。
+ * @return {int} 输出的客户端数，-1 参数非法。
+ */
+int rtsp_server_session_get_client_stats(RtspServerSession *session, RtspServerClientStats *stats, int max_stats);
+
+/**
+ * @description: 发送一帧 H.264：每帧只做一次 RTP 打包，所有客户端共享打包结果，负载不拷贝。
+ *   没有客户端在播放且未开启 GOP 缓存时只更新参数集缓存。同一 session 只能由一个线程调用。
+ * @param {RtspServerSession *} session session。
+ * @param {const MediaPacket *} packet 视频帧。
+ * @return {int} 0 成功（含因队列满被丢弃），-1 参数非法或内存不足。
+ */
+int rtsp_server_session_send_packet(RtspServerSession *session, const MediaPacket *packet);
+
+/**
+ * @description: 用缓存的 SPS/PPS 立即发送一组参数集，新客户端等待关键帧期间也会收到。
+ * @param {RtspServerSession *} session session。
+ * @param {uint64_t} pts_us 时间戳。
+ * @param {size_t *} sps_len 输出 SPS 长度，可为 NULL。
+ * @param {size_t *} pps_len 输出 PPS 长度，可为 NULL。
+ * @return {int} 0 已投递，-1 参数集未就绪或队列满。
+ */
+int rtsp_server_session_send_parameter_sets(RtspServerSession *session,
+                                            uint64_t pts_us,
+                                            size_t *sps_len,
+                                            size_t *pps_len);
+
+/**
+ * @description: 查询 session 正在播放的客户端数，可在任意线程调用。
+ * @param {RtspServerSession *} session session。
+ * @return {int}
+ */
+int rtsp_server_session_client_count(RtspServerSession *session);
+
+/**
+ * @description: 获取服务运行统计。
+ * @param {RtspServer *} server 服务句柄。
+ * @param {RtspServerStats *} stats 输出统计。
+ * @return {int} 0 成功，-1 参数非法。
+ */
+int rtsp_server_get_stats(RtspServer *server, RtspServerStats *stats);
+
+/**
+ * @description: 获取服务 RTP/RTCP 使用的本地 UDP 端口。
+ * @param {RtspServer *} server 服务句柄。
+ * @return {int} RTP 端口，RTCP 为其加一；失败返回 -1。
+ */
+int rtsp_server_get_rtp_port(RtspServer *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
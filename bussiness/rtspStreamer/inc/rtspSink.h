@@ -17,6 +17,16 @@ typedef struct {
     const char *password;     /* 鉴权密码。 */
     int queue_capacity;       /* 该 sink 自身的发送队列容量。 */
     int immediate_sps_pps_on_new_client; /* 新客户端接入时是否立刻补发缓存的 SPS/PPS。 */
+    int gop_cache_max_frames; /* GOP 缓存帧数上限，新客户端从缓存的 IDR 起播；0 关闭，每个新客户端都请求 IDR。 */
+    int gop_cache_max_age_ms; /* 缓存的 IDR 超过该时长时不再用于起播，改为请求新的 IDR。 */
+    const char *multicast_group;     /* 组播地址，NULL 或空字符串不开启组播。 */
+    int multicast_port;              /* 组播 RTP 端口（偶数），RTCP 为其加一。 */
+    int multicast_ttl;               /* 组播 TTL，默认 1 只在本网段。 */
+    const char *multicast_interface; /* 发送组播的本地网卡地址，空走系统路由。 */
+    int rtcp_interval_ms;            /* RTCP SR 周期，0 取默认 1000，负数不发 SR；由第一个创建共享服务的 sink 决定，后续 sink 的 SR 周期/预算/断开参数与之不同时告警。 */
+    int client_budget_bytes;         /* 单个 TCP 客户端发送队列字节上限，超出后该客户端丢帧等下一个关键帧；0 取默认。共享服务级。 */
+    int slow_client_evict_drops;     /* 窗口内超限次数达到该值时断开客户端，0 取默认 3，负数从不断开。共享服务级。 */
+    int slow_client_evict_window_ms; /* 超限次数的统计窗口，0 取默认 30000。共享服务级。 */
 } RtspSinkConfig;
 
 int rtsp_sink_setup(MediaSink *sink, const RtspSinkConfig *config);
@@ -2,6 +2,7 @@
 #define __RTSP_STREAMER_H__
 
 #include "mppEncoder.h"
+#include "rtspServer.h"
 #include "v4l2Capture.h"
 #include <stdio.h>
 
@@ -34,11 +35,11 @@ typedef struct {
 typedef struct {
     V4L2CaptureCtx capture;        /* V4L2 采集模块上下文。 */
     MppEncoderCtx encoder;         /* MPP 编码模块上下文。 */
-    void *rtsp_session;            /* 当前 RTSP 推流会话句柄。 */
+    RtspServer *rtsp_server;       /* 进程内 RTSP 服务句柄。 */
+    RtspServerSession *rtsp_session; /* 当前 RTSP 推流会话句柄。 */
     RtspStreamerConfig config;     /* 归一化后的 RTSP 推流配置副本。 */
     int capture_ready;             /* 采集模块是否已初始化成功。 */
     int encoder_ready;             /* 编码模块是否已初始化成功。 */
-    int rtsp_module_ready;         /* RTSP 底层模块是否已初始化成功。 */
     int running;                   /* 主循环是否正在运行。 */
     FILE *record_fp;               /* 本地录像文件句柄。 */
     uint64_t stat_last_ts_us;      /* 上次统计输出时间戳。 */
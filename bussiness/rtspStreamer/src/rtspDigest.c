@@ -0,0 +1,268 @@
+#include "rtspDigest.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#define RTSP_DIGEST_FIELD_MAX 256
+
+typedef struct {
+    uint32_t state[4];             /* A/B/C/D 四个寄存器。 */
+    uint64_t bytes;                /* 已输入的总字节数。 */
+    uint8_t block[64];             /* 未满 64 字节的尾块。 */
+    size_t block_len;              /* block 有效长度。 */
+} RtspMd5;
+
+static const uint32_t MD5_K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static const uint8_t MD5_R[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+/**
+ * @description: 处理一个 64 字节分组
+ * @param {RtspMd5 *} md5
+ * @param {const uint8_t *} block
+ * @return {static void}
+ */
+static void rtsp_md5_transform(RtspMd5 *md5, const uint8_t *block) {
+    uint32_t w[16];
+    uint32_t a = md5->state[0];
+    uint32_t b = md5->state[1];
+    uint32_t c = md5->state[2];
+    uint32_t d = md5->state[3];
+    int i;
+
+    for (i = 0; i < 16; ++i) {
+        w[i] = (uint32_t)block[i * 4] | ((uint32_t)block[i * 4 + 1] << 8) |
+               ((uint32_t)block[i * 4 + 2] << 16) | ((uint32_t)block[i * 4 + 3] << 24);
+    }
+    for (i = 0; i < 64; ++i) {
+        uint32_t f;
+        uint32_t tmp;
+        int g;
+
+        if (i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) & 15;
+        } else if (i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) & 15;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) & 15;
+        }
+        tmp = d;
+        d = c;
+        c = b;
+        f = a + f + MD5_K[i] + w[g];
+        b = b + ((f << MD5_R[i]) | (f >> (32 - MD5_R[i])));
+        a = tmp;
+    }
+    md5->state[0] += a;
+    md5->state[1] += b;
+    md5->state[2] += c;
+    md5->state[3] += d;
+}
+
+/**
+ * @description: 初始化 MD5 上下文
+ * @param {RtspMd5 *} md5
+ * @return {static void}
+ */
+static void rtsp_md5_init(RtspMd5 *md5) {
+    md5->state[0] = 0x67452301;
+    md5->state[1] = 0xefcdab89;
+    md5->state[2] = 0x98badcfe;
+    md5->state[3] = 0x10325476;
+    md5->bytes = 0;
+    md5->block_len = 0;
+}
+
+/**
+ * @description: 输入数据
+ * @param {RtspMd5 *} md5
+ * @param {const uint8_t *} data
+ * @param {size_t} len
+ * @return {static void}
+ */
+static void rtsp_md5_update(RtspMd5 *md5, const uint8_t *data, size_t len) {
+    md5->bytes += len;
+    while (len > 0) {
+        size_t step = 64 - md5->block_len;
+
+        if (step > len) {
+            step = len;
+        }
+        memcpy(md5->block + md5->block_len, data, step);
+        md5->block_len += step;
+        data += step;
+        len -= step;
+        if (md5->block_len == 64) {
+            rtsp_md5_transform(md5, md5->block);
+            md5->block_len = 0;
+        }
+    }
+}
+
+/**
+ * @description: 补位并输出 16 字节摘要
+ * @param {RtspMd5 *} md5
+ * @param {uint8_t *} digest
+ * @return {static void}
+ */
+static void rtsp_md5_final(RtspMd5 *md5, uint8_t digest[16]) {
+    static const uint8_t padding[64] = { 0x80 };
+    uint64_t bits = md5->bytes * 8;
+    uint8_t length[8];
+    size_t pad_len;
+    int i;
+
+    for (i = 0; i < 8; ++i) {
+        length[i] = (uint8_t)(bits >> (8 * i));
+    }
+    pad_len = (md5->block_len < 56) ? (56 - md5->block_len) : (120 - md5->block_len);
+    rtsp_md5_update(md5, padding, pad_len);
+    rtsp_md5_update(md5, length, sizeof(length));
+    for (i = 0; i < 4; ++i) {
+        digest[i * 4] = (uint8_t)md5->state[i];
+        digest[i * 4 + 1] = (uint8_t)(md5->state[i] >> 8);
+        digest[i * 4 + 2] = (uint8_t)(md5->state[i] >> 16);
+        digest[i * 4 + 3] = (uint8_t)(md5->state[i] >> 24);
+    }
+}
+
+void rtsp_digest_md5_hex(const void *data, size_t len, char *out_hex) {
+    static const char hex[] = "0123456789abcdef";
+    RtspMd5 md5;
+    uint8_t digest[16];
+    int i;
+
+    rtsp_md5_init(&md5);
+    rtsp_md5_update(&md5, (const uint8_t *)data, len);
+    rtsp_md5_final(&md5, digest);
+    for (i = 0; i < 16; ++i) {
+        out_hex[i * 2] = hex[digest[i] >> 4];
+        out_hex[i * 2 + 1] = hex[digest[i] & 0x0F];
+    }
+    out_hex[32] = '\0';
+}
+
+void rtsp_digest_response(const char *method,
+                          const char *uri,
+                          const char *realm,
+                          const char *nonce,
+                          const char *user,
+                          const char *password,
+                          char *out_hex) {
+    char buffer[RTSP_DIGEST_FIELD_MAX * 4];
+    char ha1[33];
+    char ha2[33];
+    int len;
+
+    len = snprintf(buffer, sizeof(buffer), "%s:%s:%s", user, realm, password);
+    rtsp_digest_md5_hex(buffer, (len > 0) ? (size_t)len : 0, ha1);
+    len = snprintf(buffer, sizeof(buffer), "%s:%s", method, uri);
+    rtsp_digest_md5_hex(buffer, (len > 0) ? (size_t)len : 0, ha2);
+    len = snprintf(buffer, sizeof(buffer), "%s:%s:%s", ha1, nonce, ha2);
+    rtsp_digest_md5_hex(buffer, (len > 0) ? (size_t)len : 0, out_hex);
+}
+
+/**
+ * @description: 从 Digest 参数列表中取出 key 对应的值，支持带引号和不带引号两种写法
+ * @param {const char *} params
+ * @param {const char *} key
+ * @param {char *} out
+ * @param {size_t} out_size
+ * @return {static int} 0 找到，-1 没有或超长
+ */
+static int rtsp_digest_param(const char *params, const char *key, char *out, size_t out_size) {
+    size_t key_len = strlen(key);
+    const char *p = params;
+
+    while (*p) {
+        const char *end;
+        size_t len;
+
+        while (*p == ' ' || *p == ',' || *p == '\t') {
+            p++;
+        }
+        if (strncasecmp(p, key, key_len) == 0 && p[key_len] == '=') {
+            p += key_len + 1;
+            if (*p == '"') {
+                p++;
+                end = strchr(p, '"');
+            } else {
+                end = p + strcspn(p, ", \t\r\n");
+            }
+            if (!end) {
+                return -1;
+            }
+            len = (size_t)(end - p);
+            if (len + 1 > out_size) {
+                return -1;
+            }
+            memcpy(out, p, len);
+            out[len] = '\0';
+            return 0;
+        }
+        /* 跳过当前参数，引号内的逗号不算分隔符。 */
+        while (*p && *p != ',') {
+            if (*p == '"') {
+                const char *quote = strchr(p + 1, '"');
+                if (!quote) {
+                    return -1;
+                }
+                p = quote;
+            }
+            p++;
+        }
+    }
+    return -1;
+}
+
+int rtsp_digest_verify(const char *authorization,
+                       const char *method,
+                       const char *realm,
+                       const char *nonce,
+                       const char *user,
+                       const char *password) {
+    char username[RTSP_DIGEST_FIELD_MAX];
+    char client_realm[RTSP_DIGEST_FIELD_MAX];
+    char client_nonce[RTSP_DIGEST_FIELD_MAX];
+    char uri[RTSP_DIGEST_FIELD_MAX];
+    char response[RTSP_DIGEST_FIELD_MAX];
+    char expect[33];
+
+    if (!authorization || strncasecmp(authorization, "Digest ", 7) != 0) {
+        return 0;
+    }
+    authorization += 7;
+    if (rtsp_digest_param(authorization, "username", username, sizeof(username)) != 0 ||
+        rtsp_digest_param(authorization, "realm", client_realm, sizeof(client_realm)) != 0 ||
+        rtsp_digest_param(authorization, "nonce", client_nonce, sizeof(client_nonce)) != 0 ||
+        rtsp_digest_param(authorization, "uri", uri, sizeof(uri)) != 0 ||
+        rtsp_digest_param(authorization, "response", response, sizeof(response)) != 0) {
+        return 0;
+    }
+    if (strcmp(username, user) != 0 || strcmp(client_realm, realm) != 0 || strcmp(client_nonce, nonce) != 0) {
+        return 0;
+    }
+    rtsp_digest_response(method, uri, realm, nonce, user, password, expect);
+    return strcasecmp(expect, response) == 0;
+}
@@ -0,0 +1,345 @@
+#include "rtspRtp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 单帧最多处理的 NALU 数，MPP 每帧通常只有 SPS/PPS/SEI/slice 几个。 */
+#define RTSP_RTP_MAX_NALUS 64
+#define RTSP_RTP_HEADER_SIZE 12
+#define RTSP_RTP_FU_A_TYPE 28
+#define H264_NALU_TYPE_IDR 5
+#define H264_NALU_TYPE_SPS 7
+#define H264_NALU_TYPE_PPS 8
+
+static const char BASE64_TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * @description: 按大端写入 RTP 固定头
+ * @param {RtspRtpPacketizer *} packetizer
+ * @param {uint8_t *} header
+ * @param {uint32_t} timestamp
+ * @param {int} marker
+ * @return {static void}
+ */
+static void rtsp_rtp_write_header(RtspRtpPacketizer *packetizer, uint8_t *header, uint32_t timestamp, int marker) {
+    uint16_t seq = packetizer->next_seq++;
+
+    header[0] = 0x80;
+    header[1] = (uint8_t)((marker ? 0x80 : 0x00) | RTSP_RTP_PAYLOAD_TYPE_H264);
+    header[2] = (uint8_t)(seq >> 8);
+    header[3] = (uint8_t)seq;
+    header[4] = (uint8_t)(timestamp >> 24);
+    header[5] = (uint8_t)(timestamp >> 16);
+    header[6] = (uint8_t)(timestamp >> 8);
+    header[7] = (uint8_t)timestamp;
+    header[8] = (uint8_t)(packetizer->ssrc >> 24);
+    header[9] = (uint8_t)(packetizer->ssrc >> 16);
+    header[10] = (uint8_t)(packetizer->ssrc >> 8);
+    header[11] = (uint8_t)packetizer->ssrc;
+}
+
+/**
+ * @description: 缓存 SPS/PPS，内容变化时递增版本号
+ * @param {RtspRtpPacketizer *} packetizer
+ * @param {const MediaNaluView *} nalu
+ * @return {static void}
+ */
+static void rtsp_rtp_cache_parameter_set(RtspRtpPacketizer *packetizer, const MediaNaluView *nalu) {
+    int type = nalu->data[0] & 0x1F;
+    uint8_t *dst;
+    size_t *dst_len;
+
+    if (type == H264_NALU_TYPE_SPS) {
+        dst = packetizer->sps;
+        dst_len = &packetizer->sps_len;
+    } else if (type == H264_NALU_TYPE_PPS) {
+        dst = packetizer->pps;
+        dst_len = &packetizer->pps_len;
+    } else {
+        return;
+    }
+    if (nalu->size > RTSP_RTP_MAX_PARAMETER_SET) {
+        return;
+    }
+    if (*dst_len == nalu->size && memcmp(dst, nalu->data, nalu->size) == 0) {
+        return;
+    }
+    memcpy(dst, nalu->data, nalu->size);
+    *dst_len = nalu->size;
+    packetizer->parameter_version++;
+}
+
+/**
+ * @description: 计算一组 NALU 打包后的 RTP 包数
+ * @param {const RtspRtpPacketizer *} packetizer
+ * @param {const MediaNaluView *} nalus
+ * @param {size_t} count
+ * @return {static int}
+ */
+static int rtsp_rtp_count_packets(const RtspRtpPacketizer *packetizer, const MediaNaluView *nalus, size_t count) {
+    size_t fragment = packetizer->max_payload - 2;
+    int packets = 0;
+    size_t i;
+
+    for (i = 0; i < count; ++i) {
+        if (nalus[i].size <= packetizer->max_payload) {
+            packets++;
+        } else {
+            /* FU-A 去掉原 NALU 头后按 fragment 切分。 */
+            packets += (int)((nalus[i].size - 1 + fragment - 1) / fragment);
+        }
+    }
+    return packets;
+}
+
+/**
+ * @description: 把一组 NALU 打成 RTP 包写入 frame，负载只记录引用
+ * @param {RtspRtpPacketizer *} packetizer
+ * @param {RtspRtpFrame *} frame
+ * @param {const MediaNaluView *} nalus
+ * @param {size_t} count
+ * @param {int} last_marker 最后一个包是否置 marker
+ * @return {static void}
+ */
+static void rtsp_rtp_fill_packets(RtspRtpPacketizer *packetizer,
+                                  RtspRtpFrame *frame,
+                                  const MediaNaluView *nalus,
+                                  size_t count,
+                                  int last_marker) {
+    size_t fragment = packetizer->max_payload - 2;
+    int index = 0;
+    size_t i;
+
+    frame->first_seq = packetizer->next_seq;
+    frame->bytes = 0;
+    for (i = 0; i < count; ++i) {
+        const uint8_t *nalu = nalus[i].data;
+        size_t size = nalus[i].size;
+        int last_nalu = (i + 1 == count);
+
+        if (size <= packetizer->max_payload) {
+            RtspRtpPacket *pkt = &frame->packets[index++];
+
+            rtsp_rtp_write_header(packetizer, pkt->header, frame->rtp_timestamp, last_nalu && last_marker);
+            pkt->header_len = RTSP_RTP_HEADER_SIZE;
+            pkt->payload = nalu;
+            pkt->payload_len = size;
+            frame->bytes += RTSP_RTP_HEADER_SIZE + size;
+        } else {
+            size_t offset = 1;
+
+            while (offset < size) {
+                RtspRtpPacket *pkt = &frame->packets[index++];
+                size_t chunk = size - offset;
+                int start = (offset == 1);
+                int end;
+
+                if (chunk > fragment) {
+                    chunk = fragment;
+                }
+                end = (offset + chunk == size);
+                rtsp_rtp_write_header(packetizer, pkt->header, frame->rtp_timestamp, end && last_nalu && last_marker);
+                /* FU indicator 沿用 F/NRI，类型 28；FU header 带 S/E 位和原 NALU 类型。 */
+                pkt->header[RTSP_RTP_HEADER_SIZE] = (uint8_t)((nalu[0] & 0xE0) | RTSP_RTP_FU_A_TYPE);
+                pkt->header[RTSP_RTP_HEADER_SIZE + 1] =
+                    (uint8_t)((start ? 0x80 : 0x00) | (end ? 0x40 : 0x00) | (nalu[0] & 0x1F));
+                pkt->header_len = RTSP_RTP_HEADER_SIZE + 2;
+                pkt->payload = nalu + offset;
+                pkt->payload_len = chunk;
+                frame->bytes += RTSP_RTP_HEADER_SIZE + 2 + chunk;
+                offset += chunk;
+            }
+        }
+    }
+    frame->packet_count = index;
+}
+
+void rtsp_rtp_packetizer_init(RtspRtpPacketizer *packetizer,
+                              uint32_t ssrc,
+                              uint16_t initial_seq,
+                              uint32_t timestamp_base,
+                              size_t max_payload) {
+    if (!packetizer) {
+        return;
+    }
+    memset(packetizer, 0, sizeof(*packetizer));
+    packetizer->ssrc = ssrc;
+    packetizer->next_seq = initial_seq;
+    packetizer->timestamp_base = timestamp_base;
+    packetizer->max_payload = (max_payload > 2) ? max_payload : RTSP_RTP_DEFAULT_MAX_PAYLOAD;
+}
+
+uint32_t rtsp_rtp_timestamp(const RtspRtpPacketizer *packetizer, uint64_t pts_us) {
+    return packetizer->timestamp_base + (uint32_t)(pts_us * 9ULL / 100ULL);
+}
+
+int rtsp_rtp_packetize(RtspRtpPacketizer *packetizer, const MediaPacket *packet, RtspRtpFrame **out_frame) {
+    MediaNaluView nalus[RTSP_RTP_MAX_NALUS];
+    RtspRtpFrame *frame;
+    size_t count = 0;
+    size_t i;
+    int packets;
+
+    *out_frame = NULL;
+    if (!packetizer || !packet || !packet->buffer) {
+        return -1;
+    }
+    if (media_annexb_split(packet->buffer->data, packet->buffer->size, nalus, RTSP_RTP_MAX_NALUS, &count) != 0) {
+        fprintf(stderr, "[RTSP][ERROR] too many NALUs frame=%llu\n", (unsigned long long)packet->frame_id);
+        return -1;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    for (i = 0; i < count; ++i) {
+        rtsp_rtp_cache_parameter_set(packetizer, &nalus[i]);
+    }
+
+    packets = rtsp_rtp_count_packets(packetizer, nalus, count);
+    frame = (RtspRtpFrame *)calloc(1, sizeof(*frame) + (size_t)packets * sizeof(RtspRtpPacket));
+    if (!frame) {
+        return -1;
+    }
+    frame->ref_count = 1;
+    frame->is_key_frame = packet->is_key_frame;
+    frame->pts_us = packet->pts_us;
+    frame->rtp_timestamp = rtsp_rtp_timestamp(packetizer, packet->pts_us);
+    media_packet_init(&frame->packet);
+    media_packet_copy_ref(&frame->packet, packet);
+    rtsp_rtp_fill_packets(packetizer, frame, nalus, count, 1);
+    *out_frame = frame;
+    return 0;
+}
+
+int rtsp_rtp_packetize_parameter_sets(RtspRtpPacketizer *packetizer, uint64_t pts_us, RtspRtpFrame **out_frame) {
+    MediaNaluView nalus[2];
+    RtspRtpFrame *frame;
+
+    *out_frame = NULL;
+    if (!packetizer || packetizer->sps_len == 0 || packetizer->pps_len == 0) {
+        return 0;
+    }
+    frame = (RtspRtpFrame *)calloc(1, sizeof(*frame) + 2 * sizeof(RtspRtpPacket));
+    if (!frame) {
+        return -1;
+    }
+    frame->owned = (uint8_t *)malloc(packetizer->sps_len + packetizer->pps_len);
+    if (!frame->owned) {
+        free(frame);
+        return -1;
+    }
+    memcpy(frame->owned, packetizer->sps, packetizer->sps_len);
+    memcpy(frame->owned + packetizer->sps_len, packetizer->pps, packetizer->pps_len);
+    nalus[0].data = frame->owned;
+    nalus[0].size = packetizer->sps_len;
+    nalus[1].data = frame->owned + packetizer->sps_len;
+    nalus[1].size = packetizer->pps_len;
+
+    frame->ref_count = 1;
+    frame->is_parameter_sets = 1;
+    frame->pts_us = pts_us;
+    frame->rtp_timestamp = rtsp_rtp_timestamp(packetizer, pts_us);
+    media_packet_init(&frame->packet);
+    /* 参数集和紧随其后的帧属于同一访问单元，不置 marker。 */
+    rtsp_rtp_fill_packets(packetizer, frame, nalus, 2, 0);
+    *out_frame = frame;
+    return 0;
+}
+
+/**
+ * @description: Base64 编码
+ * @param {const uint8_t *} data
+ * @param {size_t} len
+ * @param {char *} out
+ * @param {size_t} out_size
+ * @return {static int} 写入长度，缓冲不足返回 -1
+ */
+static int rtsp_rtp_base64(const uint8_t *data, size_t len, char *out, size_t out_size) {
+    size_t need = ((len + 2) / 3) * 4;
+    size_t i;
+    size_t o = 0;
+
+    if (need + 1 > out_size) {
+        return -1;
+    }
+    for (i = 0; i + 2 < len; i += 3) {
+        uint32_t v = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | data[i + 2];
+        out[o++] = BASE64_TABLE[(v >> 18) & 0x3F];
+        out[o++] = BASE64_TABLE[(v >> 12) & 0x3F];
+        out[o++] = BASE64_TABLE[(v >> 6) & 0x3F];
+        out[o++] = BASE64_TABLE[v & 0x3F];
+    }
+    if (i < len) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < len) {
+            v |= (uint32_t)data[i + 1] << 8;
+        }
+        out[o++] = BASE64_TABLE[(v >> 18) & 0x3F];
+        out[o++] = BASE64_TABLE[(v >> 12) & 0x3F];
+        out[o++] = (i + 1 < len) ? BASE64_TABLE[(v >> 6) & 0x3F] : '=';
+        out[o++] = '=';
+    }
+    out[o] = '\0';
+    return (int)o;
+}
+
+int rtsp_rtp_format_sprop(const RtspRtpPacketizer *packetizer, char *out, size_t out_size) {
+    char sps_b64[RTSP_RTP_MAX_PARAMETER_SET * 2];
+    char pps_b64[RTSP_RTP_MAX_PARAMETER_SET * 2];
+    int written;
+
+    if (!packetizer || !out || packetizer->sps_len < 4 || packetizer->pps_len == 0) {
+        return -1;
+    }
+    if (rtsp_rtp_base64(packetizer->sps, packetizer->sps_len, sps_b64, sizeof(sps_b64)) < 0 ||
+        rtsp_rtp_base64(packetizer->pps, packetizer->pps_len, pps_b64, sizeof(pps_b64)) < 0) {
+        return -1;
+    }
+    written = snprintf(out, out_size, "profile-level-id=%02X%02X%02X;sprop-parameter-sets=%s,%s",
+                       packetizer->sps[1],
+                       packetizer->sps[2],
+                       packetizer->sps[3],
+                       sps_b64,
+                       pps_b64);
+    return (written > 0 && (size_t)written < out_size) ? 0 : -1;
+}
+
+int rtsp_rtp_wrap_rtcp(const uint8_t *data, size_t len, RtspRtpFrame **out_frame) {
+    RtspRtpFrame *frame;
+
+    *out_frame = NULL;
+    frame = (RtspRtpFrame *)calloc(1, sizeof(*frame) + sizeof(RtspRtpPacket));
+    if (!frame) {
+        return -1;
+    }
+    frame->owned = (uint8_t *)malloc(len);
+    if (!frame->owned) {
+        free(frame);
+        return -1;
+    }
+    memcpy(frame->owned, data, len);
+    frame->ref_count = 1;
+    frame->is_rtcp = 1;
+    media_packet_init(&frame->packet);
+    /* RTCP 报文整体作为负载，header_len 为 0。 */
+    frame->packets[0].payload = frame->owned;
+    frame->packets[0].payload_len = len;
+    frame->packet_count = 1;
+    frame->bytes = len;
+    *out_frame = frame;
+    return 0;
+}
+
+void rtsp_rtp_frame_release(RtspRtpFrame *frame) {
+    if (!frame) {
+        return;
+    }
+    frame->ref_count--;
+    if (frame->ref_count > 0) {
+        return;
+    }
+    media_packet_reset(&frame->packet);
+    free(frame->owned);
+    free(frame);
+}
@@ -0,0 +1,2663 @@
+#define _GNU_SOURCE
+#include "rtspServer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mediaRtcp.h"
+#include "rtspDigest.h"
+#include "rtspRtp.h"
+
+#define DEFAULT_RTSP_SERVER_IP "0.0.0.0"
+#define DEFAULT_RTSP_SERVER_PORT 8554
+#define DEFAULT_RTSP_SERVER_MAX_CLIENTS 32
+#define DEFAULT_RTSP_SERVER_CLIENT_BUDGET_BYTES (4 * 1024 * 1024)
+#define DEFAULT_RTSP_SERVER_INBOX_CAPACITY 64
+#define DEFAULT_RTSP_SERVER_EVICT_DROPS 3
+#define DEFAULT_RTSP_SERVER_EVICT_WINDOW_MS 30000
+#define RTSP_SERVER_PENDING_CONNECTIONS 16
+#define RTSP_SERVER_REALM "RKMediaGateway"
+#define RTSP_SERVER_NAME "RKMediaGateway"
+#define RTSP_SESSION_NAME_MAX 64
+#define RTSP_SESSION_TIMEOUT_S 60
+#define RTSP_REQUEST_MAX 4096
+#define RTSP_REPLY_MAX 4096
+#define RTSP_SDP_MAX 2048
+#define RTSP_SPROP_MAX 1024
+#define RTSP_REQUEST_TIMEOUT_MS 10000
+#define RTSP_CLIENT_QUEUE_MAX 256
+#define RTSP_WRITE_MAX_IOV 1023
+#define RTSP_UDP_BATCH 64
+#define RTSP_UDP_SNDBUF (1024 * 1024)
+#define RTSP_UDP_BIND_ATTEMPTS 32
+#define RTSP_INTERLEAVED_PREFIX 4
+#define RTSP_EPOLL_EVENTS 64
+#define RTSP_EPOLL_TIMEOUT_MS 1000
+#define RTSP_STATS_INTERVAL_FRAMES 900
+#define RTSP_RTCP_CNAME RTSP_SERVER_NAME
+
+typedef enum {
+    RTSP_SESSION_FREE = 0,         /* 槽位空闲。 */
+    RTSP_SESSION_ACTIVE = 1,       /* 正在服务。 */
+    RTSP_SESSION_CLOSING = 2       /* 已卸载，等服务线程断开它的客户端。 */
+} RtspSessionState;
+
+typedef enum {
+    RTSP_TRANSPORT_NONE = 0,       /* 尚未 SETUP。 */
+    RTSP_TRANSPORT_UDP = 1,        /* RTP/AVP over UDP。 */
+    RTSP_TRANSPORT_TCP = 2,        /* RTP/AVP/TCP interleaved。 */
+    RTSP_TRANSPORT_MULTICAST = 3   /* RTP/AVP 组播，媒体由 session 统一发往组内。 */
+} RtspTransport;
+
+struct RtspServerSession {
+    RtspServer *server;            /* 所属服务。 */
+    int state;                     /* RtspSessionState，受 server->lock 保护。 */
+    char name[RTSP_SESSION_NAME_MAX]; /* session 名称。 */
+    RtspServerClientCallback callback; /* 客户端播放/断开回调。 */
+    void *opaque;                  /* 回调上下文。 */
+    atomic_int clients;            /* 正在播放的客户端数。 */
+    char sprop[RTSP_SPROP_MAX];    /* SDP fmtp 中的参数集，受 server->lock 保护。 */
+    char multicast_group[INET_ADDRSTRLEN]; /* 组播地址，空表示未开启，受 server->lock 保护。 */
+    int multicast_port;            /* 组播 RTP 端口，受 server->lock 保护。 */
+    int multicast_ttl;             /* 组播 TTL，受 server->lock 保护。 */
+    int multicast_fd;              /* 组播发送 socket，开启后不再变化。 */
+    struct sockaddr_in multicast_addr; /* 组播 RTP 目的地址。 */
+    RtspServerMulticastStats multicast_stats; /* 对外的组播统计，受 server->lock 保护。 */
+    RtspServerReceiverStats receiver_stats; /* 对外的接收报告汇总，受 server->lock 保护。 */
+    uint32_t rtcp_ssrc;            /* 打包器 SSRC 的副本，add_session 后不变，供服务线程组 SR、匹配 RR。 */
+    /* 以下字段只在打包线程（调用 send_packet 的线程）使用。 */
+    RtspRtpPacketizer packetizer;  /* RTP 打包器，SSRC/序号所有客户端共用。 */
+    uint32_t sprop_version;        /* sprop 对应的参数集版本。 */
+    int need_keyframe;             /* inbox 满丢帧后，直到下一个关键帧前不再投递。 */
+    atomic_int gop_cache_max_frames; /* GOP 缓存帧数上限，0 关闭。 */
+    atomic_int gop_cache_max_age_ms; /* 缓存的 IDR 超过该时长后新客户端改为等新的关键帧，0 不限制。 */
+    /* 以下字段只在服务线程使用。 */
+    RtspRtpFrame *gop_cache[RTSP_SERVER_GOP_CACHE_MAX_FRAMES]; /* 从最近一个 IDR 开始的帧引用。 */
+    int gop_cache_count;           /* gop_cache 有效帧数。 */
+    size_t gop_cache_bytes;        /* 缓存帧按 TCP interleaved 发送时的总字节数。 */
+    uint16_t gop_cache_next_seq;   /* 缓存中最后一帧之后应出现的 RTP 序号，用于发现中途丢帧。 */
+    long long gop_cache_start_ms;  /* 缓存的 IDR 到达服务线程的时间。 */
+    int multicast_clients;         /* 以组播方式播放的客户端数。 */
+    int multicast_waiting_for_keyframe; /* 组内开始发送或丢帧后，等下一个关键帧再发。 */
+    uint64_t multicast_frames;     /* 发往组内的帧数。 */
+    uint64_t multicast_packets;    /* 发往组内的 RTP 包数。 */
+    uint64_t multicast_bytes;      /* 发往组内的字节数。 */
+    uint64_t multicast_drops;      /* 组内丢帧次数。 */
+    int rtcp_has_frame;            /* 是否已分发过媒体帧，SR 需要它建立 NTP 与 RTP 时间戳的对应。 */
+    uint32_t rtcp_rtp_timestamp;   /* 最近分发的媒体帧的 RTP 时间戳。 */
+    uint64_t rtcp_pts_us;          /* 最近分发的媒体帧的 pts。 */
+    uint32_t rtcp_packets;         /* 本 SSRC 累计分发的 RTP 包数（SR 的 sender packet count）。 */
+    uint32_t rtcp_octets;          /* 本 SSRC 累计分发的 RTP 负载字节数（SR 的 sender octet count）。 */
+    long long rtcp_next_sr_ms;     /* 下一次发 SR 的时间。 */
+    RtspServerClientStats client_stats[RTSP_SERVER_CLIENT_STATS_MAX]; /* 播放中单播客户端的统计快照，受 server->lock 保护。 */
+    int client_stats_count;        /* client_stats 有效个数，受 server->lock 保护。 */
+};
+
+typedef struct {
+    int fd;                        /* RTSP 控制连接。 */
+    int closed;                    /* 已关闭，等本轮事件处理完再回收。 */
+    RtspServerSession *session;    /* SETUP 后绑定的 session。 */
+    int transport;                 /* RtspTransport。 */
+    int playing;                   /* 是否已 PLAY。 */
+    int waiting_for_keyframe;      /* 播放开始或 UDP 丢包后，等下一个关键帧再发。 */
+    int want_write;                /* 是否已注册 EPOLLOUT。 */
+    int close_after_reply;         /* 响应写完后关闭（TEARDOWN）。 */
+    int authorized;                /* 本连接是否已通过鉴权。 */
+    int has_request;               /* 是否收到过完整请求。 */
+    char session_id[24];           /* RTSP Session 头。 */
+    char nonce[40];                /* Digest nonce。 */
+    int rtp_channel;               /* interleaved RTP 通道号。 */
+    int rtcp_channel;              /* interleaved RTCP 通道号。 */
+    struct sockaddr_in rtp_addr;   /* UDP 模式下客户端 RTP 地址。 */
+    struct sockaddr_in rtcp_addr;  /* UDP 模式下客户端 RTCP 地址。 */
+    char peer_ip[INET_ADDRSTRLEN]; /* 客户端地址。 */
+    char local_ip[INET_ADDRSTRLEN];/* 本端地址，用于 SDP 和 Content-Base。 */
+    long long accepted_ms;         /* 接入时间，用于请求超时。 */
+    long long last_activity_ms;    /* 最近一次收到 RTSP 请求或 RTCP 的时间。 */
+    char request[RTSP_REQUEST_MAX];/* 已读到的请求数据。 */
+    size_t request_len;            /* 请求数据长度。 */
+    char reply[RTSP_REPLY_MAX];    /* 待写的 RTSP 响应。 */
+    size_t reply_len;              /* reply 长度。 */
+    size_t reply_offset;           /* reply 已写字节数。 */
+    RtspRtpFrame *queue[RTSP_CLIENT_QUEUE_MAX]; /* TCP 模式待写帧的环形队列。 */
+    int queue_head;                /* 队头下标。 */
+    int queue_size;                /* 队列有效元素数。 */
+    int packet_index;              /* 队头帧正在写的包。 */
+    size_t packet_offset;          /* 该包（含 4 字节 interleaved 前缀）已写字节数。 */
+    size_t pending_bytes;          /* 队列中尚未写出的媒体字节数，超过预算时丢帧等下一个关键帧。 */
+    size_t peak_pending_bytes;     /* pending_bytes 的历史最大值。 */
+    uint64_t sent_frames;          /* 完整写出的媒体帧数。 */
+    uint64_t bytes_sent;           /* 写给该客户端的字节数。 */
+    uint64_t dropped_frames;       /* 因积压或发送缓冲满丢弃的媒体帧数。 */
+    uint64_t drop_events;          /* 转为等关键帧的次数。 */
+    long long drop_window_start_ms;/* 超限次数统计窗口的起点。 */
+    int window_drops;              /* 当前窗口内的超限次数，达到阈值即断开。 */
+    MediaRtcpPeer rtcp;            /* 发给该客户端的 SR 计数与它回来的接收报告（丢包、抖动、RTT）。 */
+} RtspClient;
+
+struct RtspServer {
+    RtspServerConfig config;       /* 配置副本，字符串指向下面的缓冲。 */
+    char listen_ip[64];            /* 监听地址。 */
+    char user[64];                 /* 鉴权用户名。 */
+    char password[64];             /* 鉴权密码。 */
+    int listen_fd;                 /* RTSP 监听 socket。 */
+    int rtp_fd;                    /* 所有 UDP 客户端共用的 RTP 发送 socket。 */
+    int rtcp_fd;                   /* 所有 UDP 客户端共用的 RTCP socket（端口为 RTP 加一）。 */
+    int rtp_port;                  /* RTP 本地端口。 */
+    int event_fd;                  /* 打包线程投递新帧后唤醒服务线程。 */
+    int epoll_fd;                  /* 服务线程的 epoll。 */
+    pthread_t thread;              /* 服务线程。 */
+    int running;                   /* 服务线程是否已启动。 */
+    volatile int stop_requested;   /* 是否已请求服务线程退出。 */
+    pthread_mutex_t lock;          /* 保护 inbox、session 状态、stats 和随机数。 */
+    RtspRtpFrame **inbox;          /* 打包线程到服务线程的帧环形队列。 */
+    int inbox_capacity;            /* inbox 容量。 */
+    int inbox_head;                /* inbox 队头下标。 */
+    int inbox_size;                /* inbox 有效元素数。 */
+    RtspServerSession sessions[RTSP_SERVER_MAX_SESSIONS]; /* session 槽位。 */
+    int sessions_closing;          /* 是否有待清理的 session，受 lock 保护。 */
+    RtspServerStats stats;         /* 对外统计。 */
+    uint64_t random_state;         /* SSRC、Session ID、nonce 的随机源，受 lock 保护。 */
+    long long start_ms;            /* 启动时间，用作 SDP 的 session 版本。 */
+    /* 以下字段只在服务线程使用。 */
+    RtspClient **clients;          /* 所有连接。 */
+    int client_capacity;           /* clients 容量。 */
+    int client_count;              /* 连接数。 */
+    int setup_clients;             /* 已 SETUP 的客户端数。 */
+    int playing_clients;           /* 正在播放的客户端数。 */
+    uint64_t served_frames;        /* 服务线程已分发的帧数。 */
+    uint64_t rtp_packets;          /* 累计写出 RTP 包数。 */
+    uint64_t bytes_sent;           /* 累计写出字节数。 */
+    uint64_t send_calls;           /* 累计发送系统调用次数。 */
+    uint64_t udp_drops;            /* 累计 UDP 丢帧次数。 */
+    uint64_t queue_drops;          /* 累计 TCP 发送队列超限丢帧次数。 */
+    uint64_t rtcp_sr_sent;         /* 累计发出的 RTCP SR 数。 */
+    uint64_t rtcp_rr_received;     /* 累计解析到的接收报告数。 */
+};
+
+/**
+ * @description: 获取单调时钟毫秒数
+ * @return {static long long}
+ */
+static long long rtsp_now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+/**
+ * @description: 获取单调时钟微秒数，与采集侧 pts 同一时钟
+ * @return {static uint64_t}
+ */
+static uint64_t rtsp_now_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+/**
+ * @description: 生成 32 位随机数（xorshift64*），调用方需持有 server->lock
+ * @param {RtspServer *} server
+ * @return {static uint32_t}
+ */
+static uint32_t rtsp_random_locked(RtspServer *server) {
+    uint64_t x = server->random_state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    server->random_state = x;
+    return (uint32_t)((x * 2685821657736338717ULL) >> 32);
+}
+
+/**
+ * @description: 更新 epoll 关注的事件
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @param {int} want_write 是否关注可写
+ * @return {static void}
+ */
+static void rtsp_client_watch(RtspServer *server, RtspClient *client, int want_write) {
+    struct epoll_event ev;
+
+    if (client->want_write == want_write) {
+        return;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLRDHUP | (want_write ? EPOLLOUT : 0);
+    ev.data.ptr = client;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, client->fd, &ev);
+    client->want_write = want_write;
+}
+
+/**
+ * @description: 释放客户端发送队列持有的全部帧引用
+ * @param {RtspClient *} client
+ * @return {static void}
+ */
+static void rtsp_client_clear_queue(RtspClient *client) {
+    while (client->queue_size > 0) {
+        rtsp_rtp_frame_release(client->queue[client->queue_head]);
+        client->queue[client->queue_head] = NULL;
+        client->queue_head = (client->queue_head + 1) % RTSP_CLIENT_QUEUE_MAX;
+        client->queue_size--;
+    }
+    client->packet_index = 0;
+    client->packet_offset = 0;
+    client->pending_bytes = 0;
+}
+
+/**
+ * @description: 关闭客户端：停止播放并回调，释放帧引用，内存等本轮事件处理完再回收
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @param {const char *} reason 日志中的关闭原因
+ * @return {static void}
+ */
+static void rtsp_client_close(RtspServer *server, RtspClient *client, const char *reason) {
+    if (client->closed) {
+        return;
+    }
+    if (client->playing) {
+        RtspServerSession *session = client->session;
+        int clients = atomic_fetch_sub(&session->clients, 1) - 1;
+
+        client->playing = 0;
+        server->playing_clients--;
+        if (client->transport == RTSP_TRANSPORT_MULTICAST) {
+            session->multicast_clients--;
+        }
+        printf("[RTSP] event=client_closed fd=%d session=%s peer=%s reason=%s pending=%zu clients=%d\n",
+               client->fd,
+               session->name,
+               client->peer_ip,
+               reason,
+               client->pending_bytes,
+               clients);
+        if (session->callback) {
+            session->callback(session->opaque, session->name, 0, clients, 0);
+        }
+    }
+    if (client->session) {
+        server->setup_clients--;
+        client->session = NULL;
+    }
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    client->fd = -1;
+    client->closed = 1;
+    rtsp_client_clear_queue(client);
+}
+
+/**
+ * @description: 回收已关闭的客户端
+ * @param {RtspServer *} server
+ * @return {static void}
+ */
+static void rtsp_reap_clients(RtspServer *server) {
+    int i = 0;
+
+    while (i < server->client_count) {
+        if (!server->clients[i]->closed) {
+            i++;
+            continue;
+        }
+        free(server->clients[i]);
+        server->clients[i] = server->clients[server->client_count - 1];
+        server->clients[server->client_count - 1] = NULL;
+        server->client_count--;
+    }
+}
+
+/**
+ * @description: 把已写出的字节从 reply 和帧队列中扣除
+ * @param {RtspClient *} client
+ * @param {size_t} written
+ * @param {int} reply_first 本次写出的数据是否以 reply 开头
+ * @return {static void}
+ */
+static void rtsp_client_consume(RtspClient *client, size_t written, int reply_first) {
+    if (reply_first) {
+        size_t left = client->reply_len - client->reply_offset;
+        size_t step = written < left ? written : left;
+
+        client->reply_offset += step;
+        written -= step;
+        if (client->reply_offset == client->reply_len) {
+            client->reply_offset = 0;
+            client->reply_len = 0;
+        }
+    }
+    client->pending_bytes -= written;
+    while (written > 0 && client->queue_size > 0) {
+        RtspRtpFrame *frame = client->queue[client->queue_head];
+        const RtspRtpPacket *pkt = &frame->packets[client->packet_index];
+        size_t left = RTSP_INTERLEAVED_PREFIX + pkt->header_len + pkt->payload_len - client->packet_offset;
+
+        if (written < left) {
+            client->packet_offset += written;
+            return;
+        }
+        written -= left;
+        client->packet_offset = 0;
+        client->packet_index++;
+        if (client->packet_index >= frame->packet_count) {
+            if (!frame->is_rtcp && !frame->is_parameter_sets) {
+                client->sent_frames++;
+            }
+            client->packet_index = 0;
+            client->queue[client->queue_head] = NULL;
+            client->queue_head = (client->queue_head + 1) % RTSP_CLIENT_QUEUE_MAX;
+            client->queue_size--;
+            rtsp_rtp_frame_release(frame);
+        }
+    }
+}
+
+/**
+ * @description: 尽量把客户端积压的响应和 interleaved RTP 写进 socket，写不动时注册 EPOLLOUT 等待。
+ *   响应只插在 RTP 包边界上，保证 TCP 流内 interleaved 分帧完整。
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @return {static int} 0 成功，-1 连接已关闭
+ */
+static int rtsp_client_flush(RtspServer *server, RtspClient *client) {
+    struct iovec iov[RTSP_WRITE_MAX_IOV];
+    uint8_t prefixes[RTSP_WRITE_MAX_IOV / 3][RTSP_INTERLEAVED_PREFIX];
+    struct msghdr msg;
+
+    while (!client->closed && (client->reply_offset < client->reply_len || client->pending_bytes > 0)) {
+        int reply_pending = client->reply_offset < client->reply_len;
+        int reply_first = reply_pending && client->packet_offset == 0;
+        /* 队头包写了一半又有响应要发时，这一轮只补完这个包。 */
+        int packet_limit = (reply_pending && !reply_first) ? 1 : INT_MAX;
+        size_t skip = client->packet_offset;
+        size_t total = 0;
+        ssize_t written;
+        int packets = 0;
+        int n = 0;
+        int pi = client->packet_index;
+        int qi;
+
+        if (reply_first) {
+            iov[n].iov_base = client->reply + client->reply_offset;
+            iov[n].iov_len = client->reply_len - client->reply_offset;
+            total += iov[n].iov_len;
+            n++;
+        }
+        for (qi = 0; qi < client->queue_size && n + 3 <= RTSP_WRITE_MAX_IOV && packets < packet_limit; ++qi) {
+            const RtspRtpFrame *frame = client->queue[(client->queue_head + qi) % RTSP_CLIENT_QUEUE_MAX];
+
+            for (; pi < frame->packet_count && n + 3 <= RTSP_WRITE_MAX_IOV && packets < packet_limit; ++pi) {
+                const RtspRtpPacket *pkt = &frame->packets[pi];
+                uint8_t *prefix = prefixes[packets++];
+                size_t wire = (size_t)pkt->header_len + pkt->payload_len;
+                struct iovec seg[3];
+                int j;
+
+                /* 共享包里不含通道号，interleaved 前缀按客户端各自的通道现场生成。 */
+                prefix[0] = '$';
+                prefix[1] = (uint8_t)(frame->is_rtcp ? client->rtcp_channel : client->rtp_channel);
+                prefix[2] = (uint8_t)(wire >> 8);
+                prefix[3] = (uint8_t)wire;
+                seg[0].iov_base = prefix;
+                seg[0].iov_len = RTSP_INTERLEAVED_PREFIX;
+                seg[1].iov_base = (void *)pkt->header;
+                seg[1].iov_len = pkt->header_len;
+                seg[2].iov_base = (void *)pkt->payload;
+                seg[2].iov_len = pkt->payload_len;
+                for (j = 0; j < 3; ++j) {
+                    if (skip >= seg[j].iov_len) {
+                        skip -= seg[j].iov_len;
+                        continue;
+                    }
+                    iov[n].iov_base = (uint8_t *)seg[j].iov_base + skip;
+                    iov[n].iov_len = seg[j].iov_len - skip;
+                    total += iov[n].iov_len;
+                    skip = 0;
+                    n++;
+                }
+            }
+            pi = 0;
+        }
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)n;
+        written = sendmsg(client->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                rtsp_client_watch(server, client, 1);
+                return 0;
+            }
+            rtsp_client_close(server, client, "send_error");
+            return -1;
+        }
+        server->send_calls++;
+        server->bytes_sent += (uint64_t)written;
+        client->bytes_sent += (uint64_t)written;
+        rtsp_client_consume(client, (size_t)written, reply_first);
+        if ((size_t)written < total) {
+            rtsp_client_watch(server, client, 1);
+            return 0;
+        }
+        server->rtp_packets += (uint64_t)packets;
+    }
+
+    if (client->closed) {
+        return -1;
+    }
+    rtsp_client_watch(server, client, 0);
+    if (client->close_after_reply) {
+        rtsp_client_close(server, client, "teardown");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @description: 帧在 TCP interleaved 连接上占用的字节数
+ * @param {const RtspRtpFrame *} frame
+ * @return {static size_t}
+ */
+static size_t rtsp_frame_wire_bytes(const RtspRtpFrame *frame) {
+    return frame->bytes + (size_t)frame->packet_count * RTSP_INTERLEAVED_PREFIX;
+}
+
+/**
+ * @description: 发送队列超限：丢掉还没开始写的帧，写了一半的队头帧保留以保证 interleaved 分帧完整，
+ *   客户端改从下一个关键帧继续；窗口内超限次数达到阈值的客户端判定为持续过慢并断开
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @return {static int} 0 已丢帧，-1 客户端被断开
+ */
+static int rtsp_client_drop_backlog(RtspServer *server, RtspClient *client) {
+    long long now = rtsp_now_ms();
+    int keep = (client->packet_index > 0 || client->packet_offset > 0) ? 1 : 0;
+    int dropped = 0;
+
+    if (now - client->drop_window_start_ms > server->config.slow_client_evict_window_ms) {
+        client->drop_window_start_ms = now;
+        client->window_drops = 0;
+    }
+    client->window_drops++;
+    client->drop_events++;
+    server->queue_drops++;
+    if (server->config.slow_client_evict_drops > 0 && client->window_drops >= server->config.slow_client_evict_drops) {
+        pthread_mutex_lock(&server->lock);
+        server->stats.slow_drops++;
+        pthread_mutex_unlock(&server->lock);
+        rtsp_client_close(server, client, "slow_client");
+        return -1;
+    }
+    while (client->queue_size > keep) {
+        int tail = (client->queue_head + client->queue_size - 1) % RTSP_CLIENT_QUEUE_MAX;
+        RtspRtpFrame *frame = client->queue[tail];
+
+        if (!frame->is_rtcp && !frame->is_parameter_sets) {
+            dropped++;
+        }
+        client->pending_bytes -= rtsp_frame_wire_bytes(frame);
+        client->queue[tail] = NULL;
+        client->queue_size--;
+        rtsp_rtp_frame_release(frame);
+    }
+    client->dropped_frames += (uint64_t)dropped;
+    client->waiting_for_keyframe = 1;
+    printf("[RTSP] event=client_backlog_drop session=%s peer=%s dropped_frames=%d pending=%zu window_drops=%d\n",
+           client->session->name,
+           client->peer_ip,
+           dropped,
+           client->pending_bytes,
+           client->window_drops);
+    return 0;
+}
+
+/**
+ * @description: 把帧追加到 TCP 客户端发送队列。积压超限时只处理这一个客户端：丢掉它的积压并等下一个关键帧，
+ *   触发超限的帧是关键帧且放得下时直接从它继续；同一 session 的其他客户端不受影响
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @param {RtspRtpFrame *} frame
+ * @return {static int} 0 已入队，-1 未入队（丢帧或客户端被断开）
+ */
+static int rtsp_client_push(RtspServer *server, RtspClient *client, RtspRtpFrame *frame) {
+    size_t wire = rtsp_frame_wire_bytes(frame);
+    size_t budget = (size_t)server->config.client_budget_bytes;
+    int tail;
+
+    if (client->queue_size >= RTSP_CLIENT_QUEUE_MAX || client->pending_bytes + wire > budget) {
+        /* SR 不值得为它丢媒体帧，下个周期再发。 */
+        if (frame->is_rtcp) {
+            return -1;
+        }
+        if (rtsp_client_drop_backlog(server, client) != 0) {
+            return -1;
+        }
+        if (!frame->is_key_frame || client->queue_size >= RTSP_CLIENT_QUEUE_MAX ||
+            client->pending_bytes + wire > budget) {
+            if (!frame->is_parameter_sets) {
+                client->dropped_frames++;
+            }
+            return -1;
+        }
+        client->waiting_for_keyframe = 0;
+    }
+    frame->ref_count++;
+    tail = (client->queue_head + client->queue_size) % RTSP_CLIENT_QUEUE_MAX;
+    client->queue[tail] = frame;
+    client->queue_size++;
+    client->pending_bytes += wire;
+    if (client->pending_bytes > client->peak_pending_bytes) {
+        client->peak_pending_bytes = client->pending_bytes;
+    }
+    return 0;
+}
+
+/**
+ * @description: 用 sendmmsg 把一帧的全部 RTP 包批量发往一个 UDP 地址
+ * @param {RtspServer *} server
+ * @param {int} fd 发送 socket
+ * @param {struct sockaddr_in *} addr 目的地址
+ * @param {const RtspRtpFrame *} frame
+ * @param {uint64_t *} bytes 输出本次写出的字节数
+ * @return {static int} 写出的 RTP 包数，小于 frame->packet_count 表示发送缓冲已满
+ */
+static int rtsp_server_send_udp(RtspServer *server,
+                                int fd,
+                                struct sockaddr_in *addr,
+                                const RtspRtpFrame *frame,
+                                uint64_t *bytes) {
+    struct mmsghdr msgs[RTSP_UDP_BATCH];
+    struct iovec iov[RTSP_UDP_BATCH][2];
+    int sent = 0;
+
+    while (sent < frame->packet_count) {
+        int batch = frame->packet_count - sent;
+        int result;
+        int i;
+
+        if (batch > RTSP_UDP_BATCH) {
+            batch = RTSP_UDP_BATCH;
+        }
+        memset(msgs, 0, sizeof(msgs[0]) * (size_t)batch);
+        for (i = 0; i < batch; ++i) {
+            const RtspRtpPacket *pkt = &frame->packets[sent + i];
+
+            iov[i][0].iov_base = (void *)pkt->header;
+            iov[i][0].iov_len = pkt->header_len;
+            iov[i][1].iov_base = (void *)pkt->payload;
+            iov[i][1].iov_len = pkt->payload_len;
+            msgs[i].msg_hdr.msg_iov = iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 2;
+            msgs[i].msg_hdr.msg_name = addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(*addr);
+        }
+        result = sendmmsg(fd, msgs, (unsigned int)batch, MSG_DONTWAIT);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        server->send_calls++;
+        for (i = 0; i < result; ++i) {
+            *bytes += msgs[i].msg_len;
+        }
+        server->rtp_packets += (uint64_t)result;
+        sent += result;
+        if (result == 0) {
+            break;
+        }
+    }
+    server->bytes_sent += *bytes;
+    return sent;
+}
+
+/**
+ * @description: 用共享 RTP socket 发送一帧给 UDP 客户端，发送缓冲满时丢掉本帧剩余部分并等下一个关键帧
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @param {const RtspRtpFrame *} frame
+ * @return {static void}
+ */
+static void rtsp_client_send_udp(RtspServer *server, RtspClient *client, const RtspRtpFrame *frame) {
+    uint64_t bytes = 0;
+
+    int sent = rtsp_server_send_udp(server, server->rtp_fd, &client->rtp_addr, frame, &bytes);
+
+    client->bytes_sent += bytes;
+    if (sent < frame->packet_count) {
+        /* UDP 本身会丢包，这里不排队，直接让客户端从下一个关键帧恢复。 */
+        client->waiting_for_keyframe = 1;
+        client->dropped_frames++;
+        client->drop_events++;
+        server->udp_drops++;
+    } else if (!frame->is_parameter_sets) {
+        client->sent_frames++;
+    }
+}
+
+/**
+ * @description: 打印运行统计
+ * @param {RtspServer *} server
+ * @return {static void}
+ */
+static void rtsp_server_log_stats(RtspServer *server) {
+    RtspServerStats stats;
+    int i;
+
+    for (i = 0; i < RTSP_SERVER_MAX_SESSIONS; ++i) {
+        RtspServerSession *session = &server->sessions[i];
+        RtspServerMulticastStats group;
+        char name[RTSP_SESSION_NAME_MAX];
+        char address[INET_ADDRSTRLEN];
+        int port;
+
+        pthread_mutex_lock(&server->lock);
+        group = session->multicast_stats;
+        memcpy(name, session->name, sizeof(name));
+        memcpy(address, session->multicast_group, sizeof(address));
+        port = session->multicast_port;
+        pthread_mutex_unlock(&server->lock);
+        if (address[0] == '\0') {
+            continue;
+        }
+        printf("[RTSP] event=multicast_stats session=%s group=%s:%d clients=%d frames=%llu rtp_packets=%llu bytes_sent=%llu send_drops=%llu\n",
+               name,
+               address,
+               port,
+               group.clients,
+               (unsigned long long)group.frames,
+               (unsigned long long)group.rtp_packets,
+               (unsigned long long)group.bytes_sent,
+               (unsigned long long)group.send_drops);
+    }
+    for (i = 0; i < server->client_count; ++i) {
+        const RtspClient *client = server->clients[i];
+
+        if (client->closed || !client->playing || client->transport == RTSP_TRANSPORT_MULTICAST) {
+            continue;
+        }
+        printf("[RTSP] event=client_rtcp session=%s peer=%s transport=%s sr_sent=%llu reports=%llu fraction_lost=%.1f%% cumulative_lost=%d jitter_ms=%.1f rtt_ms=%d\n",
+               client->session->name,
+               client->peer_ip,
+               client->transport == RTSP_TRANSPORT_TCP ? "tcp" : "udp",
+               (unsigned long long)client->rtcp.sr_sent,
+               (unsigned long long)client->rtcp.reports,
+               client->rtcp.loss_percent,
+               (int)client->rtcp.cumulative_lost,
+               client->rtcp.jitter_ms,
+               client->rtcp.rtt_ms);
+    }
+    pthread_mutex_lock(&server->lock);
+    stats = server->stats;
+    pthread_mutex_unlock(&server->lock);
+    printf("[RTSP] event=stats port=%d clients=%d accepted=%llu rejected=%llu auth_failures=%llu slow_drops=%llu queue_drops=%llu frames=%llu inbox_drops=%llu rtp_packets=%llu bytes_sent=%llu send_calls=%llu udp_drops=%llu rtcp_sr=%llu rtcp_rr=%llu\n",
+           server->config.listen_port,
+           stats.clients,
+           (unsigned long long)stats.accepted,
+           (unsigned long long)stats.rejected,
+           (unsigned long long)stats.auth_failures,
+           (unsigned long long)stats.slow_drops,
+           (unsigned long long)stats.queue_drops,
+           (unsigned long long)stats.frames,
+           (unsigned long long)stats.inbox_drops,
+           (unsigned long long)stats.rtp_packets,
+           (unsigned long long)stats.bytes_sent,
+           (unsigned long long)stats.send_calls,
+           (unsigned long long)stats.udp_drops,
+           (unsigned long long)stats.rtcp_sender_reports,
+           (unsigned long long)stats.rtcp_receiver_reports);
+}
+
+/**
+ * @description: 服务线程把内部计数同步到对外统计
+ * @param {RtspServer *} server
+ * @return {static void}
+ */
+static void rtsp_server_publish_stats(RtspServer *server) {
+    RtspServerReceiverStats receivers[RTSP_SERVER_MAX_SESSIONS];
+    long long now = rtsp_now_ms();
+    int i;
+
+    /* 接收报告按 session 汇总最差值，超过 MEDIA_RTCP_REPORT_STALE_MS 没有新报告的客户端不计入。 */
+    memset(receivers, 0, sizeof(receivers));
+    for (i = 0; i < RTSP_SERVER_MAX_SESSIONS; ++i) {
+        receivers[i].max_rtt_ms = -1;
+    }
+    for (i = 0; i < server->client_count; ++i) {
+        const RtspClient *client = server->clients[i];
+        RtspServerReceiverStats *agg;
+
+        if (client->closed || !client->playing || client->rtcp.reports == 0 ||
+            now - client->rtcp.last_report_ms > MEDIA_RTCP_REPORT_STALE_MS) {
+            continue;
+        }
+        agg = &receivers[client->session - server->sessions];
+        agg->receivers++;
+        agg->reports += client->rtcp.reports;
+        if (client->rtcp.loss_percent > agg->max_loss_percent) {
+            agg->max_loss_percent = client->rtcp.loss_percent;
+        }
+        if (client->rtcp.jitter_ms > agg->max_jitter_ms) {
+            agg->max_jitter_ms = client->rtcp.jitter_ms;
+        }
+        if (client->rtcp.rtt_ms > agg->max_rtt_ms) {
+            agg->max_rtt_ms = client->rtcp.rtt_ms;
+        }
+    }
+
+    pthread_mutex_lock(&server->lock);
+    for (i = 0; i < RTSP_SERVER_MAX_SESSIONS; ++i) {
+        server->sessions[i].client_stats_count = 0;
+    }
+    for (i = 0; i < server->client_count; ++i) {
+        const RtspClient *client = server->clients[i];
+        RtspServerClientStats *out;
+
+        if (client->closed || !client->playing || client->transport == RTSP_TRANSPORT_MULTICAST ||
+            client->session->client_stats_count >= RTSP_SERVER_CLIENT_STATS_MAX) {
+            continue;
+        }
+        out = &client->session->client_stats[client->session->client_stats_count++];
+        memcpy(out->peer, client->peer_ip, sizeof(out->peer));
+        out->transport = client->transport == RTSP_TRANSPORT_TCP ? 1 : 0;
+        out->queue_frames = client->queue_size;
+        out->queue_bytes = client->pending_bytes;
+        out->peak_queue_bytes = client->peak_pending_bytes;
+        out->waiting_for_keyframe = client->waiting_for_keyframe;
+        out->sent_frames = client->sent_frames;
+        out->bytes_sent = client->bytes_sent;
+        out->dropped_frames = client->dropped_frames;
+        out->drop_events = client->drop_events;
+    }
+    for (i = 0; i < RTSP_SERVER_MAX_SESSIONS; ++i) {
+        RtspServerSession *session = &server->sessions[i];
+
+        session->receiver_stats = receivers[i];
+        if (session->multicast_group[0]) {
+            session->multicast_stats.clients = session->multicast_clients;
+            session->multicast_stats.frames = session->multicast_frames;
+            session->multicast_stats.rtp_packets = session->multicast_packets;
+            session->multicast_stats.bytes_sent = session->multicast_bytes;
+            session->multicast_stats.send_drops = session->multicast_drops;
+        }
+    }
+    server->stats.clients = server->playing_clients;
+    server->stats.rtp_packets = server->rtp_packets;
+    server->stats.bytes_sent = server->bytes_sent;
+    server->stats.send_calls = server->send_calls;
+    server->stats.udp_drops = server->udp_drops;
+    server->stats.queue_drops = server->queue_drops;
+    server->stats.rtcp_sender_reports = server->rtcp_sr_sent;
+    server->stats.rtcp_receiver_reports = server->rtcp_rr_received;
+    pthread_mutex_unlock(&server->lock);
+}
+
+/**
+ * @description: 释放 session GOP 缓存持有的帧引用
+ * @param {RtspServerSession *} session
+ * @return {static void}
+ */
+static void rtsp_session_clear_gop_cache(RtspServerSession *session) {
+    int i;
+
+    for (i = 0; i < session->gop_cache_count; ++i) {
+        rtsp_rtp_frame_release(session->gop_cache[i]);
+        session->gop_cache[i] = NULL;
+    }
+    session->gop_cache_count = 0;
+    session->gop_cache_bytes = 0;
+}
+
+/**
+ * @description: 关闭 session 的组播 socket 并清空组播状态，调用方持有 server->lock 或服务线程已退出
+ * @param {RtspServerSession *} session
+ * @return {static void}
+ */
+static void rtsp_session_clear_multicast(RtspServerSession *session) {
+    if (session->multicast_group[0] && session->multicast_fd >= 0) {
+        close(session->multicast_fd);
+    }
+    session->multicast_fd = -1;
+    session->multicast_group[0] = '\0';
+    session->multicast_port = 0;
+    session->multicast_ttl = 0;
+    session->multicast_clients = 0;
+    session->multicast_waiting_for_keyframe = 0;
+    session->multicast_frames = 0;
+    session->multicast_packets = 0;
+    session->multicast_bytes = 0;
+    session->multicast_drops = 0;
+    memset(&session->multicast_stats, 0, sizeof(session->multicast_stats));
+}
+
+/**
+ * @description: 维护 session 的 GOP 缓存：关键帧开始新的 GOP，其后的帧（含补发的参数集）依次追加；
+ *   超出上限或序号不连续（打包后被丢弃）时清空，避免新客户端收到缺参考帧的 GOP
+ * @param {RtspServerSession *} session
+ * @param {RtspRtpFrame *} frame
+ * @return {static void}
+ */
+static void rtsp_session_cache_frame(RtspServerSession *session, RtspRtpFrame *frame) {
+    int max_frames = atomic_load(&session->gop_cache_max_frames);
+
+    if (frame->is_key_frame && !frame->is_parameter_sets) {
+        rtsp_session_clear_gop_cache(session);
+        session->gop_cache_start_ms = rtsp_now_ms();
+    } else if (session->gop_cache_count == 0) {
+        return;
+    } else if (frame->first_seq != session->gop_cache_next_seq || session->gop_cache_count >= max_frames) {
+        rtsp_session_clear_gop_cache(session);
+        return;
+    }
+    if (max_frames <= 0) {
+        return;
+    }
+    frame->ref_count++;
+    session->gop_cache[session->gop_cache_count++] = frame;
+    session->gop_cache_bytes += frame->bytes + (size_t)frame->packet_count * RTSP_INTERLEAVED_PREFIX;
+    session->gop_cache_next_seq = (uint16_t)(frame->first_seq + frame->packet_count);
+}
+
+/**
+ * @description: 取客户端可用于起播的缓存 IDR
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @return {static const RtspRtpFrame *} 缓存为空、IDR 已过期或 TCP 积压预算放不下时返回 NULL
+ */
+static const RtspRtpFrame *rtsp_session_cached_keyframe(RtspServer *server, RtspClient *client) {
+    RtspServerSession *session = client->session;
+    int max_age_ms = atomic_load(&session->gop_cache_max_age_ms);
+
+    if (session->gop_cache_count == 0) {
+        return NULL;
+    }
+    /* 至少留一半预算给起播后的实时帧，否则宁可等下一个关键帧，也不要一接入就被当成慢客户端。 */
+    if (client->transport == RTSP_TRANSPORT_TCP &&
+        session->gop_cache_bytes > (size_t)server->config.client_budget_bytes / 2) {
+        return NULL;
+    }
+    if (max_age_ms > 0 && rtsp_now_ms() - session->gop_cache_start_ms > max_age_ms) {
+        return NULL;
+    }
+    return session->gop_cache[0];
+}
+
+/**
+ * @description: 把 GOP 缓存连续发给刚开始播放的客户端，之后的实时帧序号与之衔接
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @return {static void}
+ */
+static void rtsp_client_send_gop_cache(RtspServer *server, RtspClient *client) {
+    RtspServerSession *session = client->session;
+    int i;
+
+    for (i = 0; i < session->gop_cache_count; ++i) {
+        if (client->transport == RTSP_TRANSPORT_UDP) {
+            rtsp_client_send_udp(server, client, session->gop_cache[i]);
+            if (client->waiting_for_keyframe) {
+                return;
+            }
+        } else if (rtsp_client_push(server, client, session->gop_cache[i]) != 0) {
+            break;
+        }
+    }
+    if (client->transport == RTSP_TRANSPORT_TCP && !client->closed && !client->want_write) {
+        rtsp_client_flush(server, client);
+    }
+}
+
+/**
+ * @description: 向 session 的组播地址发送一帧，组内刚开始发送或丢帧后先等关键帧
+ * @param {RtspServer *} server
+ * @param {RtspServerSession *} session
+ * @param {const RtspRtpFrame *} frame
+ * @return {static void}
+ */
+static void rtsp_session_send_multicast(RtspServer *server, RtspServerSession *session, const RtspRtpFrame *frame) {
+    uint64_t bytes = 0;
+    int sent;
+
+    if (session->multicast_waiting_for_keyframe && !frame->is_parameter_sets) {
+        if (!frame->is_key_frame) {
+            return;
+        }
+        session->multicast_waiting_for_keyframe = 0;
+    }
+    sent = rtsp_server_send_udp(server, session->multicast_fd, &session->multicast_addr, frame, &bytes);
+    session->multicast_packets += (uint64_t)sent;
+    session->multicast_bytes += bytes;
+    if (!frame->is_parameter_sets) {
+        session->multicast_frames++;
+    }
+    if (sent < frame->packet_count) {
+        session->multicast_waiting_for_keyframe = 1;
+        session->multicast_drops++;
+    }
+}
+
+/**
+ * @description: 组播客户端开始播放：组内第一个观众从 GOP 缓存起播，组内已在发送时新观众等下一个关键帧
+ * @param {RtspServer *} server
+ * @param {RtspServerSession *} session
+ * @param {const RtspRtpFrame *} keyframe 可用的缓存 IDR，可为 NULL
+ * @return {static int} 1 需要新的关键帧，0 已从缓存起播
+ */
+static int rtsp_session_join_multicast(RtspServer *server, RtspServerSession *session, const RtspRtpFrame *keyframe) {
+    int i;
+
+    if (session->multicast_clients++ > 0) {
+        return 1;
+    }
+    session->multicast_waiting_for_keyframe = (keyframe == NULL);
+    for (i = 0; keyframe && i < session->gop_cache_count && !session->multicast_waiting_for_keyframe; ++i) {
+        rtsp_session_send_multicast(server, session, session->gop_cache[i]);
+    }
+    return session->multicast_waiting_for_keyframe;
+}
+
+/**
+ * @description: 分发一帧给所属 session 的所有播放中客户端：UDP 直接批量发送，TCP 追加引用到各自队列
+ * @param {RtspServer *} server
+ * @param {RtspRtpFrame *} frame 服务线程接管的引用
+ * @return {static void}
+ */
+static void rtsp_server_dispatch(RtspServer *server, RtspRtpFrame *frame) {
+    RtspServerSession *session = (RtspServerSession *)frame->owner;
+    int active;
+    int i;
+
+    pthread_mutex_lock(&server->lock);
+    active = (session->state == RTSP_SESSION_ACTIVE);
+    pthread_mutex_unlock(&server->lock);
+    if (!active) {
+        rtsp_rtp_frame_release(frame);
+        return;
+    }
+    /* SR 用最近一帧的 RTP 时间戳和 pts 推算当前时刻的 RTP 时间戳，计数覆盖该 SSRC 发出的全部包。 */
+    session->rtcp_has_frame = 1;
+    session->rtcp_rtp_timestamp = frame->rtp_timestamp;
+    session->rtcp_pts_us = frame->pts_us;
+    session->rtcp_packets += (uint32_t)frame->packet_count;
+    session->rtcp_octets += (uint32_t)(frame->bytes - (size_t)frame->packet_count * 12);
+    rtsp_session_cache_frame(session, frame);
+    if (session->multicast_clients > 0) {
+        rtsp_session_send_multicast(server, session, frame);
+    }
+
+    for (i = 0; i < server->client_count; ++i) {
+        RtspClient *client = server->clients[i];
+
+        if (client->closed || !client->playing || client->session != session ||
+            client->transport == RTSP_TRANSPORT_MULTICAST) {
+            continue;
+        }
+        if (client->waiting_for_keyframe && !frame->is_parameter_sets) {
+            if (!frame->is_key_frame) {
+                continue;
+            }
+            client->waiting_for_keyframe = 0;
+        }
+        if (client->transport == RTSP_TRANSPORT_UDP) {
+            rtsp_client_send_udp(server, client, frame);
+        } else {
+            rtsp_client_push(server, client, frame);
+            if (!client->closed && !client->want_write) {
+                rtsp_client_flush(server, client);
+            }
+        }
+    }
+
+    if (!frame->is_parameter_sets) {
+        server->served_frames++;
+        if ((server->served_frames % RTSP_STATS_INTERVAL_FRAMES) == 0) {
+            rtsp_server_publish_stats(server);
+            rtsp_server_log_stats(server);
+        }
+    }
+    rtsp_rtp_frame_release(frame);
+}
+
+/**
+ * @description: 给 session 的播放中客户端发一份 SR：UDP 客户端发往各自的 RTCP 端口，TCP 客户端排进发送队列
+ *   走 RTCP interleaved 通道，组播按组只发一份到组播端口加一
+ * @param {RtspServer *} server
+ * @param {RtspServerSession *} session
+ * @param {const uint8_t *} sr SR 复合包
+ * @param {size_t} sr_len 报文长度
+ * @return {static void}
+ */
+static void rtsp_session_send_report(RtspServer *server, RtspServerSession *session, const uint8_t *sr, size_t sr_len) {
+    RtspRtpFrame *frame = NULL;
+    int i;
+
+    for (i = 0; i < server->client_count; ++i) {
+        RtspClient *client = server->clients[i];
+
+        if (client->closed || !client->playing || client->session != session ||
+            client->transport == RTSP_TRANSPORT_MULTICAST) {
+            continue;
+        }
+        if (client->transport == RTSP_TRANSPORT_UDP) {
+            if (sendto(server->rtcp_fd, sr, sr_len, MSG_DONTWAIT,
+                       (struct sockaddr *)&client->rtcp_addr, sizeof(client->rtcp_addr)) < 0) {
+                continue;
+            }
+        } else {
+            if (!frame && rtsp_rtp_wrap_rtcp(sr, sr_len, &frame) != 0) {
+                return;
+            }
+            if (rtsp_client_push(server, client, frame) != 0) {
+                continue;
+            }
+            if (!client->want_write) {
+                rtsp_client_flush(server, client);
+            }
+        }
+        client->rtcp.sr_sent++;
+        server->rtcp_sr_sent++;
+    }
+    rtsp_rtp_frame_release(frame);
+    if (session->multicast_clients > 0) {
+        struct sockaddr_in addr = session->multicast_addr;
+
+        addr.sin_port = htons((uint16_t)(ntohs(addr.sin_port) + 1));
+        if (sendto(session->multicast_fd, sr, sr_len, MSG_DONTWAIT, (struct sockaddr *)&addr, sizeof(addr)) >= 0) {
+            server->rtcp_sr_sent++;
+        }
+    }
+}
+
+/**
+ * @description: 到期时为每个有播放客户端的 session 生成 SR：NTP 取当前墙钟，RTP 时间戳由最近一帧按 pts 推到当前时刻
+ * @param {RtspServer *} server
+ * @return {static void}
+ */
+static void rtsp_server_send_reports(RtspServer *server) {
+    long long now = rtsp_now_ms();
+    int i;
+
+    if (server->config.rtcp_interval_ms <= 0) {
+        return;
+    }
+    for (i = 0; i < RTSP_SERVER_MAX_SESSIONS; ++i) {
+        RtspServerSession *session = &server->sessions[i];
+        uint8_t sr[MEDIA_RTCP_SR_MAX];
+        int sr_len;
+
+        if (!session->rtcp_has_frame || atomic_load(&session->clients) == 0 || now < session->rtcp_next_sr_ms) {
+            continue;
+        }
+        session->rtcp_next_sr_ms = now + server->config.rtcp_interval_ms;
+        sr_len = media_rtcp_build_sr(sr,
+                                     sizeof(sr),
+                                     session->rtcp_ssrc,
+                                     media_rtcp_ntp_now(),
+                                     media_rtcp_rtp_timestamp_at(session->rtcp_rtp_timestamp,
+                                                                 session->rtcp_pts_us,
+                                                                 rtsp_now_us(),
+                                                                 MEDIA_RTCP_VIDEO_CLOCK_RATE),
+                                     session->rtcp_packets,
+                                     session->rtcp_octets,
+                                     RTSP_RTCP_CNAME);
+        if (sr_len > 0) {
+            rtsp_session_send_report(server, session, sr, (size_t)sr_len);
+        }
+    }
+}
+
+/**
+ * @description: 解析客户端回来的 RTCP，更新它的接收质量
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @param {const uint8_t *} data RTCP 报文
+ * @param {size_t} len 报文长度
+ * @return {static void}
+ */
+static void rtsp_client_on_rtcp(RtspServer *server, RtspClient *client, const uint8_t *data, size_t len) {
+    long long now = rtsp_now_ms();
+
+    client->last_activity_ms = now;
+    if (!client->session) {
+        return;
+    }
+    if (media_rtcp_peer_on_packet(&client->rtcp, data, len, client->session->rtcp_ssrc,
+                                  MEDIA_RTCP_VIDEO_CLOCK_RATE, now)) {
+        server->rtcp_rr_received++;
+        if (client->rtcp.reports == 1) {
+            printf("[RTSP] event=first_receiver_report session=%s peer=%s fraction_lost=%.1f%% jitter_ms=%.1f rtt_ms=%d\n",
+                   client->session->name,
+                   client->peer_ip,
+                   client->rtcp.loss_percent,
+                   client->rtcp.jitter_ms,
+                   client->rtcp.rtt_ms);
+        }
+    }
+}
+
+/**
+ * @description: 取出 inbox 队头的帧
+ * @param {RtspServer *} server
+ * @return {static RtspRtpFrame *}
+ */
+static RtspRtpFrame *rtsp_server_inbox_pop(RtspServer *server) {
+    RtspRtpFrame *frame = NULL;
+
+    pthread_mutex_lock(&server->lock);
+    if (server->inbox_size > 0) {
+        frame = server->inbox[server->inbox_head];
+        server->inbox[server->inbox_head] = NULL;
+        server->inbox_head = (server->inbox_head + 1) % server->inbox_capacity;
+        server->inbox_size--;
+    }
+    pthread_mutex_unlock(&server->lock);
+    return frame;
+}
+
+/**
+ * @description: 把帧投递给服务线程
+ * @param {RtspServer *} server
+ * @param {RtspRtpFrame *} frame 成功时引用转交给服务线程
+ * @return {static int} 0 成功，-1 inbox 已满
+ */
+static int rtsp_server_post(RtspServer *server, RtspRtpFrame *frame) {
+    uint64_t one = 1;
+    int tail;
+
+    pthread_mutex_lock(&server->lock);
+    if (server->inbox_size >= server->inbox_capacity) {
+        server->stats.inbox_drops++;
+        pthread_mutex_unlock(&server->lock);
+        return -1;
+    }
+    tail = (server->inbox_head + server->inbox_size) % server->inbox_capacity;
+    server->inbox[tail] = frame;
+    server->inbox_size++;
+    if (!frame->is_parameter_sets) {
+        server->stats.frames++;
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    if (write(server->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        fprintf(stderr, "[RTSP][ERROR] eventfd write failed errno=%d\n", errno);
+    }
+    return 0;
+}
+
+/**
+ * @description: 追加一条 RTSP 响应并尝试写出，缓冲放不下时断开连接
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @param {int} code 状态码
+ * @param {const char *} reason 状态描述
+ * @param {const char *} cseq 请求的 CSeq
+ * @param {const char *} headers 额外响应头，每行以 \r\n 结尾，可为 NULL
+ * @param {const char *} body 消息体，可为 NULL
+ * @return {static void}
+ */
+static void rtsp_client_respond(RtspServer *server,
+                                RtspClient *client,
+                                int code,
+                                const char *reason,
+                                const char *cseq,
+                                const char *headers,
+                                const char *body) {
+    size_t room = sizeof(client->reply) - client->reply_len;
+    size_t body_len = body ? strlen(body) : 0;
+    int written;
+
+    if (body) {
+        written = snprintf(client->reply + client->reply_len,
+                           room,
+                           "RTSP/1.0 %d %s\r\nCSeq: %s\r\nServer: %s\r\n%sContent-Length: %zu\r\n\r\n%s",
+                           code,
+                           reason,
+                           cseq,
+                           RTSP_SERVER_NAME,
+                           headers ? headers : "",
+                           body_len,
+                           body);
+    } else {
+        written = snprintf(client->reply + client->reply_len,
+                           room,
+                           "RTSP/1.0 %d %s\r\nCSeq: %s\r\nServer: %s\r\n%s\r\n",
+                           code,
+                           reason,
+                           cseq,
+                           RTSP_SERVER_NAME,
+                           headers ? headers : "");
+    }
+    if (written < 0 || (size_t)written >= room) {
+        rtsp_client_close(server, client, "reply_overflow");
+        return;
+    }
+    client->reply_len += (size_t)written;
+    if (!client->want_write) {
+        rtsp_client_flush(server, client);
+    }
+}
+
+/**
+ * @description: 在请求头中查找指定字段（不区分大小写）
+ * @param {const char *} request 以 '\0' 结尾的请求头
+ * @param {const char *} name 字段名
+ * @param {char *} out 输出值
+ * @param {size_t} out_size
+ * @return {static int} 0 找到，-1 没有或超长
+ */
+static int rtsp_header_value(const char *request, const char *name, char *out, size_t out_size) {
+    size_t name_len = strlen(name);
+    const char *line = strstr(request, "\r\n");
+
+    while (line) {
+        line += 2;
+        if (line[0] == '\r' || line[0] == '\0') {
+            break;
+        }
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char *value = line + name_len + 1;
+            const char *end;
+            size_t len;
+
+            while (*value == ' ' || *value == '\t') {
+                value++;
+            }
+            end = strstr(value, "\r\n");
+            len = end ? (size_t)(end - value) : strlen(value);
+            if (len + 1 > out_size) {
+                return -1;
+            }
+            memcpy(out, value, len);
+            out[len] = '\0';
+            return 0;
+        }
+        line = strstr(line, "\r\n");
+    }
+    return -1;
+}
+
+/**
+ * @description: 按请求 URL 查找 session，路径为 <name> 或 <name>/<track>
+ * @param {RtspServer *} server
+ * @param {const char *} url
+ * @return {static RtspServerSession *}
+ */
+static RtspServerSession *rtsp_server_find_session(RtspServer *server, const char *url) {
+    RtspServerSession *found = NULL;
+    const char *path = url;
+    size_t path_len;
+    int i;
+
+    if (strncasecmp(url, "rtsp://", 7) == 0) {
+        path = strchr(url + 7, '/');
+        path = path ? path + 1 : "";
+    } else if (path[0] == '/') {
+        path++;
+    }
+    path_len = strcspn(path, "?");
+
+    pthread_mutex_lock(&server->lock);
+    for (i = 0; i < RTSP_SERVER_MAX_SESSIONS && !found; ++i) {
+        RtspServerSession *session = &server->sessions[i];
+        size_t name_len = strlen(session->name);
+
+        if (session->state != RTSP_SESSION_ACTIVE || path_len < name_len) {
+            continue;
+        }
+        if (strncmp(path, session->name, name_len) == 0 && (path_len == name_len || path[name_len] == '/')) {
+            found = session;
+        }
+    }
+    pthread_mutex_unlock(&server->lock);
+    return found;
+}
+
+/**
+ * @description: 鉴权检查，未通过时回 401 并下发 nonce；同一连接通过一次后不再重复校验
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @param {const char *} request
+ * @param {const char *} method
+ * @param {const char *} cseq
+ * @return {static int} 1 通过，0 已回 401
+ */
+static int rtsp_client_check_auth(RtspServer *server,
+                                  RtspClient *client,
+                                  const char *request,
+                                  const char *method,
+                                  const char *cseq) {
+    char authorization[1024];
+    char headers[256];
+
+    if (!server->config.auth_enable || client->authorized) {
+        return 1;
+    }
+    if (rtsp_header_value(request, "Authorization", authorization, sizeof(authorization)) == 0) {
+        if (rtsp_digest_verify(authorization,
+                               method,
+                               RTSP_SERVER_REALM,
+                               client->nonce,
+                               server->user,
+                               server->password)) {
+            client->authorized = 1;
+            return 1;
+        }
+        pthread_mutex_lock(&server->lock);
+        server->stats.auth_failures++;
+        pthread_mutex_unlock(&server->lock);
+        fprintf(stderr, "[WARN] RTSP auth failed fd=%d peer=%s method=%s\n", client->fd, client->peer_ip, method);
+    }
+    snprintf(headers, sizeof(headers), "WWW-Authenticate: Digest realm=\"%s\", nonce=\"%s\"\r\n",
+             RTSP_SERVER_REALM,
+             client->nonce);
+    rtsp_client_respond(server, client, 401, "Unauthorized", cseq, headers, NULL);
+    return 0;
+}
+
+/**
+ * @description: 检查请求中的 Session 头是否与当前客户端一致
+ * @param {RtspClient *} client
+ * @param {const char *} request
+ * @return {static int} 1 一致，0 不一致
+ */
+static int rtsp_client_session_matches(const RtspClient *client, const char *request) {
+    char value[128];
+    size_t len;
+
+    if (client->session_id[0] == '\0' || rtsp_header_value(request, "Session", value, sizeof(value)) != 0) {
+        return 0;
+    }
+    len = strcspn(value, "; ");
+    return len == strlen(client->session_id) && strncmp(value, client->session_id, len) == 0;
+}
+
+/**
+ * @description: 处理 DESCRIBE：返回 H.264 的 SDP，参数集已知时带上 sprop-parameter-sets
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @param {const char *} url
+ * @param {const char *} cseq
+ * @return {static void}
+ */
+static void rtsp_handle_describe(RtspServer *server, RtspClient *client, const char *url, const char *cseq) {
+    RtspServerSession *session = rtsp_server_find_session(server, url);
+    char sprop[RTSP_SPROP_MAX];
+    char sdp[RTSP_SDP_MAX];
+    char multicast[64];
+    char headers[512];
+    size_t url_len = strlen(url);
+    int media_port = 0;
+
+    if (!session) {
+        pthread_mutex_lock(&server->lock);
+        server->stats.rejected++;
+        pthread_mutex_unlock(&server->lock);
+        fprintf(stderr, "[WARN] RTSP DESCRIBE unknown session fd=%d url=%s\n", client->fd, url);
+        rtsp_client_respond(server, client, 404, "Not Found", cseq, NULL, NULL);
+        return;
+    }
+    pthread_mutex_lock(&server->lock);
+    memcpy(sprop, session->sprop, sizeof(sprop));
+    multicast[0] = '\0';
+    if (session->multicast_group[0]) {
+        /* 组播 session 在媒体级给出组地址/TTL 和端口，支持组播的客户端据此直接选择组播传输。 */
+        snprintf(multicast, sizeof(multicast), "c=IN IP4 %s/%d\r\n", session->multicast_group, session->multicast_ttl);
+        media_port = session->multicast_port;
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    snprintf(sdp, sizeof(sdp),
+             "v=0\r\n"
+             "o=- %lld 1 IN IP4 %s\r\n"
+             "s=%s\r\n"
+             "c=IN IP4 0.0.0.0\r\n"
+             "t=0 0\r\n"
+             "a=tool:%s\r\n"
+             "a=range:npt=0-\r\n"
+             "a=control:*\r\n"
+             "m=video %d RTP/AVP %d\r\n"
+             "%s"
+             "a=rtpmap:%d H264/90000\r\n"
+             "a=fmtp:%d packetization-mode=1%s%s\r\n"
+             "a=control:trackID=0\r\n",
+             server->start_ms,
+             client->local_ip,
+             session->name,
+             RTSP_SERVER_NAME,
+             media_port,
+             RTSP_RTP_PAYLOAD_TYPE_H264,
+             multicast,
+             RTSP_RTP_PAYLOAD_TYPE_H264,
+             RTSP_RTP_PAYLOAD_TYPE_H264,
+             sprop[0] ? ";" : "",
+             sprop);
+    while (url_len > 0 && url[url_len - 1] == '/') {
+        url_len--;
+    }
+    snprintf(headers, sizeof(headers), "Content-Base: %.*s/\r\nContent-Type: application/sdp\r\n", (int)url_len, url);
+    rtsp_client_respond(server, client, 200, "OK", cseq, headers, sdp);
+}
+
+/**
+ * @description: 解析 Transport 头中的 a-b 端口/通道对
+ * @param {const char *} transport
+ * @param {const char *} key 如 "client_port=" 或 "interleaved="
+ * @param {int *} first
+ * @param {int *} second
+ * @return {static int} 0 成功，-1 没有该字段
+ */
+static int rtsp_transport_pair(const char *transport, const char *key, int *first, int *second) {
+    const char *p = strstr(transport, key);
+    char *end;
+    long a;
+    long b;
+
+    if (!p) {
+        return -1;
+    }
+    p += strlen(key);
+    a = strtol(p, &end, 10);
+    if (end == p || a < 0 || a > 65535) {
+        return -1;
+    }
+    b = a + 1;
+    if (*end == '-') {
+        b = strtol(end + 1, NULL, 10);
+    }
+    *first = (int)a;
+    *second = (int)b;
+    return 0;
+}
+
+/**
+ * @description: 处理 SETUP：支持 RTP/AVP/TCP interleaved、RTP/AVP 单播 UDP 以及已开启组播的 session 的
+ *   RTP/AVP 组播，每个连接只挂一路视频
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @param {const char *} request
+ * @param {const char *} url
+ * @param {const char *} cseq
+ * @return {static void}
+ */
+static void rtsp_handle_setup(RtspServer *server,
+                              RtspClient *client,
+                              const char *request,
+                              const char *url,
+                              const char *cseq) {
+    RtspServerSession *session = rtsp_server_find_session(server, url);
+    char transport[256];
+    char headers[512];
+    char group[INET_ADDRSTRLEN];
+    uint32_t ssrc;
+    int first = 0;
+    int second = 1;
+    int ttl = 0;
+
+    if (!session) {
+        pthread_mutex_lock(&server->lock);
+        server->stats.rejected++;
+        pthread_mutex_unlock(&server->lock);
+        rtsp_client_respond(server, client, 404, "Not Found", cseq, NULL, NULL);
+        return;
+    }
+    if (client->transport != RTSP_TRANSPORT_NONE) {
+        rtsp_client_respond(server, client, 459, "Aggregate Operation Not Allowed", cseq, NULL, NULL);
+        return;
+    }
+    if (server->setup_clients >= server->config.max_clients) {
+        pthread_mutex_lock(&server->lock);
+        server->stats.rejected++;
+        pthread_mutex_unlock(&server->lock);
+        fprintf(stderr, "[WARN] RTSP reject fd=%d: clients=%d reach max_clients=%d\n",
+                client->fd,
+                server->setup_clients,
+                server->config.max_clients);
+        rtsp_client_respond(server, client, 453, "Not Enough Bandwidth", cseq, NULL, NULL);
+        return;
+    }
+    if (rtsp_header_value(request, "Transport", transport, sizeof(transport)) != 0) {
+        rtsp_client_respond(server, client, 461, "Unsupported Transport", cseq, NULL, NULL);
+        return;
+    }
+    pthread_mutex_lock(&server->lock);
+    memcpy(group, session->multicast_group, sizeof(group));
+    first = session->multicast_port;
+    ttl = session->multicast_ttl;
+    pthread_mutex_unlock(&server->lock);
+    if (strstr(transport, "multicast") && group[0] == '\0') {
+        rtsp_client_respond(server, client, 461, "Unsupported Transport", cseq, NULL, NULL);
+        return;
+    }
+
+    ssrc = session->packetizer.ssrc;
+    pthread_mutex_lock(&server->lock);
+    snprintf(client->session_id, sizeof(client->session_id), "%08X%08X",
+             rtsp_random_locked(server),
+             rtsp_random_locked(server));
+    pthread_mutex_unlock(&server->lock);
+
+    if (strstr(transport, "multicast")) {
+        /* 组地址和端口由服务端决定，忽略客户端在 destination/port 中的建议。 */
+        client->transport = RTSP_TRANSPORT_MULTICAST;
+        snprintf(headers, sizeof(headers),
+                 "Transport: RTP/AVP;multicast;destination=%s;port=%d-%d;ttl=%d;ssrc=%08X\r\n"
+                 "Session: %s;timeout=%d\r\n",
+                 group,
+                 first,
+                 first + 1,
+                 ttl,
+                 ssrc,
+                 client->session_id,
+                 RTSP_SESSION_TIMEOUT_S);
+    } else if (strstr(transport, "RTP/AVP/TCP")) {
+        first = 0;
+        rtsp_transport_pair(transport, "interleaved=", &first, &second);
+        client->transport = RTSP_TRANSPORT_TCP;
+        client->rtp_channel = first & 0xFF;
+        client->rtcp_channel = second & 0xFF;
+        snprintf(headers, sizeof(headers),
+                 "Transport: RTP/AVP/TCP;unicast;interleaved=%d-%d;ssrc=%08X\r\n"
+                 "Session: %s;timeout=%d\r\n",
+                 client->rtp_channel,
+                 client->rtcp_channel,
+                 ssrc,
+                 client->session_id,
+                 RTSP_SESSION_TIMEOUT_S);
+    } else {
+        if (rtsp_transport_pair(transport, "client_port=", &first, &second) != 0) {
+            client->session_id[0] = '\0';
+            rtsp_client_respond(server, client, 461, "Unsupported Transport", cseq, NULL, NULL);
+            return;
+        }
+        client->transport = RTSP_TRANSPORT_UDP;
+        memset(&client->rtp_addr, 0, sizeof(client->rtp_addr));
+        client->rtp_addr.sin_family = AF_INET;
+        inet_pton(AF_INET, client->peer_ip, &client->rtp_addr.sin_addr);
+        client->rtcp_addr = client->rtp_addr;
+        client->rtp_addr.sin_port = htons((uint16_t)first);
+        client->rtcp_addr.sin_port = htons((uint16_t)second);
+        snprintf(headers, sizeof(headers),
+                 "Transport: RTP/AVP;unicast;client_port=%d-%d;server_port=%d-%d;ssrc=%08X\r\n"
+                 "Session: %s;timeout=%d\r\n",
+                 first,
+                 second,
+                 server->rtp_port,
+                 server->rtp_port + 1,
+                 ssrc,
+                 client->session_id,
+                 RTSP_SESSION_TIMEOUT_S);
+    }
+    client->session = session;
+    server->setup_clients++;
+    rtsp_client_respond(server, client, 200, "OK", cseq, headers, NULL);
+}
+
+/**
+ * @description: 处理 PLAY：开始播放并通知 session 回调，新客户端从下一个关键帧开始收流
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @param {const char *} request
+ * @param {const char *} cseq
+ * @return {static void}
+ */
+static void rtsp_handle_play(RtspServer *server, RtspClient *client, const char *request, const char *cseq) {
+    RtspServerSession *session = client->session;
+    const RtspRtpFrame *keyframe = NULL;
+    char rtp_info[64];
+    char headers[512];
+    int need_keyframe;
+    int clients;
+
+    if (!session) {
+        rtsp_client_respond(server, client, 455, "Method Not Valid in This State", cseq, NULL, NULL);
+        return;
+    }
+    if (!rtsp_client_session_matches(client, request)) {
+        rtsp_client_respond(server, client, 454, "Session Not Found", cseq, NULL, NULL);
+        return;
+    }
+    /* 从缓存起播时首包就是缓存 IDR 的首包，可以告诉客户端确切的序号和时间戳。 */
+    if (!client->playing && (client->transport != RTSP_TRANSPORT_MULTICAST || session->multicast_clients == 0)) {
+        keyframe = rtsp_session_cached_keyframe(server, client);
+    }
+    rtp_info[0] = '\0';
+    if (keyframe) {
+        snprintf(rtp_info, sizeof(rtp_info), ";seq=%u;rtptime=%u",
+                 (unsigned int)keyframe->first_seq,
+                 (unsigned int)keyframe->rtp_timestamp);
+    }
+    snprintf(headers, sizeof(headers),
+             "Session: %s\r\n"
+             "Range: npt=0.000-\r\n"
+             "RTP-Info: url=rtsp://%s:%d/%s/trackID=0%s\r\n",
+             client->session_id,
+             client->local_ip,
+             server->config.listen_port,
+             session->name,
+             rtp_info);
+    rtsp_client_respond(server, client, 200, "OK", cseq, headers, NULL);
+    if (client->closed || client->playing) {
+        return;
+    }
+
+    client->playing = 1;
+    server->playing_clients++;
+    media_rtcp_peer_reset(&client->rtcp);
+    clients = atomic_fetch_add(&session->clients, 1) + 1;
+    if (client->transport == RTSP_TRANSPORT_MULTICAST) {
+        need_keyframe = rtsp_session_join_multicast(server, session, keyframe);
+    } else {
+        client->waiting_for_keyframe = (keyframe == NULL);
+        if (keyframe) {
+            rtsp_client_send_gop_cache(server, client);
+            if (client->closed) {
+                return;
+            }
+        }
+        need_keyframe = client->waiting_for_keyframe;
+    }
+    printf("[RTSP] event=client_play fd=%d session=%s peer=%s transport=%s clients=%d gop_frames=%d\n",
+           client->fd,
+           session->name,
+           client->peer_ip,
+           client->transport == RTSP_TRANSPORT_TCP ? "tcp" :
+               (client->transport == RTSP_TRANSPORT_MULTICAST ? "multicast" : "udp"),
+           clients,
+           (keyframe && !need_keyframe) ? session->gop_cache_count : 0);
+    if (session->callback) {
+        session->callback(session->opaque, session->name, 1, clients, need_keyframe);
+    }
+}
+
+/**
+ * @description: 处理一条完整的 RTSP 请求
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @param {char *} request 以 '\0' 结尾的请求头
+ * @return {static void}
+ */
+static void rtsp_client_handle_request(RtspServer *server, RtspClient *client, char *request) {
+    char method[32];
+    char url[512];
+    char cseq[32];
+    char headers[256];
+
+    client->has_request = 1;
+    client->last_activity_ms = rtsp_now_ms();
+    if (rtsp_header_value(request, "CSeq", cseq, sizeof(cseq)) != 0) {
+        snprintf(cseq, sizeof(cseq), "0");
+    }
+    if (sscanf(request, "%31s %511s", method, url) != 2) {
+        rtsp_client_respond(server, client, 400, "Bad Request", cseq, NULL, NULL);
+        return;
+    }
+
+    if (strcmp(method, "OPTIONS") == 0) {
+        rtsp_client_respond(server, client, 200, "OK", cseq,
+                            "Public: OPTIONS, DESCRIBE, SETUP, TEARDOWN, PLAY, GET_PARAMETER, SET_PARAMETER\r\n",
+                            NULL);
+        return;
+    }
+    if (!rtsp_client_check_auth(server, client, request, method, cseq)) {
+        return;
+    }
+    if (strcmp(method, "DESCRIBE") == 0) {
+        rtsp_handle_describe(server, client, url, cseq);
+    } else if (strcmp(method, "SETUP") == 0) {
+        rtsp_handle_setup(server, client, request, url, cseq);
+    } else if (strcmp(method, "PLAY") == 0) {
+        rtsp_handle_play(server, client, request, cseq);
+    } else if (strcmp(method, "TEARDOWN") == 0) {
+        snprintf(headers, sizeof(headers), "Session: %s\r\n", client->session_id);
+        /* 停止投递新帧，已排队的媒体数据随响应一起丢弃。 */
+        rtsp_client_clear_queue(client);
+        client->close_after_reply = 1;
+        rtsp_client_respond(server, client, 200, "OK", cseq, client->session_id[0] ? headers : NULL, NULL);
+    } else if (strcmp(method, "GET_PARAMETER") == 0 || strcmp(method, "SET_PARAMETER") == 0) {
+        snprintf(headers, sizeof(headers), "Session: %s\r\n", client->session_id);
+        rtsp_client_respond(server, client, 200, "OK", cseq, client->session_id[0] ? headers : NULL, NULL);
+    } else {
+        rtsp_client_respond(server, client, 501, "Not Implemented", cseq, NULL, NULL);
+    }
+}
+
+/**
+ * @description: 从接收缓冲中依次取出完整的请求或 interleaved 数据块处理
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @return {static void}
+ */
+static void rtsp_client_process(RtspServer *server, RtspClient *client) {
+    char message[RTSP_REQUEST_MAX + 1];
+
+    while (!client->closed && client->request_len > 0 && !client->close_after_reply) {
+        size_t consumed;
+
+        if (client->request[0] == '$') {
+            /* 客户端经 TCP 回传的 RTCP：RTCP 通道上的接收报告计入质量统计，其余只刷新活跃时间。 */
+            if (client->request_len < RTSP_INTERLEAVED_PREFIX) {
+                return;
+            }
+            consumed = RTSP_INTERLEAVED_PREFIX +
+                       (((size_t)(uint8_t)client->request[2] << 8) | (uint8_t)client->request[3]);
+            if (client->request_len < consumed) {
+                return;
+            }
+            if ((uint8_t)client->request[1] == client->rtcp_channel) {
+                rtsp_client_on_rtcp(server, client, (const uint8_t *)client->request + RTSP_INTERLEAVED_PREFIX,
+                                    consumed - RTSP_INTERLEAVED_PREFIX);
+            } else {
+                client->last_activity_ms = rtsp_now_ms();
+            }
+        } else {
+            const char *end = (const char *)memmem(client->request, client->request_len, "\r\n\r\n", 4);
+            char length[32];
+            size_t header_len;
+            size_t body_len = 0;
+
+            if (!end) {
+                return;
+            }
+            header_len = (size_t)(end - client->request) + 4;
+            memcpy(message, client->request, header_len);
+            message[header_len] = '\0';
+            if (rtsp_header_value(message, "Content-Length", length, sizeof(length)) == 0) {
+                body_len = (size_t)strtoul(length, NULL, 10);
+            }
+            consumed = header_len + body_len;
+            if (consumed > sizeof(client->request)) {
+                rtsp_client_close(server, client, "request_too_large");
+                return;
+            }
+            if (client->request_len < consumed) {
+                return;
+            }
+            rtsp_client_handle_request(server, client, message);
+            if (client->closed) {
+                return;
+            }
+        }
+        memmove(client->request, client->request + consumed, client->request_len - consumed);
+        client->request_len -= consumed;
+    }
+}
+
+/**
+ * @description: 处理客户端可读事件
+ * @param {RtspServer *} server
+ * @param {RtspClient *} client
+ * @return {static void}
+ */
+static void rtsp_client_read(RtspServer *server, RtspClient *client) {
+    while (!client->closed) {
+        size_t room = sizeof(client->request) - client->request_len;
+        ssize_t n;
+
+        if (room == 0) {
+            rtsp_client_close(server, client, "request_too_large");
+            return;
+        }
+        n = recv(client->fd, client->request + client->request_len, room, MSG_DONTWAIT);
+        if (n == 0) {
+            rtsp_client_close(server, client, "peer_closed");
+            return;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                rtsp_client_close(server, client, "recv_error");
+            }
+            return;
+        }
+        client->request_len += (size_t)n;
+        rtsp_client_process(server, client);
+    }
+}
+
+/**
+ * @description: 接入新连接，连接数超出上限时直接关闭
+ * @param {RtspServer *} server
+ * @return {static void}
+ */
+static void rtsp_server_accept(RtspServer *server) {
+    while (1) {
+        struct sockaddr_in peer;
+        struct sockaddr_in local;
+        socklen_t peer_len = sizeof(peer);
+        socklen_t local_len = sizeof(local);
+        struct epoll_event ev;
+        RtspClient *client;
+        int one = 1;
+        int fd;
+
+        fd = accept4(server->listen_fd, (struct sockaddr *)&peer, &peer_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (server->client_count >= server->client_capacity) {
+            pthread_mutex_lock(&server->lock);
+            server->stats.rejected++;
+            pthread_mutex_unlock(&server->lock);
+            close(fd);
+            continue;
+        }
+        client = (RtspClient *)calloc(1, sizeof(*client));
+        if (!client) {
+            fprintf(stderr, "[RTSP][ERROR] client alloc failed\n");
+            close(fd);
+            continue;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        client->fd = fd;
+        client->accepted_ms = rtsp_now_ms();
+        client->last_activity_ms = client->accepted_ms;
+        inet_ntop(AF_INET, &peer.sin_addr, client->peer_ip, sizeof(client->peer_ip));
+        if (getsockname(fd, (struct sockaddr *)&local, &local_len) != 0 ||
+            !inet_ntop(AF_INET, &local.sin_addr, client->local_ip, sizeof(client->local_ip))) {
+            snprintf(client->local_ip, sizeof(client->local_ip), "%.15s", server->listen_ip);
+        }
+        pthread_mutex_lock(&server->lock);
+        snprintf(client->nonce, sizeof(client->nonce), "%08x%08x%08x%08x",
+                 rtsp_random_locked(server),
+                 rtsp_random_locked(server),
+                 rtsp_random_locked(server),
+                 rtsp_random_locked(server));
+        pthread_mutex_unlock(&server->lock);
+
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = client;
+        if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            fprintf(stderr, "[RTSP][ERROR] epoll add client failed errno=%d\n", errno);
+            close(fd);
+            free(client);
+            continue;
+        }
+        server->clients[server->client_count++] = client;
+        pthread_mutex_lock(&server->lock);
+        server->stats.accepted++;
+        pthread_mutex_unlock(&server->lock);
+    }
+}
+
+/**
+ * @description: 读空 UDP socket；RTCP 包按源地址匹配客户端，刷新活跃时间并解析接收报告
+ * @param {RtspServer *} server
+ * @param {int} fd
+ * @param {int} is_rtcp
+ * @return {static void}
+ */
+static void rtsp_server_drain_udp(RtspServer *server, int fd, int is_rtcp) {
+    uint8_t buffer[1500];
+
+    while (1) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(fd, buffer, sizeof(buffer), MSG_DONTWAIT, (struct sockaddr *)&from, &from_len);
+        int i;
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (!is_rtcp) {
+            continue;
+        }
+        for (i = 0; i < server->client_count; ++i) {
+            RtspClient *client = server->clients[i];
+
+            if (!client->closed && client->transport == RTSP_TRANSPORT_UDP &&
+                client->rtcp_addr.sin_addr.s_addr == from.sin_addr.s_addr &&
+                client->rtcp_addr.sin_port == from.sin_port) {
+                rtsp_client_on_rtcp(server, client, buffer, (size_t)n);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @description: 关闭请求超时或 session 超时的连接
+ * @param {RtspServer *} server
+ * @return {static void}
+ */
+static void rtsp_server_expire_clients(RtspServer *server) {
+    long long now = rtsp_now_ms();
+    int i;
+
+    for (i = 0; i < server->client_count; ++i) {
+        RtspClient *client = server->clients[i];
+
+        if (client->closed) {
+            continue;
+        }
+        if (!client->has_request && now - client->accepted_ms > RTSP_REQUEST_TIMEOUT_MS) {
+            rtsp_client_close(server, client, "request_timeout");
+        } else if (client->session && now - client->last_activity_ms > RTSP_SESSION_TIMEOUT_S * 1000LL) {
+            rtsp_client_close(server, client, "session_timeout");
+        }
+    }
+}
+
+/**
+ * @description: 清理已卸载的 session：先把 inbox 里的帧处理完，再断开它的客户端并释放槽位
+ * @param {RtspServer *} server
+ * @return {static void}
+ */
+static void rtsp_server_cleanup_sessions(RtspServer *server) {
+    RtspRtpFrame *frame;
+    int closing;
+    int i;
+    int j;
+
+    pthread_mutex_lock(&server->lock);
+    closing = server->sessions_closing;
+    server->sessions_closing = 0;
+    pthread_mutex_unlock(&server->lock);
+    if (!closing) {
+        return;
+    }
+    while ((frame = rtsp_server_inbox_pop(server)) != NULL) {
+        rtsp_server_dispatch(server, frame);
+    }
+    for (i = 0; i < RTSP_SERVER_MAX_SESSIONS; ++i) {
+        RtspServerSession *session = &server->sessions[i];
+        int state;
+
+        pthread_mutex_lock(&server->lock);
+        state = session->state;
+        pthread_mutex_unlock(&server->lock);
+        if (state != RTSP_SESSION_CLOSING) {
+            continue;
+        }
+        session->callback = NULL;
+        for (j = 0; j < server->client_count; ++j) {
+            if (server->clients[j]->session == session) {
+                rtsp_client_close(server, server->clients[j], "session_removed");
+            }
+        }
+        rtsp_session_clear_gop_cache(session);
+        pthread_mutex_lock(&server->lock);
+        rtsp_session_clear_multicast(session);
+        session->state = RTSP_SESSION_FREE;
+        session->name[0] = '\0';
+        session->sprop[0] = '\0';
+        pthread_mutex_unlock(&server->lock);
+        atomic_store(&session->clients, 0);
+    }
+}
+
+/**
+ * @description: 服务线程主函数：单个 epoll 同时处理监听、新帧通知、RTCP 和所有客户端读写
+ * @param {void *} arg
+ * @return {static void *}
+ */
+static void *rtsp_server_thread(void *arg) {
+    RtspServer *server = (RtspServer *)arg;
+    struct epoll_event events[RTSP_EPOLL_EVENTS];
+
+    while (!server->stop_requested) {
+        int n = epoll_wait(server->epoll_fd, events, RTSP_EPOLL_EVENTS, RTSP_EPOLL_TIMEOUT_MS);
+        int i;
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "[RTSP][ERROR] epoll_wait failed errno=%d\n", errno);
+            break;
+        }
+        for (i = 0; i < n; ++i) {
+            void *ptr = events[i].data.ptr;
+
+            if (ptr == &server->listen_fd) {
+                rtsp_server_accept(server);
+            } else if (ptr == &server->event_fd) {
+                uint64_t value;
+                RtspRtpFrame *frame;
+
+                if (read(server->event_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                    fprintf(stderr, "[RTSP][ERROR] eventfd read failed errno=%d\n", errno);
+                }
+                while (!server->stop_requested && (frame = rtsp_server_inbox_pop(server)) != NULL) {
+                    rtsp_server_dispatch(server, frame);
+                }
+            } else if (ptr == &server->rtp_fd) {
+                rtsp_server_drain_udp(server, server->rtp_fd, 0);
+            } else if (ptr == &server->rtcp_fd) {
+                rtsp_server_drain_udp(server, server->rtcp_fd, 1);
+            } else {
+                RtspClient *client = (RtspClient *)ptr;
+
+                if (client->closed) {
+                    continue;
+                }
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    rtsp_client_close(server, client, "socket_error");
+                    continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+                    rtsp_client_read(server, client);
+                }
+                if (!client->closed && (events[i].events & EPOLLOUT)) {
+                    rtsp_client_flush(server, client);
+                }
+            }
+        }
+        rtsp_server_cleanup_sessions(server);
+        rtsp_server_expire_clients(server);
+        rtsp_server_send_reports(server);
+        rtsp_reap_clients(server);
+        rtsp_server_publish_stats(server);
+    }
+    return NULL;
+}
+
+/**
+ * @description: 创建非阻塞 RTSP 监听 socket
+ * @param {RtspServer *} server
+ * @return {static int} 0 成功，-1 失败
+ */
+static int rtsp_server_listen(RtspServer *server) {
+    struct sockaddr_in addr;
+    int one = 1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)server->config.listen_port);
+    if (inet_pton(AF_INET, server->listen_ip, &addr.sin_addr) != 1) {
+        fprintf(stderr, "[RTSP][ERROR] invalid listen_ip=%s\n", server->listen_ip);
+        return -1;
+    }
+    server->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server->listen_fd < 0) {
+        fprintf(stderr, "[RTSP][ERROR] socket failed errno=%d\n", errno);
+        return -1;
+    }
+    setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(server->listen_fd, 64) != 0) {
+        fprintf(stderr, "[RTSP][ERROR] bind/listen %s:%d failed errno=%d\n",
+                server->listen_ip,
+                server->config.listen_port,
+                errno);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @description: 绑定一对相邻端口（RTP 偶数、RTCP 加一）的 UDP socket，所有 UDP 客户端共用
+ * @param {RtspServer *} server
+ * @return {static int} 0 成功，-1 失败
+ */
+static int rtsp_server_bind_udp(RtspServer *server) {
+    int attempt;
+
+    for (attempt = 0; attempt < RTSP_UDP_BIND_ATTEMPTS; ++attempt) {
+        struct sockaddr_in addr;
+        socklen_t addr_len = sizeof(addr);
+        int sndbuf = RTSP_UDP_SNDBUF;
+        int rtp_fd;
+        int rtcp_fd;
+        int port;
+
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        inet_pton(AF_INET, server->listen_ip, &addr.sin_addr);
+        rtp_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (rtp_fd < 0) {
+            break;
+        }
+        if (bind(rtp_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+            getsockname(rtp_fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+            close(rtp_fd);
+            break;
+        }
+        port = ntohs(addr.sin_port);
+        if ((port & 1) != 0 || port >= 65535) {
+            close(rtp_fd);
+            continue;
+        }
+        rtcp_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        addr.sin_port = htons((uint16_t)(port + 1));
+        if (rtcp_fd < 0 || bind(rtcp_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            if (rtcp_fd >= 0) {
+                close(rtcp_fd);
+            }
+            close(rtp_fd);
+            continue;
+        }
+        setsockopt(rtp_fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+        server->rtp_fd = rtp_fd;
+        server->rtcp_fd = rtcp_fd;
+        server->rtp_port = port;
+        return 0;
+    }
+    fprintf(stderr, "[RTSP][ERROR] bind RTP/RTCP port pair failed errno=%d\n", errno);
+    return -1;
+}
+
+/**
+ * @description: 关闭服务端 socket 并释放服务线程持有的全部引用
+ * @param {RtspServer *} server
+ * @return {static void}
+ */
+static void rtsp_server_release(RtspServer *server) {
+    RtspRtpFrame *frame;
+    int i;
+
+    for (i = 0; i < RTSP_SERVER_MAX_SESSIONS; ++i) {
+        server->sessions[i].callback = NULL;
+        rtsp_session_clear_gop_cache(&server->sessions[i]);
+        rtsp_session_clear_multicast(&server->sessions[i]);
+    }
+    for (i = 0; i < server->client_count; ++i) {
+        rtsp_client_close(server, server->clients[i], "shutdown");
+    }
+    rtsp_reap_clients(server);
+    while ((frame = rtsp_server_inbox_pop(server)) != NULL) {
+        rtsp_rtp_frame_release(frame);
+    }
+    if (server->epoll_fd >= 0) {
+        close(server->epoll_fd);
+    }
+    if (server->event_fd >= 0) {
+        close(server->event_fd);
+    }
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+    }
+    if (server->rtp_fd >= 0) {
+        close(server->rtp_fd);
+    }
+    if (server->rtcp_fd >= 0) {
+        close(server->rtcp_fd);
+    }
+    pthread_mutex_destroy(&server->lock);
+    free(server->inbox);
+    free(server->clients);
+    free(server);
+}
+
+/**
+ * @description: 把一个 fd 以 data.ptr 方式注册到 epoll
+ * @param {RtspServer *} server
+ * @param {int *} fd_slot 指向 server 内 fd 字段，事件分发时用它区分来源
+ * @return {static int}
+ */
+static int rtsp_server_watch_fd(RtspServer *server, int *fd_slot) {
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = fd_slot;
+    return epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, *fd_slot, &ev);
+}
+
+/**
+ * @description: 读取随机种子，/dev/urandom 不可用时退回时间和地址
+ * @param {RtspServer *} server
+ * @return {static void}
+ */
+static void rtsp_server_seed(RtspServer *server) {
+    uint64_t seed = 0;
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+
+    if (fd >= 0) {
+        if (read(fd, &seed, sizeof(seed)) != (ssize_t)sizeof(seed)) {
+            seed = 0;
+        }
+        close(fd);
+    }
+    if (seed == 0) {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_REALTIME, &ts);
+        seed = ((uint64_t)ts.tv_sec << 32) ^ (uint64_t)ts.tv_nsec ^ (uint64_t)(uintptr_t)server;
+    }
+    server->random_state = seed ? seed : 0x9E3779B97F4A7C15ULL;
+}
+
+RtspServer *rtsp_server_create(const RtspServerConfig *config) {
+    RtspServer *server;
+
+    if (!config) {
+        fprintf(stderr, "[RTSP][ERROR] create failed: config is NULL\n");
+        return NULL;
+    }
+    server = (RtspServer *)calloc(1, sizeof(*server));
+    if (!server) {
+        fprintf(stderr, "[RTSP][ERROR] create failed: server alloc\n");
+        return NULL;
+    }
+    server->config = *config;
+    snprintf(server->listen_ip, sizeof(server->listen_ip), "%s",
+             (config->listen_ip && config->listen_ip[0]) ? config->listen_ip : DEFAULT_RTSP_SERVER_IP);
+    snprintf(server->user, sizeof(server->user), "%s", config->user ? config->user : "");
+    snprintf(server->password, sizeof(server->password), "%s", config->password ? config->password : "");
+    server->config.listen_ip = server->listen_ip;
+    server->config.user = server->user;
+    server->config.password = server->password;
+    if (server->config.listen_port <= 0) {
+        server->config.listen_port = DEFAULT_RTSP_SERVER_PORT;
+    }
+    if (server->config.max_clients <= 0) {
+        server->config.max_clients = DEFAULT_RTSP_SERVER_MAX_CLIENTS;
+    }
+    if (server->config.client_budget_bytes <= 0) {
+        server->config.client_budget_bytes = DEFAULT_RTSP_SERVER_CLIENT_BUDGET_BYTES;
+    }
+    if (server->config.inbox_capacity <= 0) {
+        server->config.inbox_capacity = DEFAULT_RTSP_SERVER_INBOX_CAPACITY;
+    }
+    if (server->config.rtp_max_payload <= 0) {
+        server->config.rtp_max_payload = RTSP_RTP_DEFAULT_MAX_PAYLOAD;
+    }
+    if (server->config.rtcp_interval_ms == 0) {
+        server->config.rtcp_interval_ms = MEDIA_RTCP_DEFAULT_INTERVAL_MS;
+    }
+    if (server->config.slow_client_evict_drops == 0) {
+        server->config.slow_client_evict_drops = DEFAULT_RTSP_SERVER_EVICT_DROPS;
+    }
+    if (server->config.slow_client_evict_window_ms <= 0) {
+        server->config.slow_client_evict_window_ms = DEFAULT_RTSP_SERVER_EVICT_WINDOW_MS;
+    }
+    server->listen_fd = -1;
+    server->rtp_fd = -1;
+    server->rtcp_fd = -1;
+    server->event_fd = -1;
+    server->epoll_fd = -1;
+    server->start_ms = rtsp_now_ms();
+    pthread_mutex_init(&server->lock, NULL);
+    rtsp_server_seed(server);
+
+    server->inbox_capacity = server->config.inbox_capacity;
+    server->client_capacity = server->config.max_clients + RTSP_SERVER_PENDING_CONNECTIONS;
+    server->inbox = (RtspRtpFrame **)calloc((size_t)server->inbox_capacity, sizeof(RtspRtpFrame *));
+    server->clients = (RtspClient **)calloc((size_t)server->client_capacity, sizeof(RtspClient *));
+    if (!server->inbox || !server->clients) {
+        fprintf(stderr, "[RTSP][ERROR] create failed: queue alloc\n");
+        rtsp_server_release(server);
+        return NULL;
+    }
+    if (rtsp_server_listen(server) != 0 || rtsp_server_bind_udp(server) != 0) {
+        rtsp_server_release(server);
+        return NULL;
+    }
+    server->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (server->event_fd < 0 || server->epoll_fd < 0) {
+        fprintf(stderr, "[RTSP][ERROR] eventfd/epoll create failed errno=%d\n", errno);
+        rtsp_server_release(server);
+        return NULL;
+    }
+    if (rtsp_server_watch_fd(server, &server->listen_fd) != 0 ||
+        rtsp_server_watch_fd(server, &server->event_fd) != 0 ||
+        rtsp_server_watch_fd(server, &server->rtp_fd) != 0 ||
+        rtsp_server_watch_fd(server, &server->rtcp_fd) != 0) {
+        fprintf(stderr, "[RTSP][ERROR] epoll add failed errno=%d\n", errno);
+        rtsp_server_release(server);
+        return NULL;
+    }
+    if (pthread_create(&server->thread, NULL, rtsp_server_thread, server) != 0) {
+        fprintf(stderr, "[RTSP][ERROR] create failed: pthread_create\n");
+        rtsp_server_release(server);
+        return NULL;
+    }
+    server->running = 1;
+    printf("[INFO] RTSP server listening %s:%d rtp_port=%d auth=%d max_clients=%d rtcp_interval_ms=%d\n",
+           server->listen_ip,
+           server->config.listen_port,
+           server->rtp_port,
+           server->config.auth_enable,
+           server->config.max_clients,
+           server->config.rtcp_interval_ms);
+    return server;
+}
+
+void rtsp_server_destroy(RtspServer *server) {
+    uint64_t one = 1;
+
+    if (!server) {
+        return;
+    }
+    if (server->running) {
+        server->stop_requested = 1;
+        if (write(server->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            fprintf(stderr, "[RTSP][ERROR] eventfd wake failed errno=%d\n", errno);
+        }
+        pthread_join(server->thread, NULL);
+        server->running = 0;
+        rtsp_server_publish_stats(server);
+        rtsp_server_log_stats(server);
+    }
+    rtsp_server_release(server);
+}
+
+RtspServerSession *rtsp_server_add_session(RtspServer *server,
+                                           const char *name,
+                                           RtspServerClientCallback callback,
+                                           void *opaque) {
+    RtspServerSession *session = NULL;
+    int i;
+
+    if (!server || !name || name[0] == '\0' || strlen(name) >= RTSP_SESSION_NAME_MAX) {
+        fprintf(stderr, "[RTSP][ERROR] add session failed: invalid name\n");
+        return NULL;
+    }
+    pthread_mutex_lock(&server->lock);
+    for (i = 0; i < RTSP_SERVER_MAX_SESSIONS; ++i) {
+        RtspServerSession *slot = &server->sessions[i];
+
+        if (slot->state == RTSP_SESSION_FREE) {
+            if (!session) {
+                session = slot;
+            }
+        } else if (strcmp(slot->name, name) == 0) {
+            pthread_mutex_unlock(&server->lock);
+            fprintf(stderr, "[RTSP][ERROR] add session failed: duplicate name=%s\n", name);
+            return NULL;
+        }
+    }
+    if (!session) {
+        pthread_mutex_unlock(&server->lock);
+        fprintf(stderr, "[RTSP][ERROR] add session failed: no free slot name=%s\n", name);
+        return NULL;
+    }
+    session->server = server;
+    snprintf(session->name, sizeof(session->name), "%s", name);
+    session->callback = callback;
+    session->opaque = opaque;
+    session->sprop[0] = '\0';
+    session->sprop_version = 0;
+    session->need_keyframe = 0;
+    atomic_store(&session->clients, 0);
+    atomic_store(&session->gop_cache_max_frames, 0);
+    atomic_store(&session->gop_cache_max_age_ms, 0);
+    rtsp_session_clear_multicast(session);
+    rtsp_rtp_packetizer_init(&session->packetizer,
+                             rtsp_random_locked(server),
+                             (uint16_t)rtsp_random_locked(server),
+                             rtsp_random_locked(server),
+                             (size_t)server->config.rtp_max_payload);
+    session->rtcp_ssrc = session->packetizer.ssrc;
+    session->rtcp_has_frame = 0;
+    session->rtcp_packets = 0;
+    session->rtcp_octets = 0;
+    session->rtcp_next_sr_ms = 0;
+    memset(&session->receiver_stats, 0, sizeof(session->receiver_stats));
+    session->receiver_stats.max_rtt_ms = -1;
+    session->state = RTSP_SESSION_ACTIVE;
+    pthread_mutex_unlock(&server->lock);
+    return session;
+}
+
+void rtsp_server_remove_session(RtspServer *server, RtspServerSession *session) {
+    uint64_t one = 1;
+
+    if (!server || !session) {
+        return;
+    }
+    pthread_mutex_lock(&server->lock);
+    if (session->state == RTSP_SESSION_ACTIVE) {
+        session->state = RTSP_SESSION_CLOSING;
+        server->sessions_closing = 1;
+    }
+    pthread_mutex_unlock(&server->lock);
+    if (write(server->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        fprintf(stderr, "[RTSP][ERROR] eventfd wake failed errno=%d\n", errno);
+    }
+}
+
+/**
+ * @description: 参数集变化后重建 SDP 用的 sprop 字符串
+ * @param {RtspServerSession *} session
+ * @return {static void}
+ */
+static void rtsp_session_update_sprop(RtspServerSession *session) {
+    char sprop[RTSP_SPROP_MAX];
+
+    if (session->packetizer.parameter_version == session->sprop_version) {
+        return;
+    }
+    if (rtsp_rtp_format_sprop(&session->packetizer, sprop, sizeof(sprop)) != 0) {
+        return;
+    }
+    session->sprop_version = session->packetizer.parameter_version;
+    pthread_mutex_lock(&session->server->lock);
+    memcpy(session->sprop, sprop, sizeof(sprop));
+    pthread_mutex_unlock(&session->server->lock);
+}
+
+int rtsp_server_session_set_gop_cache(RtspServerSession *session, int max_frames, int max_age_ms) {
+    if (!session || max_frames < 0) {
+        return -1;
+    }
+    if (max_frames > RTSP_SERVER_GOP_CACHE_MAX_FRAMES) {
+        max_frames = RTSP_SERVER_GOP_CACHE_MAX_FRAMES;
+    }
+    atomic_store(&session->gop_cache_max_age_ms, max_age_ms > 0 ? max_age_ms : 0);
+    atomic_store(&session->gop_cache_max_frames, max_frames);
+    return 0;
+}
+
+int rtsp_server_session_set_multicast(RtspServerSession *session, const RtspServerMulticastConfig *config) {
+    RtspServer *server;
+    struct sockaddr_in addr;
+    struct in_addr interface_addr;
+    int sndbuf = RTSP_UDP_SNDBUF;
+    unsigned char ttl;
+    unsigned char loop = 1;
+    int configured;
+    int fd;
+
+    if (!session || !config || !config->group || inet_pton(AF_INET, config->group, &addr.sin_addr) != 1 ||
+        !IN_MULTICAST(ntohl(addr.sin_addr.s_addr)) || config->port <= 0 || config->port >= 65535 ||
+        (config->port & 1) != 0) {
+        fprintf(stderr, "[RTSP][ERROR] set multicast failed: invalid group=%s port=%d (need 224.0.0.0/4 and even port)\n",
+                (config && config->group) ? config->group : "null",
+                config ? config->port : 0);
+        return -1;
+    }
+    interface_addr.s_addr = htonl(INADDR_ANY);
+    if (config->interface_ip && config->interface_ip[0] &&
+        inet_pton(AF_INET, config->interface_ip, &interface_addr) != 1) {
+        fprintf(stderr, "[RTSP][ERROR] set multicast failed: invalid interface=%s\n", config->interface_ip);
+        return -1;
+    }
+    server = session->server;
+    pthread_mutex_lock(&server->lock);
+    configured = session->multicast_group[0] != '\0';
+    pthread_mutex_unlock(&server->lock);
+    if (configured) {
+        fprintf(stderr, "[RTSP][ERROR] set multicast failed: session=%s already configured\n", session->name);
+        return -1;
+    }
+
+    ttl = (unsigned char)((config->ttl > 0 && config->ttl <= 255) ? config->ttl : 1);
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "[RTSP][ERROR] multicast socket failed errno=%d\n", errno);
+        return -1;
+    }
+    /* 本机回环保持开启，同机播放器和 loopback 测试都能收到。 */
+    if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) != 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) != 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &interface_addr, sizeof(interface_addr)) != 0) {
+        fprintf(stderr, "[RTSP][ERROR] multicast setsockopt failed session=%s errno=%d\n", session->name, errno);
+        close(fd);
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)config->port);
+    memset(addr.sin_zero, 0, sizeof(addr.sin_zero));
+
+    pthread_mutex_lock(&server->lock);
+    session->multicast_fd = fd;
+    session->multicast_addr = addr;
+    session->multicast_port = config->port;
+    session->multicast_ttl = ttl;
+    snprintf(session->multicast_group, sizeof(session->multicast_group), "%s", config->group);
+    pthread_mutex_unlock(&server->lock);
+    printf("[INFO] RTSP multicast session=%s group=%s:%d ttl=%d interface=%s\n",
+           session->name,
+           session->multicast_group,
+           config->port,
+           (int)ttl,
+           (config->interface_ip && config->interface_ip[0]) ? config->interface_ip : "default");
+    return 0;
+}
+
+int rtsp_server_session_get_multicast_stats(RtspServerSession *session, RtspServerMulticastStats *stats) {
+    int configured;
+
+    if (!session || !stats) {
+        return -1;
+    }
+    pthread_mutex_lock(&session->server->lock);
+    configured = session->multicast_group[0] != '\0';
+    *stats = session->multicast_stats;
+    pthread_mutex_unlock(&session->server->lock);
+    return configured ? 0 : -1;
+}
+
+int rtsp_server_session_get_receiver_stats(RtspServerSession *session, RtspServerReceiverStats *stats) {
+    if (!session || !stats) {
+        return -1;
+    }
+    pthread_mutex_lock(&session->server->lock);
+    *stats = session->receiver_stats;
+    pthread_mutex_unlock(&session->server->lock);
+    return 0;
+}
+
+int rtsp_server_session_get_client_stats(RtspServerSession *session, RtspServerClientStats *stats, int max_stats) {
+    int count;
+
+    if (!session || !stats || max_stats < 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&session->server->lock);
+    count = session->client_stats_count < max_stats ? session->client_stats_count : max_stats;
+    memcpy(stats, session->client_stats, sizeof(stats[0]) * (size_t)count);
+    pthread_mutex_unlock(&session->server->lock);
+    return count;
+}
+
+int rtsp_server_session_send_packet(RtspServerSession *session, const MediaPacket *packet) {
+    RtspRtpFrame *frame = NULL;
+
+    if (!session || !packet || !packet->buffer) {
+        return -1;
+    }
+    if (packet->frame_type != MEDIA_FRAME_TYPE_VIDEO || packet->codec != MEDIA_CODEC_H264) {
+        return 0;
+    }
+    if (session->need_keyframe && !packet->is_key_frame) {
+        return 0;
+    }
+    if (rtsp_rtp_packetize(&session->packetizer, packet, &frame) != 0) {
+        fprintf(stderr, "[RTSP][ERROR] packetize failed session=%s frame=%llu\n",
+                session->name,
+                (unsigned long long)packet->frame_id);
+        return -1;
+    }
+    rtsp_session_update_sprop(session);
+    if (!frame) {
+        return 0;
+    }
+    /* 没人看且不需要维护 GOP 缓存时只维护参数集缓存，不唤醒服务线程。 */
+    if (atomic_load(&session->clients) == 0 && atomic_load(&session->gop_cache_max_frames) == 0) {
+        rtsp_rtp_frame_release(frame);
+        session->need_keyframe = 0;
+        return 0;
+    }
+    frame->owner = session;
+    if (rtsp_server_post(session->server, frame) != 0) {
+        /* 服务线程跟不上时丢到下一个关键帧，避免客户端收到缺参考帧的数据。 */
+        rtsp_rtp_frame_release(frame);
+        session->need_keyframe = 1;
+        return 0;
+    }
+    if (packet->is_key_frame) {
+        session->need_keyframe = 0;
+    }
+    return 0;
+}
+
+int rtsp_server_session_send_parameter_sets(RtspServerSession *session,
+                                            uint64_t pts_us,
+                                            size_t *sps_len,
+                                            size_t *pps_len) {
+    RtspRtpFrame *frame = NULL;
+
+    if (!session) {
+        return -1;
+    }
+    if (rtsp_rtp_packetize_parameter_sets(&session->packetizer, pts_us, &frame) != 0 || !frame) {
+        return -1;
+    }
+    frame->owner = session;
+    if (rtsp_server_post(session->server, frame) != 0) {
+        rtsp_rtp_frame_release(frame);
+        return -1;
+    }
+    if (sps_len) {
+        *sps_len = session->packetizer.sps_len;
+    }
+    if (pps_len) {
+        *pps_len = session->packetizer.pps_len;
+    }
+    return 0;
+}
+
+int rtsp_server_session_client_count(RtspServerSession *session) {
+    return session ? atomic_load(&session->clients) : 0;
+}
+
+int rtsp_server_get_stats(RtspServer *server, RtspServerStats *stats) {
+    if (!server || !stats) {
+        return -1;
+    }
+    pthread_mutex_lock(&server->lock);
+    *stats = server->stats;
+    pthread_mutex_unlock(&server->lock);
+    return 0;
+}
+
+int rtsp_server_get_rtp_port(RtspServer *server) {
+    return server ? server->rtp_port : -1;
+}
@@ -8,7 +8,7 @@
 #include <inttypes.h>
 #include <time.h>
 
-#include "rtsp_server_api.h"
+#include "rtspServer.h"
 
 #define DEFAULT_RTSP_SINK_NAME "rtsp"
 #define DEFAULT_RTSP_SESSION "live"
@@ -16,33 +16,30 @@
 #define DEFAULT_RTSP_PORT 8554
 #define DEFAULT_RTSP_USER "admin"
 #define DEFAULT_RTSP_PASSWORD "123456"
+#define DEFAULT_RTSP_GOP_CACHE_MAX_AGE_MS 2000
 
 typedef struct {
-    int in_use;                    /* 共享 RTSP 服务是否已被启用。 */
-    int module_ready;              /* rtspModuleInit 是否成功。 */
-    int server_started;            /* 服务线程是否创建成功。 */
+    RtspServer *server;            /* 进程内共享的 RTSP 服务。 */
     int auth_enable;               /* 鉴权开关。 */
     int server_port;               /* 共享服务监听端口。 */
     char server_ip[64];            /* 共享服务监听地址。 */
     char user[64];                 /* 鉴权用户名。 */
     char password[64];             /* 鉴权密码。 */
-    pthread_t server_thread;       /* 共享服务线程句柄。 */
+    int rtcp_interval_ms;          /* 创建服务的 sink 给出的 RTCP SR 周期，后续 sink 只做一致性告警。 */
+    int client_budget_bytes;       /* 创建服务的 sink 给出的客户端发送队列上限。 */
+    int slow_client_evict_drops;   /* 创建服务的 sink 给出的慢客户端断开阈值。 */
+    int slow_client_evict_window_ms; /* 创建服务的 sink 给出的慢客户端统计窗口。 */
 } RtspSharedServer;
 
 typedef struct {
     RtspSinkConfig config;         /* 当前 sink 的配置副本。 */
-    void *session;                 /* 当前 sink 绑定的 RTSP session。 */
+    RtspServerSession *session;    /* 当前 sink 绑定的 RTSP session。 */
     int shared_server_acquired;    /* 是否已持有共享服务引用计数。 */
-    int last_client_count;         /* 上一次观察到的 RTSP 总客户端数。 */
     atomic_int pending_external_idr;                        /* 新客户端接入后的一次性 IDR 请求标记。 */
     atomic_int awaiting_first_keyframe_after_external_idr;  /* 已请求外部IDR，等待首个关键帧发出。 */
     atomic_ullong new_client_detect_ts_us;                 /* 检测到新客户端接入时刻。 */
     atomic_ullong external_idr_request_ts_us;              /* 外部IDR请求被消费并准备向编码器请求时刻。 */
-    int pending_send_cached_sps_pps;                        /* 新客户端接入后，是否待发送缓存的 SPS/PPS。 */
-    uint8_t *cached_sps;                                    /* 最近缓存的 SPS NALU（不含起始码）。 */
-    size_t cached_sps_len;
-    uint8_t *cached_pps;                                    /* 最近缓存的 PPS NALU（不含起始码）。 */
-    size_t cached_pps_len;
+    atomic_int pending_send_cached_sps_pps;                 /* 新客户端接入后，是否待发送缓存的 SPS/PPS。 */
 } RtspSinkImpl;
 
 static RtspSharedServer g_rtsp_shared_server;
@@ -60,39 +57,35 @@ static uint64_t now_us(void) {
 #endif
 }
 
-/* 查询当前 sink 对应 session 的客户端数，不可用时返回 -1。 */
-static int query_rtsp_session_client_count(void *session) {
-    return rtspSessionGetClientNum(session);
-}
-
 /*
- * 轮询“当前 session 的客户端总数是否上升”。
- * 只要该 session 新增观看端，就置位外部 IDR 请求。
- * 这样可避免 live_main 与 live_sub 之间互相误触发关键帧。
+ * 服务线程在客户端 PLAY/断开时回调。
+ * 每个 session 各自注册回调，live_main 与 live_sub 之间不会互相误触发关键帧；
+ * 已从 GOP 缓存起播的客户端不再请求 IDR。
  */
-static void rtsp_sink_probe_new_client(RtspSinkImpl *impl) {
-    int cur_count;
+static void rtsp_sink_on_client(void *opaque, const char *session_name, int connected, int clients, int need_keyframe) {
+    RtspSinkImpl *impl = (RtspSinkImpl *)opaque;
     uint64_t detect_ts_us;
-    if (!impl || !impl->session) {
+
+    if (!impl || !connected) {
         return;
     }
-    cur_count = query_rtsp_session_client_count(impl->session);
-    if (cur_count < 0) {
+    detect_ts_us = now_us();
+    if (!need_keyframe) {
+        printf("[E2E] event=new_client_served_from_gop_cache session=%s clients=%d ts_us=%" PRIu64 "\n",
+               session_name ? session_name : "unknown",
+               clients,
+               detect_ts_us);
         return;
     }
-    if (cur_count > impl->last_client_count && cur_count > 0) {
-        detect_ts_us = now_us();
-        atomic_store(&impl->new_client_detect_ts_us, detect_ts_us);
-        atomic_store(&impl->pending_external_idr, 1);
-        if (impl->config.immediate_sps_pps_on_new_client) {
-            impl->pending_send_cached_sps_pps = 1;
-        }
-        printf("[E2E] event=new_client_detected session=%s clients=%d ts_us=%" PRIu64 "\n",
-               impl->config.session_name ? impl->config.session_name : "unknown",
-               cur_count,
-               detect_ts_us);
+    atomic_store(&impl->new_client_detect_ts_us, detect_ts_us);
+    atomic_store(&impl->pending_external_idr, 1);
+    if (impl->config.immediate_sps_pps_on_new_client) {
+        atomic_store(&impl->pending_send_cached_sps_pps, 1);
     }
-    impl->last_client_count = cur_count;
+    printf("[E2E] event=new_client_detected session=%s clients=%d ts_us=%" PRIu64 "\n",
+           session_name ? session_name : "unknown",
+           clients,
+           detect_ts_us);
 }
 
 /* 安全复制字符串到固定长度缓冲区，保证以 '\0' 结束。 */
@@ -119,155 +112,6 @@ static int string_equals(const char *a, const char *b) {
     return strcmp(a, b) == 0;
 }
 
-/* 判断当前位置是否为 H264 起始码，并返回起始码长度。 */
-static int start_code_len(const uint8_t *data, size_t len) {
-    if (len >= 4 && data[0] == 0 && data[1] == 0 && data[2] == 0 && data[3] == 1) {
-        return 4;
-    }
-    if (len >= 3 && data[0] == 0 && data[1] == 0 && data[2] == 1) {
-        return 3;
-    }
-    return 0;
-}
-
-/* 在缓冲区中从 offset 开始查找下一个 H264 起始码位置。 */
-static int find_start_code(const uint8_t *data, size_t len, size_t offset, size_t *pos, int *code_len) {
-    size_t i;
-    for (i = offset; i + 3 <= len; ++i) {
-        int cur_len = start_code_len(data + i, len - i);
-        if (cur_len > 0) {
-            *pos = i;
-            *code_len = cur_len;
-            return 0;
-        }
-    }
-    return -1;
-}
-
-/* 缓存最新 SPS/PPS，供“新客户端立刻补参数集”模式使用。 */
-static void cache_h264_parameter_set(RtspSinkImpl *impl, int nalu_type, const uint8_t *nalu, size_t nalu_len) {
-    uint8_t *new_buf;
-    if (!impl || !nalu || nalu_len == 0) {
-        return;
-    }
-    if (nalu_type != 7 && nalu_type != 8) {
-        return;
-    }
-    new_buf = (uint8_t *)malloc(nalu_len);
-    if (!new_buf) {
-        return;
-    }
-    memcpy(new_buf, nalu, nalu_len);
-    if (nalu_type == 7) {
-        free(impl->cached_sps);
-        impl->cached_sps = new_buf;
-        impl->cached_sps_len = nalu_len;
-    } else {
-        free(impl->cached_pps);
-        impl->cached_pps = new_buf;
-        impl->cached_pps_len = nalu_len;
-    }
-}
-
-/* 解析 Annex-B 并更新 SPS/PPS 缓存。 */
-static void update_sps_pps_cache(RtspSinkImpl *impl, const uint8_t *data, size_t len) {
-    size_t nalu_start = 0;
-    int code_len = 0;
-    if (!impl || !data || len == 0) {
-        return;
-    }
-    if (find_start_code(data, len, 0, &nalu_start, &code_len) != 0) {
-        return;
-    }
-    while (nalu_start < len) {
-        size_t payload_start = nalu_start + (size_t)code_len;
-        size_t next_start = len;
-        int next_code_len = 0;
-        int nalu_type;
-        if (payload_start >= len) {
-            break;
-        }
-        find_start_code(data, len, payload_start, &next_start, &next_code_len);
-        if (next_start <= payload_start) {
-            break;
-        }
-        nalu_type = data[payload_start] & 0x1F;
-        cache_h264_parameter_set(impl, nalu_type, data + payload_start, next_start - payload_start);
-        if (next_start >= len) {
-            break;
-        }
-        nalu_start = next_start;
-        code_len = next_code_len;
-    }
-}
-
-/* 在普通码流发送前补发缓存的 SPS/PPS，帮助新客户端尽快完成解码初始化。 */
-static void send_cached_sps_pps_if_needed(RtspSinkImpl *impl) {
-    if (!impl || !impl->session) {
-        return;
-    }
-    if (!impl->config.immediate_sps_pps_on_new_client || !impl->pending_send_cached_sps_pps) {
-        return;
-    }
-    if (!impl->cached_sps || !impl->cached_pps || impl->cached_sps_len == 0 || impl->cached_pps_len == 0) {
-        return;
-    }
-    if (sessionSendVideoData(impl->session, (unsigned char *)impl->cached_sps, (int)impl->cached_sps_len) < 0) {
-        return;
-    }
-    if (sessionSendVideoData(impl->session, (unsigned char *)impl->cached_pps, (int)impl->cached_pps_len) < 0) {
-        return;
-    }
-    impl->pending_send_cached_sps_pps = 0;
-    printf("[E2E] event=cached_sps_pps_sent session=%s sps=%zu pps=%zu\n",
-           impl->config.session_name ? impl->config.session_name : "unknown",
-           impl->cached_sps_len,
-           impl->cached_pps_len);
-}
-
-/* 将 Annex-B 数据按 NALU 切分后发送到 RTSP session。 */
-static int rtsp_send_annexb(void *session, const uint8_t *data, size_t len) {
-    size_t nalu_start = 0;
-    int code_len = 0;
-
-    if (find_start_code(data, len, 0, &nalu_start, &code_len) != 0) {
-        return sessionSendVideoData(session, (unsigned char *)data, (int)len);
-    }
-
-    while (nalu_start < len) {
-        size_t payload_start = nalu_start + (size_t)code_len;
-        size_t next_start = len;
-        int next_code_len = 0;
-
-        if (payload_start >= len) {
-            break;
-        }
-        find_start_code(data, len, payload_start, &next_start, &next_code_len);
-        if (next_start > payload_start) {
-            if (sessionSendVideoData(session, (unsigned char *)(data + payload_start), (int)(next_start - payload_start)) < 0) {
-                return -1;
-            }
-        }
-        if (next_start >= len) {
-            break;
-        }
-        nalu_start = next_start;
-        code_len = next_code_len;
-    }
-    return 0;
-}
-
-/* 共享 RTSP 服务线程入口：阻塞运行 rtspStartServer。 */
-static void *shared_rtsp_server_thread(void *arg) {
-    RtspSharedServer *shared = (RtspSharedServer *)arg;
-    rtspStartServer(shared->auth_enable,
-                    shared->server_ip,
-                    shared->server_port,
-                    shared->user,
-                    shared->password);
-    return NULL;
-}
-
 /* 校验新 sink 的 server 参数是否与共享 server 一致。 */
 static int shared_rtsp_config_compatible(const RtspSinkConfig *cfg) {
     if (!cfg) {
@@ -291,9 +135,34 @@ static int shared_rtsp_config_compatible(const RtspSinkConfig *cfg) {
     return 1;
 }
 
+/*
+ * 发送节奏与慢客户端参数是共享服务级的，只有创建服务的 sink 的值生效。
+ * 后续 sink 给出不同的值时不拒绝挂载（主/子码流常只在一侧配置），但要明确告警，避免配置被静默忽略。
+ */
+static void warn_shared_rtsp_tuning_mismatch(const RtspSinkConfig *cfg) {
+    if (g_rtsp_shared_server.rtcp_interval_ms == cfg->rtcp_interval_ms &&
+        g_rtsp_shared_server.client_budget_bytes == cfg->client_budget_bytes &&
+        g_rtsp_shared_server.slow_client_evict_drops == cfg->slow_client_evict_drops &&
+        g_rtsp_shared_server.slow_client_evict_window_ms == cfg->slow_client_evict_window_ms) {
+        return;
+    }
+    fprintf(stderr,
+            "[WARN] RTSP shared server tuning ignored for session=%s: keep rtcp_interval_ms=%d client_budget_bytes=%d "
+            "evict_drops=%d evict_window_ms=%d, requested %d/%d/%d/%d\n",
+            cfg->session_name ? cfg->session_name : "unknown",
+            g_rtsp_shared_server.rtcp_interval_ms,
+            g_rtsp_shared_server.client_budget_bytes,
+            g_rtsp_shared_server.slow_client_evict_drops,
+            g_rtsp_shared_server.slow_client_evict_window_ms,
+            cfg->rtcp_interval_ms,
+            cfg->client_budget_bytes,
+            cfg->slow_client_evict_drops,
+            cfg->slow_client_evict_window_ms);
+}
+
 /**
  * @description: 管理“共享 RTSP 服务器进程内实例”
- * 第一次调用：启动 RTSP 模块 + 起 server 线程（监听 ip:port）
+ * 第一次调用：创建 RTSP 服务（监听 ip:port，服务线程随之启动）
  * 后续调用：不重复启动，只增加引用计数
  * 并检查新 sink 的 server 参数是否和已启动的一致（端口/鉴权等）
  * 确保 main/sub 共用同一个 8554 服务端
@@ -302,7 +171,8 @@ static int shared_rtsp_config_compatible(const RtspSinkConfig *cfg) {
  */
 
 static int shared_rtsp_server_acquire(const RtspSinkConfig *cfg) {
-    int ret = 0;
+    RtspServerConfig server_config;
+
     pthread_mutex_lock(&g_rtsp_shared_lock);
 
     if (g_rtsp_shared_ref_count == 0) {
@@ -312,22 +182,27 @@ static int shared_rtsp_server_acquire(const RtspSinkConfig *cfg) {
         copy_string_field(g_rtsp_shared_server.server_ip, sizeof(g_rtsp_shared_server.server_ip), cfg->server_ip);
         copy_string_field(g_rtsp_shared_server.user, sizeof(g_rtsp_shared_server.user), cfg->user);
         copy_string_field(g_rtsp_shared_server.password, sizeof(g_rtsp_shared_server.password), cfg->password);
-        /* 初始化rtspServer */
-        if (rtspModuleInit() < 0) {
-            pthread_mutex_unlock(&g_rtsp_shared_lock);
-            return -1;
-        }
-        g_rtsp_shared_server.module_ready = 1;
-        g_rtsp_shared_server.in_use = 1;
-        /* 启动rtsp服务线程 */
-        ret = pthread_create(&g_rtsp_shared_server.server_thread, NULL, shared_rtsp_server_thread, &g_rtsp_shared_server);
-        if (ret != 0) {
-            rtspModuleDel();
+        g_rtsp_shared_server.rtcp_interval_ms = cfg->rtcp_interval_ms;
+        g_rtsp_shared_server.client_budget_bytes = cfg->client_budget_bytes;
+        g_rtsp_shared_server.slow_client_evict_drops = cfg->slow_client_evict_drops;
+        g_rtsp_shared_server.slow_client_evict_window_ms = cfg->slow_client_evict_window_ms;
+        memset(&server_config, 0, sizeof(server_config));
+        server_config.listen_ip = g_rtsp_shared_server.server_ip;
+        server_config.listen_port = cfg->server_port;
+        server_config.auth_enable = cfg->auth_enable;
+        server_config.user = g_rtsp_shared_server.user;
+        server_config.password = g_rtsp_shared_server.password;
+        server_config.rtcp_interval_ms = cfg->rtcp_interval_ms;
+        server_config.client_budget_bytes = cfg->client_budget_bytes;
+        server_config.slow_client_evict_drops = cfg->slow_client_evict_drops;
+        server_config.slow_client_evict_window_ms = cfg->slow_client_evict_window_ms;
+        /* 创建rtspServer，服务线程在内部启动 */
+        g_rtsp_shared_server.server = rtsp_server_create(&server_config);
+        if (!g_rtsp_shared_server.server) {
             memset(&g_rtsp_shared_server, 0, sizeof(g_rtsp_shared_server));
             pthread_mutex_unlock(&g_rtsp_shared_lock);
             return -1;
         }
-        g_rtsp_shared_server.server_started = 1;
     } else if (!shared_rtsp_config_compatible(cfg)) {
         fprintf(stderr, "[ERROR] RTSP shared server config conflict: expect %s:%d auth=%d user=%s\n",
                 g_rtsp_shared_server.server_ip,
@@ -336,6 +211,8 @@ static int shared_rtsp_server_acquire(const RtspSinkConfig *cfg) {
                 g_rtsp_shared_server.user);
         pthread_mutex_unlock(&g_rtsp_shared_lock);
         return -1;
+    } else {
+        warn_shared_rtsp_tuning_mismatch(cfg);
     }
 
     g_rtsp_shared_ref_count++;
@@ -354,13 +231,7 @@ static void shared_rtsp_server_release(void) {
 
     g_rtsp_shared_ref_count--;
     if (g_rtsp_shared_ref_count == 0) {
-        rtspStopServer();
-        if (g_rtsp_shared_server.server_started) {
-            pthread_join(g_rtsp_shared_server.server_thread, NULL);
-        }
-        if (g_rtsp_shared_server.module_ready) {
-            rtspModuleDel();
-        }
+        rtsp_server_destroy(g_rtsp_shared_server.server);
         memset(&g_rtsp_shared_server, 0, sizeof(g_rtsp_shared_server));
     }
 
@@ -384,39 +255,50 @@ static int rtsp_sink_start(MediaSink *sink) {
     }
     impl->shared_server_acquired = 1;
 
-    /* 创建 RTSP 会话 */
-    impl->session = rtspAddSession(impl->config.session_name);
+    /* 创建 RTSP 会话，客户端接入由服务线程回调通知 */
+    atomic_store(&impl->pending_external_idr, 0);
+    atomic_store(&impl->awaiting_first_keyframe_after_external_idr, 0);
+    atomic_store(&impl->new_client_detect_ts_us, 0);
+    atomic_store(&impl->external_idr_request_ts_us, 0);
+    atomic_store(&impl->pending_send_cached_sps_pps, 0);
+    pthread_mutex_lock(&g_rtsp_shared_lock);
+    impl->session = rtsp_server_add_session(g_rtsp_shared_server.server,
+                                            impl->config.session_name,
+                                            rtsp_sink_on_client,
+                                            impl);
+    pthread_mutex_unlock(&g_rtsp_shared_lock);
     if (!impl->session) {
-        fprintf(stderr, "[ERROR] rtsp_sink_start failed: rtspAddSession session=%s\n",
+        fprintf(stderr, "[ERROR] rtsp_sink_start failed: rtsp_server_add_session session=%s\n",
                 impl->config.session_name ? impl->config.session_name : "unknown");
         shared_rtsp_server_release();
         impl->shared_server_acquired = 0;
         return -1;
     }
-    /* 当前session添加视频流 */
-    if (sessionAddVideo(impl->session, VIDEO_H264) < 0) {
-        fprintf(stderr, "[ERROR] rtsp_sink_start failed: sessionAddVideo session=%s codec=H264\n",
-                impl->config.session_name ? impl->config.session_name : "unknown");
-        rtspDelSession(impl->session);
-        impl->session = NULL;
-        shared_rtsp_server_release();
-        impl->shared_server_acquired = 0;
-        return -1;
-    }
-    impl->last_client_count = query_rtsp_session_client_count(impl->session);
-    if (impl->last_client_count < 0) {
-        impl->last_client_count = 0;
+    rtsp_server_session_set_gop_cache(impl->session,
+                                      impl->config.gop_cache_max_frames,
+                                      impl->config.gop_cache_max_age_ms);
+    if (impl->config.multicast_group && impl->config.multicast_group[0]) {
+        RtspServerMulticastConfig multicast;
+
+        multicast.group = impl->config.multicast_group;
+        multicast.port = impl->config.multicast_port;
+        multicast.ttl = impl->config.multicast_ttl;
+        multicast.interface_ip = impl->config.multicast_interface;
+        /* 组播配置错误不影响单播播放，只告警。 */
+        if (rtsp_server_session_set_multicast(impl->session, &multicast) != 0) {
+            fprintf(stderr, "[WARN] rtsp multicast disabled session=%s group=%s port=%d\n",
+                    impl->config.session_name,
+                    impl->config.multicast_group,
+                    impl->config.multicast_port);
+        }
     }
-    atomic_store(&impl->pending_external_idr, 0);
-    atomic_store(&impl->awaiting_first_keyframe_after_external_idr, 0);
-    atomic_store(&impl->new_client_detect_ts_us, 0);
-    atomic_store(&impl->external_idr_request_ts_us, 0);
-    impl->pending_send_cached_sps_pps = 0;
 
-    printf("[INFO] RTSP sink ready: rtsp://%s:%d/%s\n",
+    printf("[INFO] RTSP sink ready: rtsp://%s:%d/%s gop_cache=%d max_age_ms=%d\n",
            impl->config.server_ip,
            impl->config.server_port,
-           impl->config.session_name);
+           impl->config.session_name,
+           impl->config.gop_cache_max_frames,
+           impl->config.gop_cache_max_age_ms);
     return 0;
 }
 
@@ -426,7 +308,25 @@ static int rtsp_sink_connect(MediaSink *sink) {
     return impl->session ? 0 : -1;
 }
 
-/* sink 发送：将 H264 包转为 RTSP 可发送单元。 */
+/* 新客户端接入后先补发缓存的 SPS/PPS，帮助其尽快完成解码初始化。 */
+static void send_cached_sps_pps_if_needed(RtspSinkImpl *impl, const MediaPacket *packet) {
+    size_t sps_len = 0;
+    size_t pps_len = 0;
+
+    if (!impl->config.immediate_sps_pps_on_new_client || !atomic_load(&impl->pending_send_cached_sps_pps)) {
+        return;
+    }
+    if (rtsp_server_session_send_parameter_sets(impl->session, packet->pts_us, &sps_len, &pps_len) != 0) {
+        return;
+    }
+    atomic_store(&impl->pending_send_cached_sps_pps, 0);
+    printf("[E2E] event=cached_sps_pps_sent session=%s sps=%zu pps=%zu\n",
+           impl->config.session_name ? impl->config.session_name : "unknown",
+           sps_len,
+           pps_len);
+}
+
+/* sink 发送：每帧打包一次 RTP，由服务线程分发给所有客户端。 */
 static int rtsp_sink_send_packet(MediaSink *sink, const MediaPacket *packet) {
     RtspSinkImpl *impl = (RtspSinkImpl *)sink->impl;
     if (!impl || !impl->session || !packet || !packet->buffer) {
@@ -436,11 +336,8 @@ static int rtsp_sink_send_packet(MediaSink *sink, const MediaPacket *packet) {
                 (void *)(packet ? packet->buffer : NULL));
         return -1;
     }
-    /* 在发送路径轻量轮询新客户端接入事件，避免额外线程/锁开销。 */
-    rtsp_sink_probe_new_client(impl);
-    /* 更新参数集缓存，并在开启开关时对新客户端补发 SPS/PPS。 */
-    update_sps_pps_cache(impl, packet->buffer->data, packet->buffer->size);
-    send_cached_sps_pps_if_needed(impl);
+    /* 参数集由打包器从码流中缓存，开关开启时对新客户端补发。 */
+    send_cached_sps_pps_if_needed(impl, packet);
     if (packet->is_key_frame && atomic_exchange(&impl->awaiting_first_keyframe_after_external_idr, 0)) {
         uint64_t now = now_us();
         uint64_t detect_ts = atomic_load(&impl->new_client_detect_ts_us);
@@ -456,7 +353,44 @@ static int rtsp_sink_send_packet(MediaSink *sink, const MediaPacket *packet) {
                idr_req_to_send,
                detect_to_send);
     }
-    return rtsp_send_annexb(impl->session, packet->buffer->data, packet->buffer->size);
+    return rtsp_server_session_send_packet(impl->session, packet);
+}
+
+/* 按需编码查询：session 内有任意客户端即视为有观看端。 */
+static int rtsp_sink_has_consumer(MediaSink *sink) {
+    RtspSinkImpl *impl = (RtspSinkImpl *)sink->impl;
+    if (!impl || !impl->session) {
+        return 0;
+    }
+    return rtsp_server_session_client_count(impl->session) > 0;
+}
+
+/* 周期统计：逐个打印单播观看端的队列和丢帧情况，用于定位拖慢的客户端。 */
+static void rtsp_sink_log_stats(MediaSink *sink) {
+    RtspSinkImpl *impl = (RtspSinkImpl *)sink->impl;
+    RtspServerClientStats clients[RTSP_SERVER_CLIENT_STATS_MAX];
+    int count;
+    int i;
+
+    if (!impl || !impl->session) {
+        return;
+    }
+    count = rtsp_server_session_get_client_stats(impl->session, clients, RTSP_SERVER_CLIENT_STATS_MAX);
+    for (i = 0; i < count; ++i) {
+        printf("[RTSP] event=client_stats session=%s peer=%s transport=%s queue_frames=%d queue_bytes=%zu peak_queue_bytes=%zu"
+               " sent_frames=%" PRIu64 " bytes=%" PRIu64 " dropped=%" PRIu64 " drop_events=%" PRIu64 " wait_key=%d\n",
+               impl->config.session_name ? impl->config.session_name : "unknown",
+               clients[i].peer,
+               clients[i].transport ? "tcp" : "udp",
+               clients[i].queue_frames,
+               clients[i].queue_bytes,
+               clients[i].peak_queue_bytes,
+               clients[i].sent_frames,
+               clients[i].bytes_sent,
+               clients[i].dropped_frames,
+               clients[i].drop_events,
+               clients[i].waiting_for_keyframe);
+    }
 }
 
 /* 当前实现无需主动断链，保留该钩子用于接口一致性。 */
@@ -471,24 +405,16 @@ static void rtsp_sink_stop(MediaSink *sink) {
         return;
     }
     if (impl->session) {
-        rtspDelSession(impl->session);
+        pthread_mutex_lock(&g_rtsp_shared_lock);
+        rtsp_server_remove_session(g_rtsp_shared_server.server, impl->session);
+        pthread_mutex_unlock(&g_rtsp_shared_lock);
         impl->session = NULL;
     }
     if (impl->shared_server_acquired) {
         shared_rtsp_server_release();
         impl->shared_server_acquired = 0;
     }
-    if (impl->cached_sps) {
-        free(impl->cached_sps);
-        impl->cached_sps = NULL;
-        impl->cached_sps_len = 0;
-    }
-    if (impl->cached_pps) {
-        free(impl->cached_pps);
-        impl->cached_pps = NULL;
-        impl->cached_pps_len = 0;
-    }
-    impl->pending_send_cached_sps_pps = 0;
+    atomic_store(&impl->pending_send_cached_sps_pps, 0);
 }
 
 /* 构建并初始化一个 RTSP sink。 */
@@ -498,7 +424,9 @@ int rtsp_sink_setup(MediaSink *sink, const RtspSinkConfig *config) {
         rtsp_sink_connect,
         rtsp_sink_send_packet,
         rtsp_sink_disconnect,
-        rtsp_sink_stop
+        rtsp_sink_stop,
+        rtsp_sink_has_consumer,
+        rtsp_sink_log_stats
     };
     MediaSinkConfig sink_config;
     RtspSinkImpl *impl;
@@ -537,6 +465,12 @@ int rtsp_sink_setup(MediaSink *sink, const RtspSinkConfig *config) {
     }
     impl->config.immediate_sps_pps_on_new_client =
         impl->config.immediate_sps_pps_on_new_client ? 1 : 0;
+    if (impl->config.gop_cache_max_frames < 0) {
+        impl->config.gop_cache_max_frames = 0;
+    }
+    if (impl->config.gop_cache_max_age_ms <= 0) {
+        impl->config.gop_cache_max_age_ms = DEFAULT_RTSP_GOP_CACHE_MAX_AGE_MS;
+    }
 
     memset(&sink_config, 0, sizeof(sink_config));
     sink_config.name = impl->config.name;
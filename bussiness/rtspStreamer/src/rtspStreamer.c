@@ -1,6 +1,5 @@
 #include "rtspStreamer.h"
 
-#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
@@ -8,7 +7,8 @@
 #include <time.h>
 #include <unistd.h>
 
-#include "rtsp_server_api.h"
+#include "mediaPacket.h"
+#include "rtspServer.h"
 
 #define DEFAULT_RTSP_SESSION "live"
 #define DEFAULT_RTSP_IP "0.0.0.0"
@@ -29,11 +29,6 @@
 #define DEFAULT_RECORD_FLUSH_INTERVAL_FRAMES 30
 #define H264_NAL_LOG_EVERY_N_FRAMES 60
 
-typedef struct {
-    RtspStreamerCtx *ctx;  /* 回指主 RTSP streamer 上下文，供服务线程读取配置。 */
-    int ret;               /* 服务线程退出时保存 rtspStartServer() 返回值。 */
-} RtspServerThreadArgs;
-
 /**
  * @description: 获取当前单调时钟时间，单位微秒
  * @return {static uint64_t}
@@ -157,9 +152,45 @@ static const char *h264_nalu_type_name(uint8_t nalu_type) {
     }
 }
 
+/**
+ * @description: 把一帧 Annex-B 码流封装成 MediaPacket 交给 RTSP session，RTP 打包在 session 内完成
+ * @param {RtspServerSession *} session
+ * @param {const uint8_t *} data
+ * @param {size_t} len
+ * @param {uint64_t} frame_id
+ * @param {int} is_key_frame
+ * @return {static int}
+ */
+static int send_h264_frame(RtspServerSession *session,
+                           const uint8_t *data,
+                           size_t len,
+                           uint64_t frame_id,
+                           int is_key_frame) {
+    MediaPacket packet;
+    int ret;
+
+    media_packet_init(&packet);
+    if (media_buffer_create_copy(data, len, &packet.buffer) != 0) {
+        fprintf(stderr, "[ERROR] media_buffer_create_copy failed\n");
+        return -1;
+    }
+    packet.frame_type = MEDIA_FRAME_TYPE_VIDEO;
+    packet.codec = MEDIA_CODEC_H264;
+    packet.frame_id = frame_id;
+    packet.pts_us = get_now_us();
+    packet.dts_us = packet.pts_us;
+    packet.is_key_frame = is_key_frame;
+    ret = rtsp_server_session_send_packet(session, &packet);
+    media_packet_reset(&packet);
+    if (ret < 0) {
+        fprintf(stderr, "[ERROR] rtsp_server_session_send_packet failed\n");
+    }
+    return ret;
+}
+
 /**
  * @description: 拆分并发送 H264 Annex-B 码流
- * @param {void *} session
+ * @param {RtspServerSession *} session
  * @param {uint8_t *} data
  * @param {size_t} len
  * @param {uint64_t} frame_id
@@ -167,7 +198,7 @@ static const char *h264_nalu_type_name(uint8_t nalu_type) {
  * @param {int} low_latency_mode
  * @return {static int}
  */
-static int send_h264_annexb(void *session,
+static int send_h264_annexb(RtspServerSession *session,
                             uint8_t *data,
                             size_t len,
                             uint64_t frame_id,
@@ -177,15 +208,15 @@ static int send_h264_annexb(void *session,
     size_t nalu_start = 0;
     int code_len = 0;
     int nalu_count = 0;
+    int has_idr = 0;
     char nalu_log[256];
     size_t nalu_log_len = 0;
 
     nalu_log[0] = '\0';
 
-    // 这里把 Annex-B 码流拆成独立 NALU 后逐个送给 rtsp_server。
-    // MPP 输出的是带起始码的 H264 Annex-B，需要先找到每个 NALU 的边界。
-    // 发送时去掉起始码，只把真正的 NALU payload 交给 RTP 打包模块。
-    // 如果没有找到起始码，就退化为把整块数据直接送给 sessionSendVideoData()。
+    // 这里只遍历 Annex-B 的 NALU 边界用于日志和关键帧判断。
+    // 整帧作为一个 MediaPacket 交给 RTSP session，由它一次性完成 RTP 打包。
+    // 如果没有找到起始码，就把整块数据视为一个 NALU 发送。
     if (find_start_code(data, len, 0, &nalu_start, &code_len) != 0) {
         uint8_t nalu_type = (len > 0) ? (data[0] & 0x1F) : 0;
         int should_log = (nalu_type == 5 || nalu_type == 7 || nalu_type == 8 ||
@@ -194,8 +225,7 @@ static int send_h264_annexb(void *session,
                  (unsigned)nalu_type,
                  h264_nalu_type_name(nalu_type));
         nalu_count = (len > 0) ? 1 : 0;
-        if (sessionSendVideoData(session, data, (int)len) < 0) {
-            fprintf(stderr, "[ERROR] sessionSendVideoData failed\n");
+        if (send_h264_frame(session, data, len, frame_id, nalu_type == 5) < 0) {
             return -1;
         }
         // 单 NALU 场景下也保留关键帧日志，便于确认 IDR/SPS/PPS 是否正常输出。
@@ -236,12 +266,8 @@ static int send_h264_annexb(void *session,
                 }
             }
             nalu_count++;
-
-            if (sessionSendVideoData(session,
-                                     data + payload_start,
-                                     (int)(next_start - payload_start)) < 0) {
-                fprintf(stderr, "[ERROR] sessionSendVideoData failed\n");
-                return -1;
+            if (nalu_type == 5) {
+                has_idr = 1;
             }
         }
 
@@ -253,6 +279,10 @@ static int send_h264_annexb(void *session,
         code_len = next_code_len;
     }
 
+    if (send_h264_frame(session, data, len, frame_id, has_idr) < 0) {
+        return -1;
+    }
+
     {
         int has_key = (strstr(nalu_log, "5(IDR)") != NULL) ||
                       (strstr(nalu_log, "7(SPS)") != NULL) ||
@@ -271,7 +301,7 @@ static int send_h264_annexb(void *session,
         if (send_video_before_ts_us) {
             *send_video_before_ts_us = ts;
         }
-        // printf("[TRACE] frame=%" PRIu64 " step=before_sessionSendVideoData ts_us=%" PRIu64 "\n",
+        // printf("[TRACE] frame=%" PRIu64 " step=before_send_packet ts_us=%" PRIu64 "\n",
         //        frame_id, ts);
     }
 
@@ -348,25 +378,6 @@ static void fill_default_config(RtspStreamerConfig *dst, const RtspStreamerConfi
     }
 }
 
-/**
- * @description: RTSP 服务线程入口函数
- * @param {void *} arg
- * @return {static void *}
- */
-static void *rtsp_server_thread(void *arg) {
-    RtspServerThreadArgs *thread_args = (RtspServerThreadArgs *)arg;
-    RtspStreamerCtx *ctx = thread_args->ctx;
-
-    // rtspStartServer() 会阻塞在内部循环/accept 上，因此放到独立线程中运行。
-    // 主线程继续负责采集、编码和推流，避免整个流程被服务端启动逻辑卡住。
-    thread_args->ret = rtspStartServer(ctx->config.auth_enable,
-                                       ctx->config.server_ip,
-                                       ctx->config.server_port,
-                                       ctx->config.user,
-                                       ctx->config.password);
-    return NULL;
-}
-
 /**
  * @description: 初始化 RTSP 推流模块
  * @param {RtspStreamerCtx *} ctx
@@ -408,24 +419,26 @@ int rtsp_streamer_init(RtspStreamerCtx *ctx, const RtspStreamerConfig *config) {
     }
     ctx->encoder_ready = 1;
 
-    // 初始化 RTSP 模块。
-    // 只有模块初始化成功后，后面的 session 创建和推流接口才可用。
-    if (rtspModuleInit() < 0) {
-        fprintf(stderr, "[ERROR] rtspModuleInit failed\n");
-        goto fail;
+    {
+        // 创建 RTSP 服务，服务线程在内部启动，客户端连接时服务端已经就绪。
+        RtspServerConfig server_config;
+        memset(&server_config, 0, sizeof(server_config));
+        server_config.listen_ip = ctx->config.server_ip;
+        server_config.listen_port = ctx->config.server_port;
+        server_config.auth_enable = ctx->config.auth_enable;
+        server_config.user = ctx->config.user;
+        server_config.password = ctx->config.password;
+        ctx->rtsp_server = rtsp_server_create(&server_config);
+        if (!ctx->rtsp_server) {
+            fprintf(stderr, "[ERROR] rtsp_server_create failed\n");
+            goto fail;
+        }
     }
-    ctx->rtsp_module_ready = 1;
 
     // 创建推流 session，客户端最终通过 rtsp://ip:port/session_name 访问。
-    ctx->rtsp_session = rtspAddSession(ctx->config.session_name);
+    ctx->rtsp_session = rtsp_server_add_session(ctx->rtsp_server, ctx->config.session_name, NULL, NULL);
     if (!ctx->rtsp_session) {
-        fprintf(stderr, "[ERROR] rtspAddSession failed\n");
-        goto fail;
-    }
-
-    // 声明当前 session 的视频类型为 H264，便于 RTSP 侧生成正确描述信息。
-    if (sessionAddVideo(ctx->rtsp_session, VIDEO_H264) < 0) {
-        fprintf(stderr, "[ERROR] sessionAddVideo failed\n");
+        fprintf(stderr, "[ERROR] rtsp_server_add_session failed\n");
         goto fail;
     }
 
@@ -468,8 +481,6 @@ int rtsp_streamer_run(RtspStreamerCtx *ctx) {
         return -1;
     }
 
-    pthread_t server_tid;
-    RtspServerThreadArgs thread_args;
     uint8_t *raw_frame = NULL;
     int raw_len = 0;
     uint64_t frame_id = 0;
@@ -477,21 +488,10 @@ int rtsp_streamer_run(RtspStreamerCtx *ctx) {
     int consecutive_encode_fail = 0;
     int ret = 0;
 
-    memset(&thread_args, 0, sizeof(thread_args));
-    thread_args.ctx = ctx;
-
-    // RTSP 服务线程先启动起来，确保客户端连接时服务端已经就绪。
-    // 主循环随后执行完整链路：采集 -> 编码 -> 拆包发送，形成持续推流。
-    ret = pthread_create(&server_tid, NULL, rtsp_server_thread, &thread_args);
-    if (ret != 0) {
-        fprintf(stderr, "[ERROR] pthread_create rtsp server failed: %d\n", ret);
-        return -1;
-    }
-
     // 主循环流程：
     // 1. 从 V4L2 获取 NV12 原始帧
     // 2. 送入 MPP 编码成 H264 Annex-B
-    // 3. 按 NALU 拆分后发送到 RTSP session
+    // 3. 整帧发送到 RTSP session，由服务线程分发给客户端
     while (ctx->running) {
         uint8_t *h264_data = NULL;
         size_t h264_len = 0;
@@ -610,13 +610,6 @@ int rtsp_streamer_run(RtspStreamerCtx *ctx) {
     }
 
     ctx->running = 0;
-    rtspStopServer();
-    pthread_join(server_tid, NULL);
-
-    if (thread_args.ret < 0 && ret == 0) {
-        ret = thread_args.ret;
-    }
-
     return ret;
 }
 
@@ -651,16 +644,13 @@ void rtsp_streamer_deinit(RtspStreamerCtx *ctx) {
         ctx->record_fp = NULL;
     }
 
-    if (ctx->rtsp_session) {
-        rtspDelSession(ctx->rtsp_session);
-        ctx->rtsp_session = NULL;
-    }
-
     // 按与初始化相反的顺序释放资源，保证依赖关系正确。
     // 结合各 ready 标记，即使 init() 中途失败也能安全执行这里的清理。
-    if (ctx->rtsp_module_ready) {
-        rtspModuleDel();
-        ctx->rtsp_module_ready = 0;
+    // 销毁服务会一并断开客户端并释放 session。
+    if (ctx->rtsp_server) {
+        rtsp_server_destroy(ctx->rtsp_server);
+        ctx->rtsp_server = NULL;
+        ctx->rtsp_session = NULL;
     }
 
     if (ctx->encoder_ready) {
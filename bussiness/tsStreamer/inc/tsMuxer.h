@@ -0,0 +1,121 @@
+#ifndef __TS_MUXER_H__
+#define __TS_MUXER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* TS 包长度。 */
+#define TS_PACKET_SIZE 188
+/* 一个 UDP 数据报默认装 7 个 TS 包（1316 字节），不超过以太网 MTU。 */
+#define TS_PACKETS_PER_DATAGRAM 7
+#define TS_PID_PAT 0x0000
+#define TS_PID_PMT 0x1000
+#define TS_PID_VIDEO 0x0100
+#define TS_STREAM_TYPE_H264 0x1B
+/* PTS/DTS 相对 PCR 的领先量（90kHz），给解码端留出缓冲。 */
+#define TS_PCR_DELAY_90K 9000
+/* 两次 PAT/PMT 之间的最大间隔（90kHz），关键帧前总会重发。 */
+#define TS_PSI_INTERVAL_90K 9000
+/* 两次 PCR 之间的目标间隔（90kHz），40ms，低于 H.222 规定的 100ms 上限。 */
+#define TS_PCR_INTERVAL_90K 3600
+/* 缓存的 SPS/PPS 最大长度，关键帧缺参数集时从缓存补。 */
+#define TS_MUXER_PARAM_SET_MAX 256
+
+/**
+ * @brief 取下一个 188 字节 TS 包的写入位置，由调用方从自己的常驻缓冲中分配。
+ * @param user 调用方上下文。
+ * @return 可写的 TS_PACKET_SIZE 字节，NULL 时中止本帧。
+ */
+typedef uint8_t *(*TsPacketSlotFn)(void *user);
+
+/**
+ * @brief 单节目、单视频流的 TS 封装状态，每路输出常驻一份。
+ *
+ * 每帧封装为一个 PES：缺 AUD 时补 AUD，关键帧缺 SPS/PPS 时从缓存补上，
+ * 首个 TS 包带 PCR，关键帧首包置 random_access_indicator。TS 包直接写进调用方给出的位置，不分配内存。
+ * 帧间隔超过 PCR/PSI 间隔（低帧率）时，调用方按时钟调用 ts_muxer_write_idle 补只带 PCR 的包和 PAT/PMT。
+ */
+typedef struct {
+    uint8_t cc_pat;                              /* PAT 连续计数。 */
+    uint8_t cc_pmt;                              /* PMT 连续计数。 */
+    uint8_t cc_video;                            /* 视频 PID 连续计数。 */
+    int psi_sent;                                /* 是否已发过 PAT/PMT。 */
+    uint64_t last_psi_90k;                       /* 最近一次发 PAT/PMT 时的流时钟（90kHz）。 */
+    int pcr_sent;                                /* 是否已发过 PCR，之前没有可以延续的时间线。 */
+    uint64_t last_pcr_90k;                       /* 最近一次写出的 PCR，保证帧间补发与帧首 PCR 单调递增。 */
+    uint8_t sps[TS_MUXER_PARAM_SET_MAX];         /* 最近一次出现的 SPS（不含起始码）。 */
+    size_t sps_len;                              /* sps 长度，0 表示还没有。 */
+    uint8_t pps[TS_MUXER_PARAM_SET_MAX];         /* 最近一次出现的 PPS（不含起始码）。 */
+    size_t pps_len;                              /* pps 长度，0 表示还没有。 */
+    uint64_t frames;                             /* 累计封装帧数。 */
+    uint64_t key_frames;                         /* 累计关键帧数。 */
+    uint64_t packets;                            /* 累计输出的 TS 包数（含 PAT/PMT）。 */
+    uint64_t psi_packets;                        /* 其中 PAT/PMT 包数。 */
+    uint64_t stuffing_bytes;                     /* 累计填充字节数。 */
+    uint64_t injected_param_sets;                /* 关键帧补 SPS/PPS 的次数。 */
+} TsMuxer;
+
+/**
+ * @brief 初始化封装状态，连续计数从 0 开始。
+ * @param muxer 封装状态。
+ */
+void ts_muxer_init(TsMuxer *muxer);
+
+/**
+ * @brief 输出一组 PAT + PMT，分段输出（如切片开头）时可主动调用。
+ * @param muxer 封装状态。
+ * @param slot 取 TS 包位置的回调。
+ * @param user 回调上下文。
+ * @return 0 成功，-1 回调返回 NULL。
+ */
+int ts_muxer_write_psi(TsMuxer *muxer, TsPacketSlotFn slot, void *user);
+
+/**
+ * @brief 把一帧 Annex-B H264 封装为 TS 包，必要时先输出 PAT/PMT。
+ * @param muxer 封装状态。
+ * @param annexb_data 帧数据。
+ * @param annexb_len 帧长度。
+ * @param is_key_frame 是否关键帧。
+ * @param pts_90k 显示时间戳（90kHz）。
+ * @param dts_90k 解码时间戳（90kHz），与 pts 相同时 PES 只带 PTS。
+ * @param slot 取 TS 包位置的回调。
+ * @param user 回调上下文。
+ * @return 本帧输出的 TS 包数，-1 参数错误或回调中止。
+ */
+int ts_muxer_write_frame(TsMuxer *muxer,
+                         const uint8_t *annexb_data,
+                         size_t annexb_len,
+                         int is_key_frame,
+                         uint64_t pts_90k,
+                         uint64_t dts_90k,
+                         TsPacketSlotFn slot,
+                         void *user);
+
+/**
+ * @brief 帧间隙按流时钟补发：距上次 PCR 满 TS_PCR_INTERVAL_90K 时输出一个只带 PCR 的视频 PID 包，
+ *        距上次 PAT/PMT 满 TS_PSI_INTERVAL_90K 时重发 PAT/PMT；没到间隔时什么都不写。
+ * @param muxer 封装状态。
+ * @param now_90k 当前流时钟（90kHz），由调用方按最近一帧的 DTS 加上之后流逝的时间算出。
+ * @param slot 取 TS 包位置的回调。
+ * @param user 回调上下文。
+ * @return 输出的 TS 包数（0 表示未到间隔或还没有发过帧），-1 参数错误或回调中止。
+ */
+int ts_muxer_write_idle(TsMuxer *muxer, uint64_t now_90k, TsPacketSlotFn slot, void *user);
+
+/**
+ * @brief 计算 PSI 段使用的 CRC32/MPEG-2。
+ * @param data 数据。
+ * @param len 长度。
+ * @return CRC 值。
+ */
+uint32_t ts_crc32(const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef __TS_UDP_SINK_H__
+#define __TS_UDP_SINK_H__
+
+#include <stdint.h>
+
+#include "mediaSink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char *name;               /* sink 名称，用于日志和统计信息。 */
+    const char *dest_ip;            /* 目的地址，单播或组播（224.0.0.0/4）。 */
+    int dest_port;                  /* 目的 UDP 端口。 */
+    int multicast_ttl;              /* 组播 TTL，默认 1 只在本网段。 */
+    const char *multicast_interface; /* 发送组播的本地网卡地址，空走系统路由。 */
+    int queue_capacity;             /* 该 sink 自身的发送队列容量。 */
+    int packets_per_datagram;       /* 每个 UDP 数据报装的 TS 包数，1~7，默认 7（1316 字节）。 */
+    int gso;                        /* 是否尝试 UDP GSO，不支持时自动退回 sendmmsg。 */
+    int pacing;                     /* 是否做令牌桶平滑，避免关键帧突发打满下游缓冲。 */
+    int pacing_rate_percent;        /* 平滑基础速率占码率的百分比。 */
+    int pacing_burst_bytes;         /* 令牌桶容量（字节）。 */
+    int pacing_spread_percent;      /* 大帧最多摊到帧间隔的百分之多少。 */
+    int video_bitrate;              /* 码流码率，平滑速率据此计算。 */
+    int video_fps;                  /* 码流帧率，平滑速率据此计算。 */
+} TsUdpSinkConfig;
+
+typedef struct {
+    uint64_t frames;                /* 已封装的视频帧数。 */
+    uint64_t ts_packets;            /* 已输出的 TS 包数（含 PAT/PMT）。 */
+    uint64_t psi_packets;           /* 其中 PAT/PMT 包数。 */
+    uint64_t datagrams;             /* 已发出的 UDP 数据报数。 */
+    uint64_t bytes_sent;            /* 已发出的 UDP 负载字节数。 */
+    uint64_t syscalls;              /* 发送系统调用次数。 */
+    uint64_t send_errors;           /* 发送失败次数。 */
+} TsUdpSinkStats;
+
+/**
+ * @description: 创建 MPEG-TS over UDP 输出通道：编码后的 H264 帧直接封装为 PAT/PMT/PES（带 PCR），
+ *               按每个数据报 7 个 TS 包写进常驻环形缓冲，再由 sendmmsg/GSO 批量发出，不重新编码、不逐帧分配内存。
+ *               目的地址为组播时按配置设置 TTL 和发送网卡。低帧率下由独立时钟线程在帧间补发 PCR 和 PAT/PMT，
+ *               PCR 间隔不随帧率变长。
+ * @param {MediaSink *} sink 输出通道。
+ * @param {const TsUdpSinkConfig *} config 配置。
+ * @return {int} 0 成功，-1 失败。
+ */
+int ts_udp_sink_setup(MediaSink *sink, const TsUdpSinkConfig *config);
+
+/**
+ * @description: 获取 TS over UDP 输出通道的运行统计。
+ * @param {MediaSink *} sink 由 ts_udp_sink_setup 创建的通道。
+ * @param {TsUdpSinkStats *} stats 输出统计。
+ * @return {int} 0 成功，-1 参数非法。
+ */
+int ts_udp_sink_get_stats(MediaSink *sink, TsUdpSinkStats *stats);
+
+/**
+ * @description: 上游编码器码率/帧率被重新配置后调用，发送线程在下一帧按新值更新发送平滑速率。
+ * @param {MediaSink *} sink 由 ts_udp_sink_setup 创建的通道。
+ * @param {int} bitrate 新码率（bps）。
+ * @param {int} fps 新帧率。
+ * @return {void}
+ */
+void ts_udp_sink_update_rate(MediaSink *sink, int bitrate, int fps);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,347 @@
+#include "tsMuxer.h"
+
+#include <string.h>
+
+#include "mediaPacket.h"
+
+#define TS_SYNC_BYTE 0x47
+#define TS_PAYLOAD_SIZE (TS_PACKET_SIZE - 4)
+#define TS_PROGRAM_NUMBER 1
+#define TS_STREAM_ID_VIDEO 0xE0
+#define TS_PTS_MASK 0x1FFFFFFFFULL
+/* PES 负载最多由几段拼成：PES 头、AUD、起始码+SPS、起始码+PPS、帧其余部分。 */
+#define TS_MAX_PIECES 7
+#define H264_NALU_AUD 9
+#define H264_NALU_SPS 7
+#define H264_NALU_PPS 8
+
+/*
+ * 一帧的 PES 字节流按“分段”组织：PES 头和补的 AUD/SPS/PPS 引用常量或缓存，帧数据引用调用方内存，
+ * 写 TS 包时逐段拷进 188 字节的负载区，整帧只拷贝这一次。
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+} TsPiece;
+
+typedef struct {
+    TsPiece pieces[TS_MAX_PIECES];
+    int count;
+    int index;
+    size_t offset;
+    size_t remaining;
+} TsPieceReader;
+
+static const uint8_t g_start_code[4] = {0x00, 0x00, 0x00, 0x01};
+static const uint8_t g_aud[6] = {0x00, 0x00, 0x00, 0x01, 0x09, 0xF0};
+
+static void piece_add(TsPieceReader *reader, const uint8_t *data, size_t len) {
+    if (len == 0 || reader->count >= TS_MAX_PIECES) return;
+    reader->pieces[reader->count].data = data;
+    reader->pieces[reader->count].len = len;
+    reader->count++;
+    reader->remaining += len;
+}
+
+static void piece_read(TsPieceReader *reader, uint8_t *dst, size_t len) {
+    while (len > 0 && reader->index < reader->count) {
+        const TsPiece *piece = &reader->pieces[reader->index];
+        size_t n = piece->len - reader->offset;
+        if (n > len) n = len;
+        memcpy(dst, piece->data + reader->offset, n);
+        dst += n;
+        len -= n;
+        reader->offset += n;
+        reader->remaining -= n;
+        if (reader->offset == piece->len) {
+            reader->index++;
+            reader->offset = 0;
+        }
+    }
+}
+
+static void write_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static void write_timestamp(uint8_t *p, uint8_t prefix, uint64_t ts) {
+    ts &= TS_PTS_MASK;
+    p[0] = (uint8_t)((prefix << 4) | (((ts >> 30) & 0x07) << 1) | 1);
+    p[1] = (uint8_t)(ts >> 22);
+    p[2] = (uint8_t)((((ts >> 15) & 0x7F) << 1) | 1);
+    p[3] = (uint8_t)(ts >> 7);
+    p[4] = (uint8_t)(((ts & 0x7F) << 1) | 1);
+}
+
+static void write_pcr(uint8_t *p, uint64_t pcr_90k) {
+    uint64_t base = pcr_90k & TS_PTS_MASK;
+    p[0] = (uint8_t)(base >> 25);
+    p[1] = (uint8_t)(base >> 17);
+    p[2] = (uint8_t)(base >> 9);
+    p[3] = (uint8_t)(base >> 1);
+    /* 扩展部分固定为 0：PCR 只按 90kHz 精度给出。 */
+    p[4] = (uint8_t)(((base & 1) << 7) | 0x7E);
+    p[5] = 0;
+}
+
+uint32_t ts_crc32(const uint8_t *data, size_t len) {
+    uint32_t crc = 0xFFFFFFFFU;
+    size_t i;
+    int bit;
+    for (i = 0; i < len; ++i) {
+        crc ^= (uint32_t)data[i] << 24;
+        for (bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80000000U) ? (crc << 1) ^ 0x04C11DB7U : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+/* 输出一个只含 PSI 段的 TS 包，段后用 0xFF 填满。 */
+static int write_section(TsMuxer *muxer, uint16_t pid, uint8_t *cc, const uint8_t *section, size_t len,
+                         TsPacketSlotFn slot, void *user) {
+    uint8_t *p = slot(user);
+    if (!p) return -1;
+    p[0] = TS_SYNC_BYTE;
+    p[1] = (uint8_t)(0x40 | (pid >> 8));
+    p[2] = (uint8_t)pid;
+    p[3] = (uint8_t)(0x10 | (*cc & 0x0F));
+    *cc = (uint8_t)((*cc + 1) & 0x0F);
+    p[4] = 0;
+    memcpy(p + 5, section, len);
+    memset(p + 5 + len, 0xFF, TS_PACKET_SIZE - 5 - len);
+    muxer->packets++;
+    muxer->psi_packets++;
+    return 0;
+}
+
+/* 输出一个只有自适应域、只带 PCR 的视频 PID 包；没有负载，按 H.222 连续计数不递增。 */
+static int write_pcr_packet(TsMuxer *muxer, uint64_t pcr_90k, TsPacketSlotFn slot, void *user) {
+    uint8_t *p = slot(user);
+    if (!p) return -1;
+    p[0] = TS_SYNC_BYTE;
+    p[1] = (uint8_t)(TS_PID_VIDEO >> 8);
+    p[2] = (uint8_t)TS_PID_VIDEO;
+    /* 连续计数沿用上一个带负载的包，cc_video 存的是下一个要用的值。 */
+    p[3] = (uint8_t)(0x20 | ((muxer->cc_video - 1) & 0x0F));
+    p[4] = TS_PAYLOAD_SIZE - 1;
+    p[5] = 0x10;
+    write_pcr(p + 6, pcr_90k);
+    memset(p + 12, 0xFF, TS_PACKET_SIZE - 12);
+    muxer->stuffing_bytes += TS_PACKET_SIZE - 12;
+    muxer->packets++;
+    muxer->last_pcr_90k = pcr_90k;
+    return 0;
+}
+
+void ts_muxer_init(TsMuxer *muxer) {
+    if (!muxer) return;
+    memset(muxer, 0, sizeof(*muxer));
+}
+
+int ts_muxer_write_psi(TsMuxer *muxer, TsPacketSlotFn slot, void *user) {
+    uint8_t pat[16];
+    uint8_t pmt[24];
+    if (!muxer || !slot) return -1;
+
+    pat[0] = 0x00;
+    pat[1] = 0xB0;
+    pat[2] = 13;
+    pat[3] = 0x00;
+    pat[4] = 0x01;
+    pat[5] = 0xC1;
+    pat[6] = 0x00;
+    pat[7] = 0x00;
+    pat[8] = 0x00;
+    pat[9] = TS_PROGRAM_NUMBER;
+    pat[10] = (uint8_t)(0xE0 | (TS_PID_PMT >> 8));
+    pat[11] = (uint8_t)TS_PID_PMT;
+    write_be32(pat + 12, ts_crc32(pat, 12));
+
+    pmt[0] = 0x02;
+    pmt[1] = 0xB0;
+    pmt[2] = 18;
+    pmt[3] = 0x00;
+    pmt[4] = TS_PROGRAM_NUMBER;
+    pmt[5] = 0xC1;
+    pmt[6] = 0x00;
+    pmt[7] = 0x00;
+    pmt[8] = (uint8_t)(0xE0 | (TS_PID_VIDEO >> 8));
+    pmt[9] = (uint8_t)TS_PID_VIDEO;
+    pmt[10] = 0xF0;
+    pmt[11] = 0x00;
+    pmt[12] = TS_STREAM_TYPE_H264;
+    pmt[13] = (uint8_t)(0xE0 | (TS_PID_VIDEO >> 8));
+    pmt[14] = (uint8_t)TS_PID_VIDEO;
+    pmt[15] = 0xF0;
+    pmt[16] = 0x00;
+    write_be32(pmt + 17, ts_crc32(pmt, 17));
+
+    if (write_section(muxer, TS_PID_PAT, &muxer->cc_pat, pat, sizeof(pat), slot, user) != 0 ||
+        write_section(muxer, TS_PID_PMT, &muxer->cc_pmt, pmt, 21, slot, user) != 0) {
+        return -1;
+    }
+    muxer->psi_sent = 1;
+    return 0;
+}
+
+int ts_muxer_write_frame(TsMuxer *muxer,
+                         const uint8_t *annexb_data,
+                         size_t annexb_len,
+                         int is_key_frame,
+                         uint64_t pts_90k,
+                         uint64_t dts_90k,
+                         TsPacketSlotFn slot,
+                         void *user) {
+    TsPieceReader reader;
+    uint8_t pes[19];
+    size_t pes_len = 9;
+    size_t aud_end = 0;
+    size_t pos = 0;
+    MediaNaluView nalu;
+    int has_sps = 0;
+    int packets = 0;
+    int first = 1;
+    uint64_t pcr_90k = dts_90k;
+
+    if (!muxer || !annexb_data || annexb_len == 0 || !slot) return -1;
+
+    /* 扫一遍 NALU：记下开头的 AUD，缓存 SPS/PPS。 */
+    while (media_annexb_next_nalu(annexb_data, annexb_len, &pos, &nalu)) {
+        uint8_t type = nalu.data[0] & 0x1F;
+        /* 起始码就在帧首（3/4 字节）的 AUD 才算开头的 AUD，pos 此时是下一个起始码的位置。 */
+        if (type == H264_NALU_AUD && (size_t)(nalu.data - annexb_data) <= 4) {
+            aud_end = pos;
+        } else if (type == H264_NALU_SPS && nalu.size <= TS_MUXER_PARAM_SET_MAX) {
+            memcpy(muxer->sps, nalu.data, nalu.size);
+            muxer->sps_len = nalu.size;
+            has_sps = 1;
+        } else if (type == H264_NALU_PPS && nalu.size <= TS_MUXER_PARAM_SET_MAX) {
+            memcpy(muxer->pps, nalu.data, nalu.size);
+            muxer->pps_len = nalu.size;
+        }
+    }
+
+    /*
+     * 帧间补发的 PCR 按墙钟外推，可能略超过这一帧的 DTS；差距在 PTS/DTS 领先量以内时沿用上次的值，
+     * 保证 PCR 不回退。差距更大说明时间戳被重置，直接用新的 DTS。
+     */
+    if (muxer->pcr_sent && pcr_90k < muxer->last_pcr_90k && muxer->last_pcr_90k - pcr_90k < TS_PCR_DELAY_90K) {
+        pcr_90k = muxer->last_pcr_90k;
+    }
+
+    if (is_key_frame || !muxer->psi_sent ||
+        (pcr_90k >= muxer->last_psi_90k && pcr_90k - muxer->last_psi_90k >= TS_PSI_INTERVAL_90K)) {
+        if (ts_muxer_write_psi(muxer, slot, user) != 0) return -1;
+        muxer->last_psi_90k = pcr_90k;
+        packets += 2;
+    }
+
+    pes[0] = 0x00;
+    pes[1] = 0x00;
+    pes[2] = 0x01;
+    pes[3] = TS_STREAM_ID_VIDEO;
+    /* 视频 PES 长度填 0（不限长），大帧不受 16 位长度限制。 */
+    pes[4] = 0x00;
+    pes[5] = 0x00;
+    pes[6] = 0x84;
+    if (pts_90k != dts_90k) {
+        pes[7] = 0xC0;
+        pes[8] = 10;
+        write_timestamp(pes + 9, 0x3, pts_90k + TS_PCR_DELAY_90K);
+        write_timestamp(pes + 14, 0x1, dts_90k + TS_PCR_DELAY_90K);
+        pes_len = 19;
+    } else {
+        pes[7] = 0x80;
+        pes[8] = 5;
+        write_timestamp(pes + 9, 0x2, pts_90k + TS_PCR_DELAY_90K);
+        pes_len = 14;
+    }
+
+    memset(&reader, 0, sizeof(reader));
+    piece_add(&reader, pes, pes_len);
+    /* H.222 要求 TS 中的每个 H264 访问单元以 AUD 开头。 */
+    if (aud_end > 0) {
+        piece_add(&reader, annexb_data, aud_end);
+    } else {
+        piece_add(&reader, g_aud, sizeof(g_aud));
+    }
+    if (is_key_frame && !has_sps && muxer->sps_len > 0 && muxer->pps_len > 0) {
+        /* 编码器只在流开头带参数集时，每个关键帧都补上，中途加入的接收端才能解码。 */
+        piece_add(&reader, g_start_code, sizeof(g_start_code));
+        piece_add(&reader, muxer->sps, muxer->sps_len);
+        piece_add(&reader, g_start_code, sizeof(g_start_code));
+        piece_add(&reader, muxer->pps, muxer->pps_len);
+        muxer->injected_param_sets++;
+    }
+    piece_add(&reader, annexb_data + aud_end, annexb_len - aud_end);
+
+    while (reader.remaining > 0) {
+        uint8_t *p = slot(user);
+        size_t af_len = 0;
+        size_t space;
+        int pcr = first;
+        int rai = first && is_key_frame;
+
+        if (!p) return -1;
+        /* 自适应域：首包带 PCR（关键帧再置随机接入标志），末包不足 184 字节时用填充补齐。 */
+        if (pcr || rai) af_len = 2 + (pcr ? 6 : 0);
+        space = TS_PAYLOAD_SIZE - af_len;
+        if (reader.remaining < space) {
+            /* 原本没有自适应域且只差 1 字节时，自适应域只有一个值为 0 的长度字节。 */
+            af_len += space - reader.remaining;
+            space = reader.remaining;
+        }
+        p[0] = TS_SYNC_BYTE;
+        p[1] = (uint8_t)((first ? 0x40 : 0x00) | (TS_PID_VIDEO >> 8));
+        p[2] = (uint8_t)TS_PID_VIDEO;
+        p[3] = (uint8_t)((af_len > 0 ? 0x30 : 0x10) | (muxer->cc_video & 0x0F));
+        muxer->cc_video = (uint8_t)((muxer->cc_video + 1) & 0x0F);
+        if (af_len > 0) {
+            uint8_t *af = p + 4;
+            size_t used = 1;
+            af[0] = (uint8_t)(af_len - 1);
+            if (af_len >= 2) {
+                af[1] = (uint8_t)((rai ? 0x40 : 0x00) | (pcr ? 0x10 : 0x00));
+                used = 2;
+                if (pcr) {
+                    write_pcr(af + 2, pcr_90k);
+                    used += 6;
+                }
+            }
+            memset(af + used, 0xFF, af_len - used);
+            muxer->stuffing_bytes += af_len - used;
+        }
+        piece_read(&reader, p + 4 + af_len, space);
+        muxer->packets++;
+        packets++;
+        first = 0;
+    }
+    muxer->pcr_sent = 1;
+    muxer->last_pcr_90k = pcr_90k;
+    muxer->frames++;
+    if (is_key_frame) muxer->key_frames++;
+    return packets;
+}
+
+int ts_muxer_write_idle(TsMuxer *muxer, uint64_t now_90k, TsPacketSlotFn slot, void *user) {
+    int packets = 0;
+
+    if (!muxer || !slot) return -1;
+    /* 还没发过帧时没有时间线可延续；时钟落后于上次 PCR 时也不补，避免 PCR 回退。 */
+    if (!muxer->pcr_sent || now_90k < muxer->last_pcr_90k) return 0;
+
+    if (now_90k >= muxer->last_psi_90k && now_90k - muxer->last_psi_90k >= TS_PSI_INTERVAL_90K) {
+        if (ts_muxer_write_psi(muxer, slot, user) != 0) return -1;
+        muxer->last_psi_90k = now_90k;
+        packets += 2;
+    }
+    if (now_90k - muxer->last_pcr_90k >= TS_PCR_INTERVAL_90K) {
+        if (write_pcr_packet(muxer, now_90k, slot, user) != 0) return -1;
+        packets++;
+    }
+    return packets;
+}
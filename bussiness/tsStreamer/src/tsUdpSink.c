@@ -0,0 +1,507 @@
+#include "tsUdpSink.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mediaRtpEgress.h"
+#include "tsMuxer.h"
+
+#define DEFAULT_TS_UDP_NAME "ts-udp"
+#define DEFAULT_TS_UDP_QUEUE_CAPACITY 64
+#define DEFAULT_TS_UDP_RECONNECT_INTERVAL_MS 1000
+#define DEFAULT_TS_UDP_TTL 1
+#define DEFAULT_TS_UDP_SNDBUF (1024 * 1024)
+/* 环形缓冲的数据报数：发送器每攒满一批就发出，环比一批大一倍即可保证被引用的数据报不会被覆盖。 */
+#define TS_UDP_RING_DATAGRAMS (MEDIA_RTP_EGRESS_MAX_BATCH * 2)
+#define TS_UDP_DATAGRAM_MAX (TS_PACKET_SIZE * TS_PACKETS_PER_DATAGRAM)
+#define TS_UDP_STATS_INTERVAL_FRAMES 900
+/* 时钟线程检查 PCR/PSI 是否到期的周期，远小于 TS_PCR_INTERVAL_90K（40ms）。 */
+#define TS_UDP_CLOCK_TICK_US 10000
+
+typedef struct {
+    TsUdpSinkConfig config;         /* 配置副本。 */
+    int fd;                         /* UDP 发送 socket，connect 时创建。 */
+    TsMuxer muxer;                  /* TS 封装状态，连续计数跨重连保持递增。 */
+    MediaRtpEgress egress;          /* 批量发送器，数据报作为无头负载排队。 */
+    uint8_t ring[TS_UDP_RING_DATAGRAMS][TS_UDP_DATAGRAM_MAX]; /* 常驻数据报环，TS 包直接写在这里。 */
+    int ring_head;                  /* 正在填充的数据报下标。 */
+    int ring_fill;                  /* 正在填充的数据报已有的 TS 包数。 */
+    int queue_failed;               /* 本帧排队失败，帧结束时作为发送失败上报。 */
+    pthread_mutex_t lock;           /* 保护 stats 与待生效的码率/帧率。 */
+    pthread_mutex_t mux_lock;       /* 发送线程和时钟线程共用封装状态、数据报环、发送器和 fd，写入时持有。 */
+    pthread_t clock_thread;         /* 时钟线程：帧间隔超过 PCR/PSI 间隔时补发。 */
+    int clock_running;              /* 时钟线程是否已启动。 */
+    volatile int clock_stop;        /* 请求时钟线程退出。 */
+    uint64_t clock_base_90k;        /* 最近一帧的 PCR，帧间流时钟从这里按墙钟外推。 */
+    uint64_t clock_base_us;         /* 写出最近一帧时的单调时钟（微秒），0 表示还没有帧。 */
+    TsUdpSinkStats stats;           /* 每帧结束时更新的统计快照。 */
+    int pending_bitrate;            /* 上游调整后待发送线程生效的码率，0 表示没有变化。 */
+    int pending_fps;                /* 与 pending_bitrate 一起生效的帧率。 */
+} TsUdpSinkImpl;
+
+/**
+ * @description: 把正在填充的数据报交给发送器，并切到环中的下一个数据报
+ * @param {TsUdpSinkImpl *} impl
+ * @return {static void}
+ */
+static void ts_udp_queue_datagram(TsUdpSinkImpl *impl) {
+    struct iovec iov;
+
+    if (impl->ring_fill == 0) {
+        return;
+    }
+    iov.iov_base = impl->ring[impl->ring_head];
+    iov.iov_len = (size_t)impl->ring_fill * TS_PACKET_SIZE;
+    if (media_rtp_egress_queue(&impl->egress, (const uint8_t *)"", 0, &iov, 1) != 0) {
+        impl->queue_failed = 1;
+    }
+    impl->ring_head = (impl->ring_head + 1) % TS_UDP_RING_DATAGRAMS;
+    impl->ring_fill = 0;
+}
+
+/**
+ * @description: TS 封装回调：在环形缓冲中取下一个 188 字节位置，数据报装满后在下一次取位置时排队
+ * @param {void *} user
+ * @return {static uint8_t *}
+ */
+static uint8_t *ts_udp_next_slot(void *user) {
+    TsUdpSinkImpl *impl = (TsUdpSinkImpl *)user;
+    uint8_t *slot;
+
+    if (impl->ring_fill >= impl->config.packets_per_datagram) {
+        ts_udp_queue_datagram(impl);
+    }
+    slot = impl->ring[impl->ring_head] + (size_t)impl->ring_fill * TS_PACKET_SIZE;
+    impl->ring_fill++;
+    return slot;
+}
+
+/**
+ * @description: 获取单调时钟微秒数
+ * @return {static uint64_t}
+ */
+static uint64_t ts_udp_now_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+/**
+ * @description: 判断目的地址是否为组播地址
+ * @param {const char *} ip
+ * @return {static int}
+ */
+static int ts_udp_is_multicast(const char *ip) {
+    struct in_addr addr;
+    if (!ip || inet_pton(AF_INET, ip, &addr) != 1) {
+        return 0;
+    }
+    return IN_MULTICAST(ntohl(addr.s_addr)) ? 1 : 0;
+}
+
+/**
+ * @description: 更新统计快照
+ * @param {TsUdpSinkImpl *} impl
+ * @return {static void}
+ */
+static void ts_udp_publish_stats(TsUdpSinkImpl *impl) {
+    pthread_mutex_lock(&impl->lock);
+    impl->stats.frames = impl->muxer.frames;
+    impl->stats.ts_packets = impl->muxer.packets;
+    impl->stats.psi_packets = impl->muxer.psi_packets;
+    impl->stats.datagrams = impl->egress.packets;
+    impl->stats.bytes_sent = impl->egress.bytes;
+    impl->stats.syscalls = impl->egress.syscalls;
+    impl->stats.send_errors = impl->egress.errors;
+    pthread_mutex_unlock(&impl->lock);
+}
+
+/**
+ * @description: 时钟线程主函数：按最近一帧的 PCR 加上流逝的墙钟时间推算流时钟，
+ *               低帧率下帧间隔超过 40ms 时补只带 PCR 的包，超过 100ms 时补 PAT/PMT，不依赖下一帧到达
+ * @param {void *} arg
+ * @return {static void *}
+ */
+static void *ts_udp_clock_thread(void *arg) {
+    TsUdpSinkImpl *impl = (TsUdpSinkImpl *)arg;
+
+    while (!impl->clock_stop) {
+        usleep(TS_UDP_CLOCK_TICK_US);
+        pthread_mutex_lock(&impl->mux_lock);
+        if (impl->fd >= 0 && impl->egress.target_ready && impl->clock_base_us > 0) {
+            uint64_t now_90k = impl->clock_base_90k + (ts_udp_now_us() - impl->clock_base_us) * 9 / 100;
+            int written = ts_muxer_write_idle(&impl->muxer, now_90k, ts_udp_next_slot, impl);
+
+            if (written > 0) {
+                ts_udp_queue_datagram(impl);
+                media_rtp_egress_flush(&impl->egress);
+                ts_udp_publish_stats(impl);
+            } else if (written < 0) {
+                impl->ring_fill = 0;
+            }
+        }
+        pthread_mutex_unlock(&impl->mux_lock);
+    }
+    return NULL;
+}
+
+/**
+ * @description: 检查 TS over UDP 通道配置
+ * @param {MediaSink *} sink
+ * @return {static int}
+ */
+static int ts_udp_sink_start(MediaSink *sink) {
+    TsUdpSinkImpl *impl = (TsUdpSinkImpl *)sink->impl;
+    struct in_addr addr;
+
+    if (!impl->config.dest_ip || inet_pton(AF_INET, impl->config.dest_ip, &addr) != 1 ||
+        impl->config.dest_port <= 0 || impl->config.dest_port > 65535) {
+        fprintf(stderr, "[WARN] TS UDP sink disabled: invalid destination %s:%d\n",
+                impl->config.dest_ip ? impl->config.dest_ip : "(null)",
+                impl->config.dest_port);
+        return -1;
+    }
+    printf("[INFO] TS UDP sink configured: udp://%s:%d multicast=%d ttl=%d packets_per_datagram=%d pacing=%d\n",
+           impl->config.dest_ip,
+           impl->config.dest_port,
+           ts_udp_is_multicast(impl->config.dest_ip),
+           impl->config.multicast_ttl,
+           impl->config.packets_per_datagram,
+           impl->config.pacing);
+    impl->clock_stop = 0;
+    if (pthread_create(&impl->clock_thread, NULL, ts_udp_clock_thread, impl) != 0) {
+        fprintf(stderr, "[TS][ERROR] start failed: clock pthread_create\n");
+        return -1;
+    }
+    impl->clock_running = 1;
+    return 0;
+}
+
+/**
+ * @description: 创建 UDP socket 并设置目的地址，组播时设置 TTL 和发送网卡
+ * @param {MediaSink *} sink
+ * @return {static int}
+ */
+static int ts_udp_sink_connect(MediaSink *sink) {
+    TsUdpSinkImpl *impl = (TsUdpSinkImpl *)sink->impl;
+    int sndbuf = DEFAULT_TS_UDP_SNDBUF;
+    int fd;
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "[TS][ERROR] socket failed errno=%d(%s)\n", errno, strerror(errno));
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    if (ts_udp_is_multicast(impl->config.dest_ip)) {
+        unsigned char ttl = (unsigned char)impl->config.multicast_ttl;
+        unsigned char loop = 1;
+        struct in_addr interface_addr;
+
+        interface_addr.s_addr = htonl(INADDR_ANY);
+        if (impl->config.multicast_interface && impl->config.multicast_interface[0] &&
+            inet_pton(AF_INET, impl->config.multicast_interface, &interface_addr) != 1) {
+            fprintf(stderr, "[TS][ERROR] invalid multicast interface %s\n", impl->config.multicast_interface);
+            close(fd);
+            return -1;
+        }
+        /* 本机回环保持开启，同机接收端和 loopback 测试都能收到。 */
+        if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) != 0 ||
+            setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) != 0 ||
+            setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &interface_addr, sizeof(interface_addr)) != 0) {
+            fprintf(stderr, "[TS][ERROR] multicast setsockopt failed errno=%d(%s)\n", errno, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+    if (media_rtp_egress_set_target(&impl->egress, fd, impl->config.dest_ip, impl->config.dest_port) != 0) {
+        close(fd);
+        return -1;
+    }
+    pthread_mutex_lock(&impl->mux_lock);
+    impl->fd = fd;
+    impl->ring_fill = 0;
+    impl->clock_base_us = 0;
+    pthread_mutex_unlock(&impl->mux_lock);
+    printf("[TS] event=connected dest=%s:%d fd=%d gso=%d\n",
+           impl->config.dest_ip,
+           impl->config.dest_port,
+           fd,
+           impl->config.gso);
+    return 0;
+}
+
+/**
+ * @description: 封装并发送一帧
+ * @param {MediaSink *} sink
+ * @param {const MediaPacket *} packet
+ * @return {static int}
+ */
+static int ts_udp_sink_send_packet(MediaSink *sink, const MediaPacket *packet) {
+    TsUdpSinkImpl *impl = (TsUdpSinkImpl *)sink->impl;
+    uint64_t pts_90k;
+    uint64_t dts_90k;
+    size_t estimate;
+
+    if (!impl || impl->fd < 0 || !packet || !packet->buffer) {
+        fprintf(stderr, "[TS][ERROR] send_packet invalid args fd=%d packet=%p\n", impl ? impl->fd : -1, (void *)packet);
+        return -1;
+    }
+    if (packet->frame_type != MEDIA_FRAME_TYPE_VIDEO || packet->codec != MEDIA_CODEC_H264) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&impl->lock);
+    if (impl->pending_bitrate > 0) {
+        media_rtp_egress_update_pacing_rate(&impl->egress, impl->pending_bitrate, impl->pending_fps);
+        impl->pending_bitrate = 0;
+    }
+    pthread_mutex_unlock(&impl->lock);
+
+    pts_90k = packet->pts_us * 9 / 100;
+    dts_90k = (packet->dts_us ? packet->dts_us : packet->pts_us) * 9 / 100;
+    /* 按负载加 PES/PSI 开销估算本帧字节数，供平滑器计算速率。 */
+    estimate = (packet->buffer->size / (TS_PACKET_SIZE - 4) + 4) * TS_PACKET_SIZE;
+    pthread_mutex_lock(&impl->mux_lock);
+    if (media_rtp_egress_begin_frame(&impl->egress, estimate) != 0) {
+        pthread_mutex_unlock(&impl->mux_lock);
+        return 0;
+    }
+    impl->queue_failed = 0;
+    if (ts_muxer_write_frame(&impl->muxer,
+                             packet->buffer->data,
+                             packet->buffer->size,
+                             packet->is_key_frame,
+                             pts_90k,
+                             dts_90k,
+                             ts_udp_next_slot,
+                             impl) < 0) {
+        fprintf(stderr, "[TS][ERROR] mux failed frame=%" PRIu64 " size=%zu\n", packet->frame_id, packet->buffer->size);
+        impl->ring_fill = 0;
+        pthread_mutex_unlock(&impl->mux_lock);
+        return -1;
+    }
+    /* 帧尾不足一个数据报时也立即发出，不等下一帧凑满，避免增加一帧时延。 */
+    ts_udp_queue_datagram(impl);
+    if (media_rtp_egress_end_frame(&impl->egress) != 0 || impl->queue_failed) {
+        fprintf(stderr, "[TS][ERROR] send failed frame=%" PRIu64 " errors=%" PRIu64 "\n",
+                packet->frame_id,
+                impl->egress.errors);
+        ts_udp_publish_stats(impl);
+        pthread_mutex_unlock(&impl->mux_lock);
+        return -1;
+    }
+    /* 帧间流时钟以这一帧的 PCR 为起点，时钟线程据此补发。 */
+    impl->clock_base_90k = impl->muxer.last_pcr_90k;
+    impl->clock_base_us = ts_udp_now_us();
+    ts_udp_publish_stats(impl);
+    pthread_mutex_unlock(&impl->mux_lock);
+    if ((impl->muxer.frames % TS_UDP_STATS_INTERVAL_FRAMES) == 0) {
+        printf("[TS] event=stats dest=%s:%d frames=%" PRIu64 " ts_packets=%" PRIu64 " datagrams=%" PRIu64
+               " syscalls=%" PRIu64 " gso_sends=%" PRIu64 " stuffing=%" PRIu64 " injected_param_sets=%" PRIu64 "\n",
+               impl->config.dest_ip,
+               impl->config.dest_port,
+               impl->muxer.frames,
+               impl->muxer.packets,
+               impl->egress.packets,
+               impl->egress.syscalls,
+               impl->egress.gso_sends,
+               impl->muxer.stuffing_bytes,
+               impl->muxer.injected_param_sets);
+    }
+    return 0;
+}
+
+/**
+ * @description: 关闭 UDP socket
+ * @param {MediaSink *} sink
+ * @return {static void}
+ */
+static void ts_udp_sink_disconnect(MediaSink *sink) {
+    TsUdpSinkImpl *impl = (TsUdpSinkImpl *)sink->impl;
+
+    if (!impl) {
+        return;
+    }
+    pthread_mutex_lock(&impl->mux_lock);
+    if (impl->fd < 0) {
+        pthread_mutex_unlock(&impl->mux_lock);
+        return;
+    }
+    printf("[TS] event=disconnect dest=%s:%d frames=%" PRIu64 " datagrams=%" PRIu64 " errors=%" PRIu64 "\n",
+           impl->config.dest_ip,
+           impl->config.dest_port,
+           impl->muxer.frames,
+           impl->egress.packets,
+           impl->egress.errors);
+    close(impl->fd);
+    impl->fd = -1;
+    impl->egress.target_ready = 0;
+    impl->egress.remote_ip[0] = '\0';
+    impl->ring_fill = 0;
+    impl->clock_base_us = 0;
+    pthread_mutex_unlock(&impl->mux_lock);
+}
+
+/**
+ * @description: 停止通道，释放发送器资源
+ * @param {MediaSink *} sink
+ * @return {static void}
+ */
+static void ts_udp_sink_stop(MediaSink *sink) {
+    TsUdpSinkImpl *impl = (TsUdpSinkImpl *)sink->impl;
+
+    if (!impl) {
+        return;
+    }
+    if (impl->clock_running) {
+        impl->clock_stop = 1;
+        pthread_join(impl->clock_thread, NULL);
+        impl->clock_running = 0;
+    }
+    ts_udp_sink_disconnect(sink);
+    media_rtp_egress_deinit(&impl->egress);
+}
+
+/**
+ * @description: 周期统计中打印 TS 封装和发送的细分统计
+ * @param {MediaSink *} sink
+ * @return {static void}
+ */
+static void ts_udp_sink_log_stats(MediaSink *sink) {
+    TsUdpSinkStats stats;
+
+    if (ts_udp_sink_get_stats(sink, &stats) != 0) {
+        return;
+    }
+    printf("[TS] event=sink_stats name=%s frames=%" PRIu64 " ts_packets=%" PRIu64 " psi_packets=%" PRIu64
+           " datagrams=%" PRIu64 " bytes=%" PRIu64 " syscalls=%" PRIu64 " errors=%" PRIu64 "\n",
+           sink->config.name ? sink->config.name : "unknown",
+           stats.frames,
+           stats.ts_packets,
+           stats.psi_packets,
+           stats.datagrams,
+           stats.bytes_sent,
+           stats.syscalls,
+           stats.send_errors);
+}
+
+int ts_udp_sink_get_stats(MediaSink *sink, TsUdpSinkStats *stats) {
+    TsUdpSinkImpl *impl;
+
+    if (!sink || !sink->impl || !stats) {
+        return -1;
+    }
+    impl = (TsUdpSinkImpl *)sink->impl;
+    pthread_mutex_lock(&impl->lock);
+    *stats = impl->stats;
+    pthread_mutex_unlock(&impl->lock);
+    return 0;
+}
+
+/**
+ * @description: 记录新的码率/帧率，由发送线程在下一帧更新平滑器
+ * @param {MediaSink *} sink
+ * @param {int} bitrate
+ * @param {int} fps
+ * @return {void}
+ */
+void ts_udp_sink_update_rate(MediaSink *sink, int bitrate, int fps) {
+    TsUdpSinkImpl *impl;
+
+    if (!sink || !sink->impl || bitrate <= 0 || fps <= 0) {
+        return;
+    }
+    impl = (TsUdpSinkImpl *)sink->impl;
+    pthread_mutex_lock(&impl->lock);
+    impl->pending_bitrate = bitrate;
+    impl->pending_fps = fps;
+    pthread_mutex_unlock(&impl->lock);
+}
+
+/**
+ * @description: 根据配置创建 TS over UDP 输出通道
+ * @param {MediaSink *} sink
+ * @param {const TsUdpSinkConfig *} config
+ * @return {int}
+ */
+int ts_udp_sink_setup(MediaSink *sink, const TsUdpSinkConfig *config) {
+    static const MediaSinkVTable vtable = {
+        ts_udp_sink_start,
+        ts_udp_sink_connect,
+        ts_udp_sink_send_packet,
+        ts_udp_sink_disconnect,
+        ts_udp_sink_stop,
+        NULL,
+        ts_udp_sink_log_stats
+    };
+    MediaSinkConfig sink_config;
+    MediaRtpPacerConfig pacing;
+    TsUdpSinkImpl *impl;
+
+    if (!sink) {
+        fprintf(stderr, "[TS][ERROR] sink_setup failed: sink is NULL\n");
+        return -1;
+    }
+
+    impl = (TsUdpSinkImpl *)calloc(1, sizeof(*impl));
+    if (!impl) {
+        fprintf(stderr, "[TS][ERROR] sink_setup failed: impl alloc\n");
+        return -1;
+    }
+
+    if (config) {
+        impl->config = *config;
+    }
+    if (!impl->config.name) {
+        impl->config.name = DEFAULT_TS_UDP_NAME;
+    }
+    if (impl->config.queue_capacity <= 0) {
+        impl->config.queue_capacity = DEFAULT_TS_UDP_QUEUE_CAPACITY;
+    }
+    if (impl->config.multicast_ttl <= 0) {
+        impl->config.multicast_ttl = DEFAULT_TS_UDP_TTL;
+    }
+    if (impl->config.packets_per_datagram <= 0 || impl->config.packets_per_datagram > TS_PACKETS_PER_DATAGRAM) {
+        impl->config.packets_per_datagram = TS_PACKETS_PER_DATAGRAM;
+    }
+    impl->fd = -1;
+    pthread_mutex_init(&impl->lock, NULL);
+    pthread_mutex_init(&impl->mux_lock, NULL);
+    ts_muxer_init(&impl->muxer);
+    media_rtp_egress_init(&impl->egress, impl->config.gso);
+    memset(&pacing, 0, sizeof(pacing));
+    pacing.enabled = impl->config.pacing;
+    pacing.rate_percent = impl->config.pacing_rate_percent;
+    pacing.burst_bytes = impl->config.pacing_burst_bytes;
+    pacing.spread_percent = impl->config.pacing_spread_percent;
+    media_rtp_pacer_fill_default(&pacing);
+    media_rtp_egress_set_pacing(&impl->egress, &pacing, impl->config.video_bitrate, impl->config.video_fps);
+
+    memset(&sink_config, 0, sizeof(sink_config));
+    sink_config.name = impl->config.name;
+    sink_config.queue_capacity = impl->config.queue_capacity;
+    sink_config.reconnect_interval_ms = DEFAULT_TS_UDP_RECONNECT_INTERVAL_MS;
+    /* 接收端从关键帧开始才能解码，重建 socket 后同样等关键帧。 */
+    sink_config.drop_until_keyframe_after_reconnect = 1;
+
+    if (media_sink_init(sink, &sink_config, &vtable, impl) != 0) {
+        fprintf(stderr, "[TS][ERROR] sink_setup failed: media_sink_init name=%s\n", impl->config.name);
+        pthread_mutex_destroy(&impl->lock);
+        pthread_mutex_destroy(&impl->mux_lock);
+        free(impl);
+        return -1;
+    }
+    return 0;
+}
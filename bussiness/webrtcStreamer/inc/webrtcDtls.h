@@ -0,0 +1,140 @@
+#ifndef __WEBRTC_DTLS_H__
+#define __WEBRTC_DTLS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <openssl/ssl.h>
+
+#include "webrtcSrtp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* SDP a=fingerprint 的 sha-256 值："XX:XX:..."，32 字节 * 3。 */
+#define WEBRTC_DTLS_FINGERPRINT_LEN 96
+/* DTLS 记录按这个 MTU 分片，与 RTP 负载上限保持同量级。 */
+#define WEBRTC_DTLS_MTU 1200
+/* 单个 DTLS 数据报的最大长度。 */
+#define WEBRTC_DTLS_DATAGRAM_MAX 2048
+
+/* DTLS 握手成功后导出的 SRTP 主密钥材料（RFC 5764 4.2），按本端/对端拆好。 */
+typedef struct {
+    uint8_t local_key[WEBRTC_SRTP_MASTER_KEY_LEN];   /* 本端发送用主密钥。 */
+    uint8_t local_salt[WEBRTC_SRTP_MASTER_SALT_LEN]; /* 本端发送用主盐。 */
+    uint8_t remote_key[WEBRTC_SRTP_MASTER_KEY_LEN];  /* 对端发送用主密钥。 */
+    uint8_t remote_salt[WEBRTC_SRTP_MASTER_SALT_LEN]; /* 对端发送用主盐。 */
+} WebrtcDtlsSrtpKeys;
+
+/* 本端 DTLS 身份：自签名 ECDSA P-256 证书，进程内所有对端共用。 */
+typedef struct {
+    SSL_CTX *ctx;                  /* DTLS 1.2 上下文，已配置 use_srtp 和证书。 */
+    EVP_PKEY *key;                 /* 私钥。 */
+    X509 *cert;                    /* 自签名证书。 */
+    char fingerprint[WEBRTC_DTLS_FINGERPRINT_LEN + 1]; /* 证书 sha-256 指纹，写进 SDP answer。 */
+} WebrtcDtlsIdentity;
+
+/**
+ * @description: DTLS 出包回调，一次调用对应一个 UDP 数据报。
+ * @param {void *} opaque 创建会话时传入的上下文。
+ * @param {const uint8_t *} data 数据报。
+ * @param {size_t} len 长度。
+ * @return {void}
+ */
+typedef void (*WebrtcDtlsSendFn)(void *opaque, const uint8_t *data, size_t len);
+
+/* 单个对端的 DTLS 会话，记录层收发通过自定义 BIO 与 UDP 套接字解耦。 */
+typedef struct {
+    SSL *ssl;                      /* OpenSSL 会话。 */
+    int is_server;                 /* 是否为 DTLS 服务端，决定导出密钥时哪一半属于本端。 */
+    WebrtcDtlsSendFn send;         /* 出包回调。 */
+    void *opaque;                  /* 出包回调上下文。 */
+    const uint8_t *rx_data;        /* 正在喂入的数据报，BIO 读一次后清空。 */
+    size_t rx_len;                 /* rx_data 长度。 */
+    char expected_fingerprint[WEBRTC_DTLS_FINGERPRINT_LEN + 1]; /* SDP 里对端声明的指纹。 */
+    int connected;                 /* 握手是否完成且指纹校验通过。 */
+    int failed;                    /* 握手是否失败。 */
+} WebrtcDtlsSession;
+
+/**
+ * @description: 生成本端 DTLS 身份（密钥、自签名证书、SSL_CTX），只启用 SRTP_AES128_CM_SHA1_80。
+ * @param {WebrtcDtlsIdentity *} identity 输出。
+ * @return {int} 0 成功，-1 失败。
+ */
+int webrtc_dtls_identity_init(WebrtcDtlsIdentity *identity);
+
+/**
+ * @description: 释放本端 DTLS 身份，可重复调用。
+ * @param {WebrtcDtlsIdentity *} identity 身份。
+ * @return {void}
+ */
+void webrtc_dtls_identity_deinit(WebrtcDtlsIdentity *identity);
+
+/**
+ * @description: 创建一个 DTLS 会话。
+ * @param {WebrtcDtlsSession *} session 输出。
+ * @param {const WebrtcDtlsIdentity *} identity 本端身份。
+ * @param {int} is_server 1 作为 DTLS 服务端（SDP setup:passive），0 作为客户端（setup:active）。
+ * @param {const char *} expected_fingerprint 对端 sha-256 指纹。
+ * @param {WebrtcDtlsSendFn} send 出包回调。
+ * @param {void *} opaque 回调上下文。
+ * @return {int} 0 成功，-1 失败。
+ */
+int webrtc_dtls_session_init(WebrtcDtlsSession *session,
+                             const WebrtcDtlsIdentity *identity,
+                             int is_server,
+                             const char *expected_fingerprint,
+                             WebrtcDtlsSendFn send,
+                             void *opaque);
+
+/**
+ * @description: 释放 DTLS 会话，可重复调用。
+ * @param {WebrtcDtlsSession *} session 会话。
+ * @return {void}
+ */
+void webrtc_dtls_session_deinit(WebrtcDtlsSession *session);
+
+/**
+ * @description: 推进握手：客户端首次调用时发出 ClientHello；data 非空时先把收到的数据报喂给会话。
+ * @param {WebrtcDtlsSession *} session 会话。
+ * @param {const uint8_t *} data 收到的 DTLS 数据报，可为 NULL。
+ * @param {size_t} len 长度。
+ * @return {int} 1 本次调用中握手完成，0 仍在进行或已完成，-1 握手失败、指纹不符或对端已关闭。
+ */
+int webrtc_dtls_session_feed(WebrtcDtlsSession *session, const uint8_t *data, size_t len);
+
+/**
+ * @description: 处理握手重传定时器。
+ * @param {WebrtcDtlsSession *} session 会话。
+ * @return {int} 0 正常，-1 重传次数耗尽。
+ */
+int webrtc_dtls_session_on_timer(WebrtcDtlsSession *session);
+
+/**
+ * @description: 查询下一次重传定时器到期的剩余时间。
+ * @param {WebrtcDtlsSession *} session 会话。
+ * @return {int} 毫秒数，-1 表示没有待处理的定时器。
+ */
+int webrtc_dtls_session_timeout_ms(WebrtcDtlsSession *session);
+
+/**
+ * @description: 握手完成后按 RFC 5764 导出 SRTP 主密钥材料。
+ * @param {WebrtcDtlsSession *} session 已连接的会话。
+ * @param {WebrtcDtlsSrtpKeys *} keys 输出。
+ * @return {int} 0 成功，-1 失败。
+ */
+int webrtc_dtls_session_export_srtp(WebrtcDtlsSession *session, WebrtcDtlsSrtpKeys *keys);
+
+/**
+ * @description: 发送 close_notify 告知对端会话结束。
+ * @param {WebrtcDtlsSession *} session 会话。
+ * @return {void}
+ */
+void webrtc_dtls_session_shutdown(WebrtcDtlsSession *session);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
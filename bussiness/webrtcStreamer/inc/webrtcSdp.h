@@ -0,0 +1,96 @@
+#ifndef __WEBRTC_SDP_H__
+#define __WEBRTC_SDP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "webrtcDtls.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* offer 里最多处理的 m= 行数，多出的行整体拒绝。 */
+#define WEBRTC_SDP_MAX_MEDIA 8
+/* ICE 凭据长度上限（RFC 8839：ufrag 4~256 字符，pwd 22~256 字符，这里按常见实现收紧）。 */
+#define WEBRTC_SDP_ICE_UFRAG_MAX 64
+#define WEBRTC_SDP_ICE_PWD_MAX 128
+#define WEBRTC_SDP_TOKEN_MAX 32
+#define WEBRTC_SDP_FMTP_MAX 256
+/* answer 的最大长度。 */
+#define WEBRTC_SDP_ANSWER_MAX 4096
+
+/* offer 里的 a=setup 取值（RFC 4145）。 */
+typedef enum {
+    WEBRTC_SDP_SETUP_ACTPASS = 0,
+    WEBRTC_SDP_SETUP_ACTIVE,
+    WEBRTC_SDP_SETUP_PASSIVE,
+} WebrtcSdpSetup;
+
+/* offer 里的一条 m= 行，answer 需要逐行对应。 */
+typedef struct {
+    char kind[WEBRTC_SDP_TOKEN_MAX];          /* 媒体类型：video/audio/application。 */
+    char protocol[WEBRTC_SDP_TOKEN_MAX];      /* 传输协议，如 UDP/TLS/RTP/SAVPF。 */
+    char first_format[WEBRTC_SDP_TOKEN_MAX];  /* 第一个格式，拒绝该行时原样带回。 */
+    char mid[WEBRTC_SDP_TOKEN_MAX];           /* a=mid，没有时为空串。 */
+} WebrtcSdpMedia;
+
+typedef struct {
+    char ice_ufrag[WEBRTC_SDP_ICE_UFRAG_MAX];        /* 对端 ice-ufrag。 */
+    char ice_pwd[WEBRTC_SDP_ICE_PWD_MAX];            /* 对端 ice-pwd。 */
+    char fingerprint[WEBRTC_DTLS_FINGERPRINT_LEN + 1]; /* 对端 DTLS 证书 sha-256 指纹。 */
+    WebrtcSdpSetup setup;                            /* 对端 DTLS 角色意向。 */
+    WebrtcSdpMedia media[WEBRTC_SDP_MAX_MEDIA];      /* 所有 m= 行。 */
+    int media_count;                                 /* m= 行数。 */
+    int video_index;                                 /* 选中的视频 m= 行下标。 */
+    int h264_pt;                                     /* 选中的 H264 负载类型。 */
+    char h264_fmtp[WEBRTC_SDP_FMTP_MAX];             /* 该负载类型的 fmtp 参数，answer 原样带回。 */
+    int nack;                                        /* 对端是否支持 rtcp-fb nack。 */
+    int pli;                                         /* 对端是否支持 rtcp-fb nack pli。 */
+    int fir;                                         /* 对端是否支持 rtcp-fb ccm fir。 */
+} WebrtcSdpOffer;
+
+/* 生成 answer 需要的本端参数。 */
+typedef struct {
+    const char *ice_ufrag;         /* 本端 ice-ufrag。 */
+    const char *ice_pwd;           /* 本端 ice-pwd。 */
+    const char *fingerprint;       /* 本端证书指纹。 */
+    const char *candidate_ip;      /* host 候选地址。 */
+    uint16_t candidate_port;       /* host 候选端口（媒体 UDP 端口）。 */
+    uint32_t ssrc;                 /* 视频 SSRC。 */
+    const char *stream_name;       /* 流名，用作 msid 和 cname。 */
+    uint64_t session_id;           /* o= 行的会话 ID。 */
+} WebrtcSdpAnswerParams;
+
+/**
+ * @description: 解析 WHEP offer，选出第一条视频 m= 行里最合适的 H264 负载类型：
+ *               packetization-mode=1 优先，其次 profile_idc 与码流一致。
+ * @param {const char *} sdp offer 文本（以 '\0' 结尾）。
+ * @param {int} profile_idc 码流 SPS 的 profile_idc，未知时传 0。
+ * @param {WebrtcSdpOffer *} offer 输出。
+ * @return {int} 0 成功，-1 缺少 ICE/DTLS 参数或没有可用的 H264 视频。
+ */
+int webrtc_sdp_parse_offer(const char *sdp, int profile_idc, WebrtcSdpOffer *offer);
+
+/**
+ * @description: DTLS 角色协商：对端 passive 时本端主动发起握手，否则本端作为服务端等待。
+ * @param {const WebrtcSdpOffer *} offer 已解析的 offer。
+ * @return {int} 1 本端为 DTLS 服务端（setup:passive），0 为客户端（setup:active）。
+ */
+int webrtc_sdp_answer_is_dtls_server(const WebrtcSdpOffer *offer);
+
+/**
+ * @description: 生成 answer：视频 m= 行 sendonly + rtcp-mux + BUNDLE，ice-lite 单 host 候选，其余 m= 行拒绝。
+ * @param {const WebrtcSdpOffer *} offer 已解析的 offer。
+ * @param {const WebrtcSdpAnswerParams *} params 本端参数。
+ * @param {char *} buf 输出缓冲，至少 WEBRTC_SDP_ANSWER_MAX 字节。
+ * @param {size_t} cap 缓冲大小。
+ * @return {int} answer 长度，-1 缓冲不足。
+ */
+int webrtc_sdp_build_answer(const WebrtcSdpOffer *offer, const WebrtcSdpAnswerParams *params, char *buf, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
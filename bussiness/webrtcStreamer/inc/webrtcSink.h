@@ -0,0 +1,85 @@
+#ifndef __WEBRTC_SINK_H__
+#define __WEBRTC_SINK_H__
+
+#include <stdint.h>
+
+#include "mediaSink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char *name;          /* sink 名称，用于日志和统计信息。 */
+    const char *listen_ip;     /* HTTP 和媒体 UDP 的监听地址，默认 0.0.0.0。 */
+    int http_port;             /* WHEP 信令 HTTP 端口，默认 8090。 */
+    int media_port;            /* 所有对端共用的媒体 UDP 端口（STUN/DTLS/SRTP/SRTCP 复用），默认 8092。 */
+    const char *announce_ip;   /* 写进 ICE host 候选的地址，空时取监听地址或第一块非回环网卡。 */
+    const char *stream_name;   /* 信令路径 /whep/<stream_name> 中的流名。 */
+    int queue_capacity;        /* 编码线程到服务线程之间的帧队列容量。 */
+    int max_peers;             /* 同时存在的最大 WebRTC 会话数，超出时 POST 回 503。 */
+    int rtp_max_payload;       /* 单个 RTP 包负载上限，加上 SRTP 开销后不超过常见路径 MTU。 */
+    int nack_history_ms;       /* NACK 重传历史覆盖的时长，0 取默认 1000。 */
+    int rtcp_interval_ms;      /* SRTCP SR 周期，0 取默认 1000，负数不发 SR。 */
+    int gso;                   /* 1 尝试用 UDP GSO 批量发送。 */
+    int video_fps;             /* 码流帧率。 */
+    int video_bitrate;         /* 码流码率，用于估算重传历史缓冲大小。 */
+} WebrtcSinkConfig;
+
+typedef struct {
+    int peers;                 /* 当前存在的会话数（含握手中）。 */
+    int connected_peers;       /* 其中 DTLS-SRTP 已建立的会话数。 */
+    uint64_t offers;           /* 收到的 WHEP offer 数。 */
+    uint64_t answers;          /* 回了 201 answer 的数量。 */
+    uint64_t rejected_offers;  /* 因流名、SDP 或会话数上限被拒绝的 offer 数。 */
+    uint64_t sessions_deleted; /* 收到 DELETE 结束的会话数。 */
+    uint64_t stun_requests;    /* 收到并通过校验的 STUN Binding 请求数。 */
+    uint64_t stun_rejects;     /* 用户名或 MESSAGE-INTEGRITY 校验失败的 STUN 请求数。 */
+    uint64_t dtls_handshakes;  /* 完成的 DTLS 握手数。 */
+    uint64_t dtls_failures;    /* 失败的 DTLS 握手数（含指纹不符）。 */
+    uint64_t setup_timeouts;   /* 在 ICE/DTLS 阶段超时关闭的会话数。 */
+    uint64_t consent_timeouts; /* 连接后长时间收不到 STUN 心跳而关闭的会话数。 */
+    uint64_t frames;           /* 发给至少一个对端的视频帧数。 */
+    uint64_t rtp_packets;      /* 发给所有对端的 SRTP 包数（含重传）。 */
+    uint64_t srtp_bytes;       /* 发给所有对端的 SRTP 字节数。 */
+    uint64_t nack_requested;   /* NACK 请求重传的序号总数。 */
+    uint64_t retransmitted;    /* 已重传的包数。 */
+    uint64_t nack_too_late;    /* 请求的包已不在历史里的次数。 */
+    uint64_t pli;              /* 收到的 PLI 数。 */
+    uint64_t fir;              /* 收到的 FIR 数。 */
+    uint64_t idr_requests;     /* 向上游请求 IDR 的次数（新连接、PLI、FIR）。 */
+    uint64_t srtcp_errors;     /* 解保护失败的 SRTCP 报文数。 */
+    uint64_t sr_sent;          /* 发出的 SRTCP SR 数。 */
+} WebrtcSinkStats;
+
+/**
+ * @description: 创建 WebRTC 输出通道：内置单线程 epoll 服务，HTTP 端口提供 WHEP 信令（POST offer / DELETE 会话），
+ *               媒体走单个 UDP 端口按首字节区分 STUN、DTLS 和 SRTP/SRTCP（ICE-lite、BUNDLE、rtcp-mux）。
+ *               每帧只打包一次并写进共享重传历史，逐对端用各自的 SRTP 密钥加密后批量发送；
+ *               支持 NACK 重传、PLI/FIR 请求关键帧和 SRTCP 发送报告。
+ * @param {MediaSink *} sink 输出通道。
+ * @param {const WebrtcSinkConfig *} config 配置。
+ * @return {int} 0 成功，-1 失败。
+ */
+int webrtc_sink_setup(MediaSink *sink, const WebrtcSinkConfig *config);
+
+/**
+ * @description: 获取 WebRTC 输出通道的运行统计。
+ * @param {MediaSink *} sink 由 webrtc_sink_setup 创建的通道。
+ * @param {WebrtcSinkStats *} stats 输出统计。
+ * @return {int} 0 成功，-1 参数非法。
+ */
+int webrtc_sink_get_stats(MediaSink *sink, WebrtcSinkStats *stats);
+
+/**
+ * @description: 取走待处理的关键帧请求（新会话建立、PLI、FIR），同一批请求只返回一次。
+ * @param {MediaSink *} sink 由 webrtc_sink_setup 创建的通道。
+ * @return {int} 1 有请求，0 没有。
+ */
+int webrtc_sink_consume_external_idr_request(MediaSink *sink);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef __WEBRTC_SRTP_H__
+#define __WEBRTC_SRTP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* SRTP_AES128_CM_HMAC_SHA1_80（RFC 3711 / RFC 5764）的主密钥、主盐和认证标签长度。 */
+#define WEBRTC_SRTP_MASTER_KEY_LEN 16
+#define WEBRTC_SRTP_MASTER_SALT_LEN 14
+#define WEBRTC_SRTP_AUTH_KEY_LEN 20
+#define WEBRTC_SRTP_AUTH_TAG_LEN 10
+/* SRTCP 尾部：E 标志 + 31 位 SRTCP 序号，再加认证标签。 */
+#define WEBRTC_SRTCP_TRAILER_LEN (4 + WEBRTC_SRTP_AUTH_TAG_LEN)
+/* 保护后报文最多增加的字节数，调用方按它预留缓冲。 */
+#define WEBRTC_SRTP_MAX_OVERHEAD WEBRTC_SRTCP_TRAILER_LEN
+
+/* RFC 3711 4.3.1 密钥派生标签。 */
+#define WEBRTC_SRTP_LABEL_RTP_ENCRYPTION 0x00
+#define WEBRTC_SRTP_LABEL_RTP_AUTH 0x01
+#define WEBRTC_SRTP_LABEL_RTP_SALT 0x02
+#define WEBRTC_SRTP_LABEL_RTCP_ENCRYPTION 0x03
+#define WEBRTC_SRTP_LABEL_RTCP_AUTH 0x04
+#define WEBRTC_SRTP_LABEL_RTCP_SALT 0x05
+
+typedef struct {
+    EVP_CIPHER_CTX *cipher;        /* 会话加密密钥的 AES-128-CTR，密钥扩展只做一次，逐包只换 IV。 */
+    HMAC_CTX *hmac;                /* 会话认证密钥的 HMAC-SHA1，逐包复用同一密钥。 */
+    uint8_t salt[WEBRTC_SRTP_MASTER_SALT_LEN]; /* 会话盐。 */
+} WebrtcSrtpKeys;
+
+/* 一个方向（发送或接收）的 SRTP/SRTCP 密码上下文，只处理一个 RTP SSRC。 */
+typedef struct {
+    WebrtcSrtpKeys rtp;            /* SRTP 会话密钥。 */
+    WebrtcSrtpKeys rtcp;           /* SRTCP 会话密钥。 */
+    int rtp_started;               /* 是否已处理过 RTP 包，ROC 从第一个包开始计。 */
+    uint32_t roc;                  /* 序号回绕计数（RFC 3711 ROC）。 */
+    uint16_t highest_seq;          /* 已处理的最大序号 s_l。 */
+    uint32_t srtcp_index;          /* 下一个发出的 SRTCP 序号。 */
+    uint64_t auth_failures;        /* 解保护时认证失败的次数。 */
+} WebrtcSrtpContext;
+
+/**
+ * @description: 按 RFC 3711 4.3 从主密钥/主盐派生一把会话密钥（KDR 为 0）。
+ * @param {const uint8_t *} master_key 16 字节主密钥。
+ * @param {const uint8_t *} master_salt 14 字节主盐。
+ * @param {uint8_t} label 派生标签 WEBRTC_SRTP_LABEL_*。
+ * @param {uint8_t *} out 输出。
+ * @param {size_t} out_len 输出长度。
+ * @return {int} 0 成功，-1 失败。
+ */
+int webrtc_srtp_derive(const uint8_t *master_key, const uint8_t *master_salt, uint8_t label, uint8_t *out, size_t out_len);
+
+/**
+ * @description: 用 DTLS-SRTP 导出的主密钥/主盐初始化一个方向的密码上下文。
+ * @param {WebrtcSrtpContext *} ctx 上下文。
+ * @param {const uint8_t *} master_key 16 字节主密钥。
+ * @param {const uint8_t *} master_salt 14 字节主盐。
+ * @return {int} 0 成功，-1 失败（已释放部分资源）。
+ */
+int webrtc_srtp_init(WebrtcSrtpContext *ctx, const uint8_t *master_key, const uint8_t *master_salt);
+
+/**
+ * @description: 释放密码上下文，可重复调用。
+ * @param {WebrtcSrtpContext *} ctx 上下文。
+ * @return {void}
+ */
+void webrtc_srtp_deinit(WebrtcSrtpContext *ctx);
+
+/**
+ * @description: 原地加密一个 RTP 包并追加认证标签。重传的旧序号按 RFC 3711 3.3.1 推算所在 ROC。
+ * @param {WebrtcSrtpContext *} ctx 发送方向上下文。
+ * @param {uint8_t *} packet RTP 包，固定头、CSRC 和扩展头之后的负载被原地加密。
+ * @param {size_t} len RTP 包长度。
+ * @param {size_t} cap 缓冲容量，至少 len + WEBRTC_SRTP_AUTH_TAG_LEN。
+ * @return {int} SRTP 包长度，-1 参数错误。
+ */
+int webrtc_srtp_protect_rtp(WebrtcSrtpContext *ctx, uint8_t *packet, size_t len, size_t cap);
+
+/**
+ * @description: 校验并原地解密一个 SRTP 包。
+ * @param {WebrtcSrtpContext *} ctx 接收方向上下文。
+ * @param {uint8_t *} packet SRTP 包。
+ * @param {size_t} len 长度。
+ * @return {int} RTP 包长度，-1 格式错误或认证失败。
+ */
+int webrtc_srtp_unprotect_rtp(WebrtcSrtpContext *ctx, uint8_t *packet, size_t len);
+
+/**
+ * @description: 原地加密一个 RTCP 复合包，追加 E 标志/SRTCP 序号和认证标签。
+ * @param {WebrtcSrtpContext *} ctx 发送方向上下文。
+ * @param {uint8_t *} packet RTCP 复合包。
+ * @param {size_t} len 长度。
+ * @param {size_t} cap 缓冲容量，至少 len + WEBRTC_SRTCP_TRAILER_LEN。
+ * @return {int} SRTCP 包长度，-1 参数错误。
+ */
+int webrtc_srtp_protect_rtcp(WebrtcSrtpContext *ctx, uint8_t *packet, size_t len, size_t cap);
+
+/**
+ * @description: 校验并原地解密一个 SRTCP 包。
+ * @param {WebrtcSrtpContext *} ctx 接收方向上下文。
+ * @param {uint8_t *} packet SRTCP 包。
+ * @param {size_t} len 长度。
+ * @return {int} RTCP 复合包长度，-1 格式错误或认证失败。
+ */
+int webrtc_srtp_unprotect_rtcp(WebrtcSrtpContext *ctx, uint8_t *packet, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
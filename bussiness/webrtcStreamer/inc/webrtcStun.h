@@ -0,0 +1,103 @@
+#ifndef __WEBRTC_STUN_H__
+#define __WEBRTC_STUN_H__
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* STUN 头长度和 magic cookie（RFC 5389）。 */
+#define WEBRTC_STUN_HEADER 20
+#define WEBRTC_STUN_MAGIC_COOKIE 0x2112A442U
+#define WEBRTC_STUN_TRANSACTION_ID_LEN 12
+/* 消息类型：Binding 请求、成功响应。 */
+#define WEBRTC_STUN_BINDING_REQUEST 0x0001
+#define WEBRTC_STUN_BINDING_SUCCESS 0x0101
+/* USERNAME 最大长度，ICE 里是 "对端ufrag:本端ufrag"。 */
+#define WEBRTC_STUN_USERNAME_MAX 256
+/* 本模块生成的 STUN 报文最大长度。 */
+#define WEBRTC_STUN_MAX 512
+
+typedef struct {
+    uint16_t type;                                         /* 消息类型。 */
+    uint8_t transaction_id[WEBRTC_STUN_TRANSACTION_ID_LEN]; /* 事务 ID，响应原样带回。 */
+    char username[WEBRTC_STUN_USERNAME_MAX];               /* USERNAME 属性，没有时为空串。 */
+    int use_candidate;                                     /* 是否带 USE-CANDIDATE（控制方提名该路径）。 */
+    uint32_t priority;                                     /* PRIORITY 属性，没有时为 0。 */
+    size_t integrity_offset;                               /* MESSAGE-INTEGRITY 属性的偏移，0 表示没有。 */
+    struct sockaddr_in mapped;                             /* XOR-MAPPED-ADDRESS，响应里才有。 */
+    int has_mapped;                                        /* mapped 是否有效。 */
+} WebrtcStunMessage;
+
+/**
+ * @description: 按 RFC 7983 判断 UDP 数据报是否是 STUN：首字节 0~3 且带 magic cookie。
+ * @param {const uint8_t *} buf 数据报。
+ * @param {size_t} len 长度。
+ * @return {int} 1 是，0 不是。
+ */
+int webrtc_stun_is_message(const uint8_t *buf, size_t len);
+
+/**
+ * @description: 解析 STUN 报文，带 FINGERPRINT 时同时校验 CRC。
+ * @param {const uint8_t *} buf 报文。
+ * @param {size_t} len 长度。
+ * @param {WebrtcStunMessage *} msg 输出。
+ * @return {int} 0 成功，-1 格式错误或 FINGERPRINT 不符。
+ */
+int webrtc_stun_parse(const uint8_t *buf, size_t len, WebrtcStunMessage *msg);
+
+/**
+ * @description: 用短期凭据（ICE 密码）校验 MESSAGE-INTEGRITY。
+ * @param {const uint8_t *} buf 报文。
+ * @param {size_t} len 长度。
+ * @param {const WebrtcStunMessage *} msg 已解析的报文。
+ * @param {const char *} password 校验用的 ice-pwd：请求用本端密码，响应用对端密码。
+ * @return {int} 1 通过，0 缺少或不符。
+ */
+int webrtc_stun_check_integrity(const uint8_t *buf, size_t len, const WebrtcStunMessage *msg, const char *password);
+
+/**
+ * @description: 生成 Binding 成功响应：XOR-MAPPED-ADDRESS + MESSAGE-INTEGRITY + FINGERPRINT。
+ * @param {uint8_t *} buf 输出缓冲，至少 WEBRTC_STUN_MAX 字节。
+ * @param {size_t} cap 缓冲大小。
+ * @param {const uint8_t *} transaction_id 请求的事务 ID。
+ * @param {const struct sockaddr_in *} mapped 请求的源地址。
+ * @param {const char *} password 本端 ice-pwd。
+ * @return {int} 报文长度，-1 缓冲不足。
+ */
+int webrtc_stun_build_binding_response(uint8_t *buf,
+                                       size_t cap,
+                                       const uint8_t *transaction_id,
+                                       const struct sockaddr_in *mapped,
+                                       const char *password);
+
+/**
+ * @description: 生成 ICE 连通性检查用的 Binding 请求（控制方）：USERNAME、PRIORITY、ICE-CONTROLLING、
+ *               可选 USE-CANDIDATE，最后是 MESSAGE-INTEGRITY + FINGERPRINT。
+ * @param {uint8_t *} buf 输出缓冲，至少 WEBRTC_STUN_MAX 字节。
+ * @param {size_t} cap 缓冲大小。
+ * @param {const uint8_t *} transaction_id 事务 ID。
+ * @param {const char *} username "对端ufrag:本端ufrag"。
+ * @param {const char *} password 对端 ice-pwd。
+ * @param {uint32_t} priority 候选优先级。
+ * @param {uint64_t} tie_breaker ICE 角色冲突裁决值。
+ * @param {int} use_candidate 是否提名。
+ * @return {int} 报文长度，-1 缓冲不足。
+ */
+int webrtc_stun_build_binding_request(uint8_t *buf,
+                                      size_t cap,
+                                      const uint8_t *transaction_id,
+                                      const char *username,
+                                      const char *password,
+                                      uint32_t priority,
+                                      uint64_t tie_breaker,
+                                      int use_candidate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,460 @@
+#include "webrtcDtls.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include <openssl/bio.h>
+#include <openssl/ec.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/x509.h>
+
+#define DTLS_SRTP_PROFILE "SRTP_AES128_CM_SHA1_80"
+#define DTLS_SRTP_EXPORTER_LABEL "EXTRACTOR-dtls_srtp"
+#define DTLS_SRTP_MATERIAL_LEN (2 * (WEBRTC_SRTP_MASTER_KEY_LEN + WEBRTC_SRTP_MASTER_SALT_LEN))
+#define DTLS_CERT_DAYS 30
+#define DTLS_CERT_CN "RKMediaGateway"
+
+static BIO_METHOD *g_dtls_bio_method = NULL;
+static pthread_once_t g_dtls_bio_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @description: BIO 写：每次写入就是一个完整的 DTLS 数据报，交给会话的出包回调
+ * @param {BIO *} bio
+ * @param {const char *} data
+ * @param {int} len
+ * @return {static int}
+ */
+static int dtls_bio_write(BIO *bio, const char *data, int len) {
+    WebrtcDtlsSession *session = (WebrtcDtlsSession *)BIO_get_data(bio);
+
+    BIO_clear_retry_flags(bio);
+    if (!session || len <= 0) {
+        return len <= 0 ? 0 : -1;
+    }
+    if (session->send) {
+        session->send(session->opaque, (const uint8_t *)data, (size_t)len);
+    }
+    return len;
+}
+
+/**
+ * @description: BIO 读：返回当前正在喂入的数据报，没有时要求重试
+ * @param {BIO *} bio
+ * @param {char *} data
+ * @param {int} len
+ * @return {static int}
+ */
+static int dtls_bio_read(BIO *bio, char *data, int len) {
+    WebrtcDtlsSession *session = (WebrtcDtlsSession *)BIO_get_data(bio);
+    size_t copy;
+
+    BIO_clear_retry_flags(bio);
+    if (!session || !session->rx_data || len <= 0) {
+        BIO_set_retry_read(bio);
+        return -1;
+    }
+    /* 数据报语义：缓冲不够时截断，剩余部分丢弃。 */
+    copy = session->rx_len < (size_t)len ? session->rx_len : (size_t)len;
+    memcpy(data, session->rx_data, copy);
+    session->rx_data = NULL;
+    session->rx_len = 0;
+    return (int)copy;
+}
+
+/**
+ * @description: BIO 控制：只回答 DTLS 实际会问的几项，MTU 固定为 WEBRTC_DTLS_MTU
+ * @param {BIO *} bio
+ * @param {int} cmd
+ * @param {long} num
+ * @param {void *} ptr
+ * @return {static long}
+ */
+static long dtls_bio_ctrl(BIO *bio, int cmd, long num, void *ptr) {
+    (void)bio;
+    (void)num;
+    (void)ptr;
+    switch (cmd) {
+        case BIO_CTRL_FLUSH:
+            return 1;
+        case BIO_CTRL_DGRAM_QUERY_MTU:
+        case BIO_CTRL_DGRAM_GET_FALLBACK_MTU:
+            return WEBRTC_DTLS_MTU;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @description: BIO 创建
+ * @param {BIO *} bio
+ * @return {static int}
+ */
+static int dtls_bio_create(BIO *bio) {
+    BIO_set_init(bio, 1);
+    BIO_set_data(bio, NULL);
+    return 1;
+}
+
+/**
+ * @description: BIO 销毁，会话由调用方管理，这里不释放
+ * @param {BIO *} bio
+ * @return {static int}
+ */
+static int dtls_bio_destroy(BIO *bio) {
+    if (bio) {
+        BIO_set_data(bio, NULL);
+    }
+    return 1;
+}
+
+/**
+ * @description: 注册自定义 BIO 方法，进程内只做一次
+ * @return {static void}
+ */
+static void dtls_bio_method_init(void) {
+    BIO_METHOD *method = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK, "webrtc dtls");
+
+    if (!method) {
+        return;
+    }
+    BIO_meth_set_write(method, dtls_bio_write);
+    BIO_meth_set_read(method, dtls_bio_read);
+    BIO_meth_set_ctrl(method, dtls_bio_ctrl);
+    BIO_meth_set_create(method, dtls_bio_create);
+    BIO_meth_set_destroy(method, dtls_bio_destroy);
+    g_dtls_bio_method = method;
+}
+
+/**
+ * @description: 证书校验回调：自签名证书无法走 CA 链，真正的校验是握手后的指纹比对
+ * @param {int} preverify_ok
+ * @param {X509_STORE_CTX *} store
+ * @return {static int}
+ */
+static int dtls_verify_callback(int preverify_ok, X509_STORE_CTX *store) {
+    (void)preverify_ok;
+    (void)store;
+    return 1;
+}
+
+/**
+ * @description: 计算证书的 sha-256 指纹，格式 "XX:XX:..."
+ * @param {X509 *} cert
+ * @param {char *} out 至少 WEBRTC_DTLS_FINGERPRINT_LEN + 1 字节
+ * @return {static int} 0 成功，-1 失败
+ */
+static int dtls_cert_fingerprint(X509 *cert, char *out) {
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int md_len = 0;
+    unsigned int i;
+
+    if (!cert || X509_digest(cert, EVP_sha256(), md, &md_len) != 1 || md_len != 32) {
+        return -1;
+    }
+    for (i = 0; i < md_len; ++i) {
+        snprintf(out + i * 3, 4, i + 1 < md_len ? "%02X:" : "%02X", md[i]);
+    }
+    return 0;
+}
+
+/**
+ * @description: 生成 ECDSA P-256 私钥
+ * @return {static EVP_PKEY *} 失败返回 NULL
+ */
+static EVP_PKEY *dtls_generate_key(void) {
+    EVP_PKEY_CTX *pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+    EVP_PKEY *key = NULL;
+
+    if (!pctx) {
+        return NULL;
+    }
+    if (EVP_PKEY_keygen_init(pctx) != 1 || EVP_PKEY_CTX_set_ec_paramgen_curve_nid(pctx, NID_X9_62_prime256v1) != 1 ||
+        EVP_PKEY_keygen(pctx, &key) != 1) {
+        key = NULL;
+    }
+    EVP_PKEY_CTX_free(pctx);
+    return key;
+}
+
+/**
+ * @description: 生成自签名证书
+ * @param {EVP_PKEY *} key
+ * @return {static X509 *} 失败返回 NULL
+ */
+static X509 *dtls_generate_cert(EVP_PKEY *key) {
+    X509 *cert = X509_new();
+    X509_NAME *name;
+    uint32_t serial = 0;
+
+    if (!cert) {
+        return NULL;
+    }
+    if (RAND_bytes((unsigned char *)&serial, sizeof(serial)) != 1) {
+        goto fail;
+    }
+    name = X509_get_subject_name(cert);
+    if (X509_set_version(cert, 2) != 1 || ASN1_INTEGER_set(X509_get_serialNumber(cert), (long)(serial & 0x7FFFFFFFU)) != 1 ||
+        !X509_gmtime_adj(X509_getm_notBefore(cert), -86400L) ||
+        !X509_gmtime_adj(X509_getm_notAfter(cert), (long)DTLS_CERT_DAYS * 86400L) || X509_set_pubkey(cert, key) != 1 ||
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)DTLS_CERT_CN, -1, -1, 0) != 1 ||
+        X509_set_issuer_name(cert, name) != 1 || X509_sign(cert, key, EVP_sha256()) <= 0) {
+        goto fail;
+    }
+    return cert;
+
+fail:
+    X509_free(cert);
+    return NULL;
+}
+
+int webrtc_dtls_identity_init(WebrtcDtlsIdentity *identity) {
+    if (!identity) {
+        return -1;
+    }
+    memset(identity, 0, sizeof(*identity));
+    pthread_once(&g_dtls_bio_once, dtls_bio_method_init);
+    if (!g_dtls_bio_method) {
+        printf("[WEBRTC][ERROR] event=dtls_bio_method_failed\n");
+        return -1;
+    }
+    identity->key = dtls_generate_key();
+    identity->cert = identity->key ? dtls_generate_cert(identity->key) : NULL;
+    if (!identity->cert || dtls_cert_fingerprint(identity->cert, identity->fingerprint) != 0) {
+        printf("[WEBRTC][ERROR] event=dtls_cert_failed\n");
+        goto fail;
+    }
+    identity->ctx = SSL_CTX_new(DTLS_method());
+    if (!identity->ctx || SSL_CTX_set_min_proto_version(identity->ctx, DTLS1_2_VERSION) != 1 ||
+        SSL_CTX_use_certificate(identity->ctx, identity->cert) != 1 ||
+        SSL_CTX_use_PrivateKey(identity->ctx, identity->key) != 1 || SSL_CTX_check_private_key(identity->ctx) != 1 ||
+        SSL_CTX_set_tlsext_use_srtp(identity->ctx, DTLS_SRTP_PROFILE) != 0) {
+        printf("[WEBRTC][ERROR] event=dtls_ctx_failed\n");
+        goto fail;
+    }
+    SSL_CTX_set_verify(identity->ctx, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, dtls_verify_callback);
+    SSL_CTX_set_read_ahead(identity->ctx, 1);
+    return 0;
+
+fail:
+    ERR_clear_error();
+    webrtc_dtls_identity_deinit(identity);
+    return -1;
+}
+
+void webrtc_dtls_identity_deinit(WebrtcDtlsIdentity *identity) {
+    if (!identity) {
+        return;
+    }
+    if (identity->ctx) {
+        SSL_CTX_free(identity->ctx);
+        identity->ctx = NULL;
+    }
+    if (identity->cert) {
+        X509_free(identity->cert);
+        identity->cert = NULL;
+    }
+    if (identity->key) {
+        EVP_PKEY_free(identity->key);
+        identity->key = NULL;
+    }
+    identity->fingerprint[0] = '\0';
+}
+
+int webrtc_dtls_session_init(WebrtcDtlsSession *session,
+                             const WebrtcDtlsIdentity *identity,
+                             int is_server,
+                             const char *expected_fingerprint,
+                             WebrtcDtlsSendFn send,
+                             void *opaque) {
+    BIO *bio;
+
+    if (!session || !identity || !identity->ctx || !expected_fingerprint || !g_dtls_bio_method) {
+        return -1;
+    }
+    memset(session, 0, sizeof(*session));
+    session->is_server = is_server ? 1 : 0;
+    session->send = send;
+    session->opaque = opaque;
+    snprintf(session->expected_fingerprint, sizeof(session->expected_fingerprint), "%s", expected_fingerprint);
+
+    session->ssl = SSL_new(identity->ctx);
+    bio = session->ssl ? BIO_new(g_dtls_bio_method) : NULL;
+    if (!bio) {
+        if (session->ssl) {
+            SSL_free(session->ssl);
+            session->ssl = NULL;
+        }
+        ERR_clear_error();
+        return -1;
+    }
+    BIO_set_data(bio, session);
+    SSL_set_bio(session->ssl, bio, bio);
+    /* 路径 MTU 由 BIO 固定回答，不让 OpenSSL 去探测套接字。 */
+    SSL_set_options(session->ssl, SSL_OP_NO_QUERY_MTU);
+    SSL_set_mtu(session->ssl, WEBRTC_DTLS_MTU);
+    if (session->is_server) {
+        SSL_set_accept_state(session->ssl);
+    } else {
+        SSL_set_connect_state(session->ssl);
+    }
+    return 0;
+}
+
+void webrtc_dtls_session_deinit(WebrtcDtlsSession *session) {
+    if (!session) {
+        return;
+    }
+    if (session->ssl) {
+        SSL_free(session->ssl);
+        session->ssl = NULL;
+    }
+    session->rx_data = NULL;
+    session->rx_len = 0;
+    session->connected = 0;
+}
+
+/**
+ * @description: 握手完成后比对对端证书指纹和 SDP 里声明的是否一致
+ * @param {WebrtcDtlsSession *} session
+ * @return {static int} 0 一致，-1 不一致
+ */
+static int dtls_check_peer_fingerprint(WebrtcDtlsSession *session) {
+    char fingerprint[WEBRTC_DTLS_FINGERPRINT_LEN + 1];
+    X509 *peer = SSL_get_peer_certificate(session->ssl);
+    int ret;
+
+    if (!peer) {
+        return -1;
+    }
+    ret = dtls_cert_fingerprint(peer, fingerprint);
+    X509_free(peer);
+    if (ret != 0 || strcasecmp(fingerprint, session->expected_fingerprint) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int webrtc_dtls_session_feed(WebrtcDtlsSession *session, const uint8_t *data, size_t len) {
+    int ret;
+
+    if (!session || !session->ssl || session->failed) {
+        return -1;
+    }
+    session->rx_data = data;
+    session->rx_len = data ? len : 0;
+    if (!session->connected) {
+        ret = SSL_do_handshake(session->ssl);
+        session->rx_data = NULL;
+        session->rx_len = 0;
+        if (ret == 1) {
+            if (dtls_check_peer_fingerprint(session) != 0) {
+                printf("[WEBRTC][WARN] event=dtls_fingerprint_mismatch\n");
+                session->failed = 1;
+                return -1;
+            }
+            session->connected = 1;
+            return 1;
+        }
+        ret = SSL_get_error(session->ssl, ret);
+        if (ret == SSL_ERROR_WANT_READ || ret == SSL_ERROR_WANT_WRITE) {
+            return 0;
+        }
+        ERR_clear_error();
+        session->failed = 1;
+        return -1;
+    }
+    if (!data) {
+        return 0;
+    }
+    /* 握手后不承载应用数据，这里只让 OpenSSL 处理重传的 Finished 和 close_notify。 */
+    {
+        uint8_t scratch[WEBRTC_DTLS_DATAGRAM_MAX];
+
+        ret = SSL_read(session->ssl, scratch, (int)sizeof(scratch));
+    }
+    session->rx_data = NULL;
+    session->rx_len = 0;
+    if (ret <= 0) {
+        ret = SSL_get_error(session->ssl, ret);
+        if (ret == SSL_ERROR_ZERO_RETURN) {
+            session->failed = 1;
+            return -1;
+        }
+        ERR_clear_error();
+    }
+    return 0;
+}
+
+int webrtc_dtls_session_on_timer(WebrtcDtlsSession *session) {
+    if (!session || !session->ssl || session->failed) {
+        return -1;
+    }
+    if (session->connected) {
+        return 0;
+    }
+    if (DTLSv1_handle_timeout(session->ssl) < 0) {
+        ERR_clear_error();
+        session->failed = 1;
+        return -1;
+    }
+    return 0;
+}
+
+int webrtc_dtls_session_timeout_ms(WebrtcDtlsSession *session) {
+    struct timeval tv;
+
+    if (!session || !session->ssl || session->connected || session->failed) {
+        return -1;
+    }
+    if (DTLSv1_get_timeout(session->ssl, &tv) != 1) {
+        return -1;
+    }
+    return (int)(tv.tv_sec * 1000 + tv.tv_usec / 1000);
+}
+
+int webrtc_dtls_session_export_srtp(WebrtcDtlsSession *session, WebrtcDtlsSrtpKeys *keys) {
+    uint8_t material[DTLS_SRTP_MATERIAL_LEN];
+    const uint8_t *client_key = material;
+    const uint8_t *server_key = material + WEBRTC_SRTP_MASTER_KEY_LEN;
+    const uint8_t *client_salt = material + 2 * WEBRTC_SRTP_MASTER_KEY_LEN;
+    const uint8_t *server_salt = client_salt + WEBRTC_SRTP_MASTER_SALT_LEN;
+    SRTP_PROTECTION_PROFILE *profile;
+
+    if (!session || !session->ssl || !session->connected || !keys) {
+        return -1;
+    }
+    profile = SSL_get_selected_srtp_profile(session->ssl);
+    if (!profile || profile->id != SRTP_AES128_CM_SHA1_80) {
+        printf("[WEBRTC][WARN] event=dtls_srtp_profile_missing\n");
+        return -1;
+    }
+    if (SSL_export_keying_material(session->ssl,
+                                   material,
+                                   sizeof(material),
+                                   DTLS_SRTP_EXPORTER_LABEL,
+                                   strlen(DTLS_SRTP_EXPORTER_LABEL),
+                                   NULL,
+                                   0,
+                                   0) != 1) {
+        ERR_clear_error();
+        return -1;
+    }
+    memcpy(keys->local_key, session->is_server ? server_key : client_key, WEBRTC_SRTP_MASTER_KEY_LEN);
+    memcpy(keys->local_salt, session->is_server ? server_salt : client_salt, WEBRTC_SRTP_MASTER_SALT_LEN);
+    memcpy(keys->remote_key, session->is_server ? client_key : server_key, WEBRTC_SRTP_MASTER_KEY_LEN);
+    memcpy(keys->remote_salt, session->is_server ? client_salt : server_salt, WEBRTC_SRTP_MASTER_SALT_LEN);
+    OPENSSL_cleanse(material, sizeof(material));
+    return 0;
+}
+
+void webrtc_dtls_session_shutdown(WebrtcDtlsSession *session) {
+    if (!session || !session->ssl || !session->connected) {
+        return;
+    }
+    SSL_shutdown(session->ssl);
+    ERR_clear_error();
+}
@@ -0,0 +1,414 @@
+#include "webrtcSdp.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define SDP_LINE_MAX 1024
+#define SDP_MAX_FORMATS 32
+#define SDP_H264_CLOCK "H264/90000"
+
+/* 解析过程中按 (m= 行, 负载类型) 收集的格式信息。 */
+typedef struct {
+    int media;                     /* 所属 m= 行下标。 */
+    int pt;                        /* 负载类型。 */
+    int h264;                      /* rtpmap 是否为 H264/90000。 */
+    char fmtp[WEBRTC_SDP_FMTP_MAX]; /* fmtp 参数。 */
+    int nack;                      /* rtcp-fb nack。 */
+    int pli;                       /* rtcp-fb nack pli。 */
+    int fir;                       /* rtcp-fb ccm fir。 */
+} SdpFormat;
+
+typedef struct {
+    SdpFormat formats[SDP_MAX_FORMATS]; /* 已收集的格式。 */
+    int count;                     /* 格式数。 */
+} SdpFormatTable;
+
+/**
+ * @description: 查找或新建 (media, pt) 对应的格式项
+ * @param {SdpFormatTable *} table
+ * @param {int} media
+ * @param {int} pt
+ * @return {static SdpFormat *} 表满时返回 NULL
+ */
+static SdpFormat *sdp_format_get(SdpFormatTable *table, int media, int pt) {
+    SdpFormat *format;
+    int i;
+
+    for (i = 0; i < table->count; ++i) {
+        if (table->formats[i].media == media && table->formats[i].pt == pt) {
+            return &table->formats[i];
+        }
+    }
+    if (table->count >= SDP_MAX_FORMATS) {
+        return NULL;
+    }
+    format = &table->formats[table->count++];
+    memset(format, 0, sizeof(*format));
+    format->media = media;
+    format->pt = pt;
+    return format;
+}
+
+/**
+ * @description: 拷贝一个以空白结尾的 token
+ * @param {char *} dst
+ * @param {size_t} cap
+ * @param {const char *} src
+ * @return {static const char *} token 之后的位置
+ */
+static const char *sdp_copy_token(char *dst, size_t cap, const char *src) {
+    size_t len = 0;
+
+    while (*src == ' ') {
+        src++;
+    }
+    while (*src && *src != ' ') {
+        if (len + 1 < cap) {
+            dst[len++] = *src;
+        }
+        src++;
+    }
+    dst[len] = '\0';
+    return src;
+}
+
+/**
+ * @description: 解析 "a=xxx:<pt> <rest>" 形式的属性值
+ * @param {const char *} value 冒号之后的部分
+ * @param {const char **} rest 输出：负载类型之后、跳过空格的部分
+ * @return {static int} 负载类型，格式错误返回 -1
+ */
+static int sdp_parse_pt(const char *value, const char **rest) {
+    char *end = NULL;
+    long pt = strtol(value, &end, 10);
+
+    if (end == value || pt < 0 || pt > 127) {
+        return -1;
+    }
+    while (*end == ' ') {
+        end++;
+    }
+    *rest = end;
+    return (int)pt;
+}
+
+/**
+ * @description: 查找 fmtp 里某个参数的值
+ * @param {const char *} fmtp
+ * @param {const char *} key
+ * @param {char *} out
+ * @param {size_t} cap
+ * @return {static int} 1 找到，0 没有
+ */
+static int sdp_fmtp_param(const char *fmtp, const char *key, char *out, size_t cap) {
+    size_t key_len = strlen(key);
+    const char *p = fmtp;
+
+    while (*p) {
+        size_t len = 0;
+
+        while (*p == ' ' || *p == ';') {
+            p++;
+        }
+        if (strncasecmp(p, key, key_len) == 0 && p[key_len] == '=') {
+            p += key_len + 1;
+            while (p[len] && p[len] != ';' && p[len] != ' ') {
+                len++;
+            }
+            if (len >= cap) {
+                len = cap - 1;
+            }
+            memcpy(out, p, len);
+            out[len] = '\0';
+            return 1;
+        }
+        while (*p && *p != ';') {
+            p++;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @description: 给 H264 格式打分：packetization-mode=1 加 2 分（FU-A 分片必需），profile_idc 一致加 1 分
+ * @param {const SdpFormat *} format
+ * @param {int} profile_idc
+ * @return {static int}
+ */
+static int sdp_h264_score(const SdpFormat *format, int profile_idc) {
+    char value[16];
+    int score = 0;
+
+    if (sdp_fmtp_param(format->fmtp, "packetization-mode", value, sizeof(value)) && atoi(value) == 1) {
+        score += 2;
+    }
+    if (profile_idc > 0 && sdp_fmtp_param(format->fmtp, "profile-level-id", value, sizeof(value)) && strlen(value) == 6) {
+        char head[3] = {value[0], value[1], '\0'};
+
+        if ((int)strtol(head, NULL, 16) == profile_idc) {
+            score += 1;
+        }
+    }
+    return score;
+}
+
+/**
+ * @description: 处理一行 a= 属性
+ * @param {WebrtcSdpOffer *} offer
+ * @param {SdpFormatTable *} table
+ * @param {int} media 当前 m= 行下标，会话级为 -1
+ * @param {const char *} attr "a=" 之后的部分
+ * @return {static void}
+ */
+static void sdp_parse_attribute(WebrtcSdpOffer *offer, SdpFormatTable *table, int media, const char *attr) {
+    const char *rest = NULL;
+    SdpFormat *format;
+    int pt;
+
+    /* BUNDLE 下各 m= 行的 ICE/DTLS 参数相同，取第一次出现的值。 */
+    if (strncmp(attr, "ice-ufrag:", 10) == 0) {
+        if (!offer->ice_ufrag[0]) {
+            sdp_copy_token(offer->ice_ufrag, sizeof(offer->ice_ufrag), attr + 10);
+        }
+    } else if (strncmp(attr, "ice-pwd:", 8) == 0) {
+        if (!offer->ice_pwd[0]) {
+            sdp_copy_token(offer->ice_pwd, sizeof(offer->ice_pwd), attr + 8);
+        }
+    } else if (strncasecmp(attr, "fingerprint:sha-256 ", 20) == 0) {
+        if (!offer->fingerprint[0]) {
+            sdp_copy_token(offer->fingerprint, sizeof(offer->fingerprint), attr + 20);
+        }
+    } else if (strncmp(attr, "setup:", 6) == 0) {
+        if (strncmp(attr + 6, "active", 6) == 0) {
+            offer->setup = WEBRTC_SDP_SETUP_ACTIVE;
+        } else if (strncmp(attr + 6, "passive", 7) == 0) {
+            offer->setup = WEBRTC_SDP_SETUP_PASSIVE;
+        } else {
+            offer->setup = WEBRTC_SDP_SETUP_ACTPASS;
+        }
+    } else if (media < 0) {
+        return;
+    } else if (strncmp(attr, "mid:", 4) == 0) {
+        sdp_copy_token(offer->media[media].mid, sizeof(offer->media[media].mid), attr + 4);
+    } else if (strncmp(attr, "rtpmap:", 7) == 0) {
+        pt = sdp_parse_pt(attr + 7, &rest);
+        format = pt >= 0 ? sdp_format_get(table, media, pt) : NULL;
+        if (format) {
+            format->h264 = strncasecmp(rest, SDP_H264_CLOCK, strlen(SDP_H264_CLOCK)) == 0;
+        }
+    } else if (strncmp(attr, "fmtp:", 5) == 0) {
+        pt = sdp_parse_pt(attr + 5, &rest);
+        format = pt >= 0 ? sdp_format_get(table, media, pt) : NULL;
+        if (format) {
+            snprintf(format->fmtp, sizeof(format->fmtp), "%s", rest);
+        }
+    } else if (strncmp(attr, "rtcp-fb:", 8) == 0) {
+        pt = sdp_parse_pt(attr + 8, &rest);
+        format = pt >= 0 ? sdp_format_get(table, media, pt) : NULL;
+        if (!format) {
+            return;
+        }
+        if (strcmp(rest, "nack") == 0) {
+            format->nack = 1;
+        } else if (strcmp(rest, "nack pli") == 0) {
+            format->pli = 1;
+        } else if (strcmp(rest, "ccm fir") == 0) {
+            format->fir = 1;
+        }
+    }
+}
+
+/**
+ * @description: 解析 m= 行
+ * @param {WebrtcSdpMedia *} media
+ * @param {const char *} value "m=" 之后的部分
+ * @return {static void}
+ */
+static void sdp_parse_media(WebrtcSdpMedia *media, const char *value) {
+    char port[WEBRTC_SDP_TOKEN_MAX];
+
+    memset(media, 0, sizeof(*media));
+    value = sdp_copy_token(media->kind, sizeof(media->kind), value);
+    value = sdp_copy_token(port, sizeof(port), value);
+    value = sdp_copy_token(media->protocol, sizeof(media->protocol), value);
+    sdp_copy_token(media->first_format, sizeof(media->first_format), value);
+}
+
+/**
+ * @description: 在第一条带 H264 的视频 m= 行里选出得分最高的负载类型，同分取 offer 里靠前的
+ * @param {WebrtcSdpOffer *} offer
+ * @param {const SdpFormatTable *} table
+ * @param {int} profile_idc
+ * @return {static int} 0 成功，-1 没有可用格式
+ */
+static int sdp_choose_h264(WebrtcSdpOffer *offer, const SdpFormatTable *table, int profile_idc) {
+    const SdpFormat *best = NULL;
+    int best_score = -1;
+    int media;
+    int i;
+
+    for (media = 0; media < offer->media_count && !best; ++media) {
+        if (strcmp(offer->media[media].kind, "video") != 0 || !strstr(offer->media[media].protocol, "SAVPF")) {
+            continue;
+        }
+        for (i = 0; i < table->count; ++i) {
+            const SdpFormat *format = &table->formats[i];
+            int score;
+
+            if (format->media != media || !format->h264) {
+                continue;
+            }
+            score = sdp_h264_score(format, profile_idc);
+            if (score > best_score) {
+                best = format;
+                best_score = score;
+            }
+        }
+    }
+    if (!best) {
+        return -1;
+    }
+    offer->video_index = best->media;
+    offer->h264_pt = best->pt;
+    snprintf(offer->h264_fmtp, sizeof(offer->h264_fmtp), "%s", best->fmtp);
+    offer->nack = best->nack;
+    offer->pli = best->pli;
+    offer->fir = best->fir;
+    return 0;
+}
+
+int webrtc_sdp_parse_offer(const char *sdp, int profile_idc, WebrtcSdpOffer *offer) {
+    SdpFormatTable *table;
+    const char *p = sdp;
+    int media = -1;
+    int ret;
+
+    if (!sdp || !offer) {
+        return -1;
+    }
+    memset(offer, 0, sizeof(*offer));
+    offer->video_index = -1;
+    offer->h264_pt = -1;
+    table = (SdpFormatTable *)calloc(1, sizeof(*table));
+    if (!table) {
+        return -1;
+    }
+    while (*p) {
+        char line[SDP_LINE_MAX];
+        size_t len = strcspn(p, "\r\n");
+        size_t copy = len < sizeof(line) ? len : sizeof(line) - 1;
+
+        memcpy(line, p, copy);
+        line[copy] = '\0';
+        p += len;
+        while (*p == '\r' || *p == '\n') {
+            p++;
+        }
+        if (strncmp(line, "m=", 2) == 0) {
+            if (offer->media_count >= WEBRTC_SDP_MAX_MEDIA) {
+                free(table);
+                return -1;
+            }
+            media = offer->media_count++;
+            sdp_parse_media(&offer->media[media], line + 2);
+        } else if (strncmp(line, "a=", 2) == 0) {
+            sdp_parse_attribute(offer, table, media, line + 2);
+        }
+    }
+    ret = sdp_choose_h264(offer, table, profile_idc);
+    free(table);
+    if (ret != 0 || !offer->ice_ufrag[0] || !offer->ice_pwd[0] || !offer->fingerprint[0]) {
+        return -1;
+    }
+    return 0;
+}
+
+int webrtc_sdp_answer_is_dtls_server(const WebrtcSdpOffer *offer) {
+    return !offer || offer->setup != WEBRTC_SDP_SETUP_PASSIVE;
+}
+
+/**
+ * @description: 向 answer 追加一行格式化文本
+ * @param {char *} buf
+ * @param {size_t} cap
+ * @param {size_t *} len
+ * @param {const char *} fmt
+ * @return {static int} 0 成功，-1 缓冲不足
+ */
+static int sdp_append(char *buf, size_t cap, size_t *len, const char *fmt, ...) {
+    va_list args;
+    int n;
+
+    if (*len >= cap) {
+        return -1;
+    }
+    va_start(args, fmt);
+    n = vsnprintf(buf + *len, cap - *len, fmt, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= cap - *len) {
+        *len = cap;
+        return -1;
+    }
+    *len += (size_t)n;
+    return 0;
+}
+
+int webrtc_sdp_build_answer(const WebrtcSdpOffer *offer, const WebrtcSdpAnswerParams *params, char *buf, size_t cap) {
+    const WebrtcSdpMedia *video;
+    size_t len = 0;
+    int pt;
+    int i;
+
+    if (!offer || !params || !buf || cap == 0 || offer->video_index < 0) {
+        return -1;
+    }
+    video = &offer->media[offer->video_index];
+    pt = offer->h264_pt;
+    sdp_append(buf, cap, &len, "v=0\r\no=- %llu 2 IN IP4 %s\r\ns=-\r\nt=0 0\r\n",
+               (unsigned long long)params->session_id, params->candidate_ip);
+    if (video->mid[0]) {
+        sdp_append(buf, cap, &len, "a=group:BUNDLE %s\r\n", video->mid);
+    }
+    sdp_append(buf, cap, &len, "a=ice-lite\r\na=msid-semantic: WMS %s\r\n", params->stream_name);
+    for (i = 0; i < offer->media_count; ++i) {
+        const WebrtcSdpMedia *media = &offer->media[i];
+
+        if (i != offer->video_index) {
+            /* 只发一路视频，其余 m= 行端口置 0 拒绝，且不进 BUNDLE 组。 */
+            sdp_append(buf, cap, &len, "m=%s 0 %s %s\r\nc=IN IP4 0.0.0.0\r\n", media->kind, media->protocol, media->first_format);
+            if (media->mid[0]) {
+                sdp_append(buf, cap, &len, "a=mid:%s\r\n", media->mid);
+            }
+            sdp_append(buf, cap, &len, "a=inactive\r\n");
+            continue;
+        }
+        sdp_append(buf, cap, &len, "m=video %u UDP/TLS/RTP/SAVPF %d\r\nc=IN IP4 %s\r\n", params->candidate_port, pt, params->candidate_ip);
+        if (media->mid[0]) {
+            sdp_append(buf, cap, &len, "a=mid:%s\r\n", media->mid);
+        }
+        sdp_append(buf, cap, &len, "a=sendonly\r\na=rtcp-mux\r\na=ice-ufrag:%s\r\na=ice-pwd:%s\r\n", params->ice_ufrag, params->ice_pwd);
+        sdp_append(buf, cap, &len, "a=fingerprint:sha-256 %s\r\na=setup:%s\r\n", params->fingerprint,
+                   webrtc_sdp_answer_is_dtls_server(offer) ? "passive" : "active");
+        sdp_append(buf, cap, &len, "a=rtpmap:%d H264/90000\r\n", pt);
+        if (offer->nack) {
+            sdp_append(buf, cap, &len, "a=rtcp-fb:%d nack\r\n", pt);
+        }
+        if (offer->pli) {
+            sdp_append(buf, cap, &len, "a=rtcp-fb:%d nack pli\r\n", pt);
+        }
+        if (offer->fir) {
+            sdp_append(buf, cap, &len, "a=rtcp-fb:%d ccm fir\r\n", pt);
+        }
+        if (offer->h264_fmtp[0]) {
+            sdp_append(buf, cap, &len, "a=fmtp:%d %s\r\n", pt, offer->h264_fmtp);
+        }
+        sdp_append(buf, cap, &len, "a=msid:%s video0\r\na=ssrc:%u cname:%s\r\na=ssrc:%u msid:%s video0\r\n",
+                   params->stream_name, params->ssrc, params->stream_name, params->ssrc, params->stream_name);
+        sdp_append(buf, cap, &len, "a=candidate:1 1 udp 2130706431 %s %u typ host\r\na=end-of-candidates\r\n",
+                   params->candidate_ip, params->candidate_port);
+    }
+    return len < cap ? (int)len : -1;
+}
@@ -0,0 +1,1870 @@
+#define _GNU_SOURCE
+#include "webrtcSink.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+
+#include "mediaRtcp.h"
+#include "mediaRtpEgress.h"
+#include "mediaRtpHistory.h"
+#include "rtspRtp.h"
+#include "webrtcDtls.h"
+#include "webrtcSdp.h"
+#include "webrtcSrtp.h"
+#include "webrtcStun.h"
+
+#define DEFAULT_WEBRTC_NAME "webrtc"
+#define DEFAULT_WEBRTC_LISTEN_IP "0.0.0.0"
+#define DEFAULT_WEBRTC_HTTP_PORT 8090
+#define DEFAULT_WEBRTC_MEDIA_PORT 8092
+#define DEFAULT_WEBRTC_STREAM_NAME "main"
+#define DEFAULT_WEBRTC_QUEUE_CAPACITY 64
+#define DEFAULT_WEBRTC_MAX_PEERS 8
+#define DEFAULT_WEBRTC_RTP_MAX_PAYLOAD 1200
+#define DEFAULT_WEBRTC_NACK_HISTORY_MS 1000
+#define DEFAULT_WEBRTC_FPS 25
+#define DEFAULT_WEBRTC_BITRATE (4 * 1024 * 1024)
+#define DEFAULT_WEBRTC_RECONNECT_INTERVAL_MS 1000
+#define WEBRTC_RTP_MIN_PAYLOAD 256
+#define WEBRTC_RTP_MAX_PAYLOAD_LIMIT 1400
+#define WEBRTC_HISTORY_MIN_BYTES (512 * 1024)
+#define WEBRTC_HISTORY_MIN_ENTRIES 1024
+#define WEBRTC_PENDING_CONNECTIONS 16
+#define WEBRTC_HTTP_REQUEST_MAX 16384
+#define WEBRTC_HTTP_RESPONSE_MAX (WEBRTC_SDP_ANSWER_MAX + 1024)
+#define WEBRTC_HTTP_TIMEOUT_MS 5000
+#define WEBRTC_SETUP_TIMEOUT_MS 10000
+#define WEBRTC_CONSENT_TIMEOUT_MS 30000
+#define WEBRTC_EPOLL_EVENTS 64
+#define WEBRTC_EPOLL_TIMEOUT_MS 20
+#define WEBRTC_UDP_MAX 2048
+#define WEBRTC_UDP_SNDBUF (1024 * 1024)
+#define WEBRTC_NACK_MAX_SEQS 256
+#define WEBRTC_PATH_MAX 256
+#define WEBRTC_SESSION_ID_LEN 32
+#define WEBRTC_UFRAG_LEN 8
+#define WEBRTC_PWD_LEN 32
+#define WEBRTC_RTCP_PT_PSFB 206
+#define WEBRTC_RTCP_FMT_PLI 1
+#define WEBRTC_RTCP_FMT_FIR 4
+
+/* 所有响应都是短连接，写完即关。 */
+#define WEBRTC_HTTP_COMMON_HEADERS "Access-Control-Allow-Origin: *\r\nConnection: close\r\n"
+
+typedef enum {
+    WEBRTC_PEER_CHECKING = 0,      /* 已回 answer，等第一个通过校验的 STUN 请求。 */
+    WEBRTC_PEER_HANDSHAKING = 1,   /* 路径已确定，DTLS 握手中。 */
+    WEBRTC_PEER_CONNECTED = 2      /* SRTP 密钥已导出，正常收发媒体。 */
+} WebrtcPeerState;
+
+typedef struct WebrtcImpl WebrtcImpl;
+
+typedef struct {
+    int fd;                        /* 客户端连接。 */
+    int closed;                    /* 已关闭，等本轮事件处理完再回收。 */
+    long long accept_ms;           /* 接入时间，用于请求超时。 */
+    char request[WEBRTC_HTTP_REQUEST_MAX + 1]; /* 已读到的请求（头 + SDP 体）。 */
+    size_t request_len;            /* 已读字节数。 */
+    int replying;                  /* 是否已进入写响应阶段。 */
+    char response[WEBRTC_HTTP_RESPONSE_MAX]; /* 响应。 */
+    size_t response_len;           /* 响应长度。 */
+    size_t response_off;           /* 已写出的字节数。 */
+} WebrtcHttpClient;
+
+typedef struct {
+    WebrtcImpl *impl;              /* 所属通道，DTLS 出包回调里用来取 UDP socket。 */
+    int closed;                    /* 已关闭，等本轮事件处理完再回收。 */
+    int state;                     /* WebrtcPeerState。 */
+    char session_id[WEBRTC_SESSION_ID_LEN + 1]; /* WHEP 资源 ID，Location 路径的最后一段。 */
+    char local_ufrag[WEBRTC_UFRAG_LEN + 1]; /* 本端 ice-ufrag，STUN USERNAME 按它找会话。 */
+    char local_pwd[WEBRTC_PWD_LEN + 1]; /* 本端 ice-pwd。 */
+    char remote_ufrag[WEBRTC_SDP_ICE_UFRAG_MAX]; /* 对端 ice-ufrag。 */
+    char remote_fingerprint[WEBRTC_DTLS_FINGERPRINT_LEN + 1]; /* 对端证书指纹。 */
+    int dtls_server;               /* 本端是否为 DTLS 服务端。 */
+    int payload_type;              /* 协商出的 H264 负载类型，发送时逐包改写。 */
+    struct sockaddr_in addr;       /* 对端媒体地址，由通过校验的 STUN 请求确定。 */
+    int has_addr;                  /* addr 是否有效。 */
+    char addr_text[64];            /* addr 的 ip:port 文本，用于日志。 */
+    long long created_ms;          /* 会话创建时间，用于建立超时。 */
+    long long consent_ms;          /* 最近一次通过校验的 STUN 请求时间（RFC 7675 consent）。 */
+    WebrtcDtlsSession dtls;        /* DTLS 会话。 */
+    int dtls_started;              /* dtls 是否已创建。 */
+    WebrtcSrtpContext srtp_tx;     /* 发送方向 SRTP/SRTCP 上下文。 */
+    WebrtcSrtpContext srtp_rx;     /* 接收方向（对端 RTCP）上下文。 */
+    MediaRtpEgress egress;         /* 批量发送器，目标为 addr。 */
+    MediaRtcpPeer rtcp;            /* 接收报告统计和 SR 节奏。 */
+    int need_keyframe;             /* 连接后等第一个关键帧再开始发送。 */
+    uint32_t rtp_packets;          /* SR 里的发送包数。 */
+    uint32_t rtp_octets;           /* SR 里的发送负载字节数。 */
+    uint64_t frames;               /* 已发给该对端的帧数。 */
+} WebrtcPeer;
+
+struct WebrtcImpl {
+    WebrtcSinkConfig config;       /* 配置副本。 */
+    char prefix[WEBRTC_PATH_MAX];  /* 信令路径 /whep/<stream>。 */
+    char announce_ip[64];          /* ICE host 候选地址。 */
+    int http_fd;                   /* HTTP 监听 socket。 */
+    int udp_fd;                    /* 媒体 UDP socket，所有对端共用。 */
+    int event_fd;                  /* 发送线程投递新帧后唤醒服务线程。 */
+    int epoll_fd;                  /* 服务线程的 epoll。 */
+    pthread_t thread;              /* 服务线程。 */
+    int running;                   /* 服务线程是否已启动。 */
+    volatile int stop_requested;   /* 是否已请求服务线程退出。 */
+    pthread_mutex_t lock;          /* 保护 inbox 和 stats。 */
+    MediaPacket *inbox;            /* 发送线程到服务线程的帧引用环形队列。 */
+    int inbox_capacity;            /* inbox 容量。 */
+    int inbox_head;                /* inbox 队头下标。 */
+    int inbox_size;                /* inbox 有效元素数。 */
+    uint64_t inbox_drops;          /* inbox 满导致丢弃的帧数，受 lock 保护。 */
+    WebrtcSinkStats stats;         /* 对外统计。 */
+    atomic_int pending_idr;        /* 待上游消费的关键帧请求。 */
+    /* 以下字段只在发送线程使用。 */
+    int inbox_need_keyframe;       /* inbox 满丢帧后，直到下一个关键帧前不再投递。 */
+    /* 以下字段只在服务线程使用。 */
+    WebrtcSinkStats counters;      /* 服务线程内累计的统计，每轮发布到 stats。 */
+    WebrtcDtlsIdentity identity;   /* 本端证书，所有对端共用。 */
+    WebrtcHttpClient **clients;    /* 所有 HTTP 连接。 */
+    int client_capacity;           /* clients 容量。 */
+    int client_count;              /* 连接数。 */
+    WebrtcPeer **peers;            /* 所有 WebRTC 会话。 */
+    int peer_capacity;             /* peers 容量。 */
+    int peer_count;                /* 会话数（含已关闭未回收的）。 */
+    RtspRtpPacketizer packetizer;  /* 所有对端共用的 RTP 打包器，SSRC 和序号只有一份。 */
+    MediaRtpHistoryArena arena;    /* 重传负载环形缓冲。 */
+    MediaRtpHistory history;       /* 共享重传历史，记录的是改写负载类型前的原始包。 */
+    size_t history_bytes;          /* arena 大小。 */
+    int history_entries;           /* 历史记录槽位数。 */
+    uint8_t *scratch;              /* 加密用的包槽位，按发送器批次下标复用，各对端依次使用。 */
+    size_t slot_bytes;             /* 每个槽位的字节数。 */
+    int have_frame;                /* 是否已打包过帧，SR 需要 RTP 时间戳基准。 */
+    uint32_t last_rtp_timestamp;   /* 最近一帧的 RTP 时间戳。 */
+    uint64_t last_pts_us;          /* 最近一帧的 pts。 */
+};
+
+/**
+ * @description: 获取单调时钟毫秒数
+ * @return {static long long}
+ */
+static long long webrtc_now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+/**
+ * @description: 获取单调时钟微秒数
+ * @return {static uint64_t}
+ */
+static uint64_t webrtc_now_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+/**
+ * @description: 生成随机十六进制串，用作会话 ID 和 ICE 凭据
+ * @param {char *} out 至少 chars + 1 字节
+ * @param {size_t} chars 字符数（偶数）
+ * @return {static int} 0 成功，-1 随机源失败
+ */
+static int webrtc_random_hex(char *out, size_t chars) {
+    static const char hex[] = "0123456789abcdef";
+    uint8_t raw[WEBRTC_SESSION_ID_LEN / 2];
+    size_t i;
+
+    if (chars / 2 > sizeof(raw) || RAND_bytes(raw, (int)(chars / 2)) != 1) {
+        return -1;
+    }
+    for (i = 0; i < chars / 2; ++i) {
+        out[i * 2] = hex[raw[i] >> 4];
+        out[i * 2 + 1] = hex[raw[i] & 0x0F];
+    }
+    out[chars] = '\0';
+    return 0;
+}
+
+/**
+ * @description: 记录一次关键帧请求，由网关主循环通过 webrtc_sink_consume_external_idr_request 取走
+ * @param {WebrtcImpl *} impl
+ * @param {const char *} reason
+ * @return {static void}
+ */
+static void webrtc_raise_idr(WebrtcImpl *impl, const char *reason) {
+    impl->counters.idr_requests++;
+    if (!atomic_exchange(&impl->pending_idr, 1)) {
+        printf("[WEBRTC] event=idr_request stream=%s reason=%s\n", impl->config.stream_name, reason);
+    }
+}
+
+/**
+ * @description: 按 WHEP 资源 ID 查找会话
+ * @param {WebrtcImpl *} impl
+ * @param {const char *} session_id
+ * @return {static WebrtcPeer *}
+ */
+static WebrtcPeer *webrtc_find_peer_by_session(WebrtcImpl *impl, const char *session_id) {
+    int i;
+
+    for (i = 0; i < impl->peer_count; ++i) {
+        if (!impl->peers[i]->closed && strcmp(impl->peers[i]->session_id, session_id) == 0) {
+            return impl->peers[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @description: 按本端 ice-ufrag 查找会话
+ * @param {WebrtcImpl *} impl
+ * @param {const char *} ufrag
+ * @param {size_t} len
+ * @return {static WebrtcPeer *}
+ */
+static WebrtcPeer *webrtc_find_peer_by_ufrag(WebrtcImpl *impl, const char *ufrag, size_t len) {
+    int i;
+
+    for (i = 0; i < impl->peer_count; ++i) {
+        WebrtcPeer *peer = impl->peers[i];
+
+        if (!peer->closed && strlen(peer->local_ufrag) == len && memcmp(peer->local_ufrag, ufrag, len) == 0) {
+            return peer;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @description: 按媒体地址查找已确定路径的会话
+ * @param {WebrtcImpl *} impl
+ * @param {const struct sockaddr_in *} addr
+ * @return {static WebrtcPeer *}
+ */
+static WebrtcPeer *webrtc_find_peer_by_addr(WebrtcImpl *impl, const struct sockaddr_in *addr) {
+    int i;
+
+    for (i = 0; i < impl->peer_count; ++i) {
+        WebrtcPeer *peer = impl->peers[i];
+
+        if (!peer->closed && peer->has_addr && peer->addr.sin_port == addr->sin_port &&
+            peer->addr.sin_addr.s_addr == addr->sin_addr.s_addr) {
+            return peer;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @description: 统计未关闭的会话数
+ * @param {WebrtcImpl *} impl
+ * @param {int} connected_only 1 只统计 SRTP 已建立的
+ * @return {static int}
+ */
+static int webrtc_count_peers(WebrtcImpl *impl, int connected_only) {
+    int count = 0;
+    int i;
+
+    for (i = 0; i < impl->peer_count; ++i) {
+        if (!impl->peers[i]->closed && (!connected_only || impl->peers[i]->state == WEBRTC_PEER_CONNECTED)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @description: 关闭会话：已连接时发 close_notify，内存等本轮事件处理完再回收
+ * @param {WebrtcImpl *} impl
+ * @param {WebrtcPeer *} peer
+ * @param {const char *} reason 日志中的关闭原因
+ * @return {static void}
+ */
+static void webrtc_peer_close(WebrtcImpl *impl, WebrtcPeer *peer, const char *reason) {
+    (void)impl;
+    if (peer->closed) {
+        return;
+    }
+    if (peer->state == WEBRTC_PEER_CONNECTED) {
+        webrtc_dtls_session_shutdown(&peer->dtls);
+    }
+    printf("[WEBRTC] event=peer_closed session=%s peer=%s reason=%s state=%d frames=%llu\n",
+           peer->session_id,
+           peer->has_addr ? peer->addr_text : "-",
+           reason,
+           peer->state,
+           (unsigned long long)peer->frames);
+    peer->closed = 1;
+}
+
+/**
+ * @description: 释放会话持有的 DTLS、SRTP 和发送器资源
+ * @param {WebrtcPeer *} peer
+ * @return {static void}
+ */
+static void webrtc_peer_free(WebrtcPeer *peer) {
+    if (peer->dtls_started) {
+        webrtc_dtls_session_deinit(&peer->dtls);
+    }
+    webrtc_srtp_deinit(&peer->srtp_tx);
+    webrtc_srtp_deinit(&peer->srtp_rx);
+    media_rtp_egress_deinit(&peer->egress);
+    free(peer);
+}
+
+/**
+ * @description: 回收已关闭的会话
+ * @param {WebrtcImpl *} impl
+ * @return {static void}
+ */
+static void webrtc_reap_peers(WebrtcImpl *impl) {
+    int i = 0;
+
+    while (i < impl->peer_count) {
+        if (!impl->peers[i]->closed) {
+            i++;
+            continue;
+        }
+        webrtc_peer_free(impl->peers[i]);
+        impl->peers[i] = impl->peers[impl->peer_count - 1];
+        impl->peers[impl->peer_count - 1] = NULL;
+        impl->peer_count--;
+    }
+}
+
+/**
+ * @description: DTLS 出包回调：经共享 UDP socket 发给对端当前路径
+ * @param {void *} opaque WebrtcPeer
+ * @param {const uint8_t *} data
+ * @param {size_t} len
+ * @return {static void}
+ */
+static void webrtc_dtls_send(void *opaque, const uint8_t *data, size_t len) {
+    WebrtcPeer *peer = (WebrtcPeer *)opaque;
+
+    if (!peer->has_addr) {
+        return;
+    }
+    if (sendto(peer->impl->udp_fd, data, len, MSG_DONTWAIT, (const struct sockaddr *)&peer->addr, sizeof(peer->addr)) < 0 &&
+        errno != EAGAIN && errno != EWOULDBLOCK) {
+        fprintf(stderr, "[WEBRTC][ERROR] dtls send failed session=%s errno=%d\n", peer->session_id, errno);
+    }
+}
+
+/**
+ * @description: 加密一个 RTP 包并排进对端的发送批次：头和负载拷进共享槽位，改写负载类型后原地加密
+ * @param {WebrtcImpl *} impl
+ * @param {WebrtcPeer *} peer
+ * @param {const uint8_t *} header 12 字节 RTP 头
+ * @param {const struct iovec *} payload 负载分段（含 FU 头）
+ * @param {int} payload_iov_count
+ * @return {static int} 负载字节数，-1 失败
+ */
+static int webrtc_peer_queue_rtp(WebrtcImpl *impl,
+                                 WebrtcPeer *peer,
+                                 const uint8_t *header,
+                                 const struct iovec *payload,
+                                 int payload_iov_count) {
+    MediaRtpEgress *egress = &peer->egress;
+    struct iovec body;
+    uint8_t *slot;
+    size_t len = MEDIA_RTP_HISTORY_HEADER;
+    int protected_len;
+    int i;
+
+    /* 槽位按批次下标复用，批次满时先发出去再覆盖。 */
+    if (egress->count >= MEDIA_RTP_EGRESS_MAX_BATCH && media_rtp_egress_flush(egress) != 0) {
+        return -1;
+    }
+    slot = impl->scratch + (size_t)egress->count * impl->slot_bytes;
+    memcpy(slot, header, MEDIA_RTP_HISTORY_HEADER);
+    for (i = 0; i < payload_iov_count; ++i) {
+        if (len + payload[i].iov_len + WEBRTC_SRTP_MAX_OVERHEAD > impl->slot_bytes) {
+            return -1;
+        }
+        memcpy(slot + len, payload[i].iov_base, payload[i].iov_len);
+        len += payload[i].iov_len;
+    }
+    slot[1] = (uint8_t)((slot[1] & 0x80) | (peer->payload_type & 0x7F));
+    protected_len = webrtc_srtp_protect_rtp(&peer->srtp_tx, slot, len, impl->slot_bytes);
+    if (protected_len < 0) {
+        return -1;
+    }
+    body.iov_base = slot + MEDIA_RTP_HISTORY_HEADER;
+    body.iov_len = (size_t)protected_len - MEDIA_RTP_HISTORY_HEADER;
+    if (media_rtp_egress_queue(egress, slot, MEDIA_RTP_HISTORY_HEADER, &body, 1) != 0) {
+        return -1;
+    }
+    impl->counters.rtp_packets++;
+    impl->counters.srtp_bytes += (uint64_t)protected_len;
+    return (int)(len - MEDIA_RTP_HISTORY_HEADER);
+}
+
+/**
+ * @description: 把打包好的一帧记进共享历史，再逐个已连接对端加密发送；新连接的对端从关键帧开始
+ * @param {WebrtcImpl *} impl
+ * @param {RtspRtpFrame *} frame
+ * @return {static int} 发出该帧的对端数
+ */
+static int webrtc_send_frame(WebrtcImpl *impl, RtspRtpFrame *frame) {
+    int sent = 0;
+    int i;
+    int p;
+
+    for (p = 0; p < frame->packet_count; ++p) {
+        const RtspRtpPacket *packet = &frame->packets[p];
+        struct iovec payload[2];
+        uint64_t pos;
+
+        payload[0].iov_base = (void *)(packet->header + MEDIA_RTP_HISTORY_HEADER);
+        payload[0].iov_len = (size_t)packet->header_len - MEDIA_RTP_HISTORY_HEADER;
+        payload[1].iov_base = (void *)packet->payload;
+        payload[1].iov_len = packet->payload_len;
+        pos = media_rtp_history_arena_append(&impl->arena, payload, 2);
+        media_rtp_history_record(&impl->history, packet->header, pos, payload[0].iov_len + payload[1].iov_len);
+    }
+    for (i = 0; i < impl->peer_count; ++i) {
+        WebrtcPeer *peer = impl->peers[i];
+
+        if (peer->closed || peer->state != WEBRTC_PEER_CONNECTED) {
+            continue;
+        }
+        if (peer->need_keyframe && !frame->is_key_frame && !frame->is_parameter_sets) {
+            continue;
+        }
+        if (frame->is_key_frame) {
+            peer->need_keyframe = 0;
+        }
+        for (p = 0; p < frame->packet_count; ++p) {
+            const RtspRtpPacket *packet = &frame->packets[p];
+            struct iovec payload[2];
+            int payload_len;
+
+            payload[0].iov_base = (void *)(packet->header + MEDIA_RTP_HISTORY_HEADER);
+            payload[0].iov_len = (size_t)packet->header_len - MEDIA_RTP_HISTORY_HEADER;
+            payload[1].iov_base = (void *)packet->payload;
+            payload[1].iov_len = packet->payload_len;
+            payload_len = webrtc_peer_queue_rtp(impl, peer, packet->header, payload, 2);
+            if (payload_len < 0) {
+                break;
+            }
+            peer->rtp_packets++;
+            peer->rtp_octets += (uint32_t)payload_len;
+        }
+        media_rtp_egress_end_frame(&peer->egress);
+        if (!frame->is_parameter_sets) {
+            peer->frames++;
+            sent++;
+        }
+    }
+    return sent;
+}
+
+/**
+ * @description: 处理一帧：只打包一次；有对端等待起播时在关键帧前补一份参数集
+ * @param {WebrtcImpl *} impl
+ * @param {const MediaPacket *} packet
+ * @return {static void}
+ */
+static void webrtc_process_frame(WebrtcImpl *impl, const MediaPacket *packet) {
+    RtspRtpFrame *params = NULL;
+    RtspRtpFrame *frame = NULL;
+    int connected = webrtc_count_peers(impl, 1);
+    int starting = 0;
+    int i;
+
+    /* 没人看时只打包关键帧，保持 SPS 缓存新鲜，供 offer 选 profile。 */
+    if (connected == 0 && !packet->is_key_frame) {
+        return;
+    }
+    for (i = 0; i < impl->peer_count; ++i) {
+        if (!impl->peers[i]->closed && impl->peers[i]->state == WEBRTC_PEER_CONNECTED && impl->peers[i]->need_keyframe) {
+            starting = 1;
+        }
+    }
+    if (connected > 0 && starting && packet->is_key_frame &&
+        rtsp_rtp_packetize_parameter_sets(&impl->packetizer, packet->pts_us, &params) != 0) {
+        params = NULL;
+    }
+    if (rtsp_rtp_packetize(&impl->packetizer, packet, &frame) != 0) {
+        fprintf(stderr, "[WEBRTC][ERROR] packetize failed frame=%llu\n", (unsigned long long)packet->frame_id);
+        rtsp_rtp_frame_release(params);
+        return;
+    }
+    if (frame) {
+        impl->have_frame = 1;
+        impl->last_rtp_timestamp = frame->rtp_timestamp;
+        impl->last_pts_us = frame->pts_us;
+    }
+    if (connected > 0) {
+        if (params) {
+            webrtc_send_frame(impl, params);
+        }
+        if (frame && webrtc_send_frame(impl, frame) > 0) {
+            impl->counters.frames++;
+        }
+    }
+    rtsp_rtp_frame_release(params);
+    rtsp_rtp_frame_release(frame);
+}
+
+/**
+ * @description: 按 NACK 从共享历史取包，用该对端的负载类型和 SRTP 上下文重新加密后重发（同 SSRC，不走 RTX）
+ * @param {WebrtcImpl *} impl
+ * @param {WebrtcPeer *} peer
+ * @param {const uint16_t *} seqs
+ * @param {int} count
+ * @return {static void}
+ */
+static void webrtc_peer_retransmit(WebrtcImpl *impl, WebrtcPeer *peer, const uint16_t *seqs, int count) {
+    int i;
+
+    impl->counters.nack_requested += (uint64_t)count;
+    for (i = 0; i < count; ++i) {
+        const MediaRtpHistoryEntry *entry = NULL;
+        struct iovec payload[2];
+        int iov_count = media_rtp_history_lookup(&impl->history, seqs[i], &entry, payload);
+
+        if (iov_count < 0) {
+            impl->counters.nack_too_late++;
+            continue;
+        }
+        if (webrtc_peer_queue_rtp(impl, peer, entry->header, payload, iov_count) >= 0) {
+            impl->counters.retransmitted++;
+        }
+    }
+    media_rtp_egress_flush(&peer->egress);
+}
+
+/**
+ * @description: 处理对端发来的 SRTCP：接收报告更新质量统计，NACK 重传，PLI/FIR 请求关键帧
+ * @param {WebrtcImpl *} impl
+ * @param {WebrtcPeer *} peer
+ * @param {uint8_t *} buf 原地解密
+ * @param {size_t} len
+ * @return {static void}
+ */
+static void webrtc_peer_on_rtcp(WebrtcImpl *impl, WebrtcPeer *peer, uint8_t *buf, size_t len) {
+    uint16_t seqs[WEBRTC_NACK_MAX_SEQS];
+    uint32_t ssrc = impl->packetizer.ssrc;
+    size_t off = 0;
+    int rtcp_len;
+    int count;
+
+    rtcp_len = webrtc_srtp_unprotect_rtcp(&peer->srtp_rx, buf, len);
+    if (rtcp_len < 0) {
+        impl->counters.srtcp_errors++;
+        return;
+    }
+    media_rtcp_peer_on_packet(&peer->rtcp, buf, (size_t)rtcp_len, ssrc, MEDIA_RTCP_VIDEO_CLOCK_RATE, webrtc_now_ms());
+    count = media_rtcp_parse_nack(buf, (size_t)rtcp_len, ssrc, seqs, WEBRTC_NACK_MAX_SEQS);
+    if (count > 0) {
+        webrtc_peer_retransmit(impl, peer, seqs, count);
+    }
+    while (off + 4 <= (size_t)rtcp_len) {
+        size_t packet_len = ((size_t)((buf[off + 2] << 8) | buf[off + 3]) + 1) * 4;
+        int fmt = buf[off] & 0x1F;
+
+        if (off + packet_len > (size_t)rtcp_len) {
+            break;
+        }
+        if (buf[off + 1] == WEBRTC_RTCP_PT_PSFB && fmt == WEBRTC_RTCP_FMT_PLI) {
+            impl->counters.pli++;
+            webrtc_raise_idr(impl, "pli");
+        } else if (buf[off + 1] == WEBRTC_RTCP_PT_PSFB && fmt == WEBRTC_RTCP_FMT_FIR) {
+            impl->counters.fir++;
+            webrtc_raise_idr(impl, "fir");
+        }
+        off += packet_len;
+    }
+}
+
+/**
+ * @description: DTLS 握手完成：导出密钥建立 SRTP，等下一个关键帧开始发送，并向上游请求 IDR
+ * @param {WebrtcImpl *} impl
+ * @param {WebrtcPeer *} peer
+ * @return {static void}
+ */
+static void webrtc_peer_on_connected(WebrtcImpl *impl, WebrtcPeer *peer) {
+    WebrtcDtlsSrtpKeys keys;
+
+    if (webrtc_dtls_session_export_srtp(&peer->dtls, &keys) != 0 ||
+        webrtc_srtp_init(&peer->srtp_tx, keys.local_key, keys.local_salt) != 0 ||
+        webrtc_srtp_init(&peer->srtp_rx, keys.remote_key, keys.remote_salt) != 0) {
+        OPENSSL_cleanse(&keys, sizeof(keys));
+        impl->counters.dtls_failures++;
+        webrtc_peer_close(impl, peer, "srtp_init_failed");
+        return;
+    }
+    OPENSSL_cleanse(&keys, sizeof(keys));
+    peer->state = WEBRTC_PEER_CONNECTED;
+    peer->need_keyframe = 1;
+    media_rtcp_peer_reset(&peer->rtcp);
+    impl->counters.dtls_handshakes++;
+    printf("[WEBRTC] event=peer_connected session=%s peer=%s role=%s setup_ms=%lld\n",
+           peer->session_id,
+           peer->addr_text,
+           peer->dtls_server ? "server" : "client",
+           webrtc_now_ms() - peer->created_ms);
+    webrtc_raise_idr(impl, "peer_connected");
+}
+
+/**
+ * @description: 设置对端媒体路径，同时更新发送器目标
+ * @param {WebrtcImpl *} impl
+ * @param {WebrtcPeer *} peer
+ * @param {const struct sockaddr_in *} from
+ * @return {static void}
+ */
+static void webrtc_peer_set_addr(WebrtcImpl *impl, WebrtcPeer *peer, const struct sockaddr_in *from) {
+    char ip[INET_ADDRSTRLEN];
+
+    if (peer->has_addr && peer->addr.sin_addr.s_addr == from->sin_addr.s_addr && peer->addr.sin_port == from->sin_port) {
+        return;
+    }
+    inet_ntop(AF_INET, &from->sin_addr, ip, sizeof(ip));
+    peer->addr = *from;
+    peer->has_addr = 1;
+    snprintf(peer->addr_text, sizeof(peer->addr_text), "%s:%u", ip, ntohs(from->sin_port));
+    media_rtp_egress_set_target(&peer->egress, impl->udp_fd, ip, ntohs(from->sin_port));
+    printf("[WEBRTC] event=peer_path session=%s peer=%s\n", peer->session_id, peer->addr_text);
+}
+
+/**
+ * @description: 处理 STUN Binding 请求：按 USERNAME 找会话、用本端密码校验后应答；
+ *               ICE-lite 下第一个通过校验的请求确定路径，之后的 USE-CANDIDATE 可以切换路径
+ * @param {WebrtcImpl *} impl
+ * @param {const uint8_t *} buf
+ * @param {size_t} len
+ * @param {const struct sockaddr_in *} from
+ * @return {static void}
+ */
+static void webrtc_on_stun(WebrtcImpl *impl, const uint8_t *buf, size_t len, const struct sockaddr_in *from) {
+    uint8_t response[WEBRTC_STUN_MAX];
+    WebrtcStunMessage msg;
+    WebrtcPeer *peer;
+    const char *colon;
+    int response_len;
+
+    if (webrtc_stun_parse(buf, len, &msg) != 0 || msg.type != WEBRTC_STUN_BINDING_REQUEST) {
+        return;
+    }
+    colon = strchr(msg.username, ':');
+    peer = colon ? webrtc_find_peer_by_ufrag(impl, msg.username, (size_t)(colon - msg.username)) : NULL;
+    if (!peer || strcmp(colon + 1, peer->remote_ufrag) != 0 || !webrtc_stun_check_integrity(buf, len, &msg, peer->local_pwd)) {
+        impl->counters.stun_rejects++;
+        return;
+    }
+    impl->counters.stun_requests++;
+    response_len = webrtc_stun_build_binding_response(response, sizeof(response), msg.transaction_id, from, peer->local_pwd);
+    if (response_len > 0 &&
+        sendto(impl->udp_fd, response, (size_t)response_len, MSG_DONTWAIT, (const struct sockaddr *)from, sizeof(*from)) < 0 &&
+        errno != EAGAIN && errno != EWOULDBLOCK) {
+        fprintf(stderr, "[WEBRTC][ERROR] stun response send failed errno=%d\n", errno);
+    }
+    peer->consent_ms = webrtc_now_ms();
+    if (!peer->has_addr || msg.use_candidate) {
+        webrtc_peer_set_addr(impl, peer, from);
+    }
+    if (peer->dtls_started) {
+        return;
+    }
+    if (webrtc_dtls_session_init(&peer->dtls,
+                                 &impl->identity,
+                                 peer->dtls_server,
+                                 peer->remote_fingerprint,
+                                 webrtc_dtls_send,
+                                 peer) != 0) {
+        impl->counters.dtls_failures++;
+        webrtc_peer_close(impl, peer, "dtls_init_failed");
+        return;
+    }
+    peer->dtls_started = 1;
+    peer->state = WEBRTC_PEER_HANDSHAKING;
+    /* setup:active 时由本端发 ClientHello。 */
+    if (!peer->dtls_server && webrtc_dtls_session_feed(&peer->dtls, NULL, 0) < 0) {
+        impl->counters.dtls_failures++;
+        webrtc_peer_close(impl, peer, "dtls_failed");
+    }
+}
+
+/**
+ * @description: 处理 DTLS 记录：推进握手，握手完成后只处理 close_notify
+ * @param {WebrtcImpl *} impl
+ * @param {const uint8_t *} buf
+ * @param {size_t} len
+ * @param {const struct sockaddr_in *} from
+ * @return {static void}
+ */
+static void webrtc_on_dtls(WebrtcImpl *impl, const uint8_t *buf, size_t len, const struct sockaddr_in *from) {
+    WebrtcPeer *peer = webrtc_find_peer_by_addr(impl, from);
+    int ret;
+
+    if (!peer || !peer->dtls_started) {
+        return;
+    }
+    ret = webrtc_dtls_session_feed(&peer->dtls, buf, len);
+    if (ret == 1) {
+        webrtc_peer_on_connected(impl, peer);
+    } else if (ret < 0) {
+        if (peer->state != WEBRTC_PEER_CONNECTED) {
+            impl->counters.dtls_failures++;
+            webrtc_peer_close(impl, peer, "dtls_failed");
+        } else {
+            webrtc_peer_close(impl, peer, "dtls_closed");
+        }
+    }
+}
+
+/**
+ * @description: 读空媒体 UDP socket，按 RFC 7983 首字节区分 STUN / DTLS / SRTCP
+ * @param {WebrtcImpl *} impl
+ * @return {static void}
+ */
+static void webrtc_udp_read(WebrtcImpl *impl) {
+    uint8_t buf[WEBRTC_UDP_MAX];
+
+    while (1) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(impl->udp_fd, buf, sizeof(buf), MSG_DONTWAIT, (struct sockaddr *)&from, &from_len);
+        WebrtcPeer *peer;
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (n < 2 || from.sin_family != AF_INET) {
+            continue;
+        }
+        if (buf[0] <= 3) {
+            webrtc_on_stun(impl, buf, (size_t)n, &from);
+        } else if (buf[0] >= 20 && buf[0] <= 63) {
+            webrtc_on_dtls(impl, buf, (size_t)n, &from);
+        } else if (buf[0] >= 128 && buf[0] <= 191 && buf[1] >= 192 && buf[1] <= 223) {
+            /* rtcp-mux：RTCP 的 PT 落在 192~223（RFC 5761），sendonly 下对端不会发 RTP。 */
+            peer = webrtc_find_peer_by_addr(impl, &from);
+            if (peer && peer->state == WEBRTC_PEER_CONNECTED) {
+                webrtc_peer_on_rtcp(impl, peer, buf, (size_t)n);
+            }
+        }
+    }
+}
+
+/**
+ * @description: 到期时给每个已连接对端发 SRTCP 保护的 SR
+ * @param {WebrtcImpl *} impl
+ * @return {static void}
+ */
+static void webrtc_send_reports(WebrtcImpl *impl) {
+    long long now = webrtc_now_ms();
+    uint32_t rtp_timestamp;
+    uint64_t ntp;
+    int i;
+
+    if (impl->config.rtcp_interval_ms <= 0 || !impl->have_frame) {
+        return;
+    }
+    ntp = media_rtcp_ntp_now();
+    rtp_timestamp = media_rtcp_rtp_timestamp_at(impl->last_rtp_timestamp,
+                                                impl->last_pts_us,
+                                                webrtc_now_us(),
+                                                MEDIA_RTCP_VIDEO_CLOCK_RATE);
+    for (i = 0; i < impl->peer_count; ++i) {
+        WebrtcPeer *peer = impl->peers[i];
+        uint8_t sr[MEDIA_RTCP_SR_MAX + WEBRTC_SRTCP_TRAILER_LEN];
+        int sr_len;
+
+        if (peer->closed || peer->state != WEBRTC_PEER_CONNECTED || peer->need_keyframe ||
+            !media_rtcp_peer_sr_due(&peer->rtcp, now, impl->config.rtcp_interval_ms)) {
+            continue;
+        }
+        sr_len = media_rtcp_build_sr(sr,
+                                     MEDIA_RTCP_SR_MAX,
+                                     impl->packetizer.ssrc,
+                                     ntp,
+                                     rtp_timestamp,
+                                     peer->rtp_packets,
+                                     peer->rtp_octets,
+                                     impl->config.stream_name);
+        if (sr_len <= 0) {
+            continue;
+        }
+        sr_len = webrtc_srtp_protect_rtcp(&peer->srtp_tx, sr, (size_t)sr_len, sizeof(sr));
+        if (sr_len > 0 &&
+            sendto(impl->udp_fd, sr, (size_t)sr_len, MSG_DONTWAIT, (const struct sockaddr *)&peer->addr, sizeof(peer->addr)) >= 0) {
+            peer->rtcp.sr_sent++;
+            impl->counters.sr_sent++;
+        }
+    }
+}
+
+/**
+ * @description: 处理握手重传定时器，关闭建立超时和 consent 过期的会话
+ * @param {WebrtcImpl *} impl
+ * @return {static void}
+ */
+static void webrtc_expire_peers(WebrtcImpl *impl) {
+    long long now = webrtc_now_ms();
+    int i;
+
+    for (i = 0; i < impl->peer_count; ++i) {
+        WebrtcPeer *peer = impl->peers[i];
+
+        if (peer->closed) {
+            continue;
+        }
+        if (peer->state != WEBRTC_PEER_CONNECTED) {
+            if (now - peer->created_ms > WEBRTC_SETUP_TIMEOUT_MS) {
+                impl->counters.setup_timeouts++;
+                webrtc_peer_close(impl, peer, "setup_timeout");
+            } else if (peer->state == WEBRTC_PEER_HANDSHAKING && webrtc_dtls_session_timeout_ms(&peer->dtls) == 0 &&
+                       webrtc_dtls_session_on_timer(&peer->dtls) != 0) {
+                impl->counters.dtls_failures++;
+                webrtc_peer_close(impl, peer, "dtls_timeout");
+            }
+        } else if (now - peer->consent_ms > WEBRTC_CONSENT_TIMEOUT_MS) {
+            impl->counters.consent_timeouts++;
+            webrtc_peer_close(impl, peer, "consent_timeout");
+        }
+    }
+}
+
+/**
+ * @description: 关闭 HTTP 连接，内存等本轮事件处理完再回收
+ * @param {WebrtcImpl *} impl
+ * @param {WebrtcHttpClient *} client
+ * @return {static void}
+ */
+static void webrtc_http_close(WebrtcImpl *impl, WebrtcHttpClient *client) {
+    if (client->closed) {
+        return;
+    }
+    epoll_ctl(impl->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    client->fd = -1;
+    client->closed = 1;
+}
+
+/**
+ * @description: 回收已关闭的 HTTP 连接
+ * @param {WebrtcImpl *} impl
+ * @return {static void}
+ */
+static void webrtc_reap_clients(WebrtcImpl *impl) {
+    int i = 0;
+
+    while (i < impl->client_count) {
+        if (!impl->clients[i]->closed) {
+            i++;
+            continue;
+        }
+        free(impl->clients[i]);
+        impl->clients[i] = impl->clients[impl->client_count - 1];
+        impl->clients[impl->client_count - 1] = NULL;
+        impl->client_count--;
+    }
+}
+
+/**
+ * @description: 尽量写出响应，写不动时注册 EPOLLOUT，写完关闭连接
+ * @param {WebrtcImpl *} impl
+ * @param {WebrtcHttpClient *} client
+ * @return {static void}
+ */
+static void webrtc_http_flush(WebrtcImpl *impl, WebrtcHttpClient *client) {
+    while (client->response_off < client->response_len) {
+        ssize_t written = send(client->fd,
+                               client->response + client->response_off,
+                               client->response_len - client->response_off,
+                               MSG_NOSIGNAL | MSG_DONTWAIT);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                struct epoll_event ev;
+
+                memset(&ev, 0, sizeof(ev));
+                ev.events = EPOLLOUT | EPOLLRDHUP;
+                ev.data.ptr = client;
+                epoll_ctl(impl->epoll_fd, EPOLL_CTL_MOD, client->fd, &ev);
+                return;
+            }
+            break;
+        }
+        client->response_off += (size_t)written;
+    }
+    webrtc_http_close(impl, client);
+}
+
+/**
+ * @description: 生成并发送响应
+ * @param {WebrtcImpl *} impl
+ * @param {WebrtcHttpClient *} client
+ * @param {const char *} status 状态行，如 "201 Created"
+ * @param {const char *} headers 额外的响应头（每行以 \r\n 结尾），可为空串
+ * @param {const char *} body 响应体，NULL 表示没有
+ * @param {size_t} body_len
+ * @return {static void}
+ */
+static void webrtc_http_reply(WebrtcImpl *impl,
+                              WebrtcHttpClient *client,
+                              const char *status,
+                              const char *headers,
+                              const char *body,
+                              size_t body_len) {
+    int len = snprintf(client->response,
+                       sizeof(client->response),
+                       "HTTP/1.1 %s\r\n%sContent-Length: %zu\r\n" WEBRTC_HTTP_COMMON_HEADERS "\r\n",
+                       status,
+                       headers,
+                       body ? body_len : 0);
+
+    if (len < 0 || (size_t)len + (body ? body_len : 0) > sizeof(client->response)) {
+        webrtc_http_close(impl, client);
+        return;
+    }
+    if (body) {
+        memcpy(client->response + len, body, body_len);
+    }
+    client->response_len = (size_t)len + (body ? body_len : 0);
+    client->response_off = 0;
+    client->replying = 1;
+    webrtc_http_flush(impl, client);
+}
+
+/**
+ * @description: 处理 WHEP offer：校验流名和会话数，解析 SDP，创建会话并回 201 + answer
+ * @param {WebrtcImpl *} impl
+ * @param {WebrtcHttpClient *} client
+ * @param {const char *} body
+ * @return {static void}
+ */
+static void webrtc_http_post_offer(WebrtcImpl *impl, WebrtcHttpClient *client, const char *body) {
+    char answer[WEBRTC_SDP_ANSWER_MAX];
+    char headers[WEBRTC_PATH_MAX + 128];
+    WebrtcSdpAnswerParams params;
+    WebrtcSdpOffer *offer;
+    WebrtcPeer *peer;
+    uint64_t session_id = 0;
+    int profile_idc;
+    int answer_len;
+
+    if (webrtc_count_peers(impl, 0) >= impl->config.max_peers || impl->peer_count >= impl->peer_capacity) {
+        impl->counters.rejected_offers++;
+        printf("[WEBRTC][WARN] event=offer_rejected reason=max_peers peers=%d\n", webrtc_count_peers(impl, 0));
+        webrtc_http_reply(impl, client, "503 Service Unavailable", "", NULL, 0);
+        return;
+    }
+    offer = (WebrtcSdpOffer *)calloc(1, sizeof(*offer));
+    peer = (WebrtcPeer *)calloc(1, sizeof(*peer));
+    if (!offer || !peer) {
+        free(offer);
+        free(peer);
+        webrtc_http_reply(impl, client, "500 Internal Server Error", "", NULL, 0);
+        return;
+    }
+    profile_idc = impl->packetizer.sps_len > 1 ? impl->packetizer.sps[1] : 0;
+    if (webrtc_sdp_parse_offer(body, profile_idc, offer) != 0) {
+        impl->counters.rejected_offers++;
+        printf("[WEBRTC][WARN] event=offer_rejected reason=bad_sdp\n");
+        free(offer);
+        free(peer);
+        webrtc_http_reply(impl, client, "400 Bad Request", "", NULL, 0);
+        return;
+    }
+    peer->impl = impl;
+    peer->state = WEBRTC_PEER_CHECKING;
+    peer->dtls_server = webrtc_sdp_answer_is_dtls_server(offer);
+    peer->payload_type = offer->h264_pt;
+    snprintf(peer->remote_ufrag, sizeof(peer->remote_ufrag), "%s", offer->ice_ufrag);
+    snprintf(peer->remote_fingerprint, sizeof(peer->remote_fingerprint), "%s", offer->fingerprint);
+    peer->created_ms = webrtc_now_ms();
+    peer->consent_ms = peer->created_ms;
+    media_rtp_egress_init(&peer->egress, impl->config.gso);
+    media_rtcp_peer_reset(&peer->rtcp);
+    if (webrtc_random_hex(peer->session_id, WEBRTC_SESSION_ID_LEN) != 0 ||
+        webrtc_random_hex(peer->local_ufrag, WEBRTC_UFRAG_LEN) != 0 ||
+        webrtc_random_hex(peer->local_pwd, WEBRTC_PWD_LEN) != 0 ||
+        RAND_bytes((unsigned char *)&session_id, sizeof(session_id)) != 1) {
+        free(offer);
+        free(peer);
+        webrtc_http_reply(impl, client, "500 Internal Server Error", "", NULL, 0);
+        return;
+    }
+
+    memset(&params, 0, sizeof(params));
+    params.ice_ufrag = peer->local_ufrag;
+    params.ice_pwd = peer->local_pwd;
+    params.fingerprint = impl->identity.fingerprint;
+    params.candidate_ip = impl->announce_ip;
+    params.candidate_port = (uint16_t)impl->config.media_port;
+    params.ssrc = impl->packetizer.ssrc;
+    params.stream_name = impl->config.stream_name;
+    params.session_id = session_id >> 1;
+    answer_len = webrtc_sdp_build_answer(offer, &params, answer, sizeof(answer));
+    free(offer);
+    if (answer_len < 0) {
+        free(peer);
+        webrtc_http_reply(impl, client, "500 Internal Server Error", "", NULL, 0);
+        return;
+    }
+    impl->peers[impl->peer_count++] = peer;
+    impl->counters.answers++;
+    printf("[WEBRTC] event=offer_accepted session=%s pt=%d dtls=%s peers=%d\n",
+           peer->session_id,
+           peer->payload_type,
+           peer->dtls_server ? "server" : "client",
+           webrtc_count_peers(impl, 0));
+    snprintf(headers,
+             sizeof(headers),
+             "Content-Type: application/sdp\r\nLocation: %s/%s\r\nAccess-Control-Expose-Headers: Location\r\n",
+             impl->prefix,
+             peer->session_id);
+    webrtc_http_reply(impl, client, "201 Created", headers, answer, (size_t)answer_len);
+}
+
+/**
+ * @description: 请求收齐后分派：POST 建会话，DELETE 结束会话，OPTIONS 回 CORS 预检；不支持 trickle ICE，PATCH 回 405
+ * @param {WebrtcImpl *} impl
+ * @param {WebrtcHttpClient *} client
+ * @param {size_t} header_len
+ * @return {static void}
+ */
+static void webrtc_http_handle_request(WebrtcImpl *impl, WebrtcHttpClient *client, size_t header_len) {
+    char method[16];
+    char path[WEBRTC_PATH_MAX];
+    size_t prefix_len = strlen(impl->prefix);
+    char *query;
+
+    if (sscanf(client->request, "%15s %255s", method, path) != 2) {
+        webrtc_http_reply(impl, client, "400 Bad Request", "", NULL, 0);
+        return;
+    }
+    query = strchr(path, '?');
+    if (query) {
+        *query = '\0';
+    }
+    if (strcmp(method, "OPTIONS") == 0) {
+        webrtc_http_reply(impl,
+                          client,
+                          "204 No Content",
+                          "Access-Control-Allow-Methods: POST, DELETE, OPTIONS\r\n"
+                          "Access-Control-Allow-Headers: Content-Type, Authorization\r\n"
+                          "Access-Control-Expose-Headers: Location\r\n",
+                          NULL,
+                          0);
+        return;
+    }
+    if (strcmp(method, "POST") == 0) {
+        impl->counters.offers++;
+        if (strcmp(path, impl->prefix) != 0) {
+            impl->counters.rejected_offers++;
+            webrtc_http_reply(impl, client, "404 Not Found", "", NULL, 0);
+            return;
+        }
+        webrtc_http_post_offer(impl, client, client->request + header_len);
+        return;
+    }
+    if (strcmp(method, "DELETE") == 0) {
+        WebrtcPeer *peer = NULL;
+
+        if (strncmp(path, impl->prefix, prefix_len) == 0 && path[prefix_len] == '/') {
+            peer = webrtc_find_peer_by_session(impl, path + prefix_len + 1);
+        }
+        if (!peer) {
+            webrtc_http_reply(impl, client, "404 Not Found", "", NULL, 0);
+            return;
+        }
+        impl->counters.sessions_deleted++;
+        webrtc_peer_close(impl, peer, "deleted");
+        webrtc_http_reply(impl, client, "200 OK", "", NULL, 0);
+        return;
+    }
+    webrtc_http_reply(impl, client, "405 Method Not Allowed", "Allow: POST, DELETE, OPTIONS\r\n", NULL, 0);
+}
+
+/**
+ * @description: 在请求头里查找 Content-Length
+ * @param {const char *} request
+ * @param {size_t} header_len
+ * @return {static long} 没有时为 0，非法时为 -1
+ */
+static long webrtc_http_content_length(const char *request, size_t header_len) {
+    const char *line = strstr(request, "\r\n");
+
+    while (line && (size_t)(line - request) < header_len) {
+        line += 2;
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            char *end = NULL;
+            long value = strtol(line + 15, &end, 10);
+
+            return (end == line + 15 || value < 0) ? -1 : value;
+        }
+        line = strstr(line, "\r\n");
+    }
+    return 0;
+}
+
+/**
+ * @description: 处理 HTTP 可读事件：按 Content-Length 收齐请求体后分派
+ * @param {WebrtcImpl *} impl
+ * @param {WebrtcHttpClient *} client
+ * @return {static void}
+ */
+static void webrtc_http_read(WebrtcImpl *impl, WebrtcHttpClient *client) {
+    while (!client->closed && !client->replying) {
+        size_t room = WEBRTC_HTTP_REQUEST_MAX - client->request_len;
+        const char *header_end;
+        size_t header_len;
+        long body_len;
+        ssize_t n;
+
+        if (room == 0) {
+            webrtc_http_reply(impl, client, "413 Payload Too Large", "", NULL, 0);
+            return;
+        }
+        n = recv(client->fd, client->request + client->request_len, room, MSG_DONTWAIT);
+        if (n == 0) {
+            webrtc_http_close(impl, client);
+            return;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                webrtc_http_close(impl, client);
+            }
+            return;
+        }
+        client->request_len += (size_t)n;
+        client->request[client->request_len] = '\0';
+        header_end = strstr(client->request, "\r\n\r\n");
+        if (!header_end) {
+            continue;
+        }
+        header_len = (size_t)(header_end - client->request) + 4;
+        body_len = webrtc_http_content_length(client->request, header_len);
+        if (body_len < 0 || header_len + (size_t)body_len > WEBRTC_HTTP_REQUEST_MAX) {
+            webrtc_http_reply(impl, client, body_len < 0 ? "400 Bad Request" : "413 Payload Too Large", "", NULL, 0);
+            return;
+        }
+        if (client->request_len < header_len + (size_t)body_len) {
+            continue;
+        }
+        client->request[header_len + (size_t)body_len] = '\0';
+        webrtc_http_handle_request(impl, client, header_len);
+    }
+}
+
+/**
+ * @description: 接入新的 HTTP 连接，连接数超出上限时直接关闭
+ * @param {WebrtcImpl *} impl
+ * @return {static void}
+ */
+static void webrtc_http_accept(WebrtcImpl *impl) {
+    while (1) {
+        struct epoll_event ev;
+        WebrtcHttpClient *client;
+        int one = 1;
+        int fd;
+
+        fd = accept4(impl->http_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (impl->client_count >= impl->client_capacity) {
+            close(fd);
+            continue;
+        }
+        client = (WebrtcHttpClient *)calloc(1, sizeof(*client));
+        if (!client) {
+            fprintf(stderr, "[WEBRTC][ERROR] http client alloc failed\n");
+            close(fd);
+            continue;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        client->fd = fd;
+        client->accept_ms = webrtc_now_ms();
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = client;
+        if (epoll_ctl(impl->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            fprintf(stderr, "[WEBRTC][ERROR] epoll add http client failed errno=%d\n", errno);
+            close(fd);
+            free(client);
+            continue;
+        }
+        impl->clients[impl->client_count++] = client;
+    }
+}
+
+/**
+ * @description: 关闭超时未发完请求或写不完响应的 HTTP 连接
+ * @param {WebrtcImpl *} impl
+ * @return {static void}
+ */
+static void webrtc_http_expire(WebrtcImpl *impl) {
+    long long now = webrtc_now_ms();
+    int i;
+
+    for (i = 0; i < impl->client_count; ++i) {
+        if (!impl->clients[i]->closed && now - impl->clients[i]->accept_ms > WEBRTC_HTTP_TIMEOUT_MS) {
+            webrtc_http_close(impl, impl->clients[i]);
+        }
+    }
+}
+
+/**
+ * @description: 从 inbox 取一个帧
+ * @param {WebrtcImpl *} impl
+ * @param {MediaPacket *} packet 输出，引用转交给调用方
+ * @return {static int} 1 取到，0 队列为空
+ */
+static int webrtc_inbox_pop(WebrtcImpl *impl, MediaPacket *packet) {
+    int got = 0;
+
+    pthread_mutex_lock(&impl->lock);
+    if (impl->inbox_size > 0) {
+        *packet = impl->inbox[impl->inbox_head];
+        media_packet_init(&impl->inbox[impl->inbox_head]);
+        impl->inbox_head = (impl->inbox_head + 1) % impl->inbox_capacity;
+        impl->inbox_size--;
+        got = 1;
+    }
+    pthread_mutex_unlock(&impl->lock);
+    return got;
+}
+
+/**
+ * @description: 把服务线程的累计统计发布给外部
+ * @param {WebrtcImpl *} impl
+ * @return {static void}
+ */
+static void webrtc_publish_stats(WebrtcImpl *impl) {
+    impl->counters.peers = webrtc_count_peers(impl, 0);
+    impl->counters.connected_peers = webrtc_count_peers(impl, 1);
+    pthread_mutex_lock(&impl->lock);
+    impl->stats = impl->counters;
+    pthread_mutex_unlock(&impl->lock);
+}
+
+/**
+ * @description: 服务线程主函数：单个 epoll 同时处理信令、媒体 UDP、新帧发送和各类定时器
+ * @param {void *} arg
+ * @return {static void *}
+ */
+static void *webrtc_server_thread(void *arg) {
+    WebrtcImpl *impl = (WebrtcImpl *)arg;
+    struct epoll_event events[WEBRTC_EPOLL_EVENTS];
+
+    while (!impl->stop_requested) {
+        int n = epoll_wait(impl->epoll_fd, events, WEBRTC_EPOLL_EVENTS, WEBRTC_EPOLL_TIMEOUT_MS);
+        int i;
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "[WEBRTC][ERROR] epoll_wait failed errno=%d\n", errno);
+            break;
+        }
+        for (i = 0; i < n; ++i) {
+            void *ptr = events[i].data.ptr;
+
+            if (ptr == &impl->http_fd) {
+                webrtc_http_accept(impl);
+            } else if (ptr == &impl->udp_fd) {
+                webrtc_udp_read(impl);
+            } else if (ptr == &impl->event_fd) {
+                MediaPacket packet;
+                uint64_t value;
+
+                if (read(impl->event_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                    fprintf(stderr, "[WEBRTC][ERROR] eventfd read failed errno=%d\n", errno);
+                }
+                while (!impl->stop_requested && webrtc_inbox_pop(impl, &packet)) {
+                    webrtc_process_frame(impl, &packet);
+                    media_packet_reset(&packet);
+                }
+            } else {
+                WebrtcHttpClient *client = (WebrtcHttpClient *)ptr;
+
+                if (client->closed) {
+                    continue;
+                }
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    webrtc_http_close(impl, client);
+                } else if (client->replying) {
+                    webrtc_http_flush(impl, client);
+                } else if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+                    webrtc_http_read(impl, client);
+                }
+            }
+        }
+        webrtc_expire_peers(impl);
+        webrtc_send_reports(impl);
+        webrtc_http_expire(impl);
+        webrtc_reap_clients(impl);
+        webrtc_reap_peers(impl);
+        webrtc_publish_stats(impl);
+    }
+    return NULL;
+}
+
+/**
+ * @description: 打印运行统计
+ * @param {WebrtcImpl *} impl
+ * @return {static void}
+ */
+static void webrtc_print_stats(WebrtcImpl *impl) {
+    WebrtcSinkStats stats;
+    uint64_t inbox_drops;
+
+    pthread_mutex_lock(&impl->lock);
+    stats = impl->stats;
+    inbox_drops = impl->inbox_drops;
+    pthread_mutex_unlock(&impl->lock);
+    printf("[WEBRTC] event=stats path=%s peers=%d connected=%d offers=%llu answers=%llu rejected=%llu deleted=%llu stun=%llu stun_rejects=%llu dtls_ok=%llu dtls_fail=%llu setup_timeouts=%llu consent_timeouts=%llu frames=%llu rtp=%llu srtp_bytes=%llu nack=%llu retransmitted=%llu too_late=%llu pli=%llu fir=%llu idr_requests=%llu srtcp_errors=%llu sr=%llu inbox_drops=%llu\n",
+           impl->prefix,
+           stats.peers,
+           stats.connected_peers,
+           (unsigned long long)stats.offers,
+           (unsigned long long)stats.answers,
+           (unsigned long long)stats.rejected_offers,
+           (unsigned long long)stats.sessions_deleted,
+           (unsigned long long)stats.stun_requests,
+           (unsigned long long)stats.stun_rejects,
+           (unsigned long long)stats.dtls_handshakes,
+           (unsigned long long)stats.dtls_failures,
+           (unsigned long long)stats.setup_timeouts,
+           (unsigned long long)stats.consent_timeouts,
+           (unsigned long long)stats.frames,
+           (unsigned long long)stats.rtp_packets,
+           (unsigned long long)stats.srtp_bytes,
+           (unsigned long long)stats.nack_requested,
+           (unsigned long long)stats.retransmitted,
+           (unsigned long long)stats.nack_too_late,
+           (unsigned long long)stats.pli,
+           (unsigned long long)stats.fir,
+           (unsigned long long)stats.idr_requests,
+           (unsigned long long)stats.srtcp_errors,
+           (unsigned long long)stats.sr_sent,
+           (unsigned long long)inbox_drops);
+}
+
+/**
+ * @description: 周期统计钩子
+ * @param {MediaSink *} sink
+ * @return {static void}
+ */
+static void webrtc_log_stats(MediaSink *sink) {
+    WebrtcImpl *impl = (WebrtcImpl *)sink->impl;
+
+    if (impl && impl->running) {
+        webrtc_print_stats(impl);
+    }
+}
+
+/**
+ * @description: 关闭所有会话和连接，释放 socket、inbox、重传历史和证书，可重复调用
+ * @param {WebrtcImpl *} impl
+ * @return {static void}
+ */
+static void webrtc_release_server(WebrtcImpl *impl) {
+    MediaPacket packet;
+    int i;
+
+    for (i = 0; i < impl->peer_count; ++i) {
+        webrtc_peer_close(impl, impl->peers[i], "shutdown");
+    }
+    webrtc_reap_peers(impl);
+    for (i = 0; i < impl->client_count; ++i) {
+        webrtc_http_close(impl, impl->clients[i]);
+    }
+    webrtc_reap_clients(impl);
+    if (impl->inbox) {
+        while (webrtc_inbox_pop(impl, &packet)) {
+            media_packet_reset(&packet);
+        }
+    }
+    if (impl->epoll_fd >= 0) {
+        close(impl->epoll_fd);
+        impl->epoll_fd = -1;
+    }
+    if (impl->event_fd >= 0) {
+        close(impl->event_fd);
+        impl->event_fd = -1;
+    }
+    if (impl->http_fd >= 0) {
+        close(impl->http_fd);
+        impl->http_fd = -1;
+    }
+    if (impl->udp_fd >= 0) {
+        close(impl->udp_fd);
+        impl->udp_fd = -1;
+    }
+    free(impl->inbox);
+    impl->inbox = NULL;
+    free(impl->clients);
+    impl->clients = NULL;
+    free(impl->peers);
+    impl->peers = NULL;
+    free(impl->scratch);
+    impl->scratch = NULL;
+    media_rtp_history_deinit(&impl->history);
+    media_rtp_history_arena_deinit(&impl->arena);
+    webrtc_dtls_identity_deinit(&impl->identity);
+    pthread_mutex_lock(&impl->lock);
+    impl->inbox_head = 0;
+    impl->inbox_size = 0;
+    impl->stats.peers = 0;
+    impl->stats.connected_peers = 0;
+    pthread_mutex_unlock(&impl->lock);
+}
+
+/**
+ * @description: 创建非阻塞 HTTP 监听 socket
+ * @param {const WebrtcSinkConfig *} config
+ * @return {static int} socket，失败返回 -1
+ */
+static int webrtc_listen_http(const WebrtcSinkConfig *config) {
+    struct sockaddr_in addr;
+    int one = 1;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)config->http_port);
+    if (inet_pton(AF_INET, config->listen_ip, &addr.sin_addr) != 1) {
+        fprintf(stderr, "[WEBRTC][ERROR] invalid listen_ip=%s\n", config->listen_ip);
+        return -1;
+    }
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "[WEBRTC][ERROR] socket failed errno=%d\n", errno);
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+        fprintf(stderr, "[WEBRTC][ERROR] bind/listen %s:%d failed errno=%d\n", config->listen_ip, config->http_port, errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @description: 创建非阻塞媒体 UDP socket
+ * @param {const WebrtcSinkConfig *} config
+ * @return {static int} socket，失败返回 -1
+ */
+static int webrtc_bind_media(const WebrtcSinkConfig *config) {
+    struct sockaddr_in addr;
+    int sndbuf = WEBRTC_UDP_SNDBUF;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)config->media_port);
+    if (inet_pton(AF_INET, config->listen_ip, &addr.sin_addr) != 1) {
+        return -1;
+    }
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "[WEBRTC][ERROR] bind media udp %s:%d failed errno=%d\n", config->listen_ip, config->media_port, errno);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    return fd;
+}
+
+/**
+ * @description: 确定 ICE host 候选地址：显式配置 > 具体监听地址 > 第一块已启用的非回环 IPv4 网卡
+ * @param {WebrtcImpl *} impl
+ * @return {static void}
+ */
+static void webrtc_detect_announce_ip(WebrtcImpl *impl) {
+    struct ifaddrs *list = NULL;
+    struct ifaddrs *it;
+
+    if (impl->config.announce_ip && impl->config.announce_ip[0] != '\0') {
+        snprintf(impl->announce_ip, sizeof(impl->announce_ip), "%s", impl->config.announce_ip);
+        return;
+    }
+    if (strcmp(impl->config.listen_ip, DEFAULT_WEBRTC_LISTEN_IP) != 0) {
+        snprintf(impl->announce_ip, sizeof(impl->announce_ip), "%s", impl->config.listen_ip);
+        return;
+    }
+    snprintf(impl->announce_ip, sizeof(impl->announce_ip), "127.0.0.1");
+    if (getifaddrs(&list) != 0) {
+        return;
+    }
+    for (it = list; it; it = it->ifa_next) {
+        if (it->ifa_addr && it->ifa_addr->sa_family == AF_INET && (it->ifa_flags & IFF_UP) && !(it->ifa_flags & IFF_LOOPBACK)) {
+            inet_ntop(AF_INET, &((struct sockaddr_in *)it->ifa_addr)->sin_addr, impl->announce_ip, sizeof(impl->announce_ip));
+            break;
+        }
+    }
+    freeifaddrs(list);
+}
+
+/**
+ * @description: 启动服务：生成证书、分配重传历史和加密槽位、打开两个端口并拉起服务线程
+ * @param {MediaSink *} sink
+ * @return {static int}
+ */
+static int webrtc_start(MediaSink *sink) {
+    WebrtcImpl *impl = (WebrtcImpl *)sink->impl;
+    struct epoll_event ev;
+    uint32_t random[3];
+    int i;
+
+    memset(&impl->counters, 0, sizeof(impl->counters));
+    impl->have_frame = 0;
+    atomic_store(&impl->pending_idr, 0);
+    impl->inbox = (MediaPacket *)calloc((size_t)impl->inbox_capacity, sizeof(MediaPacket));
+    impl->clients = (WebrtcHttpClient **)calloc((size_t)impl->client_capacity, sizeof(WebrtcHttpClient *));
+    impl->peers = (WebrtcPeer **)calloc((size_t)impl->peer_capacity, sizeof(WebrtcPeer *));
+    impl->scratch = (uint8_t *)malloc((size_t)MEDIA_RTP_EGRESS_MAX_BATCH * impl->slot_bytes);
+    if (!impl->inbox || !impl->clients || !impl->peers || !impl->scratch ||
+        media_rtp_history_arena_init(&impl->arena, impl->history_bytes) != 0 ||
+        media_rtp_history_init(&impl->history, &impl->arena, impl->history_entries) != 0) {
+        fprintf(stderr, "[WEBRTC][ERROR] start failed: alloc history=%zu entries=%d\n", impl->history_bytes, impl->history_entries);
+        webrtc_release_server(impl);
+        return -1;
+    }
+    for (i = 0; i < impl->inbox_capacity; ++i) {
+        media_packet_init(&impl->inbox[i]);
+    }
+    if (webrtc_dtls_identity_init(&impl->identity) != 0 || RAND_bytes((unsigned char *)random, sizeof(random)) != 1) {
+        fprintf(stderr, "[WEBRTC][ERROR] start failed: dtls identity\n");
+        webrtc_release_server(impl);
+        return -1;
+    }
+    rtsp_rtp_packetizer_init(&impl->packetizer, random[0], (uint16_t)random[1], random[2], (size_t)impl->config.rtp_max_payload);
+    media_rtp_history_reset(&impl->history, impl->packetizer.ssrc);
+    webrtc_detect_announce_ip(impl);
+
+    impl->http_fd = webrtc_listen_http(&impl->config);
+    impl->udp_fd = impl->http_fd >= 0 ? webrtc_bind_media(&impl->config) : -1;
+    if (impl->udp_fd < 0) {
+        webrtc_release_server(impl);
+        return -1;
+    }
+    impl->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    impl->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (impl->event_fd < 0 || impl->epoll_fd < 0) {
+        fprintf(stderr, "[WEBRTC][ERROR] eventfd/epoll create failed errno=%d\n", errno);
+        webrtc_release_server(impl);
+        return -1;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = &impl->http_fd;
+    if (epoll_ctl(impl->epoll_fd, EPOLL_CTL_ADD, impl->http_fd, &ev) != 0) {
+        fprintf(stderr, "[WEBRTC][ERROR] epoll add http failed errno=%d\n", errno);
+        webrtc_release_server(impl);
+        return -1;
+    }
+    ev.data.ptr = &impl->udp_fd;
+    if (epoll_ctl(impl->epoll_fd, EPOLL_CTL_ADD, impl->udp_fd, &ev) != 0) {
+        fprintf(stderr, "[WEBRTC][ERROR] epoll add udp failed errno=%d\n", errno);
+        webrtc_release_server(impl);
+        return -1;
+    }
+    ev.data.ptr = &impl->event_fd;
+    if (epoll_ctl(impl->epoll_fd, EPOLL_CTL_ADD, impl->event_fd, &ev) != 0) {
+        fprintf(stderr, "[WEBRTC][ERROR] epoll add eventfd failed errno=%d\n", errno);
+        webrtc_release_server(impl);
+        return -1;
+    }
+    webrtc_publish_stats(impl);
+
+    impl->stop_requested = 0;
+    if (pthread_create(&impl->thread, NULL, webrtc_server_thread, impl) != 0) {
+        fprintf(stderr, "[WEBRTC][ERROR] start failed: pthread_create\n");
+        webrtc_release_server(impl);
+        return -1;
+    }
+    impl->running = 1;
+    printf("[INFO] WebRTC WHEP serving http://%s:%d%s media=udp://%s:%d fingerprint=%s history=%zu KB\n",
+           impl->config.listen_ip,
+           impl->config.http_port,
+           impl->prefix,
+           impl->announce_ip,
+           impl->config.media_port,
+           impl->identity.fingerprint,
+           impl->history_bytes / 1024);
+    return 0;
+}
+
+/**
+ * @description: WHEP 由播放端发起会话，没有需要建立的下游连接
+ * @param {MediaSink *} sink
+ * @return {static int}
+ */
+static int webrtc_connect(MediaSink *sink) {
+    (void)sink;
+    return 0;
+}
+
+/**
+ * @description: 把帧引用投递给服务线程发送，服务线程跟不上时丢到下一个关键帧
+ * @param {MediaSink *} sink
+ * @param {const MediaPacket *} packet
+ * @return {static int}
+ */
+static int webrtc_send_packet(MediaSink *sink, const MediaPacket *packet) {
+    WebrtcImpl *impl = (WebrtcImpl *)sink->impl;
+    uint64_t one = 1;
+    int tail;
+
+    if (!impl || !packet || !packet->buffer) {
+        return -1;
+    }
+    if (packet->frame_type != MEDIA_FRAME_TYPE_VIDEO || packet->codec != MEDIA_CODEC_H264) {
+        return 0;
+    }
+    if (impl->inbox_need_keyframe && !packet->is_key_frame) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&impl->lock);
+    if (impl->inbox_size >= impl->inbox_capacity) {
+        impl->inbox_drops++;
+        pthread_mutex_unlock(&impl->lock);
+        impl->inbox_need_keyframe = 1;
+        return 0;
+    }
+    tail = (impl->inbox_head + impl->inbox_size) % impl->inbox_capacity;
+    media_packet_copy_ref(&impl->inbox[tail], packet);
+    impl->inbox_size++;
+    pthread_mutex_unlock(&impl->lock);
+    impl->inbox_need_keyframe = 0;
+
+    if (write(impl->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        fprintf(stderr, "[WEBRTC][ERROR] eventfd write failed errno=%d\n", errno);
+    }
+    return 0;
+}
+
+/**
+ * @description: 是否有会话（含握手中的），握手期间也要有帧流过以便起播
+ * @param {MediaSink *} sink
+ * @return {static int}
+ */
+static int webrtc_has_consumer(MediaSink *sink) {
+    WebrtcImpl *impl = (WebrtcImpl *)sink->impl;
+    int peers;
+
+    if (!impl) {
+        return 0;
+    }
+    pthread_mutex_lock(&impl->lock);
+    peers = impl->stats.peers;
+    pthread_mutex_unlock(&impl->lock);
+    return peers > 0;
+}
+
+/**
+ * @description: 停止服务线程并释放所有会话，可重复调用
+ * @param {MediaSink *} sink
+ * @return {static void}
+ */
+static void webrtc_stop(MediaSink *sink) {
+    WebrtcImpl *impl = (WebrtcImpl *)sink->impl;
+    uint64_t one = 1;
+
+    if (!impl) {
+        return;
+    }
+    if (impl->running) {
+        impl->stop_requested = 1;
+        if (write(impl->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            fprintf(stderr, "[WEBRTC][ERROR] eventfd wake failed errno=%d\n", errno);
+        }
+        pthread_join(impl->thread, NULL);
+        impl->running = 0;
+        webrtc_print_stats(impl);
+    }
+    webrtc_release_server(impl);
+    impl->inbox_need_keyframe = 0;
+}
+
+int webrtc_sink_get_stats(MediaSink *sink, WebrtcSinkStats *stats) {
+    WebrtcImpl *impl = sink ? (WebrtcImpl *)sink->impl : NULL;
+
+    if (!impl || !stats) {
+        return -1;
+    }
+    pthread_mutex_lock(&impl->lock);
+    *stats = impl->stats;
+    pthread_mutex_unlock(&impl->lock);
+    return 0;
+}
+
+int webrtc_sink_consume_external_idr_request(MediaSink *sink) {
+    WebrtcImpl *impl = sink ? (WebrtcImpl *)sink->impl : NULL;
+
+    if (!impl) {
+        return 0;
+    }
+    /* exchange 保证同一批请求（新连接、PLI、FIR 可能同时到）只消费一次。 */
+    return atomic_exchange(&impl->pending_idr, 0) ? 1 : 0;
+}
+
+/**
+ * @description: 根据配置创建 WebRTC 输出通道
+ * @param {MediaSink *} sink
+ * @param {const WebrtcSinkConfig *} config
+ * @return {int}
+ */
+int webrtc_sink_setup(MediaSink *sink, const WebrtcSinkConfig *config) {
+    static const MediaSinkVTable vtable = {
+        webrtc_start,
+        webrtc_connect,
+        webrtc_send_packet,
+        NULL,
+        webrtc_stop,
+        webrtc_has_consumer,
+        webrtc_log_stats
+    };
+    MediaSinkConfig sink_config;
+    WebrtcImpl *impl;
+    uint64_t history_bytes;
+    uint64_t entries;
+
+    if (!sink || !config) {
+        fprintf(stderr, "[WEBRTC][ERROR] setup failed: invalid arguments\n");
+        return -1;
+    }
+
+    impl = (WebrtcImpl *)calloc(1, sizeof(*impl));
+    if (!impl) {
+        fprintf(stderr, "[WEBRTC][ERROR] setup failed: impl alloc\n");
+        return -1;
+    }
+    impl->config = *config;
+    if (!impl->config.name) {
+        impl->config.name = DEFAULT_WEBRTC_NAME;
+    }
+    if (!impl->config.listen_ip || impl->config.listen_ip[0] == '\0') {
+        impl->config.listen_ip = DEFAULT_WEBRTC_LISTEN_IP;
+    }
+    if (impl->config.http_port <= 0) {
+        impl->config.http_port = DEFAULT_WEBRTC_HTTP_PORT;
+    }
+    if (impl->config.media_port <= 0) {
+        impl->config.media_port = DEFAULT_WEBRTC_MEDIA_PORT;
+    }
+    if (!impl->config.stream_name || impl->config.stream_name[0] == '\0') {
+        impl->config.stream_name = DEFAULT_WEBRTC_STREAM_NAME;
+    }
+    if (impl->config.queue_capacity <= 0) {
+        impl->config.queue_capacity = DEFAULT_WEBRTC_QUEUE_CAPACITY;
+    }
+    if (impl->config.max_peers <= 0) {
+        impl->config.max_peers = DEFAULT_WEBRTC_MAX_PEERS;
+    }
+    if (impl->config.rtp_max_payload <= 0) {
+        impl->config.rtp_max_payload = DEFAULT_WEBRTC_RTP_MAX_PAYLOAD;
+    }
+    if (impl->config.rtp_max_payload < WEBRTC_RTP_MIN_PAYLOAD) {
+        impl->config.rtp_max_payload = WEBRTC_RTP_MIN_PAYLOAD;
+    }
+    if (impl->config.rtp_max_payload > WEBRTC_RTP_MAX_PAYLOAD_LIMIT) {
+        impl->config.rtp_max_payload = WEBRTC_RTP_MAX_PAYLOAD_LIMIT;
+    }
+    if (impl->config.nack_history_ms <= 0) {
+        impl->config.nack_history_ms = DEFAULT_WEBRTC_NACK_HISTORY_MS;
+    }
+    if (impl->config.rtcp_interval_ms == 0) {
+        impl->config.rtcp_interval_ms = MEDIA_RTCP_DEFAULT_INTERVAL_MS;
+    }
+    if (impl->config.video_fps <= 0) {
+        impl->config.video_fps = DEFAULT_WEBRTC_FPS;
+    }
+    if (impl->config.video_bitrate <= 0) {
+        impl->config.video_bitrate = DEFAULT_WEBRTC_BITRATE;
+    }
+    /* 按两倍码率估算历史时长内的字节数，关键帧突发时仍能回溯到请求的包。 */
+    history_bytes = (uint64_t)impl->config.video_bitrate / 8 * (uint64_t)impl->config.nack_history_ms * 2 / 1000;
+    if (history_bytes < WEBRTC_HISTORY_MIN_BYTES) {
+        history_bytes = WEBRTC_HISTORY_MIN_BYTES;
+    }
+    entries = history_bytes / (uint64_t)impl->config.rtp_max_payload * 2;
+    if (entries < WEBRTC_HISTORY_MIN_ENTRIES) {
+        entries = WEBRTC_HISTORY_MIN_ENTRIES;
+    }
+    if (entries > 32768) {
+        entries = 32768;
+    }
+    snprintf(impl->prefix, sizeof(impl->prefix), "/whep/%s", impl->config.stream_name);
+
+    impl->history_bytes = (size_t)history_bytes;
+    impl->history_entries = (int)entries;
+    impl->slot_bytes = RTSP_RTP_MAX_HEADER + (size_t)impl->config.rtp_max_payload + WEBRTC_SRTP_MAX_OVERHEAD;
+    impl->http_fd = -1;
+    impl->udp_fd = -1;
+    impl->event_fd = -1;
+    impl->epoll_fd = -1;
+    impl->inbox_capacity = impl->config.queue_capacity;
+    impl->client_capacity = impl->config.max_peers + WEBRTC_PENDING_CONNECTIONS;
+    impl->peer_capacity = impl->config.max_peers * 2;
+    atomic_init(&impl->pending_idr, 0);
+    pthread_mutex_init(&impl->lock, NULL);
+
+    memset(&sink_config, 0, sizeof(sink_config));
+    sink_config.name = impl->config.name;
+    sink_config.queue_capacity = impl->config.queue_capacity;
+    sink_config.reconnect_interval_ms = DEFAULT_WEBRTC_RECONNECT_INTERVAL_MS;
+    sink_config.drop_until_keyframe_after_reconnect = 1;
+
+    if (media_sink_init(sink, &sink_config, &vtable, impl) != 0) {
+        fprintf(stderr, "[WEBRTC][ERROR] setup failed: media_sink_init name=%s\n", impl->config.name);
+        pthread_mutex_destroy(&impl->lock);
+        free(impl);
+        return -1;
+    }
+    printf("[INFO] WebRTC configured name=%s listen=%s http=%d media=%d path=%s max_peers=%d rtp_payload=%d nack_history=%dms\n",
+           impl->config.name,
+           impl->config.listen_ip,
+           impl->config.http_port,
+           impl->config.media_port,
+           impl->prefix,
+           impl->config.max_peers,
+           impl->config.rtp_max_payload,
+           impl->config.nack_history_ms);
+    return 0;
+}
@@ -0,0 +1,361 @@
+#include "webrtcSrtp.h"
+
+#include <string.h>
+
+#include <openssl/crypto.h>
+
+#define SRTP_IV_LEN 16
+#define SRTP_RTP_HEADER 12
+#define SRTCP_HEADER 8
+#define SRTCP_E_FLAG 0x80000000U
+#define SRTP_SEQ_HALF 32768
+
+static uint32_t srtp_read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void srtp_write_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/**
+ * @description: 计算 AES-CM 的 IV：(salt << 16) ^ (ssrc << 64) ^ (index << 16)
+ * @param {const uint8_t *} salt 14 字节会话盐
+ * @param {uint32_t} ssrc
+ * @param {uint64_t} index 48 位包序号（SRTP）或 31 位 SRTCP 序号
+ * @param {uint8_t *} iv 输出 16 字节
+ * @return {static void}
+ */
+static void srtp_make_iv(const uint8_t *salt, uint32_t ssrc, uint64_t index, uint8_t *iv) {
+    int i;
+
+    memcpy(iv, salt, WEBRTC_SRTP_MASTER_SALT_LEN);
+    iv[14] = 0;
+    iv[15] = 0;
+    iv[4] ^= (uint8_t)(ssrc >> 24);
+    iv[5] ^= (uint8_t)(ssrc >> 16);
+    iv[6] ^= (uint8_t)(ssrc >> 8);
+    iv[7] ^= (uint8_t)ssrc;
+    for (i = 0; i < 6; ++i) {
+        iv[8 + i] ^= (uint8_t)(index >> (40 - 8 * i));
+    }
+}
+
+/**
+ * @description: 用会话密钥的 AES-128-CTR 生成密钥流并与数据异或，只重置 IV，不重做密钥扩展
+ * @param {WebrtcSrtpKeys *} keys
+ * @param {const uint8_t *} iv
+ * @param {uint8_t *} data 原地加解密
+ * @param {size_t} len
+ * @return {static int} 0 成功，-1 失败
+ */
+static int srtp_apply_keystream(WebrtcSrtpKeys *keys, const uint8_t *iv, uint8_t *data, size_t len) {
+    int out_len = 0;
+
+    if (len == 0) {
+        return 0;
+    }
+    if (EVP_EncryptInit_ex(keys->cipher, NULL, NULL, NULL, iv) != 1 ||
+        EVP_EncryptUpdate(keys->cipher, data, &out_len, data, (int)len) != 1 || out_len != (int)len) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @description: 计算认证标签：HMAC-SHA1(data || roc) 截断到 80 位，roc 为 NULL 时不追加
+ * @param {WebrtcSrtpKeys *} keys
+ * @param {const uint8_t *} data
+ * @param {size_t} len
+ * @param {const uint8_t *} roc 4 字节大端 ROC，SRTCP 为 NULL
+ * @param {uint8_t *} tag 输出 WEBRTC_SRTP_AUTH_TAG_LEN 字节
+ * @return {static int} 0 成功，-1 失败
+ */
+static int srtp_auth_tag(WebrtcSrtpKeys *keys, const uint8_t *data, size_t len, const uint8_t *roc, uint8_t *tag) {
+    uint8_t mac[EVP_MAX_MD_SIZE];
+    unsigned int mac_len = 0;
+
+    if (HMAC_Init_ex(keys->hmac, NULL, 0, NULL, NULL) != 1 || HMAC_Update(keys->hmac, data, len) != 1 ||
+        (roc && HMAC_Update(keys->hmac, roc, 4) != 1) || HMAC_Final(keys->hmac, mac, &mac_len) != 1) {
+        return -1;
+    }
+    memcpy(tag, mac, WEBRTC_SRTP_AUTH_TAG_LEN);
+    return 0;
+}
+
+/**
+ * @description: 释放一组会话密钥
+ * @param {WebrtcSrtpKeys *} keys
+ * @return {static void}
+ */
+static void srtp_keys_deinit(WebrtcSrtpKeys *keys) {
+    if (keys->cipher) {
+        EVP_CIPHER_CTX_free(keys->cipher);
+        keys->cipher = NULL;
+    }
+    if (keys->hmac) {
+        HMAC_CTX_free(keys->hmac);
+        keys->hmac = NULL;
+    }
+    OPENSSL_cleanse(keys->salt, sizeof(keys->salt));
+}
+
+/**
+ * @description: 派生一组会话密钥（加密/认证/盐）并建立对应的 cipher 和 HMAC 上下文
+ * @param {WebrtcSrtpKeys *} keys
+ * @param {const uint8_t *} master_key
+ * @param {const uint8_t *} master_salt
+ * @param {uint8_t} first_label 加密密钥标签，认证和盐依次加一
+ * @return {static int} 0 成功，-1 失败
+ */
+static int srtp_keys_init(WebrtcSrtpKeys *keys, const uint8_t *master_key, const uint8_t *master_salt, uint8_t first_label) {
+    uint8_t cipher_key[WEBRTC_SRTP_MASTER_KEY_LEN];
+    uint8_t auth_key[WEBRTC_SRTP_AUTH_KEY_LEN];
+    int ret = -1;
+
+    memset(keys, 0, sizeof(*keys));
+    if (webrtc_srtp_derive(master_key, master_salt, first_label, cipher_key, sizeof(cipher_key)) != 0 ||
+        webrtc_srtp_derive(master_key, master_salt, (uint8_t)(first_label + 1), auth_key, sizeof(auth_key)) != 0 ||
+        webrtc_srtp_derive(master_key, master_salt, (uint8_t)(first_label + 2), keys->salt, sizeof(keys->salt)) != 0) {
+        goto out;
+    }
+    keys->cipher = EVP_CIPHER_CTX_new();
+    keys->hmac = HMAC_CTX_new();
+    if (!keys->cipher || !keys->hmac ||
+        EVP_EncryptInit_ex(keys->cipher, EVP_aes_128_ctr(), NULL, cipher_key, NULL) != 1 ||
+        HMAC_Init_ex(keys->hmac, auth_key, (int)sizeof(auth_key), EVP_sha1(), NULL) != 1) {
+        goto out;
+    }
+    ret = 0;
+
+out:
+    OPENSSL_cleanse(cipher_key, sizeof(cipher_key));
+    OPENSSL_cleanse(auth_key, sizeof(auth_key));
+    if (ret != 0) {
+        srtp_keys_deinit(keys);
+    }
+    return ret;
+}
+
+/**
+ * @description: 计算 RTP 头长度（固定头 + CSRC + 扩展头），加密从其后开始
+ * @param {const uint8_t *} packet
+ * @param {size_t} len
+ * @return {static int} 头长度，格式错误返回 -1
+ */
+static int srtp_rtp_header_len(const uint8_t *packet, size_t len) {
+    size_t header_len;
+
+    if (len < SRTP_RTP_HEADER || (packet[0] >> 6) != 2) {
+        return -1;
+    }
+    header_len = SRTP_RTP_HEADER + 4U * (packet[0] & 0x0F);
+    if (packet[0] & 0x10) {
+        if (header_len + 4 > len) {
+            return -1;
+        }
+        header_len += 4 + 4U * (size_t)((packet[header_len + 2] << 8) | packet[header_len + 3]);
+    }
+    return header_len <= len ? (int)header_len : -1;
+}
+
+/**
+ * @description: 按 RFC 3711 3.3.1 推算序号对应的 ROC，得到 48 位包序号
+ * @param {const WebrtcSrtpContext *} ctx
+ * @param {uint16_t} seq
+ * @return {static uint64_t}
+ */
+static uint64_t srtp_estimate_index(const WebrtcSrtpContext *ctx, uint16_t seq) {
+    uint32_t v = ctx->roc;
+
+    if (!ctx->rtp_started) {
+        return seq;
+    }
+    if (ctx->highest_seq < SRTP_SEQ_HALF) {
+        if ((int)seq - (int)ctx->highest_seq > SRTP_SEQ_HALF && v > 0) {
+            v--;
+        }
+    } else if ((int)ctx->highest_seq - SRTP_SEQ_HALF > (int)seq) {
+        v++;
+    }
+    return ((uint64_t)v << 16) | seq;
+}
+
+/**
+ * @description: 处理完一个包后推进 ROC 和最大序号
+ * @param {WebrtcSrtpContext *} ctx
+ * @param {uint64_t} index
+ * @return {static void}
+ */
+static void srtp_update_index(WebrtcSrtpContext *ctx, uint64_t index) {
+    uint64_t highest = ((uint64_t)ctx->roc << 16) | ctx->highest_seq;
+
+    if (!ctx->rtp_started || index > highest) {
+        ctx->rtp_started = 1;
+        ctx->roc = (uint32_t)(index >> 16);
+        ctx->highest_seq = (uint16_t)index;
+    }
+}
+
+int webrtc_srtp_derive(const uint8_t *master_key, const uint8_t *master_salt, uint8_t label, uint8_t *out, size_t out_len) {
+    EVP_CIPHER_CTX *cipher;
+    uint8_t iv[SRTP_IV_LEN];
+    int ok;
+
+    if (!master_key || !master_salt || !out) {
+        return -1;
+    }
+    /* x = (label << 48) ^ master_salt，KDR 为 0 时 r 恒为 0；密钥流即 AES-CM(master_key, x << 16) 加密全零。 */
+    memcpy(iv, master_salt, WEBRTC_SRTP_MASTER_SALT_LEN);
+    iv[7] ^= label;
+    iv[14] = 0;
+    iv[15] = 0;
+    memset(out, 0, out_len);
+    cipher = EVP_CIPHER_CTX_new();
+    if (!cipher) {
+        return -1;
+    }
+    {
+        int written = 0;
+
+        ok = EVP_EncryptInit_ex(cipher, EVP_aes_128_ctr(), NULL, master_key, iv) == 1 &&
+             EVP_EncryptUpdate(cipher, out, &written, out, (int)out_len) == 1 && written == (int)out_len;
+    }
+    EVP_CIPHER_CTX_free(cipher);
+    return ok ? 0 : -1;
+}
+
+int webrtc_srtp_init(WebrtcSrtpContext *ctx, const uint8_t *master_key, const uint8_t *master_salt) {
+    if (!ctx || !master_key || !master_salt) {
+        return -1;
+    }
+    memset(ctx, 0, sizeof(*ctx));
+    if (srtp_keys_init(&ctx->rtp, master_key, master_salt, WEBRTC_SRTP_LABEL_RTP_ENCRYPTION) != 0) {
+        return -1;
+    }
+    if (srtp_keys_init(&ctx->rtcp, master_key, master_salt, WEBRTC_SRTP_LABEL_RTCP_ENCRYPTION) != 0) {
+        srtp_keys_deinit(&ctx->rtp);
+        return -1;
+    }
+    return 0;
+}
+
+void webrtc_srtp_deinit(WebrtcSrtpContext *ctx) {
+    if (!ctx) {
+        return;
+    }
+    srtp_keys_deinit(&ctx->rtp);
+    srtp_keys_deinit(&ctx->rtcp);
+    ctx->rtp_started = 0;
+    ctx->roc = 0;
+    ctx->srtcp_index = 0;
+}
+
+int webrtc_srtp_protect_rtp(WebrtcSrtpContext *ctx, uint8_t *packet, size_t len, size_t cap) {
+    uint8_t iv[SRTP_IV_LEN];
+    uint8_t roc[4];
+    uint64_t index;
+    uint16_t seq;
+    int header_len;
+
+    if (!ctx || !ctx->rtp.cipher || !packet || cap < len + WEBRTC_SRTP_AUTH_TAG_LEN) {
+        return -1;
+    }
+    header_len = srtp_rtp_header_len(packet, len);
+    if (header_len < 0) {
+        return -1;
+    }
+    seq = (uint16_t)((packet[2] << 8) | packet[3]);
+    index = srtp_estimate_index(ctx, seq);
+    srtp_make_iv(ctx->rtp.salt, srtp_read_be32(packet + 8), index, iv);
+    if (srtp_apply_keystream(&ctx->rtp, iv, packet + header_len, len - (size_t)header_len) != 0) {
+        return -1;
+    }
+    srtp_write_be32(roc, (uint32_t)(index >> 16));
+    if (srtp_auth_tag(&ctx->rtp, packet, len, roc, packet + len) != 0) {
+        return -1;
+    }
+    srtp_update_index(ctx, index);
+    return (int)(len + WEBRTC_SRTP_AUTH_TAG_LEN);
+}
+
+int webrtc_srtp_unprotect_rtp(WebrtcSrtpContext *ctx, uint8_t *packet, size_t len) {
+    uint8_t tag[WEBRTC_SRTP_AUTH_TAG_LEN];
+    uint8_t iv[SRTP_IV_LEN];
+    uint8_t roc[4];
+    uint64_t index;
+    uint16_t seq;
+    size_t rtp_len;
+    int header_len;
+
+    if (!ctx || !ctx->rtp.cipher || !packet || len < SRTP_RTP_HEADER + WEBRTC_SRTP_AUTH_TAG_LEN) {
+        return -1;
+    }
+    rtp_len = len - WEBRTC_SRTP_AUTH_TAG_LEN;
+    header_len = srtp_rtp_header_len(packet, rtp_len);
+    if (header_len < 0) {
+        return -1;
+    }
+    seq = (uint16_t)((packet[2] << 8) | packet[3]);
+    index = srtp_estimate_index(ctx, seq);
+    srtp_write_be32(roc, (uint32_t)(index >> 16));
+    if (srtp_auth_tag(&ctx->rtp, packet, rtp_len, roc, tag) != 0 ||
+        CRYPTO_memcmp(tag, packet + rtp_len, WEBRTC_SRTP_AUTH_TAG_LEN) != 0) {
+        ctx->auth_failures++;
+        return -1;
+    }
+    srtp_make_iv(ctx->rtp.salt, srtp_read_be32(packet + 8), index, iv);
+    if (srtp_apply_keystream(&ctx->rtp, iv, packet + header_len, rtp_len - (size_t)header_len) != 0) {
+        return -1;
+    }
+    srtp_update_index(ctx, index);
+    return (int)rtp_len;
+}
+
+int webrtc_srtp_protect_rtcp(WebrtcSrtpContext *ctx, uint8_t *packet, size_t len, size_t cap) {
+    uint8_t iv[SRTP_IV_LEN];
+    uint32_t index;
+
+    if (!ctx || !ctx->rtcp.cipher || !packet || len < SRTCP_HEADER || cap < len + WEBRTC_SRTCP_TRAILER_LEN) {
+        return -1;
+    }
+    index = ctx->srtcp_index & 0x7FFFFFFFU;
+    ctx->srtcp_index = (index + 1) & 0x7FFFFFFFU;
+    srtp_make_iv(ctx->rtcp.salt, srtp_read_be32(packet + 4), index, iv);
+    if (srtp_apply_keystream(&ctx->rtcp, iv, packet + SRTCP_HEADER, len - SRTCP_HEADER) != 0) {
+        return -1;
+    }
+    srtp_write_be32(packet + len, SRTCP_E_FLAG | index);
+    if (srtp_auth_tag(&ctx->rtcp, packet, len + 4, NULL, packet + len + 4) != 0) {
+        return -1;
+    }
+    return (int)(len + WEBRTC_SRTCP_TRAILER_LEN);
+}
+
+int webrtc_srtp_unprotect_rtcp(WebrtcSrtpContext *ctx, uint8_t *packet, size_t len) {
+    uint8_t tag[WEBRTC_SRTP_AUTH_TAG_LEN];
+    uint8_t iv[SRTP_IV_LEN];
+    uint32_t trailer;
+    size_t rtcp_len;
+
+    if (!ctx || !ctx->rtcp.cipher || !packet || len < SRTCP_HEADER + WEBRTC_SRTCP_TRAILER_LEN) {
+        return -1;
+    }
+    rtcp_len = len - WEBRTC_SRTCP_TRAILER_LEN;
+    if (srtp_auth_tag(&ctx->rtcp, packet, rtcp_len + 4, NULL, tag) != 0 ||
+        CRYPTO_memcmp(tag, packet + rtcp_len + 4, WEBRTC_SRTP_AUTH_TAG_LEN) != 0) {
+        ctx->auth_failures++;
+        return -1;
+    }
+    trailer = srtp_read_be32(packet + rtcp_len);
+    if (trailer & SRTCP_E_FLAG) {
+        srtp_make_iv(ctx->rtcp.salt, srtp_read_be32(packet + 4), trailer & 0x7FFFFFFFU, iv);
+        if (srtp_apply_keystream(&ctx->rtcp, iv, packet + SRTCP_HEADER, rtcp_len - SRTCP_HEADER) != 0) {
+            return -1;
+        }
+    }
+    return (int)rtcp_len;
+}
@@ -0,0 +1,287 @@
+#include "webrtcStun.h"
+
+#include <string.h>
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#define STUN_ATTR_USERNAME 0x0006
+#define STUN_ATTR_MESSAGE_INTEGRITY 0x0008
+#define STUN_ATTR_XOR_MAPPED_ADDRESS 0x0020
+#define STUN_ATTR_PRIORITY 0x0024
+#define STUN_ATTR_USE_CANDIDATE 0x0025
+#define STUN_ATTR_FINGERPRINT 0x8028
+#define STUN_ATTR_ICE_CONTROLLING 0x802A
+#define STUN_INTEGRITY_LEN 20
+#define STUN_FINGERPRINT_XOR 0x5354554EU
+
+typedef struct {
+    uint8_t *buf;                  /* 输出缓冲。 */
+    size_t cap;                    /* 缓冲大小。 */
+    size_t len;                    /* 已写长度。 */
+    int overflow;                  /* 是否写越界。 */
+} StunWriter;
+
+static uint16_t stun_read_be16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t stun_read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void stun_write_be16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void stun_write_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/**
+ * @description: FINGERPRINT 用的 CRC-32（ISO-HDLC，与 zlib 相同）；STUN 报文很短，按位计算即可
+ * @param {const uint8_t *} data
+ * @param {size_t} len
+ * @return {static uint32_t}
+ */
+static uint32_t stun_crc32(const uint8_t *data, size_t len) {
+    uint32_t crc = 0xFFFFFFFFU;
+    size_t i;
+    int bit;
+
+    for (i = 0; i < len; ++i) {
+        crc ^= data[i];
+        for (bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+    return crc ^ 0xFFFFFFFFU;
+}
+
+/**
+ * @description: 追加一个属性，值按 4 字节补齐
+ * @param {StunWriter *} w
+ * @param {uint16_t} type
+ * @param {const void *} value 可为 NULL，此时只预留空间（内容补零）
+ * @param {size_t} len
+ * @return {static uint8_t *} 属性值的起始位置，越界时返回 NULL
+ */
+static uint8_t *stun_put_attr(StunWriter *w, uint16_t type, const void *value, size_t len) {
+    size_t padded = (len + 3) & ~(size_t)3;
+    uint8_t *p;
+
+    if (w->overflow || w->len + 4 + padded > w->cap) {
+        w->overflow = 1;
+        return NULL;
+    }
+    p = w->buf + w->len;
+    stun_write_be16(p, type);
+    stun_write_be16(p + 2, (uint16_t)len);
+    memset(p + 4, 0, padded);
+    if (value) {
+        memcpy(p + 4, value, len);
+    }
+    w->len += 4 + padded;
+    /* 长度字段随每个属性更新，MESSAGE-INTEGRITY/FINGERPRINT 计算时要求已包含自身。 */
+    stun_write_be16(w->buf + 2, (uint16_t)(w->len - WEBRTC_STUN_HEADER));
+    return p + 4;
+}
+
+/**
+ * @description: 写 STUN 头
+ * @param {StunWriter *} w
+ * @param {uint16_t} type
+ * @param {const uint8_t *} transaction_id
+ * @return {static void}
+ */
+static void stun_begin(StunWriter *w, uint16_t type, const uint8_t *transaction_id) {
+    if (w->cap < WEBRTC_STUN_HEADER) {
+        w->overflow = 1;
+        return;
+    }
+    stun_write_be16(w->buf, type);
+    stun_write_be16(w->buf + 2, 0);
+    stun_write_be32(w->buf + 4, WEBRTC_STUN_MAGIC_COOKIE);
+    memcpy(w->buf + 8, transaction_id, WEBRTC_STUN_TRANSACTION_ID_LEN);
+    w->len = WEBRTC_STUN_HEADER;
+}
+
+/**
+ * @description: 收尾：追加 MESSAGE-INTEGRITY（HMAC-SHA1，密钥为 ice-pwd）和 FINGERPRINT
+ * @param {StunWriter *} w
+ * @param {const char *} password
+ * @return {static int} 报文长度，越界返回 -1
+ */
+static int stun_finish(StunWriter *w, const char *password) {
+    unsigned int mac_len = 0;
+    uint8_t *value;
+    size_t covered;
+
+    covered = w->len;
+    value = stun_put_attr(w, STUN_ATTR_MESSAGE_INTEGRITY, NULL, STUN_INTEGRITY_LEN);
+    if (!value ||
+        !HMAC(EVP_sha1(), password, (int)strlen(password), w->buf, covered, value, &mac_len) ||
+        mac_len != STUN_INTEGRITY_LEN) {
+        return -1;
+    }
+    covered = w->len;
+    value = stun_put_attr(w, STUN_ATTR_FINGERPRINT, NULL, 4);
+    if (!value) {
+        return -1;
+    }
+    stun_write_be32(value, stun_crc32(w->buf, covered) ^ STUN_FINGERPRINT_XOR);
+    return (int)w->len;
+}
+
+int webrtc_stun_is_message(const uint8_t *buf, size_t len) {
+    return buf && len >= WEBRTC_STUN_HEADER && buf[0] < 4 && stun_read_be32(buf + 4) == WEBRTC_STUN_MAGIC_COOKIE;
+}
+
+int webrtc_stun_parse(const uint8_t *buf, size_t len, WebrtcStunMessage *msg) {
+    size_t body_len;
+    size_t off;
+
+    if (!msg || !webrtc_stun_is_message(buf, len)) {
+        return -1;
+    }
+    body_len = stun_read_be16(buf + 2);
+    if ((body_len & 3) != 0 || WEBRTC_STUN_HEADER + body_len != len) {
+        return -1;
+    }
+    memset(msg, 0, sizeof(*msg));
+    msg->type = stun_read_be16(buf);
+    memcpy(msg->transaction_id, buf + 8, WEBRTC_STUN_TRANSACTION_ID_LEN);
+
+    off = WEBRTC_STUN_HEADER;
+    while (off + 4 <= len) {
+        uint16_t type = stun_read_be16(buf + off);
+        size_t attr_len = stun_read_be16(buf + off + 2);
+        const uint8_t *value = buf + off + 4;
+
+        if (off + 4 + attr_len > len) {
+            return -1;
+        }
+        if (type == STUN_ATTR_FINGERPRINT) {
+            uint8_t copy[4];
+
+            /* FINGERPRINT 必须是最后一个属性，CRC 覆盖它之前的全部内容。 */
+            if (attr_len != 4 || off + 8 != len) {
+                return -1;
+            }
+            memcpy(copy, value, 4);
+            if (stun_read_be32(copy) != (stun_crc32(buf, off) ^ STUN_FINGERPRINT_XOR)) {
+                return -1;
+            }
+            break;
+        }
+        /* MESSAGE-INTEGRITY 之后除 FINGERPRINT 外的属性都不受保护，忽略。 */
+        if (msg->integrity_offset == 0) {
+            if (type == STUN_ATTR_USERNAME && attr_len < sizeof(msg->username)) {
+                memcpy(msg->username, value, attr_len);
+                msg->username[attr_len] = '\0';
+            } else if (type == STUN_ATTR_MESSAGE_INTEGRITY) {
+                if (attr_len != STUN_INTEGRITY_LEN) {
+                    return -1;
+                }
+                msg->integrity_offset = off;
+            } else if (type == STUN_ATTR_USE_CANDIDATE) {
+                msg->use_candidate = 1;
+            } else if (type == STUN_ATTR_PRIORITY && attr_len == 4) {
+                msg->priority = stun_read_be32(value);
+            } else if (type == STUN_ATTR_XOR_MAPPED_ADDRESS && attr_len == 8 && value[1] == 0x01) {
+                msg->mapped.sin_family = AF_INET;
+                msg->mapped.sin_port = htons((uint16_t)(stun_read_be16(value + 2) ^ (WEBRTC_STUN_MAGIC_COOKIE >> 16)));
+                msg->mapped.sin_addr.s_addr = htonl(stun_read_be32(value + 4) ^ WEBRTC_STUN_MAGIC_COOKIE);
+                msg->has_mapped = 1;
+            }
+        }
+        off += 4 + ((attr_len + 3) & ~(size_t)3);
+    }
+    return 0;
+}
+
+int webrtc_stun_check_integrity(const uint8_t *buf, size_t len, const WebrtcStunMessage *msg, const char *password) {
+    uint8_t copy[WEBRTC_STUN_MAX];
+    uint8_t mac[EVP_MAX_MD_SIZE];
+    unsigned int mac_len = 0;
+    size_t off;
+
+    if (!buf || !msg || !password || msg->integrity_offset == 0) {
+        return 0;
+    }
+    off = msg->integrity_offset;
+    if (off + 4 + STUN_INTEGRITY_LEN > len || off > sizeof(copy)) {
+        return 0;
+    }
+    /* HMAC 覆盖 MESSAGE-INTEGRITY 之前的内容，头部长度字段按截止到 MESSAGE-INTEGRITY 末尾计算。 */
+    memcpy(copy, buf, off);
+    stun_write_be16(copy + 2, (uint16_t)(off + 4 + STUN_INTEGRITY_LEN - WEBRTC_STUN_HEADER));
+    if (!HMAC(EVP_sha1(), password, (int)strlen(password), copy, off, mac, &mac_len) || mac_len != STUN_INTEGRITY_LEN) {
+        return 0;
+    }
+    return CRYPTO_memcmp(mac, buf + off + 4, STUN_INTEGRITY_LEN) == 0;
+}
+
+int webrtc_stun_build_binding_response(uint8_t *buf,
+                                       size_t cap,
+                                       const uint8_t *transaction_id,
+                                       const struct sockaddr_in *mapped,
+                                       const char *password) {
+    StunWriter w;
+    uint8_t *value;
+
+    if (!buf || !transaction_id || !mapped || !password) {
+        return -1;
+    }
+    memset(&w, 0, sizeof(w));
+    w.buf = buf;
+    w.cap = cap;
+    stun_begin(&w, WEBRTC_STUN_BINDING_SUCCESS, transaction_id);
+    value = stun_put_attr(&w, STUN_ATTR_XOR_MAPPED_ADDRESS, NULL, 8);
+    if (!value) {
+        return -1;
+    }
+    value[1] = 0x01;
+    stun_write_be16(value + 2, (uint16_t)(ntohs(mapped->sin_port) ^ (WEBRTC_STUN_MAGIC_COOKIE >> 16)));
+    stun_write_be32(value + 4, ntohl(mapped->sin_addr.s_addr) ^ WEBRTC_STUN_MAGIC_COOKIE);
+    return stun_finish(&w, password);
+}
+
+int webrtc_stun_build_binding_request(uint8_t *buf,
+                                      size_t cap,
+                                      const uint8_t *transaction_id,
+                                      const char *username,
+                                      const char *password,
+                                      uint32_t priority,
+                                      uint64_t tie_breaker,
+                                      int use_candidate) {
+    StunWriter w;
+    uint8_t *value;
+
+    if (!buf || !transaction_id || !username || !password) {
+        return -1;
+    }
+    memset(&w, 0, sizeof(w));
+    w.buf = buf;
+    w.cap = cap;
+    stun_begin(&w, WEBRTC_STUN_BINDING_REQUEST, transaction_id);
+    stun_put_attr(&w, STUN_ATTR_USERNAME, username, strlen(username));
+    value = stun_put_attr(&w, STUN_ATTR_PRIORITY, NULL, 4);
+    if (value) {
+        stun_write_be32(value, priority);
+    }
+    value = stun_put_attr(&w, STUN_ATTR_ICE_CONTROLLING, NULL, 8);
+    if (value) {
+        stun_write_be32(value, (uint32_t)(tie_breaker >> 32));
+        stun_write_be32(value + 4, (uint32_t)tie_breaker);
+    }
+    if (use_candidate) {
+        stun_put_attr(&w, STUN_ATTR_USE_CANDIDATE, NULL, 0);
+    }
+    return stun_finish(&w, password);
+}
@@ -38,6 +38,10 @@ int main(int argc, char **argv)
     config.enable_rtsp = cfg_int("GATEWAY_ENABLE_RTSP", 1);
     config.enable_rtmp = cfg_int("GATEWAY_ENABLE_RTMP", 0);
     config.enable_gb28181 = cfg_int("GATEWAY_ENABLE_GB28181", 1);
+    config.enable_http_flv = cfg_int("GATEWAY_ENABLE_HTTP_FLV", 0);
+    config.enable_ts_udp = cfg_int("GATEWAY_ENABLE_TS_UDP", 0);
+    config.enable_ll_hls = cfg_int("GATEWAY_ENABLE_LL_HLS", 0);
+    config.enable_webrtc = cfg_int("GATEWAY_ENABLE_WEBRTC", 0);
     config.fps = cfg_int("GATEWAY_FPS", 30);
     config.bitrate = cfg_int("GATEWAY_BITRATE", 2 * 1024 * 1024);
     config.gop = cfg_int("GATEWAY_GOP", 30);
@@ -85,7 +89,10 @@ int main(int argc, char **argv)
     config.rtmp.publish_url = cfg_str("RTMP_PUBLISH_URL", "rtmp://192.168.1.2/live/stream");
     config.rtmp.queue_capacity = cfg_int("RTMP_QUEUE_CAPACITY", 64);
     config.rtmp.reconnect_interval_ms = cfg_int("RTMP_RECONNECT_INTERVAL_MS", 1000);
+    config.rtmp.max_reconnect_interval_ms = cfg_int("RTMP_MAX_RECONNECT_INTERVAL_MS", 30000);
     config.rtmp.connect_timeout_ms = cfg_int("RTMP_CONNECT_TIMEOUT_MS", 3000);
+    config.rtmp.chunk_size = cfg_int("RTMP_CHUNK_SIZE", 4096);
+    config.rtmp.send_timeout_ms = cfg_int("RTMP_SEND_TIMEOUT_MS", 2000);
     config.rtmp.audio_enabled = cfg_int("RTMP_AUDIO_ENABLED", 0);
     config.rtmp.video_width = cfg_int("RTMP_VIDEO_WIDTH", CAPTURE_WIDTH);
     config.rtmp.video_height = cfg_int("RTMP_VIDEO_HEIGHT", CAPTURE_HEIGHT);
@@ -94,6 +101,57 @@ int main(int argc, char **argv)
     config.rtmp.video_codec_name = cfg_str("RTMP_VIDEO_CODEC_NAME", "H264");
     config.rtmp.encoder_name = cfg_str("RTMP_ENCODER_NAME", "RKMediaGateway");
 
+    /* HttpFlvSinkConfig */
+    config.http_flv.name = cfg_str("HTTP_FLV_NAME", "http-flv");
+    config.http_flv.listen_ip = cfg_str("HTTP_FLV_LISTEN_IP", "0.0.0.0");
+    config.http_flv.listen_port = cfg_int("HTTP_FLV_PORT", 8080);
+    config.http_flv.stream_name = cfg_str("HTTP_FLV_STREAM_NAME", "main");
+    config.http_flv.queue_capacity = cfg_int("HTTP_FLV_QUEUE_CAPACITY", 64);
+    config.http_flv.max_clients = cfg_int("HTTP_FLV_MAX_CLIENTS", 32);
+    config.http_flv.client_budget_bytes = cfg_int("HTTP_FLV_CLIENT_BUDGET_BYTES", 4 * 1024 * 1024);
+    config.http_flv.gop_cache_max_frames = cfg_int("HTTP_FLV_GOP_CACHE_MAX_FRAMES", config.gop * 2);
+    config.http_flv.encoder_name = cfg_str("RTMP_ENCODER_NAME", "RKMediaGateway");
+
+    /* TsUdpSinkConfig */
+    config.ts_udp.name = cfg_str("TS_UDP_NAME", "ts-udp");
+    config.ts_udp.dest_ip = cfg_str("TS_UDP_DEST_IP", "239.0.0.1");
+    config.ts_udp.dest_port = cfg_int("TS_UDP_DEST_PORT", 1234);
+    config.ts_udp.multicast_ttl = cfg_int("TS_UDP_MULTICAST_TTL", 1);
+    config.ts_udp.multicast_interface = cfg_str("TS_UDP_MULTICAST_INTERFACE", "");
+    config.ts_udp.queue_capacity = cfg_int("TS_UDP_QUEUE_CAPACITY", 64);
+    config.ts_udp.packets_per_datagram = cfg_int("TS_UDP_PACKETS_PER_DATAGRAM", 7);
+    config.ts_udp.gso = cfg_int("TS_UDP_GSO", 1);
+    config.ts_udp.pacing = cfg_int("TS_UDP_PACING_ENABLE", 1);
+    config.ts_udp.pacing_rate_percent = cfg_int("TS_UDP_PACING_RATE_PERCENT", 200);
+    config.ts_udp.pacing_burst_bytes = cfg_int("TS_UDP_PACING_BURST_BYTES", 16384);
+    config.ts_udp.pacing_spread_percent = cfg_int("TS_UDP_PACING_SPREAD_PERCENT", 50);
+
+    /* LlHlsSinkConfig */
+    config.ll_hls.name = cfg_str("LL_HLS_NAME", "ll-hls");
+    config.ll_hls.listen_ip = cfg_str("LL_HLS_LISTEN_IP", "0.0.0.0");
+    config.ll_hls.listen_port = cfg_int("LL_HLS_PORT", 8088);
+    config.ll_hls.stream_name = cfg_str("LL_HLS_STREAM_NAME", "main");
+    config.ll_hls.queue_capacity = cfg_int("LL_HLS_QUEUE_CAPACITY", 64);
+    config.ll_hls.max_clients = cfg_int("LL_HLS_MAX_CLIENTS", 32);
+    config.ll_hls.segment_target_ms = cfg_int("LL_HLS_SEGMENT_MS", 2000);
+    config.ll_hls.part_target_ms = cfg_int("LL_HLS_PART_MS", 200);
+    config.ll_hls.playlist_segments = cfg_int("LL_HLS_PLAYLIST_SEGMENTS", 6);
+    config.ll_hls.segment_max_bytes = cfg_int("LL_HLS_SEGMENT_MAX_BYTES", 0);
+
+    /* WebrtcSinkConfig */
+    config.webrtc.name = cfg_str("WEBRTC_NAME", "webrtc");
+    config.webrtc.listen_ip = cfg_str("WEBRTC_LISTEN_IP", "0.0.0.0");
+    config.webrtc.http_port = cfg_int("WEBRTC_HTTP_PORT", 8090);
+    config.webrtc.media_port = cfg_int("WEBRTC_MEDIA_PORT", 8092);
+    config.webrtc.announce_ip = cfg_str("WEBRTC_ANNOUNCE_IP", "");
+    config.webrtc.stream_name = cfg_str("WEBRTC_STREAM_NAME", "main");
+    config.webrtc.queue_capacity = cfg_int("WEBRTC_QUEUE_CAPACITY", 64);
+    config.webrtc.max_peers = cfg_int("WEBRTC_MAX_PEERS", 8);
+    config.webrtc.rtp_max_payload = cfg_int("WEBRTC_RTP_MAX_PAYLOAD", 1200);
+    config.webrtc.nack_history_ms = cfg_int("WEBRTC_NACK_HISTORY_MS", 1000);
+    config.webrtc.rtcp_interval_ms = cfg_int("WEBRTC_RTCP_INTERVAL_MS", 1000);
+    config.webrtc.gso = cfg_int("WEBRTC_GSO", 1);
+
     /* Gb28181SinkConfig */
     config.gb28181.name = cfg_str("GB28181_NAME", "gb28181");
     config.gb28181.server_ip = cfg_str("GB28181_SERVER_IP", "192.168.1.1");
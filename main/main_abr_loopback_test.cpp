@@ -0,0 +1,292 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+#include "mediaGatewayAbr.h"
+#include "mediaSink.h"
+}
+
+#define TEST_FPS 30
+#define TEST_GOP 30
+#define TEST_QUEUE_CAPACITY 32
+#define TEST_INITIAL_BITRATE (4 * 1024 * 1024)
+#define TEST_MIN_BITRATE (256 * 1024)
+#define TEST_DEFAULT_DURATION_SEC 24
+#define TEST_DEFAULT_THROTTLE_KBPS 1000
+#define TEST_RETUNE_FPS 20
+#define TEST_RETUNE_STEP_US 600000ULL
+#define TEST_RETUNE_MAX_STEPS 64
+
+/*
+ * 限速回环 sink：send_packet 按配置的链路速率 sleep，模拟上行带宽不足。
+ * 运行分两段：前半段限速 throttle_kbps，验证 ABR 把码率压到链路能力以下并停止丢帧；
+ * 后半段放开到 8 倍，验证 ABR 在滞回保持后逐步回升。
+ * 回环之前先用合成观测值检查手动调参：降帧后手动改帧率和码率，恢复不能回到旧配置。
+ *
+ * 用法：abr_loopback_test [duration_sec] [throttle_kbps]
+ */
+
+typedef struct {
+    volatile int link_kbps;
+} ThrottleSinkImpl;
+
+static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static void feed_abr_sample(MediaGatewayAbr *abr, uint64_t *now, int queue_depth, MediaGatewayAbrDecision *decision) {
+    MediaGatewayAbrSample sample;
+
+    media_gateway_abr_sample_reset(&sample);
+    sample.connected = 1;
+    sample.queue_depth = queue_depth;
+    sample.queue_capacity = TEST_QUEUE_CAPACITY;
+    *now += TEST_RETUNE_STEP_US;
+    media_gateway_abr_update(abr, &sample, *now, decision);
+}
+
+/*
+ * 拥塞到帧率下限后手动把帧率改成 TEST_RETUNE_FPS，随后的恢复只能抬码率，帧率不能回到初始帧率；
+ * 再手动把码率减半，码率上下限随之缩放，恢复不能超过新的上限。
+ */
+static int check_retune_then_recover(void) {
+    MediaGatewayAbrConfig config;
+    MediaGatewayAbr abr;
+    MediaGatewayAbrDecision decision;
+    uint64_t now = 1000000ULL;
+    int retuned_bitrate = TEST_INITIAL_BITRATE / 2;
+    int up_steps = 0;
+    int i;
+
+    memset(&config, 0, sizeof(config));
+    config.enabled = 1;
+    config.min_bitrate = TEST_MIN_BITRATE;
+    config.max_bitrate = TEST_INITIAL_BITRATE;
+    config.min_fps = TEST_FPS / 2;
+    config.up_hold_ms = 1000;
+    media_gateway_abr_init(&abr, &config, TEST_INITIAL_BITRATE, TEST_FPS);
+
+    for (i = 0; i < TEST_RETUNE_MAX_STEPS && abr.current_fps > config.min_fps; ++i) {
+        feed_abr_sample(&abr, &now, TEST_QUEUE_CAPACITY, &decision);
+    }
+    if (abr.current_fps != config.min_fps || abr.current_bitrate != TEST_MIN_BITRATE) {
+        fprintf(stderr, "[ERROR] retune check: congestion did not reach fps=%d bitrate=%d (fps=%d bitrate=%d)\n",
+                config.min_fps, TEST_MIN_BITRATE, abr.current_fps, abr.current_bitrate);
+        return -1;
+    }
+
+    media_gateway_abr_retune(&abr, 0, TEST_RETUNE_FPS);
+    for (i = 0; i < TEST_RETUNE_MAX_STEPS; ++i) {
+        feed_abr_sample(&abr, &now, 0, &decision);
+        if (decision.action == MEDIA_GATEWAY_ABR_UP) up_steps++;
+        if (abr.current_fps != TEST_RETUNE_FPS) {
+            fprintf(stderr, "[ERROR] retune check: recovery moved fps to %d, retuned fps=%d\n",
+                    abr.current_fps, TEST_RETUNE_FPS);
+            return -1;
+        }
+    }
+    if (up_steps == 0 || abr.current_bitrate != TEST_INITIAL_BITRATE) {
+        fprintf(stderr, "[ERROR] retune check: bitrate did not recover to %d (bitrate=%d ups=%d)\n",
+                TEST_INITIAL_BITRATE, abr.current_bitrate, up_steps);
+        return -1;
+    }
+
+    media_gateway_abr_retune(&abr, retuned_bitrate, 0);
+    if (abr.config.max_bitrate != retuned_bitrate || abr.config.min_bitrate != TEST_MIN_BITRATE / 2) {
+        fprintf(stderr, "[ERROR] retune check: bounds not rescaled (%d..%d)\n",
+                abr.config.min_bitrate, abr.config.max_bitrate);
+        return -1;
+    }
+    for (i = 0; i < TEST_RETUNE_MAX_STEPS / 4; ++i) {
+        feed_abr_sample(&abr, &now, TEST_QUEUE_CAPACITY, &decision);
+    }
+    for (i = 0; i < TEST_RETUNE_MAX_STEPS; ++i) {
+        feed_abr_sample(&abr, &now, 0, &decision);
+        if (abr.current_bitrate > retuned_bitrate || abr.current_fps > TEST_RETUNE_FPS) {
+            fprintf(stderr, "[ERROR] retune check: recovery exceeded retuned config (bitrate=%d fps=%d)\n",
+                    abr.current_bitrate, abr.current_fps);
+            return -1;
+        }
+    }
+    if (abr.current_bitrate != retuned_bitrate || abr.current_fps != TEST_RETUNE_FPS) {
+        fprintf(stderr, "[ERROR] retune check: did not recover to retuned config (bitrate=%d fps=%d)\n",
+                abr.current_bitrate, abr.current_fps);
+        return -1;
+    }
+    printf("[INFO] retune check passed fps=%d bitrate=%d range=%d..%d\n",
+           abr.current_fps, abr.current_bitrate, abr.config.min_bitrate, abr.config.max_bitrate);
+    return 0;
+}
+
+static int throttle_connect(MediaSink *sink) {
+    (void)sink;
+    return 0;
+}
+
+static int throttle_send_packet(MediaSink *sink, const MediaPacket *packet) {
+    ThrottleSinkImpl *impl = (ThrottleSinkImpl *)sink->impl;
+    uint64_t cost_us = (uint64_t)packet->buffer->size * 8ULL * 1000ULL / (uint64_t)impl->link_kbps;
+    usleep((useconds_t)cost_us);
+    return 0;
+}
+
+static const MediaSinkVTable g_throttle_vtable = {
+    NULL,
+    throttle_connect,
+    throttle_send_packet,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
+
+int main(int argc, char **argv) {
+    int duration_sec = (argc > 1) ? atoi(argv[1]) : TEST_DEFAULT_DURATION_SEC;
+    int throttle_kbps = (argc > 2) ? atoi(argv[2]) : TEST_DEFAULT_THROTTLE_KBPS;
+    ThrottleSinkImpl impl;
+    MediaSink sink;
+    MediaSinkConfig sink_config;
+    MediaGatewayAbrConfig abr_config;
+    MediaGatewayAbr abr;
+    MediaGatewayAbrSinkCursor cursor;
+    uint8_t *frame_data;
+    uint64_t start_us;
+    uint64_t next_frame_us;
+    uint64_t frame_id = 0;
+    uint64_t phase1_tail_drops = 0;
+    int bitrate = TEST_INITIAL_BITRATE;
+    int fps = TEST_FPS;
+    int phase1_end_bitrate = 0;
+    int phase = 1;
+    int ret = 0;
+
+    if (duration_sec < 8) duration_sec = 8;
+    if (throttle_kbps <= 0) throttle_kbps = TEST_DEFAULT_THROTTLE_KBPS;
+    if (check_retune_then_recover() != 0) return -1;
+
+    memset(&impl, 0, sizeof(impl));
+    impl.link_kbps = throttle_kbps;
+    memset(&sink_config, 0, sizeof(sink_config));
+    sink_config.name = "throttle-loopback";
+    sink_config.queue_capacity = TEST_QUEUE_CAPACITY;
+    if (media_sink_init(&sink, &sink_config, &g_throttle_vtable, &impl) != 0 || media_sink_start(&sink) != 0) {
+        fprintf(stderr, "[ERROR] throttle sink start failed\n");
+        return -1;
+    }
+
+    memset(&abr_config, 0, sizeof(abr_config));
+    abr_config.enabled = 1;
+    abr_config.min_bitrate = TEST_MIN_BITRATE;
+    abr_config.max_bitrate = TEST_INITIAL_BITRATE;
+    abr_config.min_fps = TEST_FPS / 2;
+    abr_config.up_hold_ms = 2000;
+    media_gateway_abr_init(&abr, &abr_config, bitrate, fps);
+    memset(&cursor, 0, sizeof(cursor));
+
+    frame_data = (uint8_t *)calloc(1, (size_t)TEST_INITIAL_BITRATE / 8);
+    if (!frame_data) {
+        media_sink_deinit(&sink);
+        return -1;
+    }
+
+    printf("[INFO] abr loopback start duration=%ds link=%dkbps initial_bitrate=%d\n",
+           duration_sec, throttle_kbps, bitrate);
+    start_us = now_us();
+    next_frame_us = start_us;
+    while (now_us() - start_us < (uint64_t)duration_sec * 1000000ULL) {
+        uint64_t now = now_us();
+        MediaBuffer *buffer = NULL;
+        MediaPacket packet;
+        MediaGatewayAbrSample sample;
+        MediaGatewayAbrDecision decision;
+        MediaSinkStats stats;
+        size_t frame_size = (size_t)bitrate / 8 / (size_t)fps;
+
+        if (phase == 1 && now - start_us >= (uint64_t)duration_sec * 500000ULL) {
+            media_sink_get_stats(&sink, &stats);
+            phase1_end_bitrate = abr.current_bitrate;
+            phase1_tail_drops = stats.dropped_frames;
+            impl.link_kbps = throttle_kbps * 8;
+            phase = 2;
+            printf("[INFO] phase2 link=%dkbps\n", impl.link_kbps);
+        }
+
+        if (media_buffer_create_copy(frame_data, frame_size, &buffer) == 0) {
+            media_packet_init(&packet);
+            packet.frame_type = MEDIA_FRAME_TYPE_VIDEO;
+            packet.codec = MEDIA_CODEC_H264;
+            packet.buffer = buffer;
+            packet.frame_id = frame_id;
+            packet.pts_us = now;
+            packet.dts_us = now;
+            packet.is_key_frame = (frame_id % TEST_GOP) == 0;
+            media_sink_enqueue(&sink, &packet);
+            media_packet_reset(&packet);
+        }
+        frame_id++;
+
+        if (media_gateway_abr_due(&abr, now)) {
+            media_sink_get_stats(&sink, &stats);
+            media_gateway_abr_sample_reset(&sample);
+            media_gateway_abr_sample_add_sink(&sample, &cursor, &stats, sink.queue_capacity, now);
+            if (media_gateway_abr_update(&abr, &sample, now, &decision)) {
+                printf("[ABR] t=%.1fs action=%s reason=%s bitrate=%d->%d fps=%d->%d queue=%d/%d age_ms=%" PRIu64
+                       " drops=%" PRIu64 " send_kbps=%.1f\n",
+                       (double)(now - start_us) / 1000000.0,
+                       (decision.action == MEDIA_GATEWAY_ABR_DOWN) ? "down" : "up",
+                       decision.reason,
+                       decision.old_bitrate,
+                       decision.new_bitrate,
+                       decision.old_fps,
+                       decision.new_fps,
+                       sample.queue_depth,
+                       sample.queue_capacity,
+                       (uint64_t)(sample.oldest_packet_age_us / 1000ULL),
+                       decision.window_drops,
+                       decision.send_kbps);
+                bitrate = decision.new_bitrate;
+                fps = decision.new_fps;
+            }
+        }
+
+        next_frame_us += 1000000ULL / (uint64_t)fps;
+        now = now_us();
+        if (next_frame_us > now) usleep((useconds_t)(next_frame_us - now));
+    }
+
+    {
+        MediaSinkStats stats;
+        media_sink_get_stats(&sink, &stats);
+        printf("[ABR_SUMMARY] link=%dkbps phase1_end_bitrate=%d final_bitrate=%d final_fps=%d downs=%" PRIu64
+               " ups=%" PRIu64 " sent=%" PRIu64 " dropped=%" PRIu64 "(phase1=%" PRIu64 ")\n",
+               throttle_kbps,
+               phase1_end_bitrate,
+               abr.current_bitrate,
+               abr.current_fps,
+               abr.step_down_count,
+               abr.step_up_count,
+               stats.sent_frames,
+               stats.dropped_frames,
+               phase1_tail_drops);
+    }
+
+    if (phase1_end_bitrate <= 0 || phase1_end_bitrate > throttle_kbps * 1000) {
+        fprintf(stderr, "[ERROR] abr did not converge below link capacity\n");
+        ret = -1;
+    }
+    if (abr.current_bitrate <= phase1_end_bitrate) {
+        fprintf(stderr, "[ERROR] abr did not recover after link improved\n");
+        ret = -1;
+    }
+
+    media_sink_stop(&sink);
+    media_sink_deinit(&sink);
+    free(frame_data);
+    return ret;
+}
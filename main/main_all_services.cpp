@@ -1,6 +1,11 @@
+#include <atomic>
 #include <list>
 #include <stdio.h>
 #include <string>
+#include <string.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
 
 #include "simple_config.h"
 
@@ -42,10 +47,37 @@ static void fill_stream_config(MediaGatewayStreamConfig *stream,
     stream->qp_min_i = cfg_int("QP_MIN_I", 20);
     stream->qp_max_i = cfg_int("QP_MAX_I", 40);
     stream->qp_max_step = cfg_int("QP_MAX_STEP", 8);
+    stream->abr.enabled = cfg_int("ABR_ENABLE", 0);
+    stream->abr.min_bitrate = cfg_int("ABR_MIN_BITRATE", stream->bitrate / 4);
+    stream->abr.max_bitrate = cfg_int("ABR_MAX_BITRATE", stream->bitrate);
+    stream->abr.min_fps = cfg_int("ABR_MIN_FPS", 0);
+    stream->abr.step_down_percent = cfg_int("ABR_STEP_DOWN_PERCENT", 20);
+    stream->abr.step_up_percent = cfg_int("ABR_STEP_UP_PERCENT", 10);
+    stream->abr.queue_high_percent = cfg_int("ABR_QUEUE_HIGH_PERCENT", 50);
+    stream->abr.queue_low_percent = cfg_int("ABR_QUEUE_LOW_PERCENT", 10);
+    stream->abr.age_high_ms = cfg_int("ABR_AGE_HIGH_MS", 500);
+    stream->abr.down_hold_ms = cfg_int("ABR_DOWN_HOLD_MS", 1000);
+    stream->abr.up_hold_ms = cfg_int("ABR_UP_HOLD_MS", 5000);
+    stream->abr.eval_interval_ms = cfg_int("ABR_EVAL_INTERVAL_MS", 500);
+    stream->idr.coalesce_ms = cfg_int("IDR_COALESCE_MS", 100);
+    stream->idr.min_interval_ms = cfg_int("IDR_MIN_INTERVAL_MS", 1000);
+    stream->idr.reuse_window_ms = cfg_int("IDR_REUSE_WINDOW_MS", 500);
+    stream->motion.enabled = cfg_int("MOTION_ENABLE", 0);
+    stream->motion.idle_fps = cfg_int("MOTION_IDLE_FPS", 1);
+    stream->motion.sad_threshold = cfg_int("MOTION_SAD_THRESHOLD", 8);
+    stream->motion.min_changed_blocks = cfg_int("MOTION_MIN_CHANGED_BLOCKS", 1);
+    stream->motion.static_hold_ms = cfg_int("MOTION_STATIC_HOLD_MS", 2000);
+    stream->on_demand = cfg_int("ON_DEMAND", 0);
+    stream->on_demand_linger_ms = cfg_int("ON_DEMAND_LINGER_MS", 3000);
+    stream->on_demand_pause_capture = cfg_int("ON_DEMAND_PAUSE_CAPTURE", 0);
 
     stream->enable_rtsp = cfg_int("ENABLE_RTSP", is_main ? 1 : 1);
     stream->enable_rtmp = cfg_int("ENABLE_RTMP", 0);
     stream->enable_gb28181 = cfg_int("ENABLE_GB28181", is_main ? 1 : 0);
+    stream->enable_http_flv = cfg_int("ENABLE_HTTP_FLV", 0);
+    stream->enable_ts_udp = cfg_int("ENABLE_TS_UDP", 0);
+    stream->enable_ll_hls = cfg_int("ENABLE_LL_HLS", 0);
+    stream->enable_webrtc = cfg_int("ENABLE_WEBRTC", 0);
 
     stream->rtsp.name = cfg_str("RTSP_NAME", is_main ? "rtsp-main" : "rtsp-sub");
     stream->rtsp.session_name = cfg_str("RTSP_SESSION_NAME", is_main ? "live_main" : "live_sub");
@@ -56,12 +88,25 @@ static void fill_stream_config(MediaGatewayStreamConfig *stream,
     stream->rtsp.password = cfg_str("RTSP_PASSWORD", "123456");
     stream->rtsp.queue_capacity = cfg_int("RTSP_QUEUE_CAPACITY", 32);
     stream->rtsp.immediate_sps_pps_on_new_client = cfg_int("RTSP_IMMEDIATE_SPS_PPS_ON_NEW_CLIENT", 0);
+    stream->rtsp.gop_cache_max_frames = cfg_int("RTSP_GOP_CACHE_MAX_FRAMES", stream->gop * 2);
+    stream->rtsp.gop_cache_max_age_ms = cfg_int("RTSP_GOP_CACHE_MAX_AGE_MS", 2000);
+    stream->rtsp.multicast_group = cfg_str("RTSP_MULTICAST_GROUP", "");
+    stream->rtsp.multicast_port = cfg_int("RTSP_MULTICAST_PORT", is_main ? 5004 : 5006);
+    stream->rtsp.multicast_ttl = cfg_int("RTSP_MULTICAST_TTL", 1);
+    stream->rtsp.multicast_interface = cfg_str("RTSP_MULTICAST_INTERFACE", "");
+    stream->rtsp.rtcp_interval_ms = cfg_int("RTSP_RTCP_INTERVAL_MS", 1000);
+    stream->rtsp.client_budget_bytes = cfg_int("RTSP_CLIENT_BUDGET_BYTES", 4 * 1024 * 1024);
+    stream->rtsp.slow_client_evict_drops = cfg_int("RTSP_SLOW_CLIENT_EVICT_DROPS", 3);
+    stream->rtsp.slow_client_evict_window_ms = cfg_int("RTSP_SLOW_CLIENT_EVICT_WINDOW_MS", 30000);
 
     stream->rtmp.name = cfg_str("RTMP_NAME", is_main ? "rtmp-main" : "rtmp-sub");
     stream->rtmp.publish_url = cfg_str("RTMP_PUBLISH_URL", "");
     stream->rtmp.queue_capacity = cfg_int("RTMP_QUEUE_CAPACITY", 64);
     stream->rtmp.reconnect_interval_ms = cfg_int("RTMP_RECONNECT_INTERVAL_MS", 1000);
+    stream->rtmp.max_reconnect_interval_ms = cfg_int("RTMP_MAX_RECONNECT_INTERVAL_MS", 30000);
     stream->rtmp.connect_timeout_ms = cfg_int("RTMP_CONNECT_TIMEOUT_MS", 3000);
+    stream->rtmp.chunk_size = cfg_int("RTMP_CHUNK_SIZE", 4096);
+    stream->rtmp.send_timeout_ms = cfg_int("RTMP_SEND_TIMEOUT_MS", 2000);
     stream->rtmp.audio_enabled = cfg_int("RTMP_AUDIO_ENABLED", 0);
     stream->rtmp.video_width = cfg_int("RTMP_VIDEO_WIDTH", stream->width);
     stream->rtmp.video_height = cfg_int("RTMP_VIDEO_HEIGHT", stream->height);
@@ -70,6 +115,65 @@ static void fill_stream_config(MediaGatewayStreamConfig *stream,
     stream->rtmp.video_codec_name = cfg_str("RTMP_VIDEO_CODEC_NAME", "H264");
     stream->rtmp.encoder_name = cfg_str("RTMP_ENCODER_NAME", "RKMediaGateway");
 
+    stream->http_flv.name = cfg_str("HTTP_FLV_NAME", is_main ? "http-flv-main" : "http-flv-sub");
+    stream->http_flv.listen_ip = cfg_str("HTTP_FLV_LISTEN_IP", "0.0.0.0");
+    stream->http_flv.listen_port = cfg_int("HTTP_FLV_PORT", is_main ? 8080 : 8081);
+    stream->http_flv.stream_name = cfg_str("HTTP_FLV_STREAM_NAME", is_main ? "main" : "sub");
+    stream->http_flv.queue_capacity = cfg_int("HTTP_FLV_QUEUE_CAPACITY", 64);
+    stream->http_flv.max_clients = cfg_int("HTTP_FLV_MAX_CLIENTS", 32);
+    stream->http_flv.client_budget_bytes = cfg_int("HTTP_FLV_CLIENT_BUDGET_BYTES", 4 * 1024 * 1024);
+    stream->http_flv.gop_cache_max_frames = cfg_int("HTTP_FLV_GOP_CACHE_MAX_FRAMES", stream->gop * 2);
+    stream->http_flv.video_width = stream->width;
+    stream->http_flv.video_height = stream->height;
+    stream->http_flv.video_fps = stream->fps;
+    stream->http_flv.video_bitrate = stream->bitrate;
+    stream->http_flv.encoder_name = cfg_str("RTMP_ENCODER_NAME", "RKMediaGateway");
+
+    stream->ts_udp.name = cfg_str("TS_UDP_NAME", is_main ? "ts-udp-main" : "ts-udp-sub");
+    stream->ts_udp.dest_ip = cfg_str("TS_UDP_DEST_IP", "239.0.0.1");
+    stream->ts_udp.dest_port = cfg_int("TS_UDP_DEST_PORT", is_main ? 1234 : 1236);
+    stream->ts_udp.multicast_ttl = cfg_int("TS_UDP_MULTICAST_TTL", 1);
+    stream->ts_udp.multicast_interface = cfg_str("TS_UDP_MULTICAST_INTERFACE", "");
+    stream->ts_udp.queue_capacity = cfg_int("TS_UDP_QUEUE_CAPACITY", 64);
+    stream->ts_udp.packets_per_datagram = cfg_int("TS_UDP_PACKETS_PER_DATAGRAM", 7);
+    stream->ts_udp.gso = cfg_int("TS_UDP_GSO", 1);
+    stream->ts_udp.pacing = cfg_int("TS_UDP_PACING_ENABLE", 1);
+    stream->ts_udp.pacing_rate_percent = cfg_int("TS_UDP_PACING_RATE_PERCENT", 200);
+    stream->ts_udp.pacing_burst_bytes = cfg_int("TS_UDP_PACING_BURST_BYTES", 16384);
+    stream->ts_udp.pacing_spread_percent = cfg_int("TS_UDP_PACING_SPREAD_PERCENT", 50);
+    stream->ts_udp.video_fps = stream->fps;
+    stream->ts_udp.video_bitrate = stream->bitrate;
+
+    stream->ll_hls.name = cfg_str("LL_HLS_NAME", is_main ? "ll-hls-main" : "ll-hls-sub");
+    stream->ll_hls.listen_ip = cfg_str("LL_HLS_LISTEN_IP", "0.0.0.0");
+    stream->ll_hls.listen_port = cfg_int("LL_HLS_PORT", is_main ? 8088 : 8089);
+    stream->ll_hls.stream_name = cfg_str("LL_HLS_STREAM_NAME", is_main ? "main" : "sub");
+    stream->ll_hls.queue_capacity = cfg_int("LL_HLS_QUEUE_CAPACITY", 64);
+    stream->ll_hls.max_clients = cfg_int("LL_HLS_MAX_CLIENTS", 32);
+    stream->ll_hls.segment_target_ms = cfg_int("LL_HLS_SEGMENT_MS", 2000);
+    stream->ll_hls.part_target_ms = cfg_int("LL_HLS_PART_MS", 200);
+    stream->ll_hls.playlist_segments = cfg_int("LL_HLS_PLAYLIST_SEGMENTS", 6);
+    stream->ll_hls.segment_max_bytes = cfg_int("LL_HLS_SEGMENT_MAX_BYTES", 0);
+    stream->ll_hls.video_width = stream->width;
+    stream->ll_hls.video_height = stream->height;
+    stream->ll_hls.video_fps = stream->fps;
+    stream->ll_hls.video_bitrate = stream->bitrate;
+
+    stream->webrtc.name = cfg_str("WEBRTC_NAME", is_main ? "webrtc-main" : "webrtc-sub");
+    stream->webrtc.listen_ip = cfg_str("WEBRTC_LISTEN_IP", "0.0.0.0");
+    stream->webrtc.http_port = cfg_int("WEBRTC_HTTP_PORT", is_main ? 8090 : 8091);
+    stream->webrtc.media_port = cfg_int("WEBRTC_MEDIA_PORT", is_main ? 8092 : 8093);
+    stream->webrtc.announce_ip = cfg_str("WEBRTC_ANNOUNCE_IP", "");
+    stream->webrtc.stream_name = cfg_str("WEBRTC_STREAM_NAME", is_main ? "main" : "sub");
+    stream->webrtc.queue_capacity = cfg_int("WEBRTC_QUEUE_CAPACITY", 64);
+    stream->webrtc.max_peers = cfg_int("WEBRTC_MAX_PEERS", 8);
+    stream->webrtc.rtp_max_payload = cfg_int("WEBRTC_RTP_MAX_PAYLOAD", 1200);
+    stream->webrtc.nack_history_ms = cfg_int("WEBRTC_NACK_HISTORY_MS", 1000);
+    stream->webrtc.rtcp_interval_ms = cfg_int("WEBRTC_RTCP_INTERVAL_MS", 1000);
+    stream->webrtc.gso = cfg_int("WEBRTC_GSO", 1);
+    stream->webrtc.video_fps = stream->fps;
+    stream->webrtc.video_bitrate = stream->bitrate;
+
     stream->gb28181.name = cfg_str("GB28181_NAME", is_main ? "gb28181-main" : "gb28181-sub");
     stream->gb28181.server_ip = cfg_str("GB28181_SERVER_IP", "192.168.1.1");
     stream->gb28181.server_port = cfg_int("GB28181_SERVER_PORT", 5060);
@@ -91,8 +195,23 @@ static void fill_stream_config(MediaGatewayStreamConfig *stream,
     stream->gb28181.model = cfg_str("GB28181_MODEL", "RKMediaGateway");
     stream->gb28181.firmware = cfg_str("GB28181_FIRMWARE", "1.0.0");
     stream->gb28181.channel_id = cfg_str("GB28181_CHANNEL_ID", stream->gb28181.device_id);
+    stream->gb28181.channel_name = cfg_str("GB28181_CHANNEL_NAME", is_main ? "main" : "sub");
     stream->gb28181.user_agent = cfg_str("GB28181_USER_AGENT", "RKMediaGateway-GB28181/1.0");
     stream->gb28181.queue_capacity = cfg_int("GB28181_QUEUE_CAPACITY", 64);
+    stream->gb28181.rtp_gso = cfg_int("GB28181_RTP_GSO", 1);
+    stream->gb28181.rtp_pacing = cfg_int("GB28181_PACING_ENABLE", 0);
+    stream->gb28181.rtp_pacing_rate_percent = cfg_int("GB28181_PACING_RATE_PERCENT", 200);
+    stream->gb28181.rtp_pacing_burst_bytes = cfg_int("GB28181_PACING_BURST_BYTES", 16384);
+    stream->gb28181.rtp_pacing_spread_percent = cfg_int("GB28181_PACING_SPREAD_PERCENT", 50);
+    stream->gb28181.rtp_nack = cfg_int("GB28181_NACK_ENABLE", 1);
+    stream->gb28181.rtp_nack_history_kb = cfg_int("GB28181_NACK_HISTORY_KB", 1024);
+    stream->gb28181.rtp_fec = cfg_int("GB28181_FEC_ENABLE", 0);
+    stream->gb28181.rtp_fec_payload_type = cfg_int("GB28181_FEC_PAYLOAD_TYPE", 127);
+    stream->gb28181.rtp_fec_key_percent = cfg_int("GB28181_FEC_IDR_PERCENT", 20);
+    stream->gb28181.rtp_fec_delta_percent = cfg_int("GB28181_FEC_P_PERCENT", 10);
+    stream->gb28181.rtp_rtcp = cfg_int("GB28181_RTCP_ENABLE", 1);
+    stream->gb28181.rtp_rtcp_interval_ms = cfg_int("GB28181_RTCP_INTERVAL_MS", 1000);
+    stream->gb28181.log_level = cfg_str("GB28181_LOG_LEVEL", "info");
 }
 
 static void fill_capture_source_config(MediaGatewayCaptureSourceConfig *source,
@@ -119,6 +238,76 @@ static void fill_capture_source_config(MediaGatewayCaptureSourceConfig *source,
     source->buffer_count = cfg_int("BUFFER_COUNT", V4L2_CAPTURE_BUFFER_COUNT);
 }
 
+static void read_stream_tuning(simple_config::Reader &file_config, int is_main, MediaGatewayStreamTuning *tuning) {
+    const std::string prefix = is_main ? "STREAM_MAIN_" : "STREAM_SUB_";
+    auto cfg_int = [&](const char *suffix) -> int {
+        return file_config.get_int((prefix + suffix).c_str(), 0);
+    };
+
+    tuning->width = cfg_int("WIDTH");
+    tuning->height = cfg_int("HEIGHT");
+    tuning->fps = cfg_int("FPS");
+    tuning->bitrate = cfg_int("BITRATE");
+    tuning->gop = cfg_int("GOP");
+    tuning->qp_init = cfg_int("QP_INIT");
+    tuning->qp_min = cfg_int("QP_MIN");
+    tuning->qp_max = cfg_int("QP_MAX");
+    tuning->qp_min_i = cfg_int("QP_MIN_I");
+    tuning->qp_max_i = cfg_int("QP_MAX_I");
+    tuning->qp_max_step = cfg_int("QP_MAX_STEP");
+}
+
+/*
+ * 运行期调参线程：轮询配置文件修改时间，文件被改写后重新读取各码流的
+ * 分辨率/帧率/码率/GOP/QP 键，只把发生变化的字段交给网关主循环在线生效。
+ */
+static void tuning_watcher_main(MediaGatewayCtx *gateway,
+                                std::string config_path,
+                                int interval_ms,
+                                std::atomic<bool> *stop_flag) {
+    MediaGatewayStreamTuning last[MEDIA_GATEWAY_MAX_STREAMS] = {};
+    time_t last_mtime = 0;
+    struct stat st;
+    simple_config::Reader file_config;
+
+    if (stat(config_path.c_str(), &st) == 0) last_mtime = st.st_mtime;
+    if (file_config.load(config_path)) {
+        read_stream_tuning(file_config, 1, &last[0]);
+        read_stream_tuning(file_config, 0, &last[1]);
+    }
+
+    while (!stop_flag->load()) {
+        usleep((useconds_t)interval_ms * 1000);
+        if (stat(config_path.c_str(), &st) != 0 || st.st_mtime == last_mtime) continue;
+        last_mtime = st.st_mtime;
+        if (!file_config.load(config_path)) continue;
+
+        for (int i = 0; i < MEDIA_GATEWAY_MAX_STREAMS; ++i) {
+            MediaGatewayStreamTuning now = {};
+            MediaGatewayStreamTuning changed = {};
+            const MediaGatewayStreamTuning unchanged = {};
+            read_stream_tuning(file_config, (i == 0) ? 1 : 0, &now);
+            if (now.width != last[i].width) changed.width = now.width;
+            if (now.height != last[i].height) changed.height = now.height;
+            if (now.fps != last[i].fps) changed.fps = now.fps;
+            if (now.bitrate != last[i].bitrate) changed.bitrate = now.bitrate;
+            if (now.gop != last[i].gop) changed.gop = now.gop;
+            if (now.qp_init != last[i].qp_init) changed.qp_init = now.qp_init;
+            if (now.qp_min != last[i].qp_min) changed.qp_min = now.qp_min;
+            if (now.qp_max != last[i].qp_max) changed.qp_max = now.qp_max;
+            if (now.qp_min_i != last[i].qp_min_i) changed.qp_min_i = now.qp_min_i;
+            if (now.qp_max_i != last[i].qp_max_i) changed.qp_max_i = now.qp_max_i;
+            if (now.qp_max_step != last[i].qp_max_step) changed.qp_max_step = now.qp_max_step;
+            last[i] = now;
+
+            if (memcmp(&changed, &unchanged, sizeof(changed)) == 0) continue;
+            if (media_gateway_request_stream_tuning(gateway, i, &changed) == 0) {
+                printf("[MAIN_CFG] stream=%d tuning requested from %s\n", i, config_path.c_str());
+            }
+        }
+    }
+}
+
 static void log_main_config_snapshot(const MediaGatewayConfig *config, simple_config::Reader &file_config) {
     if (!config) return;
     printf("[MAIN_CFG] source=%s loaded=%d\n",
@@ -128,14 +317,22 @@ static void log_main_config_snapshot(const MediaGatewayConfig *config, simple_co
            file_config.get_int("GATEWAY_STREAM_COUNT", -999),
            file_config.get_int("STREAM_MAIN_ENABLE", -999),
            file_config.get_int("STREAM_SUB_ENABLE", -999));
-    printf("[MAIN_CFG] raw MAIN out rtsp=%d rtmp=%d gb28181=%d\n",
+    printf("[MAIN_CFG] raw MAIN out rtsp=%d rtmp=%d gb28181=%d http_flv=%d ts_udp=%d ll_hls=%d webrtc=%d\n",
            file_config.get_int("STREAM_MAIN_ENABLE_RTSP", -999),
            file_config.get_int("STREAM_MAIN_ENABLE_RTMP", -999),
-           file_config.get_int("STREAM_MAIN_ENABLE_GB28181", -999));
-    printf("[MAIN_CFG] raw SUB  out rtsp=%d rtmp=%d gb28181=%d\n",
+           file_config.get_int("STREAM_MAIN_ENABLE_GB28181", -999),
+           file_config.get_int("STREAM_MAIN_ENABLE_HTTP_FLV", -999),
+           file_config.get_int("STREAM_MAIN_ENABLE_TS_UDP", -999),
+           file_config.get_int("STREAM_MAIN_ENABLE_LL_HLS", -999),
+           file_config.get_int("STREAM_MAIN_ENABLE_WEBRTC", -999));
+    printf("[MAIN_CFG] raw SUB  out rtsp=%d rtmp=%d gb28181=%d http_flv=%d ts_udp=%d ll_hls=%d webrtc=%d\n",
            file_config.get_int("STREAM_SUB_ENABLE_RTSP", -999),
            file_config.get_int("STREAM_SUB_ENABLE_RTMP", -999),
-           file_config.get_int("STREAM_SUB_ENABLE_GB28181", -999));
+           file_config.get_int("STREAM_SUB_ENABLE_GB28181", -999),
+           file_config.get_int("STREAM_SUB_ENABLE_HTTP_FLV", -999),
+           file_config.get_int("STREAM_SUB_ENABLE_TS_UDP", -999),
+           file_config.get_int("STREAM_SUB_ENABLE_LL_HLS", -999),
+           file_config.get_int("STREAM_SUB_ENABLE_WEBRTC", -999));
 
     printf("[MAIN_CFG] parsed stream_count=%d bench(enable=%d sample_every=%d print_interval_sec=%d)\n",
            config->stream_count,
@@ -144,7 +341,7 @@ static void log_main_config_snapshot(const MediaGatewayConfig *config, simple_co
            config->bench_print_interval_sec);
     for (int i = 0; i < config->stream_count && i < MEDIA_GATEWAY_MAX_STREAMS; ++i) {
         const MediaGatewayStreamConfig *s = &config->streams[i];
-        printf("[MAIN_CFG] parsed stream=%d name=%s enabled=%d source=%d size=%dx%d fps=%d bitrate=%d rc=%d out(rtsp=%d rtmp=%d gb28181=%d) rtsp_immediate_sps_pps=%d\n",
+        printf("[MAIN_CFG] parsed stream=%d name=%s enabled=%d source=%d size=%dx%d fps=%d bitrate=%d rc=%d out(rtsp=%d rtmp=%d gb28181=%d http_flv=%d ts_udp=%d ll_hls=%d webrtc=%d) rtsp_immediate_sps_pps=%d rtsp_gop_cache=%d\n",
                i,
                s->name ? s->name : "unknown",
                s->enabled,
@@ -157,7 +354,12 @@ static void log_main_config_snapshot(const MediaGatewayConfig *config, simple_co
                s->enable_rtsp,
                s->enable_rtmp,
                s->enable_gb28181,
-               s->rtsp.immediate_sps_pps_on_new_client);
+               s->enable_http_flv,
+               s->enable_ts_udp,
+               s->enable_ll_hls,
+               s->enable_webrtc,
+               s->rtsp.immediate_sps_pps_on_new_client,
+               s->rtsp.gop_cache_max_frames);
     }
 }
 
@@ -237,8 +439,16 @@ int main(int argc, char **argv)
         config.streams[0].enable_rtsp = cfg_int("GATEWAY_ENABLE_RTSP", 1);
         config.streams[0].enable_rtmp = cfg_int("GATEWAY_ENABLE_RTMP", 0);
         config.streams[0].enable_gb28181 = cfg_int("GATEWAY_ENABLE_GB28181", 1);
+        config.streams[0].enable_http_flv = cfg_int("GATEWAY_ENABLE_HTTP_FLV", 0);
+        config.streams[0].enable_ts_udp = cfg_int("GATEWAY_ENABLE_TS_UDP", 0);
+        config.streams[0].enable_ll_hls = cfg_int("GATEWAY_ENABLE_LL_HLS", 0);
+        config.streams[0].enable_webrtc = cfg_int("GATEWAY_ENABLE_WEBRTC", 0);
         config.streams[0].rtsp.immediate_sps_pps_on_new_client =
             cfg_int("GATEWAY_RTSP_IMMEDIATE_SPS_PPS_ON_NEW_CLIENT", 0);
+        config.streams[0].rtsp.gop_cache_max_frames =
+            cfg_int("GATEWAY_RTSP_GOP_CACHE_MAX_FRAMES", config.streams[0].gop * 2);
+        config.streams[0].rtsp.gop_cache_max_age_ms =
+            cfg_int("GATEWAY_RTSP_GOP_CACHE_MAX_AGE_MS", 2000);
     }
 
     log_main_config_snapshot(&config, file_config);
@@ -248,7 +458,20 @@ int main(int argc, char **argv)
         return -1;
     }
 
+    std::atomic<bool> tuning_stop(false);
+    std::thread tuning_thread;
+    int tuning_interval_ms = cfg_int("GATEWAY_TUNING_WATCH_INTERVAL_MS", 1000);
+    if (tuning_interval_ms > 0)
+    {
+        tuning_thread = std::thread(tuning_watcher_main, &gateway, std::string(config_path), tuning_interval_ms, &tuning_stop);
+    }
+
     int ret = media_gateway_run(&gateway);
+    tuning_stop.store(true);
+    if (tuning_thread.joinable())
+    {
+        tuning_thread.join();
+    }
     media_gateway_deinit(&gateway);
     return ret;
 }
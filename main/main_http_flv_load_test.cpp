@@ -0,0 +1,409 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+#include "httpFlvSink.h"
+}
+
+#define TEST_FRAMES 150
+#define TEST_GOP 10
+#define TEST_LATE_JOIN_FRAME 59
+#define TEST_IDR_BYTES (200 * 1024)
+#define TEST_P_BYTES (50 * 1024)
+#define TEST_FRAME_INTERVAL_US 10000
+#define TEST_FRAME_DURATION_MS 40
+#define TEST_EARLY_CLIENTS 8
+#define TEST_LATE_CLIENTS 8
+/* 预算小于中途接入时补发的 GOP（1 个 I 帧 + 9 个 P 帧约 650KB），补发不能把新客户端当慢客户端断开。 */
+#define TEST_CLIENT_BUDGET_BYTES (512 * 1024)
+#define TEST_STREAM_NAME "load_test"
+#define TEST_MAX_TAG (TEST_IDR_BYTES + 1024)
+
+/*
+ * HTTP-FLV 单线程 epoll 服务的本地负载测试，同一路码流同时服务多个 HTTP 客户端：
+ *   A. 推流前接入的客户端：依次收到 HTTP 头、FLV 文件头、onMetaData、sequence header，
+ *      随后从第 0 帧关键帧开始逐帧连续收齐，负载逐字节比对；
+ *   B. 推流中途接入的客户端：从缓存的最近一个 GOP 的关键帧开始，不等下一个 IDR，之后连续不丢帧；
+ *   C. 只发请求不读数据的慢客户端：积压超过预算后被单独断开，不影响 A/B；
+ *   D. 路径不匹配的请求：返回 404。
+ * 同时检查每帧只封装一次（封装帧数等于输入帧数，而不是乘以客户端数）。
+ *
+ * 用法：http_flv_load_test
+ */
+
+typedef struct {
+    int port;
+    volatile int got_header;
+    int status_ok;
+    int metadata_ok;
+    int sequence_header_ok;
+    int frames;
+    int first_index;
+    int gaps;
+    int bad;
+    uint64_t bytes;
+} Client;
+
+static size_t append_nalu(uint8_t *dst, uint8_t header, size_t len, uint32_t seed) {
+    size_t i;
+    dst[0] = 0;
+    dst[1] = 0;
+    dst[2] = 0;
+    dst[3] = 1;
+    dst[4] = header;
+    for (i = 1; i < len; ++i) {
+        seed = seed * 1103515245U + 12345U;
+        /* 负载不含 0x00，避免伪起始码。 */
+        dst[4 + i] = (uint8_t)(0x10 + ((seed >> 16) % 0xF0));
+    }
+    return 4 + len;
+}
+
+/* 帧内容只由帧号决定，客户端据此重建期望负载。 */
+static size_t make_frame(uint8_t *dst, int index) {
+    size_t len = 0;
+    int key = (index % TEST_GOP) == 0;
+    len += append_nalu(dst + len, 0x09, 2, 1);
+    if (key) {
+        len += append_nalu(dst + len, 0x67, 20, 7);
+        len += append_nalu(dst + len, 0x68, 5, 8);
+        len += append_nalu(dst + len, 0x65, TEST_IDR_BYTES, (uint32_t)index);
+    } else {
+        len += append_nalu(dst + len, 0x41, TEST_P_BYTES, (uint32_t)index);
+    }
+    return len;
+}
+
+static uint32_t read_be24(const uint8_t *p) {
+    return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+}
+
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static int read_exact(int fd, uint8_t *buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = recv(fd, buf + got, len - got, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return -1;
+        }
+        got += (size_t)n;
+    }
+    return 0;
+}
+
+static int connect_local(int port, int rcvbuf) {
+    struct sockaddr_in addr;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (rcvbuf > 0) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int send_request(int fd, const char *path) {
+    char request[256];
+    int len = snprintf(request, sizeof(request),
+                       "GET %s HTTP/1.1\r\nHost: 127.0.0.1\r\nUser-Agent: http_flv_load_test\r\n\r\n",
+                       path);
+    return send(fd, request, (size_t)len, MSG_NOSIGNAL) == len ? 0 : -1;
+}
+
+/* 读到空行为止，返回状态行是否为 200。 */
+static int read_response_header(int fd, char *header, size_t cap) {
+    size_t len = 0;
+    while (len + 1 < cap) {
+        if (read_exact(fd, (uint8_t *)header + len, 1) != 0) break;
+        len++;
+        header[len] = '\0';
+        if (len >= 4 && memcmp(header + len - 4, "\r\n\r\n", 4) == 0) break;
+    }
+    header[len] = '\0';
+    return strncmp(header, "HTTP/1.1 200", 12) == 0 && strstr(header, "video/x-flv") != NULL;
+}
+
+/* 校验一个视频帧 tag：只应包含一个媒体 NALU，内容与 make_frame 生成的一致。 */
+static int check_frame(const uint8_t *body, uint32_t size, int index, uint8_t *scratch) {
+    int key = (index % TEST_GOP) == 0;
+    size_t nalu_len = key ? TEST_IDR_BYTES : TEST_P_BYTES;
+    size_t nalu_offset = key ? (6 + 24 + 9 + 4) : (6 + 4);
+
+    if ((body[0] >> 4) != (key ? 1 : 2) || size != 5 + 4 + nalu_len || read_be32(body + 5) != nalu_len) {
+        return 0;
+    }
+    make_frame(scratch, index);
+    return memcmp(body + 9, scratch + nalu_offset, nalu_len) == 0;
+}
+
+static void *client_main(void *arg) {
+    Client *client = (Client *)arg;
+    char header[1024];
+    uint8_t flv_header[13];
+    uint8_t tag_header[11];
+    uint8_t trailer[4];
+    uint8_t *body = (uint8_t *)malloc(TEST_MAX_TAG);
+    uint8_t *scratch = (uint8_t *)malloc(TEST_IDR_BYTES + 1024);
+    int prev_index = -1;
+    int fd;
+
+    client->first_index = -1;
+    fd = connect_local(client->port, 0);
+    if (fd < 0 || !body || !scratch || send_request(fd, "/live/" TEST_STREAM_NAME ".flv?token=abc") != 0) {
+        client->got_header = 1;
+        goto out;
+    }
+    client->status_ok = read_response_header(fd, header, sizeof(header));
+    client->got_header = 1;
+    if (!client->status_ok || read_exact(fd, flv_header, sizeof(flv_header)) != 0 ||
+        memcmp(flv_header, "FLV\x01\x01\x00\x00\x00\x09\x00\x00\x00\x00", 13) != 0) {
+        client->status_ok = 0;
+        goto out;
+    }
+    client->bytes = strlen(header) + sizeof(flv_header);
+
+    while (read_exact(fd, tag_header, sizeof(tag_header)) == 0) {
+        uint32_t size = read_be24(tag_header + 1);
+        uint32_t ts = read_be24(tag_header + 4) | ((uint32_t)tag_header[7] << 24);
+
+        if (size > TEST_MAX_TAG || read_exact(fd, body, size) != 0 || read_exact(fd, trailer, sizeof(trailer)) != 0) {
+            break;
+        }
+        client->bytes += sizeof(tag_header) + size + sizeof(trailer);
+        if (read_be32(trailer) != sizeof(tag_header) + size) {
+            client->bad++;
+            continue;
+        }
+        if (tag_header[0] == 18) {
+            client->metadata_ok = size > 13 && memcmp(body, "\x02\x00\x0aonMetaData", 13) == 0;
+        } else if (tag_header[0] != 9 || size < 5) {
+            client->bad++;
+        } else if (body[1] == 0) {
+            client->sequence_header_ok = body[0] == 0x17 && size > 11 && body[5] == 1;
+        } else {
+            int index = (int)(ts / TEST_FRAME_DURATION_MS);
+
+            if (!client->sequence_header_ok || !check_frame(body, size, index, scratch)) {
+                client->bad++;
+            }
+            if (prev_index < 0) {
+                client->first_index = index;
+            } else if (index != prev_index + 1) {
+                client->gaps++;
+            }
+            prev_index = index;
+            client->frames++;
+        }
+    }
+
+out:
+    if (fd >= 0) close(fd);
+    free(body);
+    free(scratch);
+    return NULL;
+}
+
+static int enqueue_frame(MediaSink *sink, uint8_t *frame, int index) {
+    MediaPacket packet;
+    MediaBuffer *buffer = NULL;
+    size_t len = make_frame(frame, index);
+    int ret;
+    if (media_buffer_create_copy(frame, len, &buffer) != 0) return -1;
+    media_packet_init(&packet);
+    packet.frame_type = MEDIA_FRAME_TYPE_VIDEO;
+    packet.codec = MEDIA_CODEC_H264;
+    packet.buffer = buffer;
+    packet.frame_id = (uint64_t)index;
+    packet.pts_us = (uint64_t)index * TEST_FRAME_DURATION_MS * 1000ULL;
+    packet.is_key_frame = (index % TEST_GOP) == 0;
+    ret = media_sink_enqueue(sink, &packet);
+    media_buffer_release(buffer);
+    return ret;
+}
+
+static int free_port() {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int port = -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+        getsockname(fd, (struct sockaddr *)&addr, &addr_len) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+    close(fd);
+    return port;
+}
+
+static void wait_headers(Client *clients, int count) {
+    int i;
+    for (i = 0; i < count; ++i) {
+        while (!clients[i].got_header) usleep(1000);
+    }
+}
+
+static int check_client(const char *group, int index, const Client *client, int first_index, int frames) {
+    int ok = client->status_ok && client->metadata_ok && client->sequence_header_ok &&
+             client->first_index == first_index && client->frames == frames && client->gaps == 0 && client->bad == 0;
+    if (!ok || index == 0) {
+        printf("[HTTP_FLV_TEST] %s client=%d status=%d meta=%d seq=%d first=%d frames=%d gaps=%d bad=%d bytes=%" PRIu64 " result=%s\n",
+               group,
+               index,
+               client->status_ok,
+               client->metadata_ok,
+               client->sequence_header_ok,
+               client->first_index,
+               client->frames,
+               client->gaps,
+               client->bad,
+               client->bytes,
+               ok ? "PASS" : "FAIL");
+    }
+    return ok;
+}
+
+int main() {
+    Client early[TEST_EARLY_CLIENTS];
+    Client late[TEST_LATE_CLIENTS];
+    pthread_t early_threads[TEST_EARLY_CLIENTS];
+    pthread_t late_threads[TEST_LATE_CLIENTS];
+    MediaSink sink;
+    HttpFlvSinkConfig config;
+    HttpFlvSinkStats stats;
+    char header[1024];
+    uint8_t *frame = (uint8_t *)malloc(TEST_IDR_BYTES + 1024);
+    int port = free_port();
+    int slow_fd;
+    int missing_fd;
+    int ok_early = 1;
+    int ok_late = 1;
+    int ok_slow;
+    int ok_404;
+    int ok_frames;
+    int late_first = (TEST_LATE_JOIN_FRAME / TEST_GOP) * TEST_GOP;
+    uint64_t client_bytes = 0;
+    int i;
+
+    if (!frame || port <= 0) {
+        fprintf(stderr, "[ERROR] http-flv test setup failed\n");
+        return -1;
+    }
+    memset(&config, 0, sizeof(config));
+    config.name = "http-flv-test";
+    config.listen_ip = "127.0.0.1";
+    config.listen_port = port;
+    config.stream_name = TEST_STREAM_NAME;
+    config.queue_capacity = 64;
+    config.max_clients = TEST_EARLY_CLIENTS + TEST_LATE_CLIENTS + 1;
+    config.client_budget_bytes = TEST_CLIENT_BUDGET_BYTES;
+    config.gop_cache_max_frames = TEST_GOP * 2;
+    config.video_width = 1920;
+    config.video_height = 1080;
+    config.video_fps = 25;
+    config.video_bitrate = 4000000;
+    if (http_flv_sink_setup(&sink, &config) != 0 || media_sink_start(&sink) != 0) {
+        fprintf(stderr, "[ERROR] http-flv sink start failed\n");
+        return -1;
+    }
+
+    /* 路径不匹配直接 404。 */
+    missing_fd = connect_local(port, 0);
+    ok_404 = missing_fd >= 0 && send_request(missing_fd, "/live/other.flv") == 0 &&
+             !read_response_header(missing_fd, header, sizeof(header)) && strncmp(header, "HTTP/1.1 404", 12) == 0;
+    if (missing_fd >= 0) close(missing_fd);
+
+    /* 慢客户端：接收窗口很小且从不读取。 */
+    slow_fd = connect_local(port, 4096);
+    if (slow_fd < 0 || send_request(slow_fd, "/live/" TEST_STREAM_NAME ".flv") != 0) {
+        fprintf(stderr, "[ERROR] http-flv slow client connect failed\n");
+        return -1;
+    }
+
+    memset(early, 0, sizeof(early));
+    memset(late, 0, sizeof(late));
+    for (i = 0; i < TEST_EARLY_CLIENTS; ++i) {
+        early[i].port = port;
+        pthread_create(&early_threads[i], NULL, client_main, &early[i]);
+    }
+    wait_headers(early, TEST_EARLY_CLIENTS);
+    while (http_flv_sink_get_stats(&sink, &stats) == 0 && stats.clients < TEST_EARLY_CLIENTS + 1) {
+        usleep(1000);
+    }
+
+    for (i = 0; i < TEST_FRAMES; ++i) {
+        enqueue_frame(&sink, frame, i);
+        usleep(TEST_FRAME_INTERVAL_US);
+        if (i == TEST_LATE_JOIN_FRAME - 1) {
+            int j;
+            for (j = 0; j < TEST_LATE_CLIENTS; ++j) {
+                late[j].port = port;
+                pthread_create(&late_threads[j], NULL, client_main, &late[j]);
+            }
+            /* 等中途接入的客户端都拿到缓存的 GOP 后再继续推帧。 */
+            wait_headers(late, TEST_LATE_CLIENTS);
+        }
+    }
+    usleep(500000);
+    http_flv_sink_get_stats(&sink, &stats);
+    media_sink_stop(&sink);
+    media_sink_deinit(&sink);
+    close(slow_fd);
+
+    for (i = 0; i < TEST_EARLY_CLIENTS; ++i) {
+        pthread_join(early_threads[i], NULL);
+        ok_early &= check_client("early", i, &early[i], 0, TEST_FRAMES);
+        client_bytes += early[i].bytes;
+    }
+    for (i = 0; i < TEST_LATE_CLIENTS; ++i) {
+        pthread_join(late_threads[i], NULL);
+        ok_late &= check_client("late", i, &late[i], late_first, TEST_FRAMES - late_first);
+        client_bytes += late[i].bytes;
+    }
+
+    ok_frames = stats.frames == TEST_FRAMES && stats.bytes_sent >= client_bytes;
+    ok_slow = stats.slow_drops == 1;
+    printf("[HTTP_FLV_TEST] early clients=%d frames=%d result=%s\n", TEST_EARLY_CLIENTS, TEST_FRAMES, ok_early ? "PASS" : "FAIL");
+    printf("[HTTP_FLV_TEST] late clients=%d join_frame=%d start_frame=%d result=%s\n",
+           TEST_LATE_CLIENTS,
+           TEST_LATE_JOIN_FRAME,
+           late_first,
+           ok_late ? "PASS" : "FAIL");
+    printf("[HTTP_FLV_TEST] slow_drops=%" PRIu64 " budget=%d result=%s\n",
+           stats.slow_drops,
+           TEST_CLIENT_BUDGET_BYTES,
+           ok_slow ? "PASS" : "FAIL");
+    printf("[HTTP_FLV_TEST] not_found rejected=%" PRIu64 " result=%s\n", stats.rejected, ok_404 ? "PASS" : "FAIL");
+    printf("[HTTP_FLV_TEST] packetized=%" PRIu64 " bytes_sent=%" PRIu64 " client_bytes=%" PRIu64 " write_calls=%" PRIu64 " result=%s\n",
+           stats.frames,
+           stats.bytes_sent,
+           client_bytes,
+           stats.write_calls,
+           ok_frames ? "PASS" : "FAIL");
+    free(frame);
+    if (!(ok_early && ok_late && ok_slow && ok_404 && ok_frames)) {
+        fprintf(stderr, "[ERROR] http-flv load checks failed\n");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+extern "C" {
+#include "mediaGatewayIdr.h"
+}
+
+#define TEST_FPS 30
+#define TEST_GOP 90
+#define TEST_FRAMES 180
+#define TEST_FRAME_US (1000000ULL / TEST_FPS)
+
+/*
+ * IDR 仲裁回放测试：按虚拟时钟逐帧推进，不依赖编码器和网络。
+ *   frame 35..43  每帧一个 RTSP 新客户端请求，应合并成一个强制 IDR；
+ *   frame 50      GB28181 点播，最近关键帧仍新鲜，应由缓存复用满足；
+ *   frame 55      GB28181 点播，缓存已过期，受最小间隔约束延后下发；
+ *   frame 85      请求等待期间周期关键帧（frame 90）先到，应由它顺带满足。
+ *
+ * 用法：idr_arbiter_test
+ */
+
+enum {
+    REQ_NONE = 0,
+    REQ_RTSP,
+    REQ_GB
+};
+
+static int request_at(int frame) {
+    if (frame >= 35 && frame <= 43) return REQ_RTSP;
+    if (frame == 50 || frame == 55) return REQ_GB;
+    if (frame == 85) return REQ_RTSP;
+    return REQ_NONE;
+}
+
+int main() {
+    MediaGatewayIdrConfig config;
+    MediaGatewayIdrArbiter arbiter;
+    int frame;
+    int ret = 0;
+
+    memset(&config, 0, sizeof(config));
+    media_gateway_idr_init(&arbiter, &config);
+
+    for (frame = 0; frame < TEST_FRAMES; ++frame) {
+        uint64_t now = (uint64_t)frame * TEST_FRAME_US;
+        int periodic = (frame % TEST_GOP) == 0;
+        int frames_to_periodic = (TEST_GOP - frame % TEST_GOP) % TEST_GOP;
+        int req = request_at(frame);
+        int forced;
+
+        if (req == REQ_GB && media_gateway_idr_fresh(&arbiter, now)) {
+            printf("[IDR] frame=%d event=reuse age_ms=%" PRIu64 "\n",
+                   frame, (uint64_t)((now - arbiter.last_keyframe_ts_us) / 1000ULL));
+            media_gateway_idr_request(&arbiter, now, 1);
+        } else if (req != REQ_NONE) {
+            media_gateway_idr_request(&arbiter, now, 0);
+        }
+
+        forced = media_gateway_idr_poll(&arbiter, now, (uint64_t)frames_to_periodic * TEST_FRAME_US);
+        if (forced) {
+            printf("[IDR] frame=%d event=issue requested=%" PRIu64 " coalesced=%" PRIu64 "\n",
+                   frame, arbiter.requested_count, arbiter.coalesced_count);
+        }
+        if (forced || periodic) {
+            media_gateway_idr_on_keyframe(&arbiter, now);
+        }
+    }
+
+    printf("[IDR_SUMMARY] requested=%" PRIu64 " issued=%" PRIu64 " coalesced=%" PRIu64 " reused=%" PRIu64
+           " natural=%" PRIu64 "\n",
+           arbiter.requested_count,
+           arbiter.issued_count,
+           arbiter.coalesced_count,
+           arbiter.reused_count,
+           arbiter.natural_count);
+
+    if (arbiter.requested_count != 12) {
+        fprintf(stderr, "[ERROR] unexpected request count\n");
+        ret = -1;
+    }
+    if (arbiter.issued_count != 2) {
+        fprintf(stderr, "[ERROR] burst was not coalesced into the expected IDR count\n");
+        ret = -1;
+    }
+    if (arbiter.reused_count != 1 || arbiter.natural_count != 1) {
+        fprintf(stderr, "[ERROR] fresh keyframe reuse or periodic keyframe satisfaction missing\n");
+        ret = -1;
+    }
+    if (arbiter.pending) {
+        fprintf(stderr, "[ERROR] request left pending at end of run\n");
+        ret = -1;
+    }
+    return ret;
+}
@@ -0,0 +1,639 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+#include "llHlsSink.h"
+}
+
+#define TEST_FRAMES 150
+#define TEST_GOP 25
+#define TEST_FPS 25
+#define TEST_FRAME_DURATION_US (1000000 / TEST_FPS)
+#define TEST_FRAME_DURATION_90K (90000 / TEST_FPS)
+#define TEST_IDR_BYTES (30 * 1024)
+#define TEST_P_BYTES (6 * 1024)
+#define TEST_SEGMENT_MS 1000
+#define TEST_PART_MS 200
+#define TEST_PLAYLIST_SEGMENTS 2
+#define TEST_SPS_LEN 20
+#define TEST_PPS_LEN 5
+#define TEST_MAX_FRAME (TEST_IDR_BYTES + 1024)
+#define TEST_BODY_MAX (1024 * 1024)
+#define TEST_MAX_SEGMENTS 16
+/* 连接数上限，以及上限之外再发起、应被直接关闭的连接数。 */
+#define TEST_MAX_CLIENTS 4
+#define TEST_EXTRA_CLIENTS 3
+/*
+ * part 里最后一帧从入队到客户端收完 part 的时长上限：最后一帧的时长要等下一帧的 DTS 确定，part 随后结束，
+ * 比帧间隔多出的只有调度和传输开销；流末尾没有下一帧时按墙钟结束。
+ */
+#define TEST_MAX_LAST_FRAME_LATENCY_MS 150
+
+/*
+ * LL-HLS 输出的本地播放测试，客户端按 LL-HLS 播放器的方式拉流：
+ *   - 先拉播放列表和 init 段，校验 CAN-BLOCK-RELOAD / PART-INF / PRELOAD-HINT / PROGRAM-DATE-TIME 等标签，
+ *     init 段的 avcC 携带输入里的 SPS/PPS；
+ *   - 之后一直请求 PRELOAD-HINT 指向的下一个 part（服务端挂起到生成完为止），分段在关键帧处结束导致 hint 落空时
+ *     改用阻塞式刷新（_HLS_msn/_HLS_part）等下一个分段；
+ *   - 解析每个 part 的 moof/trun/mdat：mfhd 序号连续、tfdt 与帧号对应、样本时长和关键帧标志正确，
+ *     样本负载与输入逐字节一致（去掉 AUD、不补参数集），帧号连续无缺失；
+ *   - 完整分段与各 part 拼接逐字节一致，已淘汰的分段、不存在的 part 回 404，过远的阻塞请求回 400；
+ *   - 同时发起超过 max_clients 的连接时，超出的连接被直接关闭；
+ *   - 统计从入队到客户端收完 part 的延迟（part 首帧和末帧），并打印分段环形缓冲的内存占用。
+ *
+ * 用法：ll_hls_test
+ */
+
+typedef struct {
+    int next_index;
+    int frames;
+    int gaps;
+    int bad_parts;
+    int bad_samples;
+    int parts;
+    int independent_errors;
+    int orphan_hints;
+    uint32_t last_sequence;
+    double first_latency_sum_ms;
+    double last_latency_sum_ms;
+    double first_latency_max_ms;
+    double last_latency_max_ms;
+    uint8_t *segment_bytes[TEST_MAX_SEGMENTS];
+    size_t segment_len[TEST_MAX_SEGMENTS];
+    uint8_t *scratch;
+} Player;
+
+static uint64_t g_enqueue_us[TEST_FRAMES];
+
+static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t read_be64(const uint8_t *p) {
+    return ((uint64_t)read_be32(p) << 32) | read_be32(p + 4);
+}
+
+/* 写一个 NALU，avcc 为 1 时用 4 字节长度前缀代替起始码；index >= 0 时把帧号编码进负载前两字节。 */
+static size_t put_nalu(uint8_t *dst, int avcc, uint8_t header, size_t len, uint32_t seed, int index) {
+    size_t i;
+    if (avcc) {
+        dst[0] = (uint8_t)(len >> 24);
+        dst[1] = (uint8_t)(len >> 16);
+        dst[2] = (uint8_t)(len >> 8);
+        dst[3] = (uint8_t)len;
+    } else {
+        dst[0] = 0;
+        dst[1] = 0;
+        dst[2] = 0;
+        dst[3] = 1;
+    }
+    dst[4] = header;
+    for (i = 1; i < len; ++i) {
+        seed = seed * 1103515245U + 12345U;
+        /* 负载不含 0x00，避免伪起始码。 */
+        dst[4 + i] = (uint8_t)(0x10 + ((seed >> 16) % 0xF0));
+    }
+    if (index >= 0) {
+        dst[5] = (uint8_t)(0x80 | ((index >> 7) & 0x7F));
+        dst[6] = (uint8_t)(0x80 | (index & 0x7F));
+    }
+    return 4 + len;
+}
+
+static int frame_is_key(int index) {
+    return (index % TEST_GOP) == 0;
+}
+
+/* 每 3 帧有一帧带 AUD；每隔一个关键帧带 SPS/PPS。 */
+static int frame_has_aud(int index) {
+    return (index % 3) == 0;
+}
+
+static int frame_has_params(int index) {
+    return (index % (TEST_GOP * 2)) == 0;
+}
+
+/* 帧内容只由帧号决定。avcc 为 1 时生成 fMP4 样本里应有的字节（去掉 AUD，参数集原样保留）。 */
+static size_t make_frame(uint8_t *dst, int index, int avcc) {
+    size_t len = 0;
+    int key = frame_is_key(index);
+    if (frame_has_aud(index) && !avcc) {
+        len += put_nalu(dst + len, 0, 0x09, 2, (uint32_t)index + 100, -1);
+    }
+    if (key && frame_has_params(index)) {
+        len += put_nalu(dst + len, avcc, 0x67, TEST_SPS_LEN, 7, -1);
+        len += put_nalu(dst + len, avcc, 0x68, TEST_PPS_LEN, 8, -1);
+    }
+    if (key) {
+        len += put_nalu(dst + len, avcc, 0x65, TEST_IDR_BYTES, (uint32_t)index, index);
+    } else {
+        len += put_nalu(dst + len, avcc, 0x41, TEST_P_BYTES, (uint32_t)index, index);
+    }
+    return len;
+}
+
+/* 从 avcC 格式的样本里找到 slice，读出编码在负载里的帧号。 */
+static int sample_frame_index(const uint8_t *sample, size_t len) {
+    size_t pos = 0;
+    while (pos + 4 <= len) {
+        size_t nalu_len = read_be32(sample + pos);
+        const uint8_t *nalu = sample + pos + 4;
+        uint8_t type;
+        if (nalu_len < 3 || pos + 4 + nalu_len > len) return -1;
+        type = nalu[0] & 0x1F;
+        if (type == 1 || type == 5) return ((nalu[1] & 0x7F) << 7) | (nalu[2] & 0x7F);
+        pos += 4 + nalu_len;
+    }
+    return -1;
+}
+
+static int enqueue_frame(MediaSink *sink, uint8_t *frame, int index) {
+    MediaPacket packet;
+    MediaBuffer *buffer = NULL;
+    size_t len = make_frame(frame, index, 0);
+    int ret;
+    if (media_buffer_create_copy(frame, len, &buffer) != 0) return -1;
+    media_packet_init(&packet);
+    packet.frame_type = MEDIA_FRAME_TYPE_VIDEO;
+    packet.codec = MEDIA_CODEC_H264;
+    packet.buffer = buffer;
+    packet.frame_id = (uint64_t)index;
+    packet.pts_us = 1000000ULL + (uint64_t)index * TEST_FRAME_DURATION_US;
+    packet.dts_us = packet.pts_us;
+    packet.is_key_frame = frame_is_key(index);
+    g_enqueue_us[index] = now_us();
+    ret = media_sink_enqueue(sink, &packet);
+    media_buffer_release(buffer);
+    return ret;
+}
+
+static void *producer_main(void *arg) {
+    MediaSink *sink = (MediaSink *)arg;
+    uint8_t *frame = (uint8_t *)malloc(TEST_MAX_FRAME);
+    uint64_t start_us = now_us();
+    int i;
+
+    for (i = 0; frame && i < TEST_FRAMES; ++i) {
+        uint64_t due_us = start_us + (uint64_t)i * TEST_FRAME_DURATION_US;
+        uint64_t now = now_us();
+        if (due_us > now) usleep((useconds_t)(due_us - now));
+        enqueue_frame(sink, frame, i);
+    }
+    free(frame);
+    return NULL;
+}
+
+static int pick_port() {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int port = -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd >= 0 && bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+        getsockname(fd, (struct sockaddr *)&addr, &addr_len) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+    if (fd >= 0) close(fd);
+    return port;
+}
+
+/* 在长连接上发一个 GET，返回状态码，-1 表示连接失败。对端要求关闭时关闭 *fd。 */
+static int http_get(int *fd, int port, const char *path, uint8_t *body, size_t cap, size_t *body_len) {
+    char request[512];
+    char header[2048];
+    size_t header_len = 0;
+    size_t content_length = 0;
+    size_t have;
+    char *end = NULL;
+    char *p;
+    int status = -1;
+
+    if (*fd < 0) {
+        struct sockaddr_in addr;
+        struct timeval tv;
+        *fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (*fd < 0) return -1;
+        tv.tv_sec = 10;
+        tv.tv_usec = 0;
+        setsockopt(*fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(*fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            close(*fd);
+            *fd = -1;
+            return -1;
+        }
+    }
+    snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n", path);
+    if (send(*fd, request, strlen(request), MSG_NOSIGNAL) != (ssize_t)strlen(request)) goto fail;
+    while (!end) {
+        ssize_t n;
+        if (header_len >= sizeof(header) - 1) goto fail;
+        n = recv(*fd, header + header_len, sizeof(header) - 1 - header_len, 0);
+        if (n <= 0) goto fail;
+        header_len += (size_t)n;
+        header[header_len] = '\0';
+        end = strstr(header, "\r\n\r\n");
+    }
+    if (sscanf(header, "HTTP/1.1 %d", &status) != 1) goto fail;
+    p = strstr(header, "Content-Length: ");
+    if (p) content_length = (size_t)strtoull(p + 16, NULL, 10);
+    if (content_length > cap) goto fail;
+    have = header_len - (size_t)(end + 4 - header);
+    if (have > content_length) goto fail;
+    memcpy(body, end + 4, have);
+    while (have < content_length) {
+        ssize_t n = recv(*fd, body + have, content_length - have, 0);
+        if (n <= 0) goto fail;
+        have += (size_t)n;
+    }
+    *body_len = content_length;
+    if (strstr(header, "Connection: close")) {
+        close(*fd);
+        *fd = -1;
+    }
+    return status;
+
+fail:
+    close(*fd);
+    *fd = -1;
+    return -1;
+}
+
+/* 同时发起 count 个空闲连接，返回被服务端直接关闭的个数。 */
+static int count_rejected_connections(int port, int count) {
+    int fds[TEST_MAX_CLIENTS + TEST_EXTRA_CLIENTS];
+    int rejected = 0;
+    int i;
+
+    if (count > (int)(sizeof(fds) / sizeof(fds[0]))) return -1;
+    for (i = 0; i < count; ++i) {
+        struct sockaddr_in addr;
+        fds[i] = socket(AF_INET, SOCK_STREAM, 0);
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fds[i] >= 0 && connect(fds[i], (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            close(fds[i]);
+            fds[i] = -1;
+        }
+    }
+    usleep(200000);
+    for (i = 0; i < count; ++i) {
+        struct pollfd pfd;
+        char c;
+        if (fds[i] < 0) {
+            rejected++;
+            continue;
+        }
+        pfd.fd = fds[i];
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 0) > 0 && recv(fds[i], &c, 1, MSG_DONTWAIT) <= 0) rejected++;
+        close(fds[i]);
+    }
+    return rejected;
+}
+
+static const uint8_t *find_box(const uint8_t *data, size_t len, const char *type) {
+    size_t i;
+    for (i = 4; i + 4 <= len; ++i) {
+        if (memcmp(data + i, type, 4) == 0) return data + i - 4;
+    }
+    return NULL;
+}
+
+/* init 段：ftyp 开头，moov 里有 mvex/trex，avcC 携带输入的 SPS/PPS。 */
+static int check_init(const uint8_t *data, size_t len) {
+    uint8_t expected[64];
+    const uint8_t *avcc;
+    size_t sps_len;
+    size_t pps_len;
+    if (len < 16 || memcmp(data + 4, "ftyp", 4) != 0) return 0;
+    if (!find_box(data, len, "moov") || !find_box(data, len, "trex") || !find_box(data, len, "avc1")) return 0;
+    avcc = find_box(data, len, "avcC");
+    if (!avcc || avcc + 8 + 8 > data + len || avcc[8] != 1) return 0;
+    sps_len = ((size_t)avcc[14] << 8) | avcc[15];
+    put_nalu(expected, 1, 0x67, TEST_SPS_LEN, 7, -1);
+    if (sps_len != TEST_SPS_LEN || memcmp(avcc + 16, expected + 4, TEST_SPS_LEN) != 0) return 0;
+    pps_len = ((size_t)avcc[17 + sps_len] << 8) | avcc[18 + sps_len];
+    put_nalu(expected, 1, 0x68, TEST_PPS_LEN, 8, -1);
+    return pps_len == TEST_PPS_LEN && memcmp(avcc + 19 + sps_len, expected + 4, TEST_PPS_LEN) == 0;
+}
+
+/* 解析一个 part（moof + mdat），逐样本比对并统计延迟。 */
+static void handle_part(Player *pl, int64_t msn, const uint8_t *data, size_t len, uint64_t recv_us) {
+    const uint8_t *moof = data;
+    const uint8_t *tfdt;
+    const uint8_t *trun;
+    const uint8_t *mdat;
+    const uint8_t *sample;
+    size_t moof_size;
+    uint32_t count;
+    uint32_t data_offset;
+    uint32_t sequence;
+    uint64_t base;
+    int first = -1;
+    int last = -1;
+    uint32_t i;
+
+    pl->parts++;
+    if (len < 16 || memcmp(moof + 4, "moof", 4) != 0) {
+        pl->bad_parts++;
+        return;
+    }
+    moof_size = read_be32(moof);
+    sequence = read_be32(moof + 20);
+    tfdt = find_box(moof, moof_size, "tfdt");
+    trun = find_box(moof, moof_size, "trun");
+    mdat = moof + moof_size;
+    if (!tfdt || !trun || moof_size + 8 > len || memcmp(mdat + 4, "mdat", 4) != 0 || tfdt[8] != 1 ||
+        (read_be32(trun + 8) & 0xFFFFFF) != 0x000701 || read_be32(mdat) != len - moof_size) {
+        pl->bad_parts++;
+        return;
+    }
+    if (pl->last_sequence != 0 && sequence != pl->last_sequence + 1) pl->bad_parts++;
+    pl->last_sequence = sequence;
+    base = read_be64(tfdt + 12);
+    count = read_be32(trun + 12);
+    data_offset = read_be32(trun + 16);
+    if (data_offset != moof_size + 8 || 20 + 12 * (size_t)count != (size_t)read_be32(trun)) {
+        pl->bad_parts++;
+        return;
+    }
+    sample = moof + data_offset;
+    for (i = 0; i < count; ++i) {
+        const uint8_t *entry = trun + 20 + 12 * i;
+        uint32_t duration = read_be32(entry);
+        uint32_t size = read_be32(entry + 4);
+        uint32_t flags = read_be32(entry + 8);
+        size_t expected_len;
+        int index;
+
+        if (sample + size > data + len) {
+            pl->bad_parts++;
+            return;
+        }
+        index = sample_frame_index(sample, size);
+        if (index < 0 || index >= TEST_FRAMES) {
+            pl->bad_samples++;
+            sample += size;
+            continue;
+        }
+        if (i == 0 && base != (uint64_t)index * TEST_FRAME_DURATION_90K) pl->bad_samples++;
+        /* part 目标时长是 GOP 的整数分之一，关键帧总在 part 开头。 */
+        if (i > 0 && frame_is_key(index)) pl->independent_errors++;
+        if (duration != TEST_FRAME_DURATION_90K) pl->bad_samples++;
+        if ((flags == 0x02000000U) != frame_is_key(index)) pl->bad_samples++;
+        expected_len = make_frame(pl->scratch, index, 1);
+        if (expected_len != size || memcmp(sample, pl->scratch, size) != 0) pl->bad_samples++;
+        if (index != pl->next_index) pl->gaps++;
+        pl->next_index = index + 1;
+        pl->frames++;
+        if (first < 0) first = index;
+        last = index;
+        sample += size;
+    }
+    if (first >= 0) {
+        double first_ms = (double)(recv_us - g_enqueue_us[first]) / 1000.0;
+        double last_ms = (double)(recv_us - g_enqueue_us[last]) / 1000.0;
+        pl->first_latency_sum_ms += first_ms;
+        pl->last_latency_sum_ms += last_ms;
+        if (first_ms > pl->first_latency_max_ms) pl->first_latency_max_ms = first_ms;
+        if (last_ms > pl->last_latency_max_ms) pl->last_latency_max_ms = last_ms;
+    }
+    if (msn >= 0 && msn < TEST_MAX_SEGMENTS && pl->segment_bytes[msn] &&
+        pl->segment_len[msn] + len <= TEST_BODY_MAX) {
+        memcpy(pl->segment_bytes[msn] + pl->segment_len[msn], data, len);
+        pl->segment_len[msn] += len;
+    }
+}
+
+static int playlist_has(const uint8_t *body, size_t len, const char *needle) {
+    char *text = (char *)malloc(len + 1);
+    int found;
+    if (!text) return 0;
+    memcpy(text, body, len);
+    text[len] = '\0';
+    found = strstr(text, needle) != NULL;
+    free(text);
+    return found;
+}
+
+int main() {
+    static const char *tags[] = {
+        "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=0.600",
+        "#EXT-X-PART-INF:PART-TARGET=0.200",
+        "#EXT-X-MAP:URI=\"init-0.mp4\"",
+        "#EXT-X-PROGRAM-DATE-TIME:",
+        "#EXT-X-PART:DURATION=0.200,URI=\"0.0.m4s\",INDEPENDENT=YES",
+        "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"0.",
+    };
+    Player pl;
+    MediaSink sink;
+    LlHlsSinkConfig config;
+    LlHlsSinkStats stats;
+    pthread_t producer;
+    void *impl;
+    uint8_t *body = (uint8_t *)malloc(TEST_BODY_MAX);
+    char path[256];
+    size_t body_len = 0;
+    int64_t msn = 0;
+    int part = 0;
+    int port = pick_port();
+    int fd = -1;
+    int other_fd = -1;
+    int status;
+    int ok_playlist = 1;
+    int ok_init;
+    int ok_stream;
+    int ok_segment = 1;
+    int ok_errors = 1;
+    int ok_latency;
+    int ok_stats;
+    int ok_clients;
+    int rejected;
+    int steps = 0;
+    int i;
+
+    memset(&pl, 0, sizeof(pl));
+    pl.scratch = (uint8_t *)malloc(TEST_MAX_FRAME);
+    for (i = 0; i < TEST_MAX_SEGMENTS; ++i) {
+        pl.segment_bytes[i] = (uint8_t *)malloc(TEST_BODY_MAX);
+    }
+    if (!body || !pl.scratch || port <= 0) {
+        fprintf(stderr, "[ERROR] ll hls test setup failed\n");
+        return -1;
+    }
+
+    memset(&config, 0, sizeof(config));
+    config.name = "ll-hls-test";
+    config.listen_ip = "127.0.0.1";
+    config.listen_port = port;
+    config.stream_name = "test";
+    config.segment_target_ms = TEST_SEGMENT_MS;
+    config.part_target_ms = TEST_PART_MS;
+    config.playlist_segments = TEST_PLAYLIST_SEGMENTS;
+    config.video_width = 1280;
+    config.video_height = 720;
+    /* 配置帧率故意与实际帧率不同：样本时长和 part 切分都应按 DTS，而不是按配置帧率推算。 */
+    config.video_fps = TEST_FPS + 5;
+    config.max_clients = TEST_MAX_CLIENTS;
+    config.video_bitrate = (TEST_IDR_BYTES + (TEST_GOP - 1) * TEST_P_BYTES) * 8 * TEST_FPS / TEST_GOP;
+    if (ll_hls_sink_setup(&sink, &config) != 0 || media_sink_start(&sink) != 0) {
+        fprintf(stderr, "[ERROR] ll hls sink start failed\n");
+        return -1;
+    }
+    pthread_create(&producer, NULL, producer_main, &sink);
+
+    /* 首次拉播放列表会挂起到第一个 part 生成。 */
+    snprintf(path, sizeof(path), "/hls/test/index.m3u8");
+    status = http_get(&fd, port, path, body, TEST_BODY_MAX, &body_len);
+    if (status != 200) ok_playlist = 0;
+    for (i = 0; status == 200 && i < (int)(sizeof(tags) / sizeof(tags[0])); ++i) {
+        if (!playlist_has(body, body_len, tags[i])) {
+            fprintf(stderr, "[ERROR] playlist missing %s\n", tags[i]);
+            ok_playlist = 0;
+        }
+    }
+    status = http_get(&fd, port, "/hls/test/init-0.mp4", body, TEST_BODY_MAX, &body_len);
+    ok_init = status == 200 && check_init(body, body_len);
+
+    /* 按 PRELOAD-HINT 逐个拉 part，每拉到一个 part 再做一次阻塞式刷新确认播放列表里已有它。 */
+    while (pl.next_index < TEST_FRAMES && steps++ < 1000) {
+        uint64_t recv_us;
+        snprintf(path, sizeof(path), "/hls/test/%" PRId64 ".%d.m4s", msn, part);
+        status = http_get(&fd, port, path, body, TEST_BODY_MAX, &body_len);
+        recv_us = now_us();
+        if (status == 200) {
+            char uri[64];
+            handle_part(&pl, msn, body, body_len, recv_us);
+            snprintf(path, sizeof(path), "/hls/test/index.m3u8?_HLS_msn=%" PRId64 "&_HLS_part=%d", msn, part);
+            snprintf(uri, sizeof(uri), "URI=\"%" PRId64 ".%d.m4s\"", msn, part);
+            if (http_get(&fd, port, path, body, TEST_BODY_MAX, &body_len) != 200 ||
+                !playlist_has(body, body_len, uri)) {
+                ok_playlist = 0;
+            }
+            part++;
+        } else if (status == 404 && part > 0) {
+            /* 分段在关键帧处结束，hint 指向的 part 不会再生成，等下一个分段的第一个 part。 */
+            pl.orphan_hints++;
+            msn++;
+            part = 0;
+            snprintf(path, sizeof(path), "/hls/test/index.m3u8?_HLS_msn=%" PRId64 "&_HLS_part=0", msn);
+            if (http_get(&fd, port, path, body, TEST_BODY_MAX, &body_len) != 200) {
+                ok_playlist = 0;
+                break;
+            }
+        } else {
+            fprintf(stderr, "[ERROR] part %s status=%d\n", path, status);
+            break;
+        }
+    }
+    pthread_join(producer, NULL);
+
+    /* 完整分段与各 part 拼接一致。 */
+    for (i = 1; i <= 2; ++i) {
+        snprintf(path, sizeof(path), "/hls/test/%d.m4s", i);
+        status = http_get(&other_fd, port, path, body, TEST_BODY_MAX, &body_len);
+        if (status != 200 || body_len != pl.segment_len[i] || memcmp(body, pl.segment_bytes[i], body_len) != 0) {
+            fprintf(stderr, "[ERROR] segment %s status=%d len=%zu parts_len=%zu\n", path, status, body_len, pl.segment_len[i]);
+            ok_segment = 0;
+        }
+    }
+    /* 槽位数为 TEST_PLAYLIST_SEGMENTS + 3，第 5 个分段开始时 0 号分段已被覆盖。 */
+    ok_errors &= http_get(&other_fd, port, "/hls/test/0.m4s", body, TEST_BODY_MAX, &body_len) == 404;
+    ok_errors &= http_get(&other_fd, port, "/hls/test/0.0.m4s", body, TEST_BODY_MAX, &body_len) == 404;
+    ok_errors &= http_get(&other_fd, port, "/hls/test/2.9.m4s", body, TEST_BODY_MAX, &body_len) == 404;
+    ok_errors &= http_get(&other_fd, port, "/hls/other/index.m3u8", body, TEST_BODY_MAX, &body_len) == 404;
+    ok_errors &= http_get(&other_fd, port, "/hls/test/init-5.mp4", body, TEST_BODY_MAX, &body_len) == 404;
+    ok_errors &= http_get(&other_fd, port, "/hls/test/index.m3u8?_HLS_msn=100", body, TEST_BODY_MAX, &body_len) == 400;
+    ok_errors &= other_fd < 0;
+    ok_errors &= http_get(&other_fd, port, "/hls/test/index.m3u8?_HLS_part=1", body, TEST_BODY_MAX, &body_len) == 400;
+
+    usleep(100000);
+    ll_hls_sink_get_stats(&sink, &stats);
+    if (fd >= 0) close(fd);
+    if (other_fd >= 0) close(other_fd);
+    /* 等服务线程处理完上面两个连接的关闭，再测连接数上限。 */
+    usleep(100000);
+    rejected = count_rejected_connections(port, TEST_MAX_CLIENTS + TEST_EXTRA_CLIENTS);
+    ok_clients = rejected == TEST_EXTRA_CLIENTS;
+    media_sink_stop(&sink);
+    impl = sink.impl;
+    media_sink_deinit(&sink);
+    free(impl);
+
+    ok_stream = pl.frames == TEST_FRAMES && pl.gaps == 0 && pl.bad_parts == 0 && pl.bad_samples == 0 &&
+                pl.independent_errors == 0 && pl.orphan_hints == TEST_FRAMES / TEST_GOP - 1;
+    ok_latency = pl.parts > 0 && pl.last_latency_max_ms <= TEST_MAX_LAST_FRAME_LATENCY_MS;
+    ok_stats = stats.frames == TEST_FRAMES && stats.parts == (uint64_t)pl.parts &&
+               stats.segments == (uint64_t)(TEST_FRAMES / TEST_GOP - 1) && stats.blocked_reloads > 0 &&
+               stats.overflow_drops == 0 && stats.ring_bytes > 0;
+    printf("[LL_HLS_TEST] playlist_tags=%s init=%s\n", ok_playlist ? "PASS" : "FAIL", ok_init ? "PASS" : "FAIL");
+    printf("[LL_HLS_TEST] frames=%d parts=%d gaps=%d bad_parts=%d bad_samples=%d independent_errors=%d orphan_hints=%d result=%s\n",
+           pl.frames,
+           pl.parts,
+           pl.gaps,
+           pl.bad_parts,
+           pl.bad_samples,
+           pl.independent_errors,
+           pl.orphan_hints,
+           ok_stream ? "PASS" : "FAIL");
+    printf("[LL_HLS_TEST] segment_matches_parts=%s error_paths=%s\n",
+           ok_segment ? "PASS" : "FAIL",
+           ok_errors ? "PASS" : "FAIL");
+    printf("[LL_HLS_TEST] client_limit max=%d attempted=%d rejected=%d result=%s\n",
+           TEST_MAX_CLIENTS,
+           TEST_MAX_CLIENTS + TEST_EXTRA_CLIENTS,
+           rejected,
+           ok_clients ? "PASS" : "FAIL");
+    printf("[LL_HLS_TEST] latency part_first_frame avg=%.1fms max=%.1fms part_last_frame avg=%.1fms max=%.1fms limit=%dms result=%s\n",
+           pl.parts ? pl.first_latency_sum_ms / pl.parts : 0.0,
+           pl.first_latency_max_ms,
+           pl.parts ? pl.last_latency_sum_ms / pl.parts : 0.0,
+           pl.last_latency_max_ms,
+           TEST_MAX_LAST_FRAME_LATENCY_MS,
+           ok_latency ? "PASS" : "FAIL");
+    printf("[LL_HLS_TEST] requests=%" PRIu64 " blocked_reloads=%" PRIu64 " not_found=%" PRIu64 " segments=%" PRIu64
+           " ring_bytes=%" PRIu64 " (%" PRIu64 " KB per stream) result=%s\n",
+           stats.requests,
+           stats.blocked_reloads,
+           stats.not_found,
+           stats.segments,
+           stats.ring_bytes,
+           stats.ring_bytes / 1024,
+           ok_stats ? "PASS" : "FAIL");
+
+    for (i = 0; i < TEST_MAX_SEGMENTS; ++i) {
+        free(pl.segment_bytes[i]);
+    }
+    free(pl.scratch);
+    free(body);
+    if (!(ok_playlist && ok_init && ok_stream && ok_segment && ok_errors && ok_clients && ok_latency && ok_stats)) {
+        fprintf(stderr, "[ERROR] ll hls checks failed\n");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,231 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+#include "mediaGatewayMotion.h"
+}
+
+#define TEST_WIDTH 1280
+#define TEST_HEIGHT 720
+#define TEST_FPS 30
+#define TEST_IDLE_FPS 2
+#define TEST_GOP 30
+#define TEST_FRAMES 240
+#define TEST_MOTION_START 90
+#define TEST_MOTION_END 120
+#define TEST_SQUARE 48
+#define TEST_NOISE 3
+#define TEST_FRAME_US (1000000ULL / TEST_FPS)
+
+/*
+ * 静止画面降帧测试，按虚拟时钟逐帧推进：
+ *   不带参数：合成 NV12 源，渐变背景叠加 ±3 的传感器噪声；
+ *     frame 90..119 有一个 48x48 方块每帧移动 4 像素，其余时间静止。
+ *     检查噪声不触发运动、方块出现当帧立即退出静止、停止后按 hold 时间重新进入静止，
+ *     并用网关的降帧节拍和 GOP 保活函数检查：静止期跳帧，关键帧间隔不超过配置帧率下的 GOP 时长加一个空闲帧间隔。
+ *   带参数：motion_skip_test <nv12_file> <width> <height>
+ *     逐帧分析录制的 NV12 原始文件，打印状态切换和按 idle fps 可跳过的帧数。
+ */
+
+typedef struct {
+    const MediaGatewayMotionConfig *config;
+    uint64_t next_encode_us;
+    uint64_t last_key_us;
+    uint64_t max_key_gap_us;
+    int frames_since_key;
+    uint64_t encoded;
+    uint64_t skipped;
+    uint64_t keepalive_idrs;
+} IdlePacer;
+
+static uint32_t g_seed = 12345;
+
+static uint32_t next_rand() {
+    g_seed = g_seed * 1103515245U + 12345U;
+    return (g_seed >> 16) & 0x7FFFU;
+}
+
+static void render_synthetic(uint8_t *y_plane, int frame) {
+    int x;
+    int y;
+    for (y = 0; y < TEST_HEIGHT; ++y) {
+        for (x = 0; x < TEST_WIDTH; ++x) {
+            int v = 40 + (x + y) * 160 / (TEST_WIDTH + TEST_HEIGHT);
+            v += (int)(next_rand() % (2 * TEST_NOISE + 1)) - TEST_NOISE;
+            y_plane[y * TEST_WIDTH + x] = (uint8_t)v;
+        }
+    }
+    if (frame >= TEST_MOTION_START && frame < TEST_MOTION_END) {
+        int ox = 200 + (frame - TEST_MOTION_START) * 4;
+        int oy = 300;
+        for (y = oy; y < oy + TEST_SQUARE; ++y) {
+            memset(y_plane + y * TEST_WIDTH + ox, 235, TEST_SQUARE);
+        }
+    }
+}
+
+/*
+ * 走网关同一套决策：media_gateway_motion_target_fps + media_gateway_motion_pace 决定跳帧，
+ * media_gateway_motion_gop_left_us 决定是否补发保活关键帧；编码器按帧数到 GOP 时自然出关键帧。
+ */
+static void pace_frame(IdlePacer *pacer, int is_static, uint64_t now) {
+    int idle;
+    int target_fps = media_gateway_motion_target_fps(pacer->config, is_static, 0, &idle);
+    int keepalive;
+
+    if (media_gateway_motion_pace(&pacer->next_encode_us, target_fps, now)) {
+        pacer->skipped++;
+        return;
+    }
+    pacer->encoded++;
+    keepalive = media_gateway_motion_gop_left_us(pacer->next_encode_us, pacer->last_key_us, TEST_FPS, TEST_GOP, now) == 0;
+    if (pacer->last_key_us == 0 || keepalive || ++pacer->frames_since_key >= TEST_GOP) {
+        if (pacer->last_key_us != 0 && now - pacer->last_key_us > pacer->max_key_gap_us) {
+            pacer->max_key_gap_us = now - pacer->last_key_us;
+        }
+        if (keepalive) pacer->keepalive_idrs++;
+        pacer->last_key_us = now;
+        pacer->frames_since_key = 0;
+    }
+}
+
+static int run_recorded(const char *path, int width, int height) {
+    MediaGatewayMotionConfig config;
+    MediaGatewayMotion motion;
+    IdlePacer pacer;
+    size_t frame_size = (size_t)width * (size_t)height * 3 / 2;
+    uint8_t *frame_data;
+    FILE *fp;
+    int frame = 0;
+    int was_static = 0;
+
+    fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "[ERROR] open %s failed\n", path);
+        return -1;
+    }
+    frame_data = (uint8_t *)malloc(frame_size);
+    memset(&config, 0, sizeof(config));
+    config.enabled = 1;
+    media_gateway_motion_fill_default(&config, TEST_FPS);
+    if (!frame_data || media_gateway_motion_init(&motion, &config, width, height) != 0) {
+        free(frame_data);
+        fclose(fp);
+        return -1;
+    }
+    memset(&pacer, 0, sizeof(pacer));
+    pacer.config = &motion.config;
+    while (fread(frame_data, 1, frame_size, fp) == frame_size) {
+        uint64_t now = (uint64_t)(frame + 1) * TEST_FRAME_US;
+        int is_static = media_gateway_motion_analyze(&motion, frame_data, width, now);
+        if (is_static != was_static) {
+            printf("[MOTION] frame=%d event=%s changed_blocks=%d\n",
+                   frame, is_static ? "static" : "motion", motion.last_changed_blocks);
+            was_static = is_static;
+        }
+        pace_frame(&pacer, is_static, now);
+        frame++;
+    }
+    printf("[MOTION_SUMMARY] frames=%d encoded=%" PRIu64 " skipped=%" PRIu64 " keepalive_idrs=%" PRIu64
+           " static_enters=%" PRIu64 " analyze_avg_us=%.1f\n",
+           frame,
+           pacer.encoded,
+           pacer.skipped,
+           pacer.keepalive_idrs,
+           motion.static_enter_count,
+           (motion.analyzed_frames > 0) ? (double)motion.analyze_us_sum / (double)motion.analyzed_frames : 0.0);
+    media_gateway_motion_deinit(&motion);
+    free(frame_data);
+    fclose(fp);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    MediaGatewayMotionConfig config;
+    MediaGatewayMotion motion;
+    IdlePacer pacer;
+    uint8_t *y_plane;
+    int static_before_motion = 0;
+    int motion_detected_at = -1;
+    int static_again_at = -1;
+    int false_motion = 0;
+    int was_static = 0;
+    int frame;
+    int ret = 0;
+
+    if (argc >= 4) return run_recorded(argv[1], atoi(argv[2]), atoi(argv[3]));
+
+    memset(&config, 0, sizeof(config));
+    config.enabled = 1;
+    config.idle_fps = TEST_IDLE_FPS;
+    config.static_hold_ms = 1000;
+    media_gateway_motion_fill_default(&config, TEST_FPS);
+    y_plane = (uint8_t *)malloc((size_t)TEST_WIDTH * TEST_HEIGHT);
+    if (!y_plane || media_gateway_motion_init(&motion, &config, TEST_WIDTH, TEST_HEIGHT) != 0) {
+        free(y_plane);
+        return -1;
+    }
+    memset(&pacer, 0, sizeof(pacer));
+    pacer.config = &motion.config;
+
+    for (frame = 0; frame < TEST_FRAMES; ++frame) {
+        uint64_t now = (uint64_t)(frame + 1) * TEST_FRAME_US;
+        int is_static;
+
+        render_synthetic(y_plane, frame);
+        is_static = media_gateway_motion_analyze(&motion, y_plane, TEST_WIDTH, now);
+        if (is_static != was_static) {
+            printf("[MOTION] frame=%d event=%s changed_blocks=%d\n",
+                   frame, is_static ? "static" : "motion", motion.last_changed_blocks);
+        }
+        if (frame == TEST_MOTION_START - 1) static_before_motion = is_static;
+        if (!is_static && was_static) {
+            if (frame == TEST_MOTION_START) {
+                motion_detected_at = frame;
+            } else {
+                false_motion++;
+            }
+        }
+        if (is_static && !was_static && frame > TEST_MOTION_START) static_again_at = frame;
+        was_static = is_static;
+        pace_frame(&pacer, is_static, now);
+    }
+
+    printf("[MOTION_SUMMARY] frames=%d encoded=%" PRIu64 " skipped=%" PRIu64 " keepalive_idrs=%" PRIu64
+           " max_key_gap_ms=%" PRIu64 " static_enters=%" PRIu64 " analyze_avg_us=%.1f\n",
+           TEST_FRAMES,
+           pacer.encoded,
+           pacer.skipped,
+           pacer.keepalive_idrs,
+           (uint64_t)(pacer.max_key_gap_us / 1000ULL),
+           motion.static_enter_count,
+           (double)motion.analyze_us_sum / (double)motion.analyzed_frames);
+
+    if (!static_before_motion || false_motion > 0) {
+        fprintf(stderr, "[ERROR] sensor noise was not classified as static\n");
+        ret = -1;
+    }
+    if (motion_detected_at != TEST_MOTION_START) {
+        fprintf(stderr, "[ERROR] motion was not detected on its first frame\n");
+        ret = -1;
+    }
+    if (static_again_at < 0 || static_again_at > TEST_MOTION_END + TEST_FPS + 1) {
+        fprintf(stderr, "[ERROR] stream did not return to idle after motion stopped\n");
+        ret = -1;
+    }
+    if (pacer.skipped == 0) {
+        fprintf(stderr, "[ERROR] no frames skipped in static periods\n");
+        ret = -1;
+    }
+    if (pacer.keepalive_idrs == 0 ||
+        pacer.max_key_gap_us > (uint64_t)TEST_GOP * 1000000ULL / TEST_FPS + 1000000ULL / TEST_IDLE_FPS) {
+        fprintf(stderr, "[ERROR] keyframe interval was not kept at the configured GOP duration while idle\n");
+        ret = -1;
+    }
+
+    media_gateway_motion_deinit(&motion);
+    free(y_plane);
+    return ret;
+}
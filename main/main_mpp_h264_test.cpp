@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "mppEncoder.h"
 #include "v4l2Capture.h"
@@ -9,9 +11,62 @@
 #define ENCODE_FPS 30
 #define ENCODE_BITRATE (2 * 1024 * 1024)
 #define ENCODE_GOP 60
+#define RECONFIG_INPLACE_FRAME 100
+#define RECONFIG_RECREATE_FRAME 200
+#define REJECT_QP_MIN 40
+#define REJECT_QP_MAX 20
+
+static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+/**
+ * @brief 用 qp_min > qp_max 的非法区间原地调参，确认 MPP 拒绝后配置对象里的码控键全部还原
+ *
+ * @param enc 已初始化的编码器
+ * @return int 0 表示还原正确，-1 表示调参未被拒绝或配置对象残留了新值
+ */
+static int check_rejected_qp_change(MppEncoderCtx *enc) {
+    MppEncoderRcSnapshot before;
+    MppEncoderRcSnapshot after;
+    MppEncoderOptions options = enc->options;
+    int ret;
+    int i;
+
+    mpp_encoder_snapshot_rc_cfg(enc, &before);
+    options.qp_min = REJECT_QP_MIN;
+    options.qp_max = REJECT_QP_MAX;
+    ret = mpp_encoder_reconfigure(enc, CAPTURE_WIDTH, CAPTURE_HEIGHT,
+                                  ENCODE_FPS, ENCODE_BITRATE / 2, ENCODE_GOP, &options);
+    mpp_encoder_snapshot_rc_cfg(enc, &after);
+    if (ret >= 0) {
+        printf("[RECONFIG] mode=reject_qp result=FAIL reason=accepted\n");
+        return -1;
+    }
+    for (i = 0; i < MPP_ENCODER_RC_CFG_KEYS; ++i) {
+        if (before.values[i] != after.values[i]) {
+            printf("[RECONFIG] mode=reject_qp result=FAIL key_index=%d before=%d after=%d\n",
+                   i, before.values[i], after.values[i]);
+            return -1;
+        }
+    }
+    if (memcmp(&options, &enc->options, sizeof(options)) == 0 || enc->bitrate != ENCODE_BITRATE) {
+        printf("[RECONFIG] mode=reject_qp result=FAIL reason=state_not_restored\n");
+        return -1;
+    }
+    printf("[RECONFIG] mode=reject_qp result=PASS\n");
+    return 0;
+}
 
 /**
  * @brief MPP编码测试程序，使用命令 ffplay -f h264 capture.h264 验证
+ *
+ * 第 RECONFIG_INPLACE_FRAME 帧用 mpp_encoder_reconfigure 原地把码率减半，
+ * 第 RECONFIG_RECREATE_FRAME 帧用 deinit + init 恢复码率，对比两种方式的卡顿：
+ * 调用耗时、期间错过的采集帧数、恢复出包前的空帧数。
+ * 开始采集前先做一次会被 MPP 拒绝的 QP 调参，检查码控配置是否完整还原。
  * 
  * @return int 
  */
@@ -29,6 +84,10 @@ int main() {
     uint64_t dqbuf_ioctl_us = 0;
     uint64_t frame_copy_us = 0;
     int frame_count = 0;
+    const char *reconfig_mode = NULL;
+    uint64_t reconfig_stall_us = 0;
+    uint64_t reconfig_frame_id = 0;
+    int reconfig_empty_frames = 0;
 
     // 1) 初始化采集端（V4L2）与编码端（MPP H264）。
     if (v4l2_capture_init(&cap_ctx) < 0) {
@@ -48,6 +107,12 @@ int main() {
         return -1;
     }
 
+    if (check_rejected_qp_change(&enc_ctx) < 0) {
+        mpp_encoder_deinit(&enc_ctx);
+        v4l2_capture_deinit(&cap_ctx);
+        return -1;
+    }
+
     // 2) 输出裸 H264 文件（Annex-B），用于 ffplay/ffmpeg 验证。
     fp = fopen(ENCODE_OUTPUT_FILE, "wb");
     if (!fp) {
@@ -76,6 +141,28 @@ int main() {
         size_t h264_len = 0;
         int is_key = 0;
 
+        if (frame_count == RECONFIG_INPLACE_FRAME || frame_count == RECONFIG_RECREATE_FRAME) {
+            uint64_t start_us = now_us();
+            int ret;
+            if (frame_count == RECONFIG_INPLACE_FRAME) {
+                reconfig_mode = "inplace";
+                ret = mpp_encoder_reconfigure(&enc_ctx, CAPTURE_WIDTH, CAPTURE_HEIGHT,
+                                              ENCODE_FPS, ENCODE_BITRATE / 2, ENCODE_GOP, NULL);
+            } else {
+                reconfig_mode = "recreate";
+                mpp_encoder_deinit(&enc_ctx);
+                ret = mpp_encoder_init(&enc_ctx, CAPTURE_WIDTH, CAPTURE_HEIGHT,
+                                       ENCODE_FPS, ENCODE_BITRATE, ENCODE_GOP, NULL);
+            }
+            reconfig_stall_us = now_us() - start_us;
+            if (ret < 0) {
+                fprintf(stderr, "[ERROR] %s reconfigure failed\n", reconfig_mode);
+                break;
+            }
+            reconfig_frame_id = frame_id;
+            reconfig_empty_frames = 0;
+        }
+
         if (mpp_encoder_encode_frame(&enc_ctx,
                                      raw_frame,
                                      (size_t)raw_frame_len,
@@ -90,6 +177,21 @@ int main() {
             break;
         }
 
+        if (reconfig_mode) {
+            if (!h264_data || h264_len == 0) {
+                reconfig_empty_frames++;
+            } else {
+                // 采集帧号的跳变即为调参期间被丢弃的帧。
+                printf("[RECONFIG] mode=%s stall_us=%llu dropped_capture=%llu empty_output=%d first_key=%d\n",
+                       reconfig_mode,
+                       (unsigned long long)reconfig_stall_us,
+                       (unsigned long long)(frame_id - reconfig_frame_id - (uint64_t)reconfig_empty_frames),
+                       reconfig_empty_frames,
+                       is_key);
+                reconfig_mode = NULL;
+            }
+        }
+
         if (h264_data && h264_len > 0) {
             fwrite(h264_data, 1, h264_len, fp);
             if (frame_count % ENCODE_FPS == 0) {
@@ -0,0 +1,314 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern "C" {
+#include "gb28181Log.h"
+#include "gb28181PsMuxer.h"
+}
+
+#define BENCH_FRAMES 3000
+#define BENCH_GOP 30
+#define BENCH_IDR_BYTES (120 * 1024)
+#define BENCH_P_BYTES (25 * 1024)
+#define BENCH_RTP_HEADER 12
+#define BENCH_RTP_MAX_PAYLOAD 1400
+#define BENCH_LEGACY_BUFFER (2 * 1024 * 1024)
+
+/*
+ * GB28181 PS 封装基准：
+ *   合成 GOP=30 的 Annex-B 码流（关键帧 AUD+SPS+PPS+IDR，其余 AUD+P），
+ *   分别用旧的“整帧拷贝进 2MB 缓存再逐片拷贝进 RTP 包”方式和常驻 muxer 的分段方式封装分包，
+ *   比较每帧拷贝字节数和分包吞吐，并逐帧校验两种方式输出的 PS 字节流和包数一致。
+ *   另测一轮 trace：分段方式之外每帧照旧格式化 NALU 列表并写日志（写到 /dev/null），
+ *   与按级别关闭后的 scatter 对比，给出逐帧调试日志在热路径上的代价。
+ *   最后检查 NALU 数上限：恰好 GB28181_PS_MUXER_MAX_NALUS 个切片能封装，多一个必须整帧报错而不是丢掉尾部切片。
+ */
+
+typedef struct {
+    uint8_t *concat;
+    size_t concat_len;
+    uint64_t packets;
+    uint64_t copied_bytes;
+    int bad_length;
+} PacketSink;
+
+static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static size_t append_nalu(uint8_t *dst, uint8_t header, size_t len, uint32_t *seed) {
+    size_t i;
+    dst[0] = 0;
+    dst[1] = 0;
+    dst[2] = 0;
+    dst[3] = 1;
+    dst[4] = header;
+    for (i = 1; i < len; ++i) {
+        *seed = *seed * 1103515245U + 12345U;
+        /* 负载不含 0x00，避免伪起始码。 */
+        dst[4 + i] = (uint8_t)(0x10 + ((*seed >> 16) % 0xF0));
+    }
+    return 4 + len;
+}
+
+static size_t make_frame(uint8_t *dst, int key, uint32_t *seed) {
+    size_t len = 0;
+    len += append_nalu(dst + len, 0x09, 2, seed);
+    if (key) {
+        len += append_nalu(dst + len, 0x67, 20, seed);
+        len += append_nalu(dst + len, 0x68, 5, seed);
+        len += append_nalu(dst + len, 0x65, BENCH_IDR_BYTES, seed);
+    } else {
+        len += append_nalu(dst + len, 0x41, BENCH_P_BYTES, seed);
+    }
+    return len;
+}
+
+/* 旧实现的等价物：整帧 PS 写进大缓存。 */
+static void put_bytes(uint8_t *buf, size_t *len, const void *data, size_t n) {
+    memcpy(buf + *len, data, n);
+    *len += n;
+}
+
+static size_t legacy_build_ps(const uint8_t *frame, size_t frame_len, int key, uint64_t pts_90k, uint8_t *ps) {
+    static const uint8_t system_header[] = {0x00, 0x00, 0x01, 0xBB, 0x00, 0x0C, 0x80, 0x04, 0x04, 0xE1, 0x7F, 0xE0, 0xE0, 0xE8, 0xC0, 0x20, 0xBD, 0xE0};
+    static const uint8_t psm[] = {0x00, 0x00, 0x01, 0xBC, 0x00, 0x12, 0xE0, 0xFF, 0x00, 0x00, 0x00, 0x08, 0x1B, 0xE0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x45, 0xBD, 0xDC, 0xF4};
+    static const uint8_t start_code[4] = {0x00, 0x00, 0x00, 0x01};
+    uint64_t scr = pts_90k & 0x1FFFFFFFFULL;
+    uint8_t pack[14];
+    size_t len = 0;
+    size_t pos = 0;
+
+    pack[0] = 0x00;
+    pack[1] = 0x00;
+    pack[2] = 0x01;
+    pack[3] = 0xBA;
+    pack[4] = (uint8_t)(0x44 | ((scr >> 27) & 0x38) | ((scr >> 28) & 0x03));
+    pack[5] = (uint8_t)(scr >> 20);
+    pack[6] = (uint8_t)(((scr >> 12) & 0xF8) | 0x04 | ((scr >> 13) & 0x03));
+    pack[7] = (uint8_t)(scr >> 5);
+    pack[8] = (uint8_t)(((scr << 3) & 0xF8) | 0x04);
+    pack[9] = 0x01;
+    pack[10] = 0x89;
+    pack[11] = 0xC3;
+    pack[12] = 0xF8;
+    pack[13] = 0x00;
+    put_bytes(ps, &len, pack, sizeof(pack));
+    if (key) {
+        put_bytes(ps, &len, system_header, sizeof(system_header));
+        put_bytes(ps, &len, psm, sizeof(psm));
+    }
+    /* 合成帧全部使用 4 字节起始码，NALU 边界按起始码切分即可。 */
+    while (pos + 4 < frame_len) {
+        size_t start = pos + 4;
+        size_t next = start;
+        uint8_t header[14];
+        size_t pes_len;
+        while (next + 4 <= frame_len && memcmp(frame + next, start_code, 4) != 0) next++;
+        if (next + 4 > frame_len) next = frame_len;
+        pos = next;
+        if ((frame[start] & 0x1F) == 9) continue;
+        pes_len = (next - start) + 4 + 8;
+        if (pes_len > 0xFFFF) pes_len = 0;
+        header[0] = 0x00;
+        header[1] = 0x00;
+        header[2] = 0x01;
+        header[3] = 0xE0;
+        header[4] = (uint8_t)(pes_len >> 8);
+        header[5] = (uint8_t)pes_len;
+        header[6] = 0x80;
+        header[7] = 0x80;
+        header[8] = 0x05;
+        header[9] = (uint8_t)((0x02 << 4) | (((scr >> 30) & 0x07) << 1) | 0x01);
+        header[10] = (uint8_t)(scr >> 22);
+        header[11] = (uint8_t)((((scr >> 15) & 0x7F) << 1) | 0x01);
+        header[12] = (uint8_t)(scr >> 7);
+        header[13] = (uint8_t)(((scr & 0x7F) << 1) | 0x01);
+        put_bytes(ps, &len, header, sizeof(header));
+        put_bytes(ps, &len, start_code, sizeof(start_code));
+        put_bytes(ps, &len, frame + start, next - start);
+    }
+    return len;
+}
+
+static void legacy_packetize(const uint8_t *ps, size_t ps_len, PacketSink *sink) {
+    uint8_t packet[BENCH_RTP_HEADER + BENCH_RTP_MAX_PAYLOAD];
+    size_t offset = 0;
+    while (offset < ps_len) {
+        size_t chunk = ps_len - offset;
+        if (chunk > BENCH_RTP_MAX_PAYLOAD) chunk = BENCH_RTP_MAX_PAYLOAD;
+        memset(packet, 0, BENCH_RTP_HEADER);
+        memcpy(packet + BENCH_RTP_HEADER, ps + offset, chunk);
+        sink->copied_bytes += chunk;
+        sink->packets++;
+        if (sink->concat) {
+            memcpy(sink->concat + sink->concat_len, packet + BENCH_RTP_HEADER, chunk);
+            sink->concat_len += chunk;
+        }
+        offset += chunk;
+    }
+}
+
+/* 旧版默认级别下每帧都会做的 NALU 列表拼接和输出。 */
+static void trace_nalus(FILE *out, const Gb28181PsMuxer *muxer, int key, uint64_t pts_90k) {
+    char type_log[512];
+    size_t pos = 0;
+    size_t i;
+    type_log[0] = '\0';
+    for (i = 0; i < muxer->nalu_count && pos < sizeof(type_log) - 1; ++i) {
+        int written = snprintf(type_log + pos, sizeof(type_log) - pos, "%s%u", (i > 0) ? "," : "", (unsigned int)muxer->nalus[i].type);
+        if (written < 0 || (size_t)written >= sizeof(type_log) - pos) break;
+        pos += (size_t)written;
+    }
+    fprintf(out, "[GB28181][H264] pts_90k=%" PRIu64 " key=%d nalu_count=%zu types=%s\n", pts_90k, key, muxer->nalu_count, type_log);
+}
+
+/* 拼一帧 slice_count 个 P 切片的 Annex-B 数据。 */
+static size_t make_sliced_frame(uint8_t *dst, int slice_count, uint32_t *seed) {
+    size_t len = 0;
+    int i;
+    for (i = 0; i < slice_count; ++i) len += append_nalu(dst + len, 0x41, 64, seed);
+    return len;
+}
+
+static int muxer_packet(void *user, const struct iovec *iov, int iov_count, size_t payload_len, int marker) {
+    PacketSink *sink = (PacketSink *)user;
+    size_t total = 0;
+    int i;
+    for (i = 0; i < iov_count; ++i) {
+        if (sink->concat) memcpy(sink->concat + sink->concat_len + total, iov[i].iov_base, iov[i].iov_len);
+        total += iov[i].iov_len;
+    }
+    if (total != payload_len) sink->bad_length = 1;
+    if (sink->concat) sink->concat_len += total;
+    sink->packets++;
+    (void)marker;
+    return 0;
+}
+
+int main() {
+    uint8_t *frame = (uint8_t *)malloc(BENCH_IDR_BYTES + 1024);
+    uint8_t *reference = (uint8_t *)malloc(BENCH_LEGACY_BUFFER);
+    uint8_t *concat = (uint8_t *)malloc(BENCH_LEGACY_BUFFER);
+    Gb28181PsMuxer *muxer = (Gb28181PsMuxer *)malloc(sizeof(Gb28181PsMuxer));
+    PacketSink legacy;
+    PacketSink scatter;
+    PacketSink traced;
+    FILE *trace_out = fopen("/dev/null", "w");
+    uint64_t legacy_us = 0;
+    uint64_t scatter_us = 0;
+    uint64_t traced_us = 0;
+    uint64_t legacy_allocs = 0;
+    uint32_t seed = 1;
+    int mismatches = 0;
+    int i;
+
+    if (!frame || !reference || !concat || !muxer || !trace_out) return -1;
+    memset(&legacy, 0, sizeof(legacy));
+    memset(&scatter, 0, sizeof(scatter));
+    memset(&traced, 0, sizeof(traced));
+    gb28181_ps_muxer_init(muxer);
+    gb28181_log_set_level(GB28181_LOG_LEVEL_INFO);
+
+    for (i = 0; i < BENCH_FRAMES; ++i) {
+        int key = (i % BENCH_GOP) == 0;
+        uint64_t pts_90k = (uint64_t)i * 3000ULL;
+        size_t frame_len = make_frame(frame, key, &seed);
+        size_t ref_len;
+        uint64_t legacy_packets_before = legacy.packets;
+        uint64_t scatter_packets_before = scatter.packets;
+        uint64_t t0;
+        uint8_t *ps;
+
+        /* 旧路径：每帧 malloc 2MB、整帧拷贝、逐片再拷贝。 */
+        t0 = now_us();
+        ps = (uint8_t *)malloc(BENCH_LEGACY_BUFFER);
+        legacy_allocs++;
+        ref_len = legacy_build_ps(frame, frame_len, key, pts_90k, ps);
+        legacy.copied_bytes += ref_len;
+        legacy_packetize(ps, ref_len, &legacy);
+        free(ps);
+        legacy_us += now_us() - t0;
+
+        t0 = now_us();
+        if (gb28181_ps_muxer_build(muxer, frame, frame_len, key, pts_90k) != 0 ||
+            gb28181_ps_muxer_packetize(muxer, BENCH_RTP_MAX_PAYLOAD, muxer_packet, &scatter) != 0) {
+            fprintf(stderr, "[ERROR] muxer failed at frame %d\n", i);
+            return -1;
+        }
+        if (GB28181_LOG_ENABLED(GB28181_LOG_LEVEL_DEBUG)) trace_nalus(trace_out, muxer, key, pts_90k);
+        scatter_us += now_us() - t0;
+
+        t0 = now_us();
+        if (gb28181_ps_muxer_build(muxer, frame, frame_len, key, pts_90k) != 0 ||
+            gb28181_ps_muxer_packetize(muxer, BENCH_RTP_MAX_PAYLOAD, muxer_packet, &traced) != 0) {
+            fprintf(stderr, "[ERROR] muxer failed at frame %d\n", i);
+            return -1;
+        }
+        trace_nalus(trace_out, muxer, key, pts_90k);
+        traced_us += now_us() - t0;
+
+        /* 校验轮：不计时，重新封装一次并拼接负载逐字节比较。 */
+        if (i < BENCH_GOP * 2) {
+            PacketSink check;
+            memset(&check, 0, sizeof(check));
+            check.concat = concat;
+            legacy_build_ps(frame, frame_len, key, pts_90k, reference);
+            if (gb28181_ps_muxer_packetize(muxer, BENCH_RTP_MAX_PAYLOAD, muxer_packet, &check) != 0 ||
+                check.concat_len != ref_len || memcmp(concat, reference, ref_len) != 0 || check.bad_length) {
+                fprintf(stderr, "[ERROR] ps mismatch at frame %d len=%zu ref_len=%zu\n", i, check.concat_len, ref_len);
+                mismatches++;
+            }
+        }
+        if (scatter.packets - scatter_packets_before != legacy.packets - legacy_packets_before) {
+            fprintf(stderr, "[ERROR] packet count mismatch at frame %d\n", i);
+            mismatches++;
+        }
+    }
+
+    printf("[PS_BENCH] mode=legacy frames=%d packets=%" PRIu64 " pkt_per_sec=%.0f copied_per_frame=%.0f heap_allocs=%" PRIu64 "\n",
+           BENCH_FRAMES,
+           legacy.packets,
+           (legacy_us > 0) ? (double)legacy.packets * 1000000.0 / (double)legacy_us : 0.0,
+           (double)legacy.copied_bytes / BENCH_FRAMES,
+           legacy_allocs);
+    printf("[PS_BENCH] mode=scatter frames=%d packets=%" PRIu64 " pkt_per_sec=%.0f copied_per_frame=%.0f heap_allocs=0\n",
+           BENCH_FRAMES,
+           scatter.packets,
+           (scatter_us > 0) ? (double)scatter.packets * 1000000.0 / (double)scatter_us : 0.0,
+           (double)muxer->copied_bytes / (double)muxer->frames);
+    printf("[PS_BENCH] mode=scatter_trace frames=%d packets=%" PRIu64 " pkt_per_sec=%.0f trace_cost_us_per_frame=%.2f\n",
+           BENCH_FRAMES,
+           traced.packets,
+           (traced_us > 0) ? (double)traced.packets * 1000000.0 / (double)traced_us : 0.0,
+           (traced_us > scatter_us) ? (double)(traced_us - scatter_us) / BENCH_FRAMES : 0.0);
+
+    {
+        size_t sliced_len = make_sliced_frame(frame, GB28181_PS_MUXER_MAX_NALUS, &seed);
+        if (gb28181_ps_muxer_build(muxer, frame, sliced_len, 0, 0) != 0 || muxer->nalu_count != GB28181_PS_MUXER_MAX_NALUS) {
+            fprintf(stderr, "[ERROR] frame with %d slices was not muxed whole\n", GB28181_PS_MUXER_MAX_NALUS);
+            mismatches++;
+        }
+        sliced_len = make_sliced_frame(frame, GB28181_PS_MUXER_MAX_NALUS + 1, &seed);
+        if (gb28181_ps_muxer_build(muxer, frame, sliced_len, 0, 0) == 0) {
+            fprintf(stderr, "[ERROR] frame with %d slices was muxed with NALUs dropped\n", GB28181_PS_MUXER_MAX_NALUS + 1);
+            mismatches++;
+        }
+    }
+
+    free(frame);
+    free(reference);
+    free(concat);
+    free(muxer);
+    fclose(trace_out);
+    if (mismatches > 0) {
+        fprintf(stderr, "[ERROR] %d frames differ from the legacy PS output\n", mismatches);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,498 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+#include "rtmpFanoutSink.h"
+#include "rtmpPublisher.h"
+}
+
+#define TEST_FRAMES 150
+#define TEST_GOP 10
+#define TEST_IDR_BYTES (200 * 1024)
+#define TEST_P_BYTES (50 * 1024)
+#define TEST_FRAME_INTERVAL_US 10000
+#define TEST_CHUNK_SIZE 4096
+#define TEST_SEND_TIMEOUT_MS 200
+#define TEST_CONNECT_TIMEOUT_MS 300
+#define TEST_RECONNECT_INTERVAL_MS 100
+#define TEST_MAX_RECONNECT_INTERVAL_MS 800
+#define STUB_MAX_MESSAGE (512 * 1024)
+#define STUB_MAX_CSID 16
+
+/*
+ * RTMP 多目的地扇出回环测试，同一路码流推给三个目的地：
+ *   A. 正常接收桩：逐字节比对每帧负载和时间戳，应收齐全部帧；
+ *   B. publish 之后停止读取的接收桩：发送超时后独立重连，不能拖慢 A；
+ *   C. 没有服务监听的端口：连接失败后按退避间隔重试，重试次数应远少于关键帧数。
+ * 同时检查每帧只封装一次（封装帧数等于输入帧数，而不是乘以目的地数）。
+ *
+ * 用法：rtmp_fanout_test
+ */
+
+typedef struct {
+    int listen_fd;
+    int port;
+    int stall_after_publish; /* 1: publish 之后不再读取。 */
+    volatile int stop;
+    int published;
+    int metadata_ok;
+    int sequence_header_ok;
+    int frames_ok;
+    int frames_bad;
+    int pong_ok;
+    int client_chunk_size;
+    char app[64];
+    char stream[64];
+} Stub;
+
+typedef struct {
+    uint32_t length;
+    uint32_t timestamp;
+    uint8_t type;
+    uint32_t received;
+    uint8_t *body;
+} StubStream;
+
+static size_t append_nalu(uint8_t *dst, uint8_t header, size_t len, uint32_t seed) {
+    size_t i;
+    dst[0] = 0;
+    dst[1] = 0;
+    dst[2] = 0;
+    dst[3] = 1;
+    dst[4] = header;
+    for (i = 1; i < len; ++i) {
+        seed = seed * 1103515245U + 12345U;
+        /* 负载不含 0x00，避免伪起始码。 */
+        dst[4 + i] = (uint8_t)(0x10 + ((seed >> 16) % 0xF0));
+    }
+    return 4 + len;
+}
+
+/* 帧内容只由帧号决定，接收桩据此重建期望负载。 */
+static size_t make_frame(uint8_t *dst, int index) {
+    size_t len = 0;
+    int key = (index % TEST_GOP) == 0;
+    len += append_nalu(dst + len, 0x09, 2, 1);
+    if (key) {
+        len += append_nalu(dst + len, 0x67, 20, 7);
+        len += append_nalu(dst + len, 0x68, 5, 8);
+        len += append_nalu(dst + len, 0x65, TEST_IDR_BYTES, (uint32_t)index);
+    } else {
+        len += append_nalu(dst + len, 0x41, TEST_P_BYTES, (uint32_t)index);
+    }
+    return len;
+}
+
+static int stub_read(int fd, uint8_t *buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = recv(fd, buf + got, len - got, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return -1;
+        }
+        got += (size_t)n;
+    }
+    return 0;
+}
+
+static int stub_write(int fd, const uint8_t *buf, size_t len) {
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = send(fd, buf + sent, len - sent, MSG_NOSIGNAL);
+        if (n <= 0) return -1;
+        sent += (size_t)n;
+    }
+    return 0;
+}
+
+/* 按默认 128 字节 chunk 发出一条消息，让客户端走 fmt 3 续传的重组路径。 */
+static int stub_send(int fd, int csid, uint8_t type, uint32_t stream_id, const uint8_t *body, size_t len) {
+    uint8_t out[4096];
+    size_t pos = 0;
+    size_t off = 0;
+    out[pos++] = (uint8_t)csid;
+    out[pos++] = 0;
+    out[pos++] = 0;
+    out[pos++] = 0;
+    out[pos++] = (uint8_t)(len >> 16);
+    out[pos++] = (uint8_t)(len >> 8);
+    out[pos++] = (uint8_t)len;
+    out[pos++] = type;
+    out[pos++] = (uint8_t)stream_id;
+    out[pos++] = (uint8_t)(stream_id >> 8);
+    out[pos++] = (uint8_t)(stream_id >> 16);
+    out[pos++] = (uint8_t)(stream_id >> 24);
+    while (off < len) {
+        size_t take = (len - off > 128) ? 128 : len - off;
+        if (off > 0) out[pos++] = (uint8_t)(0xC0 | csid);
+        memcpy(out + pos, body + off, take);
+        pos += take;
+        off += take;
+    }
+    return stub_write(fd, out, pos);
+}
+
+static int stub_recv_message(int fd, StubStream *streams, int *in_chunk, uint8_t *type, uint8_t **body, uint32_t *len, uint32_t *ts) {
+    for (;;) {
+        uint8_t b;
+        uint8_t h[11];
+        int fmt;
+        int csid;
+        StubStream *s;
+        uint32_t chunk;
+        if (stub_read(fd, &b, 1) != 0) return -1;
+        fmt = b >> 6;
+        csid = b & 0x3F;
+        if (csid < 2 || csid >= STUB_MAX_CSID) return -1;
+        s = &streams[csid];
+        if (fmt == 0) {
+            if (stub_read(fd, h, 11) != 0) return -1;
+            s->timestamp = ((uint32_t)h[0] << 16) | ((uint32_t)h[1] << 8) | h[2];
+            s->length = ((uint32_t)h[3] << 16) | ((uint32_t)h[4] << 8) | h[5];
+            s->type = h[6];
+            if (s->timestamp == 0xFFFFFF) {
+                if (stub_read(fd, h, 4) != 0) return -1;
+                s->timestamp = ((uint32_t)h[0] << 24) | ((uint32_t)h[1] << 16) | ((uint32_t)h[2] << 8) | h[3];
+            }
+            s->received = 0;
+        } else if (fmt != 3) {
+            /* 被测客户端只发 fmt 0 / fmt 3。 */
+            return -1;
+        }
+        if (s->length > STUB_MAX_MESSAGE) return -1;
+        if (!s->body) s->body = (uint8_t *)malloc(STUB_MAX_MESSAGE);
+        chunk = s->length - s->received;
+        if (chunk > (uint32_t)*in_chunk) chunk = (uint32_t)*in_chunk;
+        if (stub_read(fd, s->body + s->received, chunk) != 0) return -1;
+        s->received += chunk;
+        if (s->received < s->length) continue;
+        s->received = 0;
+        if (s->type == RTMP_MSG_SET_CHUNK_SIZE && s->length >= 4) {
+            *in_chunk = (int)(((uint32_t)s->body[0] << 24) | ((uint32_t)s->body[1] << 16) | ((uint32_t)s->body[2] << 8) | s->body[3]);
+            continue;
+        }
+        *type = s->type;
+        *body = s->body;
+        *len = s->length;
+        *ts = s->timestamp;
+        return 0;
+    }
+}
+
+static int amf_string_at(const uint8_t *p, size_t len, char *out, size_t out_size) {
+    size_t n;
+    if (len < 3 || p[0] != RTMP_AMF0_STRING) return -1;
+    n = ((size_t)p[1] << 8) | p[2];
+    if (n + 3 > len || n >= out_size) return -1;
+    memcpy(out, p + 3, n);
+    out[n] = '\0';
+    return (int)(n + 3);
+}
+
+static double amf_number_at(const uint8_t *p) {
+    uint64_t bits = 0;
+    double v;
+    int i;
+    for (i = 1; i <= 8; ++i) bits = (bits << 8) | p[i];
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static int stub_reply(int fd, const char *name, double txn, uint32_t stream_id, int with_number, double number, const char *code) {
+    uint8_t body[1024];
+    uint8_t *p = body;
+    p = rtmp_amf_write_string(p, name);
+    p = rtmp_amf_write_number(p, txn);
+    if (code) {
+        p = rtmp_amf_write_null(p);
+        *p++ = RTMP_AMF0_OBJECT;
+        p = rtmp_amf_write_string(rtmp_amf_write_key(p, "level"), "status");
+        p = rtmp_amf_write_string(rtmp_amf_write_key(p, "code"), code);
+        p = rtmp_amf_write_string(rtmp_amf_write_key(p, "description"), "publishing");
+        p = rtmp_amf_write_object_end(p);
+    } else if (with_number) {
+        p = rtmp_amf_write_null(p);
+        p = rtmp_amf_write_number(p, number);
+    } else {
+        /* connect 的 _result 带较长的属性对象，超过 128 字节，考验客户端的 chunk 重组。 */
+        *p++ = RTMP_AMF0_OBJECT;
+        p = rtmp_amf_write_string(rtmp_amf_write_key(p, "fmsVer"), "FMS/3,5,7,7009");
+        p = rtmp_amf_write_number(rtmp_amf_write_key(p, "capabilities"), 31.0);
+        p = rtmp_amf_write_object_end(p);
+        *p++ = RTMP_AMF0_OBJECT;
+        p = rtmp_amf_write_string(rtmp_amf_write_key(p, "level"), "status");
+        p = rtmp_amf_write_string(rtmp_amf_write_key(p, "code"), "NetConnection.Connect.Success");
+        p = rtmp_amf_write_string(rtmp_amf_write_key(p, "description"), "Connection succeeded, stub server ready for publishing.");
+        p = rtmp_amf_write_number(rtmp_amf_write_key(p, "objectEncoding"), 0.0);
+        p = rtmp_amf_write_object_end(p);
+    }
+    return stub_send(fd, 3, RTMP_MSG_COMMAND_AMF0, stream_id, body, (size_t)(p - body));
+}
+
+static int check_sequence_header(const uint8_t *body, uint32_t len, uint8_t *scratch) {
+    const uint8_t *sps = scratch + 6 + 4;
+    const uint8_t *pps = sps + 20 + 4;
+    make_frame(scratch, 0);
+    if (len != 5 + 6 + 2 + 20 + 1 + 2 + 5) return 0;
+    if (body[0] != 0x17 || body[1] != 0 || body[5] != 1 || body[6] != sps[1] || body[10] != 0xE1) return 0;
+    if (body[11] != 0 || body[12] != 20 || memcmp(body + 13, sps, 20) != 0) return 0;
+    if (body[33] != 1 || body[35] != 5 || memcmp(body + 36, pps, 5) != 0) return 0;
+    return 1;
+}
+
+static int check_video(const uint8_t *body, uint32_t len, uint32_t ts, int index, uint8_t *scratch) {
+    int key = (index % TEST_GOP) == 0;
+    size_t frame_len = make_frame(scratch, index);
+    const uint8_t *nalu = scratch + frame_len - (key ? TEST_IDR_BYTES : TEST_P_BYTES);
+    size_t nalu_len = key ? TEST_IDR_BYTES : TEST_P_BYTES;
+    uint32_t expect_ts = (uint32_t)((uint64_t)index * 33333ULL / 1000ULL);
+    if (len != 5 + 4 + nalu_len || ts != expect_ts) return 0;
+    if (body[0] != (key ? 0x17 : 0x27) || body[1] != 1) return 0;
+    if (((uint32_t)body[5] << 24 | (uint32_t)body[6] << 16 | (uint32_t)body[7] << 8 | body[8]) != nalu_len) return 0;
+    return memcmp(body + 9, nalu, nalu_len) == 0;
+}
+
+static void *stub_main(void *arg) {
+    Stub *stub = (Stub *)arg;
+    StubStream streams[STUB_MAX_CSID];
+    uint8_t c0c1[1537];
+    uint8_t c2[1536];
+    uint8_t s0s1s2[1 + 1536 * 2];
+    uint8_t *scratch = (uint8_t *)malloc(TEST_IDR_BYTES + 1024);
+    int in_chunk = 128;
+    int video_index = -1;
+    struct timeval tv;
+    int fd;
+
+    memset(streams, 0, sizeof(streams));
+    fd = accept(stub->listen_fd, NULL, NULL);
+    if (fd < 0 || !scratch) goto out;
+    tv.tv_sec = 5;
+    tv.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (stub_read(fd, c0c1, sizeof(c0c1)) != 0 || c0c1[0] != 3) goto out;
+    s0s1s2[0] = 3;
+    memset(s0s1s2 + 1, 0x5A, 1536);
+    memcpy(s0s1s2 + 1 + 1536, c0c1 + 1, 1536);
+    if (stub_write(fd, s0s1s2, sizeof(s0s1s2)) != 0 || stub_read(fd, c2, sizeof(c2)) != 0) goto out;
+    if (memcmp(c2, s0s1s2 + 1, 1536) != 0) goto out;
+
+    while (!stub->stop) {
+        uint8_t type;
+        uint8_t *body;
+        uint32_t len;
+        uint32_t ts;
+        char name[64];
+        int off;
+        if (stub_recv_message(fd, streams, &in_chunk, &type, &body, &len, &ts) != 0) break;
+        stub->client_chunk_size = in_chunk;
+        if (type == RTMP_MSG_USER_CONTROL) {
+            if (len == 6 && body[1] == 7 && body[5] == 0x2A) stub->pong_ok = 1;
+            continue;
+        }
+        if (type == RTMP_MSG_DATA_AMF0) {
+            if (amf_string_at(body, len, name, sizeof(name)) > 0 && strcmp(name, "onMetaData") == 0 && video_index < 0) {
+                stub->metadata_ok = 1;
+            }
+            continue;
+        }
+        if (type == RTMP_MSG_VIDEO) {
+            if (video_index < 0) {
+                stub->sequence_header_ok = stub->metadata_ok && check_sequence_header(body, len, scratch);
+            } else if (check_video(body, len, ts, video_index, scratch)) {
+                stub->frames_ok++;
+            } else {
+                stub->frames_bad++;
+            }
+            video_index++;
+            continue;
+        }
+        if (type != RTMP_MSG_COMMAND_AMF0) continue;
+        off = amf_string_at(body, len, name, sizeof(name));
+        if (off < 0 || (size_t)off + 9 > len) continue;
+        if (strcmp(name, "connect") == 0) {
+            const uint8_t *p = body + off + 9 + 1;
+            /* 取 connect 对象里的第一个字段 app。 */
+            if (p[0] == 0 && p[1] == 3 && memcmp(p + 2, "app", 3) == 0) amf_string_at(p + 5, len, stub->app, sizeof(stub->app));
+            stub_reply(fd, "_result", amf_number_at(body + off), 0, 0, 0.0, NULL);
+        } else if (strcmp(name, "createStream") == 0) {
+            stub_reply(fd, "_result", amf_number_at(body + off), 0, 1, 1.0, NULL);
+        } else if (strcmp(name, "publish") == 0) {
+            uint8_t ping[6] = {0, 6, 0, 0, 0, 0x2A};
+            amf_string_at(body + off + 9 + 1, len - off - 10, stub->stream, sizeof(stub->stream));
+            stub_reply(fd, "onStatus", 0.0, 1, 0, 0.0, "NetStream.Publish.Start");
+            stub_send(fd, 2, RTMP_MSG_USER_CONTROL, 0, ping, sizeof(ping));
+            stub->published = 1;
+            if (stub->stall_after_publish) {
+                while (!stub->stop) usleep(10000);
+                break;
+            }
+        }
+    }
+out:
+    if (fd >= 0) close(fd);
+    free(scratch);
+    for (int i = 0; i < STUB_MAX_CSID; ++i) free(streams[i].body);
+    return NULL;
+}
+
+static int stub_listen(Stub *stub, int rcvbuf) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int one = 1;
+    memset(stub, 0, sizeof(*stub));
+    stub->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (stub->listen_fd < 0) return -1;
+    setsockopt(stub->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (rcvbuf > 0) setsockopt(stub->listen_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(stub->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(stub->listen_fd, 4) != 0 ||
+        getsockname(stub->listen_fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        close(stub->listen_fd);
+        return -1;
+    }
+    stub->port = ntohs(addr.sin_port);
+    return 0;
+}
+
+static int enqueue_frame(MediaSink *sink, uint8_t *frame, int index) {
+    MediaPacket packet;
+    MediaBuffer *buffer = NULL;
+    size_t len = make_frame(frame, index);
+    int ret;
+    if (media_buffer_create_copy(frame, len, &buffer) != 0) return -1;
+    media_packet_init(&packet);
+    packet.frame_type = MEDIA_FRAME_TYPE_VIDEO;
+    packet.codec = MEDIA_CODEC_H264;
+    packet.buffer = buffer;
+    packet.frame_id = (uint64_t)index;
+    packet.pts_us = (uint64_t)index * 33333ULL;
+    packet.is_key_frame = (index % TEST_GOP) == 0;
+    ret = media_sink_enqueue(sink, &packet);
+    media_buffer_release(buffer);
+    return ret;
+}
+
+static int closed_port() {
+    Stub stub;
+    int port;
+    if (stub_listen(&stub, 0) != 0) return -1;
+    port = stub.port;
+    close(stub.listen_fd);
+    return port;
+}
+
+int main() {
+    Stub healthy;
+    Stub stalled;
+    pthread_t healthy_thread;
+    pthread_t stalled_thread;
+    MediaSink sink;
+    RtmpSinkConfig config;
+    RtmpFanoutDestinationStats stats[3];
+    char urls[512];
+    uint8_t *frame = (uint8_t *)malloc(TEST_IDR_BYTES + 1024);
+    int refused_port = closed_port();
+    uint64_t packetized;
+    int keyframes = (TEST_FRAMES + TEST_GOP - 1) / TEST_GOP;
+    int ok_healthy;
+    int ok_stalled;
+    int ok_refused;
+    int ok_packetized;
+    int i;
+
+    if (!frame || refused_port < 0 || stub_listen(&healthy, 0) != 0 || stub_listen(&stalled, 4096) != 0) {
+        fprintf(stderr, "[ERROR] fanout test setup failed\n");
+        return -1;
+    }
+    stalled.stall_after_publish = 1;
+    pthread_create(&healthy_thread, NULL, stub_main, &healthy);
+    pthread_create(&stalled_thread, NULL, stub_main, &stalled);
+
+    snprintf(urls, sizeof(urls), "rtmp://127.0.0.1:%d/live/test_stream, rtmp://127.0.0.1:%d/live/test_stream,rtmp://127.0.0.1:%d/live/test_stream",
+             healthy.port,
+             stalled.port,
+             refused_port);
+    memset(&config, 0, sizeof(config));
+    config.name = "rtmp-fanout-test";
+    config.publish_url = urls;
+    config.queue_capacity = 64;
+    config.reconnect_interval_ms = TEST_RECONNECT_INTERVAL_MS;
+    config.max_reconnect_interval_ms = TEST_MAX_RECONNECT_INTERVAL_MS;
+    config.connect_timeout_ms = TEST_CONNECT_TIMEOUT_MS;
+    config.chunk_size = TEST_CHUNK_SIZE;
+    config.send_timeout_ms = TEST_SEND_TIMEOUT_MS;
+    config.video_width = 1920;
+    config.video_height = 1080;
+    config.video_fps = 30;
+    config.video_bitrate = 4000000;
+    if (rtmp_fanout_url_count(urls) != 3 || rtmp_fanout_sink_setup(&sink, &config) != 0 || media_sink_start(&sink) != 0) {
+        fprintf(stderr, "[ERROR] fanout sink start failed\n");
+        return -1;
+    }
+
+    for (i = 0; i < TEST_FRAMES; ++i) {
+        enqueue_frame(&sink, frame, i);
+        usleep(TEST_FRAME_INTERVAL_US);
+    }
+    usleep(500000);
+    for (i = 0; i < 3; ++i) {
+        rtmp_fanout_sink_get_destination_stats(&sink, i, &stats[i]);
+    }
+    packetized = rtmp_fanout_sink_packetized_frames(&sink);
+    media_sink_stop(&sink);
+    media_sink_deinit(&sink);
+    healthy.stop = 1;
+    stalled.stop = 1;
+    shutdown(healthy.listen_fd, SHUT_RDWR);
+    shutdown(stalled.listen_fd, SHUT_RDWR);
+    pthread_join(healthy_thread, NULL);
+    pthread_join(stalled_thread, NULL);
+    close(healthy.listen_fd);
+    close(stalled.listen_fd);
+
+    ok_packetized = packetized == TEST_FRAMES;
+    ok_healthy = healthy.sequence_header_ok && healthy.frames_ok == TEST_FRAMES && healthy.frames_bad == 0 &&
+                 stats[0].sent_frames == TEST_FRAMES && stats[0].dropped_frames == 0;
+    ok_stalled = stalled.published && stats[1].send_failures >= 1 && stats[1].sent_frames < TEST_FRAMES;
+    ok_refused = stats[2].sent_frames == 0 && stats[2].connect_failures >= 2 &&
+                 stats[2].connect_attempts < (uint64_t)keyframes && stats[2].backoff_ms > TEST_RECONNECT_INTERVAL_MS;
+    printf("[RTMP_FANOUT_TEST] packetized=%" PRIu64 " frames=%d result=%s\n", packetized, TEST_FRAMES, ok_packetized ? "PASS" : "FAIL");
+    printf("[RTMP_FANOUT_TEST] healthy sent=%" PRIu64 " dropped=%" PRIu64 " stub_ok=%d stub_bad=%d seq_header=%d result=%s\n",
+           stats[0].sent_frames,
+           stats[0].dropped_frames,
+           healthy.frames_ok,
+           healthy.frames_bad,
+           healthy.sequence_header_ok,
+           ok_healthy ? "PASS" : "FAIL");
+    printf("[RTMP_FANOUT_TEST] stalled sent=%" PRIu64 " dropped=%" PRIu64 " send_failures=%" PRIu64 " connect_attempts=%" PRIu64 " result=%s\n",
+           stats[1].sent_frames,
+           stats[1].dropped_frames,
+           stats[1].send_failures,
+           stats[1].connect_attempts,
+           ok_stalled ? "PASS" : "FAIL");
+    printf("[RTMP_FANOUT_TEST] refused connect_attempts=%" PRIu64 " keyframes=%d backoff_ms=%d result=%s\n",
+           stats[2].connect_attempts,
+           keyframes,
+           stats[2].backoff_ms,
+           ok_refused ? "PASS" : "FAIL");
+    free(frame);
+    if (!(ok_packetized && ok_healthy && ok_stalled && ok_refused)) {
+        fprintf(stderr, "[ERROR] rtmp fanout checks failed\n");
+        return -1;
+    }
+    return 0;
+}
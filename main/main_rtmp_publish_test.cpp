@@ -0,0 +1,565 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+#include "rtmpPublisher.h"
+#include "rtmpSink.h"
+}
+
+#define TEST_FRAMES 90
+#define TEST_GOP 30
+#define TEST_IDR_BYTES (120 * 1024)
+#define TEST_P_BYTES (20 * 1024)
+#define TEST_CHUNK_SIZE 4096
+#define TEST_SEND_TIMEOUT_MS 300
+#define TEST_CONNECT_TIMEOUT_MS 500
+#define TEST_STALL_MAX_FRAMES 400
+#define STUB_MAX_MESSAGE (512 * 1024)
+#define STUB_MAX_CSID 16
+
+/*
+ * 原生 RTMP 推流回环测试，本地起一个最小 RTMP 接收桩（握手、connect/createStream/publish 应答、chunk 重组）：
+ *   1. 通过 rtmp sink 推 90 帧合成 H264，接收桩逐字节比对 onMetaData 之后的 AVC sequence header 和每帧 NALU 负载、
+ *      时间戳，并验证客户端会回应 Ping；输出每条消息的 sendmsg 次数。
+ *   2. 接收桩 publish 之后停止读取，发送应在 send_timeout_ms 附近返回失败，而不是阻塞发送线程。
+ *   3. 服务端只 listen 不握手，connect 应在 connect_timeout_ms 附近失败。
+ *
+ * 用法：rtmp_publish_test
+ */
+
+typedef struct {
+    int listen_fd;
+    int port;
+    int stall_after_publish; /* 1: publish 之后不再读取。 */
+    volatile int stop;
+    int published;
+    int metadata_ok;
+    int sequence_header_ok;
+    int frames_ok;
+    int frames_bad;
+    int pong_ok;
+    int client_chunk_size;
+    char app[64];
+    char stream[64];
+} Stub;
+
+typedef struct {
+    uint32_t length;
+    uint32_t timestamp;
+    uint8_t type;
+    uint32_t received;
+    uint8_t *body;
+} StubStream;
+
+static long long now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+static size_t append_nalu(uint8_t *dst, uint8_t header, size_t len, uint32_t seed) {
+    size_t i;
+    dst[0] = 0;
+    dst[1] = 0;
+    dst[2] = 0;
+    dst[3] = 1;
+    dst[4] = header;
+    for (i = 1; i < len; ++i) {
+        seed = seed * 1103515245U + 12345U;
+        /* 负载不含 0x00，避免伪起始码。 */
+        dst[4 + i] = (uint8_t)(0x10 + ((seed >> 16) % 0xF0));
+    }
+    return 4 + len;
+}
+
+/* 帧内容只由帧号决定，接收桩据此重建期望负载。 */
+static size_t make_frame(uint8_t *dst, int index) {
+    size_t len = 0;
+    int key = (index % TEST_GOP) == 0;
+    len += append_nalu(dst + len, 0x09, 2, 1);
+    if (key) {
+        len += append_nalu(dst + len, 0x67, 20, 7);
+        len += append_nalu(dst + len, 0x68, 5, 8);
+        len += append_nalu(dst + len, 0x65, TEST_IDR_BYTES, (uint32_t)index);
+    } else {
+        len += append_nalu(dst + len, 0x41, TEST_P_BYTES, (uint32_t)index);
+    }
+    return len;
+}
+
+static int stub_read(int fd, uint8_t *buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = recv(fd, buf + got, len - got, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return -1;
+        }
+        got += (size_t)n;
+    }
+    return 0;
+}
+
+static int stub_write(int fd, const uint8_t *buf, size_t len) {
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = send(fd, buf + sent, len - sent, MSG_NOSIGNAL);
+        if (n <= 0) return -1;
+        sent += (size_t)n;
+    }
+    return 0;
+}
+
+/* 按默认 128 字节 chunk 发出一条消息，让客户端走 fmt 3 续传的重组路径。 */
+static int stub_send(int fd, int csid, uint8_t type, uint32_t stream_id, const uint8_t *body, size_t len) {
+    uint8_t out[4096];
+    size_t pos = 0;
+    size_t off = 0;
+    out[pos++] = (uint8_t)csid;
+    out[pos++] = 0;
+    out[pos++] = 0;
+    out[pos++] = 0;
+    out[pos++] = (uint8_t)(len >> 16);
+    out[pos++] = (uint8_t)(len >> 8);
+    out[pos++] = (uint8_t)len;
+    out[pos++] = type;
+    out[pos++] = (uint8_t)stream_id;
+    out[pos++] = (uint8_t)(stream_id >> 8);
+    out[pos++] = (uint8_t)(stream_id >> 16);
+    out[pos++] = (uint8_t)(stream_id >> 24);
+    while (off < len) {
+        size_t take = (len - off > 128) ? 128 : len - off;
+        if (off > 0) out[pos++] = (uint8_t)(0xC0 | csid);
+        memcpy(out + pos, body + off, take);
+        pos += take;
+        off += take;
+    }
+    return stub_write(fd, out, pos);
+}
+
+static int stub_recv_message(int fd, StubStream *streams, int *in_chunk, uint8_t *type, uint8_t **body, uint32_t *len, uint32_t *ts) {
+    for (;;) {
+        uint8_t b;
+        uint8_t h[11];
+        int fmt;
+        int csid;
+        StubStream *s;
+        uint32_t chunk;
+        if (stub_read(fd, &b, 1) != 0) return -1;
+        fmt = b >> 6;
+        csid = b & 0x3F;
+        if (csid < 2 || csid >= STUB_MAX_CSID) return -1;
+        s = &streams[csid];
+        if (fmt == 0) {
+            if (stub_read(fd, h, 11) != 0) return -1;
+            s->timestamp = ((uint32_t)h[0] << 16) | ((uint32_t)h[1] << 8) | h[2];
+            s->length = ((uint32_t)h[3] << 16) | ((uint32_t)h[4] << 8) | h[5];
+            s->type = h[6];
+            if (s->timestamp == 0xFFFFFF) {
+                if (stub_read(fd, h, 4) != 0) return -1;
+                s->timestamp = ((uint32_t)h[0] << 24) | ((uint32_t)h[1] << 16) | ((uint32_t)h[2] << 8) | h[3];
+            }
+            s->received = 0;
+        } else if (fmt != 3) {
+            /* 被测客户端只发 fmt 0 / fmt 3。 */
+            return -1;
+        }
+        if (s->length > STUB_MAX_MESSAGE) return -1;
+        if (!s->body) s->body = (uint8_t *)malloc(STUB_MAX_MESSAGE);
+        chunk = s->length - s->received;
+        if (chunk > (uint32_t)*in_chunk) chunk = (uint32_t)*in_chunk;
+        if (stub_read(fd, s->body + s->received, chunk) != 0) return -1;
+        s->received += chunk;
+        if (s->received < s->length) continue;
+        s->received = 0;
+        if (s->type == RTMP_MSG_SET_CHUNK_SIZE && s->length >= 4) {
+            *in_chunk = (int)(((uint32_t)s->body[0] << 24) | ((uint32_t)s->body[1] << 16) | ((uint32_t)s->body[2] << 8) | s->body[3]);
+            continue;
+        }
+        *type = s->type;
+        *body = s->body;
+        *len = s->length;
+        *ts = s->timestamp;
+        return 0;
+    }
+}
+
+static int amf_string_at(const uint8_t *p, size_t len, char *out, size_t out_size) {
+    size_t n;
+    if (len < 3 || p[0] != RTMP_AMF0_STRING) return -1;
+    n = ((size_t)p[1] << 8) | p[2];
+    if (n + 3 > len || n >= out_size) return -1;
+    memcpy(out, p + 3, n);
+    out[n] = '\0';
+    return (int)(n + 3);
+}
+
+static double amf_number_at(const uint8_t *p) {
+    uint64_t bits = 0;
+    double v;
+    int i;
+    for (i = 1; i <= 8; ++i) bits = (bits << 8) | p[i];
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static int stub_reply(int fd, const char *name, double txn, uint32_t stream_id, int with_number, double number, const char *code) {
+    uint8_t body[1024];
+    uint8_t *p = body;
+    p = rtmp_amf_write_string(p, name);
+    p = rtmp_amf_write_number(p, txn);
+    if (code) {
+        p = rtmp_amf_write_null(p);
+        *p++ = RTMP_AMF0_OBJECT;
+        p = rtmp_amf_write_string(rtmp_amf_write_key(p, "level"), "status");
+        p = rtmp_amf_write_string(rtmp_amf_write_key(p, "code"), code);
+        p = rtmp_amf_write_string(rtmp_amf_write_key(p, "description"), "publishing");
+        p = rtmp_amf_write_object_end(p);
+    } else if (with_number) {
+        p = rtmp_amf_write_null(p);
+        p = rtmp_amf_write_number(p, number);
+    } else {
+        /* connect 的 _result 带较长的属性对象，超过 128 字节，考验客户端的 chunk 重组。 */
+        *p++ = RTMP_AMF0_OBJECT;
+        p = rtmp_amf_write_string(rtmp_amf_write_key(p, "fmsVer"), "FMS/3,5,7,7009");
+        p = rtmp_amf_write_number(rtmp_amf_write_key(p, "capabilities"), 31.0);
+        p = rtmp_amf_write_object_end(p);
+        *p++ = RTMP_AMF0_OBJECT;
+        p = rtmp_amf_write_string(rtmp_amf_write_key(p, "level"), "status");
+        p = rtmp_amf_write_string(rtmp_amf_write_key(p, "code"), "NetConnection.Connect.Success");
+        p = rtmp_amf_write_string(rtmp_amf_write_key(p, "description"), "Connection succeeded, stub server ready for publishing.");
+        p = rtmp_amf_write_number(rtmp_amf_write_key(p, "objectEncoding"), 0.0);
+        p = rtmp_amf_write_object_end(p);
+    }
+    return stub_send(fd, 3, RTMP_MSG_COMMAND_AMF0, stream_id, body, (size_t)(p - body));
+}
+
+static int check_sequence_header(const uint8_t *body, uint32_t len, uint8_t *scratch) {
+    const uint8_t *sps = scratch + 6 + 4;
+    const uint8_t *pps = sps + 20 + 4;
+    make_frame(scratch, 0);
+    if (len != 5 + 6 + 2 + 20 + 1 + 2 + 5) return 0;
+    if (body[0] != 0x17 || body[1] != 0 || body[5] != 1 || body[6] != sps[1] || body[10] != 0xE1) return 0;
+    if (body[11] != 0 || body[12] != 20 || memcmp(body + 13, sps, 20) != 0) return 0;
+    if (body[33] != 1 || body[35] != 5 || memcmp(body + 36, pps, 5) != 0) return 0;
+    return 1;
+}
+
+static int check_video(const uint8_t *body, uint32_t len, uint32_t ts, int index, uint8_t *scratch) {
+    int key = (index % TEST_GOP) == 0;
+    size_t frame_len = make_frame(scratch, index);
+    const uint8_t *nalu = scratch + frame_len - (key ? TEST_IDR_BYTES : TEST_P_BYTES);
+    size_t nalu_len = key ? TEST_IDR_BYTES : TEST_P_BYTES;
+    uint32_t expect_ts = (uint32_t)((uint64_t)index * 33333ULL / 1000ULL);
+    if (len != 5 + 4 + nalu_len || ts != expect_ts) return 0;
+    if (body[0] != (key ? 0x17 : 0x27) || body[1] != 1) return 0;
+    if (((uint32_t)body[5] << 24 | (uint32_t)body[6] << 16 | (uint32_t)body[7] << 8 | body[8]) != nalu_len) return 0;
+    return memcmp(body + 9, nalu, nalu_len) == 0;
+}
+
+static void *stub_main(void *arg) {
+    Stub *stub = (Stub *)arg;
+    StubStream streams[STUB_MAX_CSID];
+    uint8_t c0c1[1537];
+    uint8_t c2[1536];
+    uint8_t s0s1s2[1 + 1536 * 2];
+    uint8_t *scratch = (uint8_t *)malloc(TEST_IDR_BYTES + 1024);
+    int in_chunk = 128;
+    int video_index = -1;
+    struct timeval tv;
+    int fd;
+
+    memset(streams, 0, sizeof(streams));
+    fd = accept(stub->listen_fd, NULL, NULL);
+    if (fd < 0 || !scratch) goto out;
+    tv.tv_sec = 5;
+    tv.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (stub_read(fd, c0c1, sizeof(c0c1)) != 0 || c0c1[0] != 3) goto out;
+    s0s1s2[0] = 3;
+    memset(s0s1s2 + 1, 0x5A, 1536);
+    memcpy(s0s1s2 + 1 + 1536, c0c1 + 1, 1536);
+    if (stub_write(fd, s0s1s2, sizeof(s0s1s2)) != 0 || stub_read(fd, c2, sizeof(c2)) != 0) goto out;
+    if (memcmp(c2, s0s1s2 + 1, 1536) != 0) goto out;
+
+    while (!stub->stop) {
+        uint8_t type;
+        uint8_t *body;
+        uint32_t len;
+        uint32_t ts;
+        char name[64];
+        int off;
+        if (stub_recv_message(fd, streams, &in_chunk, &type, &body, &len, &ts) != 0) break;
+        stub->client_chunk_size = in_chunk;
+        if (type == RTMP_MSG_USER_CONTROL) {
+            if (len == 6 && body[1] == 7 && body[5] == 0x2A) stub->pong_ok = 1;
+            continue;
+        }
+        if (type == RTMP_MSG_DATA_AMF0) {
+            if (amf_string_at(body, len, name, sizeof(name)) > 0 && strcmp(name, "onMetaData") == 0 && video_index < 0) {
+                stub->metadata_ok = 1;
+            }
+            continue;
+        }
+        if (type == RTMP_MSG_VIDEO) {
+            if (video_index < 0) {
+                stub->sequence_header_ok = stub->metadata_ok && check_sequence_header(body, len, scratch);
+            } else if (check_video(body, len, ts, video_index, scratch)) {
+                stub->frames_ok++;
+            } else {
+                stub->frames_bad++;
+            }
+            video_index++;
+            continue;
+        }
+        if (type != RTMP_MSG_COMMAND_AMF0) continue;
+        off = amf_string_at(body, len, name, sizeof(name));
+        if (off < 0 || (size_t)off + 9 > len) continue;
+        if (strcmp(name, "connect") == 0) {
+            const uint8_t *p = body + off + 9 + 1;
+            /* 取 connect 对象里的第一个字段 app。 */
+            if (p[0] == 0 && p[1] == 3 && memcmp(p + 2, "app", 3) == 0) amf_string_at(p + 5, len, stub->app, sizeof(stub->app));
+            stub_reply(fd, "_result", amf_number_at(body + off), 0, 0, 0.0, NULL);
+        } else if (strcmp(name, "createStream") == 0) {
+            stub_reply(fd, "_result", amf_number_at(body + off), 0, 1, 1.0, NULL);
+        } else if (strcmp(name, "publish") == 0) {
+            uint8_t ping[6] = {0, 6, 0, 0, 0, 0x2A};
+            amf_string_at(body + off + 9 + 1, len - off - 10, stub->stream, sizeof(stub->stream));
+            stub_reply(fd, "onStatus", 0.0, 1, 0, 0.0, "NetStream.Publish.Start");
+            stub_send(fd, 2, RTMP_MSG_USER_CONTROL, 0, ping, sizeof(ping));
+            stub->published = 1;
+            if (stub->stall_after_publish) {
+                while (!stub->stop) usleep(10000);
+                break;
+            }
+        }
+    }
+out:
+    if (fd >= 0) close(fd);
+    free(scratch);
+    for (int i = 0; i < STUB_MAX_CSID; ++i) free(streams[i].body);
+    return NULL;
+}
+
+static int stub_listen(Stub *stub, int rcvbuf) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int one = 1;
+    memset(stub, 0, sizeof(*stub));
+    stub->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (stub->listen_fd < 0) return -1;
+    setsockopt(stub->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (rcvbuf > 0) setsockopt(stub->listen_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(stub->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(stub->listen_fd, 4) != 0 ||
+        getsockname(stub->listen_fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        close(stub->listen_fd);
+        return -1;
+    }
+    stub->port = ntohs(addr.sin_port);
+    return 0;
+}
+
+static int send_frame(MediaSink *sink, uint8_t *frame, int index) {
+    MediaPacket packet;
+    MediaBuffer *buffer = NULL;
+    size_t len = make_frame(frame, index);
+    int ret;
+    if (media_buffer_create_copy(frame, len, &buffer) != 0) return -1;
+    media_packet_init(&packet);
+    packet.frame_type = MEDIA_FRAME_TYPE_VIDEO;
+    packet.codec = MEDIA_CODEC_H264;
+    packet.buffer = buffer;
+    packet.frame_id = (uint64_t)index;
+    packet.pts_us = (uint64_t)index * 33333ULL;
+    packet.is_key_frame = (index % TEST_GOP) == 0;
+    ret = sink->vtable->send_packet(sink, &packet);
+    media_buffer_release(buffer);
+    return ret;
+}
+
+static void fill_sink_config(RtmpSinkConfig *config, char *url, size_t url_size, int port) {
+    snprintf(url, url_size, "rtmp://127.0.0.1:%d/live/test_stream", port);
+    memset(config, 0, sizeof(*config));
+    config->name = "rtmp-test";
+    config->publish_url = url;
+    config->connect_timeout_ms = TEST_CONNECT_TIMEOUT_MS;
+    config->chunk_size = TEST_CHUNK_SIZE;
+    config->send_timeout_ms = TEST_SEND_TIMEOUT_MS;
+    config->video_width = 1920;
+    config->video_height = 1080;
+    config->video_fps = 30;
+    config->video_bitrate = 4000000;
+}
+
+static int check_url_parse() {
+    RtmpPublisher pub;
+    int failures = 0;
+    rtmp_publisher_init(&pub, 0, 0);
+    if (rtmp_publisher_parse_url(&pub, "rtmp://10.0.0.2/live/cam?key=1") != 0 || strcmp(pub.host, "10.0.0.2") != 0 ||
+        pub.port != 1935 || strcmp(pub.app, "live") != 0 || strcmp(pub.stream, "cam?key=1") != 0) {
+        failures++;
+    }
+    if (rtmp_publisher_parse_url(&pub, "rtmp://host:19350/app/inst/name") != 0 || pub.port != 19350 ||
+        strcmp(pub.app, "app/inst") != 0 || strcmp(pub.stream, "name") != 0 ||
+        strcmp(pub.tc_url, "rtmp://host:19350/app/inst") != 0) {
+        failures++;
+    }
+    if (rtmp_publisher_parse_url(&pub, "rtmp://host/onlyapp") == 0 || rtmp_publisher_parse_url(&pub, "http://host/a/b") == 0) failures++;
+    rtmp_publisher_deinit(&pub);
+    printf("[RTMP_TEST] url_parse failures=%d\n", failures);
+    return failures;
+}
+
+static int run_publish() {
+    Stub stub;
+    pthread_t thread;
+    MediaSink sink;
+    RtmpSinkConfig config;
+    char url[128];
+    uint8_t *frame = (uint8_t *)malloc(TEST_IDR_BYTES + 1024);
+    int send_failures = 0;
+    int ok;
+    int i;
+
+    if (!frame || stub_listen(&stub, 0) != 0) return -1;
+    pthread_create(&thread, NULL, stub_main, &stub);
+    fill_sink_config(&config, url, sizeof(url), stub.port);
+    if (rtmp_sink_setup(&sink, &config) != 0 || sink.vtable->start(&sink) != 0 || sink.vtable->connect(&sink) != 0) {
+        fprintf(stderr, "[ERROR] publish connect failed\n");
+        stub.stop = 1;
+        close(stub.listen_fd);
+        pthread_join(thread, NULL);
+        free(frame);
+        return -1;
+    }
+    for (i = 0; i < TEST_FRAMES; ++i) {
+        if (send_frame(&sink, frame, i) != 0) send_failures++;
+    }
+    /* 最后再发一帧，确保客户端在发送前处理过接收桩的 Ping。 */
+    usleep(50000);
+    if (send_frame(&sink, frame, TEST_FRAMES) != 0) send_failures++;
+    usleep(200000);
+    sink.vtable->disconnect(&sink);
+    stub.stop = 1;
+    pthread_join(thread, NULL);
+    close(stub.listen_fd);
+
+    /* 发送统计由 disconnect 日志输出，这里用接收桩的结果判断正确性。 */
+    ok = stub.published && stub.metadata_ok && stub.sequence_header_ok && stub.frames_ok == TEST_FRAMES + 1 &&
+         stub.frames_bad == 0 && stub.pong_ok && stub.client_chunk_size == TEST_CHUNK_SIZE && send_failures == 0 &&
+         strcmp(stub.app, "live") == 0 && strcmp(stub.stream, "test_stream") == 0;
+    printf("[RTMP_TEST] publish frames_ok=%d frames_bad=%d metadata=%d seq_header=%d pong=%d chunk_size=%d send_failures=%d result=%s\n",
+           stub.frames_ok,
+           stub.frames_bad,
+           stub.metadata_ok,
+           stub.sequence_header_ok,
+           stub.pong_ok,
+           stub.client_chunk_size,
+           send_failures,
+           ok ? "PASS" : "FAIL");
+    sink.vtable->stop(&sink);
+    media_sink_deinit(&sink);
+    free(frame);
+    return ok ? 0 : -1;
+}
+
+static int run_stall() {
+    Stub stub;
+    pthread_t thread;
+    MediaSink sink;
+    RtmpSinkConfig config;
+    char url[128];
+    uint8_t *frame = (uint8_t *)malloc(TEST_IDR_BYTES + 1024);
+    long long fail_call_ms = -1;
+    int frames = 0;
+    int ok;
+    int i;
+
+    if (!frame || stub_listen(&stub, 4096) != 0) return -1;
+    stub.stall_after_publish = 1;
+    pthread_create(&thread, NULL, stub_main, &stub);
+    fill_sink_config(&config, url, sizeof(url), stub.port);
+    if (rtmp_sink_setup(&sink, &config) != 0 || sink.vtable->start(&sink) != 0 || sink.vtable->connect(&sink) != 0) {
+        fprintf(stderr, "[ERROR] stall connect failed\n");
+        stub.stop = 1;
+        pthread_join(thread, NULL);
+        close(stub.listen_fd);
+        free(frame);
+        return -1;
+    }
+    /* 全部用关键帧尽快写满两端缓冲。 */
+    for (i = 0; i < TEST_STALL_MAX_FRAMES; ++i) {
+        long long t0 = now_ms();
+        if (send_frame(&sink, frame, (i % 2) * TEST_GOP) != 0) {
+            fail_call_ms = now_ms() - t0;
+            break;
+        }
+        frames++;
+    }
+    sink.vtable->disconnect(&sink);
+    stub.stop = 1;
+    pthread_join(thread, NULL);
+    close(stub.listen_fd);
+    ok = fail_call_ms >= TEST_SEND_TIMEOUT_MS - 50 && fail_call_ms <= TEST_SEND_TIMEOUT_MS + 500;
+    printf("[RTMP_TEST] stall frames_before_block=%d blocked_call_ms=%lld send_timeout_ms=%d result=%s\n",
+           frames,
+           fail_call_ms,
+           TEST_SEND_TIMEOUT_MS,
+           ok ? "PASS" : "FAIL");
+    sink.vtable->stop(&sink);
+    media_sink_deinit(&sink);
+    free(frame);
+    return ok ? 0 : -1;
+}
+
+static int run_connect_timeout() {
+    Stub stub;
+    RtmpPublisher pub;
+    char url[128];
+    long long t0;
+    long long elapsed;
+    int ret;
+    int ok;
+
+    if (stub_listen(&stub, 0) != 0) return -1;
+    snprintf(url, sizeof(url), "rtmp://127.0.0.1:%d/live/none", stub.port);
+    rtmp_publisher_init(&pub, TEST_CHUNK_SIZE, TEST_SEND_TIMEOUT_MS);
+    t0 = now_ms();
+    ret = rtmp_publisher_connect(&pub, url, TEST_CONNECT_TIMEOUT_MS);
+    elapsed = now_ms() - t0;
+    rtmp_publisher_deinit(&pub);
+    close(stub.listen_fd);
+    ok = ret != 0 && elapsed >= TEST_CONNECT_TIMEOUT_MS - 50 && elapsed <= TEST_CONNECT_TIMEOUT_MS + 500;
+    printf("[RTMP_TEST] connect_timeout ret=%d elapsed_ms=%lld timeout_ms=%d result=%s\n",
+           ret,
+           elapsed,
+           TEST_CONNECT_TIMEOUT_MS,
+           ok ? "PASS" : "FAIL");
+    return ok ? 0 : -1;
+}
+
+int main() {
+    int failures = 0;
+    if (check_url_parse() != 0) failures++;
+    if (run_publish() != 0) failures++;
+    if (run_stall() != 0) failures++;
+    if (run_connect_timeout() != 0) failures++;
+    if (failures > 0) {
+        fprintf(stderr, "[ERROR] %d rtmp publish checks failed\n", failures);
+        return -1;
+    }
+    return 0;
+}
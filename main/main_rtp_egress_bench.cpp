@@ -0,0 +1,410 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+#include "mediaRtpEgress.h"
+#include "mediaRtpPacer.h"
+}
+
+#define BENCH_FRAMES 300
+#define BENCH_FRAME_BYTES (100 * 1024)
+#define BENCH_RTP_MAX_PAYLOAD 1400
+#define BENCH_RCVBUF (4 * 1024 * 1024)
+#define PACING_FRAMES 60
+#define PACING_GOP 30
+#define PACING_FPS 30
+#define PACING_BITRATE (4 * 1000 * 1000)
+#define PACING_IDR_BYTES (100 * 1024)
+#define PACING_P_BYTES (10 * 1024)
+/* 接收端时间戳间隔小于该值的相邻包视为同一突发。 */
+#define PACING_BURST_GAP_US 50
+#define FANOUT_TARGETS 4
+
+/*
+ * RTP 批量发送基准，走 127.0.0.1 回环：
+ *   同一组 100KB 帧分别用逐包 sendto、sendmmsg、sendmmsg+UDP GSO 发送，
+ *   每帧发完立即在接收端收齐并校验包数、长度和 RTP 序号连续，
+ *   输出每帧系统调用次数和发送耗费的线程 CPU 时间。内核不支持 GSO 时第三组自动退回 sendmmsg。
+ * 随后按 30fps 实时节奏发送 100KB I 帧 + 10KB P 帧，分别关闭/开启令牌桶平滑，
+ *   接收端用 SO_TIMESTAMPNS 记录每包到达时间，统计 I 帧到达跨度、包间隔和最大突发包数。
+ * 最后把同一个 100KB I 帧扇出到 4 个开启平滑的发送器，用分组 flush 在同一窗口内交错发出，
+ *   整帧发完的耗时应接近一个平滑窗口，而不是 4 个窗口之和。
+ */
+
+typedef struct {
+    const char *name;
+    uint64_t syscalls;
+    uint64_t cpu_us;
+    uint64_t packets;
+} ModeResult;
+
+static uint64_t thread_cpu_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static void build_header(uint8_t *header, uint16_t seq, int marker) {
+    memset(header, 0, 12);
+    header[0] = 0x80;
+    header[1] = (uint8_t)((marker ? 0x80 : 0x00) | 96);
+    header[2] = (uint8_t)(seq >> 8);
+    header[3] = (uint8_t)seq;
+}
+
+/* 收齐一帧，校验序号连续和 marker 位置。 */
+static int receive_frame(int rx_fd, uint16_t first_seq, int expect_packets, size_t last_payload) {
+    uint8_t buf[2048];
+    int i;
+    for (i = 0; i < expect_packets; ++i) {
+        ssize_t n = recv(rx_fd, buf, sizeof(buf), 0);
+        size_t expect_len = 12 + ((i == expect_packets - 1) ? last_payload : BENCH_RTP_MAX_PAYLOAD);
+        uint16_t seq;
+        if (n < 0) {
+            fprintf(stderr, "[ERROR] recv packet %d/%d failed errno=%d(%s)\n", i, expect_packets, errno, strerror(errno));
+            return -1;
+        }
+        seq = (uint16_t)((buf[2] << 8) | buf[3]);
+        if ((size_t)n != expect_len || seq != (uint16_t)(first_seq + i) ||
+            ((buf[1] & 0x80) != 0) != (i == expect_packets - 1)) {
+            fprintf(stderr, "[ERROR] packet %d len=%zd seq=%u expect_len=%zu expect_seq=%u\n",
+                    i, n, seq, expect_len, (unsigned int)(uint16_t)(first_seq + i));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static uint64_t monotonic_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+typedef struct {
+    const char *name;
+    uint64_t idr_span_us_sum;
+    uint64_t idr_span_us_max;
+    uint64_t idr_frames;
+    uint64_t idr_gap_us_max;
+    int max_burst;
+    uint64_t delay_us_max;
+    int queue_max;
+} PacingResult;
+
+/* 收齐一帧并取内核到达时间戳，返回到达跨度，同时更新最大包间隔和突发包数。 */
+static int receive_frame_timed(int rx_fd, int expect_packets, uint64_t *span_us, uint64_t *gap_us_max, int *max_burst) {
+    uint8_t buf[2048];
+    char control[CMSG_SPACE(sizeof(struct timespec))];
+    uint64_t first_ns = 0;
+    uint64_t prev_ns = 0;
+    int burst = 1;
+    int i;
+
+    for (i = 0; i < expect_packets; ++i) {
+        struct iovec iov;
+        struct msghdr msg;
+        struct cmsghdr *cmsg;
+        uint64_t ts_ns = 0;
+        iov.iov_base = buf;
+        iov.iov_len = sizeof(buf);
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(rx_fd, &msg, 0) < 0) {
+            fprintf(stderr, "[ERROR] recv timed packet %d/%d failed errno=%d(%s)\n", i, expect_packets, errno, strerror(errno));
+            return -1;
+        }
+        for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                ts_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+            }
+        }
+        if (i == 0) {
+            first_ns = ts_ns;
+        } else {
+            uint64_t gap_us = (ts_ns - prev_ns) / 1000ULL;
+            if (gap_us_max && gap_us > *gap_us_max) *gap_us_max = gap_us;
+            burst = (gap_us < PACING_BURST_GAP_US) ? burst + 1 : 1;
+            if (max_burst && burst > *max_burst) *max_burst = burst;
+        }
+        prev_ns = ts_ns;
+    }
+    if (span_us) *span_us = (prev_ns - first_ns) / 1000ULL;
+    return 0;
+}
+
+static int run_pacing_mode(int paced, int tx_fd, int rx_fd, const struct sockaddr_in *dst, const uint8_t *frame, PacingResult *result) {
+    MediaRtpEgress *egress = (MediaRtpEgress *)malloc(sizeof(MediaRtpEgress));
+    MediaRtpPacerConfig pacing;
+    uint64_t frame_interval_us = 1000000ULL / PACING_FPS;
+    uint64_t next_frame_us;
+    uint16_t seq = 0;
+    int f;
+
+    if (!egress) return -1;
+    memset(&pacing, 0, sizeof(pacing));
+    pacing.enabled = paced;
+    media_rtp_pacer_fill_default(&pacing);
+    media_rtp_egress_init(egress, 0);
+    media_rtp_egress_set_pacing(egress, &pacing, PACING_BITRATE, PACING_FPS);
+    if (media_rtp_egress_set_target(egress, tx_fd, "127.0.0.1", ntohs(dst->sin_port)) != 0) {
+        free(egress);
+        return -1;
+    }
+    next_frame_us = monotonic_us();
+    for (f = 0; f < PACING_FRAMES; ++f) {
+        int is_idr = (f % PACING_GOP) == 0;
+        size_t frame_bytes = is_idr ? PACING_IDR_BYTES : PACING_P_BYTES;
+        int packets = (int)((frame_bytes + BENCH_RTP_MAX_PAYLOAD - 1) / BENCH_RTP_MAX_PAYLOAD);
+        size_t last_payload = frame_bytes - (size_t)(packets - 1) * BENCH_RTP_MAX_PAYLOAD;
+        uint64_t span_us = 0;
+        uint64_t now_us;
+        int p;
+
+        media_rtp_egress_begin_frame(egress, frame_bytes);
+        for (p = 0; p < packets; ++p) {
+            uint8_t header[12];
+            struct iovec payload;
+            int marker = (p == packets - 1);
+            payload.iov_base = (void *)(frame + (size_t)p * BENCH_RTP_MAX_PAYLOAD);
+            payload.iov_len = marker ? last_payload : BENCH_RTP_MAX_PAYLOAD;
+            build_header(header, seq++, marker);
+            if (media_rtp_egress_queue(egress, header, sizeof(header), &payload, 1) != 0) {
+                free(egress);
+                return -1;
+            }
+        }
+        if (media_rtp_egress_end_frame(egress) != 0 ||
+            receive_frame_timed(rx_fd, packets, &span_us,
+                                is_idr ? &result->idr_gap_us_max : NULL,
+                                &result->max_burst) != 0) {
+            fprintf(stderr, "[ERROR] pacing mode=%s frame %d failed\n", result->name, f);
+            free(egress);
+            return -1;
+        }
+        if (is_idr) {
+            result->idr_frames++;
+            result->idr_span_us_sum += span_us;
+            if (span_us > result->idr_span_us_max) result->idr_span_us_max = span_us;
+        }
+        /* 按帧率节奏发下一帧，令牌桶在帧间隙里回填。 */
+        next_frame_us += frame_interval_us;
+        now_us = monotonic_us();
+        if (next_frame_us > now_us) usleep((useconds_t)(next_frame_us - now_us));
+    }
+    result->delay_us_max = egress->pacer.delay_us_max;
+    result->queue_max = egress->pacer.occupancy_max;
+    free(egress);
+    return 0;
+}
+
+/* 一个 I 帧扇出到多个平滑发送器，返回从开始排队到全部发完的耗时。 */
+static int run_pacing_fanout(int tx_fd, int rx_fd, const struct sockaddr_in *dst, const uint8_t *frame, uint64_t *elapsed_us) {
+    MediaRtpEgress *egresses[FANOUT_TARGETS];
+    MediaRtpPacerConfig pacing;
+    int packets = (PACING_IDR_BYTES + BENCH_RTP_MAX_PAYLOAD - 1) / BENCH_RTP_MAX_PAYLOAD;
+    size_t last_payload = PACING_IDR_BYTES - (size_t)(packets - 1) * BENCH_RTP_MAX_PAYLOAD;
+    uint64_t start_us;
+    int ret = 0;
+    int p;
+    int t;
+
+    memset(&pacing, 0, sizeof(pacing));
+    pacing.enabled = 1;
+    media_rtp_pacer_fill_default(&pacing);
+    for (t = 0; t < FANOUT_TARGETS; ++t) {
+        egresses[t] = (MediaRtpEgress *)malloc(sizeof(MediaRtpEgress));
+        if (!egresses[t]) return -1;
+        media_rtp_egress_init(egresses[t], 0);
+        media_rtp_egress_set_pacing(egresses[t], &pacing, PACING_BITRATE, PACING_FPS);
+        media_rtp_egress_set_target(egresses[t], tx_fd, "127.0.0.1", ntohs(dst->sin_port));
+        media_rtp_egress_begin_frame(egresses[t], PACING_IDR_BYTES);
+    }
+    start_us = monotonic_us();
+    for (p = 0; p < packets && ret == 0; ++p) {
+        uint8_t header[12];
+        struct iovec payload;
+        int marker = (p == packets - 1);
+        /* 与 GB28181 扇出一致：各发送器批次同时排满时一起交错发出。 */
+        if (egresses[0]->count >= MEDIA_RTP_EGRESS_MAX_BATCH) ret = media_rtp_egress_flush_group(egresses, FANOUT_TARGETS, NULL);
+        payload.iov_base = (void *)(frame + (size_t)p * BENCH_RTP_MAX_PAYLOAD);
+        payload.iov_len = marker ? last_payload : BENCH_RTP_MAX_PAYLOAD;
+        build_header(header, (uint16_t)p, marker);
+        for (t = 0; t < FANOUT_TARGETS && ret == 0; ++t) ret = media_rtp_egress_queue(egresses[t], header, sizeof(header), &payload, 1);
+    }
+    if (ret == 0) ret = media_rtp_egress_flush_group(egresses, FANOUT_TARGETS, NULL);
+    *elapsed_us = monotonic_us() - start_us;
+    if (ret == 0) ret = receive_frame_timed(rx_fd, packets * FANOUT_TARGETS, NULL, NULL, NULL);
+    for (t = 0; t < FANOUT_TARGETS; ++t) free(egresses[t]);
+    return ret;
+}
+
+static int run_mode(int mode, int tx_fd, int rx_fd, const struct sockaddr_in *dst, const uint8_t *frame, ModeResult *result) {
+    MediaRtpEgress *egress = (MediaRtpEgress *)malloc(sizeof(MediaRtpEgress));
+    int packets_per_frame = (BENCH_FRAME_BYTES + BENCH_RTP_MAX_PAYLOAD - 1) / BENCH_RTP_MAX_PAYLOAD;
+    size_t last_payload = BENCH_FRAME_BYTES - (size_t)(packets_per_frame - 1) * BENCH_RTP_MAX_PAYLOAD;
+    uint16_t seq = 0;
+    int f;
+
+    if (!egress) return -1;
+    media_rtp_egress_init(egress, (mode == 2) ? 1 : 0);
+    if (media_rtp_egress_set_target(egress, tx_fd, "127.0.0.1", ntohs(dst->sin_port)) != 0) {
+        free(egress);
+        return -1;
+    }
+    for (f = 0; f < BENCH_FRAMES; ++f) {
+        uint16_t first_seq = seq;
+        uint64_t cpu_start = thread_cpu_us();
+        int p;
+        for (p = 0; p < packets_per_frame; ++p) {
+            uint8_t header[12];
+            struct iovec payload;
+            int marker = (p == packets_per_frame - 1);
+            payload.iov_base = (void *)(frame + (size_t)p * BENCH_RTP_MAX_PAYLOAD);
+            payload.iov_len = marker ? last_payload : BENCH_RTP_MAX_PAYLOAD;
+            build_header(header, seq++, marker);
+            if (mode == 0) {
+                uint8_t packet[12 + BENCH_RTP_MAX_PAYLOAD];
+                memcpy(packet, header, 12);
+                memcpy(packet + 12, payload.iov_base, payload.iov_len);
+                if (sendto(tx_fd, packet, 12 + payload.iov_len, 0, (const struct sockaddr *)dst, sizeof(*dst)) < 0) {
+                    free(egress);
+                    return -1;
+                }
+                result->syscalls++;
+            } else if (media_rtp_egress_queue(egress, header, sizeof(header), &payload, 1) != 0) {
+                free(egress);
+                return -1;
+            }
+        }
+        if (mode != 0 && media_rtp_egress_end_frame(egress) != 0) {
+            free(egress);
+            return -1;
+        }
+        result->cpu_us += thread_cpu_us() - cpu_start;
+        result->packets += (uint64_t)packets_per_frame;
+        if (receive_frame(rx_fd, first_seq, packets_per_frame, last_payload) != 0) {
+            fprintf(stderr, "[ERROR] mode=%s frame %d verification failed\n", result->name, f);
+            free(egress);
+            return -1;
+        }
+    }
+    if (mode != 0) result->syscalls = egress->syscalls;
+    if (mode == 2 && egress->gso_supported != 1) result->name = "gso(fallback)";
+    free(egress);
+    return 0;
+}
+
+int main() {
+    ModeResult results[3] = {{"sendto", 0, 0, 0}, {"sendmmsg", 0, 0, 0}, {"gso", 0, 0, 0}};
+    struct sockaddr_in rx_addr;
+    socklen_t addr_len = sizeof(rx_addr);
+    struct timeval timeout;
+    uint8_t *frame = (uint8_t *)malloc(BENCH_FRAME_BYTES);
+    int rcvbuf = BENCH_RCVBUF;
+    int tx_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int rx_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int ret = 0;
+    int i;
+
+    if (!frame || tx_fd < 0 || rx_fd < 0) return -1;
+    for (i = 0; i < BENCH_FRAME_BYTES; ++i) frame[i] = (uint8_t)(i * 7);
+    memset(&rx_addr, 0, sizeof(rx_addr));
+    rx_addr.sin_family = AF_INET;
+    rx_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    setsockopt(rx_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    timeout.tv_sec = 1;
+    timeout.tv_usec = 0;
+    setsockopt(rx_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (bind(rx_fd, (const struct sockaddr *)&rx_addr, sizeof(rx_addr)) != 0 ||
+        getsockname(rx_fd, (struct sockaddr *)&rx_addr, &addr_len) != 0) {
+        fprintf(stderr, "[ERROR] bind loopback receiver failed errno=%d(%s)\n", errno, strerror(errno));
+        return -1;
+    }
+
+    for (i = 0; i < 3; ++i) {
+        if (run_mode(i, tx_fd, rx_fd, &rx_addr, frame, &results[i]) != 0) {
+            fprintf(stderr, "[ERROR] mode=%s failed\n", results[i].name);
+            ret = -1;
+            continue;
+        }
+        printf("[EGRESS_BENCH] mode=%s frames=%d packets=%" PRIu64 " syscalls_per_frame=%.2f send_cpu_us_per_frame=%.1f\n",
+               results[i].name,
+               BENCH_FRAMES,
+               results[i].packets,
+               (double)results[i].syscalls / BENCH_FRAMES,
+               (double)results[i].cpu_us / BENCH_FRAMES);
+    }
+    if (ret == 0 && results[1].syscalls >= results[0].syscalls) {
+        fprintf(stderr, "[ERROR] sendmmsg did not reduce syscalls\n");
+        ret = -1;
+    }
+
+    {
+        PacingResult pacing_results[2];
+        int on = 1;
+        memset(pacing_results, 0, sizeof(pacing_results));
+        pacing_results[0].name = "burst";
+        pacing_results[1].name = "paced";
+        setsockopt(rx_fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+        for (i = 0; i < 2; ++i) {
+            PacingResult *r = &pacing_results[i];
+            if (run_pacing_mode(i, tx_fd, rx_fd, &rx_addr, frame, r) != 0) {
+                ret = -1;
+                continue;
+            }
+            printf("[PACING_BENCH] mode=%s idr_frames=%" PRIu64 " idr_span_us_avg=%.1f idr_span_us_max=%" PRIu64
+                   " idr_gap_us_max=%" PRIu64 " max_burst_packets=%d pacing_delay_us_max=%" PRIu64 " queue_max=%d\n",
+                   r->name,
+                   r->idr_frames,
+                   r->idr_frames ? (double)r->idr_span_us_sum / (double)r->idr_frames : 0.0,
+                   r->idr_span_us_max,
+                   r->idr_gap_us_max,
+                   r->max_burst,
+                   r->delay_us_max,
+                   r->queue_max);
+        }
+        /* 平滑后 I 帧应摊开到毫秒级，且明显长于不平滑时的突发。 */
+        if (ret == 0 && (pacing_results[1].idr_span_us_sum < 5000ULL * pacing_results[1].idr_frames ||
+                         pacing_results[1].idr_span_us_sum < 4ULL * pacing_results[0].idr_span_us_sum ||
+                         pacing_results[1].max_burst >= pacing_results[0].max_burst)) {
+            fprintf(stderr, "[ERROR] pacing did not spread I-frame bursts\n");
+            ret = -1;
+        }
+    }
+
+    {
+        /* 单个 I 帧的平滑窗口：帧间隔 × spread_percent（默认 50%）。 */
+        uint64_t window_us = 1000000ULL / PACING_FPS / 2;
+        uint64_t elapsed_us = 0;
+        if (run_pacing_fanout(tx_fd, rx_fd, &rx_addr, frame, &elapsed_us) != 0) {
+            fprintf(stderr, "[ERROR] pacing fanout failed\n");
+            ret = -1;
+        } else {
+            printf("[PACING_BENCH] mode=fanout targets=%d idr_bytes=%d elapsed_us=%" PRIu64 " window_us=%" PRIu64 "\n",
+                   FANOUT_TARGETS, PACING_IDR_BYTES, elapsed_us, window_us);
+            if (elapsed_us >= 2ULL * window_us) {
+                fprintf(stderr, "[ERROR] fanout pacing took more than one spread window\n");
+                ret = -1;
+            }
+        }
+    }
+
+    close(tx_fd);
+    close(rx_fd);
+    free(frame);
+    return ret;
+}
@@ -0,0 +1,303 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+extern "C" {
+#include "mediaRtpEgress.h"
+#include "mediaRtpHistory.h"
+}
+
+#define TEST_FRAMES 60
+#define TEST_GOP 30
+#define TEST_IDR_BYTES (100 * 1024)
+#define TEST_P_BYTES (10 * 1024)
+#define TEST_RTP_MAX_PAYLOAD 1400
+#define TEST_SSRC 0x12345678U
+#define TEST_ARENA_BYTES (256 * 1024)
+#define TEST_HISTORY_ENTRIES 1024
+/* 接收端按序号确定性丢包：每 17 个包丢 1 个，只丢首次到达。 */
+#define TEST_DROP_MODULO 17
+#define TEST_MAX_SEQS 4096
+
+/*
+ * RTP NACK 重传回环测试：
+ *   发送端每帧切片后把负载写入共享重传缓冲并记录，接收端按固定规律丢包、发现序号空洞后回 Generic NACK（rtcp-mux），
+ *   发送端在下一帧前处理反馈并原样重传。最终所有包都应按原序号、原负载到达；
+ *   对早已被覆盖的序号发 NACK 应记为 too_late，其它 SSRC 的 NACK 应被忽略，
+ *   但两份报文都要交给报文回调（GB28181 在回调里处理接收报告）。
+ *
+ * 用法：rtp_nack_test
+ */
+
+typedef struct {
+    uint8_t received[TEST_MAX_SEQS];
+    uint8_t nacked[TEST_MAX_SEQS];
+    int highest;
+    int dropped;
+    int recovered;
+    int errors;
+} Receiver;
+
+/* 与 GB28181 发流线程一样挂报文回调，统计 NACK 处理之后转交的报文数。 */
+static void count_rtcp_packet(void *user, const uint8_t *buf, size_t len) {
+    (void)buf;
+    if (len > 0) (*(int *)user)++;
+}
+
+static uint8_t payload_byte(uint16_t seq, size_t i) {
+    return (uint8_t)(seq * 7 + i);
+}
+
+static void build_header(uint8_t *header, uint16_t seq, uint32_t timestamp, int marker) {
+    header[0] = 0x80;
+    header[1] = (uint8_t)((marker ? 0x80 : 0x00) | 96);
+    header[2] = (uint8_t)(seq >> 8);
+    header[3] = (uint8_t)seq;
+    header[4] = (uint8_t)(timestamp >> 24);
+    header[5] = (uint8_t)(timestamp >> 16);
+    header[6] = (uint8_t)(timestamp >> 8);
+    header[7] = (uint8_t)timestamp;
+    header[8] = (uint8_t)(TEST_SSRC >> 24);
+    header[9] = (uint8_t)(TEST_SSRC >> 16);
+    header[10] = (uint8_t)(TEST_SSRC >> 8);
+    header[11] = (uint8_t)TEST_SSRC;
+}
+
+/* 组一个只含 Generic NACK 的 RTCP 包，每个序号单独一条 FCI（BLP 在解析侧另测）。 */
+static size_t build_nack(uint8_t *buf, uint32_t media_ssrc, const uint16_t *seqs, int count) {
+    size_t len = 12 + (size_t)count * 4;
+    int i;
+    buf[0] = 0x80 | 1;
+    buf[1] = 205;
+    buf[2] = (uint8_t)(((len / 4) - 1) >> 8);
+    buf[3] = (uint8_t)((len / 4) - 1);
+    memset(buf + 4, 0, 4);
+    buf[8] = (uint8_t)(media_ssrc >> 24);
+    buf[9] = (uint8_t)(media_ssrc >> 16);
+    buf[10] = (uint8_t)(media_ssrc >> 8);
+    buf[11] = (uint8_t)media_ssrc;
+    for (i = 0; i < count; ++i) {
+        buf[12 + i * 4] = (uint8_t)(seqs[i] >> 8);
+        buf[13 + i * 4] = (uint8_t)seqs[i];
+        buf[14 + i * 4] = 0;
+        buf[15 + i * 4] = 0;
+    }
+    return len;
+}
+
+/* 读空接收端：校验负载，按规律丢首次到达的包，对新出现的空洞回 NACK。 */
+static void receive_and_nack(int rx_fd, int tx_port, Receiver *rx) {
+    uint8_t buf[2048];
+    uint16_t missing[256];
+    int missing_count = 0;
+    struct sockaddr_in sender;
+    ssize_t n;
+    int seq;
+
+    while ((n = recv(rx_fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        uint16_t s = (uint16_t)((buf[2] << 8) | buf[3]);
+        ssize_t i;
+        if (n < 12 || s >= TEST_MAX_SEQS) {
+            rx->errors++;
+            continue;
+        }
+        for (i = 12; i < n; ++i) {
+            if (buf[i] != payload_byte(s, (size_t)(i - 12))) {
+                fprintf(stderr, "[ERROR] payload mismatch seq=%u offset=%zd\n", s, i - 12);
+                rx->errors++;
+                break;
+            }
+        }
+        if (!rx->nacked[s] && (s % TEST_DROP_MODULO) == 5) {
+            rx->dropped++;
+            continue;
+        }
+        if (rx->received[s]) continue;
+        rx->received[s] = 1;
+        if (rx->nacked[s]) rx->recovered++;
+        if (s > rx->highest) rx->highest = s;
+    }
+    for (seq = 0; seq < rx->highest && missing_count < 256; ++seq) {
+        if (!rx->received[seq] && !rx->nacked[seq]) {
+            rx->nacked[seq] = 1;
+            missing[missing_count++] = (uint16_t)seq;
+        }
+    }
+    if (missing_count == 0) return;
+    memset(&sender, 0, sizeof(sender));
+    sender.sin_family = AF_INET;
+    sender.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sender.sin_port = htons((uint16_t)tx_port);
+    n = (ssize_t)build_nack(buf, TEST_SSRC, missing, missing_count);
+    sendto(rx_fd, buf, (size_t)n, 0, (const struct sockaddr *)&sender, sizeof(sender));
+}
+
+static int bind_loopback(int *port) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int buf = 4 * 1024 * 1024;
+    if (fd < 0) return -1;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (const struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        close(fd);
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+/* 解析侧：BLP 展开、复合包里跳过非 NACK 报文、SSRC 不符时忽略。 */
+static int check_parse(void) {
+    uint8_t buf[64];
+    uint16_t seqs[32];
+    int count;
+    /* 前置一个 8 字节的 RR（无报告块），再接 NACK：PID=100，BLP=0x8001 -> 100,101,116。 */
+    memset(buf, 0, sizeof(buf));
+    buf[0] = 0x80;
+    buf[1] = 201;
+    buf[3] = 1;
+    buf[8] = 0x81;
+    buf[9] = 205;
+    buf[11] = 3;
+    buf[16] = (uint8_t)(TEST_SSRC >> 24);
+    buf[17] = (uint8_t)(TEST_SSRC >> 16);
+    buf[18] = (uint8_t)(TEST_SSRC >> 8);
+    buf[19] = (uint8_t)TEST_SSRC;
+    buf[20] = 0;
+    buf[21] = 100;
+    buf[22] = 0x80;
+    buf[23] = 0x01;
+    count = media_rtcp_parse_nack(buf, 24, TEST_SSRC, seqs, 32);
+    if (count != 3 || seqs[0] != 100 || seqs[1] != 101 || seqs[2] != 116) {
+        fprintf(stderr, "[ERROR] parse blp count=%d\n", count);
+        return -1;
+    }
+    if (media_rtcp_parse_nack(buf, 24, TEST_SSRC + 1, seqs, 32) != 0) {
+        fprintf(stderr, "[ERROR] parse accepted foreign ssrc\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main() {
+    MediaRtpEgress *egress = (MediaRtpEgress *)malloc(sizeof(MediaRtpEgress));
+    uint8_t *frame = (uint8_t *)malloc(TEST_IDR_BYTES);
+    Receiver *rx = (Receiver *)calloc(1, sizeof(Receiver));
+    MediaRtpHistoryArena arena;
+    MediaRtpHistory history;
+    uint8_t nack[64];
+    uint16_t stale_seq = 0;
+    uint16_t seq = 0;
+    int tx_port = 0;
+    int rx_port = 0;
+    int tx_fd;
+    int rx_fd;
+    int ret = 0;
+    int forwarded = 0;
+    int f;
+
+    if (!egress || !frame || !rx || check_parse() != 0) return -1;
+    tx_fd = bind_loopback(&tx_port);
+    rx_fd = bind_loopback(&rx_port);
+    if (tx_fd < 0 || rx_fd < 0 || media_rtp_history_arena_init(&arena, TEST_ARENA_BYTES) != 0 ||
+        media_rtp_history_init(&history, &arena, TEST_HISTORY_ENTRIES) != 0) {
+        fprintf(stderr, "[ERROR] setup failed errno=%d(%s)\n", errno, strerror(errno));
+        return -1;
+    }
+    media_rtp_history_reset(&history, TEST_SSRC);
+    media_rtp_egress_init(egress, 0);
+    media_rtp_egress_set_target(egress, tx_fd, "127.0.0.1", rx_port);
+
+    for (f = 0; f < TEST_FRAMES; ++f) {
+        size_t frame_bytes = (f % TEST_GOP == 0) ? TEST_IDR_BYTES : TEST_P_BYTES;
+        int packets = (int)((frame_bytes + TEST_RTP_MAX_PAYLOAD - 1) / TEST_RTP_MAX_PAYLOAD);
+        int p;
+
+        /* 与 GB28181 发流线程一致：新帧发出前先处理积压的 NACK。 */
+        media_rtp_history_serve_rtcp(&history, egress, tx_fd, NULL, NULL);
+        receive_and_nack(rx_fd, tx_port, rx);
+
+        media_rtp_egress_begin_frame(egress, frame_bytes);
+        for (p = 0; p < packets; ++p) {
+            uint8_t header[12];
+            struct iovec payload;
+            size_t len = (p == packets - 1) ? frame_bytes - (size_t)p * TEST_RTP_MAX_PAYLOAD : TEST_RTP_MAX_PAYLOAD;
+            size_t i;
+            uint64_t pos;
+            payload.iov_base = frame + (size_t)p * TEST_RTP_MAX_PAYLOAD;
+            payload.iov_len = len;
+            for (i = 0; i < len; ++i) frame[(size_t)p * TEST_RTP_MAX_PAYLOAD + i] = payload_byte(seq, i);
+            build_header(header, seq, (uint32_t)f * 3600U, p == packets - 1);
+            pos = media_rtp_history_arena_append(&arena, &payload, 1);
+            if (media_rtp_egress_queue(egress, header, sizeof(header), &payload, 1) != 0) ret = -1;
+            media_rtp_history_record(&history, header, pos, len);
+            seq++;
+        }
+        if (media_rtp_egress_end_frame(egress) != 0) ret = -1;
+        receive_and_nack(rx_fd, tx_port, rx);
+    }
+    for (f = 0; f < 4; ++f) {
+        media_rtp_history_serve_rtcp(&history, egress, tx_fd, NULL, NULL);
+        usleep(1000);
+        receive_and_nack(rx_fd, tx_port, rx);
+    }
+
+    /* 序号 0 的负载早已被后续帧覆盖，应记为 too_late 而不是发出错误数据。 */
+    {
+        struct sockaddr_in sender;
+        memset(&sender, 0, sizeof(sender));
+        sender.sin_family = AF_INET;
+        sender.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        sender.sin_port = htons((uint16_t)tx_port);
+        sendto(rx_fd, nack, build_nack(nack, TEST_SSRC, &stale_seq, 1), 0, (const struct sockaddr *)&sender, sizeof(sender));
+        sendto(rx_fd, nack, build_nack(nack, TEST_SSRC + 1, &stale_seq, 1), 0, (const struct sockaddr *)&sender, sizeof(sender));
+    }
+    usleep(1000);
+    media_rtp_history_serve_rtcp(&history, egress, tx_fd, count_rtcp_packet, &forwarded);
+
+    for (f = 0; f < seq; ++f) {
+        if (!rx->received[f]) {
+            fprintf(stderr, "[ERROR] seq=%d never recovered\n", f);
+            ret = -1;
+            break;
+        }
+    }
+    printf("[RTP_NACK_TEST] packets=%u dropped=%d recovered=%d nack_packets=%" PRIu64 " requested=%" PRIu64
+           " retransmitted=%" PRIu64 " too_late=%" PRIu64 " payload_errors=%d\n",
+           seq, rx->dropped, rx->recovered, history.nack_packets, history.nack_requested, history.retransmitted,
+           history.too_late, rx->errors);
+    if (rx->errors != 0 || rx->dropped == 0 || rx->recovered != rx->dropped ||
+        history.retransmitted != (uint64_t)rx->dropped) {
+        fprintf(stderr, "[ERROR] retransmission did not recover every dropped packet\n");
+        ret = -1;
+    }
+    if (history.too_late != 1) {
+        fprintf(stderr, "[ERROR] stale nack not reported as too_late\n");
+        ret = -1;
+    }
+    if (forwarded != 2) {
+        fprintf(stderr, "[ERROR] rtcp callback saw %d packets, expected 2\n", forwarded);
+        ret = -1;
+    }
+
+    media_rtp_egress_deinit(egress);
+    media_rtp_history_deinit(&history);
+    media_rtp_history_arena_deinit(&arena);
+    close(tx_fd);
+    close(rx_fd);
+    free(egress);
+    free(frame);
+    free(rx);
+    return ret;
+}
@@ -0,0 +1,226 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+extern "C" {
+#include "mediaRtpEgress.h"
+}
+
+#define TEST_FRAMES 120
+#define TEST_GOP 30
+#define TEST_IDR_BYTES (100 * 1024)
+#define TEST_P_BYTES (10 * 1024)
+#define TEST_RTP_MAX_PAYLOAD 1400
+#define TEST_SMALL_BUF (32 * 1024)
+/* 慢速接收端每帧间隔最多读取的字节数，约为平均码流的一半。 */
+#define TEST_SLOW_READ_BYTES (6 * 1024)
+
+/*
+ * RTP over TCP（RFC 4571）回环测试：
+ *   fast  接收端每帧都读空，所有帧都应完整到达、不丢帧；
+ *   slow  接收端限速读取、收发缓冲都很小，发送端应按帧丢弃而不是阻塞，
+ *         最终读空后流内每个包仍是完整的“两字节长度 + RTP”，序号连续、帧以 marker 结尾。
+ *
+ * 用法：rtp_tcp_test
+ */
+
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t cap;
+    uint16_t next_seq;
+    int packets;
+    int frames;
+    int in_frame;
+    int errors;
+} StreamParser;
+
+static void build_header(uint8_t *header, uint16_t seq, int marker) {
+    memset(header, 0, 12);
+    header[0] = 0x80;
+    header[1] = (uint8_t)((marker ? 0x80 : 0x00) | 96);
+    header[2] = (uint8_t)(seq >> 8);
+    header[3] = (uint8_t)seq;
+}
+
+/* 解析已收到的字节流，按 RFC 4571 切包并校验序号、marker 和包长。 */
+static void parser_consume(StreamParser *parser) {
+    size_t off = 0;
+    while (parser->len - off >= 2) {
+        size_t pkt_len = ((size_t)parser->buf[off] << 8) | parser->buf[off + 1];
+        const uint8_t *rtp;
+        uint16_t seq;
+        if (parser->len - off < 2 + pkt_len) break;
+        rtp = parser->buf + off + 2;
+        seq = (uint16_t)((rtp[2] << 8) | rtp[3]);
+        if (pkt_len < 12 || pkt_len > 12 + TEST_RTP_MAX_PAYLOAD || rtp[0] != 0x80 || (rtp[1] & 0x7F) != 96 ||
+            seq != parser->next_seq) {
+            fprintf(stderr, "[ERROR] bad packet len=%zu v=0x%02x seq=%u expect_seq=%u\n",
+                    pkt_len, rtp[0], seq, parser->next_seq);
+            parser->errors++;
+            return;
+        }
+        parser->next_seq = (uint16_t)(seq + 1);
+        parser->packets++;
+        parser->in_frame = 1;
+        if (rtp[1] & 0x80) {
+            parser->frames++;
+            parser->in_frame = 0;
+        }
+        off += 2 + pkt_len;
+    }
+    memmove(parser->buf, parser->buf + off, parser->len - off);
+    parser->len -= off;
+}
+
+/* 从接收端读取最多 budget 字节（0 表示读空），返回本次读到的字节数。 */
+static size_t receive_some(int fd, StreamParser *parser, size_t budget) {
+    size_t total = 0;
+    for (;;) {
+        size_t want = parser->cap - parser->len;
+        ssize_t n;
+        if (budget > 0 && want > budget - total) want = budget - total;
+        if (want == 0) break;
+        n = recv(fd, parser->buf + parser->len, want, MSG_DONTWAIT);
+        if (n <= 0) break;
+        parser->len += (size_t)n;
+        total += (size_t)n;
+        parser_consume(parser);
+        if (budget > 0 && total >= budget) break;
+    }
+    return total;
+}
+
+static int connect_pair(int listen_fd, const struct sockaddr_in *addr, int small_buf, int *tx_fd, int *rx_fd) {
+    int buf = TEST_SMALL_BUF;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (small_buf) setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+    if (connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    *tx_fd = fd;
+    *rx_fd = accept(listen_fd, NULL, NULL);
+    return (*rx_fd >= 0) ? 0 : -1;
+}
+
+static int run_case(const char *name, int slow, int listen_fd, const struct sockaddr_in *addr, const uint8_t *frame) {
+    MediaRtpEgress *egress = (MediaRtpEgress *)malloc(sizeof(MediaRtpEgress));
+    StreamParser parser;
+    uint16_t seq = 0;
+    int sent_frames = 0;
+    int tx_fd = -1;
+    int rx_fd = -1;
+    int ret = 0;
+    int f;
+
+    memset(&parser, 0, sizeof(parser));
+    parser.cap = 1024 * 1024;
+    parser.buf = (uint8_t *)malloc(parser.cap);
+    if (!egress || !parser.buf || connect_pair(listen_fd, addr, slow, &tx_fd, &rx_fd) != 0) {
+        fprintf(stderr, "[ERROR] case=%s setup failed errno=%d(%s)\n", name, errno, strerror(errno));
+        free(egress);
+        free(parser.buf);
+        return -1;
+    }
+    if (slow) {
+        int buf = TEST_SMALL_BUF;
+        setsockopt(rx_fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+    }
+    media_rtp_egress_init(egress, 0);
+    media_rtp_egress_set_tcp_target(egress, tx_fd);
+
+    for (f = 0; f < TEST_FRAMES; ++f) {
+        size_t frame_bytes = (f % TEST_GOP == 0) ? TEST_IDR_BYTES : TEST_P_BYTES;
+        int packets = (int)((frame_bytes + TEST_RTP_MAX_PAYLOAD - 1) / TEST_RTP_MAX_PAYLOAD);
+        size_t last_payload = frame_bytes - (size_t)(packets - 1) * TEST_RTP_MAX_PAYLOAD;
+        int p;
+
+        if (media_rtp_egress_begin_frame(egress, frame_bytes) == 0) {
+            for (p = 0; p < packets; ++p) {
+                uint8_t header[12];
+                struct iovec payload;
+                int marker = (p == packets - 1);
+                payload.iov_base = (void *)(frame + (size_t)p * TEST_RTP_MAX_PAYLOAD);
+                payload.iov_len = marker ? last_payload : TEST_RTP_MAX_PAYLOAD;
+                build_header(header, seq++, marker);
+                if (media_rtp_egress_queue(egress, header, sizeof(header), &payload, 1) != 0) ret = -1;
+            }
+            sent_frames++;
+        }
+        if (media_rtp_egress_end_frame(egress) != 0) ret = -1;
+        receive_some(rx_fd, &parser, slow ? TEST_SLOW_READ_BYTES : 0);
+    }
+
+    /* 发送结束后读空接收端，同时把发送端的帧尾续写完。 */
+    for (f = 0; f < 1000 && (egress->tcp_pending_len > 0 || parser.frames < sent_frames); ++f) {
+        struct pollfd pfd;
+        if (media_rtp_egress_flush(egress) != 0) ret = -1;
+        receive_some(rx_fd, &parser, 0);
+        pfd.fd = rx_fd;
+        pfd.events = POLLIN;
+        poll(&pfd, 1, 5);
+    }
+
+    printf("[RTP_TCP_TEST] case=%s frames=%d sent=%d dropped=%" PRIu64 " received=%d packets=%d partial_writes=%" PRIu64
+           " syscalls_per_frame=%.2f parse_errors=%d\n",
+           name, TEST_FRAMES, sent_frames, egress->dropped_frames, parser.frames, parser.packets,
+           egress->tcp_partial_writes, (double)egress->syscalls / TEST_FRAMES, parser.errors);
+    if (parser.errors != 0 || parser.in_frame || parser.len != 0 || parser.frames != sent_frames ||
+        parser.next_seq != seq) {
+        fprintf(stderr, "[ERROR] case=%s stream framing broken\n", name);
+        ret = -1;
+    }
+    if (!slow && egress->dropped_frames != 0) {
+        fprintf(stderr, "[ERROR] case=%s dropped frames on an idle link\n", name);
+        ret = -1;
+    }
+    if (slow && (egress->dropped_frames == 0 || sent_frames == 0)) {
+        fprintf(stderr, "[ERROR] case=%s expected congestion drops\n", name);
+        ret = -1;
+    }
+
+    media_rtp_egress_deinit(egress);
+    close(tx_fd);
+    close(rx_fd);
+    free(egress);
+    free(parser.buf);
+    return ret;
+}
+
+int main() {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    uint8_t *frame = (uint8_t *)malloc(TEST_IDR_BYTES);
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int ret = 0;
+    int i;
+
+    if (!frame || listen_fd < 0) return -1;
+    for (i = 0; i < TEST_IDR_BYTES; ++i) frame[i] = (uint8_t)(i * 13);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd, (const struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len) != 0 || listen(listen_fd, 2) != 0) {
+        fprintf(stderr, "[ERROR] loopback listener failed errno=%d(%s)\n", errno, strerror(errno));
+        return -1;
+    }
+
+    if (run_case("fast", 0, listen_fd, &addr, frame) != 0) ret = -1;
+    if (run_case("slow", 1, listen_fd, &addr, frame) != 0) ret = -1;
+
+    close(listen_fd);
+    free(frame);
+    return ret;
+}
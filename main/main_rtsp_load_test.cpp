@@ -0,0 +1,1443 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+#include "rtspDigest.h"
+#include "rtspRtp.h"
+#include "rtspServer.h"
+#include "mediaRtcp.h"
+}
+
+#define TEST_FRAMES 150
+#define TEST_GOP 10
+#define TEST_LATE_JOIN_FRAME 55
+#define TEST_IDR_BYTES (200 * 1024)
+#define TEST_P_BYTES (50 * 1024)
+#define TEST_FRAME_INTERVAL_US 10000
+#define TEST_FRAME_DURATION_MS 40
+#define TEST_EARLY_TCP_CLIENTS 4
+#define TEST_EARLY_UDP_CLIENTS 2
+#define TEST_LATE_CLIENTS 4
+#define TEST_SESSION "live_main"
+#define TEST_USER "admin"
+#define TEST_PASSWORD "123456"
+#define TEST_RECV_BUF (256 * 1024)
+#define TEST_MAX_FRAME (TEST_IDR_BYTES + 1024)
+#define TEST_REPLY_MAX 4096
+#define TEST_DRAIN_TIMEOUT_US (15 * 1000000ULL)
+#define TEST_MULTICAST_GROUP "239.255.77.1"
+#define TEST_MULTICAST_CLIENTS 4
+#define TEST_RTCP_INTERVAL_MS 100
+/* UDP 测试客户端在 RR 里报告的丢包比例（26/256 ≈ 10.2%）与抖动（450/90000 s = 5 ms），TCP 客户端报告 0 丢包。 */
+#define TEST_RR_UDP_FRACTION 26
+#define TEST_RR_JITTER 450
+#define TEST_SLOW_BUDGET_BYTES (1024 * 1024)
+#define TEST_SLOW_RATE_BYTES (1024 * 1024)
+#define TEST_SLOW_RCVBUF (64 * 1024)
+#define BENCH_DEFAULT_CLIENTS 32
+#define BENCH_DEFAULT_SECONDS 10
+#define BENCH_IDR_BYTES (60 * 1024)
+#define BENCH_P_BYTES (18 * 1024)
+#define BENCH_GOP 25
+#define BENCH_FRAME_INTERVAL_US 40000
+#define BENCH_WARMUP_TIMEOUT_US (10 * 1000000ULL)
+
+/*
+ * 进程内 RTSP 服务的本地测试与压测：
+ *   默认模式：同一 session 同时服务多个客户端并逐项校验——
+ *     A. 开启 Digest 鉴权：首次 DESCRIBE 回 401，带正确 response 后返回含 sprop-parameter-sets 的 SDP；
+ *     B. TCP interleaved 与 UDP 客户端：从关键帧开始收流，FU-A 重组后与输入逐字节一致，RTP 序号连续；
+ *     C. 中途接入的客户端：从下一个关键帧开始，之后连续不丢帧；
+ *     D. 不同客户端收到的同一帧 RTP 序号相同（每帧只打包一次，所有客户端共享）；
+ *     E. 错误路径回 404，错误密码回 401 并计入 auth_failures；PLAY/TEARDOWN 触发连接/断开回调。
+ *     以上分三种模式各跑一遍：不开 GOP 缓存（等下一个关键帧，每个客户端都要 IDR）；开 GOP 缓存（从缓存的
+ *     最近一个 IDR 起播，回调不再要求 IDR）；开 GOP 缓存但缓存 IDR 已超龄（退回等关键帧并要求 IDR）。
+ *     G. RTCP：服务端按周期给每个客户端发 SR（UDP 走 RTCP 端口，TCP 走 interleaved 通道 1），客户端回 RR，
+ *        session 的接收统计汇总出最差丢包率/抖动，RTT 由 LSR/DLSR 算出。
+ *     F. 组播：多个客户端经 loopback 加入同一组，SDP/SETUP 给出组地址；每帧只向组发一份，组的发送字节数
+ *        等于单个组播客户端收到的字节数，与观众数无关；同一 session 的 TCP 单播客户端不受影响。
+ *     H. 慢客户端：一个限速读取的 TCP 客户端与正常客户端同看一路流，它的发送队列超限时只丢它自己的积压、
+ *        从下一个关键帧继续，正常客户端仍逐帧收齐且时延不受影响；开启驱逐时超限次数达到阈值后被断开。
+ *   bench 模式：fork 出负载进程拉流，统计服务进程（打包 + 服务线程）CPU，换算每核可带客户端数。
+ *   url 模式：对外部 RTSP 服务（如板端旧 librtsp_server.so 网关）拉流，给定 pid 时按 /proc 统计其 CPU。
+ *
+ * 用法：rtsp_load_test
+ *       rtsp_load_test bench [clients] [seconds] [tcp|udp]
+ *       rtsp_load_test url <rtsp://user:pass@ip:port/session> [clients] [seconds] [tcp|udp] [pid]
+ */
+
+typedef struct {
+    int fd;
+    int cseq;
+    char host[64];
+    int port;
+    char url[256];
+    char user[64];
+    char password[64];
+    char realm[128];
+    char nonce[128];
+    char session[128];
+    char transport[192];
+    uint8_t *buf;
+    size_t len;
+} Conn;
+
+typedef struct {
+    uint8_t *nalu;
+    size_t nalu_len;
+    uint8_t *frame;
+    size_t frame_len;
+    int have_seq;
+    uint16_t last_seq;
+    uint16_t frame_first_seq;
+    int frame_started;
+    int seq_gaps;
+    int bad;
+} Depacketizer;
+
+typedef struct {
+    int port;
+    int use_udp;
+    int multicast;
+    int multicast_fd;
+    int auth_ok;
+    int sdp_ok;
+    int play_ok;
+    int teardown_ok;
+    volatile int ready;
+    volatile int done;
+    int frames;
+    int first_index;
+    int gaps;
+    int bad;
+    int seq_gaps;
+    int last_index;
+    uint16_t last_frame_seq;
+    uint64_t bytes;
+    int sr_received;
+    int rr_sent;
+    int throttle_bytes_per_sec;
+    int misaligned;
+    uint64_t max_delay_us;
+    Depacketizer depack;
+    uint8_t *scratch;
+} TestClient;
+
+typedef struct {
+    const char *url;
+    int use_udp;
+    int seconds;
+    int ok;
+    uint64_t bytes;
+    uint64_t packets;
+} LoadClient;
+
+static volatile int g_stop_clients = 0;
+static volatile int g_play_events = 0;
+static volatile int g_close_events = 0;
+static volatile int g_cached_play_events = 0;
+/* 每帧交给服务端的时刻，用于统计客户端收到完整帧的时延；为 0 的帧不统计。 */
+static uint64_t g_frame_sent_us[TEST_FRAMES];
+static pthread_mutex_t g_event_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static size_t append_nalu(uint8_t *dst, uint8_t header, size_t len, uint32_t seed, int index) {
+    size_t i;
+    dst[0] = 0;
+    dst[1] = 0;
+    dst[2] = 0;
+    dst[3] = 1;
+    dst[4] = header;
+    for (i = 1; i < len; ++i) {
+        seed = seed * 1103515245U + 12345U;
+        /* 负载不含 0x00，避免伪起始码。 */
+        dst[4 + i] = (uint8_t)(0x10 + ((seed >> 16) % 0xF0));
+    }
+    /* 媒体 NALU 的前 4 个负载字节编码帧号，客户端据此重建期望内容。 */
+    if (index >= 0 && len > 5) {
+        for (i = 0; i < 4; ++i) {
+            dst[5 + i] = (uint8_t)(0x10 | ((index >> (12 - 4 * i)) & 0x0F));
+        }
+    }
+    return 4 + len;
+}
+
+static size_t make_frame(uint8_t *dst, int index, int gop, size_t idr_bytes, size_t p_bytes) {
+    size_t len = 0;
+    int key = (index % gop) == 0;
+    len += append_nalu(dst + len, 0x09, 2, 1, -1);
+    if (key) {
+        len += append_nalu(dst + len, 0x67, 20, 7, -1);
+        len += append_nalu(dst + len, 0x68, 5, 8, -1);
+        len += append_nalu(dst + len, 0x65, idr_bytes, (uint32_t)index, index);
+    } else {
+        len += append_nalu(dst + len, 0x41, p_bytes, (uint32_t)index, index);
+    }
+    return len;
+}
+
+static int send_frame(RtspServerSession *session, uint8_t *frame, int index, int gop, size_t idr_bytes, size_t p_bytes,
+                      uint64_t frame_duration_us) {
+    MediaPacket packet;
+    MediaBuffer *buffer = NULL;
+    size_t len = make_frame(frame, index, gop, idr_bytes, p_bytes);
+    int ret;
+    if (media_buffer_create_copy(frame, len, &buffer) != 0) return -1;
+    media_packet_init(&packet);
+    packet.frame_type = MEDIA_FRAME_TYPE_VIDEO;
+    packet.codec = MEDIA_CODEC_H264;
+    packet.buffer = buffer;
+    packet.frame_id = (uint64_t)index;
+    packet.pts_us = (uint64_t)index * frame_duration_us;
+    packet.is_key_frame = (index % gop) == 0;
+    ret = rtsp_server_session_send_packet(session, &packet);
+    media_buffer_release(buffer);
+    return ret;
+}
+
+static int parse_url(Conn *c, const char *url) {
+    const char *p = url;
+    const char *at;
+    const char *slash;
+    const char *colon;
+    char hostport[128];
+
+    if (strncasecmp(p, "rtsp://", 7) != 0) return -1;
+    p += 7;
+    slash = strchr(p, '/');
+    at = strchr(p, '@');
+    if (at && (!slash || at < slash)) {
+        const char *sep = (const char *)memchr(p, ':', (size_t)(at - p));
+        if (!sep) return -1;
+        snprintf(c->user, sizeof(c->user), "%.*s", (int)(sep - p), p);
+        snprintf(c->password, sizeof(c->password), "%.*s", (int)(at - sep - 1), sep + 1);
+        p = at + 1;
+    }
+    snprintf(hostport, sizeof(hostport), "%.*s", slash ? (int)(slash - p) : (int)strlen(p), p);
+    colon = strchr(hostport, ':');
+    c->port = colon ? atoi(colon + 1) : 554;
+    snprintf(c->host, sizeof(c->host), "%.*s", colon ? (int)(colon - hostport) : (int)strlen(hostport), hostport);
+    /* 请求 URL 不带用户名密码。 */
+    snprintf(c->url, sizeof(c->url), "rtsp://%s%s", hostport, slash ? slash : "/");
+    return 0;
+}
+
+static void conn_close(Conn *c) {
+    if (c->fd >= 0) close(c->fd);
+    c->fd = -1;
+    free(c->buf);
+    c->buf = NULL;
+}
+
+static int conn_open(Conn *c, const char *url, int retry_ms) {
+    struct sockaddr_in addr;
+    struct timeval tv;
+    uint64_t deadline = now_us() + (uint64_t)retry_ms * 1000ULL;
+
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+    if (parse_url(c, url) != 0) return -1;
+    c->buf = (uint8_t *)malloc(TEST_RECV_BUF);
+    if (!c->buf) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)c->port);
+    if (inet_pton(AF_INET, c->host, &addr.sin_addr) != 1) {
+        conn_close(c);
+        return -1;
+    }
+    do {
+        c->fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (c->fd < 0) break;
+        if (connect(c->fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) break;
+        close(c->fd);
+        c->fd = -1;
+        usleep(20000);
+    } while (now_us() < deadline);
+    if (c->fd < 0) {
+        conn_close(c);
+        return -1;
+    }
+    tv.tv_sec = 0;
+    tv.tv_usec = 200000;
+    setsockopt(c->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return 0;
+}
+
+/* 读一次 socket 追加到缓冲，超时返回 0，出错或对端关闭返回 -1。 */
+static int conn_fill(Conn *c) {
+    ssize_t n;
+    if (c->len >= TEST_RECV_BUF) return -1;
+    n = recv(c->fd, c->buf + c->len, TEST_RECV_BUF - c->len, 0);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+    if (n <= 0) return -1;
+    c->len += (size_t)n;
+    return (int)n;
+}
+
+static void conn_consume(Conn *c, size_t n) {
+    memmove(c->buf, c->buf + n, c->len - n);
+    c->len -= n;
+}
+
+static int header_value(const char *reply, const char *name, char *out, size_t cap) {
+    size_t name_len = strlen(name);
+    const char *line = strstr(reply, "\r\n");
+    while (line && line[2] != '\r' && line[2] != '\0') {
+        line += 2;
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char *v = line + name_len + 1;
+            size_t len;
+            while (*v == ' ') v++;
+            len = strcspn(v, "\r\n");
+            if (len + 1 > cap) return -1;
+            memcpy(out, v, len);
+            out[len] = '\0';
+            return 0;
+        }
+        line = strstr(line, "\r\n");
+    }
+    return -1;
+}
+
+/* 读一个完整响应（跳过夹在中间的 interleaved 数据），返回状态码。 */
+static int conn_read_reply(Conn *c, char *reply, size_t cap) {
+    uint64_t deadline = now_us() + 3000000ULL;
+    while (now_us() < deadline) {
+        if (c->len >= 4 && c->buf[0] == '$') {
+            size_t block = 4 + (((size_t)c->buf[2] << 8) | c->buf[3]);
+            if (c->len >= block) {
+                conn_consume(c, block);
+                continue;
+            }
+        } else if (c->len > 0) {
+            uint8_t *end = (uint8_t *)memmem(c->buf, c->len, "\r\n\r\n", 4);
+            if (end) {
+                size_t header_len = (size_t)(end - c->buf) + 4;
+                size_t body_len = 0;
+                char value[32];
+                if (header_len >= cap) return -1;
+                memcpy(reply, c->buf, header_len);
+                reply[header_len] = '\0';
+                if (header_value(reply, "Content-Length", value, sizeof(value)) == 0) {
+                    body_len = (size_t)atoi(value);
+                }
+                if (c->len >= header_len + body_len) {
+                    if (header_len + body_len >= cap) return -1;
+                    memcpy(reply + header_len, c->buf + header_len, body_len);
+                    reply[header_len + body_len] = '\0';
+                    conn_consume(c, header_len + body_len);
+                    return strncmp(reply, "RTSP/1.0 ", 9) == 0 ? atoi(reply + 9) : -1;
+                }
+            }
+        }
+        if (conn_fill(c) < 0) return -1;
+    }
+    return -1;
+}
+
+static int digest_param(const char *header, const char *key, char *out, size_t cap) {
+    char pattern[32];
+    const char *p;
+    size_t len;
+    snprintf(pattern, sizeof(pattern), "%s=\"", key);
+    p = strstr(header, pattern);
+    if (!p) return -1;
+    p += strlen(pattern);
+    len = strcspn(p, "\"");
+    if (len + 1 > cap) return -1;
+    memcpy(out, p, len);
+    out[len] = '\0';
+    return 0;
+}
+
+/* 发送请求并读响应；收到 401 时按 WWW-Authenticate 计算 Digest 重试一次。 */
+static int conn_request(Conn *c, const char *method, const char *uri, const char *extra, char *reply, size_t cap) {
+    int attempt;
+    int status = -1;
+    for (attempt = 0; attempt < 2; ++attempt) {
+        char request[2048];
+        char auth[512];
+        char session[160];
+        char challenge[512];
+        int len;
+
+        auth[0] = '\0';
+        session[0] = '\0';
+        if (c->nonce[0] && c->user[0]) {
+            char response[33];
+            rtsp_digest_response(method, uri, c->realm, c->nonce, c->user, c->password, response);
+            snprintf(auth, sizeof(auth),
+                     "Authorization: Digest username=\"%s\", realm=\"%s\", nonce=\"%s\", uri=\"%s\", response=\"%s\"\r\n",
+                     c->user, c->realm, c->nonce, uri, response);
+        }
+        if (c->session[0]) {
+            snprintf(session, sizeof(session), "Session: %s\r\n", c->session);
+        }
+        len = snprintf(request, sizeof(request), "%s %s RTSP/1.0\r\nCSeq: %d\r\nUser-Agent: rtsp_load_test\r\n%s%s%s\r\n",
+                       method, uri, ++c->cseq, auth, session, extra ? extra : "");
+        if (send(c->fd, request, (size_t)len, MSG_NOSIGNAL) != len) return -1;
+        status = conn_read_reply(c, reply, cap);
+        if (status != 401 || attempt > 0 || !c->user[0] ||
+            header_value(reply, "WWW-Authenticate", challenge, sizeof(challenge)) != 0 ||
+            digest_param(challenge, "realm", c->realm, sizeof(c->realm)) != 0 ||
+            digest_param(challenge, "nonce", c->nonce, sizeof(c->nonce)) != 0) {
+            break;
+        }
+    }
+    return status;
+}
+
+/* 依次 DESCRIBE/SETUP/PLAY，UDP 模式下 rtp_port 为本地 RTP 端口，multicast 时请求组播传输。 */
+static int conn_play(Conn *c, int use_udp, int multicast, int rtp_port, char *sdp, size_t sdp_cap) {
+    char reply[TEST_REPLY_MAX];
+    char transport[128];
+    char track[320];
+    char value[128];
+
+    if (conn_request(c, "DESCRIBE", c->url, "Accept: application/sdp\r\n", reply, sizeof(reply)) != 200) return -1;
+    if (sdp) snprintf(sdp, sdp_cap, "%s", reply);
+    snprintf(track, sizeof(track), "%s%strackID=0", c->url, c->url[strlen(c->url) - 1] == '/' ? "" : "/");
+    if (multicast) {
+        snprintf(transport, sizeof(transport), "Transport: RTP/AVP;multicast\r\n");
+    } else if (use_udp) {
+        snprintf(transport, sizeof(transport), "Transport: RTP/AVP;unicast;client_port=%d-%d\r\n", rtp_port, rtp_port + 1);
+    } else {
+        snprintf(transport, sizeof(transport), "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n");
+    }
+    if (conn_request(c, "SETUP", track, transport, reply, sizeof(reply)) != 200 ||
+        header_value(reply, "Session", value, sizeof(value)) != 0 ||
+        header_value(reply, "Transport", c->transport, sizeof(c->transport)) != 0) {
+        return -1;
+    }
+    value[strcspn(value, ";")] = '\0';
+    snprintf(c->session, sizeof(c->session), "%s", value);
+    return conn_request(c, "PLAY", c->url, "Range: npt=0.000-\r\n", reply, sizeof(reply)) == 200 ? 0 : -1;
+}
+
+static int udp_bind_pair(int *rtp_fd, int *rtcp_fd) {
+    int attempt;
+    for (attempt = 0; attempt < 32; ++attempt) {
+        struct sockaddr_in addr;
+        socklen_t addr_len = sizeof(addr);
+        int rcvbuf = 4 * 1024 * 1024;
+        struct timeval tv;
+        int port;
+        int a = socket(AF_INET, SOCK_DGRAM, 0);
+        int b = socket(AF_INET, SOCK_DGRAM, 0);
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(a, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+            getsockname(a, (struct sockaddr *)&addr, &addr_len) != 0) {
+            close(a);
+            close(b);
+            return -1;
+        }
+        port = ntohs(addr.sin_port);
+        addr.sin_port = htons((uint16_t)(port + 1));
+        if ((port & 1) != 0 || bind(b, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            close(a);
+            close(b);
+            continue;
+        }
+        setsockopt(a, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        tv.tv_sec = 0;
+        tv.tv_usec = 200000;
+        setsockopt(a, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        *rtp_fd = a;
+        *rtcp_fd = b;
+        return port;
+    }
+    return -1;
+}
+
+static int depack_init(Depacketizer *d) {
+    memset(d, 0, sizeof(*d));
+    d->nalu = (uint8_t *)malloc(TEST_MAX_FRAME);
+    d->frame = (uint8_t *)malloc(TEST_MAX_FRAME);
+    return (d->nalu && d->frame) ? 0 : -1;
+}
+
+static void depack_free(Depacketizer *d) {
+    free(d->nalu);
+    free(d->frame);
+}
+
+static void depack_append(Depacketizer *d, const uint8_t *nalu, size_t len) {
+    if (d->frame_len + 4 + len > TEST_MAX_FRAME) {
+        d->bad++;
+        return;
+    }
+    memcpy(d->frame + d->frame_len, "\x00\x00\x00\x01", 4);
+    memcpy(d->frame + d->frame_len + 4, nalu, len);
+    d->frame_len += 4 + len;
+}
+
+/* 处理一个 RTP 包，marker 结束一帧时返回 1。 */
+static int depack_packet(Depacketizer *d, const uint8_t *pkt, size_t len) {
+    uint16_t seq;
+    const uint8_t *payload;
+    size_t payload_len;
+    int type;
+
+    if (len < 13 || (pkt[0] >> 6) != 2 || (pkt[1] & 0x7F) != RTSP_RTP_PAYLOAD_TYPE_H264) {
+        d->bad++;
+        return 0;
+    }
+    seq = (uint16_t)((pkt[2] << 8) | pkt[3]);
+    if (d->have_seq && seq != (uint16_t)(d->last_seq + 1)) d->seq_gaps++;
+    d->have_seq = 1;
+    d->last_seq = seq;
+    if (!d->frame_started) {
+        d->frame_started = 1;
+        d->frame_first_seq = seq;
+    }
+    payload = pkt + 12;
+    payload_len = len - 12;
+    type = payload[0] & 0x1F;
+    if (type >= 1 && type <= 23) {
+        depack_append(d, payload, payload_len);
+    } else if (type == 28 && payload_len > 2) {
+        if (payload[1] & 0x80) {
+            d->nalu[0] = (uint8_t)((payload[0] & 0xE0) | (payload[1] & 0x1F));
+            d->nalu_len = 1;
+        }
+        if (d->nalu_len == 0 || d->nalu_len + payload_len - 2 > TEST_MAX_FRAME) {
+            d->bad++;
+        } else {
+            memcpy(d->nalu + d->nalu_len, payload + 2, payload_len - 2);
+            d->nalu_len += payload_len - 2;
+            if (payload[1] & 0x40) {
+                depack_append(d, d->nalu, d->nalu_len);
+                d->nalu_len = 0;
+            }
+        }
+    } else {
+        d->bad++;
+    }
+    return (pkt[1] & 0x80) ? 1 : 0;
+}
+
+/* 按帧号重建期望内容并逐字节比对，返回帧号，不一致返回 -1。 */
+static int check_frame(TestClient *client) {
+    Depacketizer *d = &client->depack;
+    const uint8_t *media = NULL;
+    size_t i;
+    int index = 0;
+
+    for (i = 0; i + 9 < d->frame_len; ++i) {
+        if (memcmp(d->frame + i, "\x00\x00\x00\x01", 4) == 0 && (d->frame[i + 4] == 0x65 || d->frame[i + 4] == 0x41)) {
+            media = d->frame + i + 5;
+            break;
+        }
+    }
+    if (!media) return -1;
+    for (i = 0; i < 4; ++i) {
+        index = (index << 4) | (media[i] & 0x0F);
+    }
+    if (make_frame(client->scratch, index, TEST_GOP, TEST_IDR_BYTES, TEST_P_BYTES) != d->frame_len ||
+        memcmp(client->scratch, d->frame, d->frame_len) != 0) {
+        return -1;
+    }
+    return index;
+}
+
+static void on_frame(TestClient *client) {
+    int index = check_frame(client);
+    if (index < 0) {
+        client->bad++;
+    } else {
+        uint64_t sent_us = g_frame_sent_us[index];
+        if (sent_us > 0 && now_us() - sent_us > client->max_delay_us) {
+            client->max_delay_us = now_us() - sent_us;
+        }
+        if (client->frames == 0) {
+            client->first_index = index;
+        } else if (index != client->last_index + 1) {
+            client->gaps++;
+            /* 丢帧后必须从关键帧继续。 */
+            if (index % TEST_GOP != 0) client->misaligned++;
+        }
+        client->last_index = index;
+        client->last_frame_seq = client->depack.frame_first_seq;
+        client->frames++;
+    }
+    client->depack.frame_len = 0;
+    client->depack.frame_started = 0;
+}
+
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void write_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/* 收到 SR 时生成针对它的 RR（单个报告块），返回 RR 长度，不是 SR 返回 0。 */
+static size_t make_receiver_report(TestClient *client, const uint8_t *sr, size_t len, uint8_t *rr) {
+    if (len < 28 || (sr[0] >> 6) != 2 || sr[1] != MEDIA_RTCP_PT_SR) return 0;
+    client->sr_received++;
+    memset(rr, 0, 32);
+    rr[0] = 0x81;
+    rr[1] = MEDIA_RTCP_PT_RR;
+    rr[3] = 7;
+    write_be32(rr + 4, 0x5EC0000U + (uint32_t)client->port);
+    write_be32(rr + 8, read_be32(sr + 4));
+    rr[12] = client->use_udp ? TEST_RR_UDP_FRACTION : 0;
+    rr[15] = 3;
+    write_be32(rr + 16, (uint32_t)client->last_frame_seq);
+    write_be32(rr + 20, TEST_RR_JITTER);
+    /* LSR 取 SR 中 NTP 的中间 32 位，收到后立即回复，DLSR 为 0。 */
+    write_be32(rr + 24, (read_be32(sr + 8) << 16) | (read_be32(sr + 12) >> 16));
+    client->rr_sent++;
+    return 32;
+}
+
+static void *test_client_main(void *arg) {
+    TestClient *client = (TestClient *)arg;
+    char url[128];
+    char sdp[TEST_REPLY_MAX];
+    char reply[TEST_REPLY_MAX];
+    uint8_t *datagram = (uint8_t *)malloc(2048);
+    int rtp_fd = -1;
+    int rtcp_fd = -1;
+    int rtp_port = 0;
+    Conn conn;
+
+    client->first_index = -1;
+    client->scratch = (uint8_t *)malloc(TEST_MAX_FRAME);
+    snprintf(url, sizeof(url), "rtsp://" TEST_USER ":" TEST_PASSWORD "@127.0.0.1:%d/" TEST_SESSION, client->port);
+    if (!datagram || !client->scratch || depack_init(&client->depack) != 0 || conn_open(&conn, url, 0) != 0) {
+        client->ready = 1;
+        free(datagram);
+        return NULL;
+    }
+    if (client->use_udp) {
+        rtp_port = udp_bind_pair(&rtp_fd, &rtcp_fd);
+    }
+    if (client->throttle_bytes_per_sec > 0) {
+        int rcvbuf = TEST_SLOW_RCVBUF;
+        setsockopt(conn.fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    client->play_ok = (!client->use_udp || rtp_port > 0) &&
+                      conn_play(&conn, client->use_udp, client->multicast, rtp_port, sdp, sizeof(sdp)) == 0;
+    client->auth_ok = conn.nonce[0] != '\0';
+    client->sdp_ok = strstr(sdp, "a=rtpmap:96 H264/90000") && strstr(sdp, "packetization-mode=1") &&
+                     strstr(sdp, "sprop-parameter-sets=");
+    if (client->multicast) {
+        /* 组播 socket 由主线程提前加入组并负责关闭。 */
+        rtp_fd = client->multicast_fd;
+        client->sdp_ok = client->sdp_ok && strstr(sdp, "c=IN IP4 " TEST_MULTICAST_GROUP "/1\r\n") &&
+                         strstr(conn.transport, "multicast;destination=" TEST_MULTICAST_GROUP ";");
+    }
+    client->ready = 1;
+
+    /* 收到最后一帧即结束，g_stop_clients 只作为超时兜底。 */
+    while (client->play_ok && !g_stop_clients && !(client->frames > 0 && client->last_index == TEST_FRAMES - 1)) {
+        if (client->use_udp || client->multicast) {
+            ssize_t n = recv(rtp_fd, datagram, 2048, 0);
+            struct sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            uint8_t rr[32];
+            if (n > 0) {
+                client->bytes += (uint64_t)n;
+                if (depack_packet(&client->depack, datagram, (size_t)n)) on_frame(client);
+            }
+            /* SR 来自服务端 RTCP 端口，RR 原路回去。 */
+            n = rtcp_fd >= 0 ? recvfrom(rtcp_fd, datagram, 2048, MSG_DONTWAIT, (struct sockaddr *)&from, &from_len) : -1;
+            if (n > 0 && make_receiver_report(client, datagram, (size_t)n, rr) > 0) {
+                sendto(rtcp_fd, rr, sizeof(rr), 0, (struct sockaddr *)&from, from_len);
+            }
+            continue;
+        }
+        while (conn.len >= 4 && conn.buf[0] == '$') {
+            size_t block = 4 + (((size_t)conn.buf[2] << 8) | conn.buf[3]);
+            if (conn.len < block) break;
+            if (conn.buf[1] == 0) {
+                client->bytes += block;
+                if (depack_packet(&client->depack, conn.buf + 4, block - 4)) on_frame(client);
+            } else if (conn.buf[1] == 1) {
+                uint8_t rr[4 + 32];
+                if (make_receiver_report(client, conn.buf + 4, block - 4, rr + 4) > 0) {
+                    rr[0] = '$';
+                    rr[1] = 1;
+                    rr[2] = 0;
+                    rr[3] = 32;
+                    send(conn.fd, rr, sizeof(rr), MSG_NOSIGNAL);
+                }
+            }
+            conn_consume(&conn, block);
+        }
+        if (conn.len > 0 && conn.buf[0] != '$') {
+            client->bad++;
+            break;
+        }
+        {
+            int n = conn_fill(&conn);
+            if (n < 0) break;
+            if (n > 0 && client->throttle_bytes_per_sec > 0) {
+                usleep((useconds_t)((uint64_t)n * 1000000ULL / (uint64_t)client->throttle_bytes_per_sec));
+            }
+        }
+    }
+    client->seq_gaps = client->depack.seq_gaps;
+    client->bad += client->depack.bad;
+    if (client->play_ok) {
+        client->teardown_ok = conn_request(&conn, "TEARDOWN", conn.url, NULL, reply, sizeof(reply)) == 200;
+    }
+    conn_close(&conn);
+    if (rtp_fd >= 0 && !client->multicast) close(rtp_fd);
+    if (rtcp_fd >= 0) close(rtcp_fd);
+    depack_free(&client->depack);
+    free(client->scratch);
+    free(datagram);
+    client->done = 1;
+    return NULL;
+}
+
+static void on_client_event(void *opaque, const char *session_name, int connected, int clients, int need_keyframe) {
+    (void)opaque;
+    (void)session_name;
+    (void)clients;
+    pthread_mutex_lock(&g_event_lock);
+    if (connected) {
+        g_play_events++;
+        if (!need_keyframe) g_cached_play_events++;
+    } else {
+        g_close_events++;
+    }
+    pthread_mutex_unlock(&g_event_lock);
+}
+
+static int free_port() {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int port = -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+        getsockname(fd, (struct sockaddr *)&addr, &addr_len) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+    close(fd);
+    return port;
+}
+
+static int check_client(const char *mode, const char *group, int index, const TestClient *client, int first_index, int frames) {
+    int ok = client->play_ok && client->auth_ok && client->sdp_ok && client->teardown_ok &&
+             client->first_index == first_index && client->frames == frames &&
+             client->gaps == 0 && client->seq_gaps == 0 && client->bad == 0;
+    if (!ok || index == 0) {
+        printf("[RTSP_TEST] mode=%s %s client=%d play=%d auth=%d sdp=%d teardown=%d first=%d frames=%d gaps=%d seq_gaps=%d bad=%d bytes=%" PRIu64 " result=%s\n",
+               mode,
+               group,
+               index,
+               client->play_ok,
+               client->auth_ok,
+               client->sdp_ok,
+               client->teardown_ok,
+               client->first_index,
+               client->frames,
+               client->gaps,
+               client->seq_gaps,
+               client->bad,
+               client->bytes,
+               ok ? "PASS" : "FAIL");
+    }
+    return ok;
+}
+
+/* 单次请求并返回状态码，用于 404/401 检查。 */
+static int probe_status(int port, const char *path, const char *user, const char *password) {
+    char url[160];
+    char reply[TEST_REPLY_MAX];
+    Conn conn;
+    int status;
+    snprintf(url, sizeof(url), "rtsp://%s%s%s%s127.0.0.1:%d/%s",
+             user ? user : "", user ? ":" : "", password ? password : "", user ? "@" : "", port, path);
+    if (conn_open(&conn, url, 0) != 0) return -1;
+    status = conn_request(&conn, "DESCRIBE", conn.url, NULL, reply, sizeof(reply));
+    conn_close(&conn);
+    return status;
+}
+
+/*
+ * gop_cache_frames/gop_cache_age_ms 传给 rtsp_server_session_set_gop_cache；
+ * from_cache 表示预期客户端从缓存 IDR 起播（早到的从第 0 帧，中途接入的从接入前最近的关键帧）。
+ */
+static int run_functional_test(const char *mode, int gop_cache_frames, int gop_cache_age_ms, int from_cache) {
+    enum { EARLY = TEST_EARLY_TCP_CLIENTS + TEST_EARLY_UDP_CLIENTS };
+    TestClient early[EARLY];
+    TestClient late[TEST_LATE_CLIENTS];
+    pthread_t early_threads[EARLY];
+    pthread_t late_threads[TEST_LATE_CLIENTS];
+    RtspServerConfig config;
+    RtspServerStats stats;
+    RtspServerReceiverStats receivers;
+    RtspServer *server;
+    RtspServerSession *session;
+    uint8_t *frame = (uint8_t *)malloc(TEST_MAX_FRAME);
+    int port = free_port();
+    int late_first = from_cache ? (TEST_LATE_JOIN_FRAME / TEST_GOP) * TEST_GOP
+                                : ((TEST_LATE_JOIN_FRAME + TEST_GOP - 1) / TEST_GOP) * TEST_GOP;
+    int early_first = from_cache ? 0 : TEST_GOP;
+    int ok_early = 1;
+    int ok_late = 1;
+    int ok_shared = 1;
+    int ok_404;
+    int ok_401;
+    int ok_events;
+    int ok_rtcp;
+    int ok_rtcp_clients = 1;
+    int sr_received = 0;
+    int rr_sent = 0;
+    int udp_clients = 0;
+    int i;
+
+    memset(g_frame_sent_us, 0, sizeof(g_frame_sent_us));
+    if (!frame || port <= 0) {
+        fprintf(stderr, "[ERROR] rtsp test setup failed\n");
+        return -1;
+    }
+    memset(&config, 0, sizeof(config));
+    config.listen_ip = "127.0.0.1";
+    config.listen_port = port;
+    config.auth_enable = 1;
+    config.user = TEST_USER;
+    config.password = TEST_PASSWORD;
+    config.max_clients = EARLY + TEST_LATE_CLIENTS;
+    config.rtcp_interval_ms = TEST_RTCP_INTERVAL_MS;
+    server = rtsp_server_create(&config);
+    session = server ? rtsp_server_add_session(server, TEST_SESSION, on_client_event, NULL) : NULL;
+    memset(&receivers, 0, sizeof(receivers));
+    if (!session || rtsp_server_session_set_gop_cache(session, gop_cache_frames, gop_cache_age_ms) != 0) {
+        fprintf(stderr, "[ERROR] rtsp server start failed\n");
+        return -1;
+    }
+    g_stop_clients = 0;
+    g_play_events = 0;
+    g_close_events = 0;
+    g_cached_play_events = 0;
+
+    /* 没有客户端时的第 0 帧缓存 SPS/PPS，让 DESCRIBE 能带上 sprop；开 GOP 缓存时它也是早到客户端的起播帧。 */
+    send_frame(session, frame, 0, TEST_GOP, TEST_IDR_BYTES, TEST_P_BYTES, TEST_FRAME_DURATION_MS * 1000ULL);
+    ok_404 = probe_status(port, "missing", TEST_USER, TEST_PASSWORD) == 404;
+    ok_401 = probe_status(port, TEST_SESSION, TEST_USER, "wrong") == 401 && probe_status(port, TEST_SESSION, NULL, NULL) == 401;
+
+    /* 让第 0 帧的缓存时刻与早到客户端的 PLAY 拉开距离，超龄模式下结果才确定。 */
+    usleep(20000);
+    memset(early, 0, sizeof(early));
+    memset(late, 0, sizeof(late));
+    for (i = 0; i < EARLY; ++i) {
+        early[i].port = port;
+        early[i].use_udp = i >= TEST_EARLY_TCP_CLIENTS;
+        pthread_create(&early_threads[i], NULL, test_client_main, &early[i]);
+    }
+    for (i = 0; i < EARLY; ++i) {
+        while (!early[i].ready) usleep(1000);
+    }
+
+    for (i = 1; i < TEST_FRAMES; ++i) {
+        if (i == TEST_LATE_JOIN_FRAME) {
+            int j;
+            for (j = 0; j < TEST_LATE_CLIENTS; ++j) {
+                late[j].port = port;
+                late[j].use_udp = j & 1;
+                pthread_create(&late_threads[j], NULL, test_client_main, &late[j]);
+            }
+            for (j = 0; j < TEST_LATE_CLIENTS; ++j) {
+                while (!late[j].ready) usleep(1000);
+            }
+        }
+        if (i == TEST_FRAMES - 10) {
+            /* 所有客户端仍在播放时取接收统计，结束后 TEARDOWN 的客户端不再计入。 */
+            rtsp_server_session_get_receiver_stats(session, &receivers);
+        }
+        send_frame(session, frame, i, TEST_GOP, TEST_IDR_BYTES, TEST_P_BYTES, TEST_FRAME_DURATION_MS * 1000ULL);
+        usleep(TEST_FRAME_INTERVAL_US);
+    }
+    {
+        uint64_t deadline = now_us() + TEST_DRAIN_TIMEOUT_US;
+        int pending = 1;
+        while (pending && now_us() < deadline) {
+            pending = 0;
+            for (i = 0; i < EARLY; ++i) pending |= !early[i].done;
+            for (i = 0; i < TEST_LATE_CLIENTS; ++i) pending |= !late[i].done;
+            usleep(10000);
+        }
+    }
+    g_stop_clients = 1;
+    for (i = 0; i < EARLY; ++i) pthread_join(early_threads[i], NULL);
+    for (i = 0; i < TEST_LATE_CLIENTS; ++i) pthread_join(late_threads[i], NULL);
+    usleep(100000);
+
+    for (i = 0; i < EARLY; ++i) {
+        ok_early &= check_client(mode, early[i].use_udp ? "early_udp" : "early_tcp", i, &early[i], early_first, TEST_FRAMES - early_first);
+        ok_shared &= early[i].last_frame_seq == early[0].last_frame_seq;
+    }
+    for (i = 0; i < TEST_LATE_CLIENTS; ++i) {
+        ok_late &= check_client(mode, "late", i, &late[i], late_first, TEST_FRAMES - late_first);
+        ok_shared &= late[i].last_frame_seq == early[0].last_frame_seq;
+    }
+    for (i = 0; i < EARLY + TEST_LATE_CLIENTS; ++i) {
+        const TestClient *client = i < EARLY ? &early[i] : &late[i - EARLY];
+        sr_received += client->sr_received;
+        rr_sent += client->rr_sent;
+        udp_clients += client->use_udp;
+        ok_rtcp_clients &= client->sr_received > 0;
+    }
+    rtsp_server_get_stats(server, &stats);
+    /*
+     * UDP 的最后一个 RR 可能晚于 TCP 上的 TEARDOWN 到达，每个 UDP 客户端允许少计一个。
+     * RTT 含 SR 在 TCP 发送队列里的排队时间，sanitizer 构建下可达数百毫秒，只检查不是回绕出的异常值。
+     */
+    ok_rtcp = ok_rtcp_clients && receivers.receivers == EARLY + TEST_LATE_CLIENTS &&
+              receivers.max_loss_percent > 10.0 && receivers.max_loss_percent < 10.3 &&
+              receivers.max_jitter_ms > 4.9 && receivers.max_jitter_ms < 5.1 &&
+              receivers.max_rtt_ms >= 0 && receivers.max_rtt_ms < 5000 &&
+              stats.rtcp_sender_reports >= (uint64_t)sr_received &&
+              stats.rtcp_receiver_reports <= (uint64_t)rr_sent &&
+              stats.rtcp_receiver_reports + (uint64_t)udp_clients >= (uint64_t)rr_sent;
+    ok_events = g_play_events == EARLY + TEST_LATE_CLIENTS && g_close_events == g_play_events &&
+                g_cached_play_events == (from_cache ? g_play_events : 0) &&
+                rtsp_server_session_client_count(session) == 0 && stats.auth_failures >= 1;
+    printf("[RTSP_TEST] mode=%s shared_packetization last_seq=%u result=%s\n", mode, early[0].last_frame_seq, ok_shared ? "PASS" : "FAIL");
+    printf("[RTSP_TEST] mode=%s not_found result=%s\n", mode, ok_404 ? "PASS" : "FAIL");
+    printf("[RTSP_TEST] mode=%s unauthorized result=%s\n", mode, ok_401 ? "PASS" : "FAIL");
+    printf("[RTSP_TEST] mode=%s callbacks play=%d from_gop_cache=%d close=%d auth_failures=%" PRIu64 " result=%s\n",
+           mode, g_play_events, g_cached_play_events, g_close_events, stats.auth_failures, ok_events ? "PASS" : "FAIL");
+    printf("[RTSP_TEST] mode=%s rtcp sr_received=%d sr_sent=%" PRIu64 " rr_sent=%d rr_received=%" PRIu64 " receivers=%d max_loss=%.1f%% max_jitter_ms=%.1f max_rtt_ms=%d result=%s\n",
+           mode, sr_received, stats.rtcp_sender_reports, rr_sent, stats.rtcp_receiver_reports, receivers.receivers,
+           receivers.max_loss_percent, receivers.max_jitter_ms, receivers.max_rtt_ms, ok_rtcp ? "PASS" : "FAIL");
+    printf("[RTSP_TEST] mode=%s stats frames=%" PRIu64 " rtp_packets=%" PRIu64 " bytes_sent=%" PRIu64 " send_calls=%" PRIu64 " udp_drops=%" PRIu64 " slow_drops=%" PRIu64 "\n",
+           mode, stats.frames, stats.rtp_packets, stats.bytes_sent, stats.send_calls, stats.udp_drops, stats.slow_drops);
+
+    rtsp_server_destroy(server);
+    free(frame);
+    if (ok_early && ok_late && ok_shared && ok_404 && ok_401 && ok_events && ok_rtcp) {
+        printf("[RTSP_TEST] mode=%s result=PASS\n", mode);
+        return 0;
+    }
+    printf("[RTSP_TEST] mode=%s result=FAIL\n", mode);
+    return 1;
+}
+
+/* 在 loopback 上加入测试组播组，返回绑定到 group:port 的接收 socket。 */
+static int multicast_join(int port) {
+    struct sockaddr_in addr;
+    struct ip_mreq mreq;
+    struct timeval tv;
+    int rcvbuf = 4 * 1024 * 1024;
+    int reuse = 1;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    inet_pton(AF_INET, TEST_MULTICAST_GROUP, &addr.sin_addr);
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.imr_multiaddr = addr.sin_addr;
+    mreq.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+    tv.tv_sec = 0;
+    tv.tv_usec = 200000;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+        bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0) {
+        close(fd);
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+/*
+ * 组播客户端和一个 TCP 客户端同时从 GOP 缓存起播：组播组只由第一个组播 PLAY 触发缓存突发，
+ * 之后每帧向组发一份；组的 bytes_sent 必须等于每个组播客户端各自收到的字节数。
+ */
+static int run_multicast_test() {
+    enum { CLIENTS = TEST_MULTICAST_CLIENTS + 1 };
+    const char *mode = "multicast";
+    TestClient clients[CLIENTS];
+    pthread_t threads[CLIENTS];
+    RtspServerConfig config;
+    RtspServerMulticastConfig multicast;
+    RtspServerMulticastStats group;
+    RtspServer *server;
+    RtspServerSession *session;
+    uint8_t *frame = (uint8_t *)malloc(TEST_MAX_FRAME);
+    int port = free_port();
+    int group_port = free_port() & ~1;
+    int ok_clients = 1;
+    int ok_single_copy = 1;
+    int ok_group;
+    int ok_events;
+    int i;
+
+    if (!frame || port <= 0 || group_port <= 0) {
+        fprintf(stderr, "[ERROR] rtsp multicast test setup failed\n");
+        free(frame);
+        return -1;
+    }
+    memset(&config, 0, sizeof(config));
+    config.listen_ip = "127.0.0.1";
+    config.listen_port = port;
+    config.auth_enable = 1;
+    config.user = TEST_USER;
+    config.password = TEST_PASSWORD;
+    config.max_clients = CLIENTS;
+    memset(&multicast, 0, sizeof(multicast));
+    multicast.group = TEST_MULTICAST_GROUP;
+    multicast.port = group_port;
+    multicast.ttl = 1;
+    multicast.interface_ip = "127.0.0.1";
+    server = rtsp_server_create(&config);
+    session = server ? rtsp_server_add_session(server, TEST_SESSION, on_client_event, NULL) : NULL;
+    if (!session || rtsp_server_session_set_gop_cache(session, TEST_GOP * 2, 60000) != 0 ||
+        rtsp_server_session_set_multicast(session, &multicast) != 0) {
+        fprintf(stderr, "[ERROR] rtsp multicast server start failed\n");
+        rtsp_server_destroy(server);
+        free(frame);
+        return -1;
+    }
+    g_stop_clients = 0;
+    g_play_events = 0;
+    g_close_events = 0;
+    g_cached_play_events = 0;
+
+    send_frame(session, frame, 0, TEST_GOP, TEST_IDR_BYTES, TEST_P_BYTES, TEST_FRAME_DURATION_MS * 1000ULL);
+    memset(clients, 0, sizeof(clients));
+    for (i = 0; i < CLIENTS; ++i) {
+        clients[i].port = port;
+        clients[i].multicast = i < TEST_MULTICAST_CLIENTS;
+        clients[i].multicast_fd = clients[i].multicast ? multicast_join(group_port) : -1;
+        if (clients[i].multicast && clients[i].multicast_fd < 0) {
+            fprintf(stderr, "[ERROR] rtsp multicast join failed errno=%d\n", errno);
+        }
+    }
+    for (i = 0; i < CLIENTS; ++i) {
+        pthread_create(&threads[i], NULL, test_client_main, &clients[i]);
+        while (!clients[i].ready) usleep(1000);
+    }
+    for (i = 1; i < TEST_FRAMES; ++i) {
+        send_frame(session, frame, i, TEST_GOP, TEST_IDR_BYTES, TEST_P_BYTES, TEST_FRAME_DURATION_MS * 1000ULL);
+        usleep(TEST_FRAME_INTERVAL_US);
+    }
+    {
+        uint64_t deadline = now_us() + TEST_DRAIN_TIMEOUT_US;
+        int pending = 1;
+        while (pending && now_us() < deadline) {
+            pending = 0;
+            for (i = 0; i < CLIENTS; ++i) pending |= !clients[i].done;
+            usleep(10000);
+        }
+    }
+    g_stop_clients = 1;
+    for (i = 0; i < CLIENTS; ++i) pthread_join(threads[i], NULL);
+    usleep(100000);
+
+    for (i = 0; i < CLIENTS; ++i) {
+        ok_clients &= check_client(mode, clients[i].multicast ? "group" : "tcp", i, &clients[i], 0, TEST_FRAMES);
+    }
+    memset(&group, 0, sizeof(group));
+    ok_group = rtsp_server_session_get_multicast_stats(session, &group) == 0 &&
+               group.frames == TEST_FRAMES && group.clients == 0 && group.send_drops == 0;
+    for (i = 0; i < TEST_MULTICAST_CLIENTS; ++i) {
+        ok_single_copy &= clients[i].bytes == group.bytes_sent;
+    }
+    /* 第一个组播观众和 TCP 观众从缓存起播，后加入组的观众不再触发突发。 */
+    ok_events = g_play_events == CLIENTS && g_close_events == CLIENTS && g_cached_play_events == 2 &&
+                rtsp_server_session_client_count(session) == 0;
+    printf("[RTSP_TEST] mode=%s group=%s:%d frames=%" PRIu64 " rtp_packets=%" PRIu64 " bytes_sent=%" PRIu64 " send_drops=%" PRIu64 " result=%s\n",
+           mode, TEST_MULTICAST_GROUP, group_port, group.frames, group.rtp_packets, group.bytes_sent, group.send_drops,
+           ok_group ? "PASS" : "FAIL");
+    printf("[RTSP_TEST] mode=%s single_copy viewers=%d client_bytes=%" PRIu64 " result=%s\n",
+           mode, TEST_MULTICAST_CLIENTS, clients[0].bytes, ok_single_copy ? "PASS" : "FAIL");
+    printf("[RTSP_TEST] mode=%s callbacks play=%d from_gop_cache=%d close=%d result=%s\n",
+           mode, g_play_events, g_cached_play_events, g_close_events, ok_events ? "PASS" : "FAIL");
+
+    rtsp_server_destroy(server);
+    for (i = 0; i < TEST_MULTICAST_CLIENTS; ++i) {
+        if (clients[i].multicast_fd >= 0) close(clients[i].multicast_fd);
+    }
+    free(frame);
+    if (ok_clients && ok_group && ok_single_copy && ok_events) {
+        printf("[RTSP_TEST] mode=%s result=PASS\n", mode);
+        return 0;
+    }
+    printf("[RTSP_TEST] mode=%s result=FAIL\n", mode);
+    return 1;
+}
+
+/* 压测客户端：只统计收到的字节和包数，不做校验，尽量少占用负载进程 CPU。 */
+static void *load_client_main(void *arg) {
+    LoadClient *client = (LoadClient *)arg;
+    uint8_t *datagram = (uint8_t *)malloc(2048);
+    uint64_t deadline;
+    int rtp_fd = -1;
+    int rtcp_fd = -1;
+    int rtp_port = 0;
+    Conn conn;
+
+    if (!datagram || conn_open(&conn, client->url, 3000) != 0) {
+        free(datagram);
+        return NULL;
+    }
+    if (client->use_udp) rtp_port = udp_bind_pair(&rtp_fd, &rtcp_fd);
+    client->ok = (!client->use_udp || rtp_port > 0) && conn_play(&conn, client->use_udp, 0, rtp_port, NULL, 0) == 0;
+    deadline = now_us() + (uint64_t)client->seconds * 1000000ULL;
+    while (client->ok && now_us() < deadline) {
+        if (client->use_udp) {
+            ssize_t n = recv(rtp_fd, datagram, 2048, 0);
+            if (n > 0) {
+                client->bytes += (uint64_t)n;
+                client->packets++;
+            }
+            continue;
+        }
+        conn.len = 0;
+        if (conn_fill(&conn) < 0) {
+            client->ok = 0;
+            break;
+        }
+        client->bytes += conn.len;
+    }
+    conn_close(&conn);
+    if (rtp_fd >= 0) close(rtp_fd);
+    if (rtcp_fd >= 0) close(rtcp_fd);
+    free(datagram);
+    return NULL;
+}
+
+static int run_load(const char *url, int clients, int seconds, int use_udp, uint64_t *total_bytes) {
+    LoadClient *load = (LoadClient *)calloc((size_t)clients, sizeof(LoadClient));
+    pthread_t *threads = (pthread_t *)calloc((size_t)clients, sizeof(pthread_t));
+    int ok = 0;
+    int i;
+
+    if (!load || !threads) return -1;
+    *total_bytes = 0;
+    for (i = 0; i < clients; ++i) {
+        load[i].url = url;
+        load[i].use_udp = use_udp;
+        load[i].seconds = seconds;
+        pthread_create(&threads[i], NULL, load_client_main, &load[i]);
+    }
+    for (i = 0; i < clients; ++i) {
+        pthread_join(threads[i], NULL);
+        ok += load[i].ok;
+        *total_bytes += load[i].bytes;
+    }
+    free(load);
+    free(threads);
+    return ok;
+}
+
+static double process_cpu_seconds(pid_t pid) {
+    char path[64];
+    char line[1024];
+    unsigned long utime = 0;
+    unsigned long stime = 0;
+    const char *p;
+    FILE *fp;
+
+    if (pid == 0) {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+               (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+    }
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    fp = fopen(path, "r");
+    if (!fp) return -1.0;
+    if (!fgets(line, sizeof(line), fp)) line[0] = '\0';
+    fclose(fp);
+    /* comm 字段可能含空格，从最后一个 ')' 之后按字段数取 utime/stime。 */
+    p = strrchr(line, ')');
+    if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) return -1.0;
+    return (double)(utime + stime) / (double)sysconf(_SC_CLK_TCK);
+}
+
+static void print_bench(const char *mode, int clients, int playing, int seconds, int use_udp, double cpu_sec,
+                        uint64_t bytes) {
+    double cpu_pct = cpu_sec >= 0 ? cpu_sec * 100.0 / seconds : -1.0;
+    double per_core = (cpu_sec > 0) ? playing / (cpu_sec / seconds) : -1.0;
+    printf("[RTSP_BENCH] mode=%s transport=%s clients=%d playing=%d seconds=%d cpu_pct=%.1f clients_per_core=%.0f mbps_per_client=%.2f\n",
+           mode,
+           use_udp ? "udp" : "tcp",
+           clients,
+           playing,
+           seconds,
+           cpu_pct,
+           per_core,
+           playing > 0 ? (double)bytes * 8.0 / 1e6 / seconds / playing : 0.0);
+}
+
+/* 服务与推流在本进程，拉流负载在子进程，CPU 只统计本进程（打包 + 服务线程）。 */
+static int run_bench(int clients, int seconds, int use_udp) {
+    RtspServerConfig config;
+    RtspServerStats stats;
+    RtspServer *server;
+    RtspServerSession *session;
+    uint8_t *frame = (uint8_t *)malloc(TEST_MAX_FRAME);
+    char url[128];
+    int port = free_port();
+    int status = 0;
+    double cpu_begin;
+    double cpu_sec;
+    uint64_t start;
+    uint64_t next;
+    pid_t child;
+    int warmup_frames = BENCH_GOP * 2;
+    int index = 0;
+
+    if (!frame || port <= 0) return -1;
+    snprintf(url, sizeof(url), "rtsp://127.0.0.1:%d/" TEST_SESSION, port);
+    child = fork();
+    if (child == 0) {
+        uint64_t bytes = 0;
+        int playing = run_load(url, clients, seconds + (int)(BENCH_WARMUP_TIMEOUT_US / 1000000ULL) + 1, use_udp, &bytes);
+        _exit(playing == clients ? 0 : 1);
+    }
+    memset(&config, 0, sizeof(config));
+    config.listen_ip = "127.0.0.1";
+    config.listen_port = port;
+    config.max_clients = clients;
+    server = rtsp_server_create(&config);
+    session = server ? rtsp_server_add_session(server, TEST_SESSION, NULL, NULL) : NULL;
+    if (!session || child < 0) {
+        fprintf(stderr, "[ERROR] rtsp bench start failed\n");
+        if (child > 0) kill(child, SIGKILL);
+        return -1;
+    }
+
+    /* 至少推两个 GOP 且客户端全部进入播放（或预热超时）后再开始计 CPU。 */
+    start = now_us();
+    next = start;
+    cpu_begin = -1.0;
+    while (1) {
+        uint64_t now = now_us();
+        if (cpu_begin < 0 && index >= warmup_frames) {
+            rtsp_server_get_stats(server, &stats);
+            if (stats.clients == clients || now - start >= BENCH_WARMUP_TIMEOUT_US) {
+                cpu_begin = process_cpu_seconds(0);
+                start = now;
+            }
+        }
+        if (cpu_begin >= 0 && now - start >= (uint64_t)seconds * 1000000ULL) break;
+        send_frame(session, frame, index, BENCH_GOP, BENCH_IDR_BYTES, BENCH_P_BYTES, BENCH_FRAME_INTERVAL_US);
+        index++;
+        next += BENCH_FRAME_INTERVAL_US;
+        if (next > now_us()) usleep((useconds_t)(next - now_us()));
+    }
+    cpu_sec = process_cpu_seconds(0) - cpu_begin;
+    rtsp_server_get_stats(server, &stats);
+    print_bench("bench", clients, stats.clients, seconds, use_udp, cpu_sec,
+                stats.bytes_sent);
+    printf("[RTSP_BENCH] frames=%" PRIu64 " rtp_packets=%" PRIu64 " send_calls=%" PRIu64 " udp_drops=%" PRIu64 " slow_drops=%" PRIu64 " inbox_drops=%" PRIu64 "\n",
+           stats.frames, stats.rtp_packets, stats.send_calls, stats.udp_drops, stats.slow_drops, stats.inbox_drops);
+    /* 负载进程只负责拉流，统计结束后直接结束它。 */
+    kill(child, SIGTERM);
+    waitpid(child, &status, 0);
+    rtsp_server_destroy(server);
+    free(frame);
+    return stats.clients == clients ? 0 : 1;
+}
+
+/* 对外部 RTSP 服务拉流；给定 pid 时统计该进程在拉流期间的 CPU。 */
+static int run_external(const char *url, int clients, int seconds, int use_udp, pid_t pid) {
+    double cpu_begin = pid > 0 ? process_cpu_seconds(pid) : -1.0;
+    uint64_t bytes = 0;
+    int playing = run_load(url, clients, seconds, use_udp, &bytes);
+    double cpu_sec = (pid > 0 && cpu_begin >= 0) ? process_cpu_seconds(pid) - cpu_begin : -1.0;
+    print_bench("url", clients, playing, seconds, use_udp, cpu_sec, bytes);
+    return playing == clients ? 0 : 1;
+}
+
+/*
+ * 正常 TCP/UDP 客户端和一个限速读取的 TCP 客户端同时播放，不开 GOP 缓存，所有客户端从第 10 帧起播。
+ * evict=0：关闭驱逐，慢客户端多次丢积压后仍在线，恢复点都是关键帧；
+ * evict=1：窗口内超限 3 次即断开，slow_drops 计 1。
+ * 两种情况下正常客户端都必须逐帧收齐，并打印它们的最大帧时延。
+ */
+static int run_slow_client_test(const char *mode, int evict) {
+    enum { NORMAL = TEST_EARLY_TCP_CLIENTS + TEST_EARLY_UDP_CLIENTS, CLIENTS = NORMAL + 1 };
+    TestClient clients[CLIENTS];
+    TestClient *slow = &clients[NORMAL];
+    pthread_t threads[CLIENTS];
+    RtspServerConfig config;
+    RtspServerStats stats;
+    RtspServerClientStats client_stats[RTSP_SERVER_CLIENT_STATS_MAX];
+    RtspServer *server;
+    RtspServerSession *session;
+    uint8_t *frame = (uint8_t *)malloc(TEST_MAX_FRAME);
+    uint64_t slow_drop_events = 0;
+    uint64_t slow_dropped = 0;
+    uint64_t max_delay_us = 0;
+    size_t slow_peak = 0;
+    int port = free_port();
+    int ok_normal = 1;
+    int ok_slow;
+    int count;
+    int i;
+
+    memset(g_frame_sent_us, 0, sizeof(g_frame_sent_us));
+    if (!frame || port <= 0) {
+        fprintf(stderr, "[ERROR] rtsp slow client test setup failed\n");
+        free(frame);
+        return -1;
+    }
+    memset(&config, 0, sizeof(config));
+    config.listen_ip = "127.0.0.1";
+    config.listen_port = port;
+    config.auth_enable = 1;
+    config.user = TEST_USER;
+    config.password = TEST_PASSWORD;
+    config.max_clients = CLIENTS;
+    config.client_budget_bytes = TEST_SLOW_BUDGET_BYTES;
+    config.slow_client_evict_drops = evict ? 3 : -1;
+    server = rtsp_server_create(&config);
+    session = server ? rtsp_server_add_session(server, TEST_SESSION, on_client_event, NULL) : NULL;
+    if (!session) {
+        fprintf(stderr, "[ERROR] rtsp slow client server start failed\n");
+        rtsp_server_destroy(server);
+        free(frame);
+        return -1;
+    }
+    g_stop_clients = 0;
+
+    send_frame(session, frame, 0, TEST_GOP, TEST_IDR_BYTES, TEST_P_BYTES, TEST_FRAME_DURATION_MS * 1000ULL);
+    memset(clients, 0, sizeof(clients));
+    for (i = 0; i < CLIENTS; ++i) {
+        clients[i].port = port;
+        clients[i].use_udp = i >= TEST_EARLY_TCP_CLIENTS && i < NORMAL;
+        clients[i].throttle_bytes_per_sec = i == NORMAL ? TEST_SLOW_RATE_BYTES : 0;
+        pthread_create(&threads[i], NULL, test_client_main, &clients[i]);
+    }
+    for (i = 0; i < CLIENTS; ++i) {
+        while (!clients[i].ready) usleep(1000);
+    }
+    for (i = 1; i < TEST_FRAMES; ++i) {
+        g_frame_sent_us[i] = now_us();
+        send_frame(session, frame, i, TEST_GOP, TEST_IDR_BYTES, TEST_P_BYTES, TEST_FRAME_DURATION_MS * 1000ULL);
+        usleep(TEST_FRAME_INTERVAL_US);
+    }
+    {
+        /*
+         * 正常客户端收完最后一帧后，再等慢客户端读完服务端队列和 socket 缓冲里剩下的数据：
+         * 它可能在最后一个 GOP 里丢帧而收不到最后一帧，所以以队列已空且 500ms 没有新数据为准。
+         */
+        uint64_t deadline = now_us() + TEST_DRAIN_TIMEOUT_US;
+        uint64_t last_bytes = 0;
+        uint64_t idle_since = now_us();
+        int pending = 1;
+        while (pending && now_us() < deadline) {
+            int slow_queued = 0;
+            pending = 0;
+            for (i = 0; i < NORMAL; ++i) pending |= !clients[i].done;
+            count = rtsp_server_session_get_client_stats(session, client_stats, RTSP_SERVER_CLIENT_STATS_MAX);
+            for (i = 0; i < count; ++i) {
+                if (client_stats[i].transport && client_stats[i].drop_events > 0) {
+                    slow_drop_events = client_stats[i].drop_events;
+                    slow_dropped = client_stats[i].dropped_frames;
+                    slow_peak = client_stats[i].peak_queue_bytes;
+                    slow_queued = client_stats[i].queue_frames > 0;
+                }
+            }
+            if (slow->bytes != last_bytes || slow_queued) {
+                last_bytes = slow->bytes;
+                idle_since = now_us();
+            }
+            pending |= !slow->done && now_us() - idle_since < 500000ULL;
+            usleep(10000);
+        }
+    }
+    g_stop_clients = 1;
+    for (i = 0; i < CLIENTS; ++i) pthread_join(threads[i], NULL);
+    usleep(100000);
+
+    for (i = 0; i < NORMAL; ++i) {
+        ok_normal &= check_client(mode, clients[i].use_udp ? "normal_udp" : "normal_tcp", i, &clients[i], TEST_GOP, TEST_FRAMES - TEST_GOP);
+        if (clients[i].max_delay_us > max_delay_us) max_delay_us = clients[i].max_delay_us;
+    }
+    rtsp_server_get_stats(server, &stats);
+    if (evict) {
+        ok_slow = slow->play_ok && !slow->teardown_ok && slow->misaligned == 0 && slow->bad == 0 &&
+                  stats.slow_drops == 1 && stats.queue_drops >= 3;
+    } else {
+        ok_slow = slow->play_ok && slow->teardown_ok && slow->misaligned == 0 && slow->bad == 0 &&
+                  slow->first_index == TEST_GOP && slow->gaps > 0 &&
+                  slow_drop_events >= 2 && slow_peak <= TEST_SLOW_BUDGET_BYTES && stats.slow_drops == 0;
+    }
+    printf("[RTSP_TEST] mode=%s slow_client frames=%d gaps=%d misaligned=%d connected=%d drop_events=%" PRIu64
+           " dropped_frames=%" PRIu64 " peak_queue_bytes=%zu queue_drops=%" PRIu64 " evicted=%" PRIu64 " result=%s\n",
+           mode, slow->frames, slow->gaps, slow->misaligned, slow->teardown_ok, slow_drop_events, slow_dropped, slow_peak,
+           stats.queue_drops, stats.slow_drops, ok_slow ? "PASS" : "FAIL");
+    printf("[RTSP_BENCH] mode=%s normal_clients=%d max_frame_delay_ms=%.1f\n", mode, NORMAL, (double)max_delay_us / 1000.0);
+
+    rtsp_server_destroy(server);
+    free(frame);
+    if (ok_normal && ok_slow) {
+        printf("[RTSP_TEST] mode=%s result=PASS\n", mode);
+        return 0;
+    }
+    printf("[RTSP_TEST] mode=%s result=FAIL\n", mode);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    signal(SIGPIPE, SIG_IGN);
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        int clients = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_CLIENTS;
+        int seconds = argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_SECONDS;
+        int use_udp = argc > 4 && strcmp(argv[4], "udp") == 0;
+        return run_bench(clients > 0 ? clients : BENCH_DEFAULT_CLIENTS, seconds > 0 ? seconds : BENCH_DEFAULT_SECONDS, use_udp);
+    }
+    if (argc >= 3 && strcmp(argv[1], "url") == 0) {
+        int clients = argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_CLIENTS;
+        int seconds = argc > 4 ? atoi(argv[4]) : BENCH_DEFAULT_SECONDS;
+        int use_udp = argc > 5 && strcmp(argv[5], "udp") == 0;
+        pid_t pid = argc > 6 ? (pid_t)atoi(argv[6]) : 0;
+        return run_external(argv[2], clients > 0 ? clients : BENCH_DEFAULT_CLIENTS, seconds > 0 ? seconds : BENCH_DEFAULT_SECONDS,
+                            use_udp, pid);
+    }
+    {
+        int failed = 0;
+        failed |= run_functional_test("wait_keyframe", 0, 0, 0) != 0;
+        failed |= run_functional_test("gop_cache", TEST_GOP * 2, 60000, 1) != 0;
+        /* 1ms 的期限下缓存 IDR 总是超龄，客户端应退回等下一个关键帧。 */
+        failed |= run_functional_test("gop_cache_expired", TEST_GOP * 2, 1, 0) != 0;
+        failed |= run_multicast_test() != 0;
+        failed |= run_slow_client_test("slow_client_drop", 0) != 0;
+        failed |= run_slow_client_test("slow_client_evict", 1) != 0;
+        printf("[RTSP_TEST] result=%s\n", failed ? "FAIL" : "PASS");
+        return failed;
+    }
+}
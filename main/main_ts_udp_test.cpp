@@ -0,0 +1,497 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+#include "tsMuxer.h"
+#include "tsUdpSink.h"
+}
+
+#define TEST_FRAMES 100
+#define TEST_GOP 10
+#define TEST_IDR_BYTES (60 * 1024)
+#define TEST_P_BYTES (12 * 1024)
+#define TEST_FRAME_DURATION_US 20000
+/* 低帧率一轮：2fps，帧间隔远超 PCR/PSI 间隔，PCR 和 PAT/PMT 要靠帧间补发。 */
+#define TEST_LOW_FPS_FRAMES 8
+#define TEST_LOW_FPS_FRAME_DURATION_US 500000
+#define TEST_MULTICAST_GROUP "239.255.42.42"
+#define TEST_MAX_FRAME (TEST_IDR_BYTES + 1024)
+/* PCR 与到达时间偏差的允许抖动：两个帧间隔，平滑发送会把大帧摊到帧间隔内。 */
+#define TEST_MAX_PCR_JITTER_US (2 * TEST_FRAME_DURATION_US)
+/* 相邻两个 PCR 的到达间隔上限，H.222 规定 100ms。 */
+#define TEST_MAX_PCR_GAP_US 100000
+/* 相邻两组 PAT/PMT 的到达间隔上限：100ms 间隔加时钟线程检查周期和调度的余量。 */
+#define TEST_MAX_PSI_GAP_US 150000
+#define TEST_SPS_LEN 20
+#define TEST_PPS_LEN 5
+
+/*
+ * MPEG-TS over UDP 输出的本地接收测试，分单播和组播（loopback 网卡）两轮：
+ *   - 每个数据报为整数个 188 字节 TS 包且不超过 7 个，同步字节正确；
+ *   - 各 PID 连续计数逐包递增，PAT/PMT 的 CRC32 和节目映射正确，每个关键帧前都有 PAT/PMT；
+ *   - 按 PES 重组每一帧，PTS 连续，负载与输入逐字节一致：缺 AUD 的帧补 AUD，
+ *     不带 SPS/PPS 的关键帧补上最近一次的参数集，关键帧首包置随机接入标志；
+ *   - 每帧首包带 PCR，PCR 与到达时间的偏差抖动不超过 TEST_MAX_PCR_JITTER_US；
+ *   - 低帧率（2fps）下帧间补发只带 PCR 的包（不带负载、连续计数不递增）和 PAT/PMT，
+ *     PCR 单调递增，相邻 PCR 间隔不超过 100ms，相邻 PAT/PMT 间隔不超过 TEST_MAX_PSI_GAP_US；
+ *   - 发送批量化：系统调用次数少于数据报数。
+ *
+ * 用法：ts_udp_test
+ */
+
+typedef struct {
+    int fd;
+    volatile int stop;
+    int expected_frames;
+    uint64_t frame_duration_90k;
+    uint64_t datagrams;
+    uint64_t packets;
+    int bad_datagrams;
+    int bad_sync;
+    int cc_errors;
+    int psi_ok;
+    int psi_errors;
+    int psi_since_frame;
+    int key_without_psi;
+    int frames;
+    int bad_frames;
+    int gaps;
+    int rai_errors;
+    int pcr_count;
+    int idle_pcr_count;
+    int pcr_backwards;
+    int64_t pcr_offset_min;
+    int64_t pcr_offset_max;
+    uint64_t last_pcr;
+    uint64_t last_pcr_arrival_us;
+    uint64_t max_pcr_gap_us;
+    uint64_t last_psi_arrival_us;
+    uint64_t max_psi_gap_us;
+    int last_index;
+    int cc[0x2000];
+    uint8_t *pes;
+    size_t pes_len;
+    int pes_rai;
+    uint8_t *scratch;
+} Receiver;
+
+static size_t append_nalu(uint8_t *dst, uint8_t header, size_t len, uint32_t seed) {
+    size_t i;
+    dst[0] = 0;
+    dst[1] = 0;
+    dst[2] = 0;
+    dst[3] = 1;
+    dst[4] = header;
+    for (i = 1; i < len; ++i) {
+        seed = seed * 1103515245U + 12345U;
+        /* 负载不含 0x00，避免伪起始码。 */
+        dst[4 + i] = (uint8_t)(0x10 + ((seed >> 16) % 0xF0));
+    }
+    return 4 + len;
+}
+
+static int frame_is_key(int index) {
+    return (index % TEST_GOP) == 0;
+}
+
+/* 每 3 帧有一帧不带 AUD；每隔一个关键帧不带 SPS/PPS，由封装器补。 */
+static int frame_has_aud(int index) {
+    return (index % 3) != 0;
+}
+
+static int frame_has_params(int index) {
+    return (index % (TEST_GOP * 2)) == 0;
+}
+
+/* 帧内容只由帧号决定。expected 为 1 时生成封装后 PES 里应有的字节（补上 AUD 和参数集）。 */
+static size_t make_frame(uint8_t *dst, int index, int expected) {
+    size_t len = 0;
+    int key = frame_is_key(index);
+    if (frame_has_aud(index)) {
+        len += append_nalu(dst + len, 0x09, 2, (uint32_t)index + 100);
+    } else if (expected) {
+        static const uint8_t aud[6] = {0x00, 0x00, 0x00, 0x01, 0x09, 0xF0};
+        memcpy(dst + len, aud, sizeof(aud));
+        len += sizeof(aud);
+    }
+    if (key && (frame_has_params(index) || expected)) {
+        len += append_nalu(dst + len, 0x67, TEST_SPS_LEN, 7);
+        len += append_nalu(dst + len, 0x68, TEST_PPS_LEN, 8);
+    }
+    if (key) {
+        len += append_nalu(dst + len, 0x65, TEST_IDR_BYTES, (uint32_t)index);
+    } else {
+        len += append_nalu(dst + len, 0x41, TEST_P_BYTES, (uint32_t)index);
+    }
+    return len;
+}
+
+static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t read_timestamp(const uint8_t *p) {
+    return ((uint64_t)((p[0] >> 1) & 0x07) << 30) | ((uint64_t)p[1] << 22) | ((uint64_t)(p[2] >> 1) << 15) |
+           ((uint64_t)p[3] << 7) | (uint64_t)(p[4] >> 1);
+}
+
+/* 校验 PAT/PMT：CRC 正确，PAT 指向 PMT PID，PMT 里视频流为 H264。 */
+static int check_section(const uint8_t *payload, size_t len, uint16_t pid) {
+    const uint8_t *section;
+    size_t section_len;
+    if (len < 1 || payload[0] + 1U + 3U > len) return 0;
+    section = payload + 1 + payload[0];
+    section_len = 3 + (((size_t)(section[1] & 0x0F) << 8) | section[2]);
+    if (section_len < 8 || section + section_len > payload + len) return 0;
+    if (ts_crc32(section, section_len - 4) != read_be32(section + section_len - 4)) return 0;
+    if (pid == TS_PID_PAT) {
+        return section[0] == 0x00 && (((section[10] & 0x1F) << 8) | section[11]) == TS_PID_PMT;
+    }
+    return section[0] == 0x02 && section[12] == TS_STREAM_TYPE_H264 &&
+           (((section[13] & 0x1F) << 8) | section[14]) == TS_PID_VIDEO;
+}
+
+/* 一个 PES 收齐后解析时间戳并与期望帧逐字节比对。 */
+static void finish_pes(Receiver *rx) {
+    uint64_t pts;
+    size_t header_len;
+    size_t expected_len;
+    int index;
+
+    if (rx->pes_len == 0) return;
+    rx->frames++;
+    if (rx->pes_len < 14 || rx->pes[0] != 0 || rx->pes[1] != 0 || rx->pes[2] != 1 || rx->pes[3] != 0xE0 ||
+        (rx->pes[7] & 0x80) == 0) {
+        rx->bad_frames++;
+        rx->pes_len = 0;
+        return;
+    }
+    header_len = 9 + rx->pes[8];
+    pts = read_timestamp(rx->pes + 9);
+    index = (int)((pts - TS_PCR_DELAY_90K) / rx->frame_duration_90k);
+    if ((pts - TS_PCR_DELAY_90K) % rx->frame_duration_90k != 0 || index < 0 || index >= rx->expected_frames) {
+        rx->bad_frames++;
+        rx->pes_len = 0;
+        return;
+    }
+    if (index != rx->last_index + 1) rx->gaps++;
+    rx->last_index = index;
+    if (rx->pes_rai != frame_is_key(index)) rx->rai_errors++;
+    expected_len = make_frame(rx->scratch, index, 1);
+    if (rx->pes_len - header_len != expected_len ||
+        memcmp(rx->pes + header_len, rx->scratch, expected_len) != 0) {
+        rx->bad_frames++;
+    }
+    rx->pes_len = 0;
+}
+
+static void handle_packet(Receiver *rx, const uint8_t *p, uint64_t arrival_us) {
+    uint16_t pid = (uint16_t)(((p[1] & 0x1F) << 8) | p[2]);
+    int pusi = (p[1] & 0x40) != 0;
+    int afc = (p[3] >> 4) & 0x03;
+    size_t offset = 4;
+
+    rx->packets++;
+    if (p[0] != 0x47) {
+        rx->bad_sync++;
+        return;
+    }
+    if (pid == TS_PID_VIDEO && pusi) {
+        finish_pes(rx);
+        rx->pes_rai = 0;
+    }
+    if (afc & 0x01) {
+        if (rx->cc[pid] >= 0 && (p[3] & 0x0F) != ((rx->cc[pid] + 1) & 0x0F)) rx->cc_errors++;
+        rx->cc[pid] = p[3] & 0x0F;
+    } else if (rx->cc[pid] >= 0 && (p[3] & 0x0F) != rx->cc[pid]) {
+        /* 不带负载的包连续计数保持不变。 */
+        rx->cc_errors++;
+    }
+    if (afc & 0x02) {
+        size_t af_len = p[4];
+        if (pid == TS_PID_VIDEO && af_len >= 1 && (p[5] & 0x10)) {
+            uint64_t pcr = ((uint64_t)p[6] << 25) | ((uint64_t)p[7] << 17) | ((uint64_t)p[8] << 9) |
+                           ((uint64_t)p[9] << 1) | (uint64_t)(p[10] >> 7);
+            int64_t offset_us = (int64_t)arrival_us - (int64_t)(pcr * 100 / 9);
+            int seen = rx->pcr_count + rx->idle_pcr_count;
+            if (seen == 0 || offset_us < rx->pcr_offset_min) rx->pcr_offset_min = offset_us;
+            if (seen == 0 || offset_us > rx->pcr_offset_max) rx->pcr_offset_max = offset_us;
+            if (seen > 0) {
+                if (pcr < rx->last_pcr) rx->pcr_backwards++;
+                if (arrival_us - rx->last_pcr_arrival_us > rx->max_pcr_gap_us) {
+                    rx->max_pcr_gap_us = arrival_us - rx->last_pcr_arrival_us;
+                }
+            }
+            rx->last_pcr = pcr;
+            rx->last_pcr_arrival_us = arrival_us;
+            if (pusi) {
+                rx->pcr_count++;
+            } else {
+                rx->idle_pcr_count++;
+            }
+        }
+        if (pid == TS_PID_VIDEO && pusi && af_len >= 1) {
+            int rai = (p[5] & 0x40) != 0;
+            if (rai && !rx->psi_since_frame) rx->key_without_psi++;
+            rx->pes_rai = rai;
+        }
+        offset += 1 + af_len;
+    }
+    if (offset > TS_PACKET_SIZE) {
+        rx->bad_frames++;
+        return;
+    }
+    if (pid == TS_PID_PAT || pid == TS_PID_PMT) {
+        if (check_section(p + offset, TS_PACKET_SIZE - offset, pid)) {
+            rx->psi_ok++;
+            if (pid == TS_PID_PMT) {
+                rx->psi_since_frame = 1;
+                if (rx->last_psi_arrival_us > 0 && arrival_us - rx->last_psi_arrival_us > rx->max_psi_gap_us) {
+                    rx->max_psi_gap_us = arrival_us - rx->last_psi_arrival_us;
+                }
+                rx->last_psi_arrival_us = arrival_us;
+            }
+        } else {
+            rx->psi_errors++;
+        }
+        return;
+    }
+    if (pid != TS_PID_VIDEO || !(afc & 0x01)) return;
+    if (pusi) rx->psi_since_frame = 0;
+    if (rx->pes_len + (TS_PACKET_SIZE - offset) > TEST_MAX_FRAME + 64) {
+        rx->bad_frames++;
+        rx->pes_len = 0;
+        return;
+    }
+    memcpy(rx->pes + rx->pes_len, p + offset, TS_PACKET_SIZE - offset);
+    rx->pes_len += TS_PACKET_SIZE - offset;
+}
+
+static void *receiver_main(void *arg) {
+    Receiver *rx = (Receiver *)arg;
+    uint8_t datagram[2048];
+
+    for (;;) {
+        struct pollfd pfd;
+        ssize_t n;
+        uint64_t arrival_us;
+        size_t i;
+
+        pfd.fd = rx->fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 100) <= 0) {
+            if (rx->stop) break;
+            continue;
+        }
+        n = recv(rx->fd, datagram, sizeof(datagram), 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            break;
+        }
+        arrival_us = now_us();
+        rx->datagrams++;
+        if ((size_t)n % TS_PACKET_SIZE != 0 || (size_t)n > TS_PACKET_SIZE * TS_PACKETS_PER_DATAGRAM) {
+            rx->bad_datagrams++;
+            continue;
+        }
+        for (i = 0; i < (size_t)n; i += TS_PACKET_SIZE) {
+            handle_packet(rx, datagram + i, arrival_us);
+        }
+    }
+    finish_pes(rx);
+    return NULL;
+}
+
+static int open_receiver(int multicast, int *port) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int rcvbuf = 4 * 1024 * 1024;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(multicast ? INADDR_ANY : INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (multicast) {
+        struct ip_mreq mreq;
+        inet_pton(AF_INET, TEST_MULTICAST_GROUP, &mreq.imr_multiaddr);
+        mreq.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+        if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0) {
+            fprintf(stderr, "[ERROR] IP_ADD_MEMBERSHIP failed errno=%d(%s)\n", errno, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static int enqueue_frame(MediaSink *sink, uint8_t *frame, int index, uint64_t frame_duration_us) {
+    MediaPacket packet;
+    MediaBuffer *buffer = NULL;
+    size_t len = make_frame(frame, index, 0);
+    int ret;
+    if (media_buffer_create_copy(frame, len, &buffer) != 0) return -1;
+    media_packet_init(&packet);
+    packet.frame_type = MEDIA_FRAME_TYPE_VIDEO;
+    packet.codec = MEDIA_CODEC_H264;
+    packet.buffer = buffer;
+    packet.frame_id = (uint64_t)index;
+    packet.pts_us = (uint64_t)index * frame_duration_us;
+    packet.dts_us = packet.pts_us;
+    packet.is_key_frame = frame_is_key(index);
+    ret = media_sink_enqueue(sink, &packet);
+    media_buffer_release(buffer);
+    return ret;
+}
+
+static int run_case(const char *mode, int multicast, int gso, int pacing, int frames, uint64_t frame_duration_us) {
+    Receiver rx;
+    pthread_t thread;
+    MediaSink sink;
+    TsUdpSinkConfig config;
+    TsUdpSinkStats stats;
+    void *impl;
+    uint8_t *frame = (uint8_t *)malloc(TEST_MAX_FRAME);
+    int64_t jitter_us;
+    uint64_t start_us;
+    int port = 0;
+    int ok_stream;
+    int ok_psi;
+    int ok_pcr;
+    int ok_batch;
+    int i;
+
+    memset(&rx, 0, sizeof(rx));
+    memset(rx.cc, 0xFF, sizeof(rx.cc));
+    rx.last_index = -1;
+    rx.expected_frames = frames;
+    rx.frame_duration_90k = frame_duration_us * 9 / 100;
+    rx.pes = (uint8_t *)malloc(TEST_MAX_FRAME + 64);
+    rx.scratch = (uint8_t *)malloc(TEST_MAX_FRAME);
+    rx.fd = open_receiver(multicast, &port);
+    if (!frame || !rx.pes || !rx.scratch || rx.fd < 0) {
+        fprintf(stderr, "[ERROR] ts udp test setup failed mode=%s\n", mode);
+        return 0;
+    }
+    pthread_create(&thread, NULL, receiver_main, &rx);
+
+    memset(&config, 0, sizeof(config));
+    config.name = mode;
+    config.dest_ip = multicast ? TEST_MULTICAST_GROUP : "127.0.0.1";
+    config.dest_port = port;
+    config.multicast_ttl = 1;
+    config.multicast_interface = "127.0.0.1";
+    config.queue_capacity = 64;
+    config.gso = gso;
+    config.pacing = pacing;
+    config.video_fps = (int)(1000000 / frame_duration_us);
+    config.video_bitrate = (TEST_IDR_BYTES + (TEST_GOP - 1) * TEST_P_BYTES) * 8 * config.video_fps / TEST_GOP;
+    if (ts_udp_sink_setup(&sink, &config) != 0 || media_sink_start(&sink) != 0) {
+        fprintf(stderr, "[ERROR] ts udp sink start failed mode=%s\n", mode);
+        return 0;
+    }
+
+    start_us = now_us();
+    for (i = 0; i < frames; ++i) {
+        uint64_t due_us = start_us + (uint64_t)i * frame_duration_us;
+        uint64_t now = now_us();
+        if (due_us > now) usleep((useconds_t)(due_us - now));
+        /* 中途模拟 ABR 降码率：平滑速率随之更新，流仍须完整。 */
+        if (pacing && i == frames / 2) ts_udp_sink_update_rate(&sink, config.video_bitrate / 2, config.video_fps);
+        enqueue_frame(&sink, frame, i, frame_duration_us);
+    }
+    usleep(300000);
+    ts_udp_sink_get_stats(&sink, &stats);
+    media_sink_stop(&sink);
+    impl = sink.impl;
+    media_sink_deinit(&sink);
+    free(impl);
+    rx.stop = 1;
+    pthread_join(thread, NULL);
+    close(rx.fd);
+
+    jitter_us = rx.pcr_offset_max - rx.pcr_offset_min;
+    ok_stream = rx.frames == frames && rx.bad_frames == 0 && rx.gaps == 0 && rx.rai_errors == 0 &&
+                rx.cc_errors == 0 && rx.bad_sync == 0 && rx.bad_datagrams == 0;
+    ok_psi = rx.psi_ok > 0 && rx.psi_errors == 0 && rx.key_without_psi == 0 && rx.max_psi_gap_us <= TEST_MAX_PSI_GAP_US;
+    ok_pcr = rx.pcr_count == frames && jitter_us <= TEST_MAX_PCR_JITTER_US && rx.pcr_backwards == 0 &&
+             rx.max_pcr_gap_us <= TEST_MAX_PCR_GAP_US;
+    ok_batch = stats.datagrams == rx.datagrams && stats.ts_packets == rx.packets && stats.send_errors == 0 &&
+               stats.syscalls < stats.datagrams;
+    printf("[TS_UDP_TEST] mode=%s frames=%d bad=%d gaps=%d rai_errors=%d cc_errors=%d bad_datagrams=%d result=%s\n",
+           mode,
+           rx.frames,
+           rx.bad_frames,
+           rx.gaps,
+           rx.rai_errors,
+           rx.cc_errors,
+           rx.bad_datagrams,
+           ok_stream ? "PASS" : "FAIL");
+    printf("[TS_UDP_TEST] mode=%s psi_ok=%d psi_errors=%d key_without_psi=%d max_psi_gap_us=%" PRIu64
+           " result=%s\n",
+           mode,
+           rx.psi_ok,
+           rx.psi_errors,
+           rx.key_without_psi,
+           rx.max_psi_gap_us,
+           ok_psi ? "PASS" : "FAIL");
+    printf("[TS_UDP_TEST] mode=%s pcr=%d idle_pcr=%d backwards=%d max_pcr_gap_us=%" PRIu64 " pcr_jitter_us=%" PRId64
+           " limit_us=%d result=%s\n",
+           mode,
+           rx.pcr_count,
+           rx.idle_pcr_count,
+           rx.pcr_backwards,
+           rx.max_pcr_gap_us,
+           jitter_us,
+           TEST_MAX_PCR_JITTER_US,
+           ok_pcr ? "PASS" : "FAIL");
+    printf("[TS_UDP_TEST] mode=%s ts_packets=%" PRIu64 " datagrams=%" PRIu64 " received=%" PRIu64 " syscalls=%" PRIu64
+           " gso=%d pacing=%d result=%s\n",
+           mode,
+           stats.ts_packets,
+           stats.datagrams,
+           rx.datagrams,
+           stats.syscalls,
+           gso,
+           pacing,
+           ok_batch ? "PASS" : "FAIL");
+    free(frame);
+    free(rx.pes);
+    free(rx.scratch);
+    return ok_stream && ok_psi && ok_pcr && ok_batch;
+}
+
+int main() {
+    int ok = 1;
+    ok &= run_case("unicast", 0, 1, 1, TEST_FRAMES, TEST_FRAME_DURATION_US);
+    ok &= run_case("multicast", 1, 0, 0, TEST_FRAMES, TEST_FRAME_DURATION_US);
+    ok &= run_case("low-fps", 0, 1, 0, TEST_LOW_FPS_FRAMES, TEST_LOW_FPS_FRAME_DURATION_US);
+    if (!ok) {
+        fprintf(stderr, "[ERROR] ts udp checks failed\n");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,981 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+extern "C" {
+#include "webrtcDtls.h"
+#include "webrtcSink.h"
+#include "webrtcSrtp.h"
+#include "webrtcStun.h"
+}
+
+#define TEST_FRAMES 150
+#define TEST_GOP 25
+#define TEST_FPS 25
+#define TEST_FRAME_DURATION_US (1000000 / TEST_FPS)
+#define TEST_FRAME_DURATION_90K (90000 / TEST_FPS)
+#define TEST_IDR_BYTES (20 * 1024)
+#define TEST_P_BYTES (4 * 1024)
+#define TEST_SPS_LEN 20
+#define TEST_PPS_LEN 5
+#define TEST_MAX_FRAME (TEST_IDR_BYTES + 1024)
+#define TEST_MAX_PACKETS 4096
+#define TEST_PACKET_MAX 1500
+#define TEST_HTTP_MAX 16384
+#define TEST_MAX_PEERS 2
+/* 第 1 个客户端故意丢掉该帧的前几个包，再用 NACK 要回来。 */
+#define TEST_NACK_FRAME 50
+#define TEST_NACK_DROPS 3
+/* 第 1 个客户端收到该帧时发一个 PLI。 */
+#define TEST_PLI_FRAME 80
+#define TEST_RTCP_INTERVAL_MS 500
+#define TEST_HANDSHAKE_TIMEOUT_MS 5000
+#define TEST_TAIL_MS 1000
+/* 从入队到客户端收齐整帧（含解密）的时长上限，回环上只有调度和加密开销。 */
+#define TEST_MAX_FRAME_LATENCY_MS 250
+#define TEST_CLIENT_SSRC 0x0C11E47AU
+
+/*
+ * WebRTC WHEP 输出的本地播放测试，两个客户端按浏览器的方式拉流：
+ *   - POST SDP offer（含一条被拒的 audio 行、两个 H264 负载类型），校验 201、Location 和 answer：
+ *     选中 packetization-mode=1 的负载类型、ice-lite、BUNDLE、sendonly、rtcp-mux、host 候选；
+ *   - 带 USE-CANDIDATE 的 STUN Binding 请求，校验响应的 MESSAGE-INTEGRITY 和 XOR-MAPPED-ADDRESS；
+ *   - 客户端 A 为 setup:actpass（网关当 DTLS 服务端），客户端 B 为 setup:passive（网关主动发起握手），
+ *     双方都校验对端证书指纹并导出 SRTP 密钥；
+ *   - 用独立实现（EVP AES-128-CTR + HMAC-SHA1，自行派生会话密钥、推算 ROC）解密 SRTP 和 SRTCP SR，
+ *     按 RFC 6184 拆包重组，逐帧校验 slice 与输入逐字节一致、帧号连续、首帧为带参数集的关键帧；
+ *   - 客户端 A 丢掉一个关键帧的前几个包，发 NACK 后收到重传补齐；发 PLI 后网关产生关键帧请求；
+ *   - 错误路径：未知流 404、坏 SDP 400、超出会话上限 503、OPTIONS 204、PATCH 405、密码错误的 STUN 无响应，
+ *     DELETE 结束会话后再次 DELETE 回 404。
+ *
+ * 用法：webrtc_whep_test
+ */
+
+typedef struct {
+    const char *label;
+    const char *setup;             /* offer 里的 a=setup。 */
+    int fd;                        /* 客户端 UDP socket。 */
+    struct sockaddr_in local;      /* 本地地址，用于校验 XOR-MAPPED-ADDRESS。 */
+    struct sockaddr_in server;     /* answer 里的 host 候选。 */
+    char ufrag[16];                /* 本端 ice-ufrag。 */
+    char pwd[40];                  /* 本端 ice-pwd。 */
+    char location[256];            /* WHEP 资源地址。 */
+    char server_ufrag[64];
+    char server_pwd[128];
+    char server_fingerprint[WEBRTC_DTLS_FINGERPRINT_LEN + 1];
+    char server_setup[16];
+    int payload_type;
+    uint32_t ssrc;
+    int answer_ok;
+    int stun_ok;
+    WebrtcDtlsIdentity identity;
+    WebrtcDtlsSession dtls;
+    int dtls_ready;
+    int connected;
+    /* 服务端到客户端方向的独立 SRTP 解密状态。 */
+    uint8_t rtp_key[16];
+    uint8_t rtp_auth[20];
+    uint8_t rtp_salt[14];
+    uint8_t rtcp_key[16];
+    uint8_t rtcp_auth[20];
+    uint8_t rtcp_salt[14];
+    int rtp_started;
+    uint32_t roc;
+    uint16_t highest_seq;
+    /* 客户端发出的 SRTCP（NACK/PLI）用被测模块保护。 */
+    WebrtcSrtpContext tx;
+    /* 按扩展序号存放的已解密包。 */
+    uint8_t *packets[TEST_MAX_PACKETS];
+    size_t packet_len[TEST_MAX_PACKETS];
+    uint64_t packet_recv_us[TEST_MAX_PACKETS];
+    int64_t first_index;
+    uint32_t first_timestamp;
+    int max_slot;
+    int auth_failures;
+    int bad_payload_types;
+    int duplicates;
+    int srtp_packets;
+    int sr_received;
+    int sr_bad;
+    /* NACK/PLI 场景，只在客户端 A 上启用。 */
+    int inject;
+    uint16_t dropped[TEST_NACK_DROPS];
+    int dropped_count;
+    int nack_sent;
+    int retransmits;
+    int pli_sent;
+    /* 重组结果。 */
+    int frames;
+    int next_index;
+    int gaps;
+    int bad_frames;
+    int first_is_key;
+    int params_ok;
+    double latency_sum_ms;
+    double latency_max_ms;
+} TestPeer;
+
+static uint64_t g_enqueue_us[TEST_FRAMES];
+static volatile int g_producer_done;
+
+static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static int frame_is_key(int index) {
+    return (index % TEST_GOP) == 0;
+}
+
+/* NALU 内容只由类型、长度和帧号决定，负载字节都非零，不会出现起始码。 */
+static size_t put_nalu(uint8_t *dst, uint8_t header, size_t body_len, int index) {
+    size_t i;
+    dst[0] = 0;
+    dst[1] = 0;
+    dst[2] = 0;
+    dst[3] = 1;
+    dst[4] = header;
+    for (i = 0; i < body_len; ++i) {
+        dst[5 + i] = (uint8_t)(((size_t)index * 31 + i * 7) % 255 + 1);
+    }
+    if (header == 0x67) {
+        dst[5] = 0x42;
+    } else if ((header & 0x1F) == 1 || (header & 0x1F) == 5) {
+        dst[5] = (uint8_t)(0x80 | ((index >> 7) & 0x7F));
+        dst[6] = (uint8_t)(0x80 | (index & 0x7F));
+    }
+    return 5 + body_len;
+}
+
+static size_t make_frame(uint8_t *dst, int index) {
+    size_t len = 0;
+    if (frame_is_key(index)) {
+        len += put_nalu(dst + len, 0x67, TEST_SPS_LEN - 1, -1);
+        len += put_nalu(dst + len, 0x68, TEST_PPS_LEN - 1, -2);
+        len += put_nalu(dst + len, 0x65, TEST_IDR_BYTES, index);
+    } else {
+        len += put_nalu(dst + len, 0x41, TEST_P_BYTES, index);
+    }
+    return len;
+}
+
+static int enqueue_frame(MediaSink *sink, uint8_t *frame, int index) {
+    MediaPacket packet;
+    MediaBuffer *buffer = NULL;
+    size_t len = make_frame(frame, index);
+    int ret;
+    if (media_buffer_create_copy(frame, len, &buffer) != 0) return -1;
+    media_packet_init(&packet);
+    packet.frame_type = MEDIA_FRAME_TYPE_VIDEO;
+    packet.codec = MEDIA_CODEC_H264;
+    packet.buffer = buffer;
+    packet.frame_id = (uint64_t)index;
+    packet.pts_us = 1000000ULL + (uint64_t)index * TEST_FRAME_DURATION_US;
+    packet.dts_us = packet.pts_us;
+    packet.is_key_frame = frame_is_key(index);
+    g_enqueue_us[index] = now_us();
+    ret = media_sink_enqueue(sink, &packet);
+    media_buffer_release(buffer);
+    return ret;
+}
+
+static void *producer_main(void *arg) {
+    MediaSink *sink = (MediaSink *)arg;
+    uint8_t *frame = (uint8_t *)malloc(TEST_MAX_FRAME);
+    uint64_t start_us = now_us();
+    int i;
+
+    for (i = 0; frame && i < TEST_FRAMES; ++i) {
+        uint64_t due_us = start_us + (uint64_t)i * TEST_FRAME_DURATION_US;
+        uint64_t now = now_us();
+        if (due_us > now) usleep((useconds_t)(due_us - now));
+        enqueue_frame(sink, frame, i);
+    }
+    free(frame);
+    g_producer_done = 1;
+    return NULL;
+}
+
+static int pick_port(int type) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int fd = socket(AF_INET, type, 0);
+    int port = -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd >= 0 && bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+        getsockname(fd, (struct sockaddr *)&addr, &addr_len) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+    if (fd >= 0) close(fd);
+    return port;
+}
+
+static void random_hex(char *out, size_t chars) {
+    static const char hex[] = "0123456789abcdef";
+    uint8_t raw[32];
+    size_t i;
+    RAND_bytes(raw, (int)(chars / 2));
+    for (i = 0; i < chars / 2; ++i) {
+        out[i * 2] = hex[raw[i] >> 4];
+        out[i * 2 + 1] = hex[raw[i] & 0x0F];
+    }
+    out[chars] = '\0';
+}
+
+/* 发一个 HTTP 请求并读到对端关闭，返回状态码，-1 表示连接失败。 */
+static int http_request(int port,
+                        const char *method,
+                        const char *path,
+                        const char *body,
+                        char *response,
+                        size_t cap,
+                        const char **out_body,
+                        char *location,
+                        size_t location_cap) {
+    struct sockaddr_in addr;
+    char request[TEST_HTTP_MAX];
+    size_t len = 0;
+    int status = -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int n;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    n = snprintf(request,
+                 sizeof(request),
+                 "%s %s HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Type: application/sdp\r\nContent-Length: %zu\r\n\r\n%s",
+                 method,
+                 path,
+                 body ? strlen(body) : 0,
+                 body ? body : "");
+    if (send(fd, request, (size_t)n, MSG_NOSIGNAL) != n) {
+        close(fd);
+        return -1;
+    }
+    while (len + 1 < cap) {
+        ssize_t got = recv(fd, response + len, cap - 1 - len, 0);
+        if (got <= 0) break;
+        len += (size_t)got;
+    }
+    close(fd);
+    response[len] = '\0';
+    if (sscanf(response, "HTTP/1.1 %d", &status) != 1) return -1;
+    if (out_body) {
+        const char *end = strstr(response, "\r\n\r\n");
+        *out_body = end ? end + 4 : response + len;
+    }
+    if (location && location_cap > 0) {
+        const char *line = strstr(response, "\r\nLocation: ");
+        location[0] = '\0';
+        if (line) {
+            size_t l = strcspn(line + 12, "\r\n");
+            if (l >= location_cap) l = location_cap - 1;
+            memcpy(location, line + 12, l);
+            location[l] = '\0';
+        }
+    }
+    return status;
+}
+
+/* 取 SDP 里某个前缀之后到行尾的内容。 */
+static int sdp_value(const char *sdp, const char *prefix, char *out, size_t cap) {
+    const char *line = strstr(sdp, prefix);
+    size_t len;
+    if (!line) return 0;
+    line += strlen(prefix);
+    len = strcspn(line, "\r\n");
+    if (len >= cap) len = cap - 1;
+    memcpy(out, line, len);
+    out[len] = '\0';
+    return 1;
+}
+
+static void build_offer(const TestPeer *peer, char *out, size_t cap) {
+    snprintf(out,
+             cap,
+             "v=0\r\no=- 4611731400430051336 2 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\n"
+             "a=group:BUNDLE 0 1\r\na=msid-semantic: WMS\r\n"
+             "m=audio 9 UDP/TLS/RTP/SAVPF 111\r\nc=IN IP4 0.0.0.0\r\n"
+             "a=ice-ufrag:%s\r\na=ice-pwd:%s\r\na=fingerprint:sha-256 %s\r\na=setup:%s\r\n"
+             "a=mid:0\r\na=recvonly\r\na=rtcp-mux\r\na=rtpmap:111 opus/48000/2\r\n"
+             "m=video 9 UDP/TLS/RTP/SAVPF 96 102\r\nc=IN IP4 0.0.0.0\r\n"
+             "a=ice-ufrag:%s\r\na=ice-pwd:%s\r\na=fingerprint:sha-256 %s\r\na=setup:%s\r\n"
+             "a=mid:1\r\na=recvonly\r\na=rtcp-mux\r\n"
+             "a=rtpmap:96 H264/90000\r\n"
+             "a=fmtp:96 level-asymmetry-allowed=1;packetization-mode=0;profile-level-id=42e01f\r\n"
+             "a=rtpmap:102 H264/90000\r\na=rtcp-fb:102 nack\r\na=rtcp-fb:102 nack pli\r\n"
+             "a=fmtp:102 level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f\r\n",
+             peer->ufrag,
+             peer->pwd,
+             peer->identity.fingerprint,
+             peer->setup,
+             peer->ufrag,
+             peer->pwd,
+             peer->identity.fingerprint,
+             peer->setup);
+}
+
+/* POST offer 并解析 answer。 */
+static int peer_negotiate(TestPeer *peer, int http_port) {
+    char offer[4096];
+    char response[TEST_HTTP_MAX];
+    char value[256];
+    const char *answer = NULL;
+    unsigned int media_port = 0;
+    int pt = -1;
+    int status;
+
+    build_offer(peer, offer, sizeof(offer));
+    status = http_request(http_port, "POST", "/whep/test", offer, response, sizeof(response), &answer,
+                          peer->location, sizeof(peer->location));
+    if (status != 201 || strncmp(peer->location, "/whep/test/", 11) != 0 ||
+        !strstr(response, "Content-Type: application/sdp")) {
+        fprintf(stderr, "[ERROR] %s offer status=%d location=%s\n", peer->label, status, peer->location);
+        return -1;
+    }
+    if (!sdp_value(answer, "a=ice-ufrag:", peer->server_ufrag, sizeof(peer->server_ufrag)) ||
+        !sdp_value(answer, "a=ice-pwd:", peer->server_pwd, sizeof(peer->server_pwd)) ||
+        !sdp_value(answer, "a=fingerprint:sha-256 ", peer->server_fingerprint, sizeof(peer->server_fingerprint)) ||
+        !sdp_value(answer, "a=setup:", peer->server_setup, sizeof(peer->server_setup)) ||
+        !sdp_value(answer, "m=video ", value, sizeof(value)) ||
+        sscanf(value, "%u UDP/TLS/RTP/SAVPF %d", &media_port, &pt) != 2 ||
+        !sdp_value(answer, "a=ssrc:", value, sizeof(value))) {
+        fprintf(stderr, "[ERROR] %s answer incomplete:\n%s\n", peer->label, answer);
+        return -1;
+    }
+    peer->ssrc = (uint32_t)strtoul(value, NULL, 10);
+    peer->payload_type = pt;
+    peer->server.sin_family = AF_INET;
+    peer->server.sin_port = htons((uint16_t)media_port);
+    peer->server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    snprintf(value, sizeof(value), "127.0.0.1 %u typ host", media_port);
+    peer->answer_ok = pt == 102 && strstr(answer, "a=ice-lite\r\n") && strstr(answer, "a=group:BUNDLE 1\r\n") &&
+                      strstr(answer, "m=audio 0 ") && strstr(answer, "a=sendonly\r\n") && strstr(answer, "a=rtcp-mux\r\n") &&
+                      strstr(answer, "a=rtcp-fb:102 nack\r\n") && strstr(answer, "a=rtcp-fb:102 nack pli\r\n") &&
+                      strstr(answer, "packetization-mode=1") && strstr(answer, value) &&
+                      strcmp(peer->server_setup, strcmp(peer->setup, "passive") == 0 ? "active" : "passive") == 0;
+    return 0;
+}
+
+static void peer_dtls_send(void *opaque, const uint8_t *data, size_t len) {
+    TestPeer *peer = (TestPeer *)opaque;
+    sendto(peer->fd, data, len, 0, (struct sockaddr *)&peer->server, sizeof(peer->server));
+}
+
+static int peer_send_stun(TestPeer *peer, const char *password) {
+    uint8_t request[WEBRTC_STUN_MAX];
+    uint8_t tid[WEBRTC_STUN_TRANSACTION_ID_LEN];
+    char username[WEBRTC_STUN_USERNAME_MAX];
+    int len;
+
+    RAND_bytes(tid, sizeof(tid));
+    snprintf(username, sizeof(username), "%s:%s", peer->server_ufrag, peer->ufrag);
+    len = webrtc_stun_build_binding_request(request, sizeof(request), tid, username, password, 0x6E7F1EFFU, 0x1234, 1);
+    if (len <= 0) return -1;
+    return sendto(peer->fd, request, (size_t)len, 0, (struct sockaddr *)&peer->server, sizeof(peer->server)) == len ? 0 : -1;
+}
+
+/* RFC 3711 4.3 AES-CM 密钥派生，KDR 为 0。 */
+static void derive(const uint8_t *key, const uint8_t *salt, uint8_t label, uint8_t *out, int len) {
+    uint8_t iv[16] = {0};
+    uint8_t zeros[32] = {0};
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    int out_len = 0;
+    memcpy(iv, salt, 14);
+    iv[7] ^= label;
+    EVP_EncryptInit_ex(ctx, EVP_aes_128_ctr(), NULL, key, iv);
+    EVP_EncryptUpdate(ctx, out, &out_len, zeros, len);
+    EVP_CIPHER_CTX_free(ctx);
+}
+
+static void aes_ctr(const uint8_t *key, const uint8_t *iv, uint8_t *data, int len) {
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    int out_len = 0;
+    EVP_EncryptInit_ex(ctx, EVP_aes_128_ctr(), NULL, key, iv);
+    EVP_EncryptUpdate(ctx, data, &out_len, data, len);
+    EVP_CIPHER_CTX_free(ctx);
+}
+
+static int tag_ok(const uint8_t *auth_key, const uint8_t *data, size_t len, const uint8_t *roc, const uint8_t *tag) {
+    uint8_t mac[EVP_MAX_MD_SIZE];
+    unsigned int mac_len = 0;
+    HMAC_CTX *h = HMAC_CTX_new();
+    HMAC_Init_ex(h, auth_key, 20, EVP_sha1(), NULL);
+    HMAC_Update(h, data, len);
+    if (roc) HMAC_Update(h, roc, 4);
+    HMAC_Final(h, mac, &mac_len);
+    HMAC_CTX_free(h);
+    return memcmp(mac, tag, 10) == 0;
+}
+
+static int peer_on_connected(TestPeer *peer) {
+    WebrtcDtlsSrtpKeys keys;
+    if (webrtc_dtls_session_export_srtp(&peer->dtls, &keys) != 0) return -1;
+    derive(keys.remote_key, keys.remote_salt, 0, peer->rtp_key, 16);
+    derive(keys.remote_key, keys.remote_salt, 1, peer->rtp_auth, 20);
+    derive(keys.remote_key, keys.remote_salt, 2, peer->rtp_salt, 14);
+    derive(keys.remote_key, keys.remote_salt, 3, peer->rtcp_key, 16);
+    derive(keys.remote_key, keys.remote_salt, 4, peer->rtcp_auth, 20);
+    derive(keys.remote_key, keys.remote_salt, 5, peer->rtcp_salt, 14);
+    peer->connected = 1;
+    return webrtc_srtp_init(&peer->tx, keys.local_key, keys.local_salt);
+}
+
+/* STUN 检查 + DTLS 握手，直到导出 SRTP 密钥。 */
+static int peer_connect(TestPeer *peer) {
+    uint64_t deadline = now_us() + TEST_HANDSHAKE_TIMEOUT_MS * 1000ULL;
+    int client = strcmp(peer->setup, "passive") != 0;
+
+    if (webrtc_dtls_session_init(&peer->dtls, &peer->identity, !client, peer->server_fingerprint, peer_dtls_send, peer) != 0) {
+        return -1;
+    }
+    peer->dtls_ready = 1;
+    if (peer_send_stun(peer, peer->server_pwd) != 0) return -1;
+    while (!peer->connected && now_us() < deadline) {
+        struct pollfd pfd = {peer->fd, POLLIN, 0};
+        int timeout = webrtc_dtls_session_timeout_ms(&peer->dtls);
+        uint8_t buf[2048];
+        ssize_t n;
+
+        if (poll(&pfd, 1, timeout >= 0 && timeout < 50 ? timeout : 50) <= 0) {
+            if (webrtc_dtls_session_timeout_ms(&peer->dtls) == 0 && webrtc_dtls_session_on_timer(&peer->dtls) != 0) return -1;
+            continue;
+        }
+        n = recv(peer->fd, buf, sizeof(buf), 0);
+        if (n <= 0) continue;
+        if (buf[0] <= 3) {
+            WebrtcStunMessage msg;
+            if (webrtc_stun_parse(buf, (size_t)n, &msg) == 0 && msg.type == WEBRTC_STUN_BINDING_SUCCESS &&
+                webrtc_stun_check_integrity(buf, (size_t)n, &msg, peer->server_pwd) && msg.has_mapped &&
+                msg.mapped.sin_port == peer->local.sin_port && msg.mapped.sin_addr.s_addr == peer->local.sin_addr.s_addr) {
+                peer->stun_ok = 1;
+                /* 作为 DTLS 客户端时，STUN 成功后发 ClientHello。 */
+                if (client && webrtc_dtls_session_feed(&peer->dtls, NULL, 0) < 0) return -1;
+            }
+        } else if (buf[0] >= 20 && buf[0] <= 63) {
+            int ret = webrtc_dtls_session_feed(&peer->dtls, buf, (size_t)n);
+            if (ret < 0) return -1;
+            if (ret == 1 && peer_on_connected(peer) != 0) return -1;
+        }
+    }
+    return peer->connected ? 0 : -1;
+}
+
+static void peer_send_rtcp(TestPeer *peer, uint8_t *packet, size_t len) {
+    int protected_len = webrtc_srtp_protect_rtcp(&peer->tx, packet, len, len + WEBRTC_SRTCP_TRAILER_LEN);
+    if (protected_len > 0) {
+        sendto(peer->fd, packet, (size_t)protected_len, 0, (struct sockaddr *)&peer->server, sizeof(peer->server));
+    }
+}
+
+static void put_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/* 复合包：空 RR + 每个序号一个 FCI 的 Generic NACK。 */
+static void peer_send_nack(TestPeer *peer) {
+    uint8_t packet[64 + WEBRTC_SRTCP_TRAILER_LEN];
+    size_t len = 0;
+    int i;
+
+    packet[len++] = 0x80;
+    packet[len++] = 201;
+    packet[len++] = 0;
+    packet[len++] = 1;
+    put_be32(packet + len, TEST_CLIENT_SSRC);
+    len += 4;
+    packet[len++] = 0x81;
+    packet[len++] = 205;
+    packet[len++] = 0;
+    packet[len++] = (uint8_t)(2 + peer->dropped_count);
+    put_be32(packet + len, TEST_CLIENT_SSRC);
+    put_be32(packet + len + 4, peer->ssrc);
+    len += 8;
+    for (i = 0; i < peer->dropped_count; ++i) {
+        packet[len++] = (uint8_t)(peer->dropped[i] >> 8);
+        packet[len++] = (uint8_t)peer->dropped[i];
+        packet[len++] = 0;
+        packet[len++] = 0;
+    }
+    peer_send_rtcp(peer, packet, len);
+    peer->nack_sent = 1;
+}
+
+static void peer_send_pli(TestPeer *peer) {
+    uint8_t packet[20 + WEBRTC_SRTCP_TRAILER_LEN];
+    packet[0] = 0x80;
+    packet[1] = 201;
+    packet[2] = 0;
+    packet[3] = 1;
+    put_be32(packet + 4, TEST_CLIENT_SSRC);
+    packet[8] = 0x81;
+    packet[9] = 206;
+    packet[10] = 0;
+    packet[11] = 2;
+    put_be32(packet + 12, TEST_CLIENT_SSRC);
+    put_be32(packet + 16, peer->ssrc);
+    peer_send_rtcp(peer, packet, 20);
+    peer->pli_sent = 1;
+}
+
+/* 独立解密 SRTCP 并检查 SR。 */
+static void peer_on_srtcp(TestPeer *peer, uint8_t *buf, size_t len) {
+    uint8_t iv[16] = {0};
+    uint32_t index;
+    if (len < 8 + WEBRTC_SRTCP_TRAILER_LEN ||
+        !tag_ok(peer->rtcp_auth, buf, len - WEBRTC_SRTP_AUTH_TAG_LEN, NULL, buf + len - WEBRTC_SRTP_AUTH_TAG_LEN)) {
+        peer->sr_bad++;
+        return;
+    }
+    index = (((uint32_t)buf[len - 14] << 24) | ((uint32_t)buf[len - 13] << 16) | ((uint32_t)buf[len - 12] << 8) | buf[len - 11]);
+    if (index & 0x80000000U) {
+        index &= 0x7FFFFFFFU;
+        memcpy(iv, peer->rtcp_salt, 14);
+        iv[4] ^= buf[4];
+        iv[5] ^= buf[5];
+        iv[6] ^= buf[6];
+        iv[7] ^= buf[7];
+        iv[10] ^= (uint8_t)(index >> 24);
+        iv[11] ^= (uint8_t)(index >> 16);
+        iv[12] ^= (uint8_t)(index >> 8);
+        iv[13] ^= (uint8_t)index;
+        aes_ctr(peer->rtcp_key, iv, buf + 8, (int)(len - 8 - WEBRTC_SRTCP_TRAILER_LEN));
+    }
+    if (buf[1] == 200 && ((uint32_t)buf[4] << 24 | (uint32_t)buf[5] << 16 | (uint32_t)buf[6] << 8 | buf[7]) == peer->ssrc &&
+        len - WEBRTC_SRTCP_TRAILER_LEN >= 28) {
+        peer->sr_received++;
+    } else {
+        peer->sr_bad++;
+    }
+}
+
+/* 独立解密 SRTP：按 RFC 3711 3.3.1 推算 ROC，先验标签再解密，按扩展序号存放。 */
+static void peer_on_srtp(TestPeer *peer, uint8_t *buf, size_t len) {
+    uint8_t iv[16] = {0};
+    uint8_t roc_be[4];
+    uint16_t seq;
+    uint32_t timestamp;
+    uint32_t v;
+    int64_t index;
+    size_t header_len;
+    int slot;
+    int frame;
+
+    if (len < 12 + WEBRTC_SRTP_AUTH_TAG_LEN) return;
+    seq = (uint16_t)((buf[2] << 8) | buf[3]);
+    v = peer->roc;
+    if (peer->rtp_started) {
+        if (peer->highest_seq < 32768) {
+            if ((int)seq - (int)peer->highest_seq > 32768) v = peer->roc - 1;
+        } else if ((int)peer->highest_seq - 32768 > (int)seq) {
+            v = peer->roc + 1;
+        }
+    }
+    put_be32(roc_be, v);
+    if (!tag_ok(peer->rtp_auth, buf, len - WEBRTC_SRTP_AUTH_TAG_LEN, roc_be, buf + len - WEBRTC_SRTP_AUTH_TAG_LEN)) {
+        peer->auth_failures++;
+        return;
+    }
+    len -= WEBRTC_SRTP_AUTH_TAG_LEN;
+    header_len = 12 + 4 * (size_t)(buf[0] & 0x0F);
+    memcpy(iv, peer->rtp_salt, 14);
+    iv[4] ^= buf[8];
+    iv[5] ^= buf[9];
+    iv[6] ^= buf[10];
+    iv[7] ^= buf[11];
+    iv[8] ^= (uint8_t)(v >> 24);
+    iv[9] ^= (uint8_t)(v >> 16);
+    iv[10] ^= (uint8_t)(v >> 8);
+    iv[11] ^= (uint8_t)v;
+    iv[12] ^= (uint8_t)(seq >> 8);
+    iv[13] ^= (uint8_t)seq;
+    aes_ctr(peer->rtp_key, iv, buf + header_len, (int)(len - header_len));
+    if (!peer->rtp_started || v > peer->roc) {
+        peer->roc = v;
+        peer->highest_seq = seq;
+    } else if (v == peer->roc && (uint16_t)(seq - peer->highest_seq) < 32768) {
+        peer->highest_seq = seq;
+    }
+    peer->srtp_packets++;
+    if ((buf[1] & 0x7F) != peer->payload_type) peer->bad_payload_types++;
+    timestamp = ((uint32_t)buf[4] << 24) | ((uint32_t)buf[5] << 16) | ((uint32_t)buf[6] << 8) | buf[7];
+    index = ((int64_t)v << 16) | seq;
+    if (!peer->rtp_started) {
+        peer->rtp_started = 1;
+        peer->first_index = index;
+        peer->first_timestamp = timestamp;
+    }
+    frame = (int)((timestamp - peer->first_timestamp) / TEST_FRAME_DURATION_90K);
+    /* 故意丢掉关键帧的前几个包，凑齐后一次性 NACK。 */
+    if (peer->inject && frame == TEST_NACK_FRAME && peer->dropped_count < TEST_NACK_DROPS && !peer->nack_sent) {
+        peer->dropped[peer->dropped_count++] = seq;
+        if (peer->dropped_count == TEST_NACK_DROPS) peer_send_nack(peer);
+        return;
+    }
+    if (peer->inject && frame >= TEST_PLI_FRAME && !peer->pli_sent) peer_send_pli(peer);
+    slot = (int)(index - peer->first_index);
+    if (slot < 0 || slot >= TEST_MAX_PACKETS) return;
+    if (peer->packets[slot]) {
+        peer->duplicates++;
+        return;
+    }
+    if (peer->nack_sent) {
+        int i;
+        for (i = 0; i < peer->dropped_count; ++i) {
+            if (peer->dropped[i] == seq) peer->retransmits++;
+        }
+    }
+    peer->packets[slot] = (uint8_t *)malloc(len);
+    memcpy(peer->packets[slot], buf, len);
+    peer->packet_len[slot] = len;
+    peer->packet_recv_us[slot] = now_us();
+    if (slot > peer->max_slot) peer->max_slot = slot;
+}
+
+static void peer_drain(TestPeer *peer) {
+    uint8_t buf[2048];
+    while (1) {
+        ssize_t n = recv(peer->fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n <= 0) return;
+        if (n >= 2 && buf[0] >= 128 && buf[0] <= 191 && buf[1] >= 192 && buf[1] <= 223) {
+            peer_on_srtcp(peer, buf, (size_t)n);
+        } else if (n >= 2 && buf[0] >= 128 && buf[0] <= 191) {
+            peer_on_srtp(peer, buf, (size_t)n);
+        } else if (buf[0] >= 20 && buf[0] <= 63) {
+            webrtc_dtls_session_feed(&peer->dtls, buf, (size_t)n);
+        }
+    }
+}
+
+/* 一个访问单元收齐后校验：取 slice 读帧号，与输入逐字节比较；关键帧前必须有参数集。 */
+static void peer_check_frame(TestPeer *peer, uint8_t **nalus, size_t *nalu_len, int count, uint64_t recv_us, uint8_t *expected) {
+    int has_sps = 0;
+    int has_pps = 0;
+    int i;
+
+    for (i = 0; i < count; ++i) {
+        uint8_t type = nalus[i][0] & 0x1F;
+        if (type == 7) has_sps = 1;
+        if (type == 8) has_pps = 1;
+        if ((type == 1 || type == 5) && nalu_len[i] > 3) {
+            int index = ((nalus[i][1] & 0x7F) << 7) | (nalus[i][2] & 0x7F);
+            size_t len;
+            if (peer->frames == 0) {
+                peer->first_is_key = type == 5 && index == 0;
+                peer->next_index = index;
+            }
+            if (index != peer->next_index) peer->gaps++;
+            if (index < 0 || index >= TEST_FRAMES) {
+                peer->bad_frames++;
+                return;
+            }
+            len = put_nalu(expected, frame_is_key(index) ? 0x65 : 0x41, frame_is_key(index) ? TEST_IDR_BYTES : TEST_P_BYTES, index);
+            if (nalu_len[i] != len - 4 || memcmp(nalus[i], expected + 4, len - 4) != 0) peer->bad_frames++;
+            if (type == 5 && !(has_sps && has_pps)) peer->params_ok = 0;
+            if (recv_us > g_enqueue_us[index]) {
+                double ms = (double)(recv_us - g_enqueue_us[index]) / 1000.0;
+                peer->latency_sum_ms += ms;
+                if (ms > peer->latency_max_ms) peer->latency_max_ms = ms;
+            }
+            peer->frames++;
+            peer->next_index = index + 1;
+        }
+    }
+}
+
+/* RFC 6184 拆包：单 NALU 和 FU-A，按 marker 切分访问单元。 */
+static void peer_depacketize(TestPeer *peer) {
+    uint8_t *au = (uint8_t *)malloc(TEST_MAX_FRAME * 2);
+    uint8_t *expected = (uint8_t *)malloc(TEST_MAX_FRAME);
+    uint8_t *nalus[16];
+    size_t nalu_len[16];
+    size_t au_len = 0;
+    int nalu_count = 0;
+    int in_fu = 0;
+    uint64_t last_recv_us = 0;
+    int slot;
+
+    peer->params_ok = 1;
+    for (slot = 0; slot <= peer->max_slot; ++slot) {
+        const uint8_t *packet = peer->packets[slot];
+        const uint8_t *payload;
+        size_t payload_len;
+        uint8_t type;
+
+        if (!packet) {
+            /* 缺包：丢弃当前访问单元，帧号不连续会计入 gaps。 */
+            au_len = 0;
+            nalu_count = 0;
+            in_fu = 0;
+            continue;
+        }
+        payload = packet + 12 + 4 * (packet[0] & 0x0F);
+        payload_len = peer->packet_len[slot] - (size_t)(payload - packet);
+        if (peer->packet_recv_us[slot] > last_recv_us) last_recv_us = peer->packet_recv_us[slot];
+        type = payload[0] & 0x1F;
+        if (type >= 1 && type <= 23 && nalu_count < 16 && au_len + payload_len <= TEST_MAX_FRAME * 2) {
+            nalus[nalu_count] = au + au_len;
+            nalu_len[nalu_count++] = payload_len;
+            memcpy(au + au_len, payload, payload_len);
+            au_len += payload_len;
+        } else if (type == 28 && payload_len > 2) {
+            if ((payload[1] & 0x80) && nalu_count < 16) {
+                nalus[nalu_count] = au + au_len;
+                nalu_len[nalu_count++] = 1;
+                au[au_len++] = (uint8_t)((payload[0] & 0xE0) | (payload[1] & 0x1F));
+                in_fu = 1;
+            }
+            if (in_fu && au_len + payload_len - 2 <= TEST_MAX_FRAME * 2) {
+                memcpy(au + au_len, payload + 2, payload_len - 2);
+                au_len += payload_len - 2;
+                nalu_len[nalu_count - 1] += payload_len - 2;
+            }
+            if (payload[1] & 0x40) in_fu = 0;
+        }
+        if (packet[1] & 0x80) {
+            peer_check_frame(peer, nalus, nalu_len, nalu_count, last_recv_us, expected);
+            au_len = 0;
+            nalu_count = 0;
+            in_fu = 0;
+            last_recv_us = 0;
+        }
+    }
+    free(au);
+    free(expected);
+}
+
+static int peer_open(TestPeer *peer, const char *label, const char *setup, int inject) {
+    socklen_t len = sizeof(peer->local);
+    int rcvbuf = 4 * 1024 * 1024;
+
+    memset(peer, 0, sizeof(*peer));
+    peer->label = label;
+    peer->setup = setup;
+    peer->inject = inject;
+    peer->max_slot = -1;
+    random_hex(peer->ufrag, 8);
+    random_hex(peer->pwd, 32);
+    peer->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    peer->local.sin_family = AF_INET;
+    peer->local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (peer->fd < 0 || bind(peer->fd, (struct sockaddr *)&peer->local, sizeof(peer->local)) != 0 ||
+        getsockname(peer->fd, (struct sockaddr *)&peer->local, &len) != 0) {
+        return -1;
+    }
+    setsockopt(peer->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    return webrtc_dtls_identity_init(&peer->identity);
+}
+
+static void peer_close(TestPeer *peer) {
+    int i;
+    if (peer->dtls_ready) webrtc_dtls_session_deinit(&peer->dtls);
+    webrtc_dtls_identity_deinit(&peer->identity);
+    webrtc_srtp_deinit(&peer->tx);
+    for (i = 0; i < TEST_MAX_PACKETS; ++i) {
+        free(peer->packets[i]);
+    }
+    if (peer->fd >= 0) close(peer->fd);
+}
+
+static int peer_report(const TestPeer *peer) {
+    int ok = peer->answer_ok && peer->stun_ok && peer->connected && peer->frames == TEST_FRAMES && peer->gaps == 0 &&
+             peer->bad_frames == 0 && peer->first_is_key && peer->params_ok && peer->auth_failures == 0 &&
+             peer->bad_payload_types == 0 && peer->sr_received > 0 && peer->sr_bad == 0 &&
+             peer->latency_max_ms <= TEST_MAX_FRAME_LATENCY_MS;
+    printf("[WEBRTC_TEST] peer=%s setup=%s server_setup=%s answer=%s stun=%s dtls=%s frames=%d gaps=%d bad_frames=%d first_key=%d params=%d "
+           "srtp=%d auth_failures=%d bad_pt=%d duplicates=%d sr=%d sr_bad=%d latency avg=%.1fms max=%.1fms result=%s\n",
+           peer->label,
+           peer->setup,
+           peer->server_setup,
+           peer->answer_ok ? "PASS" : "FAIL",
+           peer->stun_ok ? "PASS" : "FAIL",
+           peer->connected ? "PASS" : "FAIL",
+           peer->frames,
+           peer->gaps,
+           peer->bad_frames,
+           peer->first_is_key,
+           peer->params_ok,
+           peer->srtp_packets,
+           peer->auth_failures,
+           peer->bad_payload_types,
+           peer->duplicates,
+           peer->sr_received,
+           peer->sr_bad,
+           peer->frames ? peer->latency_sum_ms / peer->frames : 0.0,
+           peer->latency_max_ms,
+           ok ? "PASS" : "FAIL");
+    return ok;
+}
+
+int main() {
+    static TestPeer peers[2];
+    static TestPeer extra;
+    MediaSink sink;
+    WebrtcSinkConfig config;
+    WebrtcSinkStats stats;
+    pthread_t producer;
+    void *impl;
+    char response[TEST_HTTP_MAX];
+    char offer[4096];
+    char path[256];
+    uint64_t done_us = 0;
+    int http_port = pick_port(SOCK_STREAM);
+    int media_port = pick_port(SOCK_DGRAM);
+    int idr_after_connect = 0;
+    int idr_after_pli = 0;
+    int ok_nack;
+    int ok_pli;
+    int ok_errors = 1;
+    int ok_delete;
+    int ok_stats;
+    int ok_peers;
+    int i;
+
+    if (http_port <= 0 || media_port <= 0) {
+        fprintf(stderr, "[ERROR] webrtc test setup failed\n");
+        return -1;
+    }
+    memset(&config, 0, sizeof(config));
+    config.name = "webrtc-test";
+    config.listen_ip = "127.0.0.1";
+    config.http_port = http_port;
+    config.media_port = media_port;
+    config.stream_name = "test";
+    config.max_peers = TEST_MAX_PEERS;
+    config.rtcp_interval_ms = TEST_RTCP_INTERVAL_MS;
+    config.gso = 1;
+    config.video_fps = TEST_FPS;
+    config.video_bitrate = (TEST_IDR_BYTES + (TEST_GOP - 1) * TEST_P_BYTES) * 8 * TEST_FPS / TEST_GOP;
+    if (webrtc_sink_setup(&sink, &config) != 0 || media_sink_start(&sink) != 0) {
+        fprintf(stderr, "[ERROR] webrtc sink start failed\n");
+        return -1;
+    }
+
+    /* A：actpass，网关为 DTLS 服务端，并做 NACK/PLI；B：passive，网关主动握手。 */
+    if (peer_open(&peers[0], "A", "actpass", 1) != 0 || peer_open(&peers[1], "B", "passive", 0) != 0 ||
+        peer_open(&extra, "C", "actpass", 0) != 0) {
+        fprintf(stderr, "[ERROR] webrtc test peer setup failed\n");
+        return -1;
+    }
+    for (i = 0; i < 2; ++i) {
+        if (peer_negotiate(&peers[i], http_port) != 0 || peer_connect(&peers[i]) != 0) {
+            fprintf(stderr, "[ERROR] peer %s setup failed answer=%d stun=%d connected=%d\n",
+                    peers[i].label, peers[i].answer_ok, peers[i].stun_ok, peers[i].connected);
+        }
+    }
+    usleep(50000);
+    idr_after_connect = webrtc_sink_consume_external_idr_request(&sink);
+
+    /* 会话数已满。 */
+    build_offer(&extra, offer, sizeof(offer));
+    ok_errors &= http_request(http_port, "POST", "/whep/test", offer, response, sizeof(response), NULL, NULL, 0) == 503;
+    /* 密码错误的 STUN 不应答。 */
+    snprintf(extra.server_ufrag, sizeof(extra.server_ufrag), "%s", peers[0].server_ufrag);
+    snprintf(extra.ufrag, sizeof(extra.ufrag), "%s", peers[0].ufrag);
+    extra.server = peers[0].server;
+    peer_send_stun(&extra, "wrong-password-wrong-password");
+
+    g_producer_done = 0;
+    pthread_create(&producer, NULL, producer_main, &sink);
+    while (1) {
+        struct pollfd pfds[2] = {{peers[0].fd, POLLIN, 0}, {peers[1].fd, POLLIN, 0}};
+        poll(pfds, 2, 10);
+        peer_drain(&peers[0]);
+        peer_drain(&peers[1]);
+        if (webrtc_sink_consume_external_idr_request(&sink) && peers[0].pli_sent) idr_after_pli = 1;
+        if (g_producer_done && done_us == 0) done_us = now_us();
+        if (done_us && now_us() - done_us > TEST_TAIL_MS * 1000ULL) break;
+    }
+    pthread_join(producer, NULL);
+    {
+        struct pollfd pfd = {extra.fd, POLLIN, 0};
+        ok_errors &= poll(&pfd, 1, 0) == 0;
+    }
+
+    ok_errors &= http_request(http_port, "POST", "/whep/other", offer, response, sizeof(response), NULL, NULL, 0) == 404;
+    ok_errors &= http_request(http_port, "OPTIONS", "/whep/test", NULL, response, sizeof(response), NULL, NULL, 0) == 204 &&
+                 strstr(response, "Access-Control-Allow-Methods: POST, DELETE, OPTIONS") != NULL;
+    snprintf(path, sizeof(path), "%s", peers[0].location);
+    ok_errors &= http_request(http_port, "PATCH", path, "a=candidate:1\r\n", response, sizeof(response), NULL, NULL, 0) == 405;
+    ok_errors &= http_request(http_port, "DELETE", "/whep/test/0000", NULL, response, sizeof(response), NULL, NULL, 0) == 404;
+    ok_delete = http_request(http_port, "DELETE", path, NULL, response, sizeof(response), NULL, NULL, 0) == 200;
+    ok_delete &= http_request(http_port, "DELETE", path, NULL, response, sizeof(response), NULL, NULL, 0) == 404;
+    /* 删除后有空位，坏 SDP 才会走到解析并回 400。 */
+    ok_errors &= http_request(http_port, "POST", "/whep/test", "v=0\r\ns=-\r\n", response, sizeof(response), NULL, NULL, 0) == 400;
+    usleep(100000);
+    webrtc_sink_get_stats(&sink, &stats);
+    ok_delete &= stats.peers == 1 && stats.connected_peers == 1;
+
+    media_sink_stop(&sink);
+    impl = sink.impl;
+    media_sink_deinit(&sink);
+    free(impl);
+
+    for (i = 0; i < 2; ++i) {
+        peer_depacketize(&peers[i]);
+    }
+    ok_peers = peer_report(&peers[0]);
+    ok_peers &= peer_report(&peers[1]);
+    ok_nack = peers[0].nack_sent && peers[0].dropped_count == TEST_NACK_DROPS && peers[0].retransmits == TEST_NACK_DROPS;
+    ok_pli = peers[0].pli_sent && idr_after_connect && idr_after_pli;
+    ok_stats = stats.offers == 5 && stats.answers == 2 && stats.rejected_offers == 3 && stats.sessions_deleted == 1 &&
+               stats.dtls_handshakes == 2 && stats.dtls_failures == 0 && stats.stun_rejects >= 1 &&
+               stats.frames == TEST_FRAMES && stats.nack_requested == TEST_NACK_DROPS &&
+               stats.retransmitted == TEST_NACK_DROPS && stats.nack_too_late == 0 && stats.pli == 1 &&
+               stats.srtcp_errors == 0 && stats.sr_sent > 0;
+    printf("[WEBRTC_TEST] nack dropped=%d retransmits=%d result=%s\n",
+           peers[0].dropped_count,
+           peers[0].retransmits,
+           ok_nack ? "PASS" : "FAIL");
+    printf("[WEBRTC_TEST] idr_request connect=%d pli=%d result=%s\n", idr_after_connect, idr_after_pli, ok_pli ? "PASS" : "FAIL");
+    printf("[WEBRTC_TEST] error_paths=%s delete=%s\n", ok_errors ? "PASS" : "FAIL", ok_delete ? "PASS" : "FAIL");
+    printf("[WEBRTC_TEST] offers=%" PRIu64 " answers=%" PRIu64 " rejected=%" PRIu64 " dtls=%" PRIu64 " stun_rejects=%" PRIu64
+           " frames=%" PRIu64 " rtp=%" PRIu64 " nack=%" PRIu64 " retransmitted=%" PRIu64 " pli=%" PRIu64 " sr=%" PRIu64
+           " result=%s\n",
+           stats.offers,
+           stats.answers,
+           stats.rejected_offers,
+           stats.dtls_handshakes,
+           stats.stun_rejects,
+           stats.frames,
+           stats.rtp_packets,
+           stats.nack_requested,
+           stats.retransmitted,
+           stats.pli,
+           stats.sr_sent,
+           ok_stats ? "PASS" : "FAIL");
+
+    peer_close(&peers[0]);
+    peer_close(&peers[1]);
+    peer_close(&extra);
+    if (!(ok_peers && ok_nack && ok_pli && ok_errors && ok_delete && ok_stats)) {
+        fprintf(stderr, "[ERROR] webrtc checks failed\n");
+        return -1;
+    }
+    return 0;
+}
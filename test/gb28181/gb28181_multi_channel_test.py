@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+import argparse
+import random
+import re
+import sys
+import time
+
+from gb28181_multi_session_test import Platform, RtpStats
+
+
+CATALOG_ITEM_RE = re.compile(r"<Item>.*?<DeviceID>(\d+)</DeviceID>", re.S)
+
+
+def run(args: argparse.Namespace) -> int:
+    platform = Platform(args)
+    channels = args.channels.split(",")
+    receivers = [RtpStats(args.rtp_port + 2 * i) for i in range(len(channels))]
+
+    print("[PLATFORM] waiting REGISTER on udp/%d ..." % args.sip_port)
+    deadline = time.time() + args.register_timeout_sec
+    while platform.device_addr is None and time.time() < deadline:
+        platform.answer_pending()
+    if platform.device_addr is None:
+        print("[PLATFORM][ERROR] device did not register")
+        return 1
+
+    # 查询目录：期望一个设备下列出全部通道。
+    sn = random.randint(1, 1 << 20)
+    query = ("<?xml version=\"1.0\"?>\r\n<Query>\r\n<CmdType>Catalog</CmdType>\r\n<SN>%d</SN>\r\n"
+             "<DeviceID>%s</DeviceID>\r\n</Query>\r\n" % (sn, args.device_id))
+    platform.request("MESSAGE", "catalog-%d" % sn, "c%d" % sn, "", query, content_type="Application/MANSCDP+xml")
+    catalog = None
+    deadline = time.time() + 5
+    while catalog is None and time.time() < deadline:
+        platform.answer_pending()
+        for body in platform.messages:
+            if "<CmdType>Catalog</CmdType>" in body and "<SN>%d</SN>" % sn in body:
+                catalog = body
+    listed = CATALOG_ITEM_RE.findall(catalog or "")
+    print("[PLATFORM] catalog channels=%s" % listed)
+
+    # 按通道 ID 逐个点播，每个通道一个收流端口。
+    for i, channel_id in enumerate(channels):
+        if platform.invite("chan-%d-%d" % (i, random.randint(1, 1 << 30)), args.rtp_port + 2 * i,
+                           "0%09d" % (200000001 + i), channel_id) is None:
+            return 1
+
+    end = time.time() + args.duration_sec
+    while time.time() < end:
+        platform.answer_pending()
+        for receiver in receivers:
+            receiver.drain()
+
+    ok = True
+    if len(platform.register_sources) != 1:
+        print("[PLATFORM][ERROR] expected one registering UA, got %s" % sorted(platform.register_sources))
+        ok = False
+    if sorted(listed) != sorted(channels):
+        print("[PLATFORM][ERROR] catalog does not list every channel")
+        ok = False
+    for channel_id, receiver in zip(channels, receivers):
+        print("[PLATFORM] channel=%s packets=%d ssrcs=%s seq_gaps=%d" %
+              (channel_id, receiver.packets, ["%08x" % s for s in receiver.ssrcs], receiver.gaps))
+        if receiver.packets == 0 or receiver.gaps != 0:
+            ok = False
+    # 不同通道承载不同码流，同一时间戳下的负载不应相同。
+    if len(receivers) >= 2:
+        common = set(receivers[0].payload_by_ts) & set(receivers[1].payload_by_ts)
+        same = sum(1 for ts in common if receivers[0].payload_by_ts[ts] == receivers[1].payload_by_ts[ts])
+        print("[PLATFORM] common_ts=%d identical_payloads=%d" % (len(common), same))
+        if common and same == len(common):
+            print("[PLATFORM][ERROR] channels carry the same stream")
+            ok = False
+    print("[PLATFORM] registers=%d result=%s" % (len(platform.register_sources), "PASS" if ok else "FAIL"))
+    return 0 if ok else 1
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="GB28181 multi-channel stand-in platform")
+    parser.add_argument("--local-ip", required=True, help="本机（平台）IP，需与网关 GB28181_SERVER_IP 一致")
+    parser.add_argument("--sip-port", type=int, default=5060)
+    parser.add_argument("--rtp-port", type=int, default=40000, help="第 N 个通道收流端口为 rtp-port + 2N")
+    parser.add_argument("--server-id", default="34020000002000000001")
+    parser.add_argument("--device-id", default="34020000001320000001")
+    parser.add_argument("--channels", default="34020000001320000001,34020000001320000002",
+                        help="逗号分隔的通道 ID，需与网关 STREAM_*_GB28181_CHANNEL_ID 一致")
+    parser.add_argument("--domain", default="3402000000")
+    parser.add_argument("--duration-sec", type=float, default=10.0)
+    parser.add_argument("--register-timeout-sec", type=float, default=60.0)
+    return run(parser.parse_args())
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+import argparse
+import random
+import socket
+import struct
+import sys
+import time
+from typing import Dict, List, Optional, Tuple
+
+
+def parse_sip(data: bytes) -> Tuple[str, Dict[str, str], str]:
+    text = data.decode("utf-8", errors="replace")
+    head, _, body = text.partition("\r\n\r\n")
+    lines = head.split("\r\n")
+    headers: Dict[str, str] = {}
+    for line in lines[1:]:
+        name, _, value = line.partition(":")
+        headers.setdefault(name.strip().lower(), value.strip())
+    return lines[0], headers, body
+
+
+def build_response(start: str, headers: Dict[str, str], extra: str = "") -> bytes:
+    lines = [start]
+    for name in ("via", "from", "to", "call-id", "cseq"):
+        if name in headers:
+            lines.append("%s: %s" % (name.title().replace("Call-Id", "Call-ID").replace("Cseq", "CSeq"), headers[name]))
+    lines.append(extra + "Content-Length: 0")
+    return ("\r\n".join(lines) + "\r\n\r\n").encode()
+
+
+class Platform:
+    def __init__(self, args: argparse.Namespace) -> None:
+        self.args = args
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind(("0.0.0.0", args.sip_port))
+        self.sock.settimeout(0.2)
+        self.device_addr: Optional[Tuple[str, int]] = None
+        self.register_sources = set()
+        self.messages: List[str] = []
+        self.cseq = 1
+
+    def answer_pending(self) -> List[Tuple[str, Dict[str, str], str]]:
+        """回复设备发来的 REGISTER / MESSAGE（MESSAGE 正文存入 messages），返回收到的响应。"""
+        responses = []
+        try:
+            while True:
+                data, addr = self.sock.recvfrom(65535)
+                start, headers, body = parse_sip(data)
+                if start.startswith("SIP/2.0"):
+                    responses.append((start, headers, body))
+                    continue
+                method = start.split(" ", 1)[0]
+                if method == "REGISTER":
+                    self.device_addr = addr
+                    self.register_sources.add((addr, headers.get("from", "").split(";")[0]))
+                    print("[PLATFORM] REGISTER from %s:%d" % addr)
+                elif method == "MESSAGE":
+                    self.messages.append(body)
+                self.sock.sendto(build_response("SIP/2.0 200 OK", headers), addr)
+        except socket.timeout:
+            pass
+        return responses
+
+    def request(self, method: str, call_id: str, from_tag: str, to_tag: str, body: str = "",
+                target: Optional[str] = None, content_type: str = "APPLICATION/SDP") -> None:
+        a = self.args
+        target = target or a.device_id
+        to = "<sip:%s@%s>" % (target, a.domain) + (";tag=%s" % to_tag if to_tag else "")
+        lines = [
+            "%s sip:%s@%s:%d SIP/2.0" % (method, target, self.device_addr[0], self.device_addr[1]),
+            "Via: SIP/2.0/UDP %s:%d;rport;branch=z9hG4bK%d" % (a.local_ip, a.sip_port, random.randint(1, 1 << 30)),
+            "From: <sip:%s@%s>;tag=%s" % (a.server_id, a.domain, from_tag),
+            "To: %s" % to,
+            "Call-ID: %s" % call_id,
+            "CSeq: %d %s" % (self.cseq if method != "ACK" else self.cseq - 1, method),
+            "Contact: <sip:%s@%s:%d>" % (a.server_id, a.local_ip, a.sip_port),
+            "Max-Forwards: 70",
+        ]
+        if method != "ACK":
+            self.cseq += 1
+        if body:
+            lines.append("Content-Type: %s" % content_type)
+        lines.append("Content-Length: %d" % len(body))
+        self.sock.sendto(("\r\n".join(lines) + "\r\n\r\n" + body).encode(), self.device_addr)
+
+    def invite(self, call_id: str, rtp_port: int, ssrc: str,
+               target: Optional[str] = None) -> Optional[Tuple[str, str, str]]:
+        a = self.args
+        sdp = (
+            "v=0\r\no=%s 0 0 IN IP4 %s\r\ns=Play\r\nc=IN IP4 %s\r\nt=0 0\r\n"
+            "m=video %d RTP/AVP 96\r\na=recvonly\r\na=rtpmap:96 PS/90000\r\ny=%s\r\n"
+            % (a.server_id, a.local_ip, a.local_ip, rtp_port, ssrc)
+        )
+        from_tag = "p%d" % random.randint(1, 1 << 30)
+        self.request("INVITE", call_id, from_tag, "", sdp, target)
+        deadline = time.time() + 5
+        while time.time() < deadline:
+            for start, headers, _ in self.answer_pending():
+                if headers.get("call-id") != call_id or not start.startswith("SIP/2.0 "):
+                    continue
+                code = int(start.split(" ")[1])
+                if code < 200:
+                    continue
+                if code != 200:
+                    print("[PLATFORM][ERROR] INVITE %s rejected: %s" % (call_id, start))
+                    return None
+                to_tag = headers.get("to", "").partition(";tag=")[2]
+                self.request("ACK", call_id, from_tag, to_tag)
+                print("[PLATFORM] session %s established rtp_port=%d ssrc=%s" % (call_id, rtp_port, ssrc))
+                return call_id, from_tag, to_tag
+        print("[PLATFORM][ERROR] INVITE %s timed out" % call_id)
+        return None
+
+
+class RtpStats:
+    def __init__(self, port: int) -> None:
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind(("0.0.0.0", port))
+        self.sock.setblocking(False)
+        self.ssrcs = set()
+        self.packets = 0
+        self.gaps = 0
+        self.next_seq: Optional[int] = None
+        self.payload_by_ts: Dict[int, bytearray] = {}
+
+    def drain(self) -> None:
+        while True:
+            try:
+                data = self.sock.recv(65535)
+            except BlockingIOError:
+                return
+            if len(data) < 12:
+                continue
+            seq, ts, ssrc = struct.unpack("!HII", data[2:12])
+            self.ssrcs.add(ssrc)
+            if self.next_seq is not None and seq != self.next_seq:
+                self.gaps += 1
+            self.next_seq = (seq + 1) & 0xFFFF
+            self.packets += 1
+            self.payload_by_ts.setdefault(ts, bytearray()).extend(data[12:])
+
+
+def run(args: argparse.Namespace) -> int:
+    platform = Platform(args)
+    receivers = [RtpStats(args.rtp_port), RtpStats(args.rtp_port + 2)]
+
+    print("[PLATFORM] waiting REGISTER on udp/%d ..." % args.sip_port)
+    deadline = time.time() + args.register_timeout_sec
+    while platform.device_addr is None and time.time() < deadline:
+        platform.answer_pending()
+    if platform.device_addr is None:
+        print("[PLATFORM][ERROR] device did not register")
+        return 1
+
+    dialogs = []
+    for i in range(len(receivers)):
+        dialog = platform.invite("multi-%d-%d" % (i, random.randint(1, 1 << 30)), args.rtp_port + 2 * i,
+                                 "0%09d" % (100000001 + i))
+        if dialog is None:
+            return 1
+        dialogs.append(dialog)
+
+    # 两路同时收流，比较同一 RTP 时间戳下的 PS 负载是否一致。
+    end = time.time() + args.duration_sec
+    while time.time() < end:
+        platform.answer_pending()
+        for receiver in receivers:
+            receiver.drain()
+    common = sorted(set(receivers[0].payload_by_ts) & set(receivers[1].payload_by_ts))[1:-1]
+    mismatched = sum(1 for ts in common if receivers[0].payload_by_ts[ts] != receivers[1].payload_by_ts[ts])
+
+    # 挂断第一路，第二路应继续出流。
+    before = receivers[1].packets
+    platform.request("BYE", *dialogs[0])
+    end = time.time() + 3
+    while time.time() < end:
+        platform.answer_pending()
+        for receiver in receivers:
+            receiver.drain()
+    after = receivers[1].packets
+
+    ok = True
+    for i, receiver in enumerate(receivers):
+        print("[PLATFORM] session=%d packets=%d ssrcs=%s seq_gaps=%d" %
+              (i, receiver.packets, ["%08x" % s for s in receiver.ssrcs], receiver.gaps))
+        if receiver.packets == 0 or len(receiver.ssrcs) != 1 or receiver.gaps != 0:
+            ok = False
+    if receivers[0].ssrcs == receivers[1].ssrcs:
+        print("[PLATFORM][ERROR] sessions share an SSRC")
+        ok = False
+    print("[PLATFORM] compared_frames=%d mismatched=%d second_session_after_bye=%d" %
+          (len(common), mismatched, after - before))
+    if not common or mismatched != 0 or after <= before:
+        ok = False
+    print("[PLATFORM] result=%s" % ("PASS" if ok else "FAIL"))
+    return 0 if ok else 1
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="GB28181 multi-session stand-in platform")
+    parser.add_argument("--local-ip", required=True, help="本机（平台）IP，需与网关 GB28181_SERVER_IP 一致")
+    parser.add_argument("--sip-port", type=int, default=5060)
+    parser.add_argument("--rtp-port", type=int, default=40000, help="第一路收流端口，第二路使用 +2")
+    parser.add_argument("--server-id", default="34020000002000000001")
+    parser.add_argument("--device-id", default="34020000001320000001")
+    parser.add_argument("--domain", default="3402000000")
+    parser.add_argument("--duration-sec", type=float, default=10.0)
+    parser.add_argument("--register-timeout-sec", type=float, default=60.0)
+    args = parser.parse_args()
+    return run(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
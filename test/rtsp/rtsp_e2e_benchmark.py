@@ -1,5 +1,6 @@
 #!/usr/bin/env python3
 import argparse
+import json
 import math
 import os
 import re
@@ -14,6 +15,7 @@ SHOWINFO_RE = re.compile(r"showinfo", re.IGNORECASE)
 E2E_SERVER_RE = re.compile(
     r"\[E2E\]\s+event=first_keyframe_sent_after_new_client.*detect_to_send_us=(\d+)"
 )
+GOP_FRAMES_RE = re.compile(r"\[RTSP\]\s+event=client_play.*gop_frames=(\d+)")
 
 
 def percentile(values: List[float], p: float) -> float:
@@ -112,6 +114,50 @@ def parse_server_detect_to_send_us(chunk: str, session_name: str) -> Optional[fl
     return None
 
 
+def parse_server_start_mode(chunk: str, session_name: str) -> Tuple[str, Optional[int]]:
+    """判断本轮客户端的起播方式：gop_cache（从缓存 IDR 起播）/ idr_request（请求新 IDR）/ NA。"""
+    mode = "NA"
+    gop_frames = None
+    for line in chunk.splitlines():
+        if session_name and f"session={session_name}" not in line:
+            continue
+        if "event=new_client_served_from_gop_cache" in line:
+            mode = "gop_cache"
+        elif "event=external_idr_requested" in line and mode == "NA":
+            mode = "idr_request"
+        m = GOP_FRAMES_RE.search(line)
+        if m:
+            gop_frames = int(m.group(1))
+    return mode, gop_frames
+
+
+def summary_dict(values: List[float]) -> dict:
+    if not values:
+        return {"n": 0}
+    return {
+        "n": len(values),
+        "mean": statistics.mean(values),
+        "p95": percentile(values, 0.95),
+        "min": min(values),
+        "max": max(values),
+    }
+
+
+def print_compare(paths: List[str]) -> int:
+    """并排打印多次运行（--summary-json 输出）的结果，用于对比不同起播模式。"""
+    rows = []
+    for path in paths:
+        with open(path, "r", encoding="utf-8") as f:
+            rows.append(json.load(f))
+    print(f"{'label':<20}{'rounds':>8}{'fail':>6}{'ff_mean':>10}{'ff_p95':>10}{'gop_start':>11}{'idr_req':>9}")
+    for r in rows:
+        ff = r.get("client_first_frame", {})
+        print(f"{r.get('label', ''):<20}{r.get('rounds', 0):>8}{r.get('failed_rounds', 0):>6}"
+              f"{ff.get('mean', 0.0):>10.2f}{ff.get('p95', 0.0):>10.2f}"
+              f"{r.get('start_modes', {}).get('gop_cache', 0):>11}{r.get('start_modes', {}).get('idr_request', 0):>9}")
+    return 0
+
+
 def summary(name: str, values: List[float]) -> str:
     if not values:
         return f"{name}: no data"
@@ -122,15 +168,23 @@ def summary(name: str, values: List[float]) -> str:
 
 def main() -> int:
     ap = argparse.ArgumentParser(description="RTSP 多轮首帧时延测试并汇总均值/P95")
-    ap.add_argument("--url", required=True, help="RTSP URL, e.g. rtsp://127.0.0.1:8554/live_sub")
+    ap.add_argument("--url", default="", help="RTSP URL, e.g. rtsp://127.0.0.1:8554/live_sub")
     ap.add_argument("--rounds", type=int, default=20, help="测试轮数，默认20")
     ap.add_argument("--timeout-sec", type=float, default=12.0, help="每轮超时时间，默认12秒")
     ap.add_argument("--transport", choices=["tcp", "udp"], default="tcp", help="RTSP transport，默认 tcp")
     ap.add_argument("--interval-sec", type=float, default=1.0, help="轮次间隔，默认1秒")
     ap.add_argument("--gateway-log", default="", help="网关日志文件路径，可选；用于提取服务端 detect_to_send_us")
     ap.add_argument("--session", default="", help="session 名称，可选；默认从 URL 最后一级路径推断")
+    ap.add_argument("--label", default="", help="本次运行的模式标签，写入 summary json，如 gop_cache / idr_each_client")
+    ap.add_argument("--summary-json", default="", help="把汇总结果写入该 json 文件，供 --compare 对比")
+    ap.add_argument("--compare", nargs="+", default=[], help="只对比若干个 summary json，不拉流")
     args = ap.parse_args()
 
+    if args.compare:
+        return print_compare(args.compare)
+    if not args.url:
+        ap.error("--url is required")
+
     session_name = args.session.strip() or parse_session_from_url(args.url.strip())
     server_log_offset = 0
     if args.gateway_log:
@@ -142,6 +196,8 @@ def main() -> int:
 
     client_delays_ms: List[float] = []
     server_detect_to_send_ms: List[float] = []
+    delays_by_mode = {"gop_cache": [], "idr_request": [], "NA": []}
+    gop_frames_list: List[float] = []
     fail_count = 0
 
     print(f"[INFO] url={args.url}")
@@ -159,6 +215,7 @@ def main() -> int:
             fail_count += 1
             print(f"[ROUND {i:02d}] {round_begin} FAIL reason={reason}")
 
+        start_mode = "NA"
         if args.gateway_log:
             try:
                 chunk, server_log_offset = read_new_log_chunk(args.gateway_log, server_log_offset)
@@ -168,8 +225,14 @@ def main() -> int:
                     print(f"[ROUND {i:02d}] server_detect_to_send={v:.2f}ms")
                 else:
                     print(f"[ROUND {i:02d}] server_detect_to_send=NA")
+                start_mode, gop_frames = parse_server_start_mode(chunk, session_name)
+                if gop_frames is not None and start_mode == "gop_cache":
+                    gop_frames_list.append(float(gop_frames))
+                print(f"[ROUND {i:02d}] start_mode={start_mode} gop_frames={gop_frames if gop_frames is not None else 'NA'}")
             except Exception as ex:
                 print(f"[ROUND {i:02d}] server_log_parse_error={ex}")
+        if ok and delay_ms is not None:
+            delays_by_mode[start_mode].append(delay_ms)
 
         if i != args.rounds and args.interval_sec > 0:
             time.sleep(args.interval_sec)
@@ -178,7 +241,26 @@ def main() -> int:
     print(summary("client_first_frame", client_delays_ms))
     if args.gateway_log:
         print(summary("server_detect_to_send", server_detect_to_send_ms))
+        print(summary("client_first_frame[gop_cache]", delays_by_mode["gop_cache"]))
+        print(summary("client_first_frame[idr_request]", delays_by_mode["idr_request"]))
+        print(f"start_modes gop_cache={len(delays_by_mode['gop_cache'])} idr_request={len(delays_by_mode['idr_request'])}"
+              f" gop_frames_mean={statistics.mean(gop_frames_list) if gop_frames_list else 0.0:.1f}")
     print(f"failed_rounds={fail_count}")
+    if args.summary_json:
+        result = {
+            "label": args.label or session_name,
+            "url": args.url,
+            "transport": args.transport,
+            "rounds": args.rounds,
+            "failed_rounds": fail_count,
+            "client_first_frame": summary_dict(client_delays_ms),
+            "server_detect_to_send": summary_dict(server_detect_to_send_ms),
+            "start_modes": {k: len(v) for k, v in delays_by_mode.items()},
+            "client_first_frame_by_mode": {k: summary_dict(v) for k, v in delays_by_mode.items()},
+        }
+        with open(args.summary_json, "w", encoding="utf-8") as f:
+            json.dump(result, f, indent=2)
+        print(f"[INFO] summary written to {args.summary_json}")
     return 0
 
 